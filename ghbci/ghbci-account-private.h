@@ -24,5 +24,7 @@
 
 GHbciAccount* ghbci_account_new_with_jobject (GHbciContext* context, jobject jobj);
 
+GHbciAccount* ghbci_account_new_with_properties (GHbciContext* context, GVariant* properties);
+
 #endif /* __GHBCI_ACCOUNT_PRIVATE_H__ */
 
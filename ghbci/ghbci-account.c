@@ -32,6 +32,8 @@
 #include "ghbci-account-private.h"
 #include "ghbci-context.h"
 #include "ghbci-context-private.h"
+#include "ghbci-instrumentation-private.h"
+#include "ghbci-jstring-private.h"
 #include "ghbci-marshal.h"
 
 #define GHBCI_ACCOUNT_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), \
@@ -46,6 +48,8 @@ struct _GHbciAccountPrivate
     jobject account_jobj;
     JNIEnv* jni_env;
     GHbciContext* context;
+    /* property name to value, for accounts of worker processes instead of account_jobj */
+    GHashTable* values;
 };
 
 /* properties */
@@ -195,19 +199,25 @@ ghbci_account_init (GHbciAccount *self)
     priv->jni_env = NULL;
     priv->context = NULL;
     priv->account_jobj = NULL;
+    priv->values = NULL;
 }
 
 static void
 ghbci_account_dispose (GObject *obj)
 {
     GHbciAccountPrivate *priv;
-    GHbciContextPrivate *context_priv;
 
     GHbciAccount *self = GHBCI_ACCOUNT (obj);
     priv = GHBCI_ACCOUNT_GET_PRIVATE (self);
-    context_priv = priv->context->priv;
 
-    (*context_priv->jni_env)->DeleteLocalRef(context_priv->jni_env, priv->account_jobj);
+    // nothing to delete once the jvm is destroyed, e.g. by
+    // g_object_run_dispose() on the context
+    if (priv->account_jobj != NULL && priv->context->priv->jvm != NULL) {
+        JNIEnv* jni_env = ghbci_context_get_jni_env (priv->context);
+        (*jni_env)->DeleteGlobalRef(jni_env, priv->account_jobj);
+    }
+    priv->account_jobj = NULL;
+    g_clear_object (&priv->context);
 
     G_OBJECT_CLASS (ghbci_account_parent_class)->dispose (obj);
 }
@@ -215,9 +225,12 @@ ghbci_account_dispose (GObject *obj)
 static void
 ghbci_account_finalize (GObject *obj)
 {
-  //GHbciAccount *self = GHBCI_ACCOUNT (obj);
+    GHbciAccount *self = GHBCI_ACCOUNT (obj);
+
+    if (self->priv->values != NULL)
+        g_hash_table_unref(self->priv->values);
 
-  G_OBJECT_CLASS (ghbci_account_parent_class)->finalize (obj);
+    G_OBJECT_CLASS (ghbci_account_parent_class)->finalize (obj);
 }
 
 static void
@@ -229,52 +242,58 @@ ghbci_account_set_property (GObject      *obj,
     GHbciAccount *self;
     GHbciAccountPrivate *priv;
     GHbciContextPrivate *context_priv;
+    JNIEnv *jni_env;
 
     self = GHBCI_ACCOUNT (obj);
     priv = GHBCI_ACCOUNT_GET_PRIVATE (self);
+    if (priv->values != NULL) {
+        g_hash_table_replace(priv->values, g_strdup(pspec->name), g_value_dup_string(value));
+        return;
+    }
     context_priv = priv->context->priv;
+    jni_env = ghbci_context_get_jni_env (priv->context);
 
     const gchar* native_string = g_value_get_string (value);
-    jstring jvalue = (*context_priv->jni_env)->NewStringUTF(context_priv->jni_env, native_string);
+    jstring jvalue = (*jni_env)->NewStringUTF(jni_env, native_string);
 
     switch (prop_id)
     {
     case PROP_COUNTRY:
-        (*context_priv->jni_env)->SetObjectField(context_priv->jni_env, priv->account_jobj, context_priv->field_Konto_country, jvalue);
+        (*jni_env)->SetObjectField(jni_env, priv->account_jobj, context_priv->field_Konto_country, jvalue);
         break;
     case PROP_BLZ:
-        (*context_priv->jni_env)->SetObjectField(context_priv->jni_env, priv->account_jobj, context_priv->field_Konto_blz, jvalue);
+        (*jni_env)->SetObjectField(jni_env, priv->account_jobj, context_priv->field_Konto_blz, jvalue);
         break;
     case PROP_NUMBER:
-        (*context_priv->jni_env)->SetObjectField(context_priv->jni_env, priv->account_jobj, context_priv->field_Konto_number, jvalue);
+        (*jni_env)->SetObjectField(jni_env, priv->account_jobj, context_priv->field_Konto_number, jvalue);
         break;
     case PROP_SUBNUMBER:
-        (*context_priv->jni_env)->SetObjectField(context_priv->jni_env, priv->account_jobj, context_priv->field_Konto_subnumber, jvalue);
+        (*jni_env)->SetObjectField(jni_env, priv->account_jobj, context_priv->field_Konto_subnumber, jvalue);
         break;
     case PROP_ACCOUNT_TYPE:
-        (*context_priv->jni_env)->SetObjectField(context_priv->jni_env, priv->account_jobj, context_priv->field_Konto_type, jvalue);
+        (*jni_env)->SetObjectField(jni_env, priv->account_jobj, context_priv->field_Konto_type, jvalue);
         break;
     case PROP_CURRENCY:
-        (*context_priv->jni_env)->SetObjectField(context_priv->jni_env, priv->account_jobj, context_priv->field_Konto_curr, jvalue);
+        (*jni_env)->SetObjectField(jni_env, priv->account_jobj, context_priv->field_Konto_curr, jvalue);
         break;
     case PROP_CUSTOMERID:
-        (*context_priv->jni_env)->SetObjectField(context_priv->jni_env, priv->account_jobj, context_priv->field_Konto_customerid, jvalue);
+        (*jni_env)->SetObjectField(jni_env, priv->account_jobj, context_priv->field_Konto_customerid, jvalue);
         break;
     case PROP_OWNER_NAME:
-        (*context_priv->jni_env)->SetObjectField(context_priv->jni_env, priv->account_jobj, context_priv->field_Konto_name, jvalue);
+        (*jni_env)->SetObjectField(jni_env, priv->account_jobj, context_priv->field_Konto_name, jvalue);
         break;
     case PROP_BIC:
-        (*context_priv->jni_env)->SetObjectField(context_priv->jni_env, priv->account_jobj, context_priv->field_Konto_bic, jvalue);
+        (*jni_env)->SetObjectField(jni_env, priv->account_jobj, context_priv->field_Konto_bic, jvalue);
         break;
     case PROP_IBAN:
-        (*context_priv->jni_env)->SetObjectField(context_priv->jni_env, priv->account_jobj, context_priv->field_Konto_iban, jvalue);
+        (*jni_env)->SetObjectField(jni_env, priv->account_jobj, context_priv->field_Konto_iban, jvalue);
         break;
 
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (obj, prop_id, pspec);
       break;
     }
-    (*context_priv->jni_env)->DeleteLocalRef(context_priv->jni_env, jvalue);
+    (*jni_env)->DeleteLocalRef(jni_env, jvalue);
 }
 
 static void
@@ -286,43 +305,50 @@ ghbci_account_get_property (GObject    *obj,
     GHbciAccount *self;
     GHbciAccountPrivate *priv;
     GHbciContextPrivate *context_priv;
+    JNIEnv *jni_env;
     jstring java_value;
 
     self = GHBCI_ACCOUNT (obj);
     priv = GHBCI_ACCOUNT_GET_PRIVATE (self);
+    GHBCI_INSTRUMENT (priv->context, G_STRFUNC);
+    if (priv->values != NULL) {
+        g_value_set_string (value, g_hash_table_lookup(priv->values, pspec->name));
+        return;
+    }
     context_priv = priv->context->priv;
+    jni_env = ghbci_context_get_jni_env (priv->context);
 
     switch (prop_id)
     {
     case PROP_COUNTRY:
-        java_value = (*context_priv->jni_env)->GetObjectField(context_priv->jni_env, priv->account_jobj, context_priv->field_Konto_country);
+        java_value = (*jni_env)->GetObjectField(jni_env, priv->account_jobj, context_priv->field_Konto_country);
         break;
     case PROP_BLZ:
-        java_value = (*context_priv->jni_env)->GetObjectField(context_priv->jni_env, priv->account_jobj, context_priv->field_Konto_blz);
+        java_value = (*jni_env)->GetObjectField(jni_env, priv->account_jobj, context_priv->field_Konto_blz);
         break;
     case PROP_NUMBER:
-        java_value = (*context_priv->jni_env)->GetObjectField(context_priv->jni_env, priv->account_jobj, context_priv->field_Konto_number);
+        java_value = (*jni_env)->GetObjectField(jni_env, priv->account_jobj, context_priv->field_Konto_number);
         break;
     case PROP_SUBNUMBER:
-        java_value = (*context_priv->jni_env)->GetObjectField(context_priv->jni_env, priv->account_jobj, context_priv->field_Konto_subnumber);
+        java_value = (*jni_env)->GetObjectField(jni_env, priv->account_jobj, context_priv->field_Konto_subnumber);
         break;
     case PROP_ACCOUNT_TYPE:
-        java_value = (*context_priv->jni_env)->GetObjectField(context_priv->jni_env, priv->account_jobj, context_priv->field_Konto_type);
+        java_value = (*jni_env)->GetObjectField(jni_env, priv->account_jobj, context_priv->field_Konto_type);
         break;
     case PROP_CURRENCY:
-        java_value = (*context_priv->jni_env)->GetObjectField(context_priv->jni_env, priv->account_jobj, context_priv->field_Konto_curr);
+        java_value = (*jni_env)->GetObjectField(jni_env, priv->account_jobj, context_priv->field_Konto_curr);
         break;
     case PROP_CUSTOMERID:
-        java_value = (*context_priv->jni_env)->GetObjectField(context_priv->jni_env, priv->account_jobj, context_priv->field_Konto_customerid);
+        java_value = (*jni_env)->GetObjectField(jni_env, priv->account_jobj, context_priv->field_Konto_customerid);
         break;
     case PROP_OWNER_NAME:
-        java_value = (*context_priv->jni_env)->GetObjectField(context_priv->jni_env, priv->account_jobj, context_priv->field_Konto_name);
+        java_value = (*jni_env)->GetObjectField(jni_env, priv->account_jobj, context_priv->field_Konto_name);
         break;
     case PROP_BIC:
-        java_value = (*context_priv->jni_env)->GetObjectField(context_priv->jni_env, priv->account_jobj, context_priv->field_Konto_bic);
+        java_value = (*jni_env)->GetObjectField(jni_env, priv->account_jobj, context_priv->field_Konto_bic);
         break;
     case PROP_IBAN:
-        java_value = (*context_priv->jni_env)->GetObjectField(context_priv->jni_env, priv->account_jobj, context_priv->field_Konto_iban);
+        java_value = (*jni_env)->GetObjectField(jni_env, priv->account_jobj, context_priv->field_Konto_iban);
         break;
 
     default:
@@ -330,11 +356,9 @@ ghbci_account_get_property (GObject    *obj,
         return;
     }
     if (java_value != NULL) {
-        const char* nativeString = (*context_priv->jni_env)->GetStringUTFChars(context_priv->jni_env, java_value, 0);
-        g_value_set_string (value, nativeString);
-        (*context_priv->jni_env)->ReleaseStringUTFChars(context_priv->jni_env, java_value, nativeString);
+        g_value_take_string (value, ghbci_jstring_dup (jni_env, java_value));
 
-        (*context_priv->jni_env)->DeleteLocalRef(context_priv->jni_env, java_value);
+        (*jni_env)->DeleteLocalRef(jni_env, java_value);
     }
 }
 
@@ -343,11 +367,41 @@ ghbci_account_new_with_jobject (GHbciContext* context, jobject jobj)
 {
     GHbciAccount* account;
     GHbciAccountPrivate* priv;
+    JNIEnv* jni_env;
+
+    account = g_object_new (GHBCI_TYPE_ACCOUNT, NULL);
+    priv = account->priv;
+    // the jvm of the context must outlive the global reference
+    priv->context = g_object_ref (context);
+    // accounts may be used from other threads, keep a global reference
+    jni_env = ghbci_context_get_jni_env (context);
+    priv->account_jobj = (*jni_env)->NewGlobalRef(jni_env, jobj);
+
+    return account;
+}
+
+/*
+ * An account of a worker process, from the a{ss} of its properties. A
+ * floating variant is consumed.
+ */
+GHbciAccount*
+ghbci_account_new_with_properties (GHbciContext* context, GVariant* properties)
+{
+    GHbciAccount* account;
+    GHbciAccountPrivate* priv;
+    GVariantIter iter;
+    gchar *name, *value;
 
     account = g_object_new (GHBCI_TYPE_ACCOUNT, NULL);
     priv = account->priv;
-    priv->context = context;
-    priv->account_jobj = jobj;
+    priv->context = g_object_ref (context);
+    priv->values = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+    g_variant_ref_sink(properties);
+    g_variant_iter_init(&iter, properties);
+    while (g_variant_iter_next(&iter, "{ss}", &name, &value))
+        g_hash_table_replace(priv->values, name, value);
+    g_variant_unref(properties);
 
     return account;
 }
@@ -371,17 +425,24 @@ ghbci_account_new (GHbciContext* context)
     GHbciContextPrivate* context_priv;
     JNIEnv* jni_env;
 
+    context_priv = context->priv;
+    // contexts with worker processes have no jvm here
+    if (context_priv->jvm == NULL)
+        return ghbci_account_new_with_properties (context, g_variant_new("a{ss}", NULL));
+
     account = g_object_new (GHBCI_TYPE_ACCOUNT, NULL);
     priv = account->priv;
-    priv->context = context;
-    context_priv = context->priv;
-    jni_env = context_priv->jni_env;
-    priv->account_jobj = (*jni_env)->NewObject(jni_env, context_priv->class_Konto, context_priv->method_Konto_constructor);
+    priv->context = g_object_ref (context);
+    jni_env = ghbci_context_get_jni_env (context);
+    jobject account_jobj = (*jni_env)->NewObject(jni_env, context_priv->class_Konto, context_priv->method_Konto_constructor);
 
-    if (priv->account_jobj == NULL) {
+    if (account_jobj == NULL) {
         (*jni_env)->ExceptionDescribe(jni_env);
+        g_object_unref (account);
         return NULL;
     }
+    priv->account_jobj = (*jni_env)->NewGlobalRef(jni_env, account_jobj);
+    (*jni_env)->DeleteLocalRef(jni_env, account_jobj);
 
     return account;
 }
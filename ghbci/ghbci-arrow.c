@@ -0,0 +1,472 @@
+/*
+ * ghbci-arrow.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/*
+ * Export of statements through the Arrow C Data Interface. Every column is
+ * built in one pass over the statements into buffers owned by the array;
+ * the release callbacks free them once the consumer is done.
+ */
+
+#include <string.h>
+
+#include "ghbci-export.h"
+#include "ghbci-arrow-private.h"
+#include "ghbci-statement.h"
+#include "ghbci-statement-private.h"
+
+/* index of the low 64 bits of a decimal128 */
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define LOW_WORD            0
+#else
+#define LOW_WORD            1
+#endif
+
+typedef enum
+{
+    COLUMN_DATE,
+    COLUMN_DECIMAL,
+    COLUMN_CURRENCY,
+    COLUMN_DICTIONARY,
+    COLUMN_STRING
+} ColumnType;
+
+static const struct
+{
+    const gchar* name;
+    ColumnType type;
+    gsize offset;
+} columns[] = {
+    { "valuta", COLUMN_DATE, G_STRUCT_OFFSET(GHbciStatementPrivate, valuta) },
+    { "booking_date", COLUMN_DATE, G_STRUCT_OFFSET(GHbciStatementPrivate, booking_date) },
+    { "value", COLUMN_DECIMAL, G_STRUCT_OFFSET(GHbciStatementPrivate, value) },
+    { "currency", COLUMN_CURRENCY, G_STRUCT_OFFSET(GHbciStatementPrivate, value) },
+    { "saldo", COLUMN_DECIMAL, G_STRUCT_OFFSET(GHbciStatementPrivate, saldo) },
+    { "gv_code", COLUMN_DICTIONARY, G_STRUCT_OFFSET(GHbciStatementPrivate, gv_code) },
+    { "transaction_type", COLUMN_DICTIONARY, G_STRUCT_OFFSET(GHbciStatementPrivate, transaction_type) },
+    { "other_name", COLUMN_STRING, G_STRUCT_OFFSET(GHbciStatementPrivate, other_name) },
+    { "other_iban", COLUMN_STRING, G_STRUCT_OFFSET(GHbciStatementPrivate, other_iban) },
+    { "other_bic", COLUMN_STRING, G_STRUCT_OFFSET(GHbciStatementPrivate, other_bic) },
+    { "eref", COLUMN_STRING, G_STRUCT_OFFSET(GHbciStatementPrivate, eref) },
+    { "mref", COLUMN_STRING, G_STRUCT_OFFSET(GHbciStatementPrivate, mref) },
+    { "cred", COLUMN_STRING, G_STRUCT_OFFSET(GHbciStatementPrivate, cred) },
+    { "reference", COLUMN_STRING, G_STRUCT_OFFSET(GHbciStatementPrivate, reference) },
+};
+
+/* amounts are in cent */
+static const gchar decimal_format[] = "d:18,2";
+
+/* buffers of an array, freed on release */
+typedef struct
+{
+    gpointer buffers[3];
+} ArrayData;
+
+static void
+release_array (struct ArrowArray* array)
+{
+    ArrayData* data = array->private_data;
+    gint64 i;
+
+    for (i = 0; i < array->n_children; i++) {
+        // the consumer may have moved the child out
+        if (array->children[i]->release != NULL)
+            array->children[i]->release(array->children[i]);
+        g_free(array->children[i]);
+    }
+    if (array->dictionary != NULL) {
+        if (array->dictionary->release != NULL)
+            array->dictionary->release(array->dictionary);
+        g_free(array->dictionary);
+    }
+    for (i = 0; i < array->n_buffers; i++)
+        g_free(data->buffers[i]);
+    g_free(array->buffers);
+    g_free(array->children);
+    g_free(data);
+    array->release = NULL;
+}
+
+static void
+release_schema (struct ArrowSchema* schema)
+{
+    gint64 i;
+
+    for (i = 0; i < schema->n_children; i++) {
+        if (schema->children[i]->release != NULL)
+            schema->children[i]->release(schema->children[i]);
+        g_free(schema->children[i]);
+    }
+    if (schema->dictionary != NULL) {
+        if (schema->dictionary->release != NULL)
+            schema->dictionary->release(schema->dictionary);
+        g_free(schema->dictionary);
+    }
+    g_free(schema->children);
+    schema->release = NULL;
+}
+
+/*
+ * Buffers are never NULL, even for empty arrays
+ */
+static gpointer
+new_buffer (gsize size)
+{
+    return g_malloc0(MAX(size, 8));
+}
+
+static void
+init_array (struct ArrowArray* array, gint64 length, gint64 n_buffers, gint64 n_children)
+{
+    ArrayData* data = g_new0(ArrayData, 1);
+    gint64 i;
+
+    memset(array, 0, sizeof(*array));
+    array->length = length;
+    array->n_buffers = n_buffers;
+    array->n_children = n_children;
+    array->buffers = g_new0(const void*, n_buffers);
+    if (n_children > 0) {
+        array->children = g_new0(struct ArrowArray*, n_children);
+        for (i = 0; i < n_children; i++)
+            array->children[i] = g_new0(struct ArrowArray, 1);
+    }
+    array->release = release_array;
+    array->private_data = data;
+}
+
+/*
+ * Give a buffer to the array
+ */
+static void
+set_buffer (struct ArrowArray* array, gint64 index, gpointer buffer)
+{
+    ArrayData* data = array->private_data;
+
+    data->buffers[index] = buffer;
+    array->buffers[index] = buffer;
+}
+
+static void
+init_schema (struct ArrowSchema* schema, const gchar* format, const gchar* name, gint64 flags, gint64 n_children)
+{
+    gint64 i;
+
+    memset(schema, 0, sizeof(*schema));
+    schema->format = format;
+    schema->name = name;
+    schema->flags = flags;
+    schema->n_children = n_children;
+    if (n_children > 0) {
+        schema->children = g_new0(struct ArrowSchema*, n_children);
+        for (i = 0; i < n_children; i++)
+            schema->children[i] = g_new0(struct ArrowSchema, 1);
+    }
+    schema->release = release_schema;
+}
+
+/*
+ * The validity bitmap is created at the first null
+ */
+static void
+set_null (struct ArrowArray* array, guint8** validity, gint64 index)
+{
+    if (*validity == NULL) {
+        *validity = new_buffer((array->length + 7) / 8);
+        memset(*validity, 0xff, (array->length + 7) / 8);
+        set_buffer(array, 0, *validity);
+    }
+    (*validity)[index / 8] &= ~(1 << (index % 8));
+    array->null_count++;
+}
+
+static const gchar*
+string_field (const GHbciStatementPrivate* priv, guint column)
+{
+    return G_STRUCT_MEMBER(const gchar*, priv, columns[column].offset);
+}
+
+/*
+ * "-12.34 EUR" in cent
+ */
+static gboolean
+parse_value (const gchar* value, gint64* cents)
+{
+    const gchar* p = value;
+    gboolean negative = FALSE;
+    gint64 units = 0;
+    guint fraction = 0;
+    guint digits = 0;
+
+    if (value == NULL)
+        return FALSE;
+    if (*p == '-') {
+        negative = TRUE;
+        p++;
+    }
+    if (!g_ascii_isdigit(*p))
+        return FALSE;
+    for (; g_ascii_isdigit(*p); p++) {
+        if (units > (G_MAXINT64 / 100 - 99) / 10)
+            return FALSE;
+        units = units * 10 + (*p - '0');
+    }
+    if (*p == '.') {
+        for (p++; g_ascii_isdigit(*p); p++, digits++) {
+            if (digits == 2)
+                return FALSE;
+            fraction = fraction * 10 + (*p - '0');
+        }
+    }
+    if (*p != '\0' && *p != ' ')
+        return FALSE;
+    if (digits == 1)
+        fraction *= 10;
+    *cents = units * 100 + fraction;
+    if (negative)
+        *cents = -*cents;
+    return TRUE;
+}
+
+static const gchar*
+currency_of (const gchar* value)
+{
+    const gchar* space = value != NULL ? strrchr(value, ' ') : NULL;
+
+    return space != NULL ? space + 1 : NULL;
+}
+
+static void
+build_date (struct ArrowArray* array, GHbciStatementPrivate** privs, gint64 length, guint column)
+{
+    gint32* values = new_buffer(length * sizeof(gint32));
+    guint8* validity = NULL;
+    gint64 i;
+
+    init_array(array, length, 2, 0);
+    set_buffer(array, 1, values);
+    for (i = 0; i < length; i++) {
+        guint32 date = G_STRUCT_MEMBER(guint32, privs[i], columns[column].offset);
+        if (date != 0)
+            values[i] = (gint64)date - GHBCI_UNIX_EPOCH_JULIAN;
+        else
+            set_null(array, &validity, i);
+    }
+}
+
+/*
+ * decimal128 is a two's complement 128 bit integer in native byte order
+ */
+static void
+build_decimal (struct ArrowArray* array, GHbciStatementPrivate** privs, gint64 length, guint column)
+{
+    guint64* values = new_buffer(length * 2 * sizeof(guint64));
+    guint8* validity = NULL;
+    gint64 cents;
+    gint64 i;
+
+    init_array(array, length, 2, 0);
+    set_buffer(array, 1, values);
+    for (i = 0; i < length; i++) {
+        if (parse_value(string_field(privs[i], column), &cents)) {
+            values[2 * i + LOW_WORD] = (guint64)cents;
+            values[2 * i + 1 - LOW_WORD] = cents < 0 ? G_MAXUINT64 : 0;
+        } else {
+            set_null(array, &validity, i);
+        }
+    }
+}
+
+/*
+ * utf8 array of the distinct values, in order of appearance
+ */
+static void
+build_dictionary_values (struct ArrowArray* array, GPtrArray* values)
+{
+    gint32* offsets = new_buffer((values->len + 1) * sizeof(gint32));
+    gchar* data;
+    gsize size = 0;
+    guint i;
+
+    for (i = 0; i < values->len; i++)
+        size += strlen(g_ptr_array_index(values, i));
+    data = new_buffer(size);
+
+    init_array(array, values->len, 3, 0);
+    set_buffer(array, 1, offsets);
+    set_buffer(array, 2, data);
+    size = 0;
+    for (i = 0; i < values->len; i++) {
+        gsize value_length = strlen(g_ptr_array_index(values, i));
+        offsets[i] = size;
+        memcpy(data + size, g_ptr_array_index(values, i), value_length);
+        size += value_length;
+    }
+    offsets[values->len] = size;
+}
+
+static void
+build_dictionary (struct ArrowArray* array, GHbciStatementPrivate** privs, gint64 length, guint column)
+{
+    GHashTable* indices = g_hash_table_new(g_str_hash, g_str_equal);
+    GPtrArray* values = g_ptr_array_new();
+    gint32* keys = new_buffer(length * sizeof(gint32));
+    guint8* validity = NULL;
+    gpointer index;
+    gint64 i;
+
+    init_array(array, length, 2, 0);
+    set_buffer(array, 1, keys);
+    for (i = 0; i < length; i++) {
+        const gchar* text = string_field(privs[i], column);
+        if (columns[column].type == COLUMN_CURRENCY)
+            text = currency_of(text);
+        if (text == NULL) {
+            set_null(array, &validity, i);
+            continue;
+        }
+        if (!g_hash_table_lookup_extended(indices, text, NULL, &index)) {
+            index = GINT_TO_POINTER(values->len);
+            g_hash_table_insert(indices, (gpointer)text, index);
+            g_ptr_array_add(values, (gpointer)text);
+        }
+        keys[i] = GPOINTER_TO_INT(index);
+    }
+
+    array->dictionary = g_new0(struct ArrowArray, 1);
+    build_dictionary_values(array->dictionary, values);
+    g_ptr_array_unref(values);
+    g_hash_table_unref(indices);
+}
+
+/*
+ * large_utf8, 64 bit offsets never overflow
+ */
+static void
+build_string (struct ArrowArray* array, GHbciStatementPrivate** privs, gint64 length, guint column)
+{
+    gint64* offsets = new_buffer((length + 1) * sizeof(gint64));
+    guint8* validity = NULL;
+    gchar* data;
+    gsize size = 0;
+    gsize text_length;
+    gint64 i;
+
+    for (i = 0; i < length; i++) {
+        const gchar* text = string_field(privs[i], column);
+        if (text != NULL)
+            size += strlen(text);
+    }
+    data = new_buffer(size);
+
+    init_array(array, length, 3, 0);
+    set_buffer(array, 1, offsets);
+    set_buffer(array, 2, data);
+    size = 0;
+    for (i = 0; i < length; i++) {
+        const gchar* text = string_field(privs[i], column);
+        offsets[i] = size;
+        if (text == NULL) {
+            set_null(array, &validity, i);
+            continue;
+        }
+        text_length = strlen(text);
+        memcpy(data + size, text, text_length);
+        size += text_length;
+    }
+    offsets[length] = size;
+}
+
+static void
+build_column_schema (struct ArrowSchema* schema, guint column)
+{
+    switch (columns[column].type) {
+    case COLUMN_DATE:
+        init_schema(schema, "tdD", columns[column].name, ARROW_FLAG_NULLABLE, 0);
+        break;
+    case COLUMN_DECIMAL:
+        init_schema(schema, decimal_format, columns[column].name, ARROW_FLAG_NULLABLE, 0);
+        break;
+    case COLUMN_CURRENCY:
+    case COLUMN_DICTIONARY:
+        init_schema(schema, "i", columns[column].name, ARROW_FLAG_NULLABLE, 0);
+        schema->dictionary = g_new0(struct ArrowSchema, 1);
+        init_schema(schema->dictionary, "u", NULL, 0, 0);
+        break;
+    case COLUMN_STRING:
+        init_schema(schema, "U", columns[column].name, ARROW_FLAG_NULLABLE, 0);
+        break;
+    }
+}
+
+/**
+ * ghbci_export_statements_arrow:
+ * @statements: (element-type GHbciStatement): statements, e.g. of
+ *   ghbci_context_get_statements()
+ * @out_array: address of a struct ArrowArray
+ * @out_schema: address of a struct ArrowSchema
+ *
+ * Export @statements through the Arrow C Data Interface as a struct array
+ * with one column per field. valuta and booking_date are date32, value and
+ * saldo decimal128(18, 2), currency, gv_code and transaction_type
+ * dictionary encoded strings, the other fields large_utf8. The columns are
+ * copies, @statements may be freed right away. Release both with their
+ * release callbacks, consumers like pyarrow do that.
+ **/
+void
+ghbci_export_statements_arrow (GSList* statements, gpointer out_array, gpointer out_schema)
+{
+    struct ArrowArray* array = out_array;
+    struct ArrowSchema* schema = out_schema;
+    GHbciStatementPrivate** privs;
+    gint64 length = g_slist_length(statements);
+    GSList* iter;
+    gint64 i;
+    guint column;
+
+    g_return_if_fail (array != NULL);
+    g_return_if_fail (schema != NULL);
+
+    privs = g_new(GHbciStatementPrivate*, MAX(length, 1));
+    for (iter = statements, i = 0; iter != NULL; iter = iter->next, i++)
+        privs[i] = GHBCI_STATEMENT(iter->data)->priv;
+
+    init_schema(schema, "+s", "", 0, G_N_ELEMENTS(columns));
+    init_array(array, length, 1, G_N_ELEMENTS(columns));
+    for (column = 0; column < G_N_ELEMENTS(columns); column++) {
+        build_column_schema(schema->children[column], column);
+        switch (columns[column].type) {
+        case COLUMN_DATE:
+            build_date(array->children[column], privs, length, column);
+            break;
+        case COLUMN_DECIMAL:
+            build_decimal(array->children[column], privs, length, column);
+            break;
+        case COLUMN_CURRENCY:
+        case COLUMN_DICTIONARY:
+            build_dictionary(array->children[column], privs, length, column);
+            break;
+        case COLUMN_STRING:
+            build_string(array->children[column], privs, length, column);
+            break;
+        }
+    }
+    g_free(privs);
+}
+
+
+// vim: sw=4 expandtab
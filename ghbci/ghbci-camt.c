@@ -0,0 +1,521 @@
+/*
+ * ghbci-camt.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/*
+ * Streaming decoder of camt.052 account reports (camt.053 statements are
+ * read the same way). The document is fed in chunks to a GMarkup parser;
+ * only the path of the current element and the fields of the current entry
+ * are kept, each entry becomes a statement as soon as it is closed.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ghbci-camt-private.h"
+#include "ghbci-statement.h"
+#include "ghbci-statement-private.h"
+
+/* length of an unstructured remittance line, shorter lines are followed by a space */
+#define USAGE_LINE_LENGTH   140
+/* EndToEndId of transactions without one */
+#define NOT_PROVIDED        "NOTPROVIDED"
+
+typedef enum
+{
+    ENTRY_AMOUNT,
+    ENTRY_CREDIT_DEBIT,
+    ENTRY_STATUS,
+    ENTRY_BOOKING_DATE,
+    ENTRY_VALUTA,
+    ENTRY_BANK_CODE,
+    ENTRY_INFO,
+    ENTRY_TX_BANK_CODE,
+    ENTRY_TX_INFO,
+    ENTRY_EREF,
+    ENTRY_MREF,
+    ENTRY_CRED,
+    ENTRY_DEBTOR_NAME,
+    ENTRY_DEBTOR_IBAN,
+    ENTRY_DEBTOR_BIC,
+    ENTRY_CREDITOR_NAME,
+    ENTRY_CREDITOR_IBAN,
+    ENTRY_CREDITOR_BIC,
+    ENTRY_USAGE,
+    N_ENTRY_FIELDS
+} EntryField;
+
+/* path of the fields below Ntry, the first transaction only */
+static const struct
+{
+    const gchar* path;
+    EntryField field;
+} entry_paths[] = {
+    { "Amt", ENTRY_AMOUNT },
+    { "CdtDbtInd", ENTRY_CREDIT_DEBIT },
+    { "Sts", ENTRY_STATUS },
+    { "Sts/Cd", ENTRY_STATUS },
+    { "BookgDt/Dt", ENTRY_BOOKING_DATE },
+    { "BookgDt/DtTm", ENTRY_BOOKING_DATE },
+    { "ValDt/Dt", ENTRY_VALUTA },
+    { "ValDt/DtTm", ENTRY_VALUTA },
+    { "BkTxCd/Prtry/Cd", ENTRY_BANK_CODE },
+    { "AddtlNtryInf", ENTRY_INFO },
+    { "NtryDtls/TxDtls/BkTxCd/Prtry/Cd", ENTRY_TX_BANK_CODE },
+    { "NtryDtls/TxDtls/AddtlTxInf", ENTRY_TX_INFO },
+    { "NtryDtls/TxDtls/Refs/EndToEndId", ENTRY_EREF },
+    { "NtryDtls/TxDtls/Refs/MndtId", ENTRY_MREF },
+    { "NtryDtls/TxDtls/RltdPties/Cdtr/Id/PrvtId/Othr/Id", ENTRY_CRED },
+    { "NtryDtls/TxDtls/RltdPties/Cdtr/Pty/Id/PrvtId/Othr/Id", ENTRY_CRED },
+    { "NtryDtls/TxDtls/RltdPties/Dbtr/Nm", ENTRY_DEBTOR_NAME },
+    { "NtryDtls/TxDtls/RltdPties/Dbtr/Pty/Nm", ENTRY_DEBTOR_NAME },
+    { "NtryDtls/TxDtls/RltdPties/DbtrAcct/Id/IBAN", ENTRY_DEBTOR_IBAN },
+    { "NtryDtls/TxDtls/RltdAgts/DbtrAgt/FinInstnId/BIC", ENTRY_DEBTOR_BIC },
+    { "NtryDtls/TxDtls/RltdAgts/DbtrAgt/FinInstnId/BICFI", ENTRY_DEBTOR_BIC },
+    { "NtryDtls/TxDtls/RltdPties/Cdtr/Nm", ENTRY_CREDITOR_NAME },
+    { "NtryDtls/TxDtls/RltdPties/Cdtr/Pty/Nm", ENTRY_CREDITOR_NAME },
+    { "NtryDtls/TxDtls/RltdPties/CdtrAcct/Id/IBAN", ENTRY_CREDITOR_IBAN },
+    { "NtryDtls/TxDtls/RltdAgts/CdtrAgt/FinInstnId/BIC", ENTRY_CREDITOR_BIC },
+    { "NtryDtls/TxDtls/RltdAgts/CdtrAgt/FinInstnId/BICFI", ENTRY_CREDITOR_BIC },
+    { "NtryDtls/TxDtls/RmtInf/Ustrd", ENTRY_USAGE },
+};
+
+struct _GHbciCamtDecoder
+{
+    GMarkupParseContext* context;
+    GHbciStringPool* pool;
+    GHbciStatementFunc func;
+    gpointer user_data;
+
+    /* local names of the open elements joined by '/', and where each starts */
+    GString* path;
+    GArray* path_lengths;
+    GString* text;
+
+    /* depth of the open Rpt/Stmt and Ntry element, 0 if none */
+    guint report_depth;
+    gsize report_offset;
+    guint entry_depth;
+    gsize entry_offset;
+
+    /* opening balance of the report, in cent */
+    gboolean has_balance;
+    gint64 balance;
+    gchar* balance_code;
+    gchar* balance_amount;
+    gchar* balance_credit_debit;
+    gchar balance_currency[4];
+
+    /* fields of the open entry */
+    gchar* fields[N_ENTRY_FIELDS];
+    GString* usage;
+    glong usage_line_length;
+    guint transactions;
+    gchar currency[4];
+};
+
+/*
+ * Element name without namespace prefix
+ */
+static const gchar*
+local_name (const gchar* element_name)
+{
+    const gchar* colon = strchr(element_name, ':');
+
+    return colon != NULL ? colon + 1 : element_name;
+}
+
+static void
+copy_currency (gchar* currency, const gchar** attribute_names, const gchar** attribute_values)
+{
+    for (; *attribute_names != NULL; attribute_names++, attribute_values++) {
+        if (strcmp(local_name(*attribute_names), "Ccy") == 0) {
+            g_strlcpy(currency, *attribute_values, 4);
+            return;
+        }
+    }
+}
+
+/*
+ * Amounts have a decimal point and at most two fraction digits
+ */
+static gboolean
+parse_amount (const gchar* text, gint64* cents)
+{
+    const gchar* p = text;
+    gint64 units = 0;
+    guint fraction = 0;
+    guint digits = 0;
+
+    if (text == NULL || !g_ascii_isdigit(*p))
+        return FALSE;
+    for (; g_ascii_isdigit(*p); p++) {
+        if (units > (G_MAXINT64 / 100 - 9) / 10)
+            return FALSE;
+        units = units * 10 + (*p - '0');
+    }
+    if (*p == '.') {
+        for (p++; g_ascii_isdigit(*p) && digits < 2; p++, digits++)
+            fraction = fraction * 10 + (*p - '0');
+    }
+    if (*p != '\0')
+        return FALSE;
+    if (digits == 1)
+        fraction *= 10;
+    *cents = units * 100 + fraction;
+    return TRUE;
+}
+
+/*
+ * Signed amount, DBIT is negative
+ */
+static gboolean
+parse_signed_amount (const gchar* amount, const gchar* credit_debit, gint64* cents)
+{
+    if (!parse_amount(amount, cents) || credit_debit == NULL)
+        return FALSE;
+    if (strcmp(credit_debit, "DBIT") == 0)
+        *cents = -*cents;
+    else if (strcmp(credit_debit, "CRDT") != 0)
+        return FALSE;
+    return TRUE;
+}
+
+/*
+ * ISODate or the date part of an ISODateTime
+ */
+static guint32
+parse_date (const gchar* text)
+{
+    guint year, month, day;
+
+    if (text == NULL || sscanf(text, "%4u-%2u-%2u", &year, &month, &day) != 3)
+        return 0;
+    return ghbci_statement_pack_date(day, month, year);
+}
+
+/*
+ * The proprietary transaction code of German banks is
+ * <SWIFT code>+<GVC>+<text key>+<primanota>
+ */
+static gchar*
+take_gv_code (gchar* code)
+{
+    gchar* start;
+    gchar* end;
+    gchar* gv_code = NULL;
+
+    if (code == NULL)
+        return NULL;
+    start = strchr(code, '+');
+    if (start != NULL) {
+        start++;
+        end = strchr(start, '+');
+        gv_code = end != NULL ? g_strndup(start, end - start) : g_strdup(start);
+    }
+    g_free(code);
+    return gv_code;
+}
+
+static gchar*
+take_field (GHbciCamtDecoder* self, EntryField field)
+{
+    gchar* value = self->fields[field];
+
+    self->fields[field] = NULL;
+    return value;
+}
+
+static void
+clear_entry (GHbciCamtDecoder* self)
+{
+    guint i;
+
+    for (i = 0; i < N_ENTRY_FIELDS; i++)
+        g_clear_pointer(&self->fields[i], g_free);
+    g_string_truncate(self->usage, 0);
+    self->transactions = 0;
+    g_strlcpy(self->currency, self->balance_currency, sizeof(self->currency));
+}
+
+static void
+clear_balance (GHbciCamtDecoder* self)
+{
+    g_clear_pointer(&self->balance_code, g_free);
+    g_clear_pointer(&self->balance_amount, g_free);
+    g_clear_pointer(&self->balance_credit_debit, g_free);
+}
+
+/*
+ * The opening balance is the base of the saldo after each entry
+ */
+static void
+end_balance (GHbciCamtDecoder* self)
+{
+    gint64 cents;
+
+    if (!self->has_balance && self->balance_code != NULL
+            && (strcmp(self->balance_code, "OPBD") == 0 || strcmp(self->balance_code, "PRCD") == 0)
+            && parse_signed_amount(self->balance_amount, self->balance_credit_debit, &cents)) {
+        self->balance = cents;
+        self->has_balance = TRUE;
+    }
+    clear_balance(self);
+}
+
+static void
+end_entry (GHbciCamtDecoder* self, GError** error)
+{
+    gint64 cents;
+    gchar* saldo = NULL;
+    gchar* gv_code;
+    gchar* transaction_type;
+    gchar* eref;
+    gboolean credit;
+
+    // pending and informational entries are not booked yet
+    if (self->fields[ENTRY_STATUS] != NULL && strcmp(self->fields[ENTRY_STATUS], "BOOK") != 0) {
+        clear_entry(self);
+        return;
+    }
+    if (!parse_signed_amount(self->fields[ENTRY_AMOUNT], self->fields[ENTRY_CREDIT_DEBIT], &cents)) {
+        g_set_error(error, G_MARKUP_ERROR, G_MARKUP_ERROR_INVALID_CONTENT, "invalid amount of entry: %s %s",
+                self->fields[ENTRY_AMOUNT] ? self->fields[ENTRY_AMOUNT] : "(none)",
+                self->fields[ENTRY_CREDIT_DEBIT] ? self->fields[ENTRY_CREDIT_DEBIT] : "(none)");
+        clear_entry(self);
+        return;
+    }
+    credit = cents >= 0;
+
+    if (self->has_balance) {
+        self->balance += cents;
+        saldo = ghbci_statement_format_amount(self->balance, self->currency);
+    }
+    gv_code = take_gv_code(take_field(self, ENTRY_BANK_CODE));
+    if (gv_code == NULL)
+        gv_code = take_gv_code(take_field(self, ENTRY_TX_BANK_CODE));
+    transaction_type = take_field(self, ENTRY_INFO);
+    if (transaction_type == NULL)
+        transaction_type = take_field(self, ENTRY_TX_INFO);
+    eref = take_field(self, ENTRY_EREF);
+    if (eref != NULL && strcmp(eref, NOT_PROVIDED) == 0)
+        g_clear_pointer(&eref, g_free);
+
+    self->func(ghbci_statement_new_structured(
+                self->pool,
+                parse_date(self->fields[ENTRY_VALUTA]),
+                parse_date(self->fields[ENTRY_BOOKING_DATE]),
+                ghbci_statement_format_amount(cents, self->currency),
+                saldo,
+                gv_code,
+                transaction_type,
+                take_field(self, credit ? ENTRY_DEBTOR_NAME : ENTRY_CREDITOR_NAME),
+                take_field(self, credit ? ENTRY_DEBTOR_IBAN : ENTRY_CREDITOR_IBAN),
+                take_field(self, credit ? ENTRY_DEBTOR_BIC : ENTRY_CREDITOR_BIC),
+                g_strndup(self->usage->str, self->usage->len),
+                eref,
+                take_field(self, ENTRY_MREF),
+                take_field(self, ENTRY_CRED)),
+            self->user_data);
+    clear_entry(self);
+}
+
+static void
+set_entry_field (GHbciCamtDecoder* self, const gchar* path, const gchar* text)
+{
+    guint i;
+
+    // the fields of batch entries are taken from the first transaction
+    if (self->transactions > 1 && g_str_has_prefix(path, "NtryDtls/"))
+        return;
+
+    for (i = 0; i < G_N_ELEMENTS(entry_paths); i++) {
+        if (strcmp(path, entry_paths[i].path) != 0)
+            continue;
+
+        EntryField field = entry_paths[i].field;
+        if (field == ENTRY_USAGE) {
+            if (self->usage->len > 0 && self->usage_line_length < USAGE_LINE_LENGTH)
+                g_string_append_c(self->usage, ' ');
+            g_string_append(self->usage, text);
+            self->usage_line_length = g_utf8_strlen(text, -1);
+        } else if (self->fields[field] == NULL) {
+            self->fields[field] = g_strdup(text);
+        }
+        return;
+    }
+}
+
+static void
+set_report_field (GHbciCamtDecoder* self, const gchar* path, const gchar* text)
+{
+    if (strcmp(path, "Bal/Tp/CdOrPrtry/Cd") == 0) {
+        g_free(self->balance_code);
+        self->balance_code = g_strdup(text);
+    } else if (strcmp(path, "Bal/Amt") == 0) {
+        g_free(self->balance_amount);
+        self->balance_amount = g_strdup(text);
+    } else if (strcmp(path, "Bal/CdtDbtInd") == 0) {
+        g_free(self->balance_credit_debit);
+        self->balance_credit_debit = g_strdup(text);
+    }
+}
+
+static void
+start_element (GMarkupParseContext* context, const gchar* element_name, const gchar** attribute_names,
+        const gchar** attribute_values, gpointer user_data, GError** error)
+{
+    GHbciCamtDecoder* self = user_data;
+    const gchar* name = local_name(element_name);
+    guint depth = self->path_lengths->len;
+
+    g_array_append_val(self->path_lengths, self->path->len);
+    if (depth > 0)
+        g_string_append_c(self->path, '/');
+    g_string_append(self->path, name);
+    g_string_truncate(self->text, 0);
+
+    if (self->report_depth == 0) {
+        // Document/BkToCstmrAcctRpt/Rpt or Document/BkToCstmrStmt/Stmt
+        if (depth == 2 && (strcmp(name, "Rpt") == 0 || strcmp(name, "Stmt") == 0)) {
+            self->report_depth = depth;
+            self->report_offset = self->path->len + 1;
+            self->has_balance = FALSE;
+            g_strlcpy(self->balance_currency, "EUR", sizeof(self->balance_currency));
+        }
+    } else if (self->entry_depth == 0) {
+        if (depth == self->report_depth + 1 && strcmp(name, "Ntry") == 0) {
+            self->entry_depth = depth;
+            self->entry_offset = self->path->len + 1;
+            clear_entry(self);
+        } else if (strcmp(self->path->str + self->report_offset, "Bal/Amt") == 0) {
+            copy_currency(self->balance_currency, attribute_names, attribute_values);
+        }
+    } else if (depth == self->entry_depth + 2 && strcmp(name, "TxDtls") == 0) {
+        self->transactions++;
+    } else if (depth == self->entry_depth + 1 && strcmp(name, "Amt") == 0) {
+        copy_currency(self->currency, attribute_names, attribute_values);
+    }
+}
+
+static void
+end_element (GMarkupParseContext* context, const gchar* element_name, gpointer user_data, GError** error)
+{
+    GHbciCamtDecoder* self = user_data;
+    guint depth = self->path_lengths->len - 1;
+
+    if (self->entry_depth != 0 && depth > self->entry_depth) {
+        set_entry_field(self, self->path->str + self->entry_offset, g_strstrip(self->text->str));
+    } else if (self->entry_depth != 0) {
+        self->entry_depth = 0;
+        end_entry(self, error);
+    } else if (self->report_depth != 0 && depth > self->report_depth) {
+        set_report_field(self, self->path->str + self->report_offset, g_strstrip(self->text->str));
+        if (depth == self->report_depth + 1 && strcmp(local_name(element_name), "Bal") == 0)
+            end_balance(self);
+    } else if (self->report_depth != 0) {
+        self->report_depth = 0;
+    }
+
+    g_string_truncate(self->path, g_array_index(self->path_lengths, gsize, depth));
+    g_array_set_size(self->path_lengths, depth);
+    g_string_truncate(self->text, 0);
+}
+
+static void
+text (GMarkupParseContext* context, const gchar* text, gsize text_len, gpointer user_data, GError** error)
+{
+    GHbciCamtDecoder* self = user_data;
+
+    if (self->report_depth != 0)
+        g_string_append_len(self->text, text, text_len);
+}
+
+static const GMarkupParser parser = {
+    start_element,
+    end_element,
+    text,
+    NULL,
+    NULL
+};
+
+/*
+ * Create a decoder, func receives each booked entry as a statement. The
+ * repeating fields of the statements go to pool, or to one of the decoder
+ * if it is NULL.
+ */
+GHbciCamtDecoder*
+ghbci_camt_decoder_new (GHbciStringPool* pool, GHbciStatementFunc func, gpointer user_data)
+{
+    GHbciCamtDecoder* self;
+
+    g_return_val_if_fail (func != NULL, NULL);
+
+    self = g_new0(GHbciCamtDecoder, 1);
+    self->context = g_markup_parse_context_new(&parser, G_MARKUP_TREAT_CDATA_AS_TEXT, self, NULL);
+    self->pool = pool != NULL ? ghbci_string_pool_ref(pool) : ghbci_string_pool_new();
+    self->func = func;
+    self->user_data = user_data;
+    self->path = g_string_sized_new(128);
+    self->path_lengths = g_array_sized_new(FALSE, FALSE, sizeof(gsize), 16);
+    self->text = g_string_sized_new(256);
+    self->usage = g_string_sized_new(256);
+    g_strlcpy(self->balance_currency, "EUR", sizeof(self->balance_currency));
+    return self;
+}
+
+/*
+ * Decode the next chunk of the document, chunks may end anywhere
+ */
+gboolean
+ghbci_camt_decoder_feed (GHbciCamtDecoder* self, const gchar* data, gsize length, GError** error)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    return g_markup_parse_context_parse(self->context, data, length, error);
+}
+
+/*
+ * Fails if the document is incomplete
+ */
+gboolean
+ghbci_camt_decoder_finish (GHbciCamtDecoder* self, GError** error)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    return g_markup_parse_context_end_parse(self->context, error);
+}
+
+void
+ghbci_camt_decoder_free (GHbciCamtDecoder* self)
+{
+    if (self == NULL)
+        return;
+
+    clear_entry(self);
+    clear_balance(self);
+    g_markup_parse_context_free(self->context);
+    g_string_free(self->path, TRUE);
+    g_array_unref(self->path_lengths);
+    g_string_free(self->text, TRUE);
+    g_string_free(self->usage, TRUE);
+    ghbci_string_pool_unref(self->pool);
+    g_free(self);
+}
+
+
+// vim: sw=4 expandtab
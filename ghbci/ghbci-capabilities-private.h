@@ -0,0 +1,45 @@
+/*
+ * ghbci-capabilities-private.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_CAPABILITIES_PRIVATE_H__
+#define __GHBCI_CAPABILITIES_PRIVATE_H__
+
+#include <glib.h>
+
+#include "ghbci-capabilities.h"
+
+GHbciCapabilities*  ghbci_capabilities_new                    (const gchar* blz);
+
+void                ghbci_capabilities_set_bank               (GHbciCapabilities* self, const gchar* bank_name,
+                                                               const gchar* pin_tan_url, const gchar* hbci_version,
+                                                               const gchar* bpd_version);
+
+void                ghbci_capabilities_add_job                (GHbciCapabilities* self, const gchar* job, gint version);
+
+void                ghbci_capabilities_set_job_parameter      (GHbciCapabilities* self, const gchar* job,
+                                                               const gchar* name, const gchar* value);
+
+void                ghbci_capabilities_add_tan_method         (GHbciCapabilities* self, const gchar* id,
+                                                               const gchar* name);
+
+GHbciCapabilities*  ghbci_capabilities_load                   (const gchar* filename, GError** error);
+
+gboolean            ghbci_capabilities_save                   (GHbciCapabilities* self, const gchar* filename,
+                                                               GError** error);
+
+#endif /* __GHBCI_CAPABILITIES_PRIVATE_H__ */
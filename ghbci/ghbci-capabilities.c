@@ -0,0 +1,478 @@
+/*
+ * ghbci-capabilities.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/**
+ * SECTION:ghbci-capabilities
+ * @short_description: What a bank supports, taken from its BPD
+ *
+ * When a passport is added, #GHbciContext reads the bank parameter data
+ * (BPD) once and keeps the supported job types with their versions and
+ * restrictions, the TAN methods of the user, the HBCI version and the
+ * PIN/TAN URL of the bank. The table is saved as bank-BLZ-USERID.caps next
+ * to the passports and reloaded from there, so later runs know the bank
+ * without contacting it.
+ * Get it with ghbci_context_get_capabilities(), all lookups are hash table
+ * lookups without JNI calls.
+ *
+ * Job types use the lowlevel names of hbci4java, e.g. "KUmsAll" or
+ * "UebSEPA". Job parameters are the restrictions the bank sent for the
+ * job, e.g. "timerange" or "maxusage". A #GHbciCapabilities is never
+ * changed, updated data replaces it in the context.
+ **/
+
+#include <stdlib.h>
+
+#include "ghbci-capabilities.h"
+#include "ghbci-capabilities-private.h"
+
+#define GROUP_BANK          "bank"
+#define GROUP_JOBS          "jobs"
+#define GROUP_TAN_METHODS   "tan-methods"
+#define GROUP_JOB_PREFIX    "job "
+
+typedef struct
+{
+    gint version;
+    GHashTable* parameters;
+} CapabilitiesJob;
+
+struct _GHbciCapabilities
+{
+    gint ref_count;
+
+    gchar* blz;
+    gchar* bank_name;
+    gchar* pin_tan_url;
+    gchar* hbci_version;
+    gchar* bpd_version;
+    GHashTable* jobs;
+    GHashTable* tan_methods;
+};
+
+
+G_DEFINE_BOXED_TYPE (GHbciCapabilities, ghbci_capabilities, ghbci_capabilities_ref, ghbci_capabilities_unref)
+
+
+static void
+capabilities_job_free (CapabilitiesJob* job)
+{
+    g_hash_table_unref(job->parameters);
+    g_free(job);
+}
+
+static gint
+compare_strings (gconstpointer a, gconstpointer b)
+{
+    return g_strcmp0(*(const gchar**)a, *(const gchar**)b);
+}
+
+
+/* private methods */
+
+GHbciCapabilities*
+ghbci_capabilities_new (const gchar* blz)
+{
+    GHbciCapabilities* self = g_new0(GHbciCapabilities, 1);
+
+    self->ref_count = 1;
+    self->blz = g_strdup(blz);
+    self->jobs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)capabilities_job_free);
+    self->tan_methods = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+    return self;
+}
+
+void
+ghbci_capabilities_set_bank (GHbciCapabilities* self, const gchar* bank_name, const gchar* pin_tan_url,
+        const gchar* hbci_version, const gchar* bpd_version)
+{
+    g_free(self->bank_name);
+    self->bank_name = g_strdup(bank_name);
+    g_free(self->pin_tan_url);
+    self->pin_tan_url = g_strdup(pin_tan_url);
+    g_free(self->hbci_version);
+    self->hbci_version = g_strdup(hbci_version);
+    g_free(self->bpd_version);
+    self->bpd_version = g_strdup(bpd_version);
+}
+
+void
+ghbci_capabilities_add_job (GHbciCapabilities* self, const gchar* job, gint version)
+{
+    CapabilitiesJob* entry = g_hash_table_lookup(self->jobs, job);
+
+    if (entry == NULL) {
+        entry = g_new0(CapabilitiesJob, 1);
+        entry->parameters = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+        g_hash_table_insert(self->jobs, g_strdup(job), entry);
+    }
+    entry->version = version;
+}
+
+/*
+ * Add a restriction of a job added with ghbci_capabilities_add_job()
+ */
+void
+ghbci_capabilities_set_job_parameter (GHbciCapabilities* self, const gchar* job, const gchar* name, const gchar* value)
+{
+    CapabilitiesJob* entry = g_hash_table_lookup(self->jobs, job);
+
+    g_return_if_fail (entry != NULL);
+
+    g_hash_table_insert(entry->parameters, g_strdup(name), g_strdup(value));
+}
+
+void
+ghbci_capabilities_add_tan_method (GHbciCapabilities* self, const gchar* id, const gchar* name)
+{
+    g_hash_table_insert(self->tan_methods, g_strdup(id), g_strdup(name));
+}
+
+/*
+ * Read capabilities saved with ghbci_capabilities_save()
+ */
+GHbciCapabilities*
+ghbci_capabilities_load (const gchar* filename, GError** error)
+{
+    GKeyFile* key_file = g_key_file_new();
+    GHbciCapabilities* self = NULL;
+    gchar** keys;
+    gchar* blz;
+    gsize i;
+
+    if (!g_key_file_load_from_file(key_file, filename, G_KEY_FILE_NONE, error))
+        goto cleanup;
+
+    blz = g_key_file_get_string(key_file, GROUP_BANK, "blz", error);
+    if (blz == NULL)
+        goto cleanup;
+
+    self = ghbci_capabilities_new(blz);
+    g_free(blz);
+    self->bank_name = g_key_file_get_string(key_file, GROUP_BANK, "name", NULL);
+    self->pin_tan_url = g_key_file_get_string(key_file, GROUP_BANK, "url", NULL);
+    self->hbci_version = g_key_file_get_string(key_file, GROUP_BANK, "hbci-version", NULL);
+    self->bpd_version = g_key_file_get_string(key_file, GROUP_BANK, "bpd-version", NULL);
+
+    keys = g_key_file_get_keys(key_file, GROUP_TAN_METHODS, NULL, NULL);
+    for (i = 0; keys != NULL && keys[i] != NULL; i++) {
+        gchar* name = g_key_file_get_string(key_file, GROUP_TAN_METHODS, keys[i], NULL);
+        ghbci_capabilities_add_tan_method(self, keys[i], name);
+        g_free(name);
+    }
+    g_strfreev(keys);
+
+    keys = g_key_file_get_keys(key_file, GROUP_JOBS, NULL, NULL);
+    for (i = 0; keys != NULL && keys[i] != NULL; i++) {
+        gchar* group = g_strconcat(GROUP_JOB_PREFIX, keys[i], NULL);
+        gchar** parameters = g_key_file_get_keys(key_file, group, NULL, NULL);
+        gsize j;
+
+        ghbci_capabilities_add_job(self, keys[i], g_key_file_get_integer(key_file, GROUP_JOBS, keys[i], NULL));
+        for (j = 0; parameters != NULL && parameters[j] != NULL; j++) {
+            gchar* value = g_key_file_get_string(key_file, group, parameters[j], NULL);
+            ghbci_capabilities_set_job_parameter(self, keys[i], parameters[j], value);
+            g_free(value);
+        }
+        g_strfreev(parameters);
+        g_free(group);
+    }
+    g_strfreev(keys);
+
+cleanup:
+    g_key_file_unref(key_file);
+    return self;
+}
+
+/*
+ * Write capabilities as key file
+ */
+gboolean
+ghbci_capabilities_save (GHbciCapabilities* self, const gchar* filename, GError** error)
+{
+    GKeyFile* key_file = g_key_file_new();
+    GHashTableIter iter, parameter_iter;
+    gpointer key, value;
+    gboolean result;
+
+    g_key_file_set_string(key_file, GROUP_BANK, "blz", self->blz);
+    if (self->bank_name != NULL)
+        g_key_file_set_string(key_file, GROUP_BANK, "name", self->bank_name);
+    if (self->pin_tan_url != NULL)
+        g_key_file_set_string(key_file, GROUP_BANK, "url", self->pin_tan_url);
+    if (self->hbci_version != NULL)
+        g_key_file_set_string(key_file, GROUP_BANK, "hbci-version", self->hbci_version);
+    if (self->bpd_version != NULL)
+        g_key_file_set_string(key_file, GROUP_BANK, "bpd-version", self->bpd_version);
+
+    g_hash_table_iter_init(&iter, self->tan_methods);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+        g_key_file_set_string(key_file, GROUP_TAN_METHODS, key, value);
+
+    g_hash_table_iter_init(&iter, self->jobs);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        CapabilitiesJob* job = value;
+        gchar* group = g_strconcat(GROUP_JOB_PREFIX, key, NULL);
+        gpointer name, parameter;
+
+        g_key_file_set_integer(key_file, GROUP_JOBS, key, job->version);
+        g_hash_table_iter_init(&parameter_iter, job->parameters);
+        while (g_hash_table_iter_next(&parameter_iter, &name, &parameter))
+            g_key_file_set_string(key_file, group, name, parameter);
+        g_free(group);
+    }
+
+    result = g_key_file_save_to_file(key_file, filename, error);
+    g_key_file_unref(key_file);
+    return result;
+}
+
+
+/* public methods */
+
+/**
+ * ghbci_capabilities_ref:
+ * @self: The #GHbciCapabilities
+ *
+ * Increase reference count
+ *
+ * Returns: (transfer full): @self
+ **/
+GHbciCapabilities*
+ghbci_capabilities_ref (GHbciCapabilities* self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    g_atomic_int_inc(&self->ref_count);
+    return self;
+}
+
+/**
+ * ghbci_capabilities_unref:
+ * @self: The #GHbciCapabilities
+ *
+ * Decrease reference count, frees @self when it drops to zero
+ **/
+void
+ghbci_capabilities_unref (GHbciCapabilities* self)
+{
+    g_return_if_fail (self != NULL);
+
+    if (g_atomic_int_dec_and_test(&self->ref_count)) {
+        g_free(self->blz);
+        g_free(self->bank_name);
+        g_free(self->pin_tan_url);
+        g_free(self->hbci_version);
+        g_free(self->bpd_version);
+        g_hash_table_unref(self->jobs);
+        g_hash_table_unref(self->tan_methods);
+        g_free(self);
+    }
+}
+
+/**
+ * ghbci_capabilities_get_blz:
+ * @self: The #GHbciCapabilities
+ *
+ * Returns: blz of the bank
+ **/
+const gchar*
+ghbci_capabilities_get_blz (GHbciCapabilities* self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    return self->blz;
+}
+
+/**
+ * ghbci_capabilities_get_bank_name:
+ * @self: The #GHbciCapabilities
+ *
+ * Returns: (nullable): name of the bank as sent in the BPD
+ **/
+const gchar*
+ghbci_capabilities_get_bank_name (GHbciCapabilities* self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    return self->bank_name;
+}
+
+/**
+ * ghbci_capabilities_get_pin_tan_url:
+ * @self: The #GHbciCapabilities
+ *
+ * Returns: (nullable): PIN/TAN server of the bank
+ **/
+const gchar*
+ghbci_capabilities_get_pin_tan_url (GHbciCapabilities* self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    return self->pin_tan_url;
+}
+
+/**
+ * ghbci_capabilities_get_hbci_version:
+ * @self: The #GHbciCapabilities
+ *
+ * Returns: (nullable): HBCI version used with the bank, like "300"
+ **/
+const gchar*
+ghbci_capabilities_get_hbci_version (GHbciCapabilities* self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    return self->hbci_version;
+}
+
+/**
+ * ghbci_capabilities_get_bpd_version:
+ * @self: The #GHbciCapabilities
+ *
+ * Returns: (nullable): version of the BPD the table was taken from
+ **/
+const gchar*
+ghbci_capabilities_get_bpd_version (GHbciCapabilities* self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    return self->bpd_version;
+}
+
+/**
+ * ghbci_capabilities_supports_job:
+ * @self: The #GHbciCapabilities
+ * @job: lowlevel job name, like "KUmsAll"
+ *
+ * Returns: %TRUE if the bank offers @job
+ **/
+gboolean
+ghbci_capabilities_supports_job (GHbciCapabilities* self, const gchar* job)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (job != NULL, FALSE);
+
+    return g_hash_table_contains(self->jobs, job);
+}
+
+/**
+ * ghbci_capabilities_get_job_version:
+ * @self: The #GHbciCapabilities
+ * @job: lowlevel job name, like "KUmsAll"
+ *
+ * Returns: highest segment version of @job the bank supports, 0 if the
+ *   job is not supported
+ **/
+gint
+ghbci_capabilities_get_job_version (GHbciCapabilities* self, const gchar* job)
+{
+    CapabilitiesJob* entry;
+
+    g_return_val_if_fail (self != NULL, 0);
+    g_return_val_if_fail (job != NULL, 0);
+
+    entry = g_hash_table_lookup(self->jobs, job);
+    return entry != NULL ? entry->version : 0;
+}
+
+/**
+ * ghbci_capabilities_get_job_parameter:
+ * @self: The #GHbciCapabilities
+ * @job: lowlevel job name, like "KUmsAll"
+ * @name: name of the restriction, like "timerange"
+ *
+ * Returns: (nullable): value the bank sent, %NULL if the job is not
+ *   supported or has no such restriction
+ **/
+const gchar*
+ghbci_capabilities_get_job_parameter (GHbciCapabilities* self, const gchar* job, const gchar* name)
+{
+    CapabilitiesJob* entry;
+
+    g_return_val_if_fail (self != NULL, NULL);
+    g_return_val_if_fail (job != NULL, NULL);
+    g_return_val_if_fail (name != NULL, NULL);
+
+    entry = g_hash_table_lookup(self->jobs, job);
+    return entry != NULL ? g_hash_table_lookup(entry->parameters, name) : NULL;
+}
+
+/**
+ * ghbci_capabilities_get_job_parameter_int:
+ * @self: The #GHbciCapabilities
+ * @job: lowlevel job name, like "KUmsAll"
+ * @name: name of the restriction, like "maxusage"
+ * @default_value: returned if the restriction is missing or not a number
+ *
+ * Returns: numeric value of a restriction
+ **/
+gint64
+ghbci_capabilities_get_job_parameter_int (GHbciCapabilities* self, const gchar* job, const gchar* name,
+        gint64 default_value)
+{
+    const gchar* value = ghbci_capabilities_get_job_parameter(self, job, name);
+    gint64 result;
+
+    if (value == NULL || !g_ascii_string_to_signed(value, 10, G_MININT64, G_MAXINT64, &result, NULL))
+        return default_value;
+    return result;
+}
+
+/**
+ * ghbci_capabilities_get_jobs:
+ * @self: The #GHbciCapabilities
+ *
+ * Returns: (transfer full): sorted %NULL terminated list of supported jobs
+ **/
+gchar**
+ghbci_capabilities_get_jobs (GHbciCapabilities* self)
+{
+    GPtrArray* jobs;
+    GHashTableIter iter;
+    gpointer key;
+
+    g_return_val_if_fail (self != NULL, NULL);
+
+    jobs = g_ptr_array_new();
+    g_hash_table_iter_init(&iter, self->jobs);
+    while (g_hash_table_iter_next(&iter, &key, NULL))
+        g_ptr_array_add(jobs, g_strdup(key));
+    g_ptr_array_sort(jobs, compare_strings);
+    g_ptr_array_add(jobs, NULL);
+
+    return (gchar**)g_ptr_array_free(jobs, FALSE);
+}
+
+/**
+ * ghbci_capabilities_get_tan_methods:
+ * @self: The #GHbciCapabilities
+ *
+ * Returns: (element-type utf8 utf8) (transfer none): allowed TAN methods
+ *   of the passport the table was filled by, id to name
+ **/
+GHashTable*
+ghbci_capabilities_get_tan_methods (GHbciCapabilities* self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    return self->tan_methods;
+}
+
+
+// vim: sw=4 expandtab
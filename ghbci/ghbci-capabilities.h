@@ -0,0 +1,63 @@
+/*
+ * ghbci-capabilities.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_CAPABILITIES_H__
+#define __GHBCI_CAPABILITIES_H__
+
+#include <glib.h>
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GHbciCapabilities GHbciCapabilities;
+
+#define GHBCI_TYPE_CAPABILITIES        (ghbci_capabilities_get_type ())
+
+GType               ghbci_capabilities_get_type               (void) G_GNUC_CONST;
+
+GHbciCapabilities*  ghbci_capabilities_ref                    (GHbciCapabilities* self);
+
+void                ghbci_capabilities_unref                  (GHbciCapabilities* self);
+
+const gchar*        ghbci_capabilities_get_blz                (GHbciCapabilities* self);
+
+const gchar*        ghbci_capabilities_get_bank_name          (GHbciCapabilities* self);
+
+const gchar*        ghbci_capabilities_get_pin_tan_url        (GHbciCapabilities* self);
+
+const gchar*        ghbci_capabilities_get_hbci_version       (GHbciCapabilities* self);
+
+const gchar*        ghbci_capabilities_get_bpd_version        (GHbciCapabilities* self);
+
+gboolean            ghbci_capabilities_supports_job           (GHbciCapabilities* self, const gchar* job);
+
+gint                ghbci_capabilities_get_job_version        (GHbciCapabilities* self, const gchar* job);
+
+const gchar*        ghbci_capabilities_get_job_parameter      (GHbciCapabilities* self, const gchar* job,
+                                                               const gchar* name);
+
+gint64              ghbci_capabilities_get_job_parameter_int  (GHbciCapabilities* self, const gchar* job,
+                                                               const gchar* name, gint64 default_value);
+
+gchar**             ghbci_capabilities_get_jobs               (GHbciCapabilities* self);
+
+GHashTable*         ghbci_capabilities_get_tan_methods        (GHbciCapabilities* self);
+
+G_END_DECLS
+
+#endif /* __GHBCI_CAPABILITIES_H__ */
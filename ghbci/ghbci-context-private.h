@@ -22,7 +22,28 @@
 #include <glib.h>
 #include <glib-object.h>
 #include <gio/gio.h>
+#include <jni.h>
 
+#include "ghbci-rate-limiter.h"
+#include "ghbci-metrics.h"
+#include "ghbci-log-ring.h"
+#include "ghbci-java-strings.h"
+#include "ghbci-string-pool-private.h"
+#include "ghbci-worker-pool-private.h"
+#include "ghbci-daemon-private.h"
+
+
+/*
+ * Sink set with ghbci_context_set_log_sink(), the drain thread holds a
+ * reference while calling it outside of log_lock
+ */
+typedef struct
+{
+    gint ref_count;
+    GHbciLogSinkFunc func;
+    gpointer user_data;
+    GDestroyNotify notify;
+} GHbciLogSink;
 
 #define GHBCI_CONTEXT_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), \
                                            GHBCI_TYPE_CONTEXT, \
@@ -37,9 +58,45 @@ struct _GHbciContextPrivate
     GHashTable* accounts;
     gchar* passport_directory;
     GSList* passports;
+    GHashTable* thread_groups;
+    GHashTable* capabilities;
+    GHashTable* pin_tan_urls;
+    GHashTable* answers;
+    GHbciCredentialProvider* credential_provider;
+    GSList* tan_challenges;
+    guint tan_timeout;
+    GMutex lock;
+
+    GHbciRateLimiter* rate_limiter;
+    /* retry policy, guarded by lock */
+    guint retry_max_attempts;
+    guint retry_base_delay;
+    guint retry_max_delay;
+
+    GHbciMetrics* metrics;
+    gboolean capture_raw_messages;
+    gboolean native_mt940;
+    GTimeZone* time_zone;
+    /* worker processes running hbci4java instead of the jvm, or NULL */
+    GHbciWorkerPool* workers;
+    /* connection to ghbci-daemon instead of the jvm, or NULL */
+    GHbciDaemonClient* daemon;
+    gint log_level;
+    GHbciLogRing* log_ring;
+    GMutex log_lock;
+    GHashTable* log_tails;
+    GQueue log_tail_order;
+    GHbciLogSink* log_sink;
+#ifdef GHBCI_ENABLE_INSTRUMENTATION
+    GMutex call_counters_lock;
+    GHashTable* call_counters;
+#endif
 
     JavaVM* jvm;
     JNIEnv* jni_env;
+    jobject callback;
+    jobject pain001_schema;
+    jstring java_strings[GHBCI_JAVA_STRING_LAST];
     jclass class_Konto;
     jclass class_Saldo;
     jclass class_Value;
@@ -52,6 +109,7 @@ struct _GHbciContextPrivate
     jclass class_HBCIJob;
     jclass class_HBCIJobResult;
     jclass class_HBCIStatus;
+    jclass class_HBCIExecStatus;
     jclass class_HBCIPassport;
     jclass class_AbstractHBCIPassport;
     jclass class_AbstractPinTanPassport;
@@ -67,28 +125,72 @@ struct _GHbciContextPrivate
     jclass class_List;
     jclass class_StringBuffer;
     jclass class_Date;
+    jclass class_ThreadGroup;
+    jclass class_Throwable;
+    jclass class_IOException;
+    jclass class_HBCIRetVal;
+    jclass class_String;
+    jclass class_Integer;
+    jclass class_Class;
+    jclass class_SchemaFactory;
+    jclass class_Schema;
+    jclass class_Validator;
+    jclass class_StreamSource;
+    jclass class_ByteArrayInputStream;
+    jclass class_StringWriter;
+    jclass class_JobParams;
     jmethodID method_HBCIUtils_getNameForBLZ;
     jmethodID method_HBCIUtils_getPinTanURLForBLZ;
     jmethodID method_HBCIUtils_init;
+    jmethodID method_HBCIUtils_initThread;
     jmethodID method_HBCIUtils_setParam;
+    jmethodID method_Integer_valueOf;
+    jmethodID method_Class_getResource;
+    jmethodID method_SchemaFactory_newInstance;
+    jmethodID method_JobParams_init;
+    jmethodID method_JobParams_set;
+    jmethodID method_SchemaFactory_newSchema;
+    jmethodID method_Schema_newValidator;
+    jmethodID method_Validator_validate;
+    jmethodID method_StreamSource_constructor;
+    jmethodID method_ByteArrayInputStream_constructor;
+    jmethodID method_StringWriter_constructor;
+    jmethodID method_StringWriter_toString;
     jmethodID method_HBCIHandler_constructor;
     jmethodID method_HBCIHandler_newJob;
     jmethodID method_HBCIHandler_execute;
     jmethodID method_HBCIHandler_getPassport;
     jmethodID method_HBCIHandler_reset;
+    jmethodID method_HBCIHandler_getSupportedLowlevelJobs;
+    jmethodID method_HBCIHandler_getLowlevelJobRestrictions;
+    jmethodID method_HBCIHandler_getHBCIVersion;
     jmethodID method_HBCICallbackConsole_constructor;
     jmethodID method_HBCICallbackNative_constructor;
+    jmethodID method_ThreadGroup_constructor;
     jmethodID method_HBCIJob_setParam;
+    jmethodID method_HBCIJob_setParamIndexed;
     jmethodID method_HBCIJob_addToQueue;
     jmethodID method_HBCIJob_getJobResult;
+    jmethodID method_HBCIJob_getName;
     jmethodID method_HBCIJobResult_getJobStatus;
+    jmethodID method_HBCIJobResult_getGlobStatus;
+    jmethodID method_HBCIStatus_getErrors;
+    jmethodID method_Throwable_getCause;
+    jmethodID method_Throwable_toString;
+    jmethodID method_HBCIExecStatus_getCustomerIds;
+    jmethodID method_HBCIExecStatus_getExceptions;
+    jmethodID method_HBCIExecStatus_getErrorString;
     jmethodID method_HBCIStatus_getErrorString;
     jmethodID method_HBCIPassport_getAccounts;
+    jmethodID method_HBCIPassport_getBPDVersion;
+    jmethodID method_HBCIPassport_getInstName;
+    jmethodID method_HBCIPassport_getHost;
     jmethodID method_AbstractHBCIPassport_getInstance;
     jmethodID method_AbstractPinTanPassport_getTwostepMechanisms;
     jmethodID method_AbstractPinTanPassport_getAllowedTwostepMechanisms;
     jmethodID method_AbstractPinTanPassport_setCurrentTANMethod;
     jmethodID method_HBCIJobResultImpl_isOK;
+    jmethodID method_HBCIJobResultImpl_getResultData;
     jmethodID method_GVRSaldoReq_getEntries;
     jmethodID method_GVRKUms_toString;
     jmethodID method_GVRKUms_getFlatData;
@@ -96,6 +198,7 @@ struct _GHbciContextPrivate
     jmethodID method_Value_toString;
     jmethodID method_Properties_keys;
     jmethodID method_Properties_getProperty;
+    jmethodID method_Properties_store;
     jmethodID method_Enumeration_hasMoreElements;
     jmethodID method_Enumeration_nextElement;
     jmethodID method_Iterator_hasNext;
@@ -105,12 +208,11 @@ struct _GHbciContextPrivate
     jmethodID method_StringBuffer_replace;
     jmethodID method_StringBuffer_setLength;
     jmethodID method_StringBuffer_toString;
+    jmethodID method_StringBuffer_length;
+    jmethodID method_StringBuffer_getChars;
     jmethodID method_Hashtable_toString;
     jmethodID method_Hashtable_get;
     jmethodID method_Date_toString;
-    jmethodID method_Date_getDate;
-    jmethodID method_Date_getMonth;
-    jmethodID method_Date_getYear;
     jmethodID method_Date_getTime;
     jfieldID field_HBCIUtilsInternal_blzs;
     jfieldID field_GVRSaldoReqInfo_ready;
@@ -135,7 +237,21 @@ struct _GHbciContextPrivate
     jfieldID field_GVRKUmsUmsLine_usage;
     jfieldID field_GVRKUmsUmsLine_other;
     jfieldID field_GVRKUmsUmsLine_text;
+    jfieldID field_GVRKUms_bufferMT940;
+    jfieldID field_HBCIRetVal_code;
+    jfieldID field_HBCIRetVal_segref;
+    jfieldID field_HBCIRetVal_text;
 };
 
+JNIEnv* ghbci_context_get_jni_env (GHbciContext* self);
+JNIEnv* ghbci_context_attach_passport_thread (GHbciContext* self, const gchar* blz, const gchar* userid);
+void    ghbci_context_detach_thread (GHbciContext* self);
+GSList* ghbci_context_fetch_statements (GHbciContext* self, const gchar* blz, const gchar* userid,
+                                        const gchar* number, gboolean native_mt940, GError** error);
+void    ghbci_context_flush_log (GHbciContext* self);
+#ifdef GHBCI_ENABLE_INSTRUMENTATION
+void    ghbci_context_record_call_counters (GHbciContext* self, const gchar* function, GHbciCallCounters* counters);
+#endif
+
 #endif /* __GHBCI_CONTEXT_PRIVATE_H__ */
 
@@ -43,6 +43,26 @@
 #include "ghbci-account-private.h"
 #include "ghbci-statement.h"
 #include "ghbci-statement-private.h"
+#include "ghbci-mt940-private.h"
+#include "ghbci-camt-private.h"
+#include "ghbci-metrics.h"
+#include "ghbci-metrics-private.h"
+#include "ghbci-status.h"
+#include "ghbci-log-ring.h"
+#include "ghbci-error.h"
+#include "ghbci-error-private.h"
+#include "ghbci-capabilities.h"
+#include "ghbci-capabilities-private.h"
+#include "ghbci-credential-provider.h"
+#include "ghbci-tan-challenge.h"
+#include "ghbci-tan-challenge-private.h"
+#include "ghbci-transfer.h"
+#include "ghbci-transfer-private.h"
+#include "ghbci-standing-order.h"
+#include "ghbci-standing-order-private.h"
+#include "ghbci-instrumentation.h"
+#include "ghbci-instrumentation-private.h"
+#include "ghbci-jstring-private.h"
 #include "ghbci-marshal.h"
 
 
@@ -52,16 +72,65 @@ enum
     CALLBACK,
     LOG,
     STATUS,
+    TAN_CHALLENGE,
     LAST_SIGNAL
 };
 
 static guint ghbci_context_signals [LAST_SIGNAL] = { 0 };
 
+/* number of log records buffered for the drain thread */
+#define LOG_RING_SIZE       4096
+/* number of dialogs and records per dialog kept for ghbci_context_get_log_tail() */
+#define LOG_TAIL_DIALOGS    32
+#define LOG_TAIL_LENGTH     64
+/* default seconds to wait for the answer of a GHbciTanChallenge */
+#define TAN_TIMEOUT         300
+/* schema of the pain documents ghbci_transfer_write_pain001() writes */
+#define PAIN001_SCHEMA      "/pain.001.003.03.xsd"
+/* recipients per collective transfer, if the BPD has no limit */
+#define MAX_BATCH_TRANSFERS 1000
+/* SEPA transfers are in EUR only */
+#define SEPA_CURRENCY       "EUR"
+/* chars of the MT940 data copied out of hbci4java at once */
+#define MT940_WINDOW_LENGTH 2048
+/* parameters reserved per job, a transfer has up to 16 */
+#define JOB_PARAMS          24
+/* size of the answer tables, indexed by GHbciReason */
+#define CALLBACK_REASONS    (GHBCI_REASON_ENUM_USERID_CHANGED + 1)
+
+/* text of the constant java strings, indexed by GHbciJavaString */
+static const gchar* const java_string_text[] = {
+#define GHBCI_JAVA_STRING(id, text) text,
+    GHBCI_JAVA_STRINGS
+#undef GHBCI_JAVA_STRING
+};
+
+/* properties */
+enum
+{
+    PROP_0,
+    PROP_LOG_LEVEL
+};
+
 
 static void     ghbci_context_class_init         (GHbciContextClass *class);
 static void     ghbci_context_init               (GHbciContext *self);
 static void     ghbci_context_finalize           (GObject *obj);
 static void     ghbci_context_dispose            (GObject *obj);
+static void     deliver_log_record               (const GHbciLogRecord* record, gpointer user_data);
+static void     log_tail_free                    (gpointer data);
+static void     log_sink_unref                   (GHbciLogSink* sink);
+static void     callback_answers_free            (gpointer data);
+static gboolean request_bank                     (GHbciContext* self, const gchar* blz, gchar** name,
+                                                  gchar** pin_tan_url);
+static void     ghbci_context_set_property       (GObject *obj,
+                                                  guint prop_id,
+                                                  const GValue *value,
+                                                  GParamSpec *pspec);
+static void     ghbci_context_get_property       (GObject *obj,
+                                                  guint prop_id,
+                                                  GValue *value,
+                                                  GParamSpec *pspec);
 
 G_DEFINE_TYPE (GHbciContext, ghbci_context, G_TYPE_OBJECT)
 
@@ -75,6 +144,24 @@ ghbci_context_class_init (GHbciContextClass *class)
 
     obj_class->dispose = ghbci_context_dispose;
     obj_class->finalize = ghbci_context_finalize;
+    obj_class->get_property = ghbci_context_get_property;
+    obj_class->set_property = ghbci_context_set_property;
+
+    /**
+     * GHbciContext:log-level
+     *
+     * Most verbose #GHbciLogLevel passed to the #GHbciContext::log signal.
+     * Messages above this level are not even created by hbci4java.
+     **/
+    g_object_class_install_property (obj_class,
+                                     PROP_LOG_LEVEL,
+                                     g_param_spec_int ("log-level",
+                                                       "Log Level",
+                                                       "Most verbose log level of hbci4java messages",
+                                                       GHBCI_LOGLEVEL_ENUM_ERROR,
+                                                       GHBCI_LOGLEVEL_ENUM_DEBUG2,
+                                                       GHBCI_LOGLEVEL_ENUM_INFO /* default value */,
+                                                       G_PARAM_READWRITE));
 
     /* install signals */
 
@@ -86,7 +173,8 @@ ghbci_context_class_init (GHbciContextClass *class)
      * @optional: optional string (depends on reason)
      *
      * Called when hbci4java needs additional input, like account information
-     * or credentials
+     * or credentials, that neither ghbci_context_set_answer() nor the
+     * #GHbciCredentialProvider answered
      *
      * Returns: (transfer full): answer, if required by reason
      **/
@@ -108,7 +196,8 @@ ghbci_context_class_init (GHbciContextClass *class)
      * @msg: log message
      * @level: log level
      *
-     * Called when hbci4java logs something
+     * Called when hbci4java logs something. Emitted from the log
+     * delivery thread, unless a sink is set with ghbci_context_set_log_sink().
      **/
     ghbci_context_signals[LOG] =
         g_signal_new ("log",
@@ -125,10 +214,11 @@ ghbci_context_class_init (GHbciContextClass *class)
     /**
      * GHbciContext::status:
      * @self: The #GHbciContext
-     * @status: type
-     * @obj: list of objects
+     * @status: type, see #GHbciStatusTag
+     * @text: short description, like job name or dialog id
+     * @payload: decoded objects attached to the event
      *
-     * Called when hbci4java logs something
+     * Called when hbci4java reaches a new step of a dialog
      **/
     ghbci_context_signals[STATUS] =
         g_signal_new ("status",
@@ -137,16 +227,50 @@ ghbci_context_class_init (GHbciContextClass *class)
               0,
               NULL /* accumulator */,
               NULL /* accumulator data */,
-              ghbci_marshal_VOID__INT64_STRING,
+              ghbci_marshal_VOID__INT64_STRING_BOXED,
               G_TYPE_NONE /* return_type */,
-              2 /* n_params */,
-              G_TYPE_INT64, G_TYPE_STRING, NULL/* param_types */);
+              3 /* n_params */,
+              G_TYPE_INT64, G_TYPE_STRING, GHBCI_TYPE_STATUS_PAYLOAD, NULL/* param_types */);
+
+    /**
+     * GHbciContext::tan-challenge:
+     * @self: The #GHbciContext
+     * @challenge: the #GHbciTanChallenge
+     *
+     * Called when the bank needs a TAN. Handlers must not block, they keep
+     * a reference to @challenge and answer it later from any thread. While
+     * handlers are connected, TANs are not asked for with
+     * #GHbciContext::callback.
+     **/
+    ghbci_context_signals[TAN_CHALLENGE] =
+        g_signal_new ("tan-challenge",
+              G_TYPE_FROM_CLASS (obj_class),
+              G_SIGNAL_RUN_LAST,
+              0,
+              NULL /* accumulator */,
+              NULL /* accumulator data */,
+              ghbci_marshal_VOID__BOXED,
+              G_TYPE_NONE /* return_type */,
+              1 /* n_params */,
+              GHBCI_TYPE_TAN_CHALLENGE, NULL/* param_types */);
 
 
     /* add private structure */
     g_type_class_add_private (obj_class, sizeof (GHbciContextPrivate));
 }
 
+/*
+ * The zone hbci4java's dates are in, the JVM runs with it. Without tzdata
+ * the summer offset still maps every midnight there to its day.
+ */
+static GTimeZone*
+new_time_zone (void)
+{
+    GTimeZone* zone = g_time_zone_new_identifier ("Europe/Berlin");
+
+    return zone != NULL ? zone : g_time_zone_new_offset (2 * 3600);
+}
+
 static void
 ghbci_context_init (GHbciContext *self)
 {
@@ -159,9 +283,43 @@ ghbci_context_init (GHbciContext *self)
     priv->accounts = NULL;
     priv->passport_directory = NULL;
     priv->passports = NULL;
+    priv->thread_groups = NULL;
+    priv->capabilities = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)ghbci_capabilities_unref);
+    priv->pin_tan_urls = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    priv->answers = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)callback_answers_free);
+    priv->credential_provider = NULL;
+    priv->tan_challenges = NULL;
+    priv->tan_timeout = TAN_TIMEOUT;
+    g_mutex_init (&priv->lock);
+
+    priv->rate_limiter = ghbci_rate_limiter_new ();
+    priv->retry_max_attempts = 3;
+    priv->retry_base_delay = 500;
+    priv->retry_max_delay = 30000;
+
+    priv->metrics = ghbci_metrics_new ();
+    priv->capture_raw_messages = FALSE;
+    priv->native_mt940 = FALSE;
+    priv->time_zone = new_time_zone ();
+    priv->workers = NULL;
+    priv->daemon = NULL;
+    priv->log_level = GHBCI_LOGLEVEL_ENUM_INFO;
+    g_mutex_init (&priv->log_lock);
+    priv->log_tails = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, log_tail_free);
+    g_queue_init (&priv->log_tail_order);
+    priv->log_sink = NULL;
+#ifdef GHBCI_ENABLE_INSTRUMENTATION
+    g_mutex_init (&priv->call_counters_lock);
+    priv->call_counters = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+#endif
+    priv->log_ring = ghbci_log_ring_new (LOG_RING_SIZE);
+    ghbci_log_ring_start (priv->log_ring, deliver_log_record, self);
 
     priv->jvm = NULL;
     priv->jni_env = NULL;
+    priv->callback = NULL;
+    priv->pain001_schema = NULL;
+    memset(priv->java_strings, 0, sizeof(priv->java_strings));
     priv->class_Konto = NULL;
     priv->class_Saldo = NULL;
     priv->class_Value = NULL;
@@ -174,6 +332,7 @@ ghbci_context_init (GHbciContext *self)
     priv->class_HBCIJob = NULL;
     priv->class_HBCIJobResult = NULL;
     priv->class_HBCIStatus = NULL;
+    priv->class_HBCIExecStatus = NULL;
     priv->class_HBCIPassport = NULL;
     priv->class_AbstractHBCIPassport = NULL;
     priv->class_AbstractPinTanPassport = NULL;
@@ -189,32 +348,77 @@ ghbci_context_init (GHbciContext *self)
     priv->class_List = NULL;
     priv->class_StringBuffer = NULL;
     priv->class_Date = NULL;
+    priv->class_ThreadGroup = NULL;
+    priv->class_Throwable = NULL;
+    priv->class_IOException = NULL;
+    priv->class_HBCIRetVal = NULL;
+    priv->class_String = NULL;
+    priv->class_Integer = NULL;
+    priv->class_Class = NULL;
+    priv->class_SchemaFactory = NULL;
+    priv->class_Schema = NULL;
+    priv->class_Validator = NULL;
+    priv->class_StreamSource = NULL;
+    priv->class_ByteArrayInputStream = NULL;
+    priv->class_StringWriter = NULL;
+    priv->class_JobParams = NULL;
     priv->method_HBCIUtils_getNameForBLZ = NULL;
     priv->method_HBCIUtils_getPinTanURLForBLZ = NULL;
     priv->method_HBCIUtils_init = NULL;
+    priv->method_HBCIUtils_initThread = NULL;
     priv->method_HBCIUtils_setParam = NULL;
+    priv->method_Integer_valueOf = NULL;
+    priv->method_Class_getResource = NULL;
+    priv->method_SchemaFactory_newInstance = NULL;
+    priv->method_JobParams_init = NULL;
+    priv->method_JobParams_set = NULL;
+    priv->method_SchemaFactory_newSchema = NULL;
+    priv->method_Schema_newValidator = NULL;
+    priv->method_Validator_validate = NULL;
+    priv->method_StreamSource_constructor = NULL;
+    priv->method_ByteArrayInputStream_constructor = NULL;
+    priv->method_StringWriter_constructor = NULL;
+    priv->method_StringWriter_toString = NULL;
     priv->method_HBCIHandler_constructor = NULL;
     priv->method_HBCIHandler_newJob = NULL;
     priv->method_HBCIHandler_execute = NULL;
     priv->method_HBCIHandler_getPassport = NULL;
     priv->method_HBCIHandler_reset = NULL;
+    priv->method_HBCIHandler_getSupportedLowlevelJobs = NULL;
+    priv->method_HBCIHandler_getLowlevelJobRestrictions = NULL;
+    priv->method_HBCIHandler_getHBCIVersion = NULL;
     priv->method_HBCICallbackConsole_constructor = NULL;
     priv->method_HBCICallbackNative_constructor = NULL;
+    priv->method_ThreadGroup_constructor = NULL;
     priv->method_HBCIJob_setParam = NULL;
+    priv->method_HBCIJob_setParamIndexed = NULL;
     priv->method_HBCIJob_addToQueue = NULL;
     priv->method_HBCIJob_getJobResult = NULL;
+    priv->method_HBCIJob_getName = NULL;
     priv->method_HBCIJobResult_getJobStatus = NULL;
+    priv->method_HBCIJobResult_getGlobStatus = NULL;
+    priv->method_HBCIStatus_getErrors = NULL;
+    priv->method_Throwable_getCause = NULL;
+    priv->method_Throwable_toString = NULL;
+    priv->method_HBCIExecStatus_getCustomerIds = NULL;
+    priv->method_HBCIExecStatus_getExceptions = NULL;
+    priv->method_HBCIExecStatus_getErrorString = NULL;
     priv->method_HBCIStatus_getErrorString = NULL;
     priv->method_HBCIPassport_getAccounts = NULL;
+    priv->method_HBCIPassport_getBPDVersion = NULL;
+    priv->method_HBCIPassport_getInstName = NULL;
+    priv->method_HBCIPassport_getHost = NULL;
     priv->method_AbstractHBCIPassport_getInstance = NULL;
     priv->method_AbstractPinTanPassport_getTwostepMechanisms = NULL;
     priv->method_AbstractPinTanPassport_getAllowedTwostepMechanisms = NULL;
     priv->method_AbstractPinTanPassport_setCurrentTANMethod = NULL;
     priv->method_HBCIJobResultImpl_isOK = NULL;
+    priv->method_HBCIJobResultImpl_getResultData = NULL;
     priv->method_Konto_constructor = NULL;
     priv->method_Value_toString = NULL;
     priv->method_Properties_keys = NULL;
     priv->method_Properties_getProperty = NULL;
+    priv->method_Properties_store = NULL;
     priv->method_Hashtable_toString = NULL;
     priv->method_Hashtable_get = NULL;
     priv->method_Enumeration_hasMoreElements = NULL;
@@ -226,10 +430,9 @@ ghbci_context_init (GHbciContext *self)
     priv->method_StringBuffer_replace = NULL;
     priv->method_StringBuffer_setLength = NULL;
     priv->method_StringBuffer_toString = NULL;
+    priv->method_StringBuffer_length = NULL;
+    priv->method_StringBuffer_getChars = NULL;
     priv->method_Date_toString = NULL;
-    priv->method_Date_getDate = NULL;
-    priv->method_Date_getMonth = NULL;
-    priv->method_Date_getYear = NULL;
     priv->method_Date_getTime = NULL;
     priv->field_HBCIUtilsInternal_blzs = NULL;
     priv->field_Konto_country = NULL;
@@ -252,6 +455,27 @@ ghbci_context_init (GHbciContext *self)
     priv->field_GVRKUmsUmsLine_usage = NULL;
     priv->field_GVRKUmsUmsLine_other = NULL;
     priv->field_GVRKUmsUmsLine_text = NULL;
+    priv->field_GVRKUms_bufferMT940 = NULL;
+    priv->field_HBCIRetVal_code = NULL;
+    priv->field_HBCIRetVal_segref = NULL;
+    priv->field_HBCIRetVal_text = NULL;
+}
+
+/*
+ * Empty a cache of global references
+ */
+static void
+delete_global_refs (JNIEnv* jni_env, GHashTable* refs)
+{
+    GHashTableIter iter;
+    gpointer ref;
+
+    if (refs == NULL)
+        return;
+    g_hash_table_iter_init(&iter, refs);
+    while (g_hash_table_iter_next(&iter, NULL, &ref))
+        (*jni_env)->DeleteGlobalRef(jni_env, ref);
+    g_hash_table_remove_all(refs);
 }
 
 static void
@@ -259,10 +483,33 @@ ghbci_context_dispose (GObject *obj)
 {
     GHbciContext *self = GHBCI_CONTEXT (obj);
 
+    // deliver pending log messages
+    ghbci_log_ring_stop(self->priv->log_ring);
+    g_clear_pointer(&self->priv->log_sink, log_sink_unref);
+    g_clear_object(&self->priv->credential_provider);
+    g_clear_pointer(&self->priv->workers, ghbci_worker_pool_free);
+    g_clear_pointer(&self->priv->daemon, ghbci_daemon_client_free);
+
     if (self->priv->jvm != NULL) {
+        JNIEnv* jni_env = ghbci_context_get_jni_env (self);
+        guint i;
+
+        delete_global_refs(jni_env, self->priv->hbci_handlers);
+        delete_global_refs(jni_env, self->priv->accounts);
+        for (i = 0; i < GHBCI_JAVA_STRING_LAST; i++) {
+            if (self->priv->java_strings[i] != NULL)
+                (*jni_env)->DeleteGlobalRef(jni_env, self->priv->java_strings[i]);
+            self->priv->java_strings[i] = NULL;
+        }
+        if (self->priv->callback != NULL) {
+            (*jni_env)->DeleteGlobalRef(jni_env, self->priv->callback);
+            self->priv->callback = NULL;
+        }
         (*self->priv->jvm)->DestroyJavaVM(self->priv->jvm); 
         self->priv->jvm = NULL;
     }
+    g_clear_pointer(&self->priv->hbci_handlers, g_hash_table_unref);
+    g_clear_pointer(&self->priv->accounts, g_hash_table_unref);
 
     GSList* iter = self->priv->passports;
     while(iter != NULL) {
@@ -273,7 +520,14 @@ ghbci_context_dispose (GObject *obj)
         iter = g_slist_next(iter);
     }
     g_slist_free_full(self->priv->passports, g_free);
+    self->priv->passports = NULL;
     g_free(self->priv->passport_directory);
+    self->priv->passport_directory = NULL;
+
+    if (self->priv->thread_groups != NULL) {
+        g_hash_table_unref(self->priv->thread_groups);
+        self->priv->thread_groups = NULL;
+    }
 
     G_OBJECT_CLASS (ghbci_context_parent_class)->dispose (obj);
 }
@@ -281,21 +535,467 @@ ghbci_context_dispose (GObject *obj)
 static void
 ghbci_context_finalize (GObject *obj)
 {
-  //GHbciContext *self = GHBCI_CONTEXT (obj);
+  GHbciContext *self = GHBCI_CONTEXT (obj);
+
+  ghbci_rate_limiter_free (self->priv->rate_limiter);
+  g_hash_table_unref (self->priv->capabilities);
+  g_hash_table_unref (self->priv->pin_tan_urls);
+  g_hash_table_unref (self->priv->answers);
+  ghbci_metrics_unref (self->priv->metrics);
+  g_time_zone_unref (self->priv->time_zone);
+  ghbci_log_ring_free (self->priv->log_ring);
+  g_hash_table_unref (self->priv->log_tails);
+  g_queue_clear (&self->priv->log_tail_order);
+  g_mutex_clear (&self->priv->log_lock);
+  g_mutex_clear (&self->priv->lock);
+#ifdef GHBCI_ENABLE_INSTRUMENTATION
+  g_hash_table_unref (self->priv->call_counters);
+  g_mutex_clear (&self->priv->call_counters_lock);
+#endif
 
   G_OBJECT_CLASS (ghbci_context_parent_class)->finalize (obj);
 }
 
+static void
+ghbci_context_set_property (GObject      *obj,
+                            guint         prop_id,
+                            const GValue *value,
+                            GParamSpec   *pspec)
+{
+    GHbciContext *self = GHBCI_CONTEXT (obj);
+
+    switch (prop_id)
+    {
+    case PROP_LOG_LEVEL:
+        ghbci_context_set_log_level (self, g_value_get_int (value));
+        break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (obj, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+ghbci_context_get_property (GObject    *obj,
+                            guint       prop_id,
+                            GValue     *value,
+                            GParamSpec *pspec)
+{
+    GHbciContext *self = GHBCI_CONTEXT (obj);
+
+    switch (prop_id)
+    {
+    case PROP_LOG_LEVEL:
+        g_value_set_int (value, g_atomic_int_get (&self->priv->log_level));
+        break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (obj, prop_id, pspec);
+      break;
+    }
+}
+
+/*
+ * Push log level to hbci4java, the setting is per thread group
+ */
+static void
+push_log_level (GHbciContext* self, JNIEnv* jni_env)
+{
+    GHbciContextPrivate* priv = self->priv;
+
+    gchar* level = g_strdup_printf("%d", g_atomic_int_get(&priv->log_level));
+    jstring loglevel_value = (*jni_env)->NewStringUTF(jni_env, level);
+    (*jni_env)->CallStaticVoidMethod(jni_env, priv->class_HBCIUtils, priv->method_HBCIUtils_setParam,
+            priv->java_strings[GHBCI_JAVA_STRING_LOG_LEVEL], loglevel_value);
+    (*jni_env)->DeleteLocalRef(jni_env, loglevel_value);
+    g_free(level);
+}
+
+/*
+ * dialog running in the current thread, for byte accounting and log tails
+ */
+typedef struct
+{
+    guint serial;
+    gchar* dialog_id;
+    guint64 bytes_sent;
+    guint64 bytes_received;
+} StatusDialog;
+
+static gint status_dialog_serial = 0;
+
+static void
+status_dialog_free (gpointer data)
+{
+    StatusDialog* dialog = data;
+
+    g_free(dialog->dialog_id);
+    g_free(dialog);
+}
+
+static GPrivate status_dialog = G_PRIVATE_INIT (status_dialog_free);
+
+static StatusDialog*
+status_dialog_get (void)
+{
+    StatusDialog* dialog = g_private_get(&status_dialog);
+
+    if (dialog == NULL) {
+        dialog = g_new0(StatusDialog, 1);
+        dialog->serial = (guint)g_atomic_int_add(&status_dialog_serial, 1) + 1;
+        g_private_set(&status_dialog, dialog);
+    }
+    return dialog;
+}
+
+static void
+log_sink_unref (GHbciLogSink* sink)
+{
+    if (!g_atomic_int_dec_and_test(&sink->ref_count))
+        return;
+    if (sink->notify != NULL)
+        sink->notify(sink->user_data);
+    g_free(sink);
+}
+
+/*
+ * Deliver a log record in the drain thread: keep it for the tail of its
+ * dialog and pass it to the sink or the log signal
+ */
+static void
+deliver_log_record (const GHbciLogRecord* record, gpointer user_data)
+{
+    GHbciContext* context = user_data;
+    GHbciContextPrivate* priv = context->priv;
+
+    g_mutex_lock(&priv->log_lock);
+
+    GQueue* tail = g_hash_table_lookup(priv->log_tails, GUINT_TO_POINTER(record->serial));
+    if (tail == NULL) {
+        // forget the oldest dialog
+        if (g_queue_get_length(&priv->log_tail_order) >= LOG_TAIL_DIALOGS) {
+            gpointer oldest = g_queue_pop_head(&priv->log_tail_order);
+            g_hash_table_remove(priv->log_tails, oldest);
+        }
+        tail = g_queue_new();
+        g_hash_table_insert(priv->log_tails, GUINT_TO_POINTER(record->serial), tail);
+        g_queue_push_tail(&priv->log_tail_order, GUINT_TO_POINTER(record->serial));
+    }
+    g_queue_push_tail(tail, g_strdup(record->message));
+    if (g_queue_get_length(tail) > LOG_TAIL_LENGTH)
+        g_free(g_queue_pop_head(tail));
+
+    // called unlocked, the sink may replace itself
+    GHbciLogSink* sink = priv->log_sink;
+    if (sink != NULL)
+        g_atomic_int_inc(&sink->ref_count);
+
+    g_mutex_unlock(&priv->log_lock);
+
+    if (sink != NULL) {
+        sink->func(record->level, record->time, record->dialog_id, record->message, sink->user_data);
+        log_sink_unref(sink);
+    } else if (g_signal_has_handler_pending(context, ghbci_context_signals[LOG], 0, TRUE)) {
+        g_signal_emit (context, ghbci_context_signals[LOG], 0, record->message, (gint64)record->level);
+    }
+}
+
+static void
+log_tail_free (gpointer data)
+{
+    g_queue_free_full(data, g_free);
+}
+
+/*
+ * Reserve a log record of the dialog running in the current thread, NULL
+ * if the message isn't heard. Filled in records are committed with ticket,
+ * delivery happens in the drain thread.
+ */
+static GHbciLogRecord*
+log_record_reserve (GHbciContext* context, gint level, guint64* ticket)
+{
+    GHbciLogRecord* record;
+    StatusDialog* dialog;
+
+    // thread groups initialized before a change of the log level still
+    // send verbose messages, drop them here
+    if (level > g_atomic_int_get(&context->priv->log_level))
+        return NULL;
+    if (g_atomic_pointer_get(&context->priv->log_sink) == NULL
+            && !g_signal_has_handler_pending(context, ghbci_context_signals[LOG], 0, TRUE))
+        return NULL;
+
+    record = ghbci_log_ring_reserve(context->priv->log_ring, ticket);
+    if (record == NULL)
+        return NULL;
+
+    dialog = status_dialog_get();
+    record->level = level;
+    record->time = g_get_real_time();
+    record->serial = dialog->serial;
+    g_strlcpy(record->dialog_id, dialog->dialog_id != NULL ? dialog->dialog_id : "", GHBCI_LOG_RECORD_DIALOG_SIZE);
+    return record;
+}
+
 /*
  * native implementation for log events
  */
 void my_log(JNIEnv *jni_env, jobject this, jstring jmsg, jint level, jobject date, jobject trace)
 {
     GHbciContext* context = (*jni_env)->reserved3;
+    GHbciLogRecord* record;
+    guint64 ticket;
+
+    record = log_record_reserve(context, level, &ticket);
+    if (record == NULL)
+        return;
+
+    // straight into the record, a long message is read only as far as it fits
+    ghbci_jstring_copy_prefix(jni_env, jmsg, record->message, GHBCI_LOG_RECORD_MESSAGE_SIZE);
+
+    ghbci_log_ring_commit(context->priv->log_ring, ticket);
+}
+
+/*
+ * Answers set with ghbci_context_set_answer() for one passport or, with the
+ * empty key, for all of them
+ */
+typedef struct
+{
+    gchar* values[CALLBACK_REASONS];
+} CallbackAnswers;
+
+static void
+callback_answers_free (gpointer data)
+{
+    CallbackAnswers* answers = data;
+    guint i;
+
+    for (i = 0; i < CALLBACK_REASONS; i++)
+        g_free(answers->values[i]);
+    g_free(answers);
+}
+
+/*
+ * Passport the current thread talks to the bank for. The callback of
+ * hbci4java doesn't tell, so add_passport and execute_job keep it on
+ * the stack while they are in java.
+ */
+typedef struct _CallbackScope CallbackScope;
+struct _CallbackScope
+{
+    const gchar* blz;
+    const gchar* userid;
+    const gchar* key;
+    const gchar* limit_key;
+    CallbackScope* outer;
+};
+
+static GPrivate callback_scope;
+
+static void
+callback_scope_push (CallbackScope* scope, const gchar* blz, const gchar* userid, const gchar* key,
+        const gchar* limit_key)
+{
+    scope->blz = blz;
+    scope->userid = userid;
+    scope->key = key;
+    scope->limit_key = limit_key;
+    scope->outer = g_private_get(&callback_scope);
+    g_private_set(&callback_scope, scope);
+}
+
+static void
+callback_scope_pop (CallbackScope* scope)
+{
+    g_private_set(&callback_scope, scope->outer);
+}
+
+/*
+ * Look up a static answer, the passport's one before the default
+ */
+static gboolean
+lookup_answer (GHbciContext* self, const CallbackScope* scope, jint reason, gchar** answer)
+{
+    GHbciContextPrivate* priv = self->priv;
+    CallbackAnswers* answers = NULL;
+    gboolean found = FALSE;
+
+    if (reason < 0 || reason >= CALLBACK_REASONS)
+        return FALSE;
+
+    g_mutex_lock(&priv->lock);
+    if (scope != NULL)
+        answers = g_hash_table_lookup(priv->answers, scope->key);
+    if (answers == NULL || answers->values[reason] == NULL)
+        answers = g_hash_table_lookup(priv->answers, "");
+    if (answers != NULL && answers->values[reason] != NULL) {
+        *answer = g_strdup(answers->values[reason]);
+        found = TRUE;
+    }
+    g_mutex_unlock(&priv->lock);
+    return found;
+}
+
+typedef struct
+{
+    gboolean done;
+    gchar* answer;
+    GError* error;
+} PendingAnswer;
+
+static void
+credential_provider_answered (GObject* source, GAsyncResult* result, gpointer user_data)
+{
+    PendingAnswer* pending = user_data;
+
+    pending->answer = ghbci_credential_provider_request_finish(GHBCI_CREDENTIAL_PROVIDER(source),
+            result, &pending->error);
+    pending->done = TRUE;
+}
+
+/*
+ * Ask the credential provider, returns FALSE if it doesn't know the answer
+ *
+ * The dialog can't continue without the answer, so deferred requests are
+ * waited for here. If this thread may run its thread default main context,
+ * e.g. in the main thread of an application, that one is iterated, so the
+ * provider can show a prompt. Otherwise a private main context is pushed
+ * and the provider completes on this thread.
+ */
+static gboolean
+ask_credential_provider (GHbciContext* self, const GHbciCredentialRequest* request, gchar** answer)
+{
+    GHbciContextPrivate* priv = self->priv;
+    GHbciCredentialProvider* provider = NULL;
+    gboolean found;
+
+    g_mutex_lock(&priv->lock);
+    if (priv->credential_provider != NULL)
+        provider = g_object_ref(priv->credential_provider);
+    g_mutex_unlock(&priv->lock);
+
+    if (provider == NULL)
+        return FALSE;
+
+    found = ghbci_credential_provider_lookup(provider, request, answer);
+    if (!found && GHBCI_CREDENTIAL_PROVIDER_GET_IFACE(provider)->request_async != NULL) {
+        PendingAnswer pending = { FALSE, NULL, NULL };
+        GMainContext* main_context = g_main_context_ref_thread_default();
+        gboolean private_context = !g_main_context_acquire(main_context);
+
+        if (private_context) {
+            g_main_context_unref(main_context);
+            main_context = g_main_context_new();
+            g_main_context_push_thread_default(main_context);
+        }
+        ghbci_credential_provider_request_async(provider, request, NULL, credential_provider_answered, &pending);
+        while (!pending.done)
+            g_main_context_iteration(main_context, TRUE);
+        if (private_context)
+            g_main_context_pop_thread_default(main_context);
+        else
+            g_main_context_release(main_context);
+        g_main_context_unref(main_context);
+
+        // errors abort the job, unless the provider can't answer at all
+        found = TRUE;
+        if (pending.error != NULL) {
+            g_debug("credential provider failed for reason %d: %s", request->reason, pending.error->message);
+            found = !g_error_matches(pending.error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED);
+            g_error_free(pending.error);
+        }
+        *answer = pending.answer;
+    }
+    g_object_unref(provider);
+    return found;
+}
+
+/*
+ * Hand a TAN request to the tan-challenge handlers and wait for the answer,
+ * returns FALSE if there are no handlers
+ *
+ * The connection slot of the bank is given back while waiting, a user
+ * reading their phone must not stall syncs of other passports.
+ */
+static gboolean
+wait_for_tan_challenge (GHbciContext* self, const CallbackScope* scope, jint reason, const gchar* message,
+        const gchar* optional, gchar** answer)
+{
+    GHbciContextPrivate* priv = self->priv;
+    GHbciTanChallenge* challenge;
+
+    if (reason != GHBCI_REASON_ENUM_NEED_PT_TAN
+            || !g_signal_has_handler_pending(self, ghbci_context_signals[TAN_CHALLENGE], 0, FALSE))
+        return FALSE;
+
+    g_mutex_lock(&priv->lock);
+    gint64 expiry_time = g_get_monotonic_time() + (gint64)priv->tan_timeout * G_TIME_SPAN_SECOND;
+    challenge = ghbci_tan_challenge_new(scope != NULL ? scope->blz : NULL, scope != NULL ? scope->userid : NULL,
+            message, optional, expiry_time);
+    priv->tan_challenges = g_slist_prepend(priv->tan_challenges, ghbci_tan_challenge_ref(challenge));
+    g_mutex_unlock(&priv->lock);
+
+    if (scope != NULL && scope->limit_key != NULL)
+        ghbci_rate_limiter_release(priv->rate_limiter, scope->limit_key);
+
+    g_signal_emit (self, ghbci_context_signals[TAN_CHALLENGE], 0, challenge);
+    *answer = ghbci_tan_challenge_wait(challenge);
+
+    if (scope != NULL && scope->limit_key != NULL)
+        ghbci_rate_limiter_acquire(priv->rate_limiter, scope->limit_key);
+
+    g_mutex_lock(&priv->lock);
+    priv->tan_challenges = g_slist_remove(priv->tan_challenges, challenge);
+    g_mutex_unlock(&priv->lock);
+    ghbci_tan_challenge_unref(challenge);
+
+    g_debug("tan challenge %s", *answer != NULL ? "answered" : "cancelled or expired");
+    ghbci_tan_challenge_unref(challenge);
+    return TRUE;
+}
+
+/*
+ * Ask the application for an answer without a static one: the credential
+ * provider, the tan-challenge handlers and the callback signal, in turn
+ */
+static void
+ask_application (GHbciContext* self, const CallbackScope* scope, jint reason, const gchar* message,
+        const gchar* optional, gchar** answer)
+{
+    GHbciCredentialRequest request;
+
+    request.reason = reason;
+    request.blz = scope != NULL ? (gchar*)scope->blz : NULL;
+    request.userid = scope != NULL ? (gchar*)scope->userid : NULL;
+    request.message = (gchar*)message;
+    request.optional = (gchar*)optional;
+
+    if (!ask_credential_provider(self, &request, answer)
+            && !wait_for_tan_challenge(self, scope, reason, message, optional, answer))
+        g_signal_emit (self, ghbci_context_signals[CALLBACK], 0, (gint64)reason, message, optional, answer);
+}
+
+/*
+ * Answer a callback of a worker process or the daemon, see
+ * ghbci_context_new_with_workers() and ghbci_context_new_for_daemon()
+ */
+static gchar*
+answer_worker_callback (const gchar* blz, const gchar* userid, gint reason, const gchar* message,
+        const gchar* optional, gpointer user_data)
+{
+    GHbciContext* self = user_data;
+    CallbackScope scope;
+    gchar* answer = NULL;
 
-    const char *msg = (*jni_env)->GetStringUTFChars(jni_env, jmsg, NULL);
-    g_signal_emit (context, ghbci_context_signals[LOG], 0, msg, level);
-    (*jni_env)->ReleaseStringUTFChars(jni_env, jmsg, msg);
+    gchar* key = g_strconcat(blz, "+", userid, NULL);
+    callback_scope_push(&scope, blz, userid, key, NULL);
+    if (!lookup_answer(self, &scope, reason, &answer))
+        ask_application(self, &scope, reason, message, optional, &answer);
+    callback_scope_pop(&scope);
+    g_free(key);
+    return answer;
 }
 
 /*
@@ -304,17 +1004,22 @@ void my_log(JNIEnv *jni_env, jobject this, jstring jmsg, jint level, jobject dat
 void my_callback(JNIEnv *jni_env, jobject this, jobject passport, jint reason, jstring jmsg, jint datatype, jobject retData)
 {
     GHbciContext* context = (*jni_env)->reserved3;
-
-    // retrieve optional argument from string buffer 
-    jstring joptional = (*jni_env)->CallObjectMethod(jni_env, retData, context->priv->method_StringBuffer_toString);
-
-    // emit signal (convert j* to native string)
-    const char *msg = (*jni_env)->GetStringUTFChars(jni_env, jmsg, NULL);
-    const char *optional = (*jni_env)->GetStringUTFChars(jni_env, joptional, NULL);
-    gchar* retvalue;
-    g_signal_emit (context, ghbci_context_signals[CALLBACK], 0, reason, msg, optional, &retvalue);
-    (*jni_env)->ReleaseStringUTFChars(jni_env, jmsg, msg);
-    (*jni_env)->ReleaseStringUTFChars(jni_env, joptional, optional);
+    const CallbackScope* scope = g_private_get(&callback_scope);
+    gchar* retvalue = NULL;
+
+    // static answers need neither the strings nor the application
+    if (!lookup_answer(context, scope, reason, &retvalue)) {
+        // retrieve optional argument from string buffer
+        jstring joptional = (*jni_env)->CallObjectMethod(jni_env, retData, context->priv->method_StringBuffer_toString);
+
+        // convert j* to native string
+        const char *msg = (*jni_env)->GetStringUTFChars(jni_env, jmsg, NULL);
+        const char *optional = (*jni_env)->GetStringUTFChars(jni_env, joptional, NULL);
+        ask_application(context, scope, reason, msg, optional, &retvalue);
+        (*jni_env)->ReleaseStringUTFChars(jni_env, jmsg, msg);
+        (*jni_env)->ReleaseStringUTFChars(jni_env, joptional, optional);
+        (*jni_env)->DeleteLocalRef(jni_env, joptional);
+    }
 
     // return result as StringBuffer in parameter retData
     (*jni_env)->CallObjectMethod(jni_env, retData, context->priv->method_StringBuffer_setLength, 0);
@@ -329,954 +1034,3745 @@ void my_callback(JNIEnv *jni_env, jobject this, jobject passport, jint reason, j
     g_free(retvalue);
 }
 
+/*
+ * Copy a java string element of the status objects, NULL for other types
+ */
+static gchar*
+status_object_to_string (GHbciContext* context, JNIEnv* jni_env, jobject object)
+{
+    gchar* result = NULL;
+
+    if (object != NULL && (*jni_env)->IsInstanceOf(jni_env, object, context->priv->class_String)) {
+        result = ghbci_jstring_dup(jni_env, object);
+    }
+    return result;
+}
+
+/*
+ * Decode the objects hbci4java attached to a status event
+ */
+static void
+status_decode_payload (GHbciContext* context, JNIEnv* jni_env, jint statusTag, jobject first,
+        GHbciStatusPayload* payload)
+{
+    GHbciContextPrivate* priv = context->priv;
+
+    switch (statusTag) {
+        case GHBCI_STATUSTAG_ENUM_SEND_TASK:
+        case GHBCI_STATUSTAG_ENUM_SEND_TASK_DONE:
+            if (first != NULL && (*jni_env)->IsInstanceOf(jni_env, first, priv->class_HBCIJob)) {
+                jstring name = (*jni_env)->CallObjectMethod(jni_env, first, priv->method_HBCIJob_getName);
+                if (name != NULL) {
+                    payload->job_name = status_object_to_string(context, jni_env, name);
+                    (*jni_env)->DeleteLocalRef(jni_env, name);
+                } else {
+                    (*jni_env)->ExceptionClear(jni_env);
+                }
+            }
+            break;
+        case GHBCI_STATUSTAG_ENUM_MSG_CREATE:
+            payload->message_name = status_object_to_string(context, jni_env, first);
+            break;
+        case GHBCI_STATUSTAG_ENUM_MSG_RAW_SEND:
+        case GHBCI_STATUSTAG_ENUM_MSG_RAW_RECV:
+            if (priv->capture_raw_messages)
+                payload->raw_message = status_object_to_string(context, jni_env, first);
+            break;
+        default:
+            break;
+    }
+}
+
 /*
  * native implementation for status events
  */
 void my_status(JNIEnv *jni_env, jobject this, jobject passport, jint statusTag, jarray o)
 {
     GHbciContext* context = (*jni_env)->reserved3;
-    //const char *msg = (*jni_env)->GetStringUTFChars(jni_env, jmsg, NULL);
-    g_signal_emit (context, ghbci_context_signals[STATUS], 0, statusTag, "");
-    //(*jni_env)->ReleaseStringUTFChars(jni_env, jmsg, msg);
+    StatusDialog* dialog;
+    jobject first = NULL;
+    gsize message_size = 0;
+
+    ghbci_metrics_status(context->priv->metrics, statusTag);
+
+    dialog = status_dialog_get();
+
+    // the log records are tagged with the dialog, listeners or not
+    switch (statusTag) {
+        case GHBCI_STATUSTAG_ENUM_DIALOG_INIT:
+            dialog->serial = (guint)g_atomic_int_add(&status_dialog_serial, 1) + 1;
+            g_free(dialog->dialog_id);
+            dialog->dialog_id = NULL;
+            dialog->bytes_sent = 0;
+            dialog->bytes_received = 0;
+            break;
+        case GHBCI_STATUSTAG_ENUM_DIALOG_INIT_DONE:
+            // objects: message status, dialog id
+            if (o != NULL && (*jni_env)->GetArrayLength(jni_env, o) > 1) {
+                jobject dialog_id = (*jni_env)->GetObjectArrayElement(jni_env, o, 1);
+                g_free(dialog->dialog_id);
+                dialog->dialog_id = status_object_to_string(context, jni_env, dialog_id);
+                if (dialog_id != NULL)
+                    (*jni_env)->DeleteLocalRef(jni_env, dialog_id);
+            }
+            break;
+        default:
+            break;
+    }
+
+    // decode only for listeners, the bytes are counted while there are some
+    if (!g_signal_has_handler_pending(context, ghbci_context_signals[STATUS], 0, TRUE))
+        return;
+
+    if (o != NULL && (*jni_env)->GetArrayLength(jni_env, o) > 0)
+        first = (*jni_env)->GetObjectArrayElement(jni_env, o, 0);
+
+    // raw messages are latin-1, so the string length is the byte count
+    if (statusTag == GHBCI_STATUSTAG_ENUM_MSG_RAW_SEND || statusTag == GHBCI_STATUSTAG_ENUM_MSG_RAW_RECV) {
+        if (first != NULL && (*jni_env)->IsInstanceOf(jni_env, first, context->priv->class_String))
+            message_size = (*jni_env)->GetStringLength(jni_env, first);
+        if (statusTag == GHBCI_STATUSTAG_ENUM_MSG_RAW_SEND)
+            dialog->bytes_sent += message_size;
+        else
+            dialog->bytes_received += message_size;
+    }
+
+    GHbciStatusPayload* payload = ghbci_status_payload_new(statusTag);
+    payload->message_size = message_size;
+
+    status_decode_payload(context, jni_env, statusTag, first, payload);
+
+    payload->dialog_id = g_strdup(dialog->dialog_id);
+    payload->dialog_bytes_sent = dialog->bytes_sent;
+    payload->dialog_bytes_received = dialog->bytes_received;
+
+    const gchar* text = payload->job_name != NULL ? payload->job_name
+                      : payload->message_name != NULL ? payload->message_name
+                      : statusTag == GHBCI_STATUSTAG_ENUM_DIALOG_INIT_DONE && payload->dialog_id != NULL ? payload->dialog_id
+                      : "";
+    g_signal_emit (context, ghbci_context_signals[STATUS], 0, (gint64)statusTag, text, payload);
+
+    ghbci_status_payload_free(payload);
+
+    if (first != NULL)
+        (*jni_env)->DeleteLocalRef(jni_env, first);
 }
 
 /*
- * Helper to fetch HBCIHandler-object from internal cache
+ * Pass on a log message or status event of a worker process like the ones
+ * of the jvm in this process, on the thread of the request
  */
-jobject get_hbci_handler(GHbciContext* self, const gchar* blz, const gchar* userid) {
-    GHbciContextPrivate* priv;
-    jobject hbci_handler;
+static void
+relay_worker_event (GHbciWorkerMessage kind, GVariant* body, gpointer user_data)
+{
+    GHbciContext* context = user_data;
+    StatusDialog* dialog = status_dialog_get();
+
+    if (kind == GHBCI_WORKER_LOG) {
+        GHbciLogRecord* record;
+        const gchar *dialog_id, *message;
+        guint64 ticket;
+        gint64 time;
+        gint level;
+
+        g_variant_get(body, "(ix&s&s)", &level, &time, &dialog_id, &message);
+        record = log_record_reserve(context, level, &ticket);
+        if (record == NULL)
+            return;
+        // already cut to the size of a record by the worker
+        record->time = time;
+        g_strlcpy(record->dialog_id, dialog_id, GHBCI_LOG_RECORD_DIALOG_SIZE);
+        g_strlcpy(record->message, message, GHBCI_LOG_RECORD_MESSAGE_SIZE);
+        ghbci_log_ring_commit(context->priv->log_ring, ticket);
+        return;
+    }
 
-    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), NULL);
-    priv = self->priv;
+    gchar* text;
+    GHbciStatusPayload* payload = ghbci_worker_status_from_variant(body, &text);
 
-    // get HBCIHandler from hashtable
-    char* key = g_strconcat(blz, "+", userid, NULL);
-    hbci_handler = g_hash_table_lookup(priv->hbci_handlers, key);
+    ghbci_metrics_status(context->priv->metrics, payload->tag);
 
-    g_free(key);
-    return hbci_handler;
+    // the worker counts the bytes, the serial for the log tails is ours
+    if (payload->tag == GHBCI_STATUSTAG_ENUM_DIALOG_INIT)
+        dialog->serial = (guint)g_atomic_int_add(&status_dialog_serial, 1) + 1;
+    g_free(dialog->dialog_id);
+    dialog->dialog_id = g_strdup(payload->dialog_id);
+    dialog->bytes_sent = payload->dialog_bytes_sent;
+    dialog->bytes_received = payload->dialog_bytes_received;
+
+    if (g_signal_has_handler_pending(context, ghbci_context_signals[STATUS], 0, TRUE))
+        g_signal_emit (context, ghbci_context_signals[STATUS], 0, (gint64)payload->tag, text, payload);
+
+    ghbci_status_payload_free(payload);
+    g_free(text);
 }
 
 /*
- * Helper to fetch Konto-object from internal cache
+ * Get the jni environment of the calling thread
+ *
+ * JNIEnv pointers are only valid in the thread they belong to. Threads not
+ * known to the jvm yet are attached as daemon threads to the main thread
+ * group, so they share the global hbci4java configuration.
  */
-jobject get_account(GHbciContext* self, const gchar* blz, const gchar* userid, const gchar* number) {
+JNIEnv*
+ghbci_context_get_jni_env (GHbciContext* self)
+{
     GHbciContextPrivate* priv;
-    jobject account;
+    JNIEnv* jni_env = NULL;
 
     g_return_val_if_fail (GHBCI_IS_CONTEXT (self), NULL);
     priv = self->priv;
 
-    char* key = g_strconcat(blz, "+", userid, "+", number, NULL);
-    account = g_hash_table_lookup(priv->accounts, key);
+    if ((*priv->jvm)->GetEnv(priv->jvm, (void**)&jni_env, JNI_VERSION_1_6) == JNI_OK) {
+        return jni_env;
+    }
 
-    g_free(key);
-    return account;
+    if ((*priv->jvm)->AttachCurrentThreadAsDaemon(priv->jvm, (void**)&jni_env, NULL) != JNI_OK) {
+        g_warning("attaching thread to jvm failed");
+        return NULL;
+    }
+    return jni_env;
 }
 
+/*
+ * Attach the calling thread to the jvm in the thread group of a passport
+ *
+ * hbci4java keeps its configuration (HBCIUtils.setParam) per thread group.
+ * Every passport gets its own group, so parameters like the passport filename
+ * don't leak between passports synced in parallel. The calling thread must
+ * not be attached already and has to call ghbci_context_detach_thread() when
+ * done.
+ */
+JNIEnv*
+ghbci_context_attach_passport_thread (GHbciContext* self, const gchar* blz, const gchar* userid)
+{
+    GHbciContextPrivate* priv;
+    JNIEnv* jni_env = NULL;
+    JavaVMAttachArgs args;
+    jobject group;
+    gboolean initialize = FALSE;
 
-/* public methods */
+    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), NULL);
+    priv = self->priv;
 
-/**
- * ghbci_context_new: (constructor)
- * @directory: temporary directory to save passports
+    gchar* key = g_strconcat(blz, "+", userid, NULL);
+
+    g_mutex_lock(&priv->lock);
+    group = g_hash_table_lookup(priv->thread_groups, key);
+    if (group == NULL) {
+        // creating the ThreadGroup object needs a temporary attachment
+        if ((*priv->jvm)->AttachCurrentThreadAsDaemon(priv->jvm, (void**)&jni_env, NULL) != JNI_OK) {
+            g_mutex_unlock(&priv->lock);
+            g_warning("attaching thread to jvm failed");
+            g_free(key);
+            return NULL;
+        }
+        jstring name = (*jni_env)->NewStringUTF(jni_env, key);
+        jobject local_group = (*jni_env)->NewObject(jni_env, priv->class_ThreadGroup, priv->method_ThreadGroup_constructor, name);
+        (*jni_env)->DeleteLocalRef(jni_env, name);
+        if (local_group == NULL) {
+            (*jni_env)->ExceptionDescribe(jni_env);
+            (*priv->jvm)->DetachCurrentThread(priv->jvm);
+            g_mutex_unlock(&priv->lock);
+            g_free(key);
+            return NULL;
+        }
+        group = (*jni_env)->NewGlobalRef(jni_env, local_group);
+        (*jni_env)->DeleteLocalRef(jni_env, local_group);
+        (*priv->jvm)->DetachCurrentThread(priv->jvm);
+
+        g_hash_table_insert(priv->thread_groups, g_strdup(key), group);
+        initialize = TRUE;
+    }
+    g_mutex_unlock(&priv->lock);
+
+    args.version = JNI_VERSION_1_6;
+    args.name = key;
+    args.group = group;
+    if ((*priv->jvm)->AttachCurrentThreadAsDaemon(priv->jvm, (void**)&jni_env, &args) != JNI_OK) {
+        g_warning("attaching thread to jvm failed");
+        g_free(key);
+        return NULL;
+    }
+    g_free(key);
+
+    if (initialize) {
+        // HBCIUtils.initThread(null, callback)
+        (*jni_env)->CallStaticVoidMethod(jni_env, priv->class_HBCIUtils, priv->method_HBCIUtils_initThread, NULL, priv->callback);
+        if ((*jni_env)->ExceptionCheck(jni_env)) {
+            (*jni_env)->ExceptionDescribe(jni_env);
+        }
+        push_log_level(self, jni_env);
+    }
+
+    return jni_env;
+}
+
+/*
+ * Detach the calling thread from the jvm, releases all its local references
+ */
+void
+ghbci_context_detach_thread (GHbciContext* self)
+{
+    g_return_if_fail (GHBCI_IS_CONTEXT (self));
+
+    (*self->priv->jvm)->DetachCurrentThread(self->priv->jvm);
+}
+
+/*
+ * Helper to fetch HBCIHandler-object from internal cache. Returns a new
+ * local reference, taken while the handler can't be removed, delete it.
+ */
+jobject get_hbci_handler(GHbciContext* self, JNIEnv* jni_env, const gchar* blz, const gchar* userid) {
+    GHbciContextPrivate* priv;
+    jobject hbci_handler;
+
+    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), NULL);
+    priv = self->priv;
+
+    // get HBCIHandler from hashtable
+    char* key = g_strconcat(blz, "+", userid, NULL);
+    g_mutex_lock(&priv->lock);
+    hbci_handler = g_hash_table_lookup(priv->hbci_handlers, key);
+    if (hbci_handler != NULL)
+        hbci_handler = (*jni_env)->NewLocalRef(jni_env, hbci_handler);
+    g_mutex_unlock(&priv->lock);
+
+    g_free(key);
+    return hbci_handler;
+}
+
+/*
+ * Helper to fetch Konto-object from internal cache. Returns a new local
+ * reference, delete it.
+ */
+jobject get_account(GHbciContext* self, JNIEnv* jni_env, const gchar* blz, const gchar* userid, const gchar* number) {
+    GHbciContextPrivate* priv;
+    jobject account;
+
+    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), NULL);
+    priv = self->priv;
+
+    char* key = g_strconcat(blz, "+", userid, "+", number, NULL);
+    g_mutex_lock(&priv->lock);
+    account = g_hash_table_lookup(priv->accounts, key);
+    if (account != NULL)
+        account = (*jni_env)->NewLocalRef(jni_env, account);
+    g_mutex_unlock(&priv->lock);
+
+    g_free(key);
+    return account;
+}
+
+/*
+ * PIN/TAN url of a bank from the list shipped with hbci4java, "" if
+ * unknown. The list never changes, so every blz is looked up once.
+ * jni_env is unused by contexts running out of process.
+ */
+static gchar*
+lookup_pin_tan_url(GHbciContext* self, JNIEnv* jni_env, const gchar* blz) {
+    GHbciContextPrivate* priv = self->priv;
+    gchar* result;
+
+    g_mutex_lock(&priv->lock);
+    result = g_strdup(g_hash_table_lookup(priv->pin_tan_urls, blz));
+    g_mutex_unlock(&priv->lock);
+    if (result != NULL)
+        return result;
+
+    if (jni_env == NULL) {
+        if (!request_bank(self, blz, NULL, &result))
+            return g_strdup("");
+        g_mutex_lock(&priv->lock);
+        g_hash_table_replace(priv->pin_tan_urls, g_strdup(blz), g_strdup(result));
+        g_mutex_unlock(&priv->lock);
+        return result;
+    }
+
+    // url = HBCIUtils.getPinTanURLForBLZ(blz)
+    jstring java_blz = (*jni_env)->NewStringUTF(jni_env, blz);
+    jstring url = (*jni_env)->CallStaticObjectMethod(jni_env,
+            priv->class_HBCIUtils, priv->method_HBCIUtils_getPinTanURLForBLZ, java_blz);
+    (*jni_env)->DeleteLocalRef(jni_env, java_blz);
+
+    if (url == NULL) {
+        (*jni_env)->ExceptionClear(jni_env);
+        return g_strdup("");
+    }
+
+    result = ghbci_jstring_dup(jni_env, url);
+    (*jni_env)->DeleteLocalRef(jni_env, url);
+
+    g_mutex_lock(&priv->lock);
+    g_hash_table_replace(priv->pin_tan_urls, g_strdup(blz), g_strdup(result));
+    g_mutex_unlock(&priv->lock);
+    return result;
+}
+
+/*
+ * Key of the rate limiter bucket for a bank: its pin/tan url, so banks
+ * sharing a computing center share the limit, or the blz itself
+ */
+static gchar*
+get_rate_limit_key(GHbciContext* self, JNIEnv* jni_env, const gchar* blz) {
+    gchar* key = lookup_pin_tan_url(self, jni_env, blz);
+
+    if (key[0] == '\0') {
+        g_free(key);
+        key = g_strdup(blz);
+    }
+    return key;
+}
+
+/*
+ * Convert a java exception to a GError. Exceptions caused by network
+ * problems are worth a retry, everything else (aborted by user, wrong
+ * input, ...) would fail again
+ */
+static void
+exception_to_error(GHbciContext* self, JNIEnv* jni_env, jthrowable exception, GError** error) {
+    GHbciContextPrivate* priv = self->priv;
+    gint code = GHBCI_ERROR_EXCEPTION;
+
+    jthrowable cause = (*jni_env)->NewLocalRef(jni_env, exception);
+    while (cause != NULL) {
+        if ((*jni_env)->IsInstanceOf(jni_env, cause, priv->class_AbortException)) {
+            code = GHBCI_ERROR_ABORTED;
+            (*jni_env)->DeleteLocalRef(jni_env, cause);
+            break;
+        }
+        if ((*jni_env)->IsInstanceOf(jni_env, cause, priv->class_IOException))
+            code = GHBCI_ERROR_NETWORK;
+
+        jthrowable next = (*jni_env)->CallObjectMethod(jni_env, cause, priv->method_Throwable_getCause);
+        (*jni_env)->DeleteLocalRef(jni_env, cause);
+        cause = next;
+    }
+
+    jstring text = (*jni_env)->CallObjectMethod(jni_env, exception, priv->method_Throwable_toString);
+    gchar* message = status_object_to_string(self, jni_env, text);
+    if (text != NULL)
+        (*jni_env)->DeleteLocalRef(jni_env, text);
+
+    ghbci_set_error(error, code, NULL, ghbci_error_retry_hint_for_code(code),
+            "%s", message != NULL ? message : "unknown exception");
+    g_free(message);
+}
+
+/*
+ * Convert the pending java exception to a GError and clear it
+ */
+static void
+set_error_from_exception(GHbciContext* self, JNIEnv* jni_env, GError** error) {
+    jthrowable exception = (*jni_env)->ExceptionOccurred(jni_env);
+
+    if (exception == NULL) {
+        ghbci_set_error(error, GHBCI_ERROR_FAILED, NULL, GHBCI_RETRY_HINT_NEVER, "unexpected empty result");
+        return;
+    }
+    (*jni_env)->ExceptionClear(jni_env);
+    exception_to_error(self, jni_env, exception, error);
+    (*jni_env)->DeleteLocalRef(jni_env, exception);
+}
+
+/*
+ * Convert the first error return value of a HBCIStatus to a GError with the
+ * numeric HBCI return code
+ *
+ * Returns TRUE if the status contained an error
+ */
+static gboolean
+status_to_error(GHbciContext* self, JNIEnv* jni_env, jobject status, GError** error) {
+    GHbciContextPrivate* priv = self->priv;
+    gboolean found = FALSE;
+
+    if (status == NULL)
+        return FALSE;
+
+    jobjectArray errors = (*jni_env)->CallObjectMethod(jni_env, status, priv->method_HBCIStatus_getErrors);
+    if (errors == NULL) {
+        (*jni_env)->ExceptionClear(jni_env);
+        return FALSE;
+    }
+
+    if ((*jni_env)->GetArrayLength(jni_env, errors) > 0) {
+        jobject retval = (*jni_env)->GetObjectArrayElement(jni_env, errors, 0);
+        jstring code = (*jni_env)->GetObjectField(jni_env, retval, priv->field_HBCIRetVal_code);
+        jstring segref = (*jni_env)->GetObjectField(jni_env, retval, priv->field_HBCIRetVal_segref);
+        jstring text = (*jni_env)->GetObjectField(jni_env, retval, priv->field_HBCIRetVal_text);
+        gchar* native_code = status_object_to_string(self, jni_env, code);
+        gchar* native_segref = status_object_to_string(self, jni_env, segref);
+        gchar* native_text = status_object_to_string(self, jni_env, text);
+
+        gint numeric_code = native_code != NULL ? (gint)g_ascii_strtoll(native_code, NULL, 10) : 0;
+        if (numeric_code <= 0)
+            numeric_code = GHBCI_ERROR_FAILED;
+        ghbci_set_error(error, numeric_code, native_segref, ghbci_error_retry_hint_for_code(numeric_code),
+                "%s", native_text != NULL ? native_text : "job failed");
+        found = TRUE;
+
+        g_free(native_code);
+        g_free(native_segref);
+        g_free(native_text);
+        if (code != NULL)
+            (*jni_env)->DeleteLocalRef(jni_env, code);
+        if (segref != NULL)
+            (*jni_env)->DeleteLocalRef(jni_env, segref);
+        if (text != NULL)
+            (*jni_env)->DeleteLocalRef(jni_env, text);
+        (*jni_env)->DeleteLocalRef(jni_env, retval);
+    }
+    (*jni_env)->DeleteLocalRef(jni_env, errors);
+
+    return found;
+}
+
+/*
+ * Convert the first exception hbci4java caught while executing the queue
+ *
+ * Returns TRUE if the status contained an exception
+ */
+static gboolean
+exec_status_to_error(GHbciContext* self, JNIEnv* jni_env, jobject exec_status, GError** error) {
+    GHbciContextPrivate* priv = self->priv;
+    gboolean found = FALSE;
+
+    jobject customer_ids = (*jni_env)->CallObjectMethod(jni_env, exec_status, priv->method_HBCIExecStatus_getCustomerIds);
+    if (customer_ids == NULL) {
+        (*jni_env)->ExceptionClear(jni_env);
+        return FALSE;
+    }
+    jobject ids_iter = (*jni_env)->CallObjectMethod(jni_env, customer_ids, priv->method_List_iterator);
+
+    while (!found && (*jni_env)->CallBooleanMethod(jni_env, ids_iter, priv->method_Iterator_hasNext)) {
+        jobject id = (*jni_env)->CallObjectMethod(jni_env, ids_iter, priv->method_Iterator_next);
+        jobject exceptions = (*jni_env)->CallObjectMethod(jni_env, exec_status, priv->method_HBCIExecStatus_getExceptions, id);
+        if (exceptions != NULL) {
+            jobject exceptions_iter = (*jni_env)->CallObjectMethod(jni_env, exceptions, priv->method_List_iterator);
+            if ((*jni_env)->CallBooleanMethod(jni_env, exceptions_iter, priv->method_Iterator_hasNext)) {
+                jthrowable exception = (*jni_env)->CallObjectMethod(jni_env, exceptions_iter, priv->method_Iterator_next);
+                exception_to_error(self, jni_env, exception, error);
+                (*jni_env)->DeleteLocalRef(jni_env, exception);
+                found = TRUE;
+            }
+            (*jni_env)->DeleteLocalRef(jni_env, exceptions_iter);
+            (*jni_env)->DeleteLocalRef(jni_env, exceptions);
+        }
+        if (id != NULL)
+            (*jni_env)->DeleteLocalRef(jni_env, id);
+    }
+    (*jni_env)->DeleteLocalRef(jni_env, ids_iter);
+    (*jni_env)->DeleteLocalRef(jni_env, customer_ids);
+
+    return found;
+}
+
+/*
+ * Check whether an executed job succeeded, otherwise find the reason: the
+ * return values of the bank for the job or the whole message, then
+ * exceptions caught by hbci4java
+ */
+static gboolean
+check_job_result(GHbciContext* self, JNIEnv* jni_env, jobject job, jobject exec_status, GError** error) {
+    GHbciContextPrivate* priv = self->priv;
+    gboolean found = FALSE;
+
+    jobject result = (*jni_env)->CallObjectMethod(jni_env, job, priv->method_HBCIJob_getJobResult);
+    if (result == NULL) {
+        set_error_from_exception(self, jni_env, error);
+        return FALSE;
+    }
+
+    if ((*jni_env)->CallBooleanMethod(jni_env, result, priv->method_HBCIJobResultImpl_isOK)) {
+        (*jni_env)->DeleteLocalRef(jni_env, result);
+        return TRUE;
+    }
+
+    jobject job_status = (*jni_env)->CallObjectMethod(jni_env, result, priv->method_HBCIJobResult_getJobStatus);
+    jobject glob_status = (*jni_env)->CallObjectMethod(jni_env, result, priv->method_HBCIJobResult_getGlobStatus);
+    found = status_to_error(self, jni_env, job_status, error)
+         || status_to_error(self, jni_env, glob_status, error)
+         || exec_status_to_error(self, jni_env, exec_status, error);
+    if (job_status != NULL)
+        (*jni_env)->DeleteLocalRef(jni_env, job_status);
+    if (glob_status != NULL)
+        (*jni_env)->DeleteLocalRef(jni_env, glob_status);
+    (*jni_env)->DeleteLocalRef(jni_env, result);
+
+    if (!found) {
+        jstring text = (*jni_env)->CallObjectMethod(jni_env, exec_status, priv->method_HBCIExecStatus_getErrorString);
+        gchar* message = status_object_to_string(self, jni_env, text);
+        ghbci_set_error(error, GHBCI_ERROR_FAILED, NULL, GHBCI_RETRY_HINT_NEVER,
+                "%s", message != NULL && message[0] != '\0' ? message : "job failed");
+        g_free(message);
+        if (text != NULL)
+            (*jni_env)->DeleteLocalRef(jni_env, text);
+    }
+
+    return FALSE;
+}
+
+/*
+ * Parameter of a job, index >= 0 sets the index-th value of jobs with
+ * several, like the recipients of a MultiUebSEPA
+ */
+typedef struct
+{
+    GHbciJavaString name;
+    gint index;
+    const gchar* value;
+} JobParam;
+
+/*
+ * Parameters of a job, the values point to the strings of the caller
+ */
+typedef struct
+{
+    gchar country[3];
+    GArray* params;
+} JobParams;
+
+static void
+job_params_init (JobParams* params)
+{
+    params->country[0] = '\0';
+    params->params = g_array_sized_new(FALSE, FALSE, sizeof(JobParam), JOB_PARAMS);
+}
+
+static void
+job_params_clear (JobParams* params)
+{
+    g_array_free(params->params, TRUE);
+    params->params = NULL;
+}
+
+/*
+ * Add a parameter, parameters without value are left out
+ */
+static void
+job_params_add_indexed (JobParams* params, GHbciJavaString name, gint index, const gchar* value)
+{
+    JobParam param = { name, index, value };
+
+    if (value != NULL)
+        g_array_append_val(params->params, param);
+}
+
+static void
+job_params_add (JobParams* params, GHbciJavaString name, const gchar* value)
+{
+    job_params_add_indexed(params, name, -1, value);
+}
+
+/*
+ * Add the parameters of the account a job is for. Its country is the one
+ * of its IBAN, known once ghbci_context_get_accounts() listed it, else DE.
+ */
+static void
+job_params_add_account (JobParams* params, GHbciContext* self, JNIEnv* jni_env, const gchar* blz,
+        const gchar* userid, const gchar* number)
+{
+    jobject account = get_account(self, jni_env, blz, userid, number);
+    jstring iban = account != NULL ? (*jni_env)->GetObjectField(jni_env, account, self->priv->field_Konto_iban) : NULL;
+    gchar code[8] = "";
+
+    if (account != NULL)
+        (*jni_env)->DeleteLocalRef(jni_env, account);
+
+    if (iban != NULL) {
+        if ((*jni_env)->GetStringLength(jni_env, iban) >= 2)
+            (*jni_env)->GetStringUTFRegion(jni_env, iban, 0, 2, code);
+        (*jni_env)->DeleteLocalRef(jni_env, iban);
+    }
+    if (g_ascii_isalpha(code[0]) && g_ascii_isalpha(code[1])) {
+        params->country[0] = code[0];
+        params->country[1] = code[1];
+        params->country[2] = '\0';
+    } else {
+        g_strlcpy(params->country, "DE", sizeof(params->country));
+    }
+    job_params_add(params, GHBCI_JAVA_STRING_MY_COUNTRY, params->country);
+    job_params_add(params, GHBCI_JAVA_STRING_MY_BLZ, blz);
+    job_params_add(params, GHBCI_JAVA_STRING_MY_NUMBER, number);
+}
+
+/*
+ * Add the parameters of the payer's account, source_iban must be valid
+ */
+static void
+job_params_add_source (JobParams* params, const gchar* blz, const gchar* number, const gchar* source_name,
+        const gchar* source_bic, const gchar* source_iban)
+{
+    // the country of the bank code is the one of the IBAN
+    g_strlcpy(params->country, source_iban, sizeof(params->country));
+    job_params_add(params, GHBCI_JAVA_STRING_SRC_COUNTRY, params->country);
+    job_params_add(params, GHBCI_JAVA_STRING_SRC_BLZ, blz);
+    job_params_add(params, GHBCI_JAVA_STRING_SRC_NUMBER, number);
+    job_params_add(params, GHBCI_JAVA_STRING_SRC_NAME, source_name);
+    job_params_add(params, GHBCI_JAVA_STRING_SRC_IBAN, source_iban);
+    if (source_bic != NULL && *source_bic != '\0')
+        job_params_add(params, GHBCI_JAVA_STRING_SRC_BIC, source_bic);
+}
+
+/*
+ * Add the parameters of a transfer, as index-th recipient if index >= 0
+ */
+static void
+job_params_add_transfer (JobParams* params, const GHbciTransfer* transfer, gint index)
+{
+    job_params_add_indexed(params, GHBCI_JAVA_STRING_DST_NAME, index, transfer->name);
+    job_params_add_indexed(params, GHBCI_JAVA_STRING_DST_IBAN, index, transfer->iban);
+    if (transfer->bic != NULL && *transfer->bic != '\0')
+        job_params_add_indexed(params, GHBCI_JAVA_STRING_DST_BIC, index, transfer->bic);
+    job_params_add_indexed(params, GHBCI_JAVA_STRING_BTG_VALUE, index, transfer->amount);
+    job_params_add_indexed(params, GHBCI_JAVA_STRING_BTG_CURR, index, SEPA_CURRENCY);
+    if (transfer->reference != NULL && *transfer->reference != '\0')
+        job_params_add_indexed(params, GHBCI_JAVA_STRING_USAGE, index, transfer->reference);
+    job_params_add_indexed(params, GHBCI_JAVA_STRING_END_TO_END_ID, index, transfer->end_to_end_id);
+}
+
+/*
+ * Set one parameter of a job
+ *
+ * Returns FALSE if hbci4java rejected the value, the exception is pending
+ */
+static gboolean
+set_job_param (GHbciContext* self, JNIEnv* jni_env, jobject job, const JobParam* param)
+{
+    GHbciContextPrivate* priv = self->priv;
+    jstring key = priv->java_strings[param->name];
+
+    jstring java_value = (*jni_env)->NewStringUTF(jni_env, param->value);
+    if (java_value == NULL)
+        return FALSE;
+    if (param->index < 0) {
+        (*jni_env)->CallVoidMethod(jni_env, job, priv->method_HBCIJob_setParam, key, java_value);
+    } else {
+        jobject java_index = (*jni_env)->CallStaticObjectMethod(jni_env, priv->class_Integer, priv->method_Integer_valueOf, (jint)param->index);
+        (*jni_env)->CallVoidMethod(jni_env, job, priv->method_HBCIJob_setParamIndexed, key, java_index, java_value);
+        (*jni_env)->DeleteLocalRef(jni_env, java_index);
+    }
+    (*jni_env)->DeleteLocalRef(jni_env, java_value);
+    return !(*jni_env)->ExceptionCheck(jni_env);
+}
+
+/* separates the values passed to JobParams.set() */
+#define JOB_PARAMS_SEPARATOR '\x1f'
+
+/*
+ * Set all parameters of a job. With ghbci-helper.jar, JobParams.set() gets
+ * them in one call: the ids and indexes of all names as one int[], the
+ * names come from the constant strings it got in ghbci_context_new(), and
+ * the values joined into one string. Without it, or if a value contains
+ * the separator, they are set one by one.
+ *
+ * Returns FALSE if hbci4java rejected a value, the exception is pending
+ */
+static gboolean
+apply_job_params (GHbciContext* self, JNIEnv* jni_env, jobject job, const JobParams* params)
+{
+    GHbciContextPrivate* priv = self->priv;
+    jsize length = params->params->len;
+    gboolean packed = priv->class_JobParams != NULL;
+    GString* values;
+    jsize i;
+
+    for (i = 0; packed && i < length; i++)
+        packed = strchr(g_array_index(params->params, JobParam, i).value, JOB_PARAMS_SEPARATOR) == NULL;
+    if (!packed) {
+        for (i = 0; i < length; i++) {
+            if (!set_job_param(self, jni_env, job, &g_array_index(params->params, JobParam, i)))
+                return FALSE;
+        }
+        return TRUE;
+    }
+
+    jint* native_params = g_new(jint, 2 * length + 1);
+    values = g_string_sized_new(64 * length);
+    for (i = 0; i < length; i++) {
+        const JobParam* param = &g_array_index(params->params, JobParam, i);
+        native_params[2 * i] = param->name;
+        native_params[2 * i + 1] = param->index;
+        if (i > 0)
+            g_string_append_c(values, JOB_PARAMS_SEPARATOR);
+        g_string_append(values, param->value);
+    }
+
+    jintArray java_params = (*jni_env)->NewIntArray(jni_env, 2 * length);
+    jstring java_values = java_params != NULL ? (*jni_env)->NewStringUTF(jni_env, values->str) : NULL;
+    if (java_values != NULL) {
+        (*jni_env)->SetIntArrayRegion(jni_env, java_params, 0, 2 * length, native_params);
+        (*jni_env)->CallStaticVoidMethod(jni_env, priv->class_JobParams, priv->method_JobParams_set,
+                job, java_params, java_values);
+        (*jni_env)->DeleteLocalRef(jni_env, java_values);
+    }
+    if (java_params != NULL)
+        (*jni_env)->DeleteLocalRef(jni_env, java_params);
+    g_string_free(values, TRUE);
+    g_free(native_params);
+    return !(*jni_env)->ExceptionCheck(jni_env);
+}
+
+/*
+ * Execute the job queue of a handler in one dialog, paced by the rate
+ * limiter of the bank
+ *
+ * Returns local reference to the HBCIExecStatus or NULL with pending exception
+ */
+static jobject
+execute_queue(GHbciContext* self, JNIEnv* jni_env, jobject hbci_handler, const gchar* blz, const gchar* jobname,
+        const gchar* limit_key) {
+    GHbciContextPrivate* priv = self->priv;
+
+    ghbci_rate_limiter_acquire(priv->rate_limiter, limit_key);
+    ghbci_metrics_begin_operation(priv->metrics, blz, jobname);
+    gint64 start = g_get_monotonic_time();
+    jobject status = (*jni_env)->CallObjectMethod(jni_env, hbci_handler, priv->method_HBCIHandler_execute);
+    ghbci_metrics_record(priv->metrics, "execute", blz, jobname, g_get_monotonic_time() - start);
+    ghbci_metrics_end_operation(priv->metrics);
+    ghbci_rate_limiter_release(priv->rate_limiter, limit_key);
+    return status;
+}
+
+/*
+ * Create a job, set its parameters and execute it
+ *
+ * Execution is paced by the rate limiter of the bank. Failures of idempotent jobs with
+ * a retry hint are retried with jittered exponential backoff, each time with
+ * a fresh job. Jobs moving money must not be retried, the bank might have
+ * executed them before the connection broke.
+ *
+ * Returns local reference to the successfully executed job or NULL
+ */
+static jobject
+execute_job(GHbciContext* self, JNIEnv* jni_env, jobject hbci_handler, const gchar* blz, const gchar* userid,
+        GHbciJavaString jobname, const JobParams* params, gboolean idempotent, GError** error) {
+    GHbciContextPrivate* priv = self->priv;
+    jobject job = NULL;
+    CallbackScope scope;
+    guint attempt, max_attempts, base_delay, max_delay;
+
+    // one policy for all attempts, even if it changes meanwhile
+    g_mutex_lock(&priv->lock);
+    max_attempts = priv->retry_max_attempts;
+    base_delay = priv->retry_base_delay;
+    max_delay = priv->retry_max_delay;
+    g_mutex_unlock(&priv->lock);
+
+    gchar* limit_key = get_rate_limit_key(self, jni_env, blz);
+    gchar* passport_key = g_strconcat(blz, "+", userid, NULL);
+    callback_scope_push(&scope, blz, userid, passport_key, limit_key);
+
+    for (attempt = 0; ; attempt++) {
+        GError* attempt_error = NULL;
+
+        // start with an empty queue
+        (*jni_env)->CallVoidMethod(jni_env, hbci_handler, priv->method_HBCIHandler_reset);
+
+        // create HBCIJob
+        job = (*jni_env)->CallObjectMethod(jni_env, hbci_handler, priv->method_HBCIHandler_newJob,
+                priv->java_strings[jobname]);
+
+        if (job == NULL) {
+            set_error_from_exception(self, jni_env, error);
+            break;
+        }
+
+        // invalid values are rejected right away
+        if (apply_job_params(self, jni_env, job, params))
+            (*jni_env)->CallVoidMethod(jni_env, job, priv->method_HBCIJob_addToQueue);
+
+        if ((*jni_env)->ExceptionCheck(jni_env)) {
+            set_error_from_exception(self, jni_env, error);
+            (*jni_env)->DeleteLocalRef(jni_env, job);
+            job = NULL;
+            break;
+        }
+
+        jobject status = execute_queue(self, jni_env, hbci_handler, blz, java_string_text[jobname], limit_key);
+
+        if (status == NULL) {
+            set_error_from_exception(self, jni_env, &attempt_error);
+        } else {
+            check_job_result(self, jni_env, job, status, &attempt_error);
+            (*jni_env)->DeleteLocalRef(jni_env, status);
+        }
+
+        if (attempt_error == NULL)
+            break;
+
+        (*jni_env)->DeleteLocalRef(jni_env, job);
+        job = NULL;
+
+        if (ghbci_error_get_retry_hint(attempt_error) != GHBCI_RETRY_HINT_RETRY || !idempotent
+                || attempt + 1 >= max_attempts) {
+            g_propagate_error(error, attempt_error);
+            break;
+        }
+
+        // back off with jitter, so retries of parallel syncs spread out
+        gint64 delay = (gint64)base_delay << MIN(attempt, 16);
+        delay = MIN(delay, max_delay);
+        delay = delay / 2 + g_random_int_range(0, delay / 2 + 1);
+        g_debug("job %s failed temporarily (%s), retry in %" G_GINT64_FORMAT " ms",
+                java_string_text[jobname], attempt_error->message, delay);
+        g_error_free(attempt_error);
+        ghbci_rate_limiter_penalize(priv->rate_limiter, limit_key, delay * 1000);
+    }
+
+    callback_scope_pop(&scope);
+    g_free(passport_key);
+    g_free(limit_key);
+    return job;
+}
+
+
+/*
+ * Schema of pain.001.003.03 bundled with hbci4java, compiled on first use
+ *
+ * Returns global reference owned by the context or NULL
+ */
+static jobject
+get_pain001_schema (GHbciContext* self, JNIEnv* jni_env, GError** error)
+{
+    GHbciContextPrivate* priv = self->priv;
+    jobject schema;
+
+    g_mutex_lock(&priv->lock);
+    if (priv->pain001_schema == NULL) {
+        jstring language = (*jni_env)->NewStringUTF(jni_env, "http://www.w3.org/2001/XMLSchema");
+        jstring name = (*jni_env)->NewStringUTF(jni_env, PAIN001_SCHEMA);
+        jobject factory = (*jni_env)->CallStaticObjectMethod(jni_env, priv->class_SchemaFactory,
+                priv->method_SchemaFactory_newInstance, language);
+        jobject url = (*jni_env)->CallObjectMethod(jni_env, priv->class_HBCIUtils, priv->method_Class_getResource, name);
+        jobject local_schema = NULL;
+
+        if (factory != NULL && url != NULL)
+            local_schema = (*jni_env)->CallObjectMethod(jni_env, factory, priv->method_SchemaFactory_newSchema, url);
+
+        if (local_schema != NULL) {
+            priv->pain001_schema = (*jni_env)->NewGlobalRef(jni_env, local_schema);
+            (*jni_env)->DeleteLocalRef(jni_env, local_schema);
+        } else if ((*jni_env)->ExceptionCheck(jni_env)) {
+            set_error_from_exception(self, jni_env, error);
+        } else {
+            ghbci_set_error(error, GHBCI_ERROR_NOT_SUPPORTED, NULL, GHBCI_RETRY_HINT_NEVER,
+                    "%s not found in hbci4java", PAIN001_SCHEMA);
+        }
+        if (url != NULL)
+            (*jni_env)->DeleteLocalRef(jni_env, url);
+        if (factory != NULL)
+            (*jni_env)->DeleteLocalRef(jni_env, factory);
+        (*jni_env)->DeleteLocalRef(jni_env, name);
+        (*jni_env)->DeleteLocalRef(jni_env, language);
+    }
+    schema = priv->pain001_schema;
+    g_mutex_unlock(&priv->lock);
+    return schema;
+}
+
+/*
+ * Validate a pain.001.003.03 document with the schema of hbci4java
+ */
+static gboolean
+validate_pain001 (GHbciContext* self, JNIEnv* jni_env, gconstpointer data, gsize size, GError** error)
+{
+    GHbciContextPrivate* priv = self->priv;
+
+    jobject schema = get_pain001_schema(self, jni_env, error);
+    if (schema == NULL)
+        return FALSE;
+
+    jbyteArray bytes = (*jni_env)->NewByteArray(jni_env, size);
+    if (bytes == NULL) {
+        set_error_from_exception(self, jni_env, error);
+        return FALSE;
+    }
+    (*jni_env)->SetByteArrayRegion(jni_env, bytes, 0, size, data);
+    jobject input = (*jni_env)->NewObject(jni_env, priv->class_ByteArrayInputStream,
+            priv->method_ByteArrayInputStream_constructor, bytes);
+    jobject source = (*jni_env)->NewObject(jni_env, priv->class_StreamSource, priv->method_StreamSource_constructor, input);
+    // validators aren't thread safe, the schema is
+    jobject validator = (*jni_env)->CallObjectMethod(jni_env, schema, priv->method_Schema_newValidator);
+    if (validator != NULL)
+        (*jni_env)->CallVoidMethod(jni_env, validator, priv->method_Validator_validate, source);
+
+    gboolean valid = !(*jni_env)->ExceptionCheck(jni_env);
+    if (!valid) {
+        GError* validation_error = NULL;
+        set_error_from_exception(self, jni_env, &validation_error);
+        ghbci_set_error(error, GHBCI_ERROR_INVALID_DATA, NULL, GHBCI_RETRY_HINT_NEVER,
+                "pain.001 document invalid: %s", validation_error->message);
+        g_error_free(validation_error);
+    }
+
+    if (validator != NULL)
+        (*jni_env)->DeleteLocalRef(jni_env, validator);
+    (*jni_env)->DeleteLocalRef(jni_env, source);
+    (*jni_env)->DeleteLocalRef(jni_env, input);
+    (*jni_env)->DeleteLocalRef(jni_env, bytes);
+    return valid;
+}
+
+/*
+ * Append text up to the end of the line or, for keys, the separator,
+ * resolving the escapes of java.util.Properties.store()
+ */
+static const gchar*
+unescape_property (const gchar* p, GString* out, gboolean key)
+{
+    while (*p != '\0' && *p != '\n' && *p != '\r') {
+        if (key && (*p == '=' || *p == ':' || *p == ' ' || *p == '\t' || *p == '\f'))
+            break;
+        if (*p != '\\') {
+            g_string_append_c(out, *p++);
+            continue;
+        }
+        p++;
+        switch (*p) {
+        case 't': g_string_append_c(out, '\t'); p++; break;
+        case 'n': g_string_append_c(out, '\n'); p++; break;
+        case 'r': g_string_append_c(out, '\r'); p++; break;
+        case 'f': g_string_append_c(out, '\f'); p++; break;
+        case 'u':
+            if (g_ascii_isxdigit(p[1]) && g_ascii_isxdigit(p[2]) && g_ascii_isxdigit(p[3]) && g_ascii_isxdigit(p[4])) {
+                g_string_append_unichar(out, g_ascii_xdigit_value(p[1]) << 12 | g_ascii_xdigit_value(p[2]) << 8
+                        | g_ascii_xdigit_value(p[3]) << 4 | g_ascii_xdigit_value(p[4]));
+                p += 5;
+            } else {
+                g_string_append_c(out, *p++);
+            }
+            break;
+        case '\0':
+            break;
+        default:
+            g_string_append_c(out, *p++);
+        }
+    }
+    return p;
+}
+
+/*
+ * Parse the output of java.util.Properties.store(), which writes one
+ * entry per line
+ */
+static GHashTable*
+parse_properties (const gchar* text)
+{
+    GHashTable* table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    const gchar* p = text;
+
+    while (*p != '\0') {
+        while (*p == ' ' || *p == '\t' || *p == '\f')
+            p++;
+        if (*p == '#' || *p == '!') {
+            while (*p != '\0' && *p != '\n')
+                p++;
+            continue;
+        }
+        if (*p == '\n' || *p == '\r') {
+            p++;
+            continue;
+        }
+
+        GString* key = g_string_new(NULL);
+        GString* value = g_string_new(NULL);
+        p = unescape_property(p, key, TRUE);
+        while (*p == ' ' || *p == '\t' || *p == '\f')
+            p++;
+        if (*p == '=' || *p == ':')
+            p++;
+        while (*p == ' ' || *p == '\t' || *p == '\f')
+            p++;
+        p = unescape_property(p, value, FALSE);
+        g_hash_table_replace(table, g_string_free(key, FALSE), g_string_free(value, FALSE));
+    }
+    return table;
+}
+
+/*
+ * Queue transfers as one collective transfer, or a single transfer as UebSEPA
+ *
+ * Returns local reference to the queued job or NULL with pending exception
+ */
+static jobject
+queue_transfer_job (GHbciContext* self, JNIEnv* jni_env, jobject hbci_handler, gboolean collective,
+        const JobParams* source, const gchar* message_id, const GHbciTransfer* transfers, guint n_transfers)
+{
+    GHbciContextPrivate* priv = self->priv;
+    JobParams params;
+    guint i;
+
+    jobject job = (*jni_env)->CallObjectMethod(jni_env, hbci_handler, priv->method_HBCIHandler_newJob,
+            priv->java_strings[collective ? GHBCI_JAVA_STRING_JOB_MULTI_UEB_SEPA : GHBCI_JAVA_STRING_JOB_UEB_SEPA]);
+    if (job == NULL)
+        return NULL;
+
+    job_params_init(&params);
+    job_params_add(&params, GHBCI_JAVA_STRING_SEPA_ID, message_id);
+    job_params_add(&params, GHBCI_JAVA_STRING_PMTINF_ID, message_id);
+    g_array_append_vals(params.params, source->params->data, source->params->len);
+
+    // the recipients of a collective transfer are indexed
+    for (i = 0; i < n_transfers; i++)
+        job_params_add_transfer(&params, &transfers[i], collective ? (gint)i : -1);
+
+    if (apply_job_params(self, jni_env, job, &params))
+        (*jni_env)->CallVoidMethod(jni_env, job, priv->method_HBCIJob_addToQueue);
+    job_params_clear(&params);
+    if ((*jni_env)->ExceptionCheck(jni_env)) {
+        (*jni_env)->DeleteLocalRef(jni_env, job);
+        return NULL;
+    }
+    return job;
+}
+
+/*
+ * Result data of a job as hash table, fetched in one piece and decoded
+ * natively instead of one JNI call per field
+ */
+static GHashTable*
+get_result_data (GHbciContext* self, JNIEnv* jni_env, jobject job, GError** error)
+{
+    GHbciContextPrivate* priv = self->priv;
+    GHashTable* data = NULL;
+
+    jobject result = (*jni_env)->CallObjectMethod(jni_env, job, priv->method_HBCIJob_getJobResult);
+    if (result == NULL) {
+        set_error_from_exception(self, jni_env, error);
+        return NULL;
+    }
+    jobject properties = (*jni_env)->CallObjectMethod(jni_env, result, priv->method_HBCIJobResultImpl_getResultData);
+    jobject writer = (*jni_env)->NewObject(jni_env, priv->class_StringWriter, priv->method_StringWriter_constructor);
+    if (properties != NULL && writer != NULL)
+        (*jni_env)->CallVoidMethod(jni_env, properties, priv->method_Properties_store, writer, NULL);
+
+    jstring text = NULL;
+    if (properties != NULL && writer != NULL && !(*jni_env)->ExceptionCheck(jni_env))
+        text = (*jni_env)->CallObjectMethod(jni_env, writer, priv->method_StringWriter_toString);
+
+    if (text != NULL) {
+        const gchar* native_text = (*jni_env)->GetStringUTFChars(jni_env, text, NULL);
+        data = parse_properties(native_text);
+        (*jni_env)->ReleaseStringUTFChars(jni_env, text, native_text);
+        (*jni_env)->DeleteLocalRef(jni_env, text);
+    } else {
+        set_error_from_exception(self, jni_env, error);
+    }
+
+    if (writer != NULL)
+        (*jni_env)->DeleteLocalRef(jni_env, writer);
+    if (properties != NULL)
+        (*jni_env)->DeleteLocalRef(jni_env, properties);
+    (*jni_env)->DeleteLocalRef(jni_env, result);
+    return data;
+}
+
+/*
+ * Id of the order the bank created for the job, NULL if unknown
+ */
+static gchar*
+get_order_id (GHbciContext* self, JNIEnv* jni_env, jobject job)
+{
+    GError* error = NULL;
+    gchar* order_id = NULL;
+
+    GHashTable* data = get_result_data(self, jni_env, job, &error);
+    if (data == NULL) {
+        // the order exists anyway
+        g_warning("could not read order id: %s", error->message);
+        g_error_free(error);
+        return NULL;
+    }
+    order_id = g_strdup(g_hash_table_lookup(data, "content.orderid"));
+    g_hash_table_unref(data);
+    return order_id;
+}
+
+
+/*
+ * Prepend to a list in reverse order
+ */
+static void
+prepend_statement (GHbciStatement* statement, gpointer user_data)
+{
+    GSList** statements = user_data;
+
+    *statements = g_slist_prepend(*statements, statement);
+}
+
+/*
+ * Parse the MT940 data of a KUmsAll result natively. hbci4java parses it
+ * only when its statements are requested, so it is never parsed twice.
+ * The data is read from hbci4java's buffer in windows of chars, which are
+ * parsed as they arrive, instead of one JNI call per field or copies of
+ * all of it.
+ *
+ * Returns FALSE on error, without statements
+ */
+static gboolean
+parse_mt940 (GHbciContext* self, JNIEnv* jni_env, const gchar* blz, jobject result, GHbciStringPool* pool,
+        GSList** statements, GError** error)
+{
+    GHbciContextPrivate* priv = self->priv;
+    GHbciMt940Parser* parser = NULL;
+    GSList* parsed = NULL;
+    gboolean success = FALSE;
+    jchar chars[MT940_WINDOW_LENGTH];
+    gchar data[MT940_WINDOW_LENGTH];
+    gint64 parse_time = 0;
+    jint begin, n, i;
+
+    jobject buffer = (*jni_env)->GetObjectField(jni_env, result, priv->field_GVRKUms_bufferMT940);
+    jint length = buffer != NULL ? (*jni_env)->CallIntMethod(jni_env, buffer, priv->method_StringBuffer_length) : 0;
+    jcharArray window = buffer != NULL && !(*jni_env)->ExceptionCheck(jni_env)
+            ? (*jni_env)->NewCharArray(jni_env, MT940_WINDOW_LENGTH) : NULL;
+    if (window == NULL) {
+        set_error_from_exception(self, jni_env, error);
+        goto cleanup;
+    }
+
+    // copies of small windows, a critical section would hold up the garbage collector for the whole parse
+    parser = ghbci_mt940_parser_new(pool, prepend_statement, &parsed);
+    for (begin = 0; begin < length; begin += n) {
+        gint64 start;
+        gboolean valid;
+
+        n = MIN(length - begin, MT940_WINDOW_LENGTH);
+        (*jni_env)->CallVoidMethod(jni_env, buffer, priv->method_StringBuffer_getChars, begin, begin + n, window, 0);
+        if (!(*jni_env)->ExceptionCheck(jni_env))
+            (*jni_env)->GetCharArrayRegion(jni_env, window, 0, n, chars);
+        if ((*jni_env)->ExceptionCheck(jni_env)) {
+            set_error_from_exception(self, jni_env, error);
+            break;
+        }
+        // ISO 8859-1 like hbci4java reads it, other chars become '?' as in String.getBytes()
+        for (i = 0; i < n; i++)
+            data[i] = chars[i] <= 0xff ? (gchar)chars[i] : '?';
+        start = g_get_monotonic_time();
+        valid = ghbci_mt940_parser_feed(parser, data, n, error);
+        parse_time += g_get_monotonic_time() - start;
+        if (!valid)
+            break;
+    }
+    if (begin >= length) {
+        gint64 start = g_get_monotonic_time();
+        success = ghbci_mt940_parser_finish(parser, error);
+        parse_time += g_get_monotonic_time() - start;
+        ghbci_metrics_record(priv->metrics, "mt940", blz, java_string_text[GHBCI_JAVA_STRING_JOB_KUMS_ALL],
+                parse_time);
+    }
+    ghbci_mt940_parser_free(parser);
+    if (success)
+        *statements = g_slist_reverse(parsed);
+    else
+        g_slist_free_full(parsed, g_object_unref);
+
+cleanup:
+    if (window != NULL)
+        (*jni_env)->DeleteLocalRef(jni_env, window);
+    if (buffer != NULL)
+        (*jni_env)->DeleteLocalRef(jni_env, buffer);
+    return success;
+}
+
+/*
+ * Whether hbci4java runs in other processes, see
+ * ghbci_context_new_with_workers() and ghbci_context_new_for_daemon()
+ */
+static gboolean
+is_out_of_process (GHbciContext* self)
+{
+    return self->priv->workers != NULL || self->priv->daemon != NULL;
+}
+
+/*
+ * Run a request on the worker of the passport, or on any worker if blz is
+ * NULL, or on the daemon. A floating body is consumed. Fails if the reply
+ * isn't of reply_type.
+ */
+static GVariant*
+request_workers (GHbciContext* self, const gchar* blz, const gchar* userid, GHbciWorkerMessage kind,
+        GVariant* body, const GVariantType* reply_type, GError** error)
+{
+    GVariant* reply;
+
+    if (self->priv->daemon != NULL)
+        return ghbci_daemon_client_request(self->priv->daemon, blz, userid, kind, body, reply_type, error);
+
+    reply = ghbci_worker_pool_request(self->priv->workers, blz, userid, kind, body, error);
+
+    if (reply != NULL && !g_variant_is_of_type(reply, reply_type)) {
+        ghbci_set_error(error, GHBCI_ERROR_WORKER, NULL, GHBCI_RETRY_HINT_NEVER,
+                "unexpected reply of type %s from worker", g_variant_get_type_string(reply));
+        g_clear_pointer(&reply, g_variant_unref);
+    }
+    return reply;
+}
+
+/*
+ * Name and pin/tan url of a bank from a worker or the daemon, FALSE with a
+ * warning if the request fails
+ */
+static gboolean
+request_bank (GHbciContext* self, const gchar* blz, gchar** name, gchar** pin_tan_url)
+{
+    GError* error = NULL;
+    GVariant* reply = request_workers(self, NULL, NULL, GHBCI_WORKER_GET_BANK, g_variant_new_string(blz),
+            G_VARIANT_TYPE("(ss)"), &error);
+
+    if (reply == NULL) {
+        g_warning("looking up bank %s failed: %s", blz, error->message);
+        g_error_free(error);
+        return FALSE;
+    }
+    g_variant_get(reply, "(ss)", name, pin_tan_url);
+    g_variant_unref(reply);
+    return TRUE;
+}
+
+/* job run by worker processes or the daemon */
+typedef struct
+{
+    const gchar* blz;
+    const gchar* jobname;
+    gchar* limit_key;
+    gint64 start;
+} OutOfProcessJob;
+
+/*
+ * Pace and time a job run by worker processes or the daemon like one of
+ * the jvm in this process, in the rate limiter bucket of the bank's
+ * server. The relayed status events fill in its phases.
+ */
+static void
+out_of_process_job_begin (GHbciContext* self, OutOfProcessJob* job, const gchar* blz, const gchar* jobname)
+{
+    job->blz = blz;
+    job->jobname = jobname;
+    job->limit_key = get_rate_limit_key(self, NULL, blz);
+    ghbci_rate_limiter_acquire(self->priv->rate_limiter, job->limit_key);
+    ghbci_metrics_begin_operation(self->priv->metrics, blz, jobname);
+    job->start = g_get_monotonic_time();
+}
+
+static void
+out_of_process_job_end (GHbciContext* self, OutOfProcessJob* job)
+{
+    ghbci_metrics_record(self->priv->metrics, "execute", job->blz, job->jobname, g_get_monotonic_time() - job->start);
+    ghbci_metrics_end_operation(self->priv->metrics);
+    ghbci_rate_limiter_release(self->priv->rate_limiter, job->limit_key);
+    g_free(job->limit_key);
+}
+
+/*
+ * request_workers() for a job contacting the bank
+ */
+static GVariant*
+request_worker_job (GHbciContext* self, const gchar* blz, const gchar* userid, GHbciJavaString jobname,
+        GHbciWorkerMessage kind, GVariant* body, const GVariantType* reply_type, GError** error)
+{
+    OutOfProcessJob job;
+
+    out_of_process_job_begin(self, &job, blz, java_string_text[jobname]);
+    GVariant* reply = request_workers(self, blz, userid, kind, body, reply_type, error);
+    out_of_process_job_end(self, &job);
+    return reply;
+}
+
+/*
+ * The order id of a reply of a worker, FALSE if there is no reply
+ */
+static gboolean
+take_worker_order_id (GVariant* reply, gchar** order_id)
+{
+    if (reply == NULL)
+        return FALSE;
+    if (order_id != NULL)
+        g_variant_get(reply, "ms", order_id);
+    g_variant_unref(reply);
+    return TRUE;
+}
+
+/*
+ * Send a transfer by the worker of the passport, scheduled at date unless
+ * it is NULL
+ */
+static gboolean
+send_worker_transfer (GHbciContext* self, const gchar* blz, const gchar* userid, const gchar* number,
+        const gchar* source_name, const gchar* source_bic, const gchar* source_iban,
+        const GHbciTransfer* transfer, const GDate* date, gchar** order_id, GError** error)
+{
+    GVariant* reply = request_worker_job(self, blz, userid,
+            date != NULL ? GHBCI_JAVA_STRING_JOB_TERM_UEB_SEPA : GHBCI_JAVA_STRING_JOB_UEB_SEPA,
+            GHBCI_WORKER_SEND_TRANSFER,
+            g_variant_new("(ssssss@" GHBCI_WORKER_TRANSFER_TYPE "u)", blz, userid, number, source_name,
+                source_bic != NULL ? source_bic : "", source_iban, ghbci_worker_transfer_to_variant(transfer),
+                date != NULL ? g_date_get_julian(date) : 0),
+            G_VARIANT_TYPE("ms"), error);
+
+    return take_worker_order_id(reply, order_id);
+}
+
+/*
+ * Send a job made of one transfer, like UebSEPA, TermUebSEPA or DauerSEPANew.
+ * Such jobs move money and are never retried.
+ */
+static gboolean
+send_transfer_job (GHbciContext* self, const gchar* blz, const gchar* userid, GHbciJavaString jobname,
+        const JobParams* params, gchar** order_id, GError** error)
+{
+    JNIEnv* jni_env = ghbci_context_get_jni_env (self);
+
+    jobject hbci_handler = get_hbci_handler(self, jni_env, blz, userid);
+    if(hbci_handler == NULL) {
+        ghbci_set_error(error, GHBCI_ERROR_NO_PASSPORT, NULL, GHBCI_RETRY_HINT_NEVER,
+                "no passport added for %s/%s", blz, userid);
+        return FALSE;
+    }
+
+    // execute_job only returns jobs the bank accepted
+    jobject job = execute_job(self, jni_env, hbci_handler, blz, userid, jobname, params, FALSE, error);
+    (*jni_env)->DeleteLocalRef(jni_env, hbci_handler);
+    if (job == NULL)
+        return FALSE;
+
+    if (order_id != NULL)
+        *order_id = get_order_id(self, jni_env, job);
+    (*jni_env)->DeleteLocalRef(jni_env, job);
+    return TRUE;
+}
+
+
+/* public methods */
+
+/**
+ * ghbci_context_new: (constructor)
+ * @directory: temporary directory to save passports
+ *
+ * Sets up a new #GHbciContext object
+ *
+ * Returns: (transfer full): A New #GHbciContext
+ **/
+GHbciContext*
+ghbci_context_new (const gchar* directory)
+{
+    GHbciContext* context;
+    GHbciContextPrivate* priv;
+    JavaVMInitArgs vm_args;
+    JavaVMOption options[2];
+    JNINativeMethod methods[3];
+    jobject console;
+    guint i;
+
+    context = g_object_new (GHBCI_TYPE_CONTEXT, NULL);
+    priv = context->priv;
+
+    priv->hbci_handlers = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    priv->accounts      = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    priv->thread_groups = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    priv->passport_directory = g_strdup(directory);
+
+    // initialize java virtual machine
+    // Path to hbci4java.jar and the optional ghbci-helper.jar
+    options[0].optionString = "-Djava.class.path=" DATA_DIR "/hbci4java.jar:" DATA_DIR "/ghbci-helper.jar";
+    // dates of statements are midnights there, see ghbci_statement_pack_java_time()
+    options[1].optionString = "-Duser.timezone=Europe/Berlin";
+    vm_args.version = JNI_VERSION_1_6; //JDK version. This indicates version 1.6
+    vm_args.nOptions = G_N_ELEMENTS(options);
+    vm_args.options = options;
+    vm_args.ignoreUnrecognized = 0;
+
+    int ret = JNI_CreateJavaVM(&priv->jvm, (void**)&priv->jni_env, &vm_args);
+    if(ret < 0) {
+        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
+        return NULL;
+    }
+    // pure evil, save context object in reserved field of jni environment struct,
+    // so it can be accessed from native callback functions (the function table
+    // is shared by the environments of all attached threads)
+    (*(struct JNINativeInterface_**)priv->jni_env)->reserved3 = context;
+
+    // save references to java classes and methods
+#define defineJavaClass(class, path) \
+    priv->class_##class = (*priv->jni_env)->FindClass(priv->jni_env, path);\
+    if (priv->class_##class == NULL) { \
+        (*priv->jni_env)->ExceptionDescribe(priv->jni_env); \
+        return NULL; \
+    }
+
+    defineJavaClass(Konto, "org/kapott/hbci/structures/Konto")
+    defineJavaClass(Saldo, "Lorg/kapott/hbci/structures/Saldo;")
+    defineJavaClass(Value, "Lorg/kapott/hbci/structures/Value;")
+    defineJavaClass(AbortException, "org/kapott/hbci/exceptions/AbortedException")
+    defineJavaClass(HBCIUtilsInternal, "org/kapott/hbci/manager/HBCIUtilsInternal")
+    defineJavaClass(HBCIUtils, "org/kapott/hbci/manager/HBCIUtils")
+    defineJavaClass(HBCICallbackConsole, "org/kapott/hbci/callback/HBCICallbackConsole")
+    defineJavaClass(HBCICallbackNative, "org/kapott/hbci/callback/HBCICallbackNative")
+    defineJavaClass(HBCIHandler, "org/kapott/hbci/manager/HBCIHandler")
+    defineJavaClass(HBCIJob, "org/kapott/hbci/GV/HBCIJob")
+    defineJavaClass(HBCIJobResult, "org/kapott/hbci/GV_Result/HBCIJobResult")
+    defineJavaClass(HBCIStatus, "org/kapott/hbci/status/HBCIStatus")
+    defineJavaClass(HBCIExecStatus, "org/kapott/hbci/status/HBCIExecStatus")
+    defineJavaClass(HBCIPassport, "org/kapott/hbci/passport/HBCIPassport")
+    defineJavaClass(AbstractHBCIPassport, "org/kapott/hbci/passport/AbstractHBCIPassport")
+    defineJavaClass(AbstractPinTanPassport, "org/kapott/hbci/passport/AbstractPinTanPassport")
+    defineJavaClass(HBCIJobResultImpl, "org/kapott/hbci/GV_Result/HBCIJobResultImpl")
+    defineJavaClass(GVRSaldoReq, "org/kapott/hbci/GV_Result/GVRSaldoReq")
+    defineJavaClass(GVRSaldoReqInfo, "org/kapott/hbci/GV_Result/GVRSaldoReq$Info")
+    defineJavaClass(GVRKUms, "org/kapott/hbci/GV_Result/GVRKUms")
+    defineJavaClass(GVRKUmsUmsLine, "org/kapott/hbci/GV_Result/GVRKUms$UmsLine")
+    defineJavaClass(Hashtable, "java/util/Hashtable")
+    defineJavaClass(Properties, "java/util/Properties")
+    defineJavaClass(Enumeration, "java/util/Enumeration")
+    defineJavaClass(Iterator, "java/util/Iterator")
+    defineJavaClass(List, "java/util/List")
+    defineJavaClass(StringBuffer, "java/lang/StringBuffer")
+    defineJavaClass(Date, "java/util/Date")
+    defineJavaClass(ThreadGroup, "java/lang/ThreadGroup")
+    defineJavaClass(Throwable, "java/lang/Throwable")
+    defineJavaClass(IOException, "java/io/IOException")
+    defineJavaClass(HBCIRetVal, "org/kapott/hbci/status/HBCIRetVal")
+    defineJavaClass(String, "java/lang/String")
+    defineJavaClass(Integer, "java/lang/Integer")
+    defineJavaClass(Class, "java/lang/Class")
+    defineJavaClass(SchemaFactory, "javax/xml/validation/SchemaFactory")
+    defineJavaClass(Schema, "javax/xml/validation/Schema")
+    defineJavaClass(Validator, "javax/xml/validation/Validator")
+    defineJavaClass(StreamSource, "javax/xml/transform/stream/StreamSource")
+    defineJavaClass(ByteArrayInputStream, "java/io/ByteArrayInputStream")
+    defineJavaClass(StringWriter, "java/io/StringWriter")
+
+#define defineJavaStaticMethod(class, method, signatur) \
+    priv->method_##class##_##method = (*priv->jni_env)->GetStaticMethodID(priv->jni_env, priv->class_##class, #method, signatur); \
+    if (priv->method_##class##_##method == NULL) { \
+        (*priv->jni_env)->ExceptionDescribe(priv->jni_env); \
+        return NULL; \
+    }
+
+    defineJavaStaticMethod(HBCIUtils, getNameForBLZ, "(Ljava/lang/String;)Ljava/lang/String;")
+    defineJavaStaticMethod(HBCIUtils, getPinTanURLForBLZ, "(Ljava/lang/String;)Ljava/lang/String;")
+    defineJavaStaticMethod(HBCIUtils, init, "(Ljava/util/Properties;Lorg/kapott/hbci/callback/HBCICallback;)V")
+    defineJavaStaticMethod(HBCIUtils, initThread, "(Ljava/util/Properties;Lorg/kapott/hbci/callback/HBCICallback;)V")
+    defineJavaStaticMethod(HBCIUtils, setParam, "(Ljava/lang/String;Ljava/lang/String;)V")
+    defineJavaStaticMethod(AbstractHBCIPassport, getInstance, "(Ljava/lang/String;)Lorg/kapott/hbci/passport/HBCIPassport;")
+    defineJavaStaticMethod(Integer, valueOf, "(I)Ljava/lang/Integer;")
+    defineJavaStaticMethod(SchemaFactory, newInstance, "(Ljava/lang/String;)Ljavax/xml/validation/SchemaFactory;")
+
+    // ghbci-helper.jar is installed with ghbci, without it job parameters are set one by one
+    priv->class_JobParams = (*priv->jni_env)->FindClass(priv->jni_env, "org/ghbci/JobParams");
+    if (priv->class_JobParams != NULL) {
+        defineJavaStaticMethod(JobParams, init, "([Ljava/lang/String;)V")
+        defineJavaStaticMethod(JobParams, set, "(Lorg/kapott/hbci/GV/HBCIJob;[ILjava/lang/String;)V")
+    } else {
+        (*priv->jni_env)->ExceptionClear(priv->jni_env);
+        g_warning("%s not found, setting job parameters one by one", DATA_DIR "/ghbci-helper.jar");
+    }
+
+#define defineJavaMethod(class, method, signatur) \
+    priv->method_##class##_##method = (*priv->jni_env)->GetMethodID(priv->jni_env, priv->class_##class, #method, signatur); \
+    if (priv->method_##class##_##method == NULL) { \
+        (*priv->jni_env)->ExceptionDescribe(priv->jni_env); \
+        return NULL; \
+    }
+#define defineJavaOverloadedMethod(class, method, variant, signatur) \
+    priv->method_##class##_##method##variant = (*priv->jni_env)->GetMethodID(priv->jni_env, priv->class_##class, #method, signatur); \
+    if (priv->method_##class##_##method##variant == NULL) { \
+        (*priv->jni_env)->ExceptionDescribe(priv->jni_env); \
+        return NULL; \
+    }
+    defineJavaMethod(HBCIHandler, newJob, "(Ljava/lang/String;)Lorg/kapott/hbci/GV/HBCIJob;")
+    defineJavaMethod(HBCIHandler, execute, "()Lorg/kapott/hbci/status/HBCIExecStatus;")
+    defineJavaMethod(HBCIHandler, getPassport, "()Lorg/kapott/hbci/passport/HBCIPassport;")
+    defineJavaMethod(HBCIHandler, reset, "()V")
+    defineJavaMethod(HBCIHandler, getSupportedLowlevelJobs, "()Ljava/util/Properties;")
+    defineJavaMethod(HBCIHandler, getLowlevelJobRestrictions, "(Ljava/lang/String;)Ljava/util/Properties;")
+    defineJavaMethod(HBCIHandler, getHBCIVersion, "()Ljava/lang/String;")
+    defineJavaMethod(HBCIJob, setParam, "(Ljava/lang/String;Ljava/lang/String;)V")
+    defineJavaOverloadedMethod(HBCIJob, setParam, Indexed, "(Ljava/lang/String;Ljava/lang/Integer;Ljava/lang/String;)V")
+    defineJavaMethod(HBCIJob, addToQueue, "()V")
+    defineJavaMethod(HBCIJob, getJobResult, "()Lorg/kapott/hbci/GV_Result/HBCIJobResult;")
+    defineJavaMethod(HBCIJob, getName, "()Ljava/lang/String;")
+    defineJavaMethod(HBCIJobResult, getJobStatus, "()Lorg/kapott/hbci/status/HBCIStatus;")
+    defineJavaMethod(HBCIJobResult, getGlobStatus, "()Lorg/kapott/hbci/status/HBCIStatus;")
+    defineJavaMethod(HBCIStatus, getErrorString, "()Ljava/lang/String;")
+    defineJavaMethod(HBCIStatus, getErrors, "()[Lorg/kapott/hbci/status/HBCIRetVal;")
+    defineJavaMethod(Throwable, getCause, "()Ljava/lang/Throwable;")
+    defineJavaMethod(Throwable, toString, "()Ljava/lang/String;")
+    defineJavaMethod(HBCIExecStatus, getCustomerIds, "()Ljava/util/List;")
+    defineJavaMethod(HBCIExecStatus, getExceptions, "(Ljava/lang/String;)Ljava/util/List;")
+    defineJavaMethod(HBCIExecStatus, getErrorString, "()Ljava/lang/String;")
+    defineJavaMethod(HBCIPassport, getAccounts, "()[Lorg/kapott/hbci/structures/Konto;")
+    defineJavaMethod(HBCIPassport, getBPDVersion, "()Ljava/lang/String;")
+    defineJavaMethod(HBCIPassport, getInstName, "()Ljava/lang/String;")
+    defineJavaMethod(HBCIPassport, getHost, "()Ljava/lang/String;")
+    defineJavaMethod(HBCIJobResultImpl, isOK, "()Z")
+    defineJavaMethod(HBCIJobResultImpl, getResultData, "()Ljava/util/Properties;")
+    defineJavaMethod(AbstractPinTanPassport, getTwostepMechanisms, "()Ljava/util/Hashtable;")
+    defineJavaMethod(AbstractPinTanPassport, getAllowedTwostepMechanisms, "()Ljava/util/List;")
+    defineJavaMethod(AbstractPinTanPassport, setCurrentTANMethod, "(Ljava/lang/String;)V")
+    defineJavaMethod(GVRSaldoReq, getEntries, "()[Lorg/kapott/hbci/GV_Result/GVRSaldoReq$Info;")
+    defineJavaMethod(GVRKUms, toString, "()Ljava/lang/String;")
+    defineJavaMethod(GVRKUms, getFlatData, "()Ljava/util/List;")
+    defineJavaMethod(Properties, keys, "()Ljava/util/Enumeration;")
+    defineJavaMethod(Properties, getProperty, "(Ljava/lang/String;)Ljava/lang/String;")
+    defineJavaMethod(Properties, store, "(Ljava/io/Writer;Ljava/lang/String;)V")
+    defineJavaMethod(Enumeration, hasMoreElements, "()Z")
+    defineJavaMethod(Enumeration, nextElement, "()Ljava/lang/Object;")
+    defineJavaMethod(Iterator, hasNext, "()Z")
+    defineJavaMethod(Iterator, next, "()Ljava/lang/Object;")
+    defineJavaMethod(List, iterator, "()Ljava/util/Iterator;")
+    defineJavaMethod(List, contains, "(Ljava/lang/Object;)Z")
+    defineJavaMethod(StringBuffer, replace, "(IILjava/lang/String;)Ljava/lang/StringBuffer;")
+    defineJavaMethod(StringBuffer, setLength, "(I)V")
+    defineJavaMethod(StringBuffer, toString, "()Ljava/lang/String;")
+    defineJavaMethod(StringBuffer, length, "()I")
+    defineJavaMethod(StringBuffer, getChars, "(II[CI)V")
+    defineJavaMethod(Hashtable, toString, "()Ljava/lang/String;")
+    defineJavaMethod(Hashtable, get, "(Ljava/lang/Object;)Ljava/lang/Object;")
+    defineJavaMethod(Value, toString, "()Ljava/lang/String;")
+    defineJavaMethod(Date, toString, "()Ljava/lang/String;")
+    defineJavaMethod(Date, getTime, "()J")
+    defineJavaMethod(Class, getResource, "(Ljava/lang/String;)Ljava/net/URL;")
+    defineJavaMethod(SchemaFactory, newSchema, "(Ljava/net/URL;)Ljavax/xml/validation/Schema;")
+    defineJavaMethod(Schema, newValidator, "()Ljavax/xml/validation/Validator;")
+    defineJavaMethod(Validator, validate, "(Ljavax/xml/transform/Source;)V")
+    defineJavaMethod(StringWriter, toString, "()Ljava/lang/String;")
+
+#define defineJavaConstructor(class, signatur) \
+    priv->method_##class##_constructor = (*priv->jni_env)->GetMethodID(priv->jni_env, priv->class_##class, "<init>", signatur); \
+    if (priv->method_##class##_constructor == NULL) { \
+        (*priv->jni_env)->ExceptionDescribe(priv->jni_env); \
+        return NULL; \
+    }
+    defineJavaConstructor(Konto, "()V")
+    defineJavaConstructor(StreamSource, "(Ljava/io/InputStream;)V")
+    defineJavaConstructor(ByteArrayInputStream, "([B)V")
+    defineJavaConstructor(StringWriter, "()V")
+    defineJavaConstructor(HBCIHandler, "(Ljava/lang/String;Lorg/kapott/hbci/passport/HBCIPassport;)V")
+    defineJavaConstructor(HBCICallbackConsole, "()V")
+    defineJavaConstructor(HBCICallbackNative, "()V")
+    defineJavaConstructor(ThreadGroup, "(Ljava/lang/String;)V")
+
+    // register native methods for callbacks
+    methods[0].name = "nativeLog";
+    methods[0].signature = "(Ljava/lang/String;ILjava/util/Date;Ljava/lang/StackTraceElement;)V";
+    methods[0].fnPtr = my_log;
+    methods[1].name = "nativeCallback";
+    methods[1].signature = "(Lorg/kapott/hbci/passport/HBCIPassport;ILjava/lang/String;ILjava/lang/StringBuffer;)V";
+    methods[1].fnPtr = my_callback;
+    methods[2].name = "nativeStatus";
+    methods[2].signature = "(Lorg/kapott/hbci/passport/HBCIPassport;I[Ljava/lang/Object;)V";
+    methods[2].fnPtr = my_status;
+    jint result = (*priv->jni_env)->RegisterNatives(priv->jni_env, priv->class_HBCICallbackNative, methods, 3);
+    if (result != 0) {
+        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
+        return NULL;
+    }
+
+#ifdef GHBCI_ENABLE_INSTRUMENTATION
+    // after reserved3 is set, the counting function table copies it
+    ghbci_instrumentation_install(priv->jni_env);
+#endif
+
+#define defineGenericJavaField(class, name, signature, type) \
+    priv->field_##class##_##name = (*priv->jni_env)->Get##type##FieldID(priv->jni_env, priv->class_##class, #name, signature); \
+    if (priv->field_##class##_##name == NULL) { \
+        (*priv->jni_env)->ExceptionDescribe(priv->jni_env); \
+        return NULL; \
+    }
+#define defineStaticJavaField(class, name, signature) defineGenericJavaField(class, name, signature, Static)
+#define defineJavaField(class, name, signature) defineGenericJavaField(class, name, signature, )
+    defineStaticJavaField(HBCIUtilsInternal, blzs, "Ljava/util/Properties;");
+    defineJavaField(Konto, country, "Ljava/lang/String;");
+    defineJavaField(Konto, blz, "Ljava/lang/String;");
+    defineJavaField(Konto, number, "Ljava/lang/String;");
+    defineJavaField(Konto, subnumber, "Ljava/lang/String;");
+    defineJavaField(Konto, acctype, "Ljava/lang/String;");
+    defineJavaField(Konto, type, "Ljava/lang/String;");
+    defineJavaField(Konto, curr, "Ljava/lang/String;");
+    defineJavaField(Konto, customerid, "Ljava/lang/String;");
+    defineJavaField(Konto, name, "Ljava/lang/String;");
+    defineJavaField(Konto, name2, "Ljava/lang/String;");
+    defineJavaField(Konto, bic, "Ljava/lang/String;");
+    defineJavaField(Konto, iban, "Ljava/lang/String;");
+    defineJavaField(GVRSaldoReqInfo, ready, "Lorg/kapott/hbci/structures/Saldo;");
+    defineJavaField(Saldo, value, "Lorg/kapott/hbci/structures/Value;");
+    defineJavaField(GVRKUmsUmsLine, valuta, "Ljava/util/Date;");
+    defineJavaField(GVRKUmsUmsLine, bdate, "Ljava/util/Date;");
+    defineJavaField(GVRKUmsUmsLine, value, "Lorg/kapott/hbci/structures/Value;");
+    defineJavaField(GVRKUmsUmsLine, saldo, "Lorg/kapott/hbci/structures/Saldo;");
+    defineJavaField(GVRKUmsUmsLine, gvcode, "Ljava/lang/String;");
+    defineJavaField(GVRKUmsUmsLine, usage, "Ljava/util/List;");
+    defineJavaField(GVRKUmsUmsLine, other, "Lorg/kapott/hbci/structures/Konto;");
+    defineJavaField(GVRKUmsUmsLine, text, "Ljava/lang/String;");
+    defineJavaField(GVRKUms, bufferMT940, "Ljava/lang/StringBuffer;");
+    defineJavaField(HBCIRetVal, code, "Ljava/lang/String;");
+    defineJavaField(HBCIRetVal, segref, "Ljava/lang/String;");
+    defineJavaField(HBCIRetVal, text, "Ljava/lang/String;");
+
+    // constant strings, shared by all threads
+    for (i = 0; i < GHBCI_JAVA_STRING_LAST; i++) {
+        jstring text = (*priv->jni_env)->NewStringUTF(priv->jni_env, java_string_text[i]);
+        if (text == NULL) {
+            (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
+            return NULL;
+        }
+        priv->java_strings[i] = (*priv->jni_env)->NewGlobalRef(priv->jni_env, text);
+        (*priv->jni_env)->DeleteLocalRef(priv->jni_env, text);
+    }
+
+    // JobParams.set() gets the ids of its parameter names only
+    if (priv->class_JobParams != NULL) {
+        jobjectArray strings = (*priv->jni_env)->NewObjectArray(priv->jni_env, GHBCI_JAVA_STRING_LAST,
+                priv->class_String, NULL);
+        if (strings == NULL) {
+            (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
+            return NULL;
+        }
+        for (i = 0; i < GHBCI_JAVA_STRING_LAST; i++)
+            (*priv->jni_env)->SetObjectArrayElement(priv->jni_env, strings, i, priv->java_strings[i]);
+        (*priv->jni_env)->CallStaticVoidMethod(priv->jni_env, priv->class_JobParams, priv->method_JobParams_init,
+                strings);
+        (*priv->jni_env)->DeleteLocalRef(priv->jni_env, strings);
+    }
+
+    // initialize hbci4java
+    console = (*priv->jni_env)->NewObject(priv->jni_env, priv->class_HBCICallbackNative, priv->method_HBCICallbackNative_constructor);
+    (*priv->jni_env)->CallStaticVoidMethod(priv->jni_env, priv->class_HBCIUtils, priv->method_HBCIUtils_init, 0, console);
+    push_log_level(context, priv->jni_env);
+
+    // keep callback for thread groups initialized later on
+    priv->callback = (*priv->jni_env)->NewGlobalRef(priv->jni_env, console);
+    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, console);
+
+    return context;
+}
+
+/**
+ * ghbci_context_new_with_workers: (constructor)
+ * @directory: temporary directory to save passports
+ * @n_workers: number of worker processes
+ * @error: return location for a #GError
+ *
+ * Sets up a new #GHbciContext running hbci4java in @n_workers processes of
+ * their own instead of a java virtual machine in this one. A crashing or
+ * hanging jvm fails only the operation it was running, with
+ * %GHBCI_ERROR_WORKER, and is restarted for the next one.
+ *
+ * Each passport is handled by one worker, so operations for different
+ * passports run in parallel on different workers. Statements are passed
+ * through shared memory. Callbacks are answered, and the log messages and
+ * status events of the worker are emitted, on the thread of the operation
+ * like with ghbci_context_new(). The metrics are kept here from the
+ * relayed status events.
+ *
+ * Returns: (transfer full): A New #GHbciContext, or %NULL if the workers
+ *   can't be started
+ **/
+GHbciContext*
+ghbci_context_new_with_workers (const gchar* directory, guint n_workers, GError** error)
+{
+    GHbciContext* context;
+    GHbciContextPrivate* priv;
+
+    g_return_val_if_fail (directory != NULL, NULL);
+    g_return_val_if_fail (n_workers > 0, NULL);
+    g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+    context = g_object_new (GHBCI_TYPE_CONTEXT, NULL);
+    priv = context->priv;
+
+    priv->hbci_handlers = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    priv->accounts      = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    priv->passport_directory = g_strdup(directory);
+
+    priv->workers = ghbci_worker_pool_new(directory, n_workers, answer_worker_callback, relay_worker_event,
+            context, error);
+    if (priv->workers == NULL) {
+        g_object_unref(context);
+        return NULL;
+    }
+    ghbci_worker_pool_set_options(priv->workers, g_atomic_int_get(&priv->log_level), priv->capture_raw_messages);
+    return context;
+}
+
+/**
+ * ghbci_context_new_for_daemon: (constructor)
+ * @connection: (nullable): connection to ghbci-daemon, or %NULL for the
+ *   session bus
+ * @error: return location for a #GError
+ *
+ * Sets up a new #GHbciContext passing its operations to ghbci-daemon, which
+ * keeps a java virtual machine and the passports of all its clients. This
+ * saves the start of a jvm for every short-lived process. The daemon is
+ * started on the session bus if it doesn't run yet.
+ *
+ * Callbacks are answered on the thread of the operation like with
+ * ghbci_context_new(), but the #GHbciContext::log and #GHbciContext::status
+ * signals are not emitted and the metrics only time whole jobs. The log
+ * level and the capture of raw messages are those of the daemon.
+ * %GHBCI_ERROR_WORKER reports a daemon that can't be reached or exited
+ * during the operation.
+ *
+ * Returns: (transfer full): A New #GHbciContext, or %NULL if the daemon
+ *   can't be reached
+ **/
+GHbciContext*
+ghbci_context_new_for_daemon (GDBusConnection* connection, GError** error)
+{
+    GHbciContext* context;
+    GHbciContextPrivate* priv;
+
+    g_return_val_if_fail (connection == NULL || G_IS_DBUS_CONNECTION (connection), NULL);
+    g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+    if (connection == NULL)
+        connection = g_bus_get_sync(G_BUS_TYPE_SESSION, NULL, error);
+    else
+        g_object_ref(connection);
+    if (connection == NULL)
+        return NULL;
+
+    context = g_object_new (GHBCI_TYPE_CONTEXT, NULL);
+    priv = context->priv;
+
+    priv->hbci_handlers = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    priv->accounts      = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    priv->daemon = ghbci_daemon_client_new(connection, answer_worker_callback, context, error);
+    g_object_unref(connection);
+    if (priv->daemon == NULL) {
+        g_object_unref(context);
+        return NULL;
+    }
+    return context;
+}
+
+
+/**
+ * ghbci_context_get_name_for_blz:
+ * @self: The #GHbciContext
+ * @blz: BLZ to resolve
+ *
+ * get bank name for BLZ
+ *
+ * Returns: (transfer full): bank name
+ **/
+const gchar*
+ghbci_context_get_name_for_blz (GHbciContext* self, const gchar* blz)
+{
+    GHbciContextPrivate* priv;
+    JNIEnv* jni_env;
+    gchar* result;
+
+    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), "");
+    GHBCI_INSTRUMENT (self, G_STRFUNC);
+    priv = self->priv;
+
+    if (is_out_of_process(self)) {
+        if (!request_bank(self, blz, &result, NULL))
+            return g_strdup("");
+        return result;
+    }
+
+    jni_env = ghbci_context_get_jni_env (self);
+
+    jstring java_blz = (*jni_env)->NewStringUTF(jni_env, blz);
+
+    jobject name = (*jni_env)->CallStaticObjectMethod(jni_env, priv->class_HBCIUtils, priv->method_HBCIUtils_getNameForBLZ, java_blz);
+    if (name == NULL) {
+        g_warning("empty result\n");
+        result = g_strdup("");
+        goto clean_blz;
+    }
+
+    // create extra string outside of JVM
+    result = ghbci_jstring_dup (jni_env, name);
+
+    (*jni_env)->DeleteLocalRef(jni_env, name);
+clean_blz:
+    (*jni_env)->DeleteLocalRef(jni_env, java_blz);
+    return result;
+}
+
+/**
+ * ghbci_context_get_pin_tan_url_for_blz:
+ * @self: The #GHbciContext
+ * @blz: BLZ to resolve
+ *
+ * get pin-tan url for BLZ, hbci4java is asked only once per BLZ
+ *
+ * Returns: (transfer full): url
+ **/
+const gchar*
+ghbci_context_get_pin_tan_url_for_blz (GHbciContext* self, const gchar* blz)
+{
+    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), "");
+    GHBCI_INSTRUMENT (self, G_STRFUNC);
+
+    return lookup_pin_tan_url(self, is_out_of_process(self) ? NULL : ghbci_context_get_jni_env (self), blz);
+}
+
+/**
+ * ghbci_context_blz_foreach:
+ * @self: The #GHbciContext
+ * @func: (scope call): function called for each bank
+ * @user_data: data for @func
+ *
+ * iterator over list of german banks included with hbci4java and call the
+ * callback for each of them
+ **/
+void
+ghbci_context_blz_foreach (GHbciContext* self, GHbciBlzFunc func, gpointer user_data)
+{
+    GHbciContextPrivate* priv;
+    GHbciJStringArena arena;
+    JNIEnv* jni_env;
+
+    g_return_if_fail (GHBCI_IS_CONTEXT (self));
+    g_return_if_fail (func != NULL);
+    GHBCI_INSTRUMENT (self, G_STRFUNC);
+    priv = self->priv;
+
+    if (is_out_of_process(self)) {
+        GError* error = NULL;
+        GVariant* reply = request_workers(self, NULL, NULL, GHBCI_WORKER_LIST_BANKS, g_variant_new("()"),
+                G_VARIANT_TYPE_STRING_ARRAY, &error);
+        GVariantIter iter;
+        const gchar* blz;
+
+        if (reply == NULL) {
+            g_warning("listing the banks failed: %s", error->message);
+            g_error_free(error);
+            return;
+        }
+        g_variant_iter_init(&iter, reply);
+        while (g_variant_iter_next(&iter, "&s", &blz))
+            (*func) (blz, user_data);
+        g_variant_unref(reply);
+        return;
+    }
+
+    jni_env = ghbci_context_get_jni_env (self);
+
+    jobject blzs = (*jni_env)->GetStaticObjectField(jni_env, priv->class_HBCIUtilsInternal, priv->field_HBCIUtilsInternal_blzs);
+
+    jobject blzs_keys = (*jni_env)->CallObjectMethod(jni_env, blzs, priv->method_Properties_keys);
+
+    ghbci_jstring_arena_init(&arena);
+    while((*jni_env)->CallBooleanMethod(jni_env, blzs_keys, priv->method_Enumeration_hasMoreElements)) {
+
+        jobject element = (*jni_env)->CallObjectMethod(jni_env, blzs_keys, priv->method_Enumeration_nextElement);
+
+        (*func) (ghbci_jstring_arena_copy(&arena, jni_env, element), user_data);
+        ghbci_jstring_arena_reset(&arena);
+
+        (*jni_env)->DeleteLocalRef(jni_env, element);
+    }
+
+    ghbci_jstring_arena_clear(&arena);
+
+    (*jni_env)->DeleteLocalRef(jni_env, blzs_keys);
+    (*jni_env)->DeleteLocalRef(jni_env, blzs);
+    return;
+}
+
+/*
+ * Allowed tan methods of a pin/tan passport, id to name
+ */
+static GHashTable*
+collect_tan_methods (GHbciContext* self, JNIEnv* jni_env, jobject passport, GError** error)
+{
+    GHbciContextPrivate* priv = self->priv;
+    GHashTable *tan_methods_result = NULL;
+
+    // get tan methods
+    jobject tan_methods = (*jni_env)->CallObjectMethod(jni_env, passport, priv->method_AbstractPinTanPassport_getTwostepMechanisms);
+    if (tan_methods == NULL) {
+        set_error_from_exception(self, jni_env, error);
+        return NULL;
+    }
+
+    // get allowed tan methods
+    jobject allowed_tan_methods = (*jni_env)->CallObjectMethod(jni_env, passport, priv->method_AbstractPinTanPassport_getAllowedTwostepMechanisms);
+    if (allowed_tan_methods == NULL) {
+        set_error_from_exception(self, jni_env, error);
+        goto cleanup_tan_methods;
+    }
+
+    jobject tan_methods_keys = (*jni_env)->CallObjectMethod(jni_env, tan_methods, priv->method_Properties_keys);
+
+    jstring name_str = priv->java_strings[GHBCI_JAVA_STRING_NAME];
+
+    tan_methods_result = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+    while((*jni_env)->CallBooleanMethod(jni_env, tan_methods_keys, priv->method_Enumeration_hasMoreElements)) {
+
+        jobject key = (*jni_env)->CallObjectMethod(jni_env, tan_methods_keys, priv->method_Enumeration_nextElement);
+
+        if ((*jni_env)->CallBooleanMethod(jni_env, allowed_tan_methods, priv->method_List_contains, key)) {
+            jobject properties = (*jni_env)->CallObjectMethod(jni_env, tan_methods, priv->method_Hashtable_get, key);
+            jobject name = (*jni_env)->CallObjectMethod(jni_env, properties, priv->method_Properties_getProperty, name_str);
+
+            g_hash_table_insert(tan_methods_result, ghbci_jstring_dup(jni_env, key), ghbci_jstring_dup(jni_env, name));
+
+            (*jni_env)->DeleteLocalRef(jni_env, properties);
+            (*jni_env)->DeleteLocalRef(jni_env, name);
+        }
+        (*jni_env)->DeleteLocalRef(jni_env, key);
+    }
+
+    (*jni_env)->DeleteLocalRef(jni_env, tan_methods_keys);
+    (*jni_env)->DeleteLocalRef(jni_env, allowed_tan_methods);
+cleanup_tan_methods:
+    (*jni_env)->DeleteLocalRef(jni_env, tan_methods);
+
+    return tan_methods_result;
+}
+
+/*
+ * Copy a java string returned by a method call, %NULL if the call failed
+ */
+static gchar*
+take_java_string (JNIEnv* jni_env, jstring string)
+{
+    gchar* result;
+
+    if (string == NULL) {
+        (*jni_env)->ExceptionClear(jni_env);
+        return NULL;
+    }
+
+    result = ghbci_jstring_dup(jni_env, string);
+    (*jni_env)->DeleteLocalRef(jni_env, string);
+    return result;
+}
+
+/*
+ * File of the capabilities of a user, they hold its TAN methods. %NULL if
+ * blz isn't 8 digits or userid would leave the passport directory.
+ */
+static gchar*
+capabilities_filename (GHbciContext* self, const gchar* blz, const gchar* userid)
+{
+    guint i;
+
+    for (i = 0; i < 8; i++) {
+        if (!g_ascii_isdigit(blz[i]))
+            return NULL;
+    }
+    if (blz[8] != '\0' || userid[0] == '\0' || strchr(userid, '/') != NULL)
+        return NULL;
+    return g_strconcat(self->priv->passport_directory, "/bank-", blz, "-", userid, ".caps", NULL);
+}
+
+/*
+ * Capabilities of a bank for a user from memory or from the file saved
+ * last time
+ */
+static GHbciCapabilities*
+lookup_capabilities (GHbciContext* self, const gchar* blz, const gchar* userid)
+{
+    GHbciContextPrivate* priv = self->priv;
+    GHbciCapabilities* capabilities;
+    gchar* key = g_strconcat(blz, "+", userid, NULL);
+
+    g_mutex_lock(&priv->lock);
+    capabilities = g_hash_table_lookup(priv->capabilities, key);
+    if (capabilities != NULL)
+        ghbci_capabilities_ref(capabilities);
+    g_mutex_unlock(&priv->lock);
+    if (capabilities != NULL) {
+        g_free(key);
+        return capabilities;
+    }
+
+    gchar* filename = capabilities_filename(self, blz, userid);
+    if (filename != NULL)
+        capabilities = ghbci_capabilities_load(filename, NULL);
+    g_free(filename);
+
+    if (capabilities != NULL) {
+        g_mutex_lock(&priv->lock);
+        g_hash_table_replace(priv->capabilities, key, ghbci_capabilities_ref(capabilities));
+        g_mutex_unlock(&priv->lock);
+    } else {
+        g_free(key);
+    }
+    return capabilities;
+}
+
+/*
+ * Fails with NOT_SUPPORTED if the known capabilities of the bank lack the job
+ */
+static gboolean
+check_job_supported (GHbciContext* self, const gchar* blz, const gchar* userid, const gchar* lowlevel_name,
+        GError** error)
+{
+    GHbciCapabilities* capabilities = lookup_capabilities(self, blz, userid);
+    gboolean supported = TRUE;
+
+    if (capabilities != NULL) {
+        supported = ghbci_capabilities_supports_job(capabilities, lowlevel_name);
+        ghbci_capabilities_unref(capabilities);
+    }
+    if (!supported)
+        ghbci_set_error(error, GHBCI_ERROR_NOT_SUPPORTED, NULL, GHBCI_RETRY_HINT_NEVER,
+                "bank %s doesn't support %s", blz, lowlevel_name);
+    return supported;
+}
+
+/*
+ * Add the restrictions hbci4java knows for a job from the BPD
+ */
+static void
+collect_job_parameters (GHbciContext* self, JNIEnv* jni_env, jobject handler, GHbciCapabilities* capabilities,
+        jstring job, const gchar* native_job)
+{
+    GHbciContextPrivate* priv = self->priv;
+
+    jobject restrictions = (*jni_env)->CallObjectMethod(jni_env, handler, priv->method_HBCIHandler_getLowlevelJobRestrictions, job);
+    if (restrictions == NULL) {
+        (*jni_env)->ExceptionClear(jni_env);
+        return;
+    }
+
+    jobject keys = (*jni_env)->CallObjectMethod(jni_env, restrictions, priv->method_Properties_keys);
+    while ((*jni_env)->CallBooleanMethod(jni_env, keys, priv->method_Enumeration_hasMoreElements)) {
+        jstring name = (*jni_env)->CallObjectMethod(jni_env, keys, priv->method_Enumeration_nextElement);
+        gchar* value = take_java_string(jni_env,
+                (*jni_env)->CallObjectMethod(jni_env, restrictions, priv->method_Properties_getProperty, name));
+        gchar* native_name = take_java_string(jni_env, name);
+
+        if (native_name != NULL && value != NULL)
+            ghbci_capabilities_set_job_parameter(capabilities, native_job, native_name, value);
+        g_free(native_name);
+        g_free(value);
+    }
+    (*jni_env)->DeleteLocalRef(jni_env, keys);
+    (*jni_env)->DeleteLocalRef(jni_env, restrictions);
+}
+
+/*
+ * Rebuild the capabilities of a bank for a user from the BPD of a freshly
+ * initialized handler, unless the saved ones are from the same BPD version
+ */
+static void
+update_capabilities (GHbciContext* self, JNIEnv* jni_env, const gchar* blz, const gchar* userid, jobject handler,
+        jobject passport)
+{
+    GHbciContextPrivate* priv = self->priv;
+    GHbciCapabilities* capabilities;
+    GError* error = NULL;
+
+    gchar* bpd_version = take_java_string(jni_env,
+            (*jni_env)->CallObjectMethod(jni_env, passport, priv->method_HBCIPassport_getBPDVersion));
+
+    capabilities = lookup_capabilities(self, blz, userid);
+    if (capabilities != NULL) {
+        gboolean current = bpd_version != NULL
+            && g_strcmp0(ghbci_capabilities_get_bpd_version(capabilities), bpd_version) == 0;
+        ghbci_capabilities_unref(capabilities);
+        if (current) {
+            g_free(bpd_version);
+            return;
+        }
+    }
+
+    capabilities = ghbci_capabilities_new(blz);
+
+    gchar* bank_name = take_java_string(jni_env,
+            (*jni_env)->CallObjectMethod(jni_env, passport, priv->method_HBCIPassport_getInstName));
+    gchar* host = take_java_string(jni_env,
+            (*jni_env)->CallObjectMethod(jni_env, passport, priv->method_HBCIPassport_getHost));
+    gchar* hbci_version = take_java_string(jni_env,
+            (*jni_env)->CallObjectMethod(jni_env, handler, priv->method_HBCIHandler_getHBCIVersion));
+    ghbci_capabilities_set_bank(capabilities, bank_name, host, hbci_version, bpd_version);
+    g_free(bank_name);
+    g_free(host);
+    g_free(hbci_version);
+    g_free(bpd_version);
+
+    // supported jobs: name to highest version
+    jobject jobs = (*jni_env)->CallObjectMethod(jni_env, handler, priv->method_HBCIHandler_getSupportedLowlevelJobs);
+    if (jobs != NULL) {
+        jobject keys = (*jni_env)->CallObjectMethod(jni_env, jobs, priv->method_Properties_keys);
+        while ((*jni_env)->CallBooleanMethod(jni_env, keys, priv->method_Enumeration_hasMoreElements)) {
+            jstring job = (*jni_env)->CallObjectMethod(jni_env, keys, priv->method_Enumeration_nextElement);
+            gchar* version = take_java_string(jni_env,
+                    (*jni_env)->CallObjectMethod(jni_env, jobs, priv->method_Properties_getProperty, job));
+            const gchar* native_job = (*jni_env)->GetStringUTFChars(jni_env, job, 0);
+
+            ghbci_capabilities_add_job(capabilities, native_job, version != NULL ? atoi(version) : 0);
+            collect_job_parameters(self, jni_env, handler, capabilities, job, native_job);
+
+            (*jni_env)->ReleaseStringUTFChars(jni_env, job, native_job);
+            (*jni_env)->DeleteLocalRef(jni_env, job);
+            g_free(version);
+        }
+        (*jni_env)->DeleteLocalRef(jni_env, keys);
+        (*jni_env)->DeleteLocalRef(jni_env, jobs);
+    } else {
+        (*jni_env)->ExceptionClear(jni_env);
+    }
+
+    GHashTable* tan_methods = collect_tan_methods(self, jni_env, passport, NULL);
+    if (tan_methods != NULL) {
+        GHashTableIter iter;
+        gpointer id, name;
+
+        g_hash_table_iter_init(&iter, tan_methods);
+        while (g_hash_table_iter_next(&iter, &id, &name))
+            ghbci_capabilities_add_tan_method(capabilities, id, name);
+        g_hash_table_unref(tan_methods);
+    }
+
+    g_mutex_lock(&priv->lock);
+    g_hash_table_replace(priv->capabilities, g_strconcat(blz, "+", userid, NULL),
+            ghbci_capabilities_ref(capabilities));
+    g_mutex_unlock(&priv->lock);
+
+    gchar* filename = capabilities_filename(self, blz, userid);
+    if (filename != NULL && !ghbci_capabilities_save(capabilities, filename, &error)) {
+        g_warning("saving capabilities of %s/%s failed: %s", blz, userid, error->message);
+        g_error_free(error);
+    }
+    g_free(filename);
+    ghbci_capabilities_unref(capabilities);
+}
+
+/**
+ * ghbci_context_add_passport:
+ * @self: The #GHbciContext
+ * @blz: blz
+ * @userid: userid
+ * @error: return location for a #GError
+ *
+ * Add bank account to passport file. Triggers #callback signal for additional
+ * account details and credentials and fetches account capabilities online.
+ *
+ * Returns: TRUE if successful
+ **/
+gboolean
+ghbci_context_add_passport (GHbciContext* self, const gchar* blz, const gchar* userid, GError** error)
+{
+    GHbciContextPrivate* priv;
+    JNIEnv* jni_env;
+
+    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), FALSE);
+    g_return_val_if_fail (blz != NULL, FALSE);
+    g_return_val_if_fail (userid != NULL, FALSE);
+    g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+    GHBCI_INSTRUMENT (self, G_STRFUNC);
+    priv = self->priv;
+
+    if (priv->workers != NULL) {
+        ghbci_metrics_begin_operation(priv->metrics, blz, "init");
+        gboolean added = ghbci_worker_pool_add_passport(priv->workers, blz, userid, error);
+        ghbci_metrics_end_operation(priv->metrics);
+        return added;
+    }
+    if (priv->daemon != NULL)
+        return ghbci_daemon_client_add_passport(priv->daemon, blz, userid, error);
+
+    jni_env = ghbci_context_get_jni_env (self);
+
+    gchar* key = g_strconcat(blz, "+", userid, NULL);
+
+    // set passport filename
+    gchar* filename = g_strconcat(priv->passport_directory, "/passport-", key, ".dat", NULL);
+    jstring filename_value = (*jni_env)->NewStringUTF(jni_env, filename);
+    (*jni_env)->CallStaticVoidMethod(jni_env, priv->class_HBCIUtils, priv->method_HBCIUtils_setParam,
+            priv->java_strings[GHBCI_JAVA_STRING_PINTAN_FILENAME], filename_value);
+    (*jni_env)->DeleteLocalRef(jni_env, filename_value);
+
+    g_mutex_lock(&priv->lock);
+    if (g_slist_find_custom(priv->passports, filename, (GCompareFunc)g_strcmp0) == NULL) {
+        priv->passports = g_slist_prepend(priv->passports, filename);
+    } else {
+        g_free(filename);
+    }
+    g_mutex_unlock(&priv->lock);
+
+    // force check certificates
+    (*jni_env)->CallStaticVoidMethod(jni_env, priv->class_HBCIUtils, priv->method_HBCIUtils_setParam,
+            priv->java_strings[GHBCI_JAVA_STRING_PINTAN_CHECKCERT], priv->java_strings[GHBCI_JAVA_STRING_ONE]);
+
+    // require reinitialization of pinTan
+    (*jni_env)->CallStaticVoidMethod(jni_env, priv->class_HBCIUtils, priv->method_HBCIUtils_setParam,
+            priv->java_strings[GHBCI_JAVA_STRING_PINTAN_INIT], priv->java_strings[GHBCI_JAVA_STRING_ONE]);
+
+    // set log level
+    push_log_level(self, jni_env);
+
+    // answer callbacks for this passport
+    CallbackScope scope;
+    callback_scope_push(&scope, blz, userid, key, NULL);
+
+    // create HBCIPassport object
+    jobject passport = (*jni_env)->CallStaticObjectMethod(jni_env, priv->class_AbstractHBCIPassport, priv->method_AbstractHBCIPassport_getInstance,
+            priv->java_strings[GHBCI_JAVA_STRING_PINTAN]);
+
+    if (passport == NULL) {
+        callback_scope_pop(&scope);
+        set_error_from_exception(self, jni_env, error);
+        return FALSE;
+    }
+
+    // create HBCIHandler from passport
+    ghbci_metrics_begin_operation(priv->metrics, blz, "init");
+    jobject handler = (*jni_env)->NewObject(jni_env, priv->class_HBCIHandler, priv->method_HBCIHandler_constructor,
+            priv->java_strings[GHBCI_JAVA_STRING_HBCI_VERSION], passport);
+    ghbci_metrics_end_operation(priv->metrics);
+    callback_scope_pop(&scope);
+
+    if (handler == NULL) {
+        set_error_from_exception(self, jni_env, error);
+        (*jni_env)->DeleteLocalRef(jni_env, passport);
+        return FALSE;
+    }
+
+    update_capabilities(self, jni_env, blz, userid, handler, passport);
+
+    // handlers are shared between threads, keep a global reference
+    jobject global_handler = (*jni_env)->NewGlobalRef(jni_env, handler);
+    (*jni_env)->DeleteLocalRef(jni_env, handler);
+    (*jni_env)->DeleteLocalRef(jni_env, passport);
+
+    g_mutex_lock(&priv->lock);
+    jobject old_handler = g_hash_table_lookup(priv->hbci_handlers, key);
+    if (old_handler != NULL) {
+        (*jni_env)->DeleteGlobalRef(jni_env, old_handler);
+    }
+    g_hash_table_insert(priv->hbci_handlers, key, global_handler);
+    g_mutex_unlock(&priv->lock);
+    return TRUE;
+}
+
+/**
+ * ghbci_context_get_accounts:
+ * @self: The #GHbciContext
+ * @blz: blz
+ * @userid: userid
+ * @error: return location for a #GError
+ *
+ * Get list of bank accounts visible by this userid
+ *
+ * Returns: (element-type GHbciAccount) (transfer full): List of #GHbciAccount objects
+ **/
+GSList*
+ghbci_context_get_accounts (GHbciContext* self, const gchar* blz, const gchar* userid, GError** error)
+{
+    GHbciContextPrivate* priv;
+    JNIEnv* jni_env;
+    GSList *account_list = NULL;
+
+    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), NULL);
+    GHBCI_INSTRUMENT (self, G_STRFUNC);
+    priv = self->priv;
+
+    if (is_out_of_process(self)) {
+        GVariant* reply = request_workers(self, blz, userid, GHBCI_WORKER_GET_ACCOUNTS,
+                g_variant_new("(ss)", blz, userid), G_VARIANT_TYPE("aa{ss}"), error);
+        GVariant* properties;
+        GVariantIter iter;
+
+        if (reply == NULL)
+            return NULL;
+        g_variant_iter_init(&iter, reply);
+        while ((properties = g_variant_iter_next_value(&iter)) != NULL) {
+            account_list = g_slist_prepend(account_list, ghbci_account_new_with_properties(self, properties));
+            g_variant_unref(properties);
+        }
+        g_variant_unref(reply);
+        return g_slist_reverse(account_list);
+    }
+
+    jni_env = ghbci_context_get_jni_env (self);
+
+    jobject hbci_handler = get_hbci_handler(self, jni_env, blz, userid);
+    if(hbci_handler == NULL) {
+        ghbci_set_error(error, GHBCI_ERROR_NO_PASSPORT, NULL, GHBCI_RETRY_HINT_NEVER,
+                "no passport added for %s/%s", blz, userid);
+        return NULL;
+    }
+
+    // get passport from HBCIHandler
+    jobject passport = (*jni_env)->CallObjectMethod(jni_env, hbci_handler, priv->method_HBCIHandler_getPassport);
+    (*jni_env)->DeleteLocalRef(jni_env, hbci_handler);
+    if (passport == NULL) {
+        set_error_from_exception(self, jni_env, error);
+        return NULL;
+    }
+
+    // get accounts
+    jobject accounts = (*jni_env)->CallObjectMethod(jni_env, passport, priv->method_HBCIPassport_getAccounts);
+    if (accounts == NULL) {
+        set_error_from_exception(self, jni_env, error);
+        (*jni_env)->DeleteLocalRef(jni_env, passport);
+        return NULL;
+    }
+    int i;
+    for(i = 0; i < (*jni_env)->GetArrayLength(jni_env, accounts); i++) {
+        jobject element = (*jni_env)->GetObjectArrayElement(jni_env, accounts, i);
+
+        GHbciAccount* account = ghbci_account_new_with_jobject(self, element);
+        account_list = g_slist_prepend (account_list, account);
+
+        gchar* number;
+        g_object_get(account, "number", &number, NULL);
+
+        char* key = g_strconcat(blz, "+", userid, "+", number, NULL);
+        g_mutex_lock(&priv->lock);
+        jobject old_element = g_hash_table_lookup(priv->accounts, key);
+        if (old_element != NULL) {
+            (*jni_env)->DeleteGlobalRef(jni_env, old_element);
+        }
+        g_hash_table_insert(priv->accounts, key, (*jni_env)->NewGlobalRef(jni_env, element));
+        g_mutex_unlock(&priv->lock);
+
+        g_free (number);
+        (*jni_env)->DeleteLocalRef(jni_env, element);
+    }
+    (*jni_env)->DeleteLocalRef(jni_env, accounts);
+    (*jni_env)->DeleteLocalRef(jni_env, passport);
+
+    return g_slist_reverse(account_list);
+}
+
+/**
+ * ghbci_context_get_tan_methods:
+ * @self: The #GHbciContext
+ * @blz: blz
+ * @userid: userid
+ * @error: return location for a #GError
  *
- * Sets up a new #GHbciContext object
+ * Get list of tan methods supported by this account
  *
- * Returns: (transfer full): A New #GHbciContext
+ * Returns: (element-type gchar* gchar*) (transfer full): List of tan methods
  **/
-GHbciContext*
-ghbci_context_new (const gchar* directory)
+GHashTable*
+ghbci_context_get_tan_methods (GHbciContext* self, const gchar* blz, const gchar* userid, GError** error)
 {
-    GHbciContext* context;
     GHbciContextPrivate* priv;
-    JavaVMInitArgs vm_args;
-    JavaVMOption options; 
-    JNINativeMethod methods[3];
-    jobject console;
+    JNIEnv* jni_env;
+    GHashTable *tan_methods_result = NULL;
 
-    context = g_object_new (GHBCI_TYPE_CONTEXT, NULL);
-    priv = context->priv;
+    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), NULL);
+    GHBCI_INSTRUMENT (self, G_STRFUNC);
+    priv = self->priv;
 
-    priv->hbci_handlers = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
-    priv->accounts      = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
-    priv->passport_directory = g_strdup(directory);
+    if (is_out_of_process(self)) {
+        GVariant* reply = request_workers(self, blz, userid, GHBCI_WORKER_GET_TAN_METHODS,
+                g_variant_new("(ss)", blz, userid), G_VARIANT_TYPE("a{ss}"), error);
+        GVariantIter iter;
+        gchar *key, *name;
+
+        if (reply == NULL)
+            return NULL;
+        tan_methods_result = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+        g_variant_iter_init(&iter, reply);
+        while (g_variant_iter_next(&iter, "{ss}", &key, &name))
+            g_hash_table_replace(tan_methods_result, key, name);
+        g_variant_unref(reply);
+        return tan_methods_result;
+    }
 
-    // initialize java virtual machine
-    // Path to hbci4java.jar
-    options.optionString = "-Djava.class.path=" DATA_DIR "/hbci4java.jar"; 
-    vm_args.version = JNI_VERSION_1_6; //JDK version. This indicates version 1.6
-    vm_args.nOptions = 1;
-    vm_args.options = &options;
-    vm_args.ignoreUnrecognized = 0;
+    jni_env = ghbci_context_get_jni_env (self);
 
-    int ret = JNI_CreateJavaVM(&priv->jvm, (void**)&priv->jni_env, &vm_args);
-    if(ret < 0) {
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
+    jobject hbci_handler = get_hbci_handler(self, jni_env, blz, userid);
+    if(hbci_handler == NULL) {
+        ghbci_set_error(error, GHBCI_ERROR_NO_PASSPORT, NULL, GHBCI_RETRY_HINT_NEVER,
+                "no passport added for %s/%s", blz, userid);
         return NULL;
     }
-    // pure evil, save context object in reserved field of jni environment struct,
-    // so it can be accessed from native callback functions
-    (*(struct JNINativeInterface_**)priv->jni_env)->reserved3 = context;
 
-    // save references to java classes and methods
-#define defineJavaClass(class, path) \
-    priv->class_##class = (*priv->jni_env)->FindClass(priv->jni_env, path);\
-    if (priv->class_##class == NULL) { \
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env); \
-        return NULL; \
+    // get passport from HBCIHandler
+    jobject passport = (*jni_env)->CallObjectMethod(jni_env, hbci_handler, priv->method_HBCIHandler_getPassport);
+    (*jni_env)->DeleteLocalRef(jni_env, hbci_handler);
+    if (passport == NULL) {
+        set_error_from_exception(self, jni_env, error);
+        return NULL;
     }
 
-    defineJavaClass(Konto, "org/kapott/hbci/structures/Konto")
-    defineJavaClass(Saldo, "Lorg/kapott/hbci/structures/Saldo;")
-    defineJavaClass(Value, "Lorg/kapott/hbci/structures/Value;")
-    defineJavaClass(AbortException, "org/kapott/hbci/exceptions/AbortedException")
-    defineJavaClass(HBCIUtilsInternal, "org/kapott/hbci/manager/HBCIUtilsInternal")
-    defineJavaClass(HBCIUtils, "org/kapott/hbci/manager/HBCIUtils")
-    defineJavaClass(HBCICallbackConsole, "org/kapott/hbci/callback/HBCICallbackConsole")
-    defineJavaClass(HBCICallbackNative, "org/kapott/hbci/callback/HBCICallbackNative")
-    defineJavaClass(HBCIHandler, "org/kapott/hbci/manager/HBCIHandler")
-    defineJavaClass(HBCIJob, "org/kapott/hbci/GV/HBCIJob")
-    defineJavaClass(HBCIJobResult, "org/kapott/hbci/GV_Result/HBCIJobResult")
-    defineJavaClass(HBCIStatus, "org/kapott/hbci/status/HBCIStatus")
-    defineJavaClass(HBCIPassport, "org/kapott/hbci/passport/HBCIPassport")
-    defineJavaClass(AbstractHBCIPassport, "org/kapott/hbci/passport/AbstractHBCIPassport")
-    defineJavaClass(AbstractPinTanPassport, "org/kapott/hbci/passport/AbstractPinTanPassport")
-    defineJavaClass(HBCIJobResultImpl, "org/kapott/hbci/GV_Result/HBCIJobResultImpl")
-    defineJavaClass(GVRSaldoReq, "org/kapott/hbci/GV_Result/GVRSaldoReq")
-    defineJavaClass(GVRSaldoReqInfo, "org/kapott/hbci/GV_Result/GVRSaldoReq$Info")
-    defineJavaClass(GVRKUms, "org/kapott/hbci/GV_Result/GVRKUms")
-    defineJavaClass(GVRKUmsUmsLine, "org/kapott/hbci/GV_Result/GVRKUms$UmsLine")
-    defineJavaClass(Hashtable, "java/util/Hashtable")
-    defineJavaClass(Properties, "java/util/Properties")
-    defineJavaClass(Enumeration, "java/util/Enumeration")
-    defineJavaClass(Iterator, "java/util/Iterator")
-    defineJavaClass(List, "java/util/List")
-    defineJavaClass(StringBuffer, "java/lang/StringBuffer")
-    defineJavaClass(Date, "java/util/Date")
+    (*jni_env)->CallVoidMethod(jni_env, passport, priv->method_AbstractPinTanPassport_setCurrentTANMethod, NULL);
 
-#define defineJavaStaticMethod(class, method, signatur) \
-    priv->method_##class##_##method = (*priv->jni_env)->GetStaticMethodID(priv->jni_env, priv->class_##class, #method, signatur); \
-    if (priv->method_##class##_##method == NULL) { \
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env); \
-        return NULL; \
-    }
+    tan_methods_result = collect_tan_methods(self, jni_env, passport, error);
+    (*jni_env)->DeleteLocalRef(jni_env, passport);
 
-    defineJavaStaticMethod(HBCIUtils, getNameForBLZ, "(Ljava/lang/String;)Ljava/lang/String;")
-    defineJavaStaticMethod(HBCIUtils, getPinTanURLForBLZ, "(Ljava/lang/String;)Ljava/lang/String;")
-    defineJavaStaticMethod(HBCIUtils, init, "(Ljava/util/Properties;Lorg/kapott/hbci/callback/HBCICallback;)V")
-    defineJavaStaticMethod(HBCIUtils, setParam, "(Ljava/lang/String;Ljava/lang/String;)V")
-    defineJavaStaticMethod(AbstractHBCIPassport, getInstance, "(Ljava/lang/String;)Lorg/kapott/hbci/passport/HBCIPassport;")
+    return tan_methods_result;
+}
 
-#define defineJavaMethod(class, method, signatur) \
-    priv->method_##class##_##method = (*priv->jni_env)->GetMethodID(priv->jni_env, priv->class_##class, #method, signatur); \
-    if (priv->method_##class##_##method == NULL) { \
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env); \
-        return NULL; \
+/**
+ * ghbci_context_get_balances:
+ * @self: The #GHbciContext
+ * @blz: blz
+ * @userid: userid
+ * @number: number of account to inquery
+ * @error: return location for a #GError
+ *
+ * Fetch balances of bank accounts
+ *
+ * Returns: (transfer full): balance
+ **/
+gchar*
+ghbci_context_get_balances (GHbciContext* self, const gchar* blz, const gchar* userid, const gchar* number,
+        GError** error)
+{
+    GHbciContextPrivate* priv;
+    JNIEnv* jni_env;
+    gchar *value = NULL;
+
+    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), NULL);
+    GHBCI_INSTRUMENT (self, G_STRFUNC);
+    priv = self->priv;
+
+    if (is_out_of_process(self)) {
+        OutOfProcessJob job;
+
+        out_of_process_job_begin(self, &job, blz, java_string_text[GHBCI_JAVA_STRING_JOB_SALDO_REQ]);
+        if (priv->workers != NULL)
+            value = ghbci_worker_pool_get_balances(priv->workers, blz, userid, number, error);
+        else
+            value = ghbci_daemon_client_get_balances(priv->daemon, blz, userid, number, error);
+        out_of_process_job_end(self, &job);
+        return value;
     }
-    defineJavaMethod(HBCIHandler, newJob, "(Ljava/lang/String;)Lorg/kapott/hbci/GV/HBCIJob;")
-    defineJavaMethod(HBCIHandler, execute, "()Lorg/kapott/hbci/status/HBCIExecStatus;")
-    defineJavaMethod(HBCIHandler, getPassport, "()Lorg/kapott/hbci/passport/HBCIPassport;")
-    defineJavaMethod(HBCIHandler, reset, "()V")
-    defineJavaMethod(HBCIJob, setParam, "(Ljava/lang/String;Ljava/lang/String;)V")
-    defineJavaMethod(HBCIJob, addToQueue, "()V")
-    defineJavaMethod(HBCIJob, getJobResult, "()Lorg/kapott/hbci/GV_Result/HBCIJobResult;")
-    defineJavaMethod(HBCIJobResult, getJobStatus, "()Lorg/kapott/hbci/status/HBCIStatus;")
-    defineJavaMethod(HBCIStatus, getErrorString, "()Ljava/lang/String;")
-    defineJavaMethod(HBCIPassport, getAccounts, "()[Lorg/kapott/hbci/structures/Konto;")
-    defineJavaMethod(HBCIJobResultImpl, isOK, "()Z")
-    defineJavaMethod(AbstractPinTanPassport, getTwostepMechanisms, "()Ljava/util/Hashtable;")
-    defineJavaMethod(AbstractPinTanPassport, getAllowedTwostepMechanisms, "()Ljava/util/List;")
-    defineJavaMethod(AbstractPinTanPassport, setCurrentTANMethod, "(Ljava/lang/String;)V")
-    defineJavaMethod(GVRSaldoReq, getEntries, "()[Lorg/kapott/hbci/GV_Result/GVRSaldoReq$Info;")
-    defineJavaMethod(GVRKUms, toString, "()Ljava/lang/String;")
-    defineJavaMethod(GVRKUms, getFlatData, "()Ljava/util/List;")
-    defineJavaMethod(Properties, keys, "()Ljava/util/Enumeration;")
-    defineJavaMethod(Properties, getProperty, "(Ljava/lang/String;)Ljava/lang/String;")
-    defineJavaMethod(Enumeration, hasMoreElements, "()Z")
-    defineJavaMethod(Enumeration, nextElement, "()Ljava/lang/Object;")
-    defineJavaMethod(Iterator, hasNext, "()Z")
-    defineJavaMethod(Iterator, next, "()Ljava/lang/Object;")
-    defineJavaMethod(List, iterator, "()Ljava/util/Iterator;")
-    defineJavaMethod(List, contains, "(Ljava/lang/Object;)Z")
-    defineJavaMethod(StringBuffer, replace, "(IILjava/lang/String;)Ljava/lang/StringBuffer;")
-    defineJavaMethod(StringBuffer, setLength, "(I)V")
-    defineJavaMethod(StringBuffer, toString, "()Ljava/lang/String;")
-    defineJavaMethod(Hashtable, toString, "()Ljava/lang/String;")
-    defineJavaMethod(Hashtable, get, "(Ljava/lang/Object;)Ljava/lang/Object;")
-    defineJavaMethod(Value, toString, "()Ljava/lang/String;")
-    defineJavaMethod(Date, toString, "()Ljava/lang/String;")
-    defineJavaMethod(Date, getDate, "()I")
-    defineJavaMethod(Date, getMonth, "()I")
-    defineJavaMethod(Date, getYear, "()I")
-    defineJavaMethod(Date, getTime, "()J")
 
-#define defineJavaConstructor(class, signatur) \
-    priv->method_##class##_constructor = (*priv->jni_env)->GetMethodID(priv->jni_env, priv->class_##class, "<init>", signatur); \
-    if (priv->method_##class##_constructor == NULL) { \
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env); \
-        return NULL; \
+    jni_env = ghbci_context_get_jni_env (self);
+
+    jobject hbci_handler = get_hbci_handler(self, jni_env, blz, userid);
+    if(hbci_handler == NULL) {
+        ghbci_set_error(error, GHBCI_ERROR_NO_PASSPORT, NULL, GHBCI_RETRY_HINT_NEVER,
+                "no passport added for %s/%s", blz, userid);
+        return NULL;
     }
-    defineJavaConstructor(Konto, "()V")
-    defineJavaConstructor(HBCIHandler, "(Ljava/lang/String;Lorg/kapott/hbci/passport/HBCIPassport;)V")
-    defineJavaConstructor(HBCICallbackConsole, "()V")
-    defineJavaConstructor(HBCICallbackNative, "()V")
 
-    // register native methods for callbacks
-    methods[0].name = "nativeLog";
-    methods[0].signature = "(Ljava/lang/String;ILjava/util/Date;Ljava/lang/StackTraceElement;)V";
-    methods[0].fnPtr = my_log;
-    methods[1].name = "nativeCallback";
-    methods[1].signature = "(Lorg/kapott/hbci/passport/HBCIPassport;ILjava/lang/String;ILjava/lang/StringBuffer;)V";
-    methods[1].fnPtr = my_callback;
-    methods[2].name = "nativeStatus";
-    methods[2].signature = "(Lorg/kapott/hbci/passport/HBCIPassport;I[Ljava/lang/Object;)V";
-    methods[2].fnPtr = my_status;
-    jint result = (*priv->jni_env)->RegisterNatives(priv->jni_env, priv->class_HBCICallbackNative, methods, 3);
-    if (result != 0) {
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
+    JobParams params;
+    job_params_init(&params);
+    job_params_add_account(&params, self, jni_env, blz, userid, number);
+    jobject job = execute_job(self, jni_env, hbci_handler, blz, userid, GHBCI_JAVA_STRING_JOB_SALDO_REQ, &params, TRUE, error);
+    (*jni_env)->DeleteLocalRef(jni_env, hbci_handler);
+    job_params_clear(&params);
+    if (job == NULL) {
         return NULL;
     }
 
-#define defineGenericJavaField(class, name, signature, type) \
-    priv->field_##class##_##name = (*priv->jni_env)->Get##type##FieldID(priv->jni_env, priv->class_##class, #name, signature); \
-    if (priv->field_##class##_##name == NULL) { \
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env); \
-        return NULL; \
+    jobject result = (*jni_env)->CallObjectMethod(jni_env, job, priv->method_HBCIJob_getJobResult);
+    if (result == NULL) {
+        set_error_from_exception(self, jni_env, error);
+        goto cleanup_job;
     }
-#define defineStaticJavaField(class, name, signature) defineGenericJavaField(class, name, signature, Static)
-#define defineJavaField(class, name, signature) defineGenericJavaField(class, name, signature, )
-    defineStaticJavaField(HBCIUtilsInternal, blzs, "Ljava/util/Properties;");
-    defineJavaField(Konto, country, "Ljava/lang/String;");
-    defineJavaField(Konto, blz, "Ljava/lang/String;");
-    defineJavaField(Konto, number, "Ljava/lang/String;");
-    defineJavaField(Konto, subnumber, "Ljava/lang/String;");
-    defineJavaField(Konto, acctype, "Ljava/lang/String;");
-    defineJavaField(Konto, type, "Ljava/lang/String;");
-    defineJavaField(Konto, curr, "Ljava/lang/String;");
-    defineJavaField(Konto, customerid, "Ljava/lang/String;");
-    defineJavaField(Konto, name, "Ljava/lang/String;");
-    defineJavaField(Konto, name2, "Ljava/lang/String;");
-    defineJavaField(Konto, bic, "Ljava/lang/String;");
-    defineJavaField(Konto, iban, "Ljava/lang/String;");
-    defineJavaField(GVRSaldoReqInfo, ready, "Lorg/kapott/hbci/structures/Saldo;");
-    defineJavaField(Saldo, value, "Lorg/kapott/hbci/structures/Value;");
-    defineJavaField(GVRKUmsUmsLine, valuta, "Ljava/util/Date;");
-    defineJavaField(GVRKUmsUmsLine, bdate, "Ljava/util/Date;");
-    defineJavaField(GVRKUmsUmsLine, value, "Lorg/kapott/hbci/structures/Value;");
-    defineJavaField(GVRKUmsUmsLine, saldo, "Lorg/kapott/hbci/structures/Saldo;");
-    defineJavaField(GVRKUmsUmsLine, gvcode, "Ljava/lang/String;");
-    defineJavaField(GVRKUmsUmsLine, usage, "Ljava/util/List;");
-    defineJavaField(GVRKUmsUmsLine, other, "Lorg/kapott/hbci/structures/Konto;");
-    defineJavaField(GVRKUmsUmsLine, text, "Ljava/lang/String;");
 
-    // initialize hbci4java
-    console = (*priv->jni_env)->NewObject(priv->jni_env, priv->class_HBCICallbackNative, priv->method_HBCICallbackNative_constructor);
-    (*priv->jni_env)->CallStaticVoidMethod(priv->jni_env, priv->class_HBCIUtils, priv->method_HBCIUtils_init, 0, console);
+    // GVRSaldoReq.Info[] saldi = res.getEntries();
+    jobject entries = (*jni_env)->CallObjectMethod(jni_env, result, priv->method_GVRSaldoReq_getEntries);
+    if (entries == NULL) {
+        set_error_from_exception(self, jni_env, error);
+        goto cleanup_result;
+    }
+    jobject element = (*jni_env)->GetObjectArrayElement(jni_env, entries, 0);
+    if (element == NULL) {
+        set_error_from_exception(self, jni_env, error);
+        goto cleanup_entries;
+    }
+    jobject ready = (*jni_env)->GetObjectField(jni_env, element, priv->field_GVRSaldoReqInfo_ready);
+    if (ready == NULL) {
+        set_error_from_exception(self, jni_env, error);
+        goto cleanup_element;
+    }
+    jobject jvalue = (*jni_env)->GetObjectField(jni_env, ready, priv->field_Saldo_value);
+    if (jvalue == NULL) {
+        set_error_from_exception(self, jni_env, error);
+        goto cleanup_ready;
+    }
+    jobject jvaluestr = (*jni_env)->CallObjectMethod(jni_env, jvalue, priv->method_Value_toString);
+    if (jvaluestr == NULL) {
+        set_error_from_exception(self, jni_env, error);
+        goto cleanup_jvalue;
+    }
 
-    return context;
+    // to native string
+    value = ghbci_jstring_dup(jni_env, jvaluestr);
+
+    (*jni_env)->DeleteLocalRef(jni_env, jvaluestr);
+cleanup_jvalue:
+    (*jni_env)->DeleteLocalRef(jni_env, jvalue);
+cleanup_ready:
+    (*jni_env)->DeleteLocalRef(jni_env, ready);
+cleanup_element:
+    (*jni_env)->DeleteLocalRef(jni_env, element);
+cleanup_entries:
+    (*jni_env)->DeleteLocalRef(jni_env, entries);
+cleanup_result:
+    (*jni_env)->DeleteLocalRef(jni_env, result);
+cleanup_job:
+    (*jni_env)->DeleteLocalRef(jni_env, job);
+    return value;
 }
 
 
 /**
- * ghbci_context_get_name_for_blz:
+ * ghbci_context_get_statements:
  * @self: The #GHbciContext
- * @blz: BLZ to resolve
+ * @blz: blz
+ * @userid: userid
+ * @number: bank account number
+ * @error: return location for a #GError
  *
- * get bank name for BLZ
+ * Fetch all statements for a bank account. On error no statements are
+ * returned, not even the ones read before it.
  *
- * Returns: (transfer full): bank name
+ * Returns: (element-type GHbciStatement) (transfer full): List of #GHbciStatement objects
  **/
-const gchar*
-ghbci_context_get_name_for_blz (GHbciContext* self, const gchar* blz)
+GSList*
+ghbci_context_get_statements (GHbciContext* self, const gchar* blz, const gchar* userid, const gchar* number,
+        GError** error)
+{
+    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), NULL);
+    GHBCI_INSTRUMENT (self, G_STRFUNC);
+
+    return ghbci_context_fetch_statements(self, blz, userid, number, self->priv->native_mt940, error);
+}
+
+/*
+ * ghbci_context_get_statements() with the parser chosen per call, for
+ * requests of several clients with different settings
+ */
+GSList*
+ghbci_context_fetch_statements (GHbciContext* self, const gchar* blz, const gchar* userid, const gchar* number,
+        gboolean native_mt940, GError** error)
 {
     GHbciContextPrivate* priv;
-    const gchar* result;
+    JNIEnv* jni_env;
+    GHbciStringPool* pool;
+    GSList* statements = NULL;
+    gboolean failed = FALSE;
 
-    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), "");
     priv = self->priv;
 
-    jstring java_blz = (*priv->jni_env)->NewStringUTF(priv->jni_env, blz);
+    if (is_out_of_process(self)) {
+        OutOfProcessJob job;
+
+        out_of_process_job_begin(self, &job, blz, java_string_text[GHBCI_JAVA_STRING_JOB_KUMS_ALL]);
+        pool = ghbci_string_pool_new();
+        if (priv->workers != NULL)
+            statements = ghbci_worker_pool_get_statements(priv->workers, blz, userid, number, native_mt940,
+                    pool, error);
+        else
+            statements = ghbci_daemon_client_get_statements(priv->daemon, blz, userid, number, native_mt940,
+                    pool, error);
+        ghbci_string_pool_unref(pool);
+        out_of_process_job_end(self, &job);
+        return statements;
+    }
 
-    jobject name = (*priv->jni_env)->CallStaticObjectMethod(priv->jni_env, priv->class_HBCIUtils, priv->method_HBCIUtils_getNameForBLZ, java_blz);
-    if (name == NULL) {
-        g_warning("empty result\n");
-        result = "";
-        goto clean_blz;
+    jni_env = ghbci_context_get_jni_env (self);
+
+    jobject hbci_handler = get_hbci_handler(self, jni_env, blz, userid);
+    if(hbci_handler == NULL) {
+        ghbci_set_error(error, GHBCI_ERROR_NO_PASSPORT, NULL, GHBCI_RETRY_HINT_NEVER,
+                "no passport added for %s/%s", blz, userid);
+        return NULL;
     }
 
-    const char *nativeString = (*priv->jni_env)->GetStringUTFChars(priv->jni_env, name, 0);
-    // create extra string outside of JVM
-    result = g_strdup (nativeString);
-    (*priv->jni_env)->ReleaseStringUTFChars(priv->jni_env, name, nativeString);
+    JobParams params;
+    job_params_init(&params);
+    job_params_add_account(&params, self, jni_env, blz, userid, number);
+    jobject job = execute_job(self, jni_env, hbci_handler, blz, userid, GHBCI_JAVA_STRING_JOB_KUMS_ALL, &params, TRUE, error);
+    (*jni_env)->DeleteLocalRef(jni_env, hbci_handler);
+    job_params_clear(&params);
+    if (job == NULL) {
+        return NULL;
+    }
 
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, name);
-clean_blz:
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, java_blz);
-    return result;
+    jobject result = (*jni_env)->CallObjectMethod(jni_env, job, priv->method_HBCIJob_getJobResult);
+    if (result == NULL) {
+        set_error_from_exception(self, jni_env, error);
+        goto cleanup_job;
+    }
+    // the pooled strings of these statements only, they go with the last one
+    pool = ghbci_string_pool_new();
+    if (native_mt940) {
+        parse_mt940(self, jni_env, blz, result, pool, &statements, error);
+        goto cleanup_pool;
+    }
+
+    jobject jstatements = (*jni_env)->CallObjectMethod(jni_env, result, priv->method_GVRKUms_getFlatData);
+    if (jstatements == NULL) {
+        set_error_from_exception(self, jni_env, error);
+        goto cleanup_pool;
+    }
+
+    jobject jstatements_iter = (*jni_env)->CallObjectMethod(jni_env, jstatements, priv->method_List_iterator);
+    if (jstatements_iter == NULL) {
+        set_error_from_exception(self, jni_env, error);
+        goto cleanup_jstatements;
+    }
+
+    // the strings pooled or concatenated by the statements, one row at a time
+    GHbciJStringArena arena;
+    ghbci_jstring_arena_init(&arena);
+    while((*jni_env)->CallBooleanMethod(jni_env, jstatements_iter, priv->method_Iterator_hasNext)) {
+        jobject jstatement = (*jni_env)->CallObjectMethod(jni_env, jstatements_iter, priv->method_Iterator_next);
+        if (jstatement == NULL) {
+            set_error_from_exception(self, jni_env, error);
+            failed = TRUE;
+            break;
+        }
+        GHbciStatement* statement = ghbci_statement_new_with_jobject(self, pool, jstatement, &arena);
+        statements = g_slist_prepend (statements, statement);
+        ghbci_jstring_arena_reset(&arena);
+
+        (*jni_env)->DeleteLocalRef(jni_env, jstatement);
+    }
+    // hasNext() throwing ends the loop as well
+    if (!failed && (*jni_env)->ExceptionCheck(jni_env)) {
+        set_error_from_exception(self, jni_env, error);
+        failed = TRUE;
+    }
+    statements = g_slist_reverse(statements);
+    ghbci_jstring_arena_clear(&arena);
+
+    (*jni_env)->DeleteLocalRef(jni_env, jstatements_iter);
+cleanup_jstatements:
+    (*jni_env)->DeleteLocalRef(jni_env, jstatements);
+cleanup_pool:
+    ghbci_string_pool_unref(pool);
+    (*jni_env)->DeleteLocalRef(jni_env, result);
+cleanup_job:
+    (*jni_env)->DeleteLocalRef(jni_env, job);
+    // all or nothing, a partial list would look complete
+    if (failed) {
+        g_slist_free_full(statements, g_object_unref);
+        statements = NULL;
+    }
+    return statements;
 }
 
+
+/* size of the chunks a camt document is read in */
+#define CAMT_CHUNK_SIZE     16384
+
 /**
- * ghbci_context_get_pin_tan_url_for_blz:
+ * ghbci_context_read_camt:
  * @self: The #GHbciContext
- * @blz: BLZ to resolve
+ * @stream: a #GInputStream with a camt.052 account report or camt.053 statement
+ * @cancellable: (nullable): a #GCancellable
+ * @error: return location for a #GError
  *
- * get pin-tan url for BLZ
+ * Decode the booked entries of a camt document, e.g. one downloaded with
+ * another client. The document is read in chunks and never held in memory
+ * completely. The fields of the entries map to the properties of the
+ * statements directly, so they need no ghbci_statement_prettify_statement().
+ * Fails with %GHBCI_ERROR_INVALID_DATA if the document is malformed.
  *
- * Returns: (transfer full): url
+ * Returns: (element-type GHbciStatement) (transfer full): List of #GHbciStatement objects
  **/
-const gchar*
-ghbci_context_get_pin_tan_url_for_blz (GHbciContext* self, const gchar* blz)
+GSList*
+ghbci_context_read_camt (GHbciContext* self, GInputStream* stream, GCancellable* cancellable, GError** error)
 {
-    GHbciContextPrivate* priv;
-    const gchar* result;
+    GSList* statements = NULL;
+    GError* decode_error = NULL;
+    gboolean success = TRUE;
+    gssize length;
 
-    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), "");
-    priv = self->priv;
+    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), NULL);
+    g_return_val_if_fail (G_IS_INPUT_STREAM (stream), NULL);
+    GHBCI_INSTRUMENT (self, G_STRFUNC);
+
+    gint64 start = g_get_monotonic_time();
+    gchar* buffer = g_malloc(CAMT_CHUNK_SIZE);
+    // NULL: a pool for the statements of this document
+    GHbciCamtDecoder* decoder = ghbci_camt_decoder_new(NULL, prepend_statement, &statements);
+
+    while (success && (length = g_input_stream_read(stream, buffer, CAMT_CHUNK_SIZE, cancellable, error)) > 0)
+        success = ghbci_camt_decoder_feed(decoder, buffer, length, &decode_error);
+    if (length < 0) {
+        success = FALSE;
+    } else if (success) {
+        success = ghbci_camt_decoder_finish(decoder, &decode_error);
+    }
+    if (decode_error != NULL) {
+        ghbci_set_error(error, GHBCI_ERROR_INVALID_DATA, NULL, GHBCI_RETRY_HINT_NEVER,
+                "invalid camt document: %s", decode_error->message);
+        g_error_free(decode_error);
+    }
 
-    jstring java_blz = (*priv->jni_env)->NewStringUTF(priv->jni_env, blz);
+    ghbci_camt_decoder_free(decoder);
+    g_free(buffer);
+    ghbci_metrics_record(self->priv->metrics, "camt", NULL, NULL, g_get_monotonic_time() - start);
 
-    // url = HBCIUtils.getPinTanURLForBLZ(blz)
-    jobject url = (*priv->jni_env)->CallStaticObjectMethod(priv->jni_env,
-            priv->class_HBCIUtils, priv->method_HBCIUtils_getPinTanURLForBLZ, java_blz);
-    if (url == NULL) {
-        g_warning("empty result\n");
-        result = "";
-        goto clean_blz;
+    if (!success) {
+        g_slist_free_full(statements, g_object_unref);
+        return NULL;
     }
+    return g_slist_reverse(statements);
+}
 
-    // create extra string outside of JVM
-    const char *nativeString = (*priv->jni_env)->GetStringUTFChars(priv->jni_env, url, 0);
-    result = g_strdup (nativeString);
-    (*priv->jni_env)->ReleaseStringUTFChars(priv->jni_env, url, nativeString);
+/**
+ * ghbci_context_send_transfer:
+ * @self: The #GHbciContext
+ * @blz: blz
+ * @userid: userid
+ * @number: account number
+ * @destination_name: name of recipient
+ * @destination_bic: bic
+ * @destination_iban: iban
+ * @reference: reference used in transfer
+ * @amount: amount to transfer
+ * @error: return location for a #GError
+ *
+ * Send SEPA transfer
+ *
+ * Returns: true if successful
+ **/
+gboolean
+ghbci_context_send_transfer (GHbciContext* self, const gchar* blz, const gchar* userid, const gchar* number,
+        const gchar* source_name, const gchar* source_bic, const gchar* source_iban,
+        const gchar* destination_name, const gchar* destination_bic, const gchar* destination_iban,
+        const gchar* reference, const gchar* amount, GError** error)
+{
+    JobParams params;
+    gboolean result;
 
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, url);
-clean_blz:
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, java_blz);
+    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), FALSE);
+    GHBCI_INSTRUMENT (self, G_STRFUNC);
+
+    const GHbciTransfer transfer = {
+        (gchar*)destination_name,
+        (gchar*)destination_bic,
+        (gchar*)destination_iban,
+        (gchar*)reference,
+        (gchar*)amount,
+        NULL
+    };
+    if (!ghbci_transfer_check_account(source_name, source_bic, source_iban, error)
+            || !ghbci_transfer_validate(&transfer, error))
+        return FALSE;
+    if (is_out_of_process(self))
+        return send_worker_transfer(self, blz, userid, number, source_name, source_bic, source_iban, &transfer,
+                NULL, NULL, error);
+
+    job_params_init(&params);
+    job_params_add_source(&params, blz, number, source_name, source_bic, source_iban);
+    job_params_add_transfer(&params, &transfer, -1);
+    result = send_transfer_job(self, blz, userid, GHBCI_JAVA_STRING_JOB_UEB_SEPA, &params, NULL, error);
+    job_params_clear(&params);
     return result;
 }
 
 /**
- * ghbci_context_blz_foreach:
+ * ghbci_context_send_scheduled_transfer:
  * @self: The #GHbciContext
- * @func: (scope call): function called for each bank
- * @user_data: data for @func
+ * @blz: blz
+ * @userid: userid
+ * @number: account number
+ * @source_name: name of the account holder
+ * @source_bic: bic of the account
+ * @source_iban: iban of the account
+ * @transfer: the transfer
+ * @date: day the bank executes @transfer
+ * @order_id: (out) (optional) (transfer full) (nullable): return location
+ *   for the id the bank assigned, %NULL if the bank didn't tell
+ * @error: return location for a #GError
  *
- * iterator over list of german banks included with hbci4java and call the
- * callback for each of them
+ * Send a SEPA transfer the bank executes at @date (TermUebSEPA)
+ *
+ * Returns: true if the bank accepted the transfer
  **/
-void
-ghbci_context_blz_foreach (GHbciContext* self, GHbciBlzFunc func, gpointer user_data)
+gboolean
+ghbci_context_send_scheduled_transfer (GHbciContext* self, const gchar* blz, const gchar* userid,
+        const gchar* number, const gchar* source_name, const gchar* source_bic, const gchar* source_iban,
+        const GHbciTransfer* transfer, const GDate* date, gchar** order_id, GError** error)
 {
-    GHbciContextPrivate* priv;
-
-    g_return_if_fail (GHBCI_IS_CONTEXT (self));
-    g_return_if_fail (func != NULL);
-    priv = self->priv;
-
-    jobject blzs = (*priv->jni_env)->GetStaticObjectField(priv->jni_env, priv->class_HBCIUtilsInternal, priv->field_HBCIUtilsInternal_blzs);
-
-    jobject blzs_keys = (*priv->jni_env)->CallObjectMethod(priv->jni_env, blzs, priv->method_Properties_keys);
+    JobParams params;
+    gboolean result;
 
-    while((*priv->jni_env)->CallBooleanMethod(priv->jni_env, blzs_keys, priv->method_Enumeration_hasMoreElements)) {
-
-        jobject element = (*priv->jni_env)->CallObjectMethod(priv->jni_env, blzs_keys, priv->method_Enumeration_nextElement);
-
-        const gchar* nativeString = (*priv->jni_env)->GetStringUTFChars(priv->jni_env, element, 0);
-        (*func) (nativeString, user_data);
-        (*priv->jni_env)->ReleaseStringUTFChars(priv->jni_env, element, nativeString);
+    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), FALSE);
+    g_return_val_if_fail (transfer != NULL, FALSE);
+    g_return_val_if_fail (date != NULL, FALSE);
+    GHBCI_INSTRUMENT (self, G_STRFUNC);
 
-        (*priv->jni_env)->DeleteLocalRef(priv->jni_env, element);
+    if (!ghbci_transfer_check_account(source_name, source_bic, source_iban, error)
+            || !ghbci_transfer_validate(transfer, error))
+        return FALSE;
+    if (!g_date_valid(date)) {
+        ghbci_set_error(error, GHBCI_ERROR_INVALID_DATA, NULL, GHBCI_RETRY_HINT_NEVER, "invalid execution date");
+        return FALSE;
     }
-
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, blzs_keys);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, blzs);
-    return;
+    if (!check_job_supported(self, blz, userid, "TermUebSEPA", error))
+        return FALSE;
+    if (is_out_of_process(self))
+        return send_worker_transfer(self, blz, userid, number, source_name, source_bic, source_iban, transfer,
+                date, order_id, error);
+
+    gchar* execution_date = ghbci_format_iso_date(date);
+    job_params_init(&params);
+    job_params_add_source(&params, blz, number, source_name, source_bic, source_iban);
+    job_params_add_transfer(&params, transfer, -1);
+    job_params_add(&params, GHBCI_JAVA_STRING_DATE, execution_date);
+    result = send_transfer_job(self, blz, userid, GHBCI_JAVA_STRING_JOB_TERM_UEB_SEPA, &params, order_id, error);
+    job_params_clear(&params);
+    g_free(execution_date);
+    return result;
 }
 
 /**
- * ghbci_context_add_passport:
+ * ghbci_context_create_standing_order:
  * @self: The #GHbciContext
  * @blz: blz
  * @userid: userid
+ * @number: account number
+ * @source_name: name of the account holder
+ * @source_bic: bic of the account
+ * @source_iban: iban of the account
+ * @order: the standing order, @order_id is ignored
+ * @order_id: (out) (optional) (transfer full) (nullable): return location
+ *   for the id the bank assigned, %NULL if the bank didn't tell
+ * @error: return location for a #GError
  *
- * Add bank account to passport file. Triggers #callback signal for additional
- * account details and credentials and fetches account capabilities online.
+ * Create a standing order at the bank (DauerSEPANew)
  *
- * Returns: TRUE if successful
+ * Returns: true if the bank accepted the standing order
  **/
 gboolean
-ghbci_context_add_passport (GHbciContext* self, const gchar* blz, const gchar* userid)
+ghbci_context_create_standing_order (GHbciContext* self, const gchar* blz, const gchar* userid,
+        const gchar* number, const gchar* source_name, const gchar* source_bic, const gchar* source_iban,
+        const GHbciStandingOrder* order, gchar** order_id, GError** error)
 {
-    GHbciContextPrivate* priv;
+    JobParams params;
+    gchar time_unit[2] = { 0, 0 };
+    gchar turnus[16], exec_day[16];
+    gboolean result;
 
     g_return_val_if_fail (GHBCI_IS_CONTEXT (self), FALSE);
-    g_return_val_if_fail (blz != NULL, FALSE);
-    g_return_val_if_fail (userid != NULL, FALSE);
-    priv = self->priv;
-
-    gchar* key = g_strconcat(blz, "+", userid, NULL);
-
-    // set passport filename
-    gchar* filename = g_strconcat(priv->passport_directory, "/passport-", key, ".dat", NULL);
-    jstring filename_key = (*priv->jni_env)->NewStringUTF(priv->jni_env, "client.passport.PinTan.filename");
-    jstring filename_value = (*priv->jni_env)->NewStringUTF(priv->jni_env, filename);
-    (*priv->jni_env)->CallStaticVoidMethod(priv->jni_env, priv->class_HBCIUtils, priv->method_HBCIUtils_setParam, filename_key, filename_value);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, filename_key);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, filename_value);
-
-    if (g_slist_find_custom(priv->passports, filename, (GCompareFunc)g_strcmp0) == NULL) {
-        priv->passports = g_slist_prepend(priv->passports, filename);
-    } else {
-        g_free(filename);
-    }
-
-    // force check certificates
-    jstring checkcert_key = (*priv->jni_env)->NewStringUTF(priv->jni_env, "client.passport.PinTan.checkcert");
-    jstring checkcert_value = (*priv->jni_env)->NewStringUTF(priv->jni_env, "1");
-    (*priv->jni_env)->CallStaticVoidMethod(priv->jni_env, priv->class_HBCIUtils, priv->method_HBCIUtils_setParam, checkcert_key, checkcert_value);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, checkcert_key);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, checkcert_value);
-
-    // require reinitialization of pinTan
-    jstring pinTanInit_key = (*priv->jni_env)->NewStringUTF(priv->jni_env, "client.passport.PinTan.init");
-    jstring pinTanInit_value = (*priv->jni_env)->NewStringUTF(priv->jni_env, "1");
-    (*priv->jni_env)->CallStaticVoidMethod(priv->jni_env, priv->class_HBCIUtils, priv->method_HBCIUtils_setParam, pinTanInit_key, pinTanInit_value);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, pinTanInit_key);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, pinTanInit_value);
-
-    // set log level
-    jstring loglevel_key = (*priv->jni_env)->NewStringUTF(priv->jni_env, "log.loglevel.default");
-    jstring loglevel_value = (*priv->jni_env)->NewStringUTF(priv->jni_env, "5");
-    (*priv->jni_env)->CallStaticVoidMethod(priv->jni_env, priv->class_HBCIUtils, priv->method_HBCIUtils_setParam, loglevel_key, loglevel_value);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, loglevel_key);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, loglevel_value);
-
-    // create HBCIPassport object
-    jstring type = (*priv->jni_env)->NewStringUTF(priv->jni_env, "PinTan");
-    jobject passport = (*priv->jni_env)->CallStaticObjectMethod(priv->jni_env, priv->class_AbstractHBCIPassport, priv->method_AbstractHBCIPassport_getInstance, type);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, type);
+    g_return_val_if_fail (order != NULL, FALSE);
+    GHBCI_INSTRUMENT (self, G_STRFUNC);
 
-    if (passport == NULL) {
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
+    if (!ghbci_transfer_check_account(source_name, source_bic, source_iban, error)
+            || !ghbci_standing_order_validate(order, error))
         return FALSE;
-    }
-
-    // create HBCIHandler from passport
-    jstring version = (*priv->jni_env)->NewStringUTF(priv->jni_env, "300");
-    jobject handler = (*priv->jni_env)->NewObject(priv->jni_env, priv->class_HBCIHandler, priv->method_HBCIHandler_constructor, version, passport);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, version);
-
-    if (handler == NULL) {
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
-        (*priv->jni_env)->DeleteLocalRef(priv->jni_env, passport);
+    if (!check_job_supported(self, blz, userid, "DauerSEPANew", error))
         return FALSE;
-    }
-    
-    g_hash_table_insert(priv->hbci_handlers, key, handler);
-    return TRUE;
+    if (is_out_of_process(self))
+        return take_worker_order_id(request_worker_job(self, blz, userid, GHBCI_JAVA_STRING_JOB_DAUER_SEPA_NEW,
+                    GHBCI_WORKER_CREATE_STANDING_ORDER,
+                    g_variant_new("(ssssss@" GHBCI_WORKER_ORDER_TYPE ")", blz, userid, number, source_name,
+                        source_bic != NULL ? source_bic : "", source_iban,
+                        ghbci_worker_standing_order_to_variant(order)),
+                    G_VARIANT_TYPE("ms"), error), order_id);
+
+    gchar* first_date = ghbci_format_iso_date(order->first_date);
+    gchar* last_date = order->last_date != NULL ? ghbci_format_iso_date(order->last_date) : NULL;
+    time_unit[0] = order->time_unit;
+    g_snprintf(turnus, sizeof(turnus), "%u", order->turnus);
+    g_snprintf(exec_day, sizeof(exec_day), "%u", order->exec_day);
+
+    job_params_init(&params);
+    job_params_add_source(&params, blz, number, source_name, source_bic, source_iban);
+    job_params_add_transfer(&params, &order->transfer, -1);
+    job_params_add(&params, GHBCI_JAVA_STRING_FIRST_DATE, first_date);
+    job_params_add(&params, GHBCI_JAVA_STRING_TIME_UNIT, time_unit);
+    job_params_add(&params, GHBCI_JAVA_STRING_TURNUS, turnus);
+    job_params_add(&params, GHBCI_JAVA_STRING_EXEC_DAY, exec_day);
+    job_params_add(&params, GHBCI_JAVA_STRING_LAST_DATE, last_date);
+    result = send_transfer_job(self, blz, userid, GHBCI_JAVA_STRING_JOB_DAUER_SEPA_NEW, &params, order_id, error);
+    job_params_clear(&params);
+    g_free(last_date);
+    g_free(first_date);
+    return result;
 }
 
 /**
- * ghbci_context_get_accounts:
+ * ghbci_context_get_standing_orders:
  * @self: The #GHbciContext
  * @blz: blz
  * @userid: userid
+ * @number: account number
+ * @source_bic: bic of the account
+ * @source_iban: iban of the account
+ * @error: return location for a #GError
  *
- * Get list of bank accounts visible by this userid
+ * Fetch the standing orders of an account (DauerSEPAList). The result is
+ * fetched from hbci4java in one piece and decoded natively.
  *
- * Returns: (element-type GHbciAccount) (transfer full): List of #GHbciAccount objects
+ * Returns: (element-type GHbciStandingOrder) (transfer full): List of
+ *   #GHbciStandingOrder, free with ghbci_standing_order_free()
  **/
 GSList*
-ghbci_context_get_accounts (GHbciContext* self, const gchar* blz, const gchar* userid)
+ghbci_context_get_standing_orders (GHbciContext* self, const gchar* blz, const gchar* userid,
+        const gchar* number, const gchar* source_bic, const gchar* source_iban, GError** error)
 {
-    GHbciContextPrivate* priv;
-    GSList *account_list = NULL;
+    JNIEnv* jni_env;
+    JobParams params;
+    GSList* orders = NULL;
+    guint i;
 
     g_return_val_if_fail (GHBCI_IS_CONTEXT (self), NULL);
-    priv = self->priv;
+    GHBCI_INSTRUMENT (self, G_STRFUNC);
 
-    jobject hbci_handler = get_hbci_handler(self, blz, userid);
-    if(hbci_handler == NULL) {
-        g_warning("no handler found");
+    if (!ghbci_transfer_check_iban(source_iban)) {
+        ghbci_set_error(error, GHBCI_ERROR_INVALID_DATA, NULL, GHBCI_RETRY_HINT_NEVER,
+                "invalid IBAN: %s", source_iban != NULL ? source_iban : "");
         return NULL;
     }
 
-    // get passport from HBCIHandler
-    jobject passport = (*priv->jni_env)->CallObjectMethod(priv->jni_env, hbci_handler, priv->method_HBCIHandler_getPassport);
-    if (passport == NULL) {
-        g_warning("creating passport failed");
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
-        return NULL;
+    if (is_out_of_process(self)) {
+        GVariant* reply = request_worker_job(self, blz, userid, GHBCI_JAVA_STRING_JOB_DAUER_SEPA_LIST,
+                GHBCI_WORKER_GET_STANDING_ORDERS,
+                g_variant_new("(sssss)", blz, userid, number, source_bic != NULL ? source_bic : "", source_iban),
+                G_VARIANT_TYPE("a" GHBCI_WORKER_ORDER_TYPE), error);
+        GVariant* child;
+        GVariantIter iter;
+
+        if (reply == NULL)
+            return NULL;
+        g_variant_iter_init(&iter, reply);
+        while ((child = g_variant_iter_next_value(&iter)) != NULL) {
+            orders = g_slist_prepend(orders, ghbci_worker_standing_order_from_variant(child));
+            g_variant_unref(child);
+        }
+        g_variant_unref(reply);
+        return g_slist_reverse(orders);
     }
 
-    // get accounts
-    jobject accounts = (*priv->jni_env)->CallObjectMethod(priv->jni_env, passport, priv->method_HBCIPassport_getAccounts);
-    if (accounts == NULL) {
-        g_warning("fetching accounts failed");
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
-        (*priv->jni_env)->DeleteLocalRef(priv->jni_env, passport);
+    jni_env = ghbci_context_get_jni_env (self);
+
+    jobject hbci_handler = get_hbci_handler(self, jni_env, blz, userid);
+    if(hbci_handler == NULL) {
+        ghbci_set_error(error, GHBCI_ERROR_NO_PASSPORT, NULL, GHBCI_RETRY_HINT_NEVER,
+                "no passport added for %s/%s", blz, userid);
         return NULL;
     }
-    int i;
-    for(i = 0; i < (*priv->jni_env)->GetArrayLength(priv->jni_env, accounts); i++) {
-        jobject element = (*priv->jni_env)->GetObjectArrayElement(priv->jni_env, accounts, i);
 
-        GHbciAccount* account = ghbci_account_new_with_jobject(self, element);
-        account_list = g_slist_append (account_list, account);
+    job_params_init(&params);
+    job_params_add_source(&params, blz, number, NULL, source_bic, source_iban);
+    jobject job = execute_job(self, jni_env, hbci_handler, blz, userid, GHBCI_JAVA_STRING_JOB_DAUER_SEPA_LIST,
+            &params, TRUE, error);
+    (*jni_env)->DeleteLocalRef(jni_env, hbci_handler);
+    job_params_clear(&params);
+    if (job == NULL)
+        return NULL;
 
-        gchar* number;
-        g_object_get(account, "number", &number, NULL);
+    GHashTable* data = get_result_data(self, jni_env, job, error);
+    (*jni_env)->DeleteLocalRef(jni_env, job);
+    if (data == NULL)
+        return NULL;
 
-        char* key = g_strconcat(blz, "+", userid, "+", number, NULL);
-        g_hash_table_insert(priv->accounts, key, element);
+    // one response segment per standing order: content, content_2, ...
+    for (i = 1; ; i++) {
+        GError* order_error = NULL;
+        gchar* prefix = i == 1 ? g_strdup("content.") : g_strdup_printf("content_%u.", i);
+        gchar* key = g_strconcat(prefix, "orderid", NULL);
+        gboolean found = g_hash_table_contains(data, key);
+        g_free(key);
+        if (!found) {
+            g_free(prefix);
+            break;
+        }
 
-        g_free (number);
+        GHbciStandingOrder* order = ghbci_standing_order_new_from_result(data, prefix, &order_error);
+        if (order != NULL) {
+            orders = g_slist_prepend(orders, order);
+        } else {
+            g_warning("skipping standing order %s: %s", prefix, order_error->message);
+            g_error_free(order_error);
+        }
+        g_free(prefix);
     }
-
-    return account_list;
+    g_hash_table_unref(data);
+    return g_slist_reverse(orders);
 }
 
 /**
- * ghbci_context_get_tan_methods:
+ * ghbci_context_send_transfers:
  * @self: The #GHbciContext
  * @blz: blz
  * @userid: userid
+ * @number: account number
+ * @source_name: name of the account holder
+ * @source_bic: bic of the account
+ * @source_iban: iban of the account
+ * @transfers: (array length=n_transfers): transfers to send
+ * @n_transfers: number of transfers
+ * @error: return location for a #GError
  *
- * Get list of tan methods supported by this account
+ * Send many SEPA transfers in one dialog. If the bank supports collective
+ * transfers (SammelUebSEPA), they are sent as few collective transfers
+ * within the size limit of the bank, else as one single transfer each.
  *
- * Returns: (element-type gchar* gchar*) (transfer full): List of tan methods
+ * All transfers are checked before the bank is contacted: their pain.001
+ * document as ghbci_transfer_write_pain001() writes it is validated against
+ * the schema. This is a check of the input only, hbci4java renders the
+ * document sent to the bank itself. If the bank rejects a part, the error
+ * names the first rejected transfers, the others may have been executed.
+ *
+ * Returns: true if the bank accepted all transfers
  **/
-GHashTable*
-ghbci_context_get_tan_methods (GHbciContext* self, const gchar* blz, const gchar* userid)
+gboolean
+ghbci_context_send_transfers (GHbciContext* self, const gchar* blz, const gchar* userid, const gchar* number,
+        const gchar* source_name, const gchar* source_bic, const gchar* source_iban,
+        const GHbciTransfer* transfers, guint n_transfers, GError** error)
 {
     GHbciContextPrivate* priv;
-    GHashTable *tan_methods_result = NULL;
+    JNIEnv* jni_env;
+    GHbciCapabilities* capabilities;
+    CallbackScope scope;
+    gboolean collective = FALSE;
+    guint batch_size = 1;
+    guint n_jobs, i;
 
-    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), NULL);
+    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), FALSE);
+    g_return_val_if_fail (n_transfers == 0 || transfers != NULL, FALSE);
+    GHBCI_INSTRUMENT (self, G_STRFUNC);
     priv = self->priv;
 
-    jobject hbci_handler = get_hbci_handler(self, blz, userid);
-    if(hbci_handler == NULL) {
-        g_warning("no handler found");
-        return NULL;
+    if (!ghbci_transfer_check_account(source_name, source_bic, source_iban, error))
+        return FALSE;
+    for (i = 0; i < n_transfers; i++) {
+        GError* transfer_error = NULL;
+        if (!ghbci_transfer_validate(&transfers[i], &transfer_error)) {
+            g_propagate_prefixed_error(error, transfer_error, "transfer %u: ", i);
+            return FALSE;
+        }
+    }
+    if (n_transfers == 0)
+        return TRUE;
+
+    capabilities = lookup_capabilities(self, blz, userid);
+    if (capabilities != NULL && n_transfers > 1 && ghbci_capabilities_supports_job(capabilities, "SammelUebSEPA")) {
+        gint64 maxnum = ghbci_capabilities_get_job_parameter_int(capabilities, "SammelUebSEPA", "maxnum",
+                MAX_BATCH_TRANSFERS);
+        collective = TRUE;
+        batch_size = CLAMP(maxnum, 1, MAX_BATCH_TRANSFERS);
+    }
+    if (capabilities != NULL)
+        ghbci_capabilities_unref(capabilities);
+    n_jobs = (n_transfers + batch_size - 1) / batch_size;
+
+    if (is_out_of_process(self)) {
+        GVariantBuilder builder;
+        GVariant* reply;
+
+        // the worker splits them the same way, the capabilities are shared
+        g_variant_builder_init(&builder, G_VARIANT_TYPE("a" GHBCI_WORKER_TRANSFER_TYPE));
+        for (i = 0; i < n_transfers; i++)
+            g_variant_builder_add_value(&builder, ghbci_worker_transfer_to_variant(&transfers[i]));
+        reply = request_worker_job(self, blz, userid,
+                collective ? GHBCI_JAVA_STRING_JOB_MULTI_UEB_SEPA : GHBCI_JAVA_STRING_JOB_UEB_SEPA,
+                GHBCI_WORKER_SEND_TRANSFERS,
+                g_variant_new("(ssssss@a" GHBCI_WORKER_TRANSFER_TYPE ")", blz, userid, number, source_name,
+                    source_bic != NULL ? source_bic : "", source_iban, g_variant_builder_end(&builder)),
+                G_VARIANT_TYPE_UNIT, error);
+        if (reply == NULL)
+            return FALSE;
+        g_variant_unref(reply);
+        return TRUE;
     }
 
-    // get passport from HBCIHandler
-    jobject passport = (*priv->jni_env)->CallObjectMethod(priv->jni_env, hbci_handler, priv->method_HBCIHandler_getPassport);
-    if (passport == NULL) {
-        g_warning("creating passport failed");
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
-        return NULL;
+    jni_env = ghbci_context_get_jni_env (self);
+    jobject hbci_handler = get_hbci_handler(self, jni_env, blz, userid);
+    if(hbci_handler == NULL) {
+        ghbci_set_error(error, GHBCI_ERROR_NO_PASSPORT, NULL, GHBCI_RETRY_HINT_NEVER,
+                "no passport added for %s/%s", blz, userid);
+        return FALSE;
     }
 
-    (*priv->jni_env)->CallVoidMethod(priv->jni_env, passport, priv->method_AbstractPinTanPassport_setCurrentTANMethod, NULL);
+    // pre-check the input against the schema before asking for a TAN, hbci4java
+    // renders the pain.001 sent to the bank itself, only the message ids are shared
+    gchar** message_ids = g_new0(gchar*, n_jobs + 1);
+    for (i = 0; i < n_jobs; i++) {
+        guint first = i * batch_size;
+        guint count = MIN(batch_size, n_transfers - first);
+        GOutputStream* stream = g_memory_output_stream_new_resizable();
+        gboolean valid;
+
+        message_ids[i] = ghbci_transfer_new_message_id();
+        valid = ghbci_transfer_write_pain001(stream, message_ids[i], source_name, source_bic, source_iban,
+                    &transfers[first], count, FALSE, NULL, error)
+                && g_output_stream_close(stream, NULL, error)
+                && validate_pain001(self, jni_env,
+                    g_memory_output_stream_get_data(G_MEMORY_OUTPUT_STREAM(stream)),
+                    g_memory_output_stream_get_data_size(G_MEMORY_OUTPUT_STREAM(stream)), error);
+        g_object_unref(stream);
+        if (!valid) {
+            (*jni_env)->DeleteLocalRef(jni_env, hbci_handler);
+            g_strfreev(message_ids);
+            return FALSE;
+        }
+    }
 
-    // get tan methods
-    jobject tan_methods = (*priv->jni_env)->CallObjectMethod(priv->jni_env, passport, priv->method_AbstractPinTanPassport_getTwostepMechanisms);
-    if (tan_methods == NULL) {
-        g_warning("fetching tan methods failed");
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
-        goto cleanup_passport;
+    JobParams source;
+    job_params_init(&source);
+    job_params_add_source(&source, blz, number, source_name, source_bic, source_iban);
+
+    gchar* limit_key = get_rate_limit_key(self, jni_env, blz);
+    gchar* passport_key = g_strconcat(blz, "+", userid, NULL);
+    callback_scope_push(&scope, blz, userid, passport_key, limit_key);
+
+    // all jobs go into one dialog, so at most one TAN is needed
+    (*jni_env)->CallVoidMethod(jni_env, hbci_handler, priv->method_HBCIHandler_reset);
+    (*jni_env)->EnsureLocalCapacity(jni_env, n_jobs + 16);
+    jobject* jobs = g_new0(jobject, n_jobs);
+    gboolean success = TRUE;
+    for (i = 0; i < n_jobs; i++) {
+        guint first = i * batch_size;
+        jobs[i] = queue_transfer_job(self, jni_env, hbci_handler, collective, &source, message_ids[i],
+                &transfers[first], MIN(batch_size, n_transfers - first));
+        if (jobs[i] == NULL) {
+            GError* job_error = NULL;
+            set_error_from_exception(self, jni_env, &job_error);
+            g_propagate_prefixed_error(error, job_error, "transfer %u: ", first);
+            success = FALSE;
+            break;
+        }
     }
 
-    // get allowed tan methods
-    jobject allowed_tan_methods = (*priv->jni_env)->CallObjectMethod(priv->jni_env, passport, priv->method_AbstractPinTanPassport_getAllowedTwostepMechanisms);
-    if (allowed_tan_methods == NULL) {
-        g_warning("fetching allowed tan methods failed");
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
-        goto cleanup_tan_methods;
+    if (success) {
+        // moves money, so no retry
+        jobject status = execute_queue(self, jni_env, hbci_handler, blz,
+                java_string_text[collective ? GHBCI_JAVA_STRING_JOB_MULTI_UEB_SEPA : GHBCI_JAVA_STRING_JOB_UEB_SEPA],
+                limit_key);
+        if (status == NULL) {
+            set_error_from_exception(self, jni_env, error);
+            success = FALSE;
+        }
+        for (i = 0; success && i < n_jobs; i++) {
+            GError* job_error = NULL;
+            guint first = i * batch_size;
+            if (!check_job_result(self, jni_env, jobs[i], status, &job_error)) {
+                if (collective)
+                    g_propagate_prefixed_error(error, job_error, "transfers %u to %u: ", first,
+                            MIN(first + batch_size, n_transfers) - 1);
+                else
+                    g_propagate_prefixed_error(error, job_error, "transfer %u: ", first);
+                success = FALSE;
+            }
+        }
+        if (status != NULL)
+            (*jni_env)->DeleteLocalRef(jni_env, status);
     }
 
-    jobject tan_methods_keys = (*priv->jni_env)->CallObjectMethod(priv->jni_env, tan_methods, priv->method_Properties_keys);
+    for (i = 0; i < n_jobs; i++) {
+        if (jobs[i] != NULL)
+            (*jni_env)->DeleteLocalRef(jni_env, jobs[i]);
+    }
+    g_free(jobs);
+    (*jni_env)->DeleteLocalRef(jni_env, hbci_handler);
+    job_params_clear(&source);
+    callback_scope_pop(&scope);
+    g_free(passport_key);
+    g_free(limit_key);
+    g_strfreev(message_ids);
+    return success;
+}
 
-    jstring name_str = (*priv->jni_env)->NewStringUTF(priv->jni_env, "name");
+/**
+ * ghbci_context_validate_pain001:
+ * @self: The #GHbciContext
+ * @document: pain.001.003.03 document, e.g. written by
+ *   ghbci_transfer_write_pain001()
+ * @error: return location for a #GError
+ *
+ * Validate @document against the pain.001.003.03 schema bundled with
+ * hbci4java
+ *
+ * Returns: true if @document is valid
+ **/
+gboolean
+ghbci_context_validate_pain001 (GHbciContext* self, GBytes* document, GError** error)
+{
+    JNIEnv* jni_env;
+    gsize size;
+    gconstpointer data;
 
-    tan_methods_result = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), FALSE);
+    g_return_val_if_fail (document != NULL, FALSE);
+    GHBCI_INSTRUMENT (self, G_STRFUNC);
+
+    if (is_out_of_process(self)) {
+        GVariant* reply = request_workers(self, NULL, NULL, GHBCI_WORKER_VALIDATE_PAIN001,
+                g_variant_new_from_bytes(G_VARIANT_TYPE_BYTESTRING, document, TRUE), G_VARIANT_TYPE_UNIT, error);
+        if (reply == NULL)
+            return FALSE;
+        g_variant_unref(reply);
+        return TRUE;
+    }
 
-    while((*priv->jni_env)->CallBooleanMethod(priv->jni_env, tan_methods_keys, priv->method_Enumeration_hasMoreElements)) {
+    jni_env = ghbci_context_get_jni_env (self);
 
-        jobject key = (*priv->jni_env)->CallObjectMethod(priv->jni_env, tan_methods_keys, priv->method_Enumeration_nextElement);
+    data = g_bytes_get_data(document, &size);
+    return validate_pain001(self, jni_env, data, size, error);
+}
 
-        if ((*priv->jni_env)->CallBooleanMethod(priv->jni_env, allowed_tan_methods, priv->method_List_contains, key)) {
-            jobject properties = (*priv->jni_env)->CallObjectMethod(priv->jni_env, tan_methods, priv->method_Hashtable_get, key);
-            jobject name = (*priv->jni_env)->CallObjectMethod(priv->jni_env, properties, priv->method_Properties_getProperty, name_str);
+/**
+ * ghbci_context_get_metrics:
+ * @self: The #GHbciContext
+ *
+ * Get latency histograms of all jobs run by this context
+ *
+ * Returns: (transfer none): metrics of this context
+ **/
+GHbciMetrics*
+ghbci_context_get_metrics (GHbciContext* self)
+{
+    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), NULL);
 
-            const gchar* native_key = (*priv->jni_env)->GetStringUTFChars(priv->jni_env, key, 0);
-            const gchar* native_name = (*priv->jni_env)->GetStringUTFChars(priv->jni_env, name, 0);
+    return self->priv->metrics;
+}
 
-            g_hash_table_insert(tan_methods_result, g_strdup(native_key), g_strdup(native_name));
+/**
+ * ghbci_context_set_log_sink:
+ * @self: The #GHbciContext
+ * @func: (nullable) (scope notified) (closure user_data) (destroy notify): sink for log
+ *   messages, %NULL to use the #GHbciContext::log signal again
+ * @user_data: data for @func
+ * @notify: called when @user_data is no longer needed
+ *
+ * Log messages of hbci4java are queued and delivered by a background
+ * thread, so a slow handler doesn't stall a dialog with the bank. By
+ * default they are emitted as #GHbciContext::log signal from that thread,
+ * a sink replaces the signal.
+ **/
+void
+ghbci_context_set_log_sink (GHbciContext* self, GHbciLogSinkFunc func, gpointer user_data, GDestroyNotify notify)
+{
+    GHbciContextPrivate* priv;
+    GHbciLogSink* sink = NULL;
+    GHbciLogSink* old_sink;
 
-            (*priv->jni_env)->ReleaseStringUTFChars(priv->jni_env, name, native_name);
-            (*priv->jni_env)->ReleaseStringUTFChars(priv->jni_env, key, native_key);
+    g_return_if_fail (GHBCI_IS_CONTEXT (self));
+    priv = self->priv;
 
-            (*priv->jni_env)->DeleteLocalRef(priv->jni_env, properties);
-            (*priv->jni_env)->DeleteLocalRef(priv->jni_env, name);
-        }
-        (*priv->jni_env)->DeleteLocalRef(priv->jni_env, key);
+    if (func != NULL) {
+        sink = g_new(GHbciLogSink, 1);
+        sink->ref_count = 1;
+        sink->func = func;
+        sink->user_data = user_data;
+        sink->notify = notify;
     }
 
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, name_str);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, tan_methods_keys);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, allowed_tan_methods);
-cleanup_tan_methods:
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, tan_methods);
-cleanup_passport:
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, passport);
+    g_mutex_lock(&priv->log_lock);
+    old_sink = priv->log_sink;
+    g_atomic_pointer_set(&priv->log_sink, sink);
+    g_mutex_unlock(&priv->log_lock);
 
-    return tan_methods_result;
+    // a record being delivered keeps the old sink until it returns
+    if (old_sink != NULL)
+        log_sink_unref(old_sink);
 }
 
 /**
- * ghbci_context_get_balances:
+ * ghbci_context_get_log_tail:
  * @self: The #GHbciContext
- * @blz: blz
- * @userid: userid
- * @number: number of account to inquery
  *
- * Fetch balances of bank accounts
+ * Get the last log messages of the most recent dialog of the calling
+ * thread, e.g. to dump them after a job failed. Messages are only kept
+ * while a log sink or a #GHbciContext::log handler is set.
  *
- * Returns: (transfer full): balance
+ * Returns: (transfer full) (array zero-terminated=1): log messages, oldest first
  **/
-gchar*
-ghbci_context_get_balances (GHbciContext* self, const gchar* blz, const gchar* userid, const gchar* number)
+gchar**
+ghbci_context_get_log_tail (GHbciContext* self)
 {
     GHbciContextPrivate* priv;
-    gchar *value = NULL;
+    GPtrArray* messages;
+    GQueue* tail;
+    GList* iter;
 
     g_return_val_if_fail (GHBCI_IS_CONTEXT (self), NULL);
     priv = self->priv;
 
-    jobject hbci_handler = get_hbci_handler(self, blz, userid);
-    if(hbci_handler == NULL) {
-        g_warning("no handler found");
-        return NULL;
+    ghbci_log_ring_flush(priv->log_ring);
+
+    messages = g_ptr_array_new();
+    g_mutex_lock(&priv->log_lock);
+    tail = g_hash_table_lookup(priv->log_tails, GUINT_TO_POINTER(status_dialog_get()->serial));
+    if (tail != NULL) {
+        for (iter = tail->head; iter != NULL; iter = iter->next) {
+            g_ptr_array_add(messages, g_strdup(iter->data));
+        }
     }
+    g_mutex_unlock(&priv->log_lock);
+    g_ptr_array_add(messages, NULL);
 
-    // create HBCIJob
-    jstring jobname = (*priv->jni_env)->NewStringUTF(priv->jni_env, "SaldoReq");
-    jobject job = (*priv->jni_env)->CallObjectMethod(priv->jni_env, hbci_handler, priv->method_HBCIHandler_newJob, jobname);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, jobname);
+    return (gchar**)g_ptr_array_free(messages, FALSE);
+}
 
-    if (job == NULL) {
-        g_warning("newJob failed");
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
-        return NULL;
-    }
+/*
+ * Wait until the log messages queued so far are delivered
+ */
+void
+ghbci_context_flush_log (GHbciContext* self)
+{
+    g_return_if_fail (GHBCI_IS_CONTEXT (self));
 
-    // set country
-    jstring country_key = (*priv->jni_env)->NewStringUTF(priv->jni_env, "my.country");
-    jstring country_value = (*priv->jni_env)->NewStringUTF(priv->jni_env, "DE");
-    (*priv->jni_env)->CallObjectMethod(priv->jni_env, job, priv->method_HBCIJob_setParam, country_key, country_value);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, country_key);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, country_value);
-
-    // set blz
-    jstring blz_key = (*priv->jni_env)->NewStringUTF(priv->jni_env, "my.blz");
-    jstring blz_value = (*priv->jni_env)->NewStringUTF(priv->jni_env, blz);
-    (*priv->jni_env)->CallObjectMethod(priv->jni_env, job, priv->method_HBCIJob_setParam, blz_key, blz_value);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, blz_key);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, blz_value);
-
-    // set account number
-    jstring number_key = (*priv->jni_env)->NewStringUTF(priv->jni_env, "my.number");
-    jstring number_value = (*priv->jni_env)->NewStringUTF(priv->jni_env, number);
-    (*priv->jni_env)->CallObjectMethod(priv->jni_env, job, priv->method_HBCIJob_setParam, number_key, number_value);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, number_key);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, number_value);
-
-    // add to job queue
-    (*priv->jni_env)->CallObjectMethod(priv->jni_env, job, priv->method_HBCIJob_addToQueue);
-
-    // execute queue
-    jobject status = (*priv->jni_env)->CallObjectMethod(priv->jni_env, hbci_handler, priv->method_HBCIHandler_execute);
-    if (status == NULL) {
-        g_warning("HBCIHandler execute failed");
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
-        goto cleanup_job;
-    }
+    ghbci_log_ring_flush(self->priv->log_ring);
+}
 
-    jobject result = (*priv->jni_env)->CallObjectMethod(priv->jni_env, job, priv->method_HBCIJob_getJobResult);
-    if (result == NULL) {
-        g_warning("getJobResult failed");
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
-        goto cleanup_status;
-    }
+/**
+ * ghbci_context_set_log_level:
+ * @self: The #GHbciContext
+ * @level: most verbose #GHbciLogLevel to pass on
+ *
+ * Set threshold for messages of hbci4java. Filtering happens inside
+ * hbci4java, so suppressed messages cost nothing.
+ **/
+void
+ghbci_context_set_log_level (GHbciContext* self, GHbciLogLevel level)
+{
+    g_return_if_fail (GHBCI_IS_CONTEXT (self));
+    g_return_if_fail (level >= GHBCI_LOGLEVEL_ENUM_ERROR && level <= GHBCI_LOGLEVEL_ENUM_DEBUG2);
 
-    jboolean isOK = (*priv->jni_env)->CallBooleanMethod(priv->jni_env, result, priv->method_HBCIJobResultImpl_isOK);
-    if (!isOK) {
-        g_warning("job failed");
-        goto cleanup_result;
-    }
+    if (g_atomic_int_get (&self->priv->log_level) == (gint)level)
+        return;
 
-    // GVRSaldoReq.Info[] saldi = res.getEntries();
-    jobject entries = (*priv->jni_env)->CallObjectMethod(priv->jni_env, result, priv->method_GVRSaldoReq_getEntries);
-    if (entries == NULL) {
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
-        goto cleanup_result;
-    }
-    jobject element = (*priv->jni_env)->GetObjectArrayElement(priv->jni_env, entries, 0);
-    if (element == NULL) {
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
-        goto cleanup_entries;
-    }
-    jobject ready = (*priv->jni_env)->GetObjectField(priv->jni_env, element, priv->field_GVRSaldoReqInfo_ready);
-    if (ready == NULL) {
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
-        goto cleanup_element;
-    }
-    jobject jvalue = (*priv->jni_env)->GetObjectField(priv->jni_env, ready, priv->field_Saldo_value);
-    if (jvalue == NULL) {
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
-        goto cleanup_ready;
-    }
-    jobject jvaluestr = (*priv->jni_env)->CallObjectMethod(priv->jni_env, jvalue, priv->method_Value_toString);
-    if (jvaluestr == NULL) {
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
-        goto cleanup_jvalue;
-    }
+    g_atomic_int_set (&self->priv->log_level, level);
+    if (self->priv->jvm != NULL)
+        push_log_level (self, ghbci_context_get_jni_env (self));
+    if (self->priv->workers != NULL)
+        ghbci_worker_pool_set_options (self->priv->workers, level, self->priv->capture_raw_messages);
 
-    // to native string
-    const gchar* nativeString = (*priv->jni_env)->GetStringUTFChars(priv->jni_env, jvaluestr, 0);
-    value = g_strdup(nativeString);
-    (*priv->jni_env)->ReleaseStringUTFChars(priv->jni_env, jvaluestr, nativeString);
+    g_object_notify (G_OBJECT (self), "log-level");
+}
 
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, jvaluestr);
-cleanup_jvalue:
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, jvalue);
-cleanup_ready:
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, ready);
-cleanup_element:
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, element);
-cleanup_entries:
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, entries);
-cleanup_result:
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, result);
-cleanup_status:
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, status);
-cleanup_job:
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, job);
-    return value;
+/**
+ * ghbci_context_get_log_level:
+ * @self: The #GHbciContext
+ *
+ * Get threshold for messages of hbci4java
+ *
+ * Returns: most verbose #GHbciLogLevel passed on
+ **/
+GHbciLogLevel
+ghbci_context_get_log_level (GHbciContext* self)
+{
+    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), GHBCI_LOGLEVEL_ENUM_INFO);
+
+    return g_atomic_int_get (&self->priv->log_level);
 }
 
+/**
+ * ghbci_context_set_capture_raw_messages:
+ * @self: The #GHbciContext
+ * @capture: whether to pass raw messages to the #GHbciContext::status signal
+ *
+ * Include raw HBCI messages in the payload of MSG_RAW_SEND and MSG_RAW_RECV
+ * status events. Raw messages contain account data, so this is off by
+ * default.
+ **/
+void
+ghbci_context_set_capture_raw_messages (GHbciContext* self, gboolean capture)
+{
+    g_return_if_fail (GHBCI_IS_CONTEXT (self));
+
+    self->priv->capture_raw_messages = capture;
+    if (self->priv->workers != NULL)
+        ghbci_worker_pool_set_options (self->priv->workers, g_atomic_int_get (&self->priv->log_level), capture);
+}
 
 /**
- * ghbci_context_get_statements:
+ * ghbci_context_set_native_mt940:
  * @self: The #GHbciContext
- * @blz: blz
- * @userid: userid
- * @number: bank account number
+ * @native: whether to parse statements natively
  *
- * Fetch all statements for a bank account
+ * Parse the MT940 data of ghbci_context_get_statements() natively instead
+ * of reading the statements hbci4java parsed, one JNI call per field. This
+ * saves time and memory for large downloads. Natively parsed statements
+ * are prettified already, see ghbci_statement_prettify_statement().
+ **/
+void
+ghbci_context_set_native_mt940 (GHbciContext* self, gboolean native)
+{
+    g_return_if_fail (GHBCI_IS_CONTEXT (self));
+
+    self->priv->native_mt940 = native;
+}
+
+/**
+ * ghbci_context_set_rate_limit:
+ * @self: The #GHbciContext
+ * @blz: (nullable): blz of the bank, or %NULL to set the default for all banks
+ * @requests_per_second: sustained rate of requests, 0 for no limit
+ * @burst: number of requests which may be sent at once after a pause
+ * @max_concurrent: maximum number of requests in flight, 0 for no limit
  *
- * Returns: (element-type GHbciStatement) (transfer full): List of #GHbciStatement objects
+ * Pace requests sent to a bank. Limits apply per pin/tan server, so banks
+ * sharing a server share the limit as well. When a request fails with a
+ * transient error, all requests to the same server back off together.
  **/
-GSList*
-ghbci_context_get_statements (GHbciContext* self, const gchar* blz, const gchar* userid, const gchar* number)
+void
+ghbci_context_set_rate_limit (GHbciContext* self, const gchar* blz, gdouble requests_per_second,
+        guint burst, guint max_concurrent)
 {
     GHbciContextPrivate* priv;
-    GSList* statements = NULL;
+    gchar* key = NULL;
 
-    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), NULL);
+    g_return_if_fail (GHBCI_IS_CONTEXT (self));
+    g_return_if_fail (requests_per_second >= 0);
     priv = self->priv;
 
-    jobject hbci_handler = get_hbci_handler(self, blz, userid);
-    if(hbci_handler == NULL) {
-        printf("no handler found!\n");
-        return NULL;
-    }
+    // out of process, a worker or the daemon looks up the server
+    if (blz != NULL)
+        key = get_rate_limit_key(self, is_out_of_process(self) ? NULL : ghbci_context_get_jni_env (self), blz);
 
-    // create HBCIJob
-    jstring jobname = (*priv->jni_env)->NewStringUTF(priv->jni_env, "KUmsAll");
-    jobject job = (*priv->jni_env)->CallObjectMethod(priv->jni_env, hbci_handler, priv->method_HBCIHandler_newJob, jobname);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, jobname);
+    ghbci_rate_limiter_set_limit(priv->rate_limiter, key, requests_per_second, burst, max_concurrent);
+    g_free(key);
+}
 
-    if (job == NULL) {
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
-        return NULL;
-    }
+/**
+ * ghbci_context_set_retry_policy:
+ * @self: The #GHbciContext
+ * @max_attempts: maximum number of attempts per job, 1 to disable retries
+ * @base_delay: delay before the first retry in milliseconds
+ * @max_delay: upper bound for the delay in milliseconds
+ *
+ * Configure retries of jobs failing because of network problems or
+ * temporary errors reported by the bank. The delay doubles with every
+ * attempt and is randomized by up to half its length. Transfers are never
+ * retried.
+ **/
+void
+ghbci_context_set_retry_policy (GHbciContext* self, guint max_attempts, guint base_delay, guint max_delay)
+{
+    g_return_if_fail (GHBCI_IS_CONTEXT (self));
+    g_return_if_fail (max_attempts > 0);
 
-    jstring country_key = (*priv->jni_env)->NewStringUTF(priv->jni_env, "my.country");
-    jstring country_value = (*priv->jni_env)->NewStringUTF(priv->jni_env, "DE");
-    (*priv->jni_env)->CallObjectMethod(priv->jni_env, job, priv->method_HBCIJob_setParam, country_key, country_value);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, country_key);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, country_value);
+    g_mutex_lock(&self->priv->lock);
+    self->priv->retry_max_attempts = max_attempts;
+    self->priv->retry_base_delay = base_delay;
+    self->priv->retry_max_delay = MAX(base_delay, max_delay);
+    g_mutex_unlock(&self->priv->lock);
+}
 
-    jstring blz_key = (*priv->jni_env)->NewStringUTF(priv->jni_env, "my.blz");
-    jstring blz_value = (*priv->jni_env)->NewStringUTF(priv->jni_env, blz);
-    (*priv->jni_env)->CallObjectMethod(priv->jni_env, job, priv->method_HBCIJob_setParam, blz_key, blz_value);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, blz_key);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, blz_value);
+/**
+ * ghbci_context_get_capabilities:
+ * @self: The #GHbciContext
+ * @blz: blz of the bank
+ * @userid: userid of the passport
+ *
+ * Get what a bank supports according to its BPD, with the TAN methods of
+ * the user. The table is filled when the passport is added and saved next
+ * to the passports, so it is available without contacting the bank after
+ * the first time.
+ *
+ * Returns: (transfer full) (nullable): capabilities of the bank, %NULL if
+ *   the passport wasn't added yet
+ **/
+GHbciCapabilities*
+ghbci_context_get_capabilities (GHbciContext* self, const gchar* blz, const gchar* userid)
+{
+    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), NULL);
+    g_return_val_if_fail (blz != NULL, NULL);
+    g_return_val_if_fail (userid != NULL, NULL);
 
-    jstring number_key = (*priv->jni_env)->NewStringUTF(priv->jni_env, "my.number");
-    jstring number_value = (*priv->jni_env)->NewStringUTF(priv->jni_env, number);
-    (*priv->jni_env)->CallObjectMethod(priv->jni_env, job, priv->method_HBCIJob_setParam, number_key, number_value);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, number_key);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, number_value);
+    return lookup_capabilities(self, blz, userid);
+}
 
-    // add to queue
-    (*priv->jni_env)->CallObjectMethod(priv->jni_env, job, priv->method_HBCIJob_addToQueue);
+/**
+ * ghbci_context_set_answer:
+ * @self: The #GHbciContext
+ * @blz: (nullable): blz of the passport, %NULL for all passports
+ * @userid: (nullable): userid of the passport, %NULL for all passports
+ * @reason: #GHbciReason to answer
+ * @answer: (nullable): answer, %NULL removes it
+ *
+ * Answer requests of hbci4java for @reason with a fixed value, without
+ * asking the #GHbciCredentialProvider or emitting #GHbciContext::callback.
+ * Meant for values known beforehand, like the country, blz, userid, host,
+ * port, filter or passphrase. Answers of a passport take precedence over
+ * answers for all passports.
+ **/
+void
+ghbci_context_set_answer (GHbciContext* self, const gchar* blz, const gchar* userid, GHbciReason reason,
+        const gchar* answer)
+{
+    GHbciContextPrivate* priv;
+    CallbackAnswers* answers;
+    gchar* key;
 
-    // run queue
-    jobject status = (*priv->jni_env)->CallObjectMethod(priv->jni_env, hbci_handler, priv->method_HBCIHandler_execute);
-    if (status == NULL) {
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
-        goto cleanup_job;
-    }
+    g_return_if_fail (GHBCI_IS_CONTEXT (self));
+    g_return_if_fail ((blz == NULL) == (userid == NULL));
+    g_return_if_fail (reason >= 0 && reason < CALLBACK_REASONS);
+    priv = self->priv;
 
-    jobject result = (*priv->jni_env)->CallObjectMethod(priv->jni_env, job, priv->method_HBCIJob_getJobResult);
-    if (result == NULL) {
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
-        goto cleanup_status;
-    }
-    jboolean isOK = (*priv->jni_env)->CallBooleanMethod(priv->jni_env, result, priv->method_HBCIJobResultImpl_isOK);
-    if (!isOK) {
-        printf("job failed\n");
-        goto cleanup_result;
-    }
-    jobject jstatements = (*priv->jni_env)->CallObjectMethod(priv->jni_env, result, priv->method_GVRKUms_getFlatData);
-    if (jstatements == NULL) {
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
-        goto cleanup_result;
-    }
+    key = blz != NULL ? g_strconcat(blz, "+", userid, NULL) : g_strdup("");
 
-    jobject jstatements_iter = (*priv->jni_env)->CallObjectMethod(priv->jni_env, jstatements, priv->method_List_iterator);
-    if (jstatements_iter == NULL) {
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
-        goto cleanup_jstatements;
+    g_mutex_lock(&priv->lock);
+    answers = g_hash_table_lookup(priv->answers, key);
+    if (answers == NULL) {
+        answers = g_new0(CallbackAnswers, 1);
+        g_hash_table_insert(priv->answers, key, answers);
+    } else {
+        g_free(key);
     }
+    g_free(answers->values[reason]);
+    answers->values[reason] = g_strdup(answer);
+    g_mutex_unlock(&priv->lock);
+}
 
-    while((*priv->jni_env)->CallBooleanMethod(priv->jni_env, jstatements_iter, priv->method_Iterator_hasNext)) {
-        jobject jstatement = (*priv->jni_env)->CallObjectMethod(priv->jni_env, jstatements_iter, priv->method_Iterator_next);
-        if (jstatement == NULL) {
-            (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
-            goto cleanup_jstatements_iter;
-        }
-        GHbciStatement* statement = ghbci_statement_new_with_jobject(self, jstatement);
-        statements = g_slist_append (statements, statement);
+/**
+ * ghbci_context_set_credential_provider:
+ * @self: The #GHbciContext
+ * @provider: (nullable): the #GHbciCredentialProvider, %NULL to unset
+ *
+ * Ask @provider for answers not set with ghbci_context_set_answer(), before
+ * falling back to #GHbciContext::callback
+ **/
+void
+ghbci_context_set_credential_provider (GHbciContext* self, GHbciCredentialProvider* provider)
+{
+    GHbciContextPrivate* priv;
+    GHbciCredentialProvider* old_provider;
 
-        (*priv->jni_env)->DeleteLocalRef(priv->jni_env, jstatement);
-    }
+    g_return_if_fail (GHBCI_IS_CONTEXT (self));
+    g_return_if_fail (provider == NULL || GHBCI_IS_CREDENTIAL_PROVIDER (provider));
+    priv = self->priv;
 
-cleanup_jstatements_iter:
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, jstatements_iter);
-cleanup_jstatements:
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, jstatements);
-cleanup_result:
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, result);
-cleanup_status:
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, status);
-cleanup_job:
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, job);
-    return statements;
-}
+    if (provider != NULL)
+        g_object_ref(provider);
+
+    g_mutex_lock(&priv->lock);
+    old_provider = priv->credential_provider;
+    priv->credential_provider = provider;
+    g_mutex_unlock(&priv->lock);
 
+    if (old_provider != NULL)
+        g_object_unref(old_provider);
+}
 
 /**
- * ghbci_context_send_transfer:
+ * ghbci_context_get_tan_challenges:
  * @self: The #GHbciContext
- * @blz: blz
- * @userid: userid
- * @number: account number
- * @destination_name: name of recipient
- * @destination_bic: bic
- * @destination_iban: iban
- * @reference: reference used in transfer
- * @amount: amount to transfer
  *
- * Send SEPA transfer
+ * Get the TAN challenges waiting for an answer, see
+ * #GHbciContext::tan-challenge
  *
- * Returns: true if successful
+ * Returns: (element-type GHbciTanChallenge) (transfer full): list of pending #GHbciTanChallenge
  **/
-gboolean
-ghbci_context_send_transfer (GHbciContext* self, const gchar* blz, const gchar* userid, const gchar* number,
-        const gchar* source_name, const gchar* source_bic, const gchar* source_iban,
-        const gchar* destination_name, const gchar* destination_bic, const gchar* destination_iban,
-        const gchar* reference, const gchar* amount)
+GSList*
+ghbci_context_get_tan_challenges (GHbciContext* self)
 {
-    GHbciContextPrivate* priv;
-    gboolean return_value = FALSE;
+    GSList* challenges = NULL;
+    GSList* iter;
 
-    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), FALSE);
-    priv = self->priv;
+    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), NULL);
 
-    jobject hbci_handler = get_hbci_handler(self, blz, userid);
-    if(hbci_handler == NULL) {
-        g_warning("no handler found");
-        return FALSE;
-    }
+    g_mutex_lock(&self->priv->lock);
+    for (iter = self->priv->tan_challenges; iter != NULL; iter = g_slist_next(iter))
+        challenges = g_slist_prepend(challenges, ghbci_tan_challenge_ref(iter->data));
+    g_mutex_unlock(&self->priv->lock);
+    return challenges;
+}
 
-    (*priv->jni_env)->CallVoidMethod(priv->jni_env, hbci_handler, priv->method_HBCIHandler_reset);
+/**
+ * ghbci_context_set_tan_timeout:
+ * @self: The #GHbciContext
+ * @seconds: time to answer a #GHbciTanChallenge
+ *
+ * Set how long a job waits for the answer of a TAN challenge before it is
+ * aborted. The default is 300 seconds.
+ **/
+void
+ghbci_context_set_tan_timeout (GHbciContext* self, guint seconds)
+{
+    g_return_if_fail (GHBCI_IS_CONTEXT (self));
+    g_return_if_fail (seconds > 0);
 
-    jstring jobname = (*priv->jni_env)->NewStringUTF(priv->jni_env, "UebSEPA"); // TODO: support TermUebSEPA
-    jobject job = (*priv->jni_env)->CallObjectMethod(priv->jni_env, hbci_handler, priv->method_HBCIHandler_newJob, jobname);
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, jobname);
+    g_mutex_lock(&self->priv->lock);
+    self->priv->tan_timeout = seconds;
+    g_mutex_unlock(&self->priv->lock);
+}
 
-    if (job == NULL) {
-        g_warning("newJob failed");
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
-        return FALSE;
-    }
-#define HBCIJob_setParam(variable, key, value) \
-    jstring variable##_key = (*priv->jni_env)->NewStringUTF(priv->jni_env, key); \
-    jstring variable##_value = (*priv->jni_env)->NewStringUTF(priv->jni_env, value); \
-    (*priv->jni_env)->CallObjectMethod(priv->jni_env, job, priv->method_HBCIJob_setParam, variable##_key, variable##_value); \
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, variable##_key); \
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, variable##_value);
-
-    HBCIJob_setParam(src_country, "src.country", "DE");
-    HBCIJob_setParam(src_blz, "src.blz", blz);
-    HBCIJob_setParam(src_number, "src.number", number);
-    HBCIJob_setParam(src_name, "src.name", source_name);
-    HBCIJob_setParam(src_bic, "src.bic", source_bic);
-    HBCIJob_setParam(src_iban, "src.iban", source_iban);
-    HBCIJob_setParam(dst_name, "dst.name", destination_name);
-    HBCIJob_setParam(dst_bic, "dst.bic", destination_bic);
-    HBCIJob_setParam(dst_iban, "dst.iban", destination_iban);
-    HBCIJob_setParam(usage, "usage", reference);
-    HBCIJob_setParam(btg_value, "btg.value", amount);
-    HBCIJob_setParam(btg_curr, "btg.curr", "EUR");
-
-    // add to queue
-    (*priv->jni_env)->CallObjectMethod(priv->jni_env, job, priv->method_HBCIJob_addToQueue);
-
-    jobject status = (*priv->jni_env)->CallObjectMethod(priv->jni_env, hbci_handler, priv->method_HBCIHandler_execute);
-    if (status == NULL) {
-        g_warning("HBCIHandler execute failed");
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
-        goto cleanup_job;
+#ifdef GHBCI_ENABLE_INSTRUMENTATION
+/*
+ * Add the counters of a finished public call to the totals and report
+ * them to status listeners
+ */
+void
+ghbci_context_record_call_counters (GHbciContext* self, const gchar* function, GHbciCallCounters* counters)
+{
+    GHbciContextPrivate* priv = self->priv;
+    GHbciCallCounters* total;
+
+    g_mutex_lock(&priv->call_counters_lock);
+    total = g_hash_table_lookup(priv->call_counters, function);
+    if (total == NULL) {
+        total = g_new0(GHbciCallCounters, 1);
+        g_hash_table_insert(priv->call_counters, g_strdup(function), total);
     }
-
-    jobject result = (*priv->jni_env)->CallObjectMethod(priv->jni_env, job, priv->method_HBCIJob_getJobResult);
-    if (result == NULL) {
-        g_warning("getJobResult failed");
-        (*priv->jni_env)->ExceptionDescribe(priv->jni_env);
-        goto cleanup_status;
+    total->calls += counters->calls;
+    total->jni_calls += counters->jni_calls;
+    total->local_refs += counters->local_refs;
+    total->string_bytes += counters->string_bytes;
+    total->allocations += counters->allocations;
+    g_mutex_unlock(&priv->call_counters_lock);
+
+    if (g_signal_has_handler_pending(self, ghbci_context_signals[STATUS], 0, TRUE)) {
+        GHbciStatusPayload* payload = ghbci_status_payload_new(GHBCI_STATUSTAG_ENUM_API_CALL_DONE);
+        payload->function = g_strdup(function);
+        payload->call_counters = ghbci_call_counters_copy(counters);
+        g_signal_emit (self, ghbci_context_signals[STATUS], 0, (gint64)GHBCI_STATUSTAG_ENUM_API_CALL_DONE, function, payload);
+        ghbci_status_payload_free(payload);
     }
-    jboolean isOK = (*priv->jni_env)->CallBooleanMethod(priv->jni_env, result, priv->method_HBCIJobResultImpl_isOK);
-    if (!isOK) {
-        g_warning("job failed");
+}
+#endif
 
-        jobject job_status = (*priv->jni_env)->CallObjectMethod(priv->jni_env, result, priv->method_HBCIJobResult_getJobStatus);
-        jstring errorstring = (*priv->jni_env)->CallObjectMethod(priv->jni_env, status, priv->method_HBCIStatus_getErrorString);
+/**
+ * ghbci_context_get_call_counters:
+ * @self: The #GHbciContext
+ * @function: name of a public function, like "ghbci_context_get_statements"
+ * @counters: (out caller-allocates): location for the totals
+ *
+ * Get the JNI calls, local references, converted string bytes and memory
+ * allocations of all calls of @function so far. Counted are the calling
+ * thread's costs, including those of hbci4java and the jvm while the call
+ * runs. Nested calls of public functions add to the outermost one.
+ *
+ * Returns: %TRUE if @function was called, %FALSE if not or if ghbci was
+ *   built without instrumentation
+ **/
+gboolean
+ghbci_context_get_call_counters (GHbciContext* self, const gchar* function, GHbciCallCounters* counters)
+{
+    g_return_val_if_fail (GHBCI_IS_CONTEXT (self), FALSE);
+    g_return_val_if_fail (function != NULL, FALSE);
+    g_return_val_if_fail (counters != NULL, FALSE);
+
+    memset(counters, 0, sizeof(GHbciCallCounters));
+#ifdef GHBCI_ENABLE_INSTRUMENTATION
+    GHbciCallCounters* total;
+    gboolean found;
+
+    g_mutex_lock(&self->priv->call_counters_lock);
+    total = g_hash_table_lookup(self->priv->call_counters, function);
+    found = total != NULL;
+    if (found)
+        *counters = *total;
+    g_mutex_unlock(&self->priv->call_counters_lock);
+    return found;
+#else
+    return FALSE;
+#endif
+}
 
-        if (errorstring != NULL) {
-            const gchar* nativeString = (*priv->jni_env)->GetStringUTFChars(priv->jni_env, errorstring, 0);
-            g_warning("error: %s", nativeString);
-            (*priv->jni_env)->ReleaseStringUTFChars(priv->jni_env, errorstring, nativeString);
-        }
+/**
+ * ghbci_context_reset_call_counters:
+ * @self: The #GHbciContext
+ *
+ * Forget the totals of all functions
+ **/
+void
+ghbci_context_reset_call_counters (GHbciContext* self)
+{
+    g_return_if_fail (GHBCI_IS_CONTEXT (self));
 
-        (*priv->jni_env)->DeleteLocalRef(priv->jni_env, job_status);
-        (*priv->jni_env)->DeleteLocalRef(priv->jni_env, errorstring);
-        return_value = FALSE;
-    }
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, result);
-cleanup_status:
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, status);
-cleanup_job:
-    (*priv->jni_env)->DeleteLocalRef(priv->jni_env, job);
-    return return_value;
+#ifdef GHBCI_ENABLE_INSTRUMENTATION
+    g_mutex_lock(&self->priv->call_counters_lock);
+    g_hash_table_remove_all(self->priv->call_counters);
+    g_mutex_unlock(&self->priv->call_counters_lock);
+#endif
 }
 
 
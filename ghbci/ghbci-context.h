@@ -22,6 +22,16 @@
 #include <glib.h>
 #include <glib-object.h>
 
+#include "ghbci-metrics.h"
+#include "ghbci-status.h"
+#include "ghbci-error.h"
+#include "ghbci-instrumentation.h"
+#include "ghbci-capabilities.h"
+#include "ghbci-credential-provider.h"
+#include "ghbci-tan-challenge.h"
+#include "ghbci-transfer.h"
+#include "ghbci-standing-order.h"
+
 G_BEGIN_DECLS
 
 typedef struct _GHbciContext GHbciContext;
@@ -141,37 +151,123 @@ typedef enum {
 	GHBCI_STATUSTAG_ENUM_MSG_PARSE = 28,
 	GHBCI_STATUSTAG_ENUM_SEND_INFOPOINT_DATA = 29,
 	GHBCI_STATUSTAG_ENUM_MSG_RAW_SEND = 30,
-	GHBCI_STATUSTAG_ENUM_MSG_RAW_RECV = 31
+	GHBCI_STATUSTAG_ENUM_MSG_RAW_RECV = 31,
+	// not sent by hbci4java, see ghbci_context_get_call_counters()
+	GHBCI_STATUSTAG_ENUM_API_CALL_DONE = 1000
 } GHbciStatusTag;
 
 
 typedef void (*GHbciBlzFunc) (const gchar* blz, gpointer user_data);
 
+/**
+ * GHbciLogSinkFunc:
+ * @level: #GHbciLogLevel of the message
+ * @time: wall clock time of the message in microseconds since epoch
+ * @dialog_id: id of the dialog, empty if unknown
+ * @message: log message
+ * @user_data: data passed to ghbci_context_set_log_sink()
+ *
+ * Receives log messages of hbci4java in the log delivery thread
+ **/
+typedef void (*GHbciLogSinkFunc) (gint level, gint64 time, const gchar* dialog_id, const gchar* message, gpointer user_data);
+
 GType             ghbci_context_get_type                      (void) G_GNUC_CONST;
 
 GHbciContext*     ghbci_context_new                           (const gchar* directory);
 
+GHbciContext*     ghbci_context_new_with_workers              (const gchar* directory, guint n_workers,
+                                                               GError** error);
+
+GHbciContext*     ghbci_context_new_for_daemon                (GDBusConnection* connection, GError** error);
+
 const gchar*      ghbci_context_get_name_for_blz              (GHbciContext* self, const gchar* blz);
 
 const gchar*      ghbci_context_get_pin_tan_url_for_blz       (GHbciContext* self, const gchar* blz);
 
 void              ghbci_context_blz_foreach                   (GHbciContext* self, GHbciBlzFunc func, gpointer user_data);
 
-gboolean          ghbci_context_add_passport                  (GHbciContext* self, const gchar* blz, const gchar* userid);
+gboolean          ghbci_context_add_passport                  (GHbciContext* self, const gchar* blz, const gchar* userid,
+                                                               GError** error);
+
+GSList*           ghbci_context_get_accounts                  (GHbciContext* self, const gchar* blz, const gchar* userid,
+                                                               GError** error);
 
-GSList*           ghbci_context_get_accounts                  (GHbciContext* self, const gchar* blz, const gchar* userid);
+GHashTable*       ghbci_context_get_tan_methods               (GHbciContext* self, const gchar* blz, const gchar* userid,
+                                                               GError** error);
 
-GHashTable*       ghbci_context_get_tan_methods               (GHbciContext* self, const gchar* blz, const gchar* userid);
+gchar*            ghbci_context_get_balances                  (GHbciContext* self, const gchar* blz, const gchar* userid, const gchar* number,
+                                                               GError** error);
 
-gchar*            ghbci_context_get_balances                  (GHbciContext* self, const gchar* blz, const gchar* userid, const gchar* number);
+GSList*           ghbci_context_get_statements                (GHbciContext* self, const gchar* blz, const gchar* userid, const gchar* number,
+                                                               GError** error);
 
-GSList*           ghbci_context_get_statements                (GHbciContext* self, const gchar* blz, const gchar* userid, const gchar* number);
+GSList*           ghbci_context_read_camt                     (GHbciContext* self, GInputStream* stream,
+                                                               GCancellable* cancellable, GError** error);
 
 gboolean          ghbci_context_send_transfer                 (GHbciContext* self, const gchar* blz, const gchar* userid, const gchar* number,
                                                                const gchar* source_name, const gchar* source_bic, const gchar* source_iban,
                                                                const gchar* destination_name, const gchar* destination_bic,
                                                                const gchar* destination_iban, const gchar* reference,
-                                                               const gchar* amount);
+                                                               const gchar* amount, GError** error);
+
+gboolean          ghbci_context_send_transfers                (GHbciContext* self, const gchar* blz, const gchar* userid, const gchar* number,
+                                                               const gchar* source_name, const gchar* source_bic, const gchar* source_iban,
+                                                               const GHbciTransfer* transfers, guint n_transfers,
+                                                               GError** error);
+
+gboolean          ghbci_context_validate_pain001              (GHbciContext* self, GBytes* document, GError** error);
+
+gboolean          ghbci_context_send_scheduled_transfer       (GHbciContext* self, const gchar* blz, const gchar* userid, const gchar* number,
+                                                               const gchar* source_name, const gchar* source_bic, const gchar* source_iban,
+                                                               const GHbciTransfer* transfer, const GDate* date,
+                                                               gchar** order_id, GError** error);
+
+gboolean          ghbci_context_create_standing_order         (GHbciContext* self, const gchar* blz, const gchar* userid, const gchar* number,
+                                                               const gchar* source_name, const gchar* source_bic, const gchar* source_iban,
+                                                               const GHbciStandingOrder* order, gchar** order_id,
+                                                               GError** error);
+
+GSList*           ghbci_context_get_standing_orders           (GHbciContext* self, const gchar* blz, const gchar* userid, const gchar* number,
+                                                               const gchar* source_bic, const gchar* source_iban,
+                                                               GError** error);
+
+GHbciMetrics*     ghbci_context_get_metrics                   (GHbciContext* self);
+
+void              ghbci_context_set_log_sink                  (GHbciContext* self, GHbciLogSinkFunc func, gpointer user_data,
+                                                               GDestroyNotify notify);
+
+gchar**           ghbci_context_get_log_tail                  (GHbciContext* self);
+
+void              ghbci_context_set_log_level                 (GHbciContext* self, GHbciLogLevel level);
+
+GHbciLogLevel     ghbci_context_get_log_level                 (GHbciContext* self);
+
+void              ghbci_context_set_capture_raw_messages      (GHbciContext* self, gboolean capture);
+
+void              ghbci_context_set_native_mt940              (GHbciContext* self, gboolean native);
+
+void              ghbci_context_set_rate_limit                (GHbciContext* self, const gchar* blz, gdouble requests_per_second,
+                                                               guint burst, guint max_concurrent);
+
+void              ghbci_context_set_retry_policy              (GHbciContext* self, guint max_attempts, guint base_delay,
+                                                               guint max_delay);
+
+GHbciCapabilities* ghbci_context_get_capabilities             (GHbciContext* self, const gchar* blz,
+                                                               const gchar* userid);
+
+void              ghbci_context_set_answer                    (GHbciContext* self, const gchar* blz, const gchar* userid,
+                                                               GHbciReason reason, const gchar* answer);
+
+void              ghbci_context_set_credential_provider       (GHbciContext* self, GHbciCredentialProvider* provider);
+
+GSList*           ghbci_context_get_tan_challenges            (GHbciContext* self);
+
+void              ghbci_context_set_tan_timeout               (GHbciContext* self, guint seconds);
+
+gboolean          ghbci_context_get_call_counters             (GHbciContext* self, const gchar* function,
+                                                               GHbciCallCounters* counters);
+
+void              ghbci_context_reset_call_counters           (GHbciContext* self);
 
 G_END_DECLS
 
@@ -0,0 +1,177 @@
+/*
+ * ghbci-credential-provider.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/**
+ * SECTION:ghbci-credential-provider
+ * @short_description: Answers the questions of hbci4java
+ *
+ * hbci4java asks for the country, blz, userid, server, PIN, TAN and so on
+ * while a passport is used. #GHbciContext answers them in this order:
+ *
+ * 1. answers set with ghbci_context_set_answer(), without calling into the
+ *    application
+ * 2. the @lookup function of the #GHbciCredentialProvider set with
+ *    ghbci_context_set_credential_provider()
+ * 3. the @request_async function of the provider. The HBCI dialog waits
+ *    until it completes, so a TAN prompt can be shown asynchronously.
+ * 4. for TANs, a #GHbciTanChallenge emitted with
+ *    #GHbciContext::tan-challenge, if the signal has handlers
+ * 5. the #GHbciContext::callback signal
+ **/
+
+#include "ghbci-credential-provider.h"
+
+
+G_DEFINE_INTERFACE (GHbciCredentialProvider, ghbci_credential_provider, G_TYPE_OBJECT)
+
+G_DEFINE_BOXED_TYPE (GHbciCredentialRequest, ghbci_credential_request, ghbci_credential_request_copy, ghbci_credential_request_free)
+
+
+static void
+ghbci_credential_provider_default_init (GHbciCredentialProviderInterface* iface)
+{
+    iface->lookup = NULL;
+    iface->request_async = NULL;
+    iface->request_finish = NULL;
+}
+
+/**
+ * ghbci_credential_provider_lookup:
+ * @self: The #GHbciCredentialProvider
+ * @request: the question
+ * @answer: (out) (transfer full) (nullable): return location for the answer,
+ *   %NULL aborts the job
+ *
+ * Answer @request without blocking
+ *
+ * Returns: %TRUE if @answer is set
+ **/
+gboolean
+ghbci_credential_provider_lookup (GHbciCredentialProvider* self, const GHbciCredentialRequest* request,
+        gchar** answer)
+{
+    GHbciCredentialProviderInterface* iface;
+
+    g_return_val_if_fail (GHBCI_IS_CREDENTIAL_PROVIDER (self), FALSE);
+    g_return_val_if_fail (request != NULL, FALSE);
+    g_return_val_if_fail (answer != NULL, FALSE);
+
+    iface = GHBCI_CREDENTIAL_PROVIDER_GET_IFACE (self);
+    if (iface->lookup == NULL)
+        return FALSE;
+    return iface->lookup(self, request, answer);
+}
+
+/**
+ * ghbci_credential_provider_request_async:
+ * @self: The #GHbciCredentialProvider
+ * @request: the question
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: called when the answer is known
+ * @user_data: data for @callback
+ *
+ * Ask for the answer of @request. Fails with %G_IO_ERROR_NOT_SUPPORTED if
+ * the provider has no asynchronous way.
+ **/
+void
+ghbci_credential_provider_request_async (GHbciCredentialProvider* self, const GHbciCredentialRequest* request,
+        GCancellable* cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+    GHbciCredentialProviderInterface* iface;
+
+    g_return_if_fail (GHBCI_IS_CREDENTIAL_PROVIDER (self));
+    g_return_if_fail (request != NULL);
+
+    iface = GHBCI_CREDENTIAL_PROVIDER_GET_IFACE (self);
+    if (iface->request_async == NULL) {
+        g_task_report_new_error(self, callback, user_data, ghbci_credential_provider_request_async,
+                G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "Credential provider answers synchronously only");
+        return;
+    }
+    iface->request_async(self, request, cancellable, callback, user_data);
+}
+
+/**
+ * ghbci_credential_provider_request_finish:
+ * @self: The #GHbciCredentialProvider
+ * @result: the #GAsyncResult passed to the callback
+ * @error: return location for error or %NULL
+ *
+ * Finish ghbci_credential_provider_request_async()
+ *
+ * Returns: (transfer full) (nullable): the answer, %NULL on error
+ **/
+gchar*
+ghbci_credential_provider_request_finish (GHbciCredentialProvider* self, GAsyncResult* result, GError** error)
+{
+    GHbciCredentialProviderInterface* iface;
+
+    g_return_val_if_fail (GHBCI_IS_CREDENTIAL_PROVIDER (self), NULL);
+    g_return_val_if_fail (G_IS_ASYNC_RESULT (result), NULL);
+
+    iface = GHBCI_CREDENTIAL_PROVIDER_GET_IFACE (self);
+    if (iface->request_async == NULL || iface->request_finish == NULL)
+        return g_task_propagate_pointer(G_TASK(result), error);
+    return iface->request_finish(self, result, error);
+}
+
+/**
+ * ghbci_credential_request_copy:
+ * @self: The #GHbciCredentialRequest
+ *
+ * Create a deep copy
+ *
+ * Returns: (transfer full): copy of @self
+ **/
+GHbciCredentialRequest*
+ghbci_credential_request_copy (GHbciCredentialRequest* self)
+{
+    GHbciCredentialRequest* copy;
+
+    g_return_val_if_fail (self != NULL, NULL);
+
+    copy = g_new0(GHbciCredentialRequest, 1);
+    copy->reason = self->reason;
+    copy->blz = g_strdup(self->blz);
+    copy->userid = g_strdup(self->userid);
+    copy->message = g_strdup(self->message);
+    copy->optional = g_strdup(self->optional);
+    return copy;
+}
+
+/**
+ * ghbci_credential_request_free:
+ * @self: The #GHbciCredentialRequest
+ *
+ * Free a request created by ghbci_credential_request_copy()
+ **/
+void
+ghbci_credential_request_free (GHbciCredentialRequest* self)
+{
+    if (self == NULL)
+        return;
+
+    g_free(self->blz);
+    g_free(self->userid);
+    g_free(self->message);
+    g_free(self->optional);
+    g_free(self);
+}
+
+
+//vim: expandtab sw=4
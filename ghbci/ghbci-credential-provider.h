@@ -0,0 +1,105 @@
+/*
+ * ghbci-credential-provider.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_CREDENTIAL_PROVIDER_H__
+#define __GHBCI_CREDENTIAL_PROVIDER_H__
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GHbciCredentialProvider GHbciCredentialProvider;
+typedef struct _GHbciCredentialProviderInterface GHbciCredentialProviderInterface;
+typedef struct _GHbciCredentialRequest GHbciCredentialRequest;
+
+#define GHBCI_TYPE_CREDENTIAL_PROVIDER           (ghbci_credential_provider_get_type ())
+#define GHBCI_CREDENTIAL_PROVIDER(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), GHBCI_TYPE_CREDENTIAL_PROVIDER, GHbciCredentialProvider))
+#define GHBCI_IS_CREDENTIAL_PROVIDER(obj)        (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GHBCI_TYPE_CREDENTIAL_PROVIDER))
+#define GHBCI_CREDENTIAL_PROVIDER_GET_IFACE(obj) (G_TYPE_INSTANCE_GET_INTERFACE ((obj), GHBCI_TYPE_CREDENTIAL_PROVIDER, GHbciCredentialProviderInterface))
+
+#define GHBCI_TYPE_CREDENTIAL_REQUEST            (ghbci_credential_request_get_type ())
+
+/**
+ * GHbciCredentialRequest:
+ * @reason: #GHbciReason of the request
+ * @blz: blz of the passport, %NULL if unknown
+ * @userid: userid of the passport, %NULL if unknown
+ * @message: message of hbci4java
+ * @optional: optional data of hbci4java, e.g. the available TAN methods
+ *
+ * A question hbci4java asks while a passport is used
+ **/
+struct _GHbciCredentialRequest
+{
+    gint reason;
+    gchar* blz;
+    gchar* userid;
+    gchar* message;
+    gchar* optional;
+};
+
+/**
+ * GHbciCredentialProviderInterface:
+ * @parent_iface: parent interface
+ * @lookup: answers @request without blocking, returns %FALSE if the
+ *   provider has no immediate answer
+ * @request_async: asks for the answer, e.g. shows a TAN prompt
+ * @request_finish: returns the answer of @request_async, %NULL with an
+ *   error aborts the job
+ *
+ * Both ways are optional. A provider without @request_async leaves
+ * unanswered requests to the #GHbciContext::callback signal.
+ **/
+struct _GHbciCredentialProviderInterface
+{
+    GTypeInterface parent_iface;
+
+    gboolean (*lookup)         (GHbciCredentialProvider* self, const GHbciCredentialRequest* request,
+                                gchar** answer);
+    void     (*request_async)  (GHbciCredentialProvider* self, const GHbciCredentialRequest* request,
+                                GCancellable* cancellable, GAsyncReadyCallback callback, gpointer user_data);
+    gchar*   (*request_finish) (GHbciCredentialProvider* self, GAsyncResult* result, GError** error);
+};
+
+GType                   ghbci_credential_provider_get_type        (void) G_GNUC_CONST;
+
+gboolean                ghbci_credential_provider_lookup          (GHbciCredentialProvider* self,
+                                                                   const GHbciCredentialRequest* request,
+                                                                   gchar** answer);
+
+void                    ghbci_credential_provider_request_async   (GHbciCredentialProvider* self,
+                                                                   const GHbciCredentialRequest* request,
+                                                                   GCancellable* cancellable,
+                                                                   GAsyncReadyCallback callback,
+                                                                   gpointer user_data);
+
+gchar*                  ghbci_credential_provider_request_finish  (GHbciCredentialProvider* self,
+                                                                   GAsyncResult* result, GError** error);
+
+GType                   ghbci_credential_request_get_type         (void) G_GNUC_CONST;
+
+GHbciCredentialRequest* ghbci_credential_request_copy             (GHbciCredentialRequest* self);
+
+void                    ghbci_credential_request_free             (GHbciCredentialRequest* self);
+
+G_END_DECLS
+
+#endif /* __GHBCI_CREDENTIAL_PROVIDER_H__ */
+
@@ -0,0 +1,582 @@
+/*
+ * ghbci-daemon-client.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/*
+ * Client of ghbci-daemon, for ghbci_context_new_for_daemon().
+ *
+ * A request registers a callback object at a path of its own and passes the
+ * path along, so the daemon can ask for pins and tans while the request
+ * runs. Both live in a main context pushed for the request only, which is
+ * iterated until the reply arrives: callbacks are answered on the thread of
+ * the request, like with a jvm in this process, and requests of several
+ * threads don't mix. Statements come as a sealed memfd like those of the
+ * worker processes.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <gio/gunixfdlist.h>
+
+#include "ghbci-daemon-private.h"
+#include "ghbci-error.h"
+#include "ghbci-error-private.h"
+
+struct _GHbciDaemonClient
+{
+    GDBusConnection* connection;
+    GDBusNodeInfo* introspection;
+    GHbciWorkerCallbackFunc callback;
+    gpointer user_data;
+    /* numbers the callback objects of the requests */
+    gint n_requests;
+};
+
+typedef struct
+{
+    GHbciDaemonClient* client;
+    const gchar* blz;
+    const gchar* userid;
+    GDBusMessage* reply;
+    GError* error;
+} Request;
+
+
+/* the methods of the daemon for the requests of the worker protocol */
+static const struct
+{
+    GHbciWorkerMessage kind;
+    const gchar* method;
+} methods[] = {
+    { GHBCI_WORKER_ADD_PASSPORT, "AddPassport" },
+    { GHBCI_WORKER_GET_BALANCES, "GetBalances" },
+    { GHBCI_WORKER_GET_STATEMENTS, "GetStatements" },
+    { GHBCI_WORKER_GET_ACCOUNTS, "GetAccounts" },
+    { GHBCI_WORKER_GET_TAN_METHODS, "GetTanMethods" },
+    { GHBCI_WORKER_SEND_TRANSFER, "SendTransfer" },
+    { GHBCI_WORKER_SEND_TRANSFERS, "SendTransfers" },
+    { GHBCI_WORKER_CREATE_STANDING_ORDER, "CreateStandingOrder" },
+    { GHBCI_WORKER_GET_STANDING_ORDERS, "GetStandingOrders" },
+    { GHBCI_WORKER_VALIDATE_PAIN001, "ValidatePain001" },
+    { GHBCI_WORKER_GET_BANK, "GetBank" },
+    { GHBCI_WORKER_LIST_BANKS, "ListBanks" },
+};
+
+
+const gchar*
+ghbci_daemon_method_for_kind (GHbciWorkerMessage kind)
+{
+    gsize i;
+
+    for (i = 0; i < G_N_ELEMENTS(methods); i++) {
+        if (methods[i].kind == kind)
+            return methods[i].method;
+    }
+    return NULL;
+}
+
+/*
+ * The request of a method of the daemon, 0 if there is none
+ */
+GHbciWorkerMessage
+ghbci_daemon_kind_for_method (const gchar* method)
+{
+    gsize i;
+
+    for (i = 0; i < G_N_ELEMENTS(methods); i++) {
+        if (g_str_equal(methods[i].method, method))
+            return methods[i].kind;
+    }
+    return 0;
+}
+
+/*
+ * type without its maybes, like D-Bus sees it
+ */
+static gchar*
+flat_type_string (const GVariantType* type)
+{
+    gchar* result = g_variant_type_dup_string(type);
+    gchar *from, *to;
+
+    for (from = to = result; *from != '\0'; from++) {
+        if (*from != 'm')
+            *to++ = *from;
+    }
+    *to = '\0';
+    return result;
+}
+
+/*
+ * A value of the worker protocol as D-Bus can carry it: its maybe strings
+ * become strings, empty for nothing. Returns a new reference, value is not
+ * consumed and must not be floating.
+ */
+GVariant*
+ghbci_daemon_variant_from_worker (GVariant* value)
+{
+    GVariantBuilder builder;
+    GVariantIter iter;
+    GVariant* child;
+    GVariant* flat;
+    gchar* type;
+
+    g_return_val_if_fail (value != NULL, NULL);
+
+    if (strchr(g_variant_get_type_string(value), 'm') == NULL)
+        return g_variant_ref(value);
+
+    if (g_variant_is_of_type(value, G_VARIANT_TYPE_MAYBE)) {
+        g_return_val_if_fail (g_variant_is_of_type(value, G_VARIANT_TYPE("ms")), NULL);
+        child = g_variant_get_maybe(value);
+        if (child == NULL)
+            return g_variant_ref_sink(g_variant_new_string(""));
+        return child;
+    }
+
+    type = flat_type_string(g_variant_get_type(value));
+    g_variant_builder_init(&builder, G_VARIANT_TYPE(type));
+    g_variant_iter_init(&iter, value);
+    while ((child = g_variant_iter_next_value(&iter)) != NULL) {
+        flat = ghbci_daemon_variant_from_worker(child);
+        g_variant_builder_add_value(&builder, flat);
+        g_variant_unref(flat);
+        g_variant_unref(child);
+    }
+    g_free(type);
+    return g_variant_ref_sink(g_variant_builder_end(&builder));
+}
+
+/*
+ * The reverse of ghbci_daemon_variant_from_worker(), value is of the
+ * flattened type. Returns a new reference, value is not consumed and must
+ * not be floating.
+ */
+GVariant*
+ghbci_daemon_variant_to_worker (GVariant* value, const GVariantType* type)
+{
+    GVariantBuilder builder;
+    GVariantIter iter;
+    GVariant* child;
+    GVariant* restored;
+    const GVariantType* child_type;
+    const gchar* string;
+    gchar* type_string;
+    gboolean is_flat;
+
+    g_return_val_if_fail (value != NULL, NULL);
+
+    if (g_variant_type_is_maybe(type)) {
+        g_return_val_if_fail (g_variant_is_of_type(value, G_VARIANT_TYPE_STRING), NULL);
+        string = g_variant_get_string(value, NULL);
+        return g_variant_ref_sink(g_variant_new_maybe(G_VARIANT_TYPE_STRING,
+                    *string != '\0' ? g_variant_new_string(string) : NULL));
+    }
+
+    type_string = g_variant_type_dup_string(type);
+    is_flat = strchr(type_string, 'm') == NULL;
+    g_free(type_string);
+    if (is_flat)
+        return g_variant_ref(value);
+
+    g_variant_builder_init(&builder, type);
+    child_type = g_variant_type_is_array(type) ? g_variant_type_element(type) : g_variant_type_first(type);
+    g_variant_iter_init(&iter, value);
+    while ((child = g_variant_iter_next_value(&iter)) != NULL) {
+        restored = ghbci_daemon_variant_to_worker(child, child_type);
+        g_variant_builder_add_value(&builder, restored);
+        g_variant_unref(restored);
+        g_variant_unref(child);
+        if (!g_variant_type_is_array(type))
+            child_type = g_variant_type_next(child_type);
+    }
+    return g_variant_ref_sink(g_variant_builder_end(&builder));
+}
+
+/*
+ * Reply to a method call of the daemon with an error, keeping segment and
+ * retry hint of a GHBCI_ERROR. Consumes the invocation.
+ */
+void
+ghbci_daemon_return_error (GDBusMethodInvocation* invocation, const GError* error)
+{
+    GDBusMessage* reply;
+    const gchar* segment = NULL;
+    GHbciRetryHint retry_hint = GHBCI_RETRY_HINT_NEVER;
+
+    g_return_if_fail (G_IS_DBUS_METHOD_INVOCATION (invocation));
+    g_return_if_fail (error != NULL);
+
+    if (error->domain == GHBCI_ERROR) {
+        segment = ghbci_error_get_segment(error);
+        retry_hint = ghbci_error_get_retry_hint(error);
+    }
+
+    // unregistered domains like GHBCI_ERROR are encoded in the name
+    gchar* name = g_dbus_error_encode_gerror(error);
+    reply = g_dbus_message_new_method_error_literal(g_dbus_method_invocation_get_message(invocation), name,
+            error->message);
+    g_dbus_message_set_body(reply, g_variant_new("(ssu)", error->message, segment != NULL ? segment : "",
+                retry_hint));
+    g_dbus_connection_send_message(g_dbus_method_invocation_get_connection(invocation), reply,
+            G_DBUS_SEND_MESSAGE_FLAGS_NONE, NULL, NULL);
+    g_object_unref(reply);
+    g_free(name);
+    g_object_unref(invocation);
+}
+
+/*
+ * Set error from an error reply of the daemon, FALSE if the reply is none
+ */
+gboolean
+ghbci_daemon_propagate_reply_error (GError** error, GDBusMessage* reply)
+{
+    GError* remote_error = NULL;
+    const gchar* message;
+    const gchar* segment;
+    guint32 retry_hint;
+
+    g_return_val_if_fail (G_IS_DBUS_MESSAGE (reply), FALSE);
+
+    // the domain has to be registered before the error is created, or it
+    // lacks the segment and retry hint
+    GQuark domain = GHBCI_ERROR;
+    if (!g_dbus_message_to_gerror(reply, &remote_error))
+        return FALSE;
+    g_dbus_error_strip_remote_error(remote_error);
+
+    GVariant* body = g_dbus_message_get_body(reply);
+    if (remote_error->domain == domain && body != NULL && g_variant_is_of_type(body, G_VARIANT_TYPE("(ssu)"))) {
+        // the message of the error is the first of the body
+        g_variant_get(body, "(&s&su)", &message, &segment, &retry_hint);
+        ghbci_set_error(error, remote_error->code, *segment != '\0' ? segment : NULL, retry_hint, "%s", message);
+        g_error_free(remote_error);
+    } else {
+        g_propagate_error(error, remote_error);
+    }
+    return TRUE;
+}
+
+/*
+ * Only the daemon may ask, not any other peer of the bus
+ */
+static gboolean
+is_daemon (GHbciDaemonClient* self, const gchar* sender)
+{
+    GVariant* owner;
+    const gchar* name;
+    gboolean result;
+
+    // peer to peer connections have no other peer
+    if (g_dbus_connection_get_unique_name(self->connection) == NULL)
+        return TRUE;
+    if (sender == NULL)
+        return FALSE;
+
+    owner = g_dbus_connection_call_sync(self->connection, "org.freedesktop.DBus", "/org/freedesktop/DBus",
+            "org.freedesktop.DBus", "GetNameOwner", g_variant_new("(s)", GHBCI_DAEMON_NAME), G_VARIANT_TYPE("(s)"),
+            G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL);
+    if (owner == NULL)
+        return FALSE;
+    g_variant_get(owner, "(&s)", &name);
+    result = g_str_equal(name, sender);
+    g_variant_unref(owner);
+    return result;
+}
+
+static void
+handle_answer (GDBusConnection* connection, const gchar* sender, const gchar* object_path,
+        const gchar* interface_name, const gchar* method_name, GVariant* parameters,
+        GDBusMethodInvocation* invocation, gpointer user_data)
+{
+    Request* request = user_data;
+    GHbciDaemonClient* self = request->client;
+    const gchar* message;
+    const gchar* optional;
+    gint64 reason;
+
+    if (!is_daemon(self, sender)) {
+        g_dbus_method_invocation_return_error_literal(invocation, G_DBUS_ERROR, G_DBUS_ERROR_ACCESS_DENIED,
+                "only " GHBCI_DAEMON_NAME " may ask");
+        return;
+    }
+
+    g_variant_get(parameters, "(x&s&s)", &reason, &message, &optional);
+    gchar* answer = self->callback(request->blz, request->userid, reason, message, optional, self->user_data);
+    g_dbus_method_invocation_return_value(invocation, g_variant_new("(bs)", answer != NULL,
+                answer != NULL ? answer : ""));
+    g_free(answer);
+}
+
+static const GDBusInterfaceVTable callback_vtable = { handle_answer, NULL, NULL };
+
+static void
+request_done (GObject* source, GAsyncResult* result, gpointer user_data)
+{
+    Request* request = user_data;
+
+    request->reply = g_dbus_connection_send_message_with_reply_finish(G_DBUS_CONNECTION(source), result,
+            &request->error);
+}
+
+/*
+ * Call a method of the daemon, arguments is the tuple of arguments before
+ * the callback object. Returns the reply, or NULL with error set.
+ */
+static GDBusMessage*
+call_daemon (GHbciDaemonClient* self, const gchar* blz, const gchar* userid, const gchar* method,
+        GVariant* arguments, GError** error)
+{
+    GVariantBuilder builder;
+    GVariantIter iter;
+    GVariant* child;
+    Request request = { self, blz, userid, NULL, NULL };
+    guint id;
+
+    g_variant_ref_sink(arguments);
+    gchar* path = g_strdup_printf("/org/ghbci/Client/Request%d", g_atomic_int_add(&self->n_requests, 1));
+    g_variant_builder_init(&builder, G_VARIANT_TYPE_TUPLE);
+    g_variant_iter_init(&iter, arguments);
+    while ((child = g_variant_iter_next_value(&iter)) != NULL) {
+        g_variant_builder_add_value(&builder, child);
+        g_variant_unref(child);
+    }
+    g_variant_builder_add(&builder, "o", path);
+    g_variant_unref(arguments);
+
+    GMainContext* main_context = g_main_context_new();
+    g_main_context_push_thread_default(main_context);
+
+    id = g_dbus_connection_register_object(self->connection, path,
+            g_dbus_node_info_lookup_interface(self->introspection, GHBCI_DAEMON_CALLBACK_INTERFACE),
+            &callback_vtable, &request, NULL, &request.error);
+    if (id != 0) {
+        GDBusMessage* message = g_dbus_message_new_method_call(
+                g_dbus_connection_get_unique_name(self->connection) != NULL ? GHBCI_DAEMON_NAME : NULL,
+                GHBCI_DAEMON_PATH, GHBCI_DAEMON_INTERFACE, method);
+        g_dbus_message_set_body(message, g_variant_builder_end(&builder));
+        // asking for a tan takes as long as the user needs, there is no
+        // timeout, the bus replies if the daemon exits
+        g_dbus_connection_send_message_with_reply(self->connection, message, G_DBUS_SEND_MESSAGE_FLAGS_NONE,
+                G_MAXINT, NULL, NULL, request_done, &request);
+        g_object_unref(message);
+        while (request.reply == NULL && request.error == NULL)
+            g_main_context_iteration(main_context, TRUE);
+        g_dbus_connection_unregister_object(self->connection, id);
+    } else {
+        g_variant_builder_clear(&builder);
+    }
+
+    g_main_context_pop_thread_default(main_context);
+    g_main_context_unref(main_context);
+    g_free(path);
+
+    if (request.reply != NULL && ghbci_daemon_propagate_reply_error(&request.error, request.reply)) {
+        g_clear_object(&request.reply);
+        // errors of the bus, like no reply of an exiting daemon, are
+        // handled like the transport failing
+        if (request.error->domain != G_DBUS_ERROR) {
+            g_propagate_error(error, request.error);
+            return NULL;
+        }
+    }
+    if (request.error != NULL) {
+        ghbci_set_error(error, GHBCI_ERROR_WORKER, NULL, GHBCI_RETRY_HINT_RETRY, "calling ghbci-daemon failed: %s",
+                request.error->message);
+        g_error_free(request.error);
+        return NULL;
+    }
+    return request.reply;
+}
+
+/*
+ * Talk to ghbci-daemon on connection, the session bus or a peer to peer
+ * connection to the daemon. The daemon is started on the bus if it doesn't
+ * run yet. Callbacks of the daemon are passed to callback, on the thread of
+ * the request.
+ */
+GHbciDaemonClient*
+ghbci_daemon_client_new (GDBusConnection* connection, GHbciWorkerCallbackFunc callback, gpointer user_data,
+        GError** error)
+{
+    GHbciDaemonClient* self;
+    GVariant* result;
+
+    g_return_val_if_fail (G_IS_DBUS_CONNECTION (connection), NULL);
+    g_return_val_if_fail (callback != NULL, NULL);
+
+    // start it now rather than with the first request
+    if (g_dbus_connection_get_unique_name(connection) != NULL) {
+        result = g_dbus_connection_call_sync(connection, "org.freedesktop.DBus", "/org/freedesktop/DBus",
+                "org.freedesktop.DBus", "StartServiceByName", g_variant_new("(su)", GHBCI_DAEMON_NAME, 0),
+                G_VARIANT_TYPE("(u)"), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+        if (result == NULL)
+            return NULL;
+        g_variant_unref(result);
+    }
+
+    self = g_new0(GHbciDaemonClient, 1);
+    self->connection = g_object_ref(connection);
+    self->introspection = g_dbus_node_info_new_for_xml(GHBCI_DAEMON_INTROSPECTION, NULL);
+    self->callback = callback;
+    self->user_data = user_data;
+    return self;
+}
+
+/*
+ * Disconnect, no request may be running
+ */
+void
+ghbci_daemon_client_free (GHbciDaemonClient* self)
+{
+    g_return_if_fail (self != NULL);
+
+    g_dbus_node_info_unref(self->introspection);
+    g_object_unref(self->connection);
+    g_free(self);
+}
+
+gboolean
+ghbci_daemon_client_add_passport (GHbciDaemonClient* self, const gchar* blz, const gchar* userid, GError** error)
+{
+    GDBusMessage* reply;
+
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    reply = call_daemon(self, blz, userid, "AddPassport", g_variant_new("(ss)", blz, userid), error);
+    if (reply == NULL)
+        return FALSE;
+    g_object_unref(reply);
+    return TRUE;
+}
+
+gchar*
+ghbci_daemon_client_get_balances (GHbciDaemonClient* self, const gchar* blz, const gchar* userid,
+        const gchar* number, GError** error)
+{
+    GDBusMessage* reply;
+    gboolean has_balance;
+    gchar* balance;
+
+    g_return_val_if_fail (self != NULL, NULL);
+
+    reply = call_daemon(self, blz, userid, "GetBalances", g_variant_new("(sss)", blz, userid, number), error);
+    if (reply == NULL)
+        return NULL;
+    g_variant_get(g_dbus_message_get_body(reply), "(bs)", &has_balance, &balance);
+    g_object_unref(reply);
+    if (!has_balance)
+        g_clear_pointer(&balance, g_free);
+    return balance;
+}
+
+GSList*
+ghbci_daemon_client_get_statements (GHbciDaemonClient* self, const gchar* blz, const gchar* userid,
+        const gchar* number, gboolean native_mt940, GHbciStringPool* pool, GError** error)
+{
+    GDBusMessage* reply;
+    GUnixFDList* fd_list;
+    GError* read_error = NULL;
+    GSList* statements = NULL;
+    gint32 handle;
+    gint fd = -1;
+
+    g_return_val_if_fail (self != NULL, NULL);
+
+    reply = call_daemon(self, blz, userid, "GetStatements",
+            g_variant_new("(sssb)", blz, userid, number, native_mt940), error);
+    if (reply == NULL)
+        return NULL;
+
+    g_variant_get(g_dbus_message_get_body(reply), "(h)", &handle);
+    fd_list = g_dbus_message_get_unix_fd_list(reply);
+    if (fd_list != NULL)
+        fd = g_unix_fd_list_get(fd_list, handle, &read_error);
+    else
+        g_set_error_literal(&read_error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "no statements sent");
+    if (fd >= 0) {
+        statements = ghbci_worker_read_statements(fd, pool, &read_error);
+        close(fd);
+    }
+    if (read_error != NULL) {
+        ghbci_set_error(error, GHBCI_ERROR_WORKER, NULL, GHBCI_RETRY_HINT_RETRY,
+                "statements of ghbci-daemon are invalid: %s", read_error->message);
+        g_error_free(read_error);
+    }
+    g_object_unref(reply);
+    return statements;
+}
+
+
+/*
+ * Run a request of the worker protocol on the daemon, like
+ * ghbci_worker_pool_request(). A floating body is consumed. Fails if the
+ * reply isn't of reply_type.
+ */
+GVariant*
+ghbci_daemon_client_request (GHbciDaemonClient* self, const gchar* blz, const gchar* userid,
+        GHbciWorkerMessage kind, GVariant* body, const GVariantType* reply_type, GError** error)
+{
+    const gchar* method = ghbci_daemon_method_for_kind(kind);
+    GDBusMessage* reply;
+    GVariant* arguments;
+    GVariant* flat;
+    GVariant* result = NULL;
+    gchar* type;
+    gchar* flat_type;
+
+    g_return_val_if_fail (self != NULL, NULL);
+    g_return_val_if_fail (method != NULL, NULL);
+
+    g_variant_ref_sink(body);
+    arguments = ghbci_daemon_variant_from_worker(body);
+    g_variant_unref(body);
+    if (!g_variant_is_of_type(arguments, G_VARIANT_TYPE_TUPLE)) {
+        flat = g_variant_ref_sink(g_variant_new_tuple(&arguments, 1));
+        g_variant_unref(arguments);
+        arguments = flat;
+    }
+    reply = call_daemon(self, blz, userid, method, arguments, error);
+    g_variant_unref(arguments);
+    if (reply == NULL)
+        return NULL;
+
+    // replies of a single value come as a tuple of one
+    type = flat_type_string(reply_type);
+    flat_type = g_variant_type_is_tuple(reply_type) ? g_strdup(type) : g_strdup_printf("(%s)", type);
+    flat = g_dbus_message_get_body(reply);
+    flat = flat != NULL ? g_variant_ref(flat) : g_variant_ref_sink(g_variant_new("()"));
+    if (g_variant_is_of_type(flat, G_VARIANT_TYPE(flat_type))) {
+        if (!g_variant_type_is_tuple(reply_type)) {
+            GVariant* child = g_variant_get_child_value(flat, 0);
+            g_variant_unref(flat);
+            flat = child;
+        }
+        result = ghbci_daemon_variant_to_worker(flat, reply_type);
+    } else {
+        ghbci_set_error(error, GHBCI_ERROR_WORKER, NULL, GHBCI_RETRY_HINT_NEVER,
+                "unexpected reply of type %s from ghbci-daemon", g_variant_get_type_string(flat));
+    }
+    g_variant_unref(flat);
+    g_free(flat_type);
+    g_free(type);
+    g_object_unref(reply);
+    return result;
+}
+
+
+// vim: sw=4 expandtab
@@ -0,0 +1,200 @@
+/*
+ * ghbci-daemon-private.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_DAEMON_PRIVATE_H__
+#define __GHBCI_DAEMON_PRIVATE_H__
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "ghbci-context.h"
+#include "ghbci-string-pool-private.h"
+#include "ghbci-worker-pool-private.h"
+
+#define GHBCI_DAEMON_NAME                   "org.ghbci.Daemon"
+#define GHBCI_DAEMON_PATH                   "/org/ghbci/Daemon"
+#define GHBCI_DAEMON_INTERFACE              "org.ghbci.Daemon1"
+#define GHBCI_DAEMON_CALLBACK_INTERFACE     "org.ghbci.Callback1"
+
+/* a transfer: name, bic, iban, reference, amount, end to end id */
+#define GHBCI_DAEMON_TRANSFER_TYPE  "(ssssss)"
+/* a standing order: order id, transfer, julian first and last date (0 if
+ * none), time unit, turnus, execution day */
+#define GHBCI_DAEMON_ORDER_TYPE     "(s" GHBCI_DAEMON_TRANSFER_TYPE "uuyuu)"
+
+/*
+ * Every request names an object of the caller implementing the callback
+ * interface, the daemon calls it for the callbacks of the passport while
+ * the request runs. Error replies carry segment and retry hint after the
+ * message, as (ssu).
+ *
+ * The methods are the requests of the worker protocol, see
+ * ghbci-worker-pool-private.h, with the same arguments. D-Bus has no maybe
+ * types, missing strings are empty, see ghbci_daemon_variant_from_worker().
+ */
+#define GHBCI_DAEMON_INTROSPECTION \
+    "<node>" \
+    "  <interface name='" GHBCI_DAEMON_INTERFACE "'>" \
+    "    <method name='AddPassport'>" \
+    "      <arg direction='in' type='s' name='blz'/>" \
+    "      <arg direction='in' type='s' name='userid'/>" \
+    "      <arg direction='in' type='o' name='callback'/>" \
+    "    </method>" \
+    "    <method name='GetBalances'>" \
+    "      <arg direction='in' type='s' name='blz'/>" \
+    "      <arg direction='in' type='s' name='userid'/>" \
+    "      <arg direction='in' type='s' name='number'/>" \
+    "      <arg direction='in' type='o' name='callback'/>" \
+    "      <arg direction='out' type='b' name='has_balance'/>" \
+    "      <arg direction='out' type='s' name='balance'/>" \
+    "    </method>" \
+    "    <method name='GetStatements'>" \
+    "      <arg direction='in' type='s' name='blz'/>" \
+    "      <arg direction='in' type='s' name='userid'/>" \
+    "      <arg direction='in' type='s' name='number'/>" \
+    "      <arg direction='in' type='b' name='native_mt940'/>" \
+    "      <arg direction='in' type='o' name='callback'/>" \
+    "      <arg direction='out' type='h' name='statements'/>" \
+    "    </method>" \
+    "    <method name='GetAccounts'>" \
+    "      <arg direction='in' type='s' name='blz'/>" \
+    "      <arg direction='in' type='s' name='userid'/>" \
+    "      <arg direction='in' type='o' name='callback'/>" \
+    "      <arg direction='out' type='aa{ss}' name='accounts'/>" \
+    "    </method>" \
+    "    <method name='GetTanMethods'>" \
+    "      <arg direction='in' type='s' name='blz'/>" \
+    "      <arg direction='in' type='s' name='userid'/>" \
+    "      <arg direction='in' type='o' name='callback'/>" \
+    "      <arg direction='out' type='a{ss}' name='tan_methods'/>" \
+    "    </method>" \
+    "    <method name='SendTransfer'>" \
+    "      <arg direction='in' type='s' name='blz'/>" \
+    "      <arg direction='in' type='s' name='userid'/>" \
+    "      <arg direction='in' type='s' name='number'/>" \
+    "      <arg direction='in' type='s' name='source_name'/>" \
+    "      <arg direction='in' type='s' name='source_bic'/>" \
+    "      <arg direction='in' type='s' name='source_iban'/>" \
+    "      <arg direction='in' type='" GHBCI_DAEMON_TRANSFER_TYPE "' name='transfer'/>" \
+    "      <arg direction='in' type='u' name='execution_date'/>" \
+    "      <arg direction='in' type='o' name='callback'/>" \
+    "      <arg direction='out' type='s' name='order_id'/>" \
+    "    </method>" \
+    "    <method name='SendTransfers'>" \
+    "      <arg direction='in' type='s' name='blz'/>" \
+    "      <arg direction='in' type='s' name='userid'/>" \
+    "      <arg direction='in' type='s' name='number'/>" \
+    "      <arg direction='in' type='s' name='source_name'/>" \
+    "      <arg direction='in' type='s' name='source_bic'/>" \
+    "      <arg direction='in' type='s' name='source_iban'/>" \
+    "      <arg direction='in' type='a" GHBCI_DAEMON_TRANSFER_TYPE "' name='transfers'/>" \
+    "      <arg direction='in' type='o' name='callback'/>" \
+    "    </method>" \
+    "    <method name='CreateStandingOrder'>" \
+    "      <arg direction='in' type='s' name='blz'/>" \
+    "      <arg direction='in' type='s' name='userid'/>" \
+    "      <arg direction='in' type='s' name='number'/>" \
+    "      <arg direction='in' type='s' name='source_name'/>" \
+    "      <arg direction='in' type='s' name='source_bic'/>" \
+    "      <arg direction='in' type='s' name='source_iban'/>" \
+    "      <arg direction='in' type='" GHBCI_DAEMON_ORDER_TYPE "' name='order'/>" \
+    "      <arg direction='in' type='o' name='callback'/>" \
+    "      <arg direction='out' type='s' name='order_id'/>" \
+    "    </method>" \
+    "    <method name='GetStandingOrders'>" \
+    "      <arg direction='in' type='s' name='blz'/>" \
+    "      <arg direction='in' type='s' name='userid'/>" \
+    "      <arg direction='in' type='s' name='number'/>" \
+    "      <arg direction='in' type='s' name='source_bic'/>" \
+    "      <arg direction='in' type='s' name='source_iban'/>" \
+    "      <arg direction='in' type='o' name='callback'/>" \
+    "      <arg direction='out' type='a" GHBCI_DAEMON_ORDER_TYPE "' name='orders'/>" \
+    "    </method>" \
+    "    <method name='ValidatePain001'>" \
+    "      <arg direction='in' type='ay' name='document'/>" \
+    "      <arg direction='in' type='o' name='callback'/>" \
+    "    </method>" \
+    "    <method name='GetBank'>" \
+    "      <arg direction='in' type='s' name='blz'/>" \
+    "      <arg direction='in' type='o' name='callback'/>" \
+    "      <arg direction='out' type='s' name='name'/>" \
+    "      <arg direction='out' type='s' name='pin_tan_url'/>" \
+    "    </method>" \
+    "    <method name='ListBanks'>" \
+    "      <arg direction='in' type='o' name='callback'/>" \
+    "      <arg direction='out' type='as' name='blzs'/>" \
+    "    </method>" \
+    "  </interface>" \
+    "  <interface name='" GHBCI_DAEMON_CALLBACK_INTERFACE "'>" \
+    "    <method name='Answer'>" \
+    "      <arg direction='in' type='x' name='reason'/>" \
+    "      <arg direction='in' type='s' name='message'/>" \
+    "      <arg direction='in' type='s' name='optional'/>" \
+    "      <arg direction='out' type='b' name='answered'/>" \
+    "      <arg direction='out' type='s' name='answer'/>" \
+    "    </method>" \
+    "  </interface>" \
+    "</node>"
+
+typedef struct _GHbciDaemonClient GHbciDaemonClient;
+typedef struct _GHbciDaemonService GHbciDaemonService;
+
+void                ghbci_daemon_return_error                 (GDBusMethodInvocation* invocation,
+                                                               const GError* error);
+
+gboolean            ghbci_daemon_propagate_reply_error        (GError** error, GDBusMessage* reply);
+
+const gchar*        ghbci_daemon_method_for_kind              (GHbciWorkerMessage kind);
+
+GHbciWorkerMessage  ghbci_daemon_kind_for_method              (const gchar* method);
+
+GVariant*           ghbci_daemon_variant_from_worker          (GVariant* value);
+
+GVariant*           ghbci_daemon_variant_to_worker            (GVariant* value, const GVariantType* type);
+
+GHbciDaemonClient*  ghbci_daemon_client_new                   (GDBusConnection* connection,
+                                                               GHbciWorkerCallbackFunc callback, gpointer user_data,
+                                                               GError** error);
+
+void                ghbci_daemon_client_free                  (GHbciDaemonClient* self);
+
+gboolean            ghbci_daemon_client_add_passport          (GHbciDaemonClient* self, const gchar* blz,
+                                                               const gchar* userid, GError** error);
+
+gchar*              ghbci_daemon_client_get_balances          (GHbciDaemonClient* self, const gchar* blz,
+                                                               const gchar* userid, const gchar* number,
+                                                               GError** error);
+
+GSList*             ghbci_daemon_client_get_statements        (GHbciDaemonClient* self, const gchar* blz,
+                                                               const gchar* userid, const gchar* number,
+                                                               gboolean native_mt940, GHbciStringPool* pool,
+                                                               GError** error);
+
+GVariant*           ghbci_daemon_client_request               (GHbciDaemonClient* self, const gchar* blz,
+                                                               const gchar* userid, GHbciWorkerMessage kind,
+                                                               GVariant* body, const GVariantType* reply_type,
+                                                               GError** error);
+
+GHbciDaemonService* ghbci_daemon_service_new                  (GHbciContext* context, guint n_threads);
+
+gboolean            ghbci_daemon_service_register             (GHbciDaemonService* self,
+                                                               GDBusConnection* connection, GError** error);
+
+void                ghbci_daemon_service_free                 (GHbciDaemonService* self);
+
+#endif /* __GHBCI_DAEMON_PRIVATE_H__ */
@@ -0,0 +1,353 @@
+/*
+ * ghbci-daemon-service.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/*
+ * The org.ghbci.Daemon1 object of ghbci-daemon, exporting the operations of
+ * one context. Requests run on a thread pool, so a client waiting for a tan
+ * doesn't block the others; callbacks of a request are passed to the
+ * callback object of its client, see ghbci-daemon-private.h for the
+ * interfaces. Like with a #GHbciScheduler, requests for the same passport
+ * run one after the other, since a hbci4java handler is not thread-safe,
+ * and in the thread group of their passport, so requests of different
+ * passports don't share the hbci4java configuration.
+ */
+
+#include <unistd.h>
+#include <gio/gunixfdlist.h>
+
+#include "ghbci-context.h"
+#include "ghbci-context-private.h"
+#include "ghbci-daemon-private.h"
+#include "ghbci-error-private.h"
+
+struct _GHbciDaemonService
+{
+    GDBusNodeInfo* introspection;
+    GHbciContext* context;
+    gulong callback_id;
+    GThreadPool* requests;
+
+    GMutex lock;
+    /* blz+userid of the passports with a running request to the requests waiting for it */
+    GHashTable* passports;
+    gboolean stopping;
+};
+
+/* the invocation of the request running on this thread */
+static GPrivate current_request;
+
+
+static gchar*
+forward_callback (GHbciContext* context, gint64 reason, const gchar* message, const gchar* optional,
+        gpointer user_data)
+{
+    GDBusMethodInvocation* invocation = g_private_get(&current_request);
+    GVariant* parameters;
+    GVariant* result;
+    GError* error = NULL;
+    const gchar* path;
+    gboolean answered;
+    gchar* answer;
+
+    if (invocation == NULL)
+        return NULL;
+
+    // the callback object is the last argument of every method
+    parameters = g_dbus_method_invocation_get_parameters(invocation);
+    g_variant_get_child(parameters, g_variant_n_children(parameters) - 1, "&o", &path);
+
+    // the user may take long for a tan
+    result = g_dbus_connection_call_sync(g_dbus_method_invocation_get_connection(invocation),
+            g_dbus_method_invocation_get_sender(invocation), path, GHBCI_DAEMON_CALLBACK_INTERFACE, "Answer",
+            g_variant_new("(xss)", reason, message != NULL ? message : "", optional != NULL ? optional : ""),
+            G_VARIANT_TYPE("(bs)"), G_DBUS_CALL_FLAGS_NO_AUTO_START, G_MAXINT, NULL, &error);
+    if (result == NULL) {
+        g_warning("asking %s failed: %s", g_dbus_method_invocation_get_sender(invocation), error->message);
+        g_error_free(error);
+        return NULL;
+    }
+
+    g_variant_get(result, "(bs)", &answered, &answer);
+    g_variant_unref(result);
+    if (!answered)
+        g_clear_pointer(&answer, g_free);
+    return answer;
+}
+
+/*
+ * Requests of the worker protocol not running on a passport
+ */
+static gboolean
+has_passport (GHbciWorkerMessage kind)
+{
+    return kind != GHBCI_WORKER_VALIDATE_PAIN001 && kind != GHBCI_WORKER_GET_BANK
+        && kind != GHBCI_WORKER_LIST_BANKS;
+}
+
+/*
+ * The methods of a passport start with blz and userid, NULL for the others
+ */
+static gchar*
+passport_key (GDBusMethodInvocation* invocation)
+{
+    GVariant* parameters = g_dbus_method_invocation_get_parameters(invocation);
+    const gchar *blz, *userid;
+
+    if (!has_passport(ghbci_daemon_kind_for_method(g_dbus_method_invocation_get_method_name(invocation))))
+        return NULL;
+    g_variant_get_child(parameters, 0, "&s", &blz);
+    g_variant_get_child(parameters, 1, "&s", &userid);
+    return g_strconcat(blz, "+", userid, NULL);
+}
+
+/*
+ * The body of the worker request for the arguments of a method call,
+ * without the callback object
+ */
+static GVariant*
+request_body (GVariant* parameters, GHbciWorkerMessage kind)
+{
+    const GVariantType* type = G_VARIANT_TYPE(ghbci_worker_body_type(kind));
+    gsize n = g_variant_n_children(parameters) - 1;
+    GVariant** children = g_new(GVariant*, n);
+    GVariant* arguments;
+    GVariant* body;
+    gsize i;
+
+    for (i = 0; i < n; i++)
+        children[i] = g_variant_get_child_value(parameters, i);
+    if (g_variant_type_is_tuple(type)) {
+        arguments = g_variant_ref_sink(g_variant_new_tuple(children, n));
+    } else {
+        g_return_val_if_fail (n == 1, NULL);
+        arguments = g_variant_ref(children[0]);
+    }
+    for (i = 0; i < n; i++)
+        g_variant_unref(children[i]);
+    g_free(children);
+
+    body = ghbci_daemon_variant_to_worker(arguments, type);
+    g_variant_unref(arguments);
+    return body;
+}
+
+/*
+ * Reply to invocation with the reply of a worker request
+ */
+static void
+return_reply (GDBusMethodInvocation* invocation, GHbciWorkerMessage kind, GVariant* reply, gint fd)
+{
+    GUnixFDList* fd_list;
+    GVariant* value;
+    const gchar* balance;
+
+    if (fd >= 0) {
+        fd_list = g_unix_fd_list_new_from_array(&fd, 1);
+        g_dbus_method_invocation_return_value_with_unix_fd_list(invocation, g_variant_new("(h)", 0), fd_list);
+        g_object_unref(fd_list);
+        return;
+    }
+    if (kind == GHBCI_WORKER_GET_BALANCES) {
+        // older clients tell a missing balance by the flag
+        g_variant_get(reply, "m&s", &balance);
+        g_dbus_method_invocation_return_value(invocation, g_variant_new("(bs)", balance != NULL,
+                    balance != NULL ? balance : ""));
+        return;
+    }
+
+    value = ghbci_daemon_variant_from_worker(reply);
+    if (g_variant_is_of_type(value, G_VARIANT_TYPE_TUPLE))
+        g_dbus_method_invocation_return_value(invocation, value);
+    else
+        g_dbus_method_invocation_return_value(invocation, g_variant_new_tuple(&value, 1));
+    g_variant_unref(value);
+}
+
+static void
+run_request (gpointer data, gpointer user_data)
+{
+    GDBusMethodInvocation* invocation = data;
+    GDBusMethodInvocation* next;
+    GHbciDaemonService* self = user_data;
+    GHbciContext* context = self->context;
+    gchar* key = passport_key(invocation);
+    GVariant* parameters = g_dbus_method_invocation_get_parameters(invocation);
+    GHbciWorkerMessage kind = ghbci_daemon_kind_for_method(g_dbus_method_invocation_get_method_name(invocation));
+    const gchar *blz, *userid;
+    GError* error = NULL;
+    gboolean attached = FALSE;
+    GVariant* body;
+    GVariant* reply;
+    gint fd;
+
+    // a context running the jvm itself, not one passing requests on
+    if (key != NULL && context->priv->jvm != NULL) {
+        g_variant_get_child(parameters, 0, "&s", &blz);
+        g_variant_get_child(parameters, 1, "&s", &userid);
+        attached = ghbci_context_attach_passport_thread(context, blz, userid) != NULL;
+        if (!attached) {
+            ghbci_set_error(&error, GHBCI_ERROR_FAILED, NULL, GHBCI_RETRY_HINT_RETRY,
+                    "could not attach a thread for %s/%s", blz, userid);
+            goto finish;
+        }
+    }
+
+    g_private_set(&current_request, invocation);
+    body = request_body(parameters, kind);
+    reply = ghbci_worker_run_request(context, kind, body, &fd, &error);
+    g_variant_unref(body);
+    if (reply != NULL) {
+        g_variant_ref_sink(reply);
+        return_reply(invocation, kind, reply, fd);
+        g_variant_unref(reply);
+    }
+    g_private_set(&current_request, NULL);
+    if (attached)
+        ghbci_context_detach_thread(context);
+
+finish:
+    if (error != NULL) {
+        ghbci_daemon_return_error(invocation, error);
+        g_error_free(error);
+    }
+    if (key == NULL)
+        return;
+
+    // start the next request of the passport, when stopping the waiting
+    // ones are left to ghbci_daemon_service_free()
+    g_mutex_lock(&self->lock);
+    next = self->stopping ? NULL : g_queue_pop_head(g_hash_table_lookup(self->passports, key));
+    if (next == NULL && !self->stopping)
+        g_hash_table_remove(self->passports, key);
+    g_mutex_unlock(&self->lock);
+    if (next != NULL)
+        g_thread_pool_push(self->requests, next, NULL);
+    g_free(key);
+}
+
+static void
+handle_method_call (GDBusConnection* connection, const gchar* sender, const gchar* object_path,
+        const gchar* interface_name, const gchar* method_name, GVariant* parameters,
+        GDBusMethodInvocation* invocation, gpointer user_data)
+{
+    GHbciDaemonService* self = user_data;
+    gchar* key = passport_key(invocation);
+    GQueue* waiting;
+
+    g_mutex_lock(&self->lock);
+    if (self->stopping) {
+        g_mutex_unlock(&self->lock);
+        g_free(key);
+        g_dbus_method_invocation_return_error_literal(invocation, G_DBUS_ERROR, G_DBUS_ERROR_NO_SERVER,
+                "ghbci-daemon is stopping");
+        return;
+    }
+    if (key == NULL) {
+        g_mutex_unlock(&self->lock);
+        g_thread_pool_push(self->requests, invocation, NULL);
+        return;
+    }
+    waiting = g_hash_table_lookup(self->passports, key);
+    if (waiting != NULL) {
+        g_queue_push_tail(waiting, invocation);
+        g_mutex_unlock(&self->lock);
+        g_free(key);
+        return;
+    }
+    g_hash_table_insert(self->passports, key, g_queue_new());
+    g_mutex_unlock(&self->lock);
+
+    g_thread_pool_push(self->requests, invocation, NULL);
+}
+
+static const GDBusInterfaceVTable service_vtable = { handle_method_call, NULL, NULL };
+
+/*
+ * Export the operations of context, running up to n_threads requests at
+ * once. Callbacks of context are taken over.
+ */
+GHbciDaemonService*
+ghbci_daemon_service_new (GHbciContext* context, guint n_threads)
+{
+    GHbciDaemonService* self;
+
+    g_return_val_if_fail (GHBCI_IS_CONTEXT (context), NULL);
+    g_return_val_if_fail (n_threads > 0, NULL);
+
+    self = g_new0(GHbciDaemonService, 1);
+    self->introspection = g_dbus_node_info_new_for_xml(GHBCI_DAEMON_INTROSPECTION, NULL);
+    self->context = g_object_ref(context);
+    self->callback_id = g_signal_connect(context, "callback", G_CALLBACK(forward_callback), NULL);
+    g_mutex_init(&self->lock);
+    self->passports = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_queue_free);
+    self->requests = g_thread_pool_new(run_request, self, n_threads, FALSE, NULL);
+    return self;
+}
+
+/*
+ * Export the object on connection, method calls are dispatched in the
+ * thread default main context of the caller
+ */
+gboolean
+ghbci_daemon_service_register (GHbciDaemonService* self, GDBusConnection* connection, GError** error)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (G_IS_DBUS_CONNECTION (connection), FALSE);
+
+    return g_dbus_connection_register_object(connection, GHBCI_DAEMON_PATH,
+            g_dbus_node_info_lookup_interface(self->introspection, GHBCI_DAEMON_INTERFACE),
+            &service_vtable, self, NULL, error) != 0;
+}
+
+/*
+ * Wait for the requests on the thread pool, the ones waiting for their
+ * passport fail with an error worth a retry. Method calls must not be
+ * dispatched anymore.
+ */
+void
+ghbci_daemon_service_free (GHbciDaemonService* self)
+{
+    GError* error = NULL;
+    GHashTableIter iter;
+    gpointer waiting;
+    GDBusMethodInvocation* invocation;
+
+    g_return_if_fail (self != NULL);
+
+    g_mutex_lock(&self->lock);
+    self->stopping = TRUE;
+    g_mutex_unlock(&self->lock);
+
+    g_thread_pool_free(self->requests, FALSE, TRUE);
+
+    ghbci_set_error(&error, GHBCI_ERROR_WORKER, NULL, GHBCI_RETRY_HINT_RETRY, "ghbci-daemon is stopping");
+    g_hash_table_iter_init(&iter, self->passports);
+    while (g_hash_table_iter_next(&iter, NULL, &waiting)) {
+        while ((invocation = g_queue_pop_head(waiting)) != NULL)
+            ghbci_daemon_return_error(invocation, error);
+    }
+    g_error_free(error);
+    g_signal_handler_disconnect(self->context, self->callback_id);
+    g_object_unref(self->context);
+    g_hash_table_unref(self->passports);
+    g_mutex_clear(&self->lock);
+    g_dbus_node_info_unref(self->introspection);
+    g_free(self);
+}
+
+// vim: sw=4 expandtab
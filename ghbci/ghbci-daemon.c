@@ -0,0 +1,116 @@
+/*
+ * ghbci-daemon.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/*
+ * Session daemon for ghbci_context_new_for_daemon(). Keeps one context, with
+ * its jvm and the passports of all clients, and exports its operations on
+ * the session bus, see ghbci-daemon-service.c.
+ */
+
+#include <stdlib.h>
+#include <glib/gstdio.h>
+
+#include "ghbci-context.h"
+#include "ghbci-daemon-private.h"
+
+typedef struct
+{
+    GHbciDaemonService* service;
+    GMainLoop* loop;
+} Daemon;
+
+
+static void
+on_bus_acquired (GDBusConnection* connection, const gchar* name, gpointer user_data)
+{
+    Daemon* daemon = user_data;
+    GError* error = NULL;
+
+    if (!ghbci_daemon_service_register(daemon->service, connection, &error)) {
+        g_printerr("registering %s failed: %s\n", GHBCI_DAEMON_PATH, error->message);
+        g_error_free(error);
+        g_main_loop_quit(daemon->loop);
+    }
+}
+
+static void
+on_name_lost (GDBusConnection* connection, const gchar* name, gpointer user_data)
+{
+    Daemon* daemon = user_data;
+
+    g_printerr("lost %s on the session bus\n", name);
+    g_main_loop_quit(daemon->loop);
+}
+
+int
+main (int argc, char** argv)
+{
+    GOptionContext* options;
+    GHbciContext* context;
+    GError* error = NULL;
+    Daemon daemon;
+    gchar* directory = NULL;
+    gint n_workers = 0;
+    gint n_threads = 4;
+    guint owner_id;
+    GOptionEntry entries[] = {
+        { "directory", 0, 0, G_OPTION_ARG_FILENAME, &directory, "Directory of the passports", "DIR" },
+        { "workers", 0, 0, G_OPTION_ARG_INT, &n_workers, "Run hbci4java in N worker processes", "N" },
+        { "threads", 0, 0, G_OPTION_ARG_INT, &n_threads, "Run up to N requests at once", "N" },
+        { NULL }
+    };
+
+    options = g_option_context_new("- hbci4java daemon for ghbci contexts");
+    g_option_context_add_main_entries(options, entries, NULL);
+    if (!g_option_context_parse(options, &argc, &argv, &error) || n_workers < 0 || n_threads < 1) {
+        g_printerr("%s\n", error != NULL ? error->message : "invalid number of workers or threads");
+        g_option_context_free(options);
+        return EXIT_FAILURE;
+    }
+    g_option_context_free(options);
+
+    if (directory == NULL)
+        directory = g_build_filename(g_get_user_data_dir(), "ghbci", NULL);
+    g_mkdir_with_parents(directory, 0700);
+    if (n_workers > 0) {
+        context = ghbci_context_new_with_workers(directory, n_workers, &error);
+    } else {
+        context = ghbci_context_new(directory);
+    }
+    if (context == NULL) {
+        g_printerr("%s\n", error != NULL ? error->message : "starting the jvm failed");
+        g_clear_error(&error);
+        return EXIT_FAILURE;
+    }
+
+    daemon.service = ghbci_daemon_service_new(context, n_threads);
+    daemon.loop = g_main_loop_new(NULL, FALSE);
+    owner_id = g_bus_own_name(G_BUS_TYPE_SESSION, GHBCI_DAEMON_NAME, G_BUS_NAME_OWNER_FLAGS_NONE,
+            on_bus_acquired, NULL, on_name_lost, &daemon, NULL);
+
+    g_main_loop_run(daemon.loop);
+
+    g_bus_unown_name(owner_id);
+    ghbci_daemon_service_free(daemon.service);
+    g_main_loop_unref(daemon.loop);
+    g_object_unref(context);
+    g_free(directory);
+    return EXIT_SUCCESS;
+}
+
+// vim: sw=4 expandtab
@@ -0,0 +1,32 @@
+/*
+ * ghbci-error-private.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_ERROR_PRIVATE_H__
+#define __GHBCI_ERROR_PRIVATE_H__
+
+#include <glib.h>
+
+#include "ghbci-error.h"
+
+GHbciRetryHint    ghbci_error_retry_hint_for_code             (gint code);
+
+void              ghbci_set_error                             (GError** error, gint code, const gchar* segment,
+                                                               GHbciRetryHint retry_hint, const gchar* format,
+                                                               ...) G_GNUC_PRINTF (5, 6);
+
+#endif /* __GHBCI_ERROR_PRIVATE_H__ */
@@ -0,0 +1,162 @@
+/*
+ * ghbci-error.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/**
+ * SECTION:ghbci-error
+ * @short_description: Errors reported by the bank and hbci4java
+ *
+ * Failing operations of #GHbciContext report a #GError in the #GHBCI_ERROR
+ * domain. When the bank rejected a job, the error code is the HBCI return
+ * code of the first error the bank sent and the message its text. The
+ * referenced segment and a hint whether a retry makes sense are attached
+ * to the error and survive g_error_copy().
+ **/
+
+#include "ghbci-error.h"
+#include "ghbci-error-private.h"
+
+typedef struct
+{
+    gchar* segment;
+    GHbciRetryHint retry_hint;
+} GHbciErrorPrivate;
+
+static void
+ghbci_error_private_init (GHbciErrorPrivate* priv)
+{
+    priv->segment = NULL;
+    priv->retry_hint = GHBCI_RETRY_HINT_NEVER;
+}
+
+static void
+ghbci_error_private_copy (const GHbciErrorPrivate* src, GHbciErrorPrivate* dest)
+{
+    dest->segment = g_strdup(src->segment);
+    dest->retry_hint = src->retry_hint;
+}
+
+static void
+ghbci_error_private_clear (GHbciErrorPrivate* priv)
+{
+    g_free(priv->segment);
+}
+
+G_DEFINE_EXTENDED_ERROR (GHbciError, ghbci_error)
+
+
+/*
+ * HBCI return codes not meaning a permanent rejection
+ */
+static const struct {
+    gint code;
+    GHbciRetryHint retry_hint;
+} retry_hints[] = {
+    { 9800, GHBCI_RETRY_HINT_RETRY },       // dialog aborted
+    { 9931, GHBCI_RETRY_HINT_USER_ACTION }, // userid or pin wrong
+    { 9941, GHBCI_RETRY_HINT_USER_ACTION }, // tan wrong
+    { 9942, GHBCI_RETRY_HINT_USER_ACTION }, // pin wrong
+    { GHBCI_ERROR_NETWORK, GHBCI_RETRY_HINT_RETRY },
+};
+
+/*
+ * Classify an error code of #GHBCI_ERROR
+ */
+GHbciRetryHint
+ghbci_error_retry_hint_for_code (gint code)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(retry_hints); i++) {
+        if (retry_hints[i].code == code)
+            return retry_hints[i].retry_hint;
+    }
+    return GHBCI_RETRY_HINT_NEVER;
+}
+
+/*
+ * Set a #GHBCI_ERROR with segment and retry hint
+ */
+void
+ghbci_set_error (GError** error, gint code, const gchar* segment, GHbciRetryHint retry_hint,
+        const gchar* format, ...)
+{
+    GHbciErrorPrivate* priv;
+    GError* new_error;
+    va_list args;
+
+    if (error == NULL)
+        return;
+
+    va_start(args, format);
+    new_error = g_error_new_valist(GHBCI_ERROR, code, format, args);
+    va_end(args);
+
+    priv = ghbci_error_get_private(new_error);
+    priv->segment = g_strdup(segment);
+    priv->retry_hint = retry_hint;
+
+    g_propagate_error(error, new_error);
+}
+
+/**
+ * ghbci_error_get_segment:
+ * @error: a #GError
+ *
+ * Get the segment the bank referenced with the error, like "3" for the
+ * third segment of the message
+ *
+ * Returns: (nullable): segment reference or %NULL if unknown
+ **/
+const gchar*
+ghbci_error_get_segment (const GError* error)
+{
+    GHbciErrorPrivate* priv;
+
+    g_return_val_if_fail (error != NULL, NULL);
+
+    // the private data only exists for our domain
+    if (error->domain != GHBCI_ERROR)
+        return NULL;
+    priv = ghbci_error_get_private(error);
+    return priv != NULL ? priv->segment : NULL;
+}
+
+/**
+ * ghbci_error_get_retry_hint:
+ * @error: a #GError
+ *
+ * Tell whether the failed operation is worth retrying. Errors of other
+ * domains are never retried.
+ *
+ * Returns: retry hint
+ **/
+GHbciRetryHint
+ghbci_error_get_retry_hint (const GError* error)
+{
+    GHbciErrorPrivate* priv;
+
+    g_return_val_if_fail (error != NULL, GHBCI_RETRY_HINT_NEVER);
+
+    if (error->domain != GHBCI_ERROR)
+        return GHBCI_RETRY_HINT_NEVER;
+    priv = ghbci_error_get_private(error);
+    return priv != NULL ? priv->retry_hint : GHBCI_RETRY_HINT_NEVER;
+}
+
+
+// vim: sw=4 expandtab
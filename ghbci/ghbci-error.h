@@ -0,0 +1,83 @@
+/*
+ * ghbci-error.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_ERROR_H__
+#define __GHBCI_ERROR_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GHBCI_ERROR:
+ *
+ * Error domain of ghbci. Errors reported by the bank use the numeric HBCI
+ * return code (e.g. 9800) as error code, errors detected locally use the
+ * values of #GHbciError, which are all below 1000.
+ **/
+#define GHBCI_ERROR (ghbci_error_quark ())
+
+/**
+ * GHbciError:
+ * @GHBCI_ERROR_FAILED: unspecific failure
+ * @GHBCI_ERROR_NO_PASSPORT: no passport was added for blz and userid
+ * @GHBCI_ERROR_EXCEPTION: hbci4java threw an exception
+ * @GHBCI_ERROR_NETWORK: connection to the bank failed
+ * @GHBCI_ERROR_ABORTED: aborted by a callback
+ * @GHBCI_ERROR_NOT_SUPPORTED: operation not supported
+ * @GHBCI_ERROR_INVALID_DATA: invalid input, rejected before contacting the bank
+ * @GHBCI_ERROR_WORKER: a worker process of ghbci_context_new_with_workers()
+ *   crashed or stopped answering, it is restarted for the next operation,
+ *   or the daemon of ghbci_context_new_for_daemon() can't be reached
+ *
+ * Local error codes of #GHBCI_ERROR
+ **/
+typedef enum {
+	GHBCI_ERROR_FAILED = 1,
+	GHBCI_ERROR_NO_PASSPORT = 2,
+	GHBCI_ERROR_EXCEPTION = 3,
+	GHBCI_ERROR_NETWORK = 4,
+	GHBCI_ERROR_ABORTED = 5,
+	GHBCI_ERROR_NOT_SUPPORTED = 6,
+	GHBCI_ERROR_INVALID_DATA = 7,
+	GHBCI_ERROR_WORKER = 8,
+} GHbciError;
+
+/**
+ * GHbciRetryHint:
+ * @GHBCI_RETRY_HINT_NEVER: would fail again
+ * @GHBCI_RETRY_HINT_RETRY: temporary problem, retrying may succeed
+ * @GHBCI_RETRY_HINT_USER_ACTION: needs user interaction first, like a correct PIN
+ *
+ * Whether an operation failing with a #GHBCI_ERROR is worth retrying
+ **/
+typedef enum {
+	GHBCI_RETRY_HINT_NEVER = 0,
+	GHBCI_RETRY_HINT_RETRY = 1,
+	GHBCI_RETRY_HINT_USER_ACTION = 2,
+} GHbciRetryHint;
+
+GQuark            ghbci_error_quark                          (void);
+
+const gchar*      ghbci_error_get_segment                    (const GError* error);
+
+GHbciRetryHint    ghbci_error_get_retry_hint                 (const GError* error);
+
+G_END_DECLS
+
+#endif /* __GHBCI_ERROR_H__ */
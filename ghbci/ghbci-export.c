@@ -0,0 +1,516 @@
+/*
+ * ghbci-export.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/**
+ * SECTION:ghbci-export
+ * @short_description: Writes statements to files
+ *
+ * Statements are written to a #GOutputStream in CSV, JSON Lines or OFX.
+ * The fields are read directly instead of through g_object_get(), and the
+ * output is collected in a buffer that is written in large blocks, so
+ * exporting many statements costs little more than the I/O.
+ *
+ * CSV and JSON Lines have the fields valuta, booking_date, amount,
+ * currency, saldo, gv_code, transaction_type, other_name, other_iban,
+ * other_bic, eref, mref, cred and reference. Dates are ISO 8601, amounts
+ * have a decimal point and are negative for debits.
+ **/
+
+#include <string.h>
+#include <gio/gunixoutputstream.h>
+
+#include "ghbci-export.h"
+#include "ghbci-statement.h"
+#include "ghbci-statement-private.h"
+
+/* the buffer is written when it grows beyond this */
+#define BUFFER_SIZE         65536
+/* OFX limits the name of the payee */
+#define OFX_NAME_LENGTH     32
+
+typedef struct
+{
+    GOutputStream* stream;
+    GCancellable* cancellable;
+    GString* buffer;
+} Writer;
+
+static gboolean
+writer_flush (Writer* writer, GError** error)
+{
+    gboolean success;
+
+    if (writer->buffer->len == 0)
+        return TRUE;
+    success = g_output_stream_write_all(writer->stream, writer->buffer->str, writer->buffer->len, NULL,
+            writer->cancellable, error);
+    g_string_truncate(writer->buffer, 0);
+    return success;
+}
+
+/*
+ * Write the buffer once it is full, called after each statement
+ */
+static gboolean
+writer_next (Writer* writer, GError** error)
+{
+    if (writer->buffer->len < BUFFER_SIZE)
+        return TRUE;
+    return writer_flush(writer, error);
+}
+
+/*
+ * Split "-12.34 EUR" into the amount and the currency
+ */
+static const gchar*
+split_value (const gchar* value, gsize* amount_length)
+{
+    const gchar* space;
+
+    if (value == NULL) {
+        *amount_length = 0;
+        return NULL;
+    }
+    space = strrchr(value, ' ');
+    if (space == NULL) {
+        *amount_length = strlen(value);
+        return NULL;
+    }
+    *amount_length = space - value;
+    return space + 1;
+}
+
+static void
+append_date (GString* buffer, guint32 date, const gchar* format)
+{
+    GDate view;
+
+    ghbci_statement_date_view(date, &view);
+    g_string_append_printf(buffer, format, g_date_get_year(&view), g_date_get_month(&view), g_date_get_day(&view));
+}
+
+/*
+ * CSV
+ */
+
+static const gchar* const csv_header =
+    "valuta,booking_date,amount,currency,saldo,gv_code,transaction_type,"
+    "other_name,other_iban,other_bic,eref,mref,cred,reference\r\n";
+
+static void
+append_csv (GString* buffer, const gchar* text, gsize length)
+{
+    const gchar* p;
+    const gchar* end = text + length;
+
+    for (p = text; p < end; p++) {
+        if (*p == ',' || *p == '"' || *p == '\r' || *p == '\n')
+            break;
+    }
+    if (p == end) {
+        g_string_append_len(buffer, text, length);
+        return;
+    }
+
+    g_string_append_c(buffer, '"');
+    for (p = text; p < end; p++) {
+        if (*p == '"')
+            g_string_append_c(buffer, '"');
+        g_string_append_c(buffer, *p);
+    }
+    g_string_append_c(buffer, '"');
+}
+
+static void
+append_csv_field (GString* buffer, const gchar* text)
+{
+    if (text != NULL)
+        append_csv(buffer, text, strlen(text));
+    g_string_append_c(buffer, ',');
+}
+
+static void
+append_csv_date (GString* buffer, guint32 date)
+{
+    if (date != 0)
+        append_date(buffer, date, "%04u-%02u-%02u");
+    g_string_append_c(buffer, ',');
+}
+
+static void
+write_csv (GString* buffer, const GHbciStatementPrivate* priv)
+{
+    gsize length;
+    const gchar* currency;
+
+    append_csv_date(buffer, priv->valuta);
+    append_csv_date(buffer, priv->booking_date);
+    currency = split_value(priv->value, &length);
+    append_csv(buffer, priv->value, length);
+    g_string_append_c(buffer, ',');
+    append_csv_field(buffer, currency);
+    split_value(priv->saldo, &length);
+    append_csv(buffer, priv->saldo, length);
+    g_string_append_c(buffer, ',');
+    append_csv_field(buffer, priv->gv_code);
+    append_csv_field(buffer, priv->transaction_type);
+    append_csv_field(buffer, priv->other_name);
+    append_csv_field(buffer, priv->other_iban);
+    append_csv_field(buffer, priv->other_bic);
+    append_csv_field(buffer, priv->eref);
+    append_csv_field(buffer, priv->mref);
+    append_csv_field(buffer, priv->cred);
+    if (priv->reference != NULL)
+        append_csv(buffer, priv->reference, strlen(priv->reference));
+    g_string_append(buffer, "\r\n");
+}
+
+/*
+ * JSON Lines
+ */
+
+static void
+append_json (GString* buffer, const gchar* key, const gchar* text, gsize length)
+{
+    const gchar* p;
+    const gchar* end = text + length;
+
+    g_string_append_c(buffer, '"');
+    g_string_append(buffer, key);
+    g_string_append(buffer, "\":");
+    if (text == NULL) {
+        g_string_append(buffer, "null,");
+        return;
+    }
+
+    g_string_append_c(buffer, '"');
+    for (p = text; p < end; p++) {
+        switch (*p) {
+        case '"':
+            g_string_append(buffer, "\\\"");
+            break;
+        case '\\':
+            g_string_append(buffer, "\\\\");
+            break;
+        case '\n':
+            g_string_append(buffer, "\\n");
+            break;
+        case '\r':
+            g_string_append(buffer, "\\r");
+            break;
+        case '\t':
+            g_string_append(buffer, "\\t");
+            break;
+        default:
+            if ((guchar)*p < 0x20)
+                g_string_append_printf(buffer, "\\u%04x", (guchar)*p);
+            else
+                g_string_append_c(buffer, *p);
+        }
+    }
+    g_string_append(buffer, "\",");
+}
+
+static void
+append_json_field (GString* buffer, const gchar* key, const gchar* text)
+{
+    append_json(buffer, key, text, text != NULL ? strlen(text) : 0);
+}
+
+static void
+append_json_date (GString* buffer, const gchar* key, guint32 date)
+{
+    g_string_append_printf(buffer, "\"%s\":", key);
+    if (date != 0)
+        append_date(buffer, date, "\"%04u-%02u-%02u\",");
+    else
+        g_string_append(buffer, "null,");
+}
+
+static void
+write_json_line (GString* buffer, const GHbciStatementPrivate* priv)
+{
+    gsize length;
+    const gchar* currency;
+
+    g_string_append_c(buffer, '{');
+    append_json_date(buffer, "valuta", priv->valuta);
+    append_json_date(buffer, "booking_date", priv->booking_date);
+    currency = split_value(priv->value, &length);
+    append_json(buffer, "amount", priv->value, length);
+    append_json_field(buffer, "currency", currency);
+    split_value(priv->saldo, &length);
+    append_json(buffer, "saldo", priv->saldo, length);
+    append_json_field(buffer, "gv_code", priv->gv_code);
+    append_json_field(buffer, "transaction_type", priv->transaction_type);
+    append_json_field(buffer, "other_name", priv->other_name);
+    append_json_field(buffer, "other_iban", priv->other_iban);
+    append_json_field(buffer, "other_bic", priv->other_bic);
+    append_json_field(buffer, "eref", priv->eref);
+    append_json_field(buffer, "mref", priv->mref);
+    append_json_field(buffer, "cred", priv->cred);
+    append_json_field(buffer, "reference", priv->reference);
+    // replace the trailing comma
+    buffer->str[buffer->len - 1] = '}';
+    g_string_append_c(buffer, '\n');
+}
+
+/*
+ * OFX
+ */
+
+static void
+append_xml (GString* buffer, const gchar* text, gsize length)
+{
+    const gchar* p;
+    const gchar* end = text + length;
+
+    for (p = text; p < end; p++) {
+        switch (*p) {
+        case '&':
+            g_string_append(buffer, "&amp;");
+            break;
+        case '<':
+            g_string_append(buffer, "&lt;");
+            break;
+        case '>':
+            g_string_append(buffer, "&gt;");
+            break;
+        default:
+            g_string_append_c(buffer, *p);
+        }
+    }
+}
+
+static void
+append_ofx_element (GString* buffer, const gchar* name, const gchar* text, gsize length)
+{
+    g_string_append_printf(buffer, "<%s>", name);
+    append_xml(buffer, text, length);
+    g_string_append_printf(buffer, "</%s>\n", name);
+}
+
+static void
+append_ofx_date (GString* buffer, const gchar* name, guint32 date)
+{
+    g_string_append_printf(buffer, "<%s>", name);
+    append_date(buffer, date, "%04u%02u%02u");
+    g_string_append_printf(buffer, "</%s>\n", name);
+}
+
+static void
+write_ofx_header (GString* buffer, GSList* statements, const gchar* blz, const gchar* number)
+{
+    const GHbciStatementPrivate* first = NULL;
+    const GHbciStatementPrivate* last = NULL;
+    const gchar* currency = NULL;
+    GSList* iter;
+    gsize length;
+
+    for (iter = statements; iter != NULL; iter = iter->next) {
+        const GHbciStatementPrivate* priv = GHBCI_STATEMENT(iter->data)->priv;
+        if (priv->booking_date == 0)
+            continue;
+        if (first == NULL)
+            first = priv;
+        last = priv;
+    }
+    if (statements != NULL)
+        currency = split_value(GHBCI_STATEMENT(statements->data)->priv->value, &length);
+
+    GDateTime* now = g_date_time_new_now_utc();
+    gchar* server_time = g_date_time_format(now, "%Y%m%d%H%M%S");
+    g_date_time_unref(now);
+
+    g_string_append(buffer,
+            "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n"
+            "<?OFX OFXHEADER=\"200\" VERSION=\"220\" SECURITY=\"NONE\" OLDFILEUID=\"NONE\" NEWFILEUID=\"NONE\"?>\n"
+            "<OFX>\n"
+            "<SIGNONMSGSRSV1>\n<SONRS>\n"
+            "<STATUS>\n<CODE>0</CODE>\n<SEVERITY>INFO</SEVERITY>\n</STATUS>\n");
+    g_string_append_printf(buffer, "<DTSERVER>%s</DTSERVER>\n", server_time);
+    g_string_append(buffer,
+            "<LANGUAGE>GER</LANGUAGE>\n"
+            "</SONRS>\n</SIGNONMSGSRSV1>\n"
+            "<BANKMSGSRSV1>\n<STMTTRNRS>\n"
+            "<TRNUID>0</TRNUID>\n"
+            "<STATUS>\n<CODE>0</CODE>\n<SEVERITY>INFO</SEVERITY>\n</STATUS>\n"
+            "<STMTRS>\n");
+    g_free(server_time);
+
+    append_ofx_element(buffer, "CURDEF", currency != NULL ? currency : "EUR", currency != NULL ? strlen(currency) : 3);
+    g_string_append(buffer, "<BANKACCTFROM>\n");
+    append_ofx_element(buffer, "BANKID", blz, strlen(blz));
+    append_ofx_element(buffer, "ACCTID", number, strlen(number));
+    g_string_append(buffer, "<ACCTTYPE>CHECKING</ACCTTYPE>\n</BANKACCTFROM>\n<BANKTRANLIST>\n");
+    if (first != NULL) {
+        append_ofx_date(buffer, "DTSTART", first->booking_date);
+        append_ofx_date(buffer, "DTEND", last->booking_date);
+    }
+}
+
+static void
+write_ofx_transaction (GString* buffer, const GHbciStatementPrivate* priv, guint index)
+{
+    gsize length;
+
+    split_value(priv->value, &length);
+    g_string_append(buffer, "<STMTTRN>\n");
+    g_string_append_printf(buffer, "<TRNTYPE>%s</TRNTYPE>\n",
+            priv->value != NULL && priv->value[0] == '-' ? "DEBIT" : "CREDIT");
+    if (priv->booking_date != 0)
+        append_ofx_date(buffer, "DTPOSTED", priv->booking_date);
+    if (priv->valuta != 0)
+        append_ofx_date(buffer, "DTUSER", priv->valuta);
+    append_ofx_element(buffer, "TRNAMT", priv->value != NULL ? priv->value : "0", priv->value != NULL ? length : 1);
+
+    // unique within the statement, stable for the same list
+    g_string_append(buffer, "<FITID>");
+    if (priv->booking_date != 0)
+        append_date(buffer, priv->booking_date, "%04u%02u%02u");
+    g_string_append_printf(buffer, "-%u</FITID>\n", index);
+
+    if (priv->other_name != NULL) {
+        const gchar* end = priv->other_name;
+        guint chars;
+        for (chars = 0; *end != '\0' && chars < OFX_NAME_LENGTH; chars++)
+            end = g_utf8_next_char(end);
+        append_ofx_element(buffer, "NAME", priv->other_name, end - priv->other_name);
+    }
+    if (priv->reference != NULL && priv->reference[0] != '\0')
+        append_ofx_element(buffer, "MEMO", priv->reference, strlen(priv->reference));
+    g_string_append(buffer, "</STMTTRN>\n");
+}
+
+static void
+write_ofx_footer (GString* buffer, GSList* statements)
+{
+    const GHbciStatementPrivate* balance = NULL;
+    GSList* iter;
+    gsize length;
+
+    for (iter = statements; iter != NULL; iter = iter->next) {
+        const GHbciStatementPrivate* priv = GHBCI_STATEMENT(iter->data)->priv;
+        if (priv->saldo != NULL && priv->booking_date != 0)
+            balance = priv;
+    }
+
+    g_string_append(buffer, "</BANKTRANLIST>\n");
+    // the saldo after the last statement, omitted if the bank sent none
+    if (balance != NULL) {
+        split_value(balance->saldo, &length);
+        g_string_append(buffer, "<LEDGERBAL>\n");
+        append_ofx_element(buffer, "BALAMT", balance->saldo, length);
+        append_ofx_date(buffer, "DTASOF", balance->booking_date);
+        g_string_append(buffer, "</LEDGERBAL>\n");
+    }
+    g_string_append(buffer, "</STMTRS>\n</STMTTRNRS>\n</BANKMSGSRSV1>\n</OFX>\n");
+}
+
+/**
+ * ghbci_export_statements:
+ * @statements: (element-type GHbciStatement): statements, e.g. of
+ *   ghbci_context_get_statements()
+ * @format: the #GHbciExportFormat
+ * @blz: (nullable): blz of the account, required for OFX
+ * @number: (nullable): account number, required for OFX
+ * @stream: the #GOutputStream to write to, it is not closed
+ * @cancellable: (nullable): a #GCancellable
+ * @error: return location for a #GError
+ *
+ * Write @statements to @stream
+ *
+ * Returns: %TRUE if all statements were written
+ **/
+gboolean
+ghbci_export_statements (GSList* statements, GHbciExportFormat format, const gchar* blz, const gchar* number,
+        GOutputStream* stream, GCancellable* cancellable, GError** error)
+{
+    Writer writer;
+    GSList* iter;
+    guint index = 0;
+    gboolean success = TRUE;
+
+    g_return_val_if_fail (G_IS_OUTPUT_STREAM (stream), FALSE);
+    g_return_val_if_fail (format != GHBCI_EXPORT_FORMAT_OFX || (blz != NULL && number != NULL), FALSE);
+
+    writer.stream = stream;
+    writer.cancellable = cancellable;
+    writer.buffer = g_string_sized_new(BUFFER_SIZE + 4096);
+
+    if (format == GHBCI_EXPORT_FORMAT_CSV)
+        g_string_append(writer.buffer, csv_header);
+    else if (format == GHBCI_EXPORT_FORMAT_OFX)
+        write_ofx_header(writer.buffer, statements, blz, number);
+
+    for (iter = statements; success && iter != NULL; iter = iter->next, index++) {
+        const GHbciStatementPrivate* priv = GHBCI_STATEMENT(iter->data)->priv;
+
+        switch (format) {
+        case GHBCI_EXPORT_FORMAT_CSV:
+            write_csv(writer.buffer, priv);
+            break;
+        case GHBCI_EXPORT_FORMAT_JSON_LINES:
+            write_json_line(writer.buffer, priv);
+            break;
+        case GHBCI_EXPORT_FORMAT_OFX:
+            write_ofx_transaction(writer.buffer, priv, index);
+            break;
+        }
+        success = writer_next(&writer, error);
+    }
+
+    if (success && format == GHBCI_EXPORT_FORMAT_OFX)
+        write_ofx_footer(writer.buffer, statements);
+    if (success)
+        success = writer_flush(&writer, error);
+    g_string_free(writer.buffer, TRUE);
+    return success;
+}
+
+/**
+ * ghbci_export_statements_to_fd:
+ * @statements: (element-type GHbciStatement): statements, e.g. of
+ *   ghbci_context_get_statements()
+ * @format: the #GHbciExportFormat
+ * @blz: (nullable): blz of the account, required for OFX
+ * @number: (nullable): account number, required for OFX
+ * @fd: file descriptor to write to, it is not closed
+ * @error: return location for a #GError
+ *
+ * Write @statements to @fd, like ghbci_export_statements()
+ *
+ * Returns: %TRUE if all statements were written
+ **/
+gboolean
+ghbci_export_statements_to_fd (GSList* statements, GHbciExportFormat format, const gchar* blz,
+        const gchar* number, gint fd, GError** error)
+{
+    GOutputStream* stream;
+    gboolean success;
+
+    g_return_val_if_fail (fd >= 0, FALSE);
+
+    stream = g_unix_output_stream_new(fd, FALSE);
+    success = ghbci_export_statements(statements, format, blz, number, stream, NULL, error);
+    g_object_unref(stream);
+    return success;
+}
+
+
+// vim: sw=4 expandtab
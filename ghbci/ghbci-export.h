@@ -0,0 +1,58 @@
+/*
+ * ghbci-export.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_EXPORT_H__
+#define __GHBCI_EXPORT_H__
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GHbciExportFormat:
+ * @GHBCI_EXPORT_FORMAT_CSV: comma separated values as in RFC 4180, with a
+ *   header line
+ * @GHBCI_EXPORT_FORMAT_JSON_LINES: one JSON object per line
+ * @GHBCI_EXPORT_FORMAT_OFX: an OFX 2.2 bank statement
+ *
+ * Formats ghbci_export_statements() writes. For dataframes, use
+ * ghbci_export_statements_arrow() instead.
+ **/
+typedef enum {
+    GHBCI_EXPORT_FORMAT_CSV,
+    GHBCI_EXPORT_FORMAT_JSON_LINES,
+    GHBCI_EXPORT_FORMAT_OFX
+} GHbciExportFormat;
+
+gboolean            ghbci_export_statements                   (GSList* statements, GHbciExportFormat format,
+                                                               const gchar* blz, const gchar* number,
+                                                               GOutputStream* stream, GCancellable* cancellable,
+                                                               GError** error);
+
+gboolean            ghbci_export_statements_to_fd             (GSList* statements, GHbciExportFormat format,
+                                                               const gchar* blz, const gchar* number,
+                                                               gint fd, GError** error);
+
+void                ghbci_export_statements_arrow             (GSList* statements, gpointer out_array,
+                                                               gpointer out_schema);
+
+G_END_DECLS
+
+#endif /* __GHBCI_EXPORT_H__ */
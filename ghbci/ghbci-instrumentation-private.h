@@ -0,0 +1,61 @@
+/*
+ * ghbci-instrumentation-private.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_INSTRUMENTATION_PRIVATE_H__
+#define __GHBCI_INSTRUMENTATION_PRIVATE_H__
+
+#include <glib.h>
+#include <jni.h>
+
+#include "ghbci-instrumentation.h"
+#include "ghbci-context.h"
+
+#ifdef GHBCI_ENABLE_INSTRUMENTATION
+
+typedef struct
+{
+    GHbciContext* context;
+    const gchar* function;
+    GHbciCallCounters counters;
+    gboolean outermost;
+} GHbciInstrumentationScope;
+
+gboolean          ghbci_instrumentation_install               (JNIEnv* jni_env);
+
+void              ghbci_instrumentation_begin                 (GHbciInstrumentationScope* scope, GHbciContext* context,
+                                                               const gchar* function);
+
+void              ghbci_instrumentation_end                   (GHbciInstrumentationScope* scope);
+
+GHbciCallCounters* ghbci_instrumentation_swap_counters        (GHbciCallCounters* counters);
+
+/*
+ * Count the costs of the enclosing public function until it returns,
+ * nested instrumented calls add to the outermost one
+ */
+#define GHBCI_INSTRUMENT(context, function) \
+    GHbciInstrumentationScope ghbci_instrumentation_scope __attribute__((cleanup(ghbci_instrumentation_end))); \
+    ghbci_instrumentation_begin (&ghbci_instrumentation_scope, (context), (function))
+
+#else
+
+#define GHBCI_INSTRUMENT(context, function)
+
+#endif /* GHBCI_ENABLE_INSTRUMENTATION */
+
+#endif /* __GHBCI_INSTRUMENTATION_PRIVATE_H__ */
@@ -0,0 +1,412 @@
+/*
+ * ghbci-instrumentation.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/**
+ * SECTION:ghbci-instrumentation
+ * @short_description: JNI and allocation counters per public function
+ *
+ * Built with the meson option instrumentation, #GHbciContext counts for
+ * every public function the JNI functions called, the local references
+ * created, the bytes of converted strings and the memory allocations.
+ * Read the totals with ghbci_context_get_call_counters(), or listen to
+ * the #GHbciContext::status signal for %GHBCI_STATUSTAG_ENUM_API_CALL_DONE.
+ * Without the option the counting code is not compiled in.
+ **/
+
+#include <string.h>
+
+#include "ghbci-instrumentation.h"
+#include "ghbci-instrumentation-private.h"
+
+G_DEFINE_BOXED_TYPE (GHbciCallCounters, ghbci_call_counters, ghbci_call_counters_copy, ghbci_call_counters_free)
+
+
+/**
+ * ghbci_call_counters_copy:
+ * @self: The #GHbciCallCounters
+ *
+ * Create a copy
+ *
+ * Returns: (transfer full): copy of @self
+ **/
+GHbciCallCounters*
+ghbci_call_counters_copy (GHbciCallCounters* self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    return g_memdup2(self, sizeof(GHbciCallCounters));
+}
+
+/**
+ * ghbci_call_counters_free:
+ * @self: The #GHbciCallCounters
+ *
+ * Free counters
+ **/
+void
+ghbci_call_counters_free (GHbciCallCounters* self)
+{
+    g_free(self);
+}
+
+#ifdef GHBCI_ENABLE_INSTRUMENTATION
+
+#include <jvmti.h>
+
+#include "ghbci-context-private.h"
+
+/*
+ * Counters of the outermost instrumented call running in this thread.
+ * Initial exec model, the allocation hooks must not allocate to find it.
+ */
+static __thread GHbciCallCounters* current __attribute__((tls_model("initial-exec"))) = NULL;
+
+/*
+ * Allocation counting
+ *
+ * The instrumented library interposes the allocator of glibc. hbci4java
+ * and the jvm allocate on the calling thread too, they are counted with
+ * the GLib allocations.
+ */
+
+#ifdef __GLIBC__
+extern void* __libc_malloc (size_t size);
+extern void* __libc_calloc (size_t nmemb, size_t size);
+extern void* __libc_realloc (void* ptr, size_t size);
+
+void*
+malloc (size_t size)
+{
+    if (current != NULL)
+        current->allocations++;
+    return __libc_malloc(size);
+}
+
+void*
+calloc (size_t nmemb, size_t size)
+{
+    if (current != NULL)
+        current->allocations++;
+    return __libc_calloc(nmemb, size);
+}
+
+void*
+realloc (void* ptr, size_t size)
+{
+    if (current != NULL)
+        current->allocations++;
+    return __libc_realloc(ptr, size);
+}
+#endif
+
+/*
+ * JNI counting
+ *
+ * The JNI function table is replaced through JVMTI by a copy whose entries
+ * count and forward to the original functions. The copy keeps reserved3,
+ * so callbacks still find the context.
+ */
+
+static struct JNINativeInterface_ original;
+static struct JNINativeInterface_ counting;
+
+#define COUNT_CALL() \
+    if (current != NULL) current->jni_calls++
+
+#define COUNT_LOCAL_REF(ref) \
+    if (current != NULL && (ref) != NULL) current->local_refs++
+
+#define COUNT_STRING_BYTES(bytes) \
+    if (current != NULL) current->string_bytes += (bytes)
+
+// functions returning a local reference
+#define COUNTING_REF_FUNCTION(ret, name, params, args) \
+    static ret counting_##name params \
+    { \
+        ret result; \
+        COUNT_CALL(); \
+        result = original.name args; \
+        COUNT_LOCAL_REF(result); \
+        return result; \
+    }
+
+#define COUNTING_FUNCTION(ret, name, params, args) \
+    static ret counting_##name params \
+    { \
+        COUNT_CALL(); \
+        return original.name args; \
+    }
+
+#define COUNTING_VOID_FUNCTION(name, params, args) \
+    static void counting_##name params \
+    { \
+        COUNT_CALL(); \
+        original.name args; \
+    }
+
+// variadic Call<Type>Method functions forward to their va_list variant
+#define COUNTING_CALL_METHOD(ret, name, target_type, count) \
+    static ret counting_##name (JNIEnv* env, target_type target, jmethodID method, ...) \
+    { \
+        va_list args; \
+        ret result; \
+        COUNT_CALL(); \
+        va_start(args, method); \
+        result = original.name##V(env, target, method, args); \
+        va_end(args); \
+        count; \
+        return result; \
+    }
+
+#define COUNTING_CALL_VOID_METHOD(name, target_type) \
+    static void counting_##name (JNIEnv* env, target_type target, jmethodID method, ...) \
+    { \
+        va_list args; \
+        COUNT_CALL(); \
+        va_start(args, method); \
+        original.name##V(env, target, method, args); \
+        va_end(args); \
+    }
+
+COUNTING_REF_FUNCTION(jclass, FindClass, (JNIEnv* env, const char* name), (env, name))
+COUNTING_REF_FUNCTION(jobject, GetObjectField, (JNIEnv* env, jobject obj, jfieldID field), (env, obj, field))
+COUNTING_REF_FUNCTION(jobject, GetStaticObjectField, (JNIEnv* env, jclass clazz, jfieldID field), (env, clazz, field))
+COUNTING_REF_FUNCTION(jobject, GetObjectArrayElement, (JNIEnv* env, jobjectArray array, jsize index), (env, array, index))
+COUNTING_REF_FUNCTION(jobject, NewLocalRef, (JNIEnv* env, jobject obj), (env, obj))
+COUNTING_REF_FUNCTION(jthrowable, ExceptionOccurred, (JNIEnv* env), (env))
+COUNTING_REF_FUNCTION(jobjectArray, NewObjectArray, (JNIEnv* env, jsize length, jclass clazz, jobject init),
+        (env, length, clazz, init))
+COUNTING_REF_FUNCTION(jbyteArray, NewByteArray, (JNIEnv* env, jsize length), (env, length))
+COUNTING_REF_FUNCTION(jcharArray, NewCharArray, (JNIEnv* env, jsize length), (env, length))
+COUNTING_REF_FUNCTION(jintArray, NewIntArray, (JNIEnv* env, jsize length), (env, length))
+COUNTING_FUNCTION(jobject, NewGlobalRef, (JNIEnv* env, jobject obj), (env, obj))
+COUNTING_VOID_FUNCTION(DeleteGlobalRef, (JNIEnv* env, jobject obj), (env, obj))
+COUNTING_VOID_FUNCTION(DeleteLocalRef, (JNIEnv* env, jobject obj), (env, obj))
+COUNTING_VOID_FUNCTION(SetObjectField, (JNIEnv* env, jobject obj, jfieldID field, jobject value), (env, obj, field, value))
+COUNTING_VOID_FUNCTION(SetObjectArrayElement, (JNIEnv* env, jobjectArray array, jsize index, jobject value),
+        (env, array, index, value))
+COUNTING_VOID_FUNCTION(SetByteArrayRegion, (JNIEnv* env, jbyteArray array, jsize start, jsize len, const jbyte* buf),
+        (env, array, start, len, buf))
+COUNTING_VOID_FUNCTION(SetIntArrayRegion, (JNIEnv* env, jintArray array, jsize start, jsize len, const jint* buf),
+        (env, array, start, len, buf))
+COUNTING_VOID_FUNCTION(GetCharArrayRegion, (JNIEnv* env, jcharArray array, jsize start, jsize len, jchar* buf),
+        (env, array, start, len, buf))
+COUNTING_FUNCTION(jint, EnsureLocalCapacity, (JNIEnv* env, jint capacity), (env, capacity))
+COUNTING_FUNCTION(jmethodID, GetMethodID, (JNIEnv* env, jclass clazz, const char* name, const char* sig),
+        (env, clazz, name, sig))
+COUNTING_FUNCTION(jmethodID, GetStaticMethodID, (JNIEnv* env, jclass clazz, const char* name, const char* sig),
+        (env, clazz, name, sig))
+COUNTING_FUNCTION(jfieldID, GetFieldID, (JNIEnv* env, jclass clazz, const char* name, const char* sig),
+        (env, clazz, name, sig))
+COUNTING_FUNCTION(jfieldID, GetStaticFieldID, (JNIEnv* env, jclass clazz, const char* name, const char* sig),
+        (env, clazz, name, sig))
+COUNTING_FUNCTION(jint, RegisterNatives, (JNIEnv* env, jclass clazz, const JNINativeMethod* methods, jint n_methods),
+        (env, clazz, methods, n_methods))
+COUNTING_FUNCTION(jint, GetJavaVM, (JNIEnv* env, JavaVM** vm), (env, vm))
+COUNTING_FUNCTION(jboolean, IsInstanceOf, (JNIEnv* env, jobject obj, jclass clazz), (env, obj, clazz))
+COUNTING_FUNCTION(jsize, GetArrayLength, (JNIEnv* env, jarray array), (env, array))
+COUNTING_FUNCTION(jsize, GetStringLength, (JNIEnv* env, jstring str), (env, str))
+COUNTING_FUNCTION(jsize, GetStringUTFLength, (JNIEnv* env, jstring str), (env, str))
+COUNTING_FUNCTION(jboolean, ExceptionCheck, (JNIEnv* env), (env))
+COUNTING_VOID_FUNCTION(ExceptionClear, (JNIEnv* env), (env))
+COUNTING_VOID_FUNCTION(ExceptionDescribe, (JNIEnv* env), (env))
+COUNTING_FUNCTION(jint, ThrowNew, (JNIEnv* env, jclass clazz, const char* msg), (env, clazz, msg))
+COUNTING_CALL_METHOD(jobject, CallObjectMethod, jobject, COUNT_LOCAL_REF(result))
+COUNTING_CALL_METHOD(jboolean, CallBooleanMethod, jobject, )
+COUNTING_CALL_METHOD(jint, CallIntMethod, jobject, )
+COUNTING_CALL_METHOD(jlong, CallLongMethod, jobject, )
+COUNTING_CALL_METHOD(jobject, CallStaticObjectMethod, jclass, COUNT_LOCAL_REF(result))
+COUNTING_CALL_METHOD(jobject, NewObject, jclass, COUNT_LOCAL_REF(result))
+COUNTING_CALL_VOID_METHOD(CallVoidMethod, jobject)
+COUNTING_CALL_VOID_METHOD(CallStaticVoidMethod, jclass)
+
+static jstring
+counting_NewStringUTF (JNIEnv* env, const char* chars)
+{
+    jstring result;
+
+    COUNT_CALL();
+    result = original.NewStringUTF(env, chars);
+    COUNT_LOCAL_REF(result);
+    if (chars != NULL)
+        COUNT_STRING_BYTES(strlen(chars));
+    return result;
+}
+
+static const char*
+counting_GetStringUTFChars (JNIEnv* env, jstring str, jboolean* is_copy)
+{
+    const char* result;
+
+    COUNT_CALL();
+    result = original.GetStringUTFChars(env, str, is_copy);
+    if (result != NULL)
+        COUNT_STRING_BYTES(strlen(result));
+    return result;
+}
+
+COUNTING_VOID_FUNCTION(ReleaseStringUTFChars, (JNIEnv* env, jstring str, const char* chars), (env, str, chars))
+
+static void
+counting_GetStringUTFRegion (JNIEnv* env, jstring str, jsize start, jsize len, char* buf)
+{
+    COUNT_CALL();
+    original.GetStringUTFRegion(env, str, start, len, buf);
+    // len counts characters, good enough for the mostly ascii strings of hbci
+    COUNT_STRING_BYTES(len);
+}
+
+static void
+counting_GetStringRegion (JNIEnv* env, jstring str, jsize start, jsize len, jchar* buf)
+{
+    COUNT_CALL();
+    original.GetStringRegion(env, str, start, len, buf);
+    COUNT_STRING_BYTES(len);
+}
+
+/*
+ * Replace the JNI function table, only the first call does anything
+ */
+gboolean
+ghbci_instrumentation_install (JNIEnv* jni_env)
+{
+    static gsize installed = 0;
+    static gboolean result = FALSE;
+    JavaVM* jvm;
+    jvmtiEnv* jvmti;
+    jniNativeInterface* table;
+
+    if (!g_once_init_enter(&installed))
+        return result;
+
+    if ((*jni_env)->GetJavaVM(jni_env, &jvm) != JNI_OK
+            || (*jvm)->GetEnv(jvm, (void**)&jvmti, JVMTI_VERSION_1_0) != JNI_OK
+            || (*jvmti)->GetJNIFunctionTable(jvmti, &table) != JVMTI_ERROR_NONE) {
+        g_warning("instrumentation: jvmti not available, JNI calls are not counted");
+        g_once_init_leave(&installed, 1);
+        return result;
+    }
+
+    original = *table;
+    counting = *table;
+    (*jvmti)->Deallocate(jvmti, (unsigned char*)table);
+
+#define COUNT(name) counting.name = counting_##name;
+    COUNT(FindClass)
+    COUNT(GetObjectField)
+    COUNT(GetStaticObjectField)
+    COUNT(GetObjectArrayElement)
+    COUNT(NewLocalRef)
+    COUNT(ExceptionOccurred)
+    COUNT(NewObjectArray)
+    COUNT(NewByteArray)
+    COUNT(NewCharArray)
+    COUNT(NewIntArray)
+    COUNT(NewGlobalRef)
+    COUNT(DeleteGlobalRef)
+    COUNT(DeleteLocalRef)
+    COUNT(SetObjectField)
+    COUNT(SetObjectArrayElement)
+    COUNT(SetByteArrayRegion)
+    COUNT(SetIntArrayRegion)
+    COUNT(GetCharArrayRegion)
+    COUNT(EnsureLocalCapacity)
+    COUNT(GetMethodID)
+    COUNT(GetStaticMethodID)
+    COUNT(GetFieldID)
+    COUNT(GetStaticFieldID)
+    COUNT(RegisterNatives)
+    COUNT(GetJavaVM)
+    COUNT(IsInstanceOf)
+    COUNT(GetArrayLength)
+    COUNT(GetStringLength)
+    COUNT(GetStringUTFLength)
+    COUNT(ExceptionCheck)
+    COUNT(ExceptionClear)
+    COUNT(ExceptionDescribe)
+    COUNT(ThrowNew)
+    COUNT(CallObjectMethod)
+    COUNT(CallBooleanMethod)
+    COUNT(CallIntMethod)
+    COUNT(CallLongMethod)
+    COUNT(CallStaticObjectMethod)
+    COUNT(NewObject)
+    COUNT(CallVoidMethod)
+    COUNT(CallStaticVoidMethod)
+    COUNT(NewStringUTF)
+    COUNT(GetStringUTFChars)
+    COUNT(ReleaseStringUTFChars)
+    COUNT(GetStringUTFRegion)
+    COUNT(GetStringRegion)
+#undef COUNT
+
+    result = (*jvmti)->SetJNIFunctionTable(jvmti, &counting) == JVMTI_ERROR_NONE;
+    if (!result)
+        g_warning("instrumentation: replacing JNI function table failed");
+
+    g_once_init_leave(&installed, 1);
+    return result;
+}
+
+/*
+ * Start counting for @function, unless an instrumented call is already
+ * running in this thread
+ */
+void
+ghbci_instrumentation_begin (GHbciInstrumentationScope* scope, GHbciContext* context, const gchar* function)
+{
+    scope->context = context;
+    scope->function = function;
+    memset(&scope->counters, 0, sizeof(GHbciCallCounters));
+    scope->counters.calls = 1;
+    scope->outermost = current == NULL;
+    if (scope->outermost)
+        current = &scope->counters;
+}
+
+/*
+ * Stop counting and hand the counters to the context
+ */
+void
+ghbci_instrumentation_end (GHbciInstrumentationScope* scope)
+{
+    if (!scope->outermost)
+        return;
+
+    current = NULL;
+    ghbci_context_record_call_counters(scope->context, scope->function, &scope->counters);
+}
+
+/*
+ * Count the calls of this thread into counters, or nothing if NULL,
+ * instead of per public function. For benchmarks of the code below the
+ * public functions. Returns the counters counted into before.
+ */
+GHbciCallCounters*
+ghbci_instrumentation_swap_counters (GHbciCallCounters* counters)
+{
+    GHbciCallCounters* previous = current;
+
+    current = counters;
+    return previous;
+}
+
+#endif /* GHBCI_ENABLE_INSTRUMENTATION */
+
+
+// vim: sw=4 expandtab
@@ -0,0 +1,60 @@
+/*
+ * ghbci-instrumentation.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_INSTRUMENTATION_H__
+#define __GHBCI_INSTRUMENTATION_H__
+
+#include <glib.h>
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GHbciCallCounters GHbciCallCounters;
+
+/**
+ * GHbciCallCounters:
+ * @calls: number of calls of the public function
+ * @jni_calls: JNI functions called
+ * @local_refs: JNI local references created
+ * @string_bytes: bytes converted between C and java strings
+ * @allocations: malloc(), calloc() and realloc() calls
+ *
+ * Costs of calls of a public function, counted on the calling thread
+ * while the call runs. Only available if ghbci was built with
+ * instrumentation enabled.
+ **/
+struct _GHbciCallCounters
+{
+    guint64 calls;
+    guint64 jni_calls;
+    guint64 local_refs;
+    guint64 string_bytes;
+    guint64 allocations;
+};
+
+#define GHBCI_TYPE_CALL_COUNTERS       (ghbci_call_counters_get_type ())
+
+GType               ghbci_call_counters_get_type              (void) G_GNUC_CONST;
+
+GHbciCallCounters*  ghbci_call_counters_copy                  (GHbciCallCounters* self);
+
+void                ghbci_call_counters_free                  (GHbciCallCounters* self);
+
+G_END_DECLS
+
+#endif /* __GHBCI_INSTRUMENTATION_H__ */
@@ -0,0 +1,80 @@
+/*
+ * ghbci-java-strings.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_JAVA_STRINGS_H__
+#define __GHBCI_JAVA_STRINGS_H__
+
+/*
+ * Constant strings passed to hbci4java: job names, job parameter names and
+ * global parameters. The context creates each one once as global reference
+ * in ghbci_context_new(), so jobs don't convert them again on every call.
+ *
+ * GHBCI_JAVA_STRING(id, text) is expanded for every entry.
+ */
+#define GHBCI_JAVA_STRINGS \
+    /* jobs */ \
+    GHBCI_JAVA_STRING(JOB_SALDO_REQ,            "SaldoReq") \
+    GHBCI_JAVA_STRING(JOB_KUMS_ALL,             "KUmsAll") \
+    GHBCI_JAVA_STRING(JOB_UEB_SEPA,             "UebSEPA") \
+    GHBCI_JAVA_STRING(JOB_MULTI_UEB_SEPA,       "MultiUebSEPA") \
+    GHBCI_JAVA_STRING(JOB_TERM_UEB_SEPA,        "TermUebSEPA") \
+    GHBCI_JAVA_STRING(JOB_DAUER_SEPA_NEW,       "DauerSEPANew") \
+    GHBCI_JAVA_STRING(JOB_DAUER_SEPA_LIST,      "DauerSEPAList") \
+    /* job parameters */ \
+    GHBCI_JAVA_STRING(MY_COUNTRY,               "my.country") \
+    GHBCI_JAVA_STRING(MY_BLZ,                   "my.blz") \
+    GHBCI_JAVA_STRING(MY_NUMBER,                "my.number") \
+    GHBCI_JAVA_STRING(SRC_COUNTRY,              "src.country") \
+    GHBCI_JAVA_STRING(SRC_BLZ,                  "src.blz") \
+    GHBCI_JAVA_STRING(SRC_NUMBER,               "src.number") \
+    GHBCI_JAVA_STRING(SRC_NAME,                 "src.name") \
+    GHBCI_JAVA_STRING(SRC_IBAN,                 "src.iban") \
+    GHBCI_JAVA_STRING(SRC_BIC,                  "src.bic") \
+    GHBCI_JAVA_STRING(DST_NAME,                 "dst.name") \
+    GHBCI_JAVA_STRING(DST_IBAN,                 "dst.iban") \
+    GHBCI_JAVA_STRING(DST_BIC,                  "dst.bic") \
+    GHBCI_JAVA_STRING(BTG_VALUE,                "btg.value") \
+    GHBCI_JAVA_STRING(BTG_CURR,                 "btg.curr") \
+    GHBCI_JAVA_STRING(USAGE,                    "usage") \
+    GHBCI_JAVA_STRING(END_TO_END_ID,            "endtoendid") \
+    GHBCI_JAVA_STRING(SEPA_ID,                  "sepaid") \
+    GHBCI_JAVA_STRING(PMTINF_ID,                "pmtinfid") \
+    GHBCI_JAVA_STRING(DATE,                     "date") \
+    GHBCI_JAVA_STRING(FIRST_DATE,               "firstdate") \
+    GHBCI_JAVA_STRING(LAST_DATE,                "lastdate") \
+    GHBCI_JAVA_STRING(TIME_UNIT,                "timeunit") \
+    GHBCI_JAVA_STRING(TURNUS,                   "turnus") \
+    GHBCI_JAVA_STRING(EXEC_DAY,                 "execday") \
+    /* global parameters and their values */ \
+    GHBCI_JAVA_STRING(LOG_LEVEL,                "log.loglevel.default") \
+    GHBCI_JAVA_STRING(PINTAN_FILENAME,          "client.passport.PinTan.filename") \
+    GHBCI_JAVA_STRING(PINTAN_CHECKCERT,         "client.passport.PinTan.checkcert") \
+    GHBCI_JAVA_STRING(PINTAN_INIT,              "client.passport.PinTan.init") \
+    GHBCI_JAVA_STRING(PINTAN,                   "PinTan") \
+    GHBCI_JAVA_STRING(HBCI_VERSION,             "300") \
+    GHBCI_JAVA_STRING(ONE,                      "1") \
+    GHBCI_JAVA_STRING(NAME,                     "name")
+
+typedef enum {
+#define GHBCI_JAVA_STRING(id, text) GHBCI_JAVA_STRING_##id,
+    GHBCI_JAVA_STRINGS
+#undef GHBCI_JAVA_STRING
+    GHBCI_JAVA_STRING_LAST
+} GHbciJavaString;
+
+#endif /* __GHBCI_JAVA_STRINGS_H__ */
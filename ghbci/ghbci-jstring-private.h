@@ -0,0 +1,60 @@
+/*
+ * ghbci-jstring-private.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_JSTRING_PRIVATE_H__
+#define __GHBCI_JSTRING_PRIVATE_H__
+
+#include <glib.h>
+#include <jni.h>
+
+/* size of the blocks of an arena, larger strings get a block of their own */
+#define GHBCI_JSTRING_ARENA_BLOCK_SIZE      1024
+
+/* chars copied at once by ghbci_jstring_copy_prefix(), on the stack */
+#define GHBCI_JSTRING_PREFIX_CHUNK          512
+
+/*
+ * Bump allocator for java strings only needed while a row is converted,
+ * lives on the stack of the caller
+ */
+typedef struct
+{
+    gchar* block;
+    gsize size;
+    gsize used;
+    /* blocks filled before block */
+    GSList* full;
+} GHbciJStringArena;
+
+void              ghbci_jstring_arena_init                    (GHbciJStringArena* self);
+
+void              ghbci_jstring_arena_reset                   (GHbciJStringArena* self);
+
+void              ghbci_jstring_arena_clear                   (GHbciJStringArena* self);
+
+const gchar*      ghbci_jstring_arena_copy                    (GHbciJStringArena* self, JNIEnv* jni_env,
+                                                               jstring jstr);
+
+gchar*            ghbci_jstring_dup                           (JNIEnv* jni_env, jstring jstr);
+
+gsize             ghbci_jstring_append                        (GString* string, JNIEnv* jni_env, jstring jstr);
+
+gsize             ghbci_jstring_copy_prefix                   (JNIEnv* jni_env, jstring jstr, gchar* dest,
+                                                               gsize size);
+
+#endif /* __GHBCI_JSTRING_PRIVATE_H__ */
@@ -0,0 +1,205 @@
+/*
+ * ghbci-jstring.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/*
+ * Copies java strings out of the jvm. GetStringUTFChars() hands out a copy
+ * the jvm allocated, which then had to be copied again to outlive the
+ * release; here the (modified) utf-8 length is asked first and the string
+ * is copied with GetStringUTFRegion() once, right to its destination: a
+ * string of its own, the end of a GString or an arena that is reset after
+ * each row and freed in bulk. Strings cut to a fixed size are read as utf-16
+ * instead, only as far as they fit, and encoded here.
+ */
+
+#include <string.h>
+
+#include "ghbci-jstring-private.h"
+
+
+void
+ghbci_jstring_arena_init (GHbciJStringArena* self)
+{
+    self->block = NULL;
+    self->size = 0;
+    self->used = 0;
+    self->full = NULL;
+}
+
+/*
+ * Forget the strings of the arena, keeps the current block for the next row
+ */
+void
+ghbci_jstring_arena_reset (GHbciJStringArena* self)
+{
+    g_slist_free_full(self->full, g_free);
+    self->full = NULL;
+    self->used = 0;
+}
+
+void
+ghbci_jstring_arena_clear (GHbciJStringArena* self)
+{
+    ghbci_jstring_arena_reset(self);
+    g_clear_pointer(&self->block, g_free);
+    self->size = 0;
+}
+
+static gchar*
+arena_alloc (GHbciJStringArena* self, gsize size)
+{
+    gchar* result;
+
+    if (self->used + size <= self->size) {
+        result = self->block + self->used;
+        self->used += size;
+        return result;
+    }
+
+    // don't give up the rest of the current block for a string this large
+    if (size > GHBCI_JSTRING_ARENA_BLOCK_SIZE / 2) {
+        result = g_malloc(size);
+        self->full = g_slist_prepend(self->full, result);
+        return result;
+    }
+
+    if (self->block != NULL)
+        self->full = g_slist_prepend(self->full, self->block);
+    self->block = g_malloc(GHBCI_JSTRING_ARENA_BLOCK_SIZE);
+    self->size = GHBCI_JSTRING_ARENA_BLOCK_SIZE;
+    self->used = size;
+    return self->block;
+}
+
+/*
+ * Copies jstr to dest, which has room for utf_length + 1 bytes
+ */
+static void
+copy_region (JNIEnv* jni_env, jstring jstr, jsize length, gsize utf_length, gchar* dest)
+{
+    if (length > 0)
+        (*jni_env)->GetStringUTFRegion(jni_env, jstr, 0, length, dest);
+    dest[utf_length] = '\0';
+}
+
+/*
+ * Copy of jstr valid until the next reset of self, NULL if jstr is
+ */
+const gchar*
+ghbci_jstring_arena_copy (GHbciJStringArena* self, JNIEnv* jni_env, jstring jstr)
+{
+    jsize length;
+    gsize utf_length;
+    gchar* result;
+
+    if (jstr == NULL)
+        return NULL;
+
+    length = (*jni_env)->GetStringLength(jni_env, jstr);
+    utf_length = (*jni_env)->GetStringUTFLength(jni_env, jstr);
+    result = arena_alloc(self, utf_length + 1);
+    copy_region(jni_env, jstr, length, utf_length, result);
+    return result;
+}
+
+/*
+ * Newly allocated copy of jstr, NULL if jstr is
+ */
+gchar*
+ghbci_jstring_dup (JNIEnv* jni_env, jstring jstr)
+{
+    jsize length;
+    gsize utf_length;
+    gchar* result;
+
+    if (jstr == NULL)
+        return NULL;
+
+    length = (*jni_env)->GetStringLength(jni_env, jstr);
+    utf_length = (*jni_env)->GetStringUTFLength(jni_env, jstr);
+    result = g_malloc(utf_length + 1);
+    copy_region(jni_env, jstr, length, utf_length, result);
+    return result;
+}
+
+/*
+ * Appends jstr to string, returns the number of bytes appended
+ */
+gsize
+ghbci_jstring_append (GString* string, JNIEnv* jni_env, jstring jstr)
+{
+    jsize length;
+    gsize utf_length;
+    gsize offset = string->len;
+
+    if (jstr == NULL)
+        return 0;
+
+    length = (*jni_env)->GetStringLength(jni_env, jstr);
+    utf_length = (*jni_env)->GetStringUTFLength(jni_env, jstr);
+    g_string_set_size(string, offset + utf_length);
+    copy_region(jni_env, jstr, length, utf_length, string->str + offset);
+    return utf_length;
+}
+
+/*
+ * Copies as much of jstr as fits into dest of size bytes, cut before the
+ * first character not fitting completely, and terminates it. Every char
+ * takes a byte at least, so no more than size - 1 of them are read.
+ * Returns the number of bytes copied.
+ */
+gsize
+ghbci_jstring_copy_prefix (JNIEnv* jni_env, jstring jstr, gchar* dest, gsize size)
+{
+    jchar chars[GHBCI_JSTRING_PREFIX_CHUNK];
+    gchar utf8[6];
+    jsize length, start, n, i;
+    gsize used = 0;
+    gunichar c;
+    gint bytes;
+
+    g_return_val_if_fail (dest != NULL && size > 0, 0);
+
+    length = jstr != NULL ? (*jni_env)->GetStringLength(jni_env, jstr) : 0;
+    for (start = 0; start < length && used < size - 1; start += n) {
+        n = MIN(length - start, (jsize)MIN(GHBCI_JSTRING_PREFIX_CHUNK, size - 1 - used));
+        (*jni_env)->GetStringRegion(jni_env, jstr, start, n, chars);
+        // a surrogate pair split by the chunk is read with the next one
+        if (n > 1 && start + n < length && chars[n - 1] >= 0xd800 && chars[n - 1] < 0xdc00)
+            n--;
+
+        for (i = 0; i < n; i++) {
+            c = chars[i];
+            if (c >= 0xd800 && c < 0xdc00 && i + 1 < n && chars[i + 1] >= 0xdc00 && chars[i + 1] < 0xe000) {
+                c = 0x10000 + ((c - 0xd800) << 10) + (chars[i + 1] - 0xdc00);
+                i++;
+            } else if (c == 0 || (c >= 0xd800 && c < 0xe000)) {
+                c = 0xfffd;
+            }
+            bytes = g_unichar_to_utf8(c, utf8);
+            if (used + bytes > size - 1)
+                goto done;
+            memcpy(dest + used, utf8, bytes);
+            used += bytes;
+        }
+    }
+done:
+    dest[used] = '\0';
+    return used;
+}
+
+// vim: sw=4 expandtab
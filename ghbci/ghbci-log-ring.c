@@ -0,0 +1,280 @@
+/*
+ * ghbci-log-ring.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/*
+ * Bounded ring of fixed size log records
+ *
+ * Any number of threads append records without locking or allocating:
+ * a producer claims a slot with ghbci_log_ring_reserve(), fills the record
+ * in place and publishes it with ghbci_log_ring_commit(). Every slot carries
+ * a sequence number telling whether it is free, being written or ready to
+ * be consumed. When the ring is full, records are dropped and counted
+ * instead of blocking the producer.
+ *
+ * A single drain thread started with ghbci_log_ring_start() consumes the
+ * records in order and hands them to a callback. It sleeps while the ring
+ * is empty, producers only take its lock to wake it up.
+ */
+
+#include <string.h>
+
+#include "ghbci-log-ring.h"
+
+typedef struct
+{
+    guint64 sequence;
+    GHbciLogRecord record;
+} RingSlot;
+
+struct _GHbciLogRing
+{
+    RingSlot* slots;
+    guint64 mask;
+
+    guint64 enqueue_pos;
+    guint64 dequeue_pos;
+    /* records handed to func, behind dequeue_pos while func runs */
+    guint64 delivered_pos;
+    guint64 dropped;
+
+    GThread* thread;
+    GMutex lock;
+    GCond cond;
+    gint sleeping;
+    gboolean stop;
+    GHbciLogRingFunc func;
+    gpointer user_data;
+};
+
+
+/*
+ * Create ring with room for capacity records, rounded up to a power of two
+ */
+GHbciLogRing*
+ghbci_log_ring_new (guint capacity)
+{
+    GHbciLogRing* self = g_new0(GHbciLogRing, 1);
+    guint64 size = 1;
+    guint64 i;
+
+    while (size < MAX(capacity, 2))
+        size <<= 1;
+
+    self->slots = g_new0(RingSlot, size);
+    self->mask = size - 1;
+    for (i = 0; i < size; i++) {
+        self->slots[i].sequence = i;
+    }
+
+    g_mutex_init(&self->lock);
+    g_cond_init(&self->cond);
+
+    return self;
+}
+
+void
+ghbci_log_ring_free (GHbciLogRing* self)
+{
+    if (self == NULL)
+        return;
+
+    ghbci_log_ring_stop(self);
+    g_cond_clear(&self->cond);
+    g_mutex_clear(&self->lock);
+    g_free(self->slots);
+    g_free(self);
+}
+
+/*
+ * Claim the next free slot, returns NULL if the ring is full
+ */
+GHbciLogRecord*
+ghbci_log_ring_reserve (GHbciLogRing* self, guint64* ticket)
+{
+    guint64 pos = __atomic_load_n(&self->enqueue_pos, __ATOMIC_RELAXED);
+
+    for (;;) {
+        RingSlot* slot = &self->slots[pos & self->mask];
+        guint64 sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        gint64 diff = (gint64)(sequence - pos);
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&self->enqueue_pos, &pos, pos + 1, TRUE,
+                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *ticket = pos;
+                return &slot->record;
+            }
+            // pos was updated by the failed exchange
+        } else if (diff < 0) {
+            __atomic_fetch_add(&self->dropped, 1, __ATOMIC_RELAXED);
+            return NULL;
+        } else {
+            pos = __atomic_load_n(&self->enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/*
+ * Publish a record filled after ghbci_log_ring_reserve()
+ */
+void
+ghbci_log_ring_commit (GHbciLogRing* self, guint64 ticket)
+{
+    RingSlot* slot = &self->slots[ticket & self->mask];
+
+    __atomic_store_n(&slot->sequence, ticket + 1, __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&self->sleeping, __ATOMIC_SEQ_CST)) {
+        g_mutex_lock(&self->lock);
+        g_cond_broadcast(&self->cond);
+        g_mutex_unlock(&self->lock);
+    }
+}
+
+static gboolean
+log_ring_is_empty (GHbciLogRing* self)
+{
+    guint64 pos = __atomic_load_n(&self->dequeue_pos, __ATOMIC_RELAXED);
+    RingSlot* slot = &self->slots[pos & self->mask];
+
+    return __atomic_load_n(&slot->sequence, __ATOMIC_SEQ_CST) != pos + 1;
+}
+
+/*
+ * Take the oldest record, must only be called by one thread at a time
+ */
+gboolean
+ghbci_log_ring_pop (GHbciLogRing* self, GHbciLogRecord* record)
+{
+    guint64 pos = __atomic_load_n(&self->dequeue_pos, __ATOMIC_RELAXED);
+    RingSlot* slot = &self->slots[pos & self->mask];
+
+    if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != pos + 1)
+        return FALSE;
+
+    memcpy(record, &slot->record, sizeof(GHbciLogRecord));
+    __atomic_store_n(&slot->sequence, pos + self->mask + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&self->dequeue_pos, pos + 1, __ATOMIC_RELEASE);
+
+    return TRUE;
+}
+
+guint64
+ghbci_log_ring_get_dropped (GHbciLogRing* self)
+{
+    return __atomic_load_n(&self->dropped, __ATOMIC_RELAXED);
+}
+
+static void
+log_ring_drain (GHbciLogRing* self)
+{
+    GHbciLogRecord record;
+
+    while (ghbci_log_ring_pop(self, &record)) {
+        self->func(&record, self->user_data);
+        __atomic_fetch_add(&self->delivered_pos, 1, __ATOMIC_RELEASE);
+    }
+}
+
+static gpointer
+log_ring_thread (gpointer data)
+{
+    GHbciLogRing* self = data;
+
+    g_mutex_lock(&self->lock);
+    while (!self->stop) {
+        g_mutex_unlock(&self->lock);
+        log_ring_drain(self);
+        g_mutex_lock(&self->lock);
+
+        // wake up ghbci_log_ring_flush()
+        g_cond_broadcast(&self->cond);
+        if (self->stop)
+            break;
+
+        __atomic_store_n(&self->sleeping, 1, __ATOMIC_SEQ_CST);
+        if (log_ring_is_empty(self))
+            g_cond_wait_until(&self->cond, &self->lock, g_get_monotonic_time() + G_USEC_PER_SEC / 10);
+        __atomic_store_n(&self->sleeping, 0, __ATOMIC_SEQ_CST);
+    }
+    g_mutex_unlock(&self->lock);
+
+    log_ring_drain(self);
+    return NULL;
+}
+
+/*
+ * Start the drain thread calling func for every record
+ */
+void
+ghbci_log_ring_start (GHbciLogRing* self, GHbciLogRingFunc func, gpointer user_data)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (self->thread == NULL);
+
+    self->func = func;
+    self->user_data = user_data;
+    self->stop = FALSE;
+    self->thread = g_thread_new("ghbci-log", log_ring_thread, self);
+}
+
+/*
+ * Deliver remaining records and stop the drain thread
+ */
+void
+ghbci_log_ring_stop (GHbciLogRing* self)
+{
+    g_return_if_fail (self != NULL);
+
+    if (self->thread == NULL)
+        return;
+
+    g_mutex_lock(&self->lock);
+    self->stop = TRUE;
+    g_cond_broadcast(&self->cond);
+    g_mutex_unlock(&self->lock);
+
+    g_thread_join(self->thread);
+    self->thread = NULL;
+}
+
+/*
+ * Wait until all records committed so far are delivered. Returns at once
+ * on the drain thread, the delivery function would wait for itself.
+ */
+void
+ghbci_log_ring_flush (GHbciLogRing* self)
+{
+    guint64 target;
+
+    g_return_if_fail (self != NULL);
+    if (g_thread_self() == self->thread)
+        return;
+    target = __atomic_load_n(&self->enqueue_pos, __ATOMIC_SEQ_CST);
+
+    g_mutex_lock(&self->lock);
+    while (self->thread != NULL && !self->stop
+           && __atomic_load_n(&self->delivered_pos, __ATOMIC_ACQUIRE) < target) {
+        g_cond_broadcast(&self->cond);
+        g_cond_wait_until(&self->cond, &self->lock, g_get_monotonic_time() + G_USEC_PER_SEC / 100);
+    }
+    g_mutex_unlock(&self->lock);
+}
+
+
+// vim: sw=4 expandtab
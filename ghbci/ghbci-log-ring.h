@@ -0,0 +1,62 @@
+/*
+ * ghbci-log-ring.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_LOG_RING_H__
+#define __GHBCI_LOG_RING_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define GHBCI_LOG_RECORD_DIALOG_SIZE   32
+#define GHBCI_LOG_RECORD_MESSAGE_SIZE  472
+
+typedef struct
+{
+    gint level;
+    gint64 time;
+    guint serial;
+    gchar dialog_id[GHBCI_LOG_RECORD_DIALOG_SIZE];
+    gchar message[GHBCI_LOG_RECORD_MESSAGE_SIZE];
+} GHbciLogRecord;
+
+typedef struct _GHbciLogRing GHbciLogRing;
+
+typedef void (*GHbciLogRingFunc) (const GHbciLogRecord* record, gpointer user_data);
+
+GHbciLogRing*     ghbci_log_ring_new                (guint capacity);
+
+void              ghbci_log_ring_free               (GHbciLogRing* self);
+
+GHbciLogRecord*   ghbci_log_ring_reserve            (GHbciLogRing* self, guint64* ticket);
+
+void              ghbci_log_ring_commit             (GHbciLogRing* self, guint64 ticket);
+
+gboolean          ghbci_log_ring_pop                (GHbciLogRing* self, GHbciLogRecord* record);
+
+guint64           ghbci_log_ring_get_dropped        (GHbciLogRing* self);
+
+void              ghbci_log_ring_start              (GHbciLogRing* self, GHbciLogRingFunc func, gpointer user_data);
+
+void              ghbci_log_ring_stop               (GHbciLogRing* self);
+
+void              ghbci_log_ring_flush              (GHbciLogRing* self);
+
+G_END_DECLS
+
+#endif /* __GHBCI_LOG_RING_H__ */
@@ -0,0 +1,589 @@
+/*
+ * ghbci-metrics.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/**
+ * SECTION:ghbci-metrics
+ * @short_description: Latency histograms of hbci4java phases
+ *
+ * A #GHbciContext times the phases reported by hbci4java through status
+ * events (dialog initialization, signing, encryption, sending, parsing, ...)
+ * and the execution of whole jobs. Durations are collected in histograms per
+ * phase, bank and job type. Fetch them with ghbci_context_get_metrics().
+ *
+ * Phases are named after the lower case #GHbciStatusTag without prefix, e.g.
+ * "dialog_init" or "msg_send". The duration of a whole job is recorded as
+ * phase "execute", natively parsing MT940 statements as "mt940" and reading
+ * camt documents as "camt". Paired tags are timed from start to _DONE tag,
+ * the message phases from one tag to the next status event. The raw
+ * messages and infopoint data reported while a message is sent or received
+ * don't end its phase.
+ *
+ * Histograms are log-linear: every power of two is split into 16 buckets,
+ * so any recorded duration is off by at most 1/16. Recording only needs
+ * atomic increments.
+ **/
+
+#include <string.h>
+
+#include "ghbci-metrics.h"
+#include "ghbci-metrics-private.h"
+
+#define SUB_BUCKET_BITS  4
+#define SUB_BUCKETS      (1 << SUB_BUCKET_BITS)
+#define MAGNITUDES       40
+#define N_BUCKETS        (MAGNITUDES * SUB_BUCKETS)
+
+#define N_STATUS_TAGS    32
+#define FIRST_MSG_TAG    21
+#define LAST_MSG_TAG     28
+
+typedef struct
+{
+    gchar* phase;
+    gchar* blz;
+    gchar* job;
+
+    guint64 count;
+    guint64 sum;
+    guint64 buckets[N_BUCKETS];
+} MetricsSeries;
+
+struct _GHbciMetrics
+{
+    gint ref_count;
+
+    GRWLock lock;
+    GHashTable* series;
+};
+
+/* state of the operation running in the current thread */
+typedef struct
+{
+    GHbciMetrics* metrics;
+    gchar* blz;
+    gchar* job;
+    /* series of the phases of blz and job, looked up once per operation */
+    MetricsSeries* series[N_STATUS_TAGS];
+    gint64 start[N_STATUS_TAGS];
+    gint msg_tag;
+    gint64 msg_start;
+} MetricsOperation;
+
+static void metrics_operation_free (gpointer data);
+
+static GPrivate current_operation = G_PRIVATE_INIT (metrics_operation_free);
+
+static const gchar* phase_names[N_STATUS_TAGS] = {
+    NULL,
+    "send_task", NULL,
+    "inst_bpd_init", NULL,
+    "inst_get_keys", NULL,
+    "send_keys", NULL,
+    "init_sysid", NULL,
+    "init_upd", NULL,
+    "lock_keys", NULL,
+    "init_sigid", NULL,
+    "dialog_init", NULL,
+    "dialog_end", NULL,
+    "msg_create",
+    "msg_sign",
+    "msg_crypt",
+    "msg_send",
+    "msg_decrypt",
+    "msg_verify",
+    "msg_recv",
+    "msg_parse",
+};
+
+/* upper bounds of the prometheus buckets in microseconds */
+static const guint64 prometheus_bounds[] = {
+    1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+    1000000, 2500000, 5000000, 10000000, 30000000, 60000000,
+};
+
+
+G_DEFINE_BOXED_TYPE (GHbciMetrics, ghbci_metrics, ghbci_metrics_ref, ghbci_metrics_unref)
+
+
+static guint
+bucket_index (guint64 usec)
+{
+    guint msb, shift, index;
+
+    if (usec < SUB_BUCKETS)
+        return usec;
+
+    msb = g_bit_storage(usec) - 1;
+    shift = msb - SUB_BUCKET_BITS;
+    index = (shift + 1) * SUB_BUCKETS + ((usec >> shift) & (SUB_BUCKETS - 1));
+
+    return MIN(index, N_BUCKETS - 1);
+}
+
+static guint64
+bucket_lower_bound (guint index)
+{
+    if (index < SUB_BUCKETS)
+        return index;
+    return (guint64)(SUB_BUCKETS + index % SUB_BUCKETS) << (index / SUB_BUCKETS - 1);
+}
+
+static guint64
+bucket_upper_bound (guint index)
+{
+    if (index < SUB_BUCKETS)
+        return index;
+    return bucket_lower_bound(index) + ((guint64)1 << (index / SUB_BUCKETS - 1)) - 1;
+}
+
+static void
+metrics_series_free (MetricsSeries* series)
+{
+    g_free(series->phase);
+    g_free(series->blz);
+    g_free(series->job);
+    g_free(series);
+}
+
+static void
+metrics_operation_free (gpointer data)
+{
+    MetricsOperation* operation = data;
+
+    g_free(operation->blz);
+    g_free(operation->job);
+    g_free(operation);
+}
+
+static MetricsOperation*
+metrics_get_operation (void)
+{
+    MetricsOperation* operation = g_private_get(&current_operation);
+
+    if (operation == NULL) {
+        operation = g_new0(MetricsOperation, 1);
+        g_private_set(&current_operation, operation);
+    }
+    return operation;
+}
+
+static gboolean
+series_matches (MetricsSeries* series, const gchar* phase, const gchar* blz, const gchar* job)
+{
+    return (phase == NULL || strcmp(series->phase, phase) == 0)
+        && (blz == NULL || strcmp(series->blz, blz) == 0)
+        && (job == NULL || strcmp(series->job, job) == 0);
+}
+
+/*
+ * Sum up the buckets of all series matching the filter, NULL matches all
+ */
+static guint64
+metrics_collect (GHbciMetrics* self, const gchar* phase, const gchar* blz, const gchar* job,
+        guint64* buckets)
+{
+    GHashTableIter iter;
+    MetricsSeries* series;
+    guint64 count = 0;
+    guint i;
+
+    g_rw_lock_reader_lock(&self->lock);
+    g_hash_table_iter_init(&iter, self->series);
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer*)&series)) {
+        if (!series_matches(series, phase, blz, job))
+            continue;
+        for (i = 0; i < N_BUCKETS; i++) {
+            guint64 value = __atomic_load_n(&series->buckets[i], __ATOMIC_RELAXED);
+            if (buckets != NULL)
+                buckets[i] += value;
+            count += value;
+        }
+    }
+    g_rw_lock_reader_unlock(&self->lock);
+
+    return count;
+}
+
+
+/* private methods */
+
+GHbciMetrics*
+ghbci_metrics_new (void)
+{
+    GHbciMetrics* self = g_new0(GHbciMetrics, 1);
+
+    self->ref_count = 1;
+    g_rw_lock_init(&self->lock);
+    self->series = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)metrics_series_free);
+
+    return self;
+}
+
+/*
+ * Series of phase, blz and job, created if there is none. Series are never
+ * removed, so the result stays valid as long as self.
+ */
+static MetricsSeries*
+metrics_get_series (GHbciMetrics* self, const gchar* phase, const gchar* blz, const gchar* job)
+{
+    MetricsSeries* series;
+
+    if (blz == NULL)
+        blz = "";
+    if (job == NULL)
+        job = "";
+
+    gchar* key = g_strjoin("\x1f", phase, blz, job, NULL);
+
+    g_rw_lock_reader_lock(&self->lock);
+    series = g_hash_table_lookup(self->series, key);
+    g_rw_lock_reader_unlock(&self->lock);
+
+    if (series == NULL) {
+        g_rw_lock_writer_lock(&self->lock);
+        series = g_hash_table_lookup(self->series, key);
+        if (series == NULL) {
+            series = g_new0(MetricsSeries, 1);
+            series->phase = g_strdup(phase);
+            series->blz = g_strdup(blz);
+            series->job = g_strdup(job);
+            g_hash_table_insert(self->series, key, series);
+            key = NULL;
+        }
+        g_rw_lock_writer_unlock(&self->lock);
+    }
+    g_free(key);
+    return series;
+}
+
+static void
+metrics_series_add (MetricsSeries* series, guint64 usec)
+{
+    // series are never removed, so updating them needs no lock
+    __atomic_fetch_add(&series->buckets[bucket_index(usec)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&series->sum, usec, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&series->count, 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * Record a phase of the current operation, the series of blz and job is
+ * looked up the first time the phase ends
+ */
+static void
+metrics_operation_record (GHbciMetrics* self, MetricsOperation* operation, gint status_tag, guint64 usec)
+{
+    if (operation->metrics != self) {
+        ghbci_metrics_record(self, phase_names[status_tag], NULL, NULL, usec);
+        return;
+    }
+    if (operation->series[status_tag] == NULL)
+        operation->series[status_tag] = metrics_get_series(self, phase_names[status_tag], operation->blz,
+                operation->job);
+    metrics_series_add(operation->series[status_tag], usec);
+}
+
+/*
+ * Add a duration to the histogram of phase, blz and job
+ */
+void
+ghbci_metrics_record (GHbciMetrics* self, const gchar* phase, const gchar* blz, const gchar* job, guint64 usec)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (phase != NULL);
+
+    metrics_series_add(metrics_get_series(self, phase, blz, job), usec);
+}
+
+/*
+ * Assign the status events of the current thread to a bank and job
+ */
+void
+ghbci_metrics_begin_operation (GHbciMetrics* self, const gchar* blz, const gchar* job)
+{
+    MetricsOperation* operation = metrics_get_operation();
+
+    g_free(operation->blz);
+    g_free(operation->job);
+    operation->metrics = self;
+    operation->blz = g_strdup(blz);
+    operation->job = g_strdup(job);
+    memset(operation->series, 0, sizeof(operation->series));
+    memset(operation->start, 0, sizeof(operation->start));
+    operation->msg_tag = 0;
+}
+
+void
+ghbci_metrics_end_operation (GHbciMetrics* self)
+{
+    MetricsOperation* operation = metrics_get_operation();
+
+    // close message phase still running
+    ghbci_metrics_status(self, 0);
+
+    g_free(operation->blz);
+    g_free(operation->job);
+    operation->metrics = NULL;
+    operation->blz = NULL;
+    operation->job = NULL;
+    memset(operation->series, 0, sizeof(operation->series));
+}
+
+/*
+ * Feed a status event of hbci4java
+ */
+void
+ghbci_metrics_status (GHbciMetrics* self, gint status_tag)
+{
+    MetricsOperation* operation = metrics_get_operation();
+    gint64 now = g_get_monotonic_time();
+
+    // raw messages and infopoint data are reported in the middle of a phase
+    if (status_tag > LAST_MSG_TAG)
+        return;
+
+    // any other event ends the current message phase
+    if (operation->msg_tag != 0) {
+        metrics_operation_record(self, operation, operation->msg_tag, now - operation->msg_start);
+        operation->msg_tag = 0;
+    }
+
+    if (status_tag >= FIRST_MSG_TAG && status_tag <= LAST_MSG_TAG) {
+        operation->msg_tag = status_tag;
+        operation->msg_start = now;
+    } else if (status_tag > 0 && status_tag < FIRST_MSG_TAG) {
+        if (status_tag % 2 == 1) {
+            operation->start[status_tag] = now;
+        } else if (operation->start[status_tag - 1] != 0) {
+            metrics_operation_record(self, operation, status_tag - 1, now - operation->start[status_tag - 1]);
+            operation->start[status_tag - 1] = 0;
+        }
+    }
+}
+
+
+/* public methods */
+
+/**
+ * ghbci_metrics_ref:
+ * @self: The #GHbciMetrics
+ *
+ * Increase reference count
+ *
+ * Returns: (transfer full): @self
+ **/
+GHbciMetrics*
+ghbci_metrics_ref (GHbciMetrics* self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    g_atomic_int_inc(&self->ref_count);
+    return self;
+}
+
+/**
+ * ghbci_metrics_unref:
+ * @self: The #GHbciMetrics
+ *
+ * Decrease reference count, frees @self when it drops to zero
+ **/
+void
+ghbci_metrics_unref (GHbciMetrics* self)
+{
+    g_return_if_fail (self != NULL);
+
+    if (g_atomic_int_dec_and_test(&self->ref_count)) {
+        g_hash_table_unref(self->series);
+        g_rw_lock_clear(&self->lock);
+        g_free(self);
+    }
+}
+
+/**
+ * ghbci_metrics_get_count:
+ * @self: The #GHbciMetrics
+ * @phase: (nullable): phase name or %NULL for all phases
+ * @blz: (nullable): blz or %NULL for all banks
+ * @job: (nullable): job name or %NULL for all jobs
+ *
+ * Get number of recorded durations
+ *
+ * Returns: number of durations matching the filter
+ **/
+guint64
+ghbci_metrics_get_count (GHbciMetrics* self, const gchar* phase, const gchar* blz, const gchar* job)
+{
+    g_return_val_if_fail (self != NULL, 0);
+
+    return metrics_collect(self, phase, blz, job, NULL);
+}
+
+/**
+ * ghbci_metrics_get_percentile:
+ * @self: The #GHbciMetrics
+ * @phase: (nullable): phase name or %NULL for all phases
+ * @blz: (nullable): blz or %NULL for all banks
+ * @job: (nullable): job name or %NULL for all jobs
+ * @percentile: percentile between 0 and 100
+ *
+ * Get a percentile of the recorded durations, e.g. 99 for the duration
+ * 99 percent of the matching phases were faster than
+ *
+ * Returns: duration in microseconds, 0 if nothing was recorded
+ **/
+guint64
+ghbci_metrics_get_percentile (GHbciMetrics* self, const gchar* phase, const gchar* blz, const gchar* job,
+        gdouble percentile)
+{
+    guint64* buckets;
+    guint64 count, rank, seen = 0;
+    guint64 result = 0;
+    guint i;
+
+    g_return_val_if_fail (self != NULL, 0);
+    g_return_val_if_fail (percentile >= 0 && percentile <= 100, 0);
+
+    buckets = g_new0(guint64, N_BUCKETS);
+    count = metrics_collect(self, phase, blz, job, buckets);
+
+    if (count > 0) {
+        rank = MAX((guint64)(percentile / 100 * count + 0.5), 1);
+        for (i = 0; i < N_BUCKETS; i++) {
+            seen += buckets[i];
+            if (seen >= rank) {
+                result = (bucket_lower_bound(i) + bucket_upper_bound(i)) / 2;
+                break;
+            }
+        }
+    }
+
+    g_free(buckets);
+    return result;
+}
+
+/**
+ * ghbci_metrics_reset:
+ * @self: The #GHbciMetrics
+ *
+ * Forget all recorded durations
+ **/
+void
+ghbci_metrics_reset (GHbciMetrics* self)
+{
+    GHashTableIter iter;
+    MetricsSeries* series;
+    guint i;
+
+    g_return_if_fail (self != NULL);
+
+    // recording threads may hold on to series, so only clear them
+    g_rw_lock_reader_lock(&self->lock);
+    g_hash_table_iter_init(&iter, self->series);
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer*)&series)) {
+        for (i = 0; i < N_BUCKETS; i++) {
+            __atomic_store_n(&series->buckets[i], 0, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&series->sum, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&series->count, 0, __ATOMIC_RELAXED);
+    }
+    g_rw_lock_reader_unlock(&self->lock);
+}
+
+static gint
+series_compare (gconstpointer a, gconstpointer b)
+{
+    const MetricsSeries* series_a = *(MetricsSeries**)a;
+    const MetricsSeries* series_b = *(MetricsSeries**)b;
+    gint result;
+
+    result = strcmp(series_a->phase, series_b->phase);
+    if (result == 0)
+        result = strcmp(series_a->blz, series_b->blz);
+    if (result == 0)
+        result = strcmp(series_a->job, series_b->job);
+    return result;
+}
+
+/**
+ * ghbci_metrics_to_prometheus:
+ * @self: The #GHbciMetrics
+ *
+ * Dump all histograms in the prometheus text exposition format as metric
+ * ghbci_phase_duration_seconds with labels phase, blz and job.
+ *
+ * The log-linear buckets don't end at the prometheus bounds, so a bucket
+ * counts for a bound when its lower end is within it: the count of a
+ * bound includes durations up to 1/16 above it.
+ *
+ * Returns: (transfer full): prometheus text
+ **/
+gchar*
+ghbci_metrics_to_prometheus (GHbciMetrics* self)
+{
+    GString* text;
+    GPtrArray* all_series;
+    GHashTableIter iter;
+    MetricsSeries* series;
+    guint i, j, k;
+
+    g_return_val_if_fail (self != NULL, NULL);
+
+    text = g_string_new("# HELP ghbci_phase_duration_seconds Duration of hbci4java phases\n"
+                        "# TYPE ghbci_phase_duration_seconds histogram\n");
+
+    g_rw_lock_reader_lock(&self->lock);
+
+    all_series = g_ptr_array_new();
+    g_hash_table_iter_init(&iter, self->series);
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer*)&series)) {
+        g_ptr_array_add(all_series, series);
+    }
+    g_ptr_array_sort(all_series, series_compare);
+
+    for (i = 0; i < all_series->len; i++) {
+        series = g_ptr_array_index(all_series, i);
+
+        gchar* labels = g_strdup_printf("phase=\"%s\",blz=\"%s\",job=\"%s\"", series->phase, series->blz, series->job);
+        guint64 cumulative = 0;
+
+        k = 0;
+        for (j = 0; j < G_N_ELEMENTS(prometheus_bounds); j++) {
+            for (; k < N_BUCKETS && bucket_lower_bound(k) <= prometheus_bounds[j]; k++) {
+                cumulative += __atomic_load_n(&series->buckets[k], __ATOMIC_RELAXED);
+            }
+            g_string_append_printf(text, "ghbci_phase_duration_seconds_bucket{%s,le=\"%g\"} %" G_GUINT64_FORMAT "\n",
+                    labels, prometheus_bounds[j] / 1e6, cumulative);
+        }
+
+        guint64 count = __atomic_load_n(&series->count, __ATOMIC_RELAXED);
+        guint64 sum = __atomic_load_n(&series->sum, __ATOMIC_RELAXED);
+        g_string_append_printf(text, "ghbci_phase_duration_seconds_bucket{%s,le=\"+Inf\"} %" G_GUINT64_FORMAT "\n",
+                labels, count);
+        g_string_append_printf(text, "ghbci_phase_duration_seconds_sum{%s} %g\n", labels, sum / 1e6);
+        g_string_append_printf(text, "ghbci_phase_duration_seconds_count{%s} %" G_GUINT64_FORMAT "\n", labels, count);
+
+        g_free(labels);
+    }
+
+    g_rw_lock_reader_unlock(&self->lock);
+    g_ptr_array_free(all_series, TRUE);
+
+    return g_string_free(text, FALSE);
+}
+
+
+// vim: sw=4 expandtab
@@ -0,0 +1,49 @@
+/*
+ * ghbci-metrics.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_METRICS_H__
+#define __GHBCI_METRICS_H__
+
+#include <glib.h>
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GHbciMetrics GHbciMetrics;
+
+#define GHBCI_TYPE_METRICS             (ghbci_metrics_get_type ())
+
+GType             ghbci_metrics_get_type                      (void) G_GNUC_CONST;
+
+GHbciMetrics*     ghbci_metrics_ref                           (GHbciMetrics* self);
+
+void              ghbci_metrics_unref                         (GHbciMetrics* self);
+
+guint64           ghbci_metrics_get_count                     (GHbciMetrics* self, const gchar* phase,
+                                                               const gchar* blz, const gchar* job);
+
+guint64           ghbci_metrics_get_percentile                (GHbciMetrics* self, const gchar* phase,
+                                                               const gchar* blz, const gchar* job, gdouble percentile);
+
+void              ghbci_metrics_reset                         (GHbciMetrics* self);
+
+gchar*            ghbci_metrics_to_prometheus                 (GHbciMetrics* self);
+
+G_END_DECLS
+
+#endif /* __GHBCI_METRICS_H__ */
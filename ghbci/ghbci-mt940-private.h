@@ -0,0 +1,40 @@
+/*
+ * ghbci-mt940-private.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_MT940_PRIVATE_H__
+#define __GHBCI_MT940_PRIVATE_H__
+
+#include <glib.h>
+
+#include "ghbci-statement.h"
+#include "ghbci-statement-private.h"
+
+typedef struct _GHbciMt940Parser GHbciMt940Parser;
+
+gboolean            ghbci_mt940_parse                         (const gchar* data, gsize length,
+                                                               GHbciStringPool* pool, GHbciStatementFunc func, gpointer user_data,
+                                                               GError** error);
+
+GHbciMt940Parser*   ghbci_mt940_parser_new                    (GHbciStringPool* pool, GHbciStatementFunc func,
+                                                               gpointer user_data);
+gboolean            ghbci_mt940_parser_feed                   (GHbciMt940Parser* parser, const gchar* data, gsize length,
+                                                               GError** error);
+gboolean            ghbci_mt940_parser_finish                 (GHbciMt940Parser* parser, GError** error);
+void                ghbci_mt940_parser_free                   (GHbciMt940Parser* parser);
+
+#endif /* __GHBCI_MT940_PRIVATE_H__ */
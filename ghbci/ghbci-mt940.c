@@ -0,0 +1,683 @@
+/*
+ * ghbci-mt940.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/*
+ * Parser of the MT940 data of KUmsAll, as hbci4java receives it. The data
+ * is read in one pass: fields are slices of the input, only the values of
+ * statements are copied, and the SEPA fields are split off the reference
+ * when the statement is created. Data arriving in pieces is fed to a
+ * GHbciMt940Parser, which keeps only the field still incomplete.
+ */
+
+#include <string.h>
+
+#include "ghbci-mt940-private.h"
+#include "ghbci-statement.h"
+#include "ghbci-statement-private.h"
+#include "ghbci-error.h"
+#include "ghbci-error-private.h"
+
+/* bytes is_field_start() looks at, a field start is only certain before the last of them */
+#define FIELD_START_LENGTH  6
+/* length of a line of the reference, shorter lines are followed by a space */
+#define USAGE_LINE_LENGTH   27
+/* transaction code of unstructured :86: fields */
+#define UNSTRUCTURED_CODE   "999"
+
+/* field of a message, slices of the input */
+typedef struct
+{
+    const gchar* tag;
+    gsize tag_length;
+    const gchar* value;
+    const gchar* value_end;
+} Field;
+
+struct _GHbciMt940Parser
+{
+    GHbciStringPool* pool;
+    GHbciStatementFunc func;
+    gpointer user_data;
+    guint this_year;
+
+    /* balance after the last statement, in cent */
+    gint64 balance;
+    gchar currency[4];
+
+    /* statement waiting for its :86: field */
+    gboolean pending;
+    guint32 valuta;
+    guint32 booking_date;
+    gchar* value;
+    gchar* saldo;
+
+    /* :86: field without line breaks */
+    GString* details;
+
+    /* fed data from the start of the first incomplete field */
+    GString* input;
+    /* offset of input in all data */
+    gsize offset;
+    /* start of the first line of input not looked at */
+    gsize scanned;
+};
+
+typedef GHbciMt940Parser Parser;
+
+
+/*
+ * Length of the line break at p, 0 if there is none. Some banks separate
+ * lines with "@@".
+ */
+static gsize
+line_break_length (const gchar* p, const gchar* end)
+{
+    if (p < end && *p == '\n')
+        return 1;
+    if (p + 1 < end && ((p[0] == '\r' && p[1] == '\n') || (p[0] == '@' && p[1] == '@')))
+        return 2;
+    return 0;
+}
+
+/*
+ * Whether a field like ":61:" or ":60F:", or the "-" ending a message,
+ * starts at the line starting at p
+ */
+static gboolean
+is_field_start (const gchar* p, const gchar* end)
+{
+    if (p < end && *p == '-')
+        return p + 1 == end || line_break_length(p + 1, end) > 0;
+    if (p + 3 >= end || p[0] != ':' || !g_ascii_isdigit(p[1]) || !g_ascii_isdigit(p[2]))
+        return FALSE;
+    return p[3] == ':' || (g_ascii_isalpha(p[3]) && p + 4 < end && p[4] == ':');
+}
+
+/*
+ * Read the field at the line starting at *pos. Values end at the line
+ * break before the next field.
+ *
+ * Returns FALSE at the end of data
+ */
+static gboolean
+next_field (const gchar** pos, const gchar* end, Field* field)
+{
+    const gchar* p = *pos;
+    gsize n;
+
+    // skip empty lines and whatever precedes the first field
+    while (p < end && !is_field_start(p, end)) {
+        while (p < end && line_break_length(p, end) == 0)
+            p++;
+        p += line_break_length(p, end);
+    }
+    if (p >= end)
+        return FALSE;
+
+    if (*p == '-') {
+        field->tag = p;
+        field->tag_length = 1;
+        field->value = field->value_end = ++p;
+    } else {
+        field->tag = p + 1;
+        field->tag_length = p[3] == ':' ? 2 : 3;
+        p += field->tag_length + 2;
+        field->value = p;
+        for (;;) {
+            while (p < end && (n = line_break_length(p, end)) == 0)
+                p++;
+            field->value_end = p;
+            if (p >= end)
+                break;
+            p += n;
+            if (p >= end || is_field_start(p, end))
+                break;
+        }
+    }
+    *pos = p;
+    return TRUE;
+}
+
+static gboolean
+field_is (const Field* field, const gchar* tag)
+{
+    return field->tag_length == strlen(tag) && memcmp(field->tag, tag, field->tag_length) == 0;
+}
+
+static gboolean
+parse_digits (const gchar** pos, const gchar* end, guint count, guint* value)
+{
+    const gchar* p = *pos;
+    guint result = 0;
+    guint i;
+
+    if (end - p < (gssize)count)
+        return FALSE;
+    for (i = 0; i < count; i++) {
+        if (!g_ascii_isdigit(p[i]))
+            return FALSE;
+        result = result * 10 + (p[i] - '0');
+    }
+    *value = result;
+    *pos = p + count;
+    return TRUE;
+}
+
+/*
+ * Amount like "1234,5", in cent
+ */
+static gboolean
+parse_amount (const gchar** pos, const gchar* end, gint64* cents)
+{
+    const gchar* p = *pos;
+    gint64 units = 0;
+    gint fraction = 0;
+    guint decimals = 0;
+
+    if (p >= end || !g_ascii_isdigit(*p))
+        return FALSE;
+    while (p < end && g_ascii_isdigit(*p)) {
+        if (units > G_MAXINT64 / 1000)
+            return FALSE;
+        units = units * 10 + (*p++ - '0');
+    }
+    if (p >= end || *p != ',')
+        return FALSE;
+    for (p++; p < end && g_ascii_isdigit(*p); p++) {
+        if (decimals++ < 2)
+            fraction = fraction * 10 + (*p - '0');
+    }
+    if (decimals == 1)
+        fraction *= 10;
+    *cents = units * 100 + fraction;
+    *pos = p;
+    return TRUE;
+}
+
+/*
+ * Two digit years are at most 20 years ahead, like in hbci4java
+ */
+static guint
+expand_year (const Parser* parser, guint year)
+{
+    year += 2000;
+    if (year > parser->this_year + 20)
+        year -= 100;
+    return year;
+}
+
+static void
+append_latin1 (GString* string, const gchar* text, gsize length)
+{
+    const guchar* p = (const guchar*)text;
+    const guchar* end = p + length;
+
+    while (p < end) {
+        const guchar* ascii = p;
+        while (p < end && *p < 0x80)
+            p++;
+        g_string_append_len(string, (const gchar*)ascii, p - ascii);
+        if (p < end) {
+            g_string_append_c(string, 0xc0 | (*p >> 6));
+            g_string_append_c(string, 0x80 | (*p & 0x3f));
+            p++;
+        }
+    }
+}
+
+static gchar*
+latin1_to_utf8 (const gchar* text, gsize length)
+{
+    GString* string = g_string_sized_new(length + 1);
+
+    append_latin1(string, text, length);
+    return g_string_free(string, FALSE);
+}
+
+static void
+clear_pending (Parser* parser)
+{
+    parser->valuta = 0;
+    parser->booking_date = 0;
+    g_clear_pointer(&parser->value, g_free);
+    g_clear_pointer(&parser->saldo, g_free);
+    parser->pending = FALSE;
+}
+
+/*
+ * Pass the pending statement to the callback, takes ownership of the
+ * strings
+ */
+static void
+emit_statement (Parser* parser, gchar* gv_code, gchar* transaction_type, gchar* other_name,
+        gchar* other_iban, gchar* other_bic, gchar* usage)
+{
+    GHbciStatement* statement = ghbci_statement_new_native(parser->pool, parser->valuta,
+            parser->booking_date, parser->value, parser->saldo, gv_code, transaction_type, other_name, other_iban,
+            other_bic, usage);
+
+    parser->valuta = 0;
+    parser->booking_date = 0;
+    parser->value = NULL;
+    parser->saldo = NULL;
+    parser->pending = FALSE;
+    parser->func(statement, parser->user_data);
+}
+
+/*
+ * Emit a statement without :86: field
+ */
+static void
+flush_statement (Parser* parser)
+{
+    if (parser->pending)
+        emit_statement(parser, NULL, NULL, NULL, NULL, NULL, g_strdup(""));
+}
+
+/*
+ * :60F: or :60M:, e.g. "C150101EUR1234,56"
+ */
+static gboolean
+parse_balance (Parser* parser, const Field* field)
+{
+    const gchar* p = field->value;
+    const gchar* end = field->value_end;
+    gboolean debit;
+    gint64 cents;
+    guint date;
+
+    if (p >= end || (*p != 'C' && *p != 'D'))
+        return FALSE;
+    debit = *p++ == 'D';
+    if (!parse_digits(&p, end, 6, &date) || end - p < 3)
+        return FALSE;
+    if (!g_ascii_isalpha(p[0]) || !g_ascii_isalpha(p[1]) || !g_ascii_isalpha(p[2]))
+        return FALSE;
+    memcpy(parser->currency, p, 3);
+    p += 3;
+    if (!parse_amount(&p, end, &cents))
+        return FALSE;
+    parser->balance = debit ? -cents : cents;
+    return TRUE;
+}
+
+/*
+ * :61:, e.g. "1501020102DR12,34NMSCNONREF": valuta, booking date, debit
+ * or credit, funds code, amount and references, which are ignored
+ */
+static gboolean
+parse_statement_line (Parser* parser, const Field* field)
+{
+    const gchar* p = field->value;
+    const gchar* end = field->value_end;
+    guint valuta, booking;
+    gboolean debit;
+    gint64 cents;
+
+    if (!parse_digits(&p, end, 6, &valuta))
+        return FALSE;
+    guint year = expand_year(parser, valuta / 10000);
+    guint month = valuta / 100 % 100;
+    guint day = valuta % 100;
+    guint booking_year = year;
+    guint booking_month = month;
+    guint booking_day = day;
+    if (parse_digits(&p, end, 4, &booking)) {
+        booking_month = booking / 100;
+        booking_day = booking % 100;
+        // booked around new year
+        if (booking_month == 12 && month == 1)
+            booking_year--;
+        else if (booking_month == 1 && month == 12)
+            booking_year++;
+    }
+    if (!g_date_valid_dmy(day, month, year) || !g_date_valid_dmy(booking_day, booking_month, booking_year))
+        return FALSE;
+
+    // reversals have the opposite sign
+    if (end - p >= 2 && p[0] == 'R' && (p[1] == 'C' || p[1] == 'D')) {
+        debit = p[1] == 'C';
+        p += 2;
+    } else if (p < end && (*p == 'C' || *p == 'D')) {
+        debit = *p == 'D';
+        p++;
+    } else {
+        return FALSE;
+    }
+    if (p < end && g_ascii_isalpha(*p))
+        p++;
+    if (!parse_amount(&p, end, &cents))
+        return FALSE;
+    if (debit)
+        cents = -cents;
+
+    flush_statement(parser);
+    parser->balance += cents;
+    parser->valuta = ghbci_statement_pack_date(day, month, year);
+    parser->booking_date = ghbci_statement_pack_date(booking_day, booking_month, booking_year);
+    parser->value = ghbci_statement_format_amount(cents, parser->currency);
+    parser->saldo = ghbci_statement_format_amount(parser->balance, parser->currency);
+    parser->pending = TRUE;
+    return TRUE;
+}
+
+static gboolean
+is_subfield_start (const gchar* p, const gchar* end, gchar separator)
+{
+    return end - p >= 3 && p[0] == separator && g_ascii_isdigit(p[1]) && g_ascii_isdigit(p[2]);
+}
+
+/*
+ * :86: of the pending statement, e.g. "166?00GUTSCHRIFT?20EREF+..?32Name":
+ * transaction code and subfields for the transaction type, the lines of
+ * the reference and the other account
+ */
+static void
+parse_details (Parser* parser, const Field* field)
+{
+    GString* details = parser->details;
+    const gchar* p = field->value;
+    const gchar* end = field->value_end;
+    gchar* transaction_type = NULL;
+    gchar* other_iban = NULL;
+    gchar* other_bic = NULL;
+    GString* other_name = NULL;
+    GString* usage;
+
+    // information on the account instead of a statement
+    if (!parser->pending)
+        return;
+
+    // subfields may be wrapped anywhere
+    g_string_truncate(details, 0);
+    while (p < end) {
+        const gchar* line = p;
+        while (p < end && line_break_length(p, end) == 0)
+            p++;
+        g_string_append_len(details, line, p - line);
+        p += line_break_length(p, end);
+    }
+
+    p = details->str;
+    end = details->str + details->len;
+    usage = g_string_sized_new(details->len + 16);
+    if (details->len < 6 || !g_ascii_isdigit(p[0]) || !g_ascii_isdigit(p[1]) || !g_ascii_isdigit(p[2])
+            || g_ascii_isalnum(p[3]) || !is_subfield_start(p + 3, end, p[3])) {
+        append_latin1(usage, p, details->len);
+        emit_statement(parser, g_strdup(UNSTRUCTURED_CODE), NULL, NULL, NULL, NULL, g_string_free(usage, FALSE));
+        return;
+    }
+
+    gchar* gv_code = g_strndup(p, 3);
+    gchar separator = p[3];
+    for (p += 3; p < end; ) {
+        guint code = (p[1] - '0') * 10 + (p[2] - '0');
+        const gchar* value = p + 3;
+        for (p = value; p < end && !is_subfield_start(p, end, separator); p++)
+            ;
+
+        switch (code) {
+        case 0:
+            g_free(transaction_type);
+            transaction_type = latin1_to_utf8(value, p - value);
+            break;
+        case 20: case 21: case 22: case 23: case 24: case 25: case 26: case 27: case 28: case 29:
+        case 60: case 61: case 62: case 63:
+            append_latin1(usage, value, p - value);
+            if (p - value < USAGE_LINE_LENGTH)
+                g_string_append_c(usage, ' ');
+            break;
+        case 30:
+            g_free(other_bic);
+            other_bic = latin1_to_utf8(value, p - value);
+            break;
+        case 31:
+            g_free(other_iban);
+            other_iban = latin1_to_utf8(value, p - value);
+            break;
+        case 32:
+        case 33:
+            if (other_name == NULL)
+                other_name = g_string_new(NULL);
+            append_latin1(other_name, value, p - value);
+            break;
+        default:
+            break;
+        }
+    }
+
+    emit_statement(parser, gv_code, transaction_type, other_name != NULL ? g_string_free(other_name, FALSE) : NULL,
+            other_iban, other_bic, g_string_free(usage, FALSE));
+}
+
+
+/*
+ * Parse the fields between data and end, which ends at the start of a field
+ * or of all data. offset is the offset of data in all data.
+ */
+static gboolean
+parse_fields (Parser* parser, const gchar* data, const gchar* end, gsize offset, GError** error)
+{
+    const gchar* pos = data;
+    gboolean valid = TRUE;
+    Field field;
+
+    while (valid && next_field(&pos, end, &field)) {
+        if (field_is(&field, "61")) {
+            valid = parse_statement_line(parser, &field);
+        } else if (field_is(&field, "86")) {
+            parse_details(parser, &field);
+        } else {
+            // any other field ends a statement
+            flush_statement(parser);
+            if (field_is(&field, "60F") || field_is(&field, "60M"))
+                valid = parse_balance(parser, &field);
+        }
+    }
+
+    if (!valid) {
+        ghbci_set_error(error, GHBCI_ERROR_FAILED, NULL, GHBCI_RETRY_HINT_NEVER,
+                "invalid MT940 field :%.*s: at byte %" G_GSIZE_FORMAT,
+                (int)field.tag_length, field.tag, offset + (gsize)(field.tag - 1 - data));
+        clear_pending(parser);
+    }
+    return valid;
+}
+
+static void
+parser_init (Parser* parser, GHbciStringPool* pool, GHbciStatementFunc func, gpointer user_data)
+{
+    GDateTime* now = g_date_time_new_now_local();
+    parser->this_year = g_date_time_get_year(now);
+    g_date_time_unref(now);
+    parser->pool = pool != NULL ? ghbci_string_pool_ref(pool) : ghbci_string_pool_new();
+    parser->func = func;
+    parser->user_data = user_data;
+    g_strlcpy(parser->currency, "EUR", sizeof(parser->currency));
+    parser->details = g_string_sized_new(256);
+}
+
+static void
+parser_clear (Parser* parser)
+{
+    clear_pending(parser);
+    g_string_free(parser->details, TRUE);
+    if (parser->input != NULL)
+        g_string_free(parser->input, TRUE);
+    ghbci_string_pool_unref(parser->pool);
+}
+
+
+/* private methods */
+
+/**
+ * ghbci_mt940_parse:
+ * @data: MT940 data, ISO 8859-1 encoded like hbci4java reads it
+ * @length: length of @data
+ * @pool: (nullable): pool for the repeating fields of the statements, %NULL
+ *   for one of this call
+ * @func: called with each statement, in order
+ * @user_data: data for @func
+ * @error: return location for a #GError
+ *
+ * Parse statements, the saldo of each is computed from the opening
+ * balance. @func has received the statements before the invalid field
+ * if parsing fails.
+ *
+ * Returns: %TRUE if all of @data was valid
+ **/
+gboolean
+ghbci_mt940_parse (const gchar* data, gsize length, GHbciStringPool* pool, GHbciStatementFunc func,
+        gpointer user_data, GError** error)
+{
+    Parser parser = { 0 };
+    gboolean valid;
+
+    g_return_val_if_fail (data != NULL || length == 0, FALSE);
+    g_return_val_if_fail (func != NULL, FALSE);
+
+    parser_init(&parser, pool, func, user_data);
+    valid = parse_fields(&parser, data, data + length, 0, error);
+    if (valid)
+        flush_statement(&parser);
+    parser_clear(&parser);
+    return valid;
+}
+
+/**
+ * ghbci_mt940_parser_new:
+ * @pool: (nullable): pool for the repeating fields of the statements, %NULL
+ *   for one of this parser
+ * @func: called with each statement, in order
+ * @user_data: data for @func
+ *
+ * Parser of data arriving in pieces, like ghbci_mt940_parse() parses
+ * all of it. Feed the data with ghbci_mt940_parser_feed() and end it with
+ * ghbci_mt940_parser_finish().
+ *
+ * Returns: (transfer full): a new parser, free it with ghbci_mt940_parser_free()
+ **/
+GHbciMt940Parser*
+ghbci_mt940_parser_new (GHbciStringPool* pool, GHbciStatementFunc func, gpointer user_data)
+{
+    Parser* parser;
+
+    g_return_val_if_fail (func != NULL, NULL);
+
+    parser = g_new0(Parser, 1);
+    parser_init(parser, pool, func, user_data);
+    parser->input = g_string_sized_new(1024);
+    return parser;
+}
+
+/**
+ * ghbci_mt940_parser_feed:
+ * @parser: a #GHbciMt940Parser
+ * @data: the next piece of the data, ISO 8859-1 encoded
+ * @length: length of @data
+ * @error: return location for a #GError
+ *
+ * Parse the fields of @data which are complete, the rest is kept until the
+ * next piece. Don't feed the parser after an error.
+ *
+ * Returns: %TRUE if the complete fields were valid
+ **/
+gboolean
+ghbci_mt940_parser_feed (GHbciMt940Parser* parser, const gchar* data, gsize length, GError** error)
+{
+    const gchar *start, *end, *p, *cut;
+    gsize n;
+
+    g_return_val_if_fail (parser != NULL, FALSE);
+    g_return_val_if_fail (data != NULL || length == 0, FALSE);
+
+    g_string_append_len(parser->input, data, length);
+    start = parser->input->str;
+    end = start + parser->input->len;
+
+    // the last line starting a field which is known to start there
+    cut = start;
+    p = start + parser->scanned;
+    while (end - p >= FIELD_START_LENGTH) {
+        const gchar* line = p;
+        if (line != start && is_field_start(line, end))
+            cut = line;
+        while (p < end && (n = line_break_length(p, end)) == 0)
+            p++;
+        // look at an incomplete line again, it may end in half a line break
+        if (p >= end) {
+            p = line;
+            break;
+        }
+        p += n;
+    }
+    parser->scanned = p - start;
+    if (cut == start)
+        return TRUE;
+
+    if (!parse_fields(parser, start, cut, parser->offset, error))
+        return FALSE;
+    parser->offset += cut - start;
+    parser->scanned -= cut - start;
+    g_string_erase(parser->input, 0, cut - start);
+    return TRUE;
+}
+
+/**
+ * ghbci_mt940_parser_finish:
+ * @parser: a #GHbciMt940Parser
+ * @error: return location for a #GError
+ *
+ * Parse the rest of the data after the last piece.
+ *
+ * Returns: %TRUE if the rest was valid
+ **/
+gboolean
+ghbci_mt940_parser_finish (GHbciMt940Parser* parser, GError** error)
+{
+    gboolean valid;
+
+    g_return_val_if_fail (parser != NULL, FALSE);
+
+    valid = parse_fields(parser, parser->input->str, parser->input->str + parser->input->len, parser->offset, error);
+    if (valid)
+        flush_statement(parser);
+    parser->offset += parser->input->len;
+    parser->scanned = 0;
+    g_string_truncate(parser->input, 0);
+    return valid;
+}
+
+/**
+ * ghbci_mt940_parser_free:
+ * @parser: (transfer full): a #GHbciMt940Parser
+ *
+ * Free the parser, a statement waiting for its :86: field is dropped
+ * unless ghbci_mt940_parser_finish() was called.
+ **/
+void
+ghbci_mt940_parser_free (GHbciMt940Parser* parser)
+{
+    if (parser == NULL)
+        return;
+    parser_clear(parser);
+    g_free(parser);
+}
+
+
+// vim: sw=4 expandtab
@@ -0,0 +1,231 @@
+/*
+ * ghbci-rate-limiter.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/*
+ * Token bucket limiter for requests sent to a bank server
+ *
+ * Every key (usually the pin/tan url of a bank) has its own bucket, which
+ * refills with requests_per_second tokens up to burst tokens. A request
+ * needs one token and one of max_concurrent slots. After a transient
+ * failure the bucket can be blocked for a while, so all requests to the
+ * same server back off together instead of retrying on their own.
+ *
+ * A key without explicit limit uses the limit set for the key NULL, also
+ * if that changes later. A rate of 0 or max_concurrent of 0 means no limit.
+ */
+
+#include "ghbci-rate-limiter.h"
+
+typedef struct
+{
+    gdouble rate;
+    guint burst;
+    guint max_concurrent;
+    /* limits set for this key, not the defaults */
+    gboolean explicit;
+
+    gdouble tokens;
+    gint64 last_refill;
+    gint64 blocked_until;
+    guint running;
+} RateBucket;
+
+struct _GHbciRateLimiter
+{
+    GMutex lock;
+    GCond cond;
+
+    gdouble default_rate;
+    guint default_burst;
+    guint default_max_concurrent;
+
+    GHashTable* buckets;
+};
+
+
+GHbciRateLimiter*
+ghbci_rate_limiter_new (void)
+{
+    GHbciRateLimiter* self = g_new0(GHbciRateLimiter, 1);
+
+    g_mutex_init(&self->lock);
+    g_cond_init(&self->cond);
+    self->buckets = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+    return self;
+}
+
+void
+ghbci_rate_limiter_free (GHbciRateLimiter* self)
+{
+    if (self == NULL)
+        return;
+
+    g_hash_table_unref(self->buckets);
+    g_cond_clear(&self->cond);
+    g_mutex_clear(&self->lock);
+    g_free(self);
+}
+
+/*
+ * Apply limits to a bucket, a full bucket is allowed to burst right away
+ */
+static void
+rate_bucket_configure (RateBucket* bucket, gdouble rate, guint burst, guint max_concurrent)
+{
+    // no tokens are taken without a rate, so such a bucket is full
+    if (bucket->rate == 0)
+        bucket->tokens = G_MAXDOUBLE;
+    bucket->rate = rate;
+    bucket->burst = MAX(burst, 1);
+    bucket->max_concurrent = max_concurrent;
+    bucket->tokens = MIN(bucket->tokens, bucket->burst);
+}
+
+/*
+ * Look up bucket of key, creating it with default limits. Lock must be held.
+ */
+static RateBucket*
+rate_limiter_get_bucket (GHbciRateLimiter* self, const gchar* key)
+{
+    RateBucket* bucket = g_hash_table_lookup(self->buckets, key);
+
+    if (bucket == NULL) {
+        bucket = g_new0(RateBucket, 1);
+        bucket->tokens = G_MAXDOUBLE;
+        bucket->last_refill = g_get_monotonic_time();
+        rate_bucket_configure(bucket, self->default_rate, self->default_burst, self->default_max_concurrent);
+        g_hash_table_insert(self->buckets, g_strdup(key), bucket);
+    }
+    return bucket;
+}
+
+static void
+rate_bucket_refill (RateBucket* bucket, gint64 now)
+{
+    if (bucket->rate > 0) {
+        bucket->tokens += (now - bucket->last_refill) * bucket->rate / G_USEC_PER_SEC;
+        bucket->tokens = MIN(bucket->tokens, bucket->burst);
+    }
+    bucket->last_refill = now;
+}
+
+void
+ghbci_rate_limiter_set_limit (GHbciRateLimiter* self, const gchar* key,
+        gdouble requests_per_second, guint burst, guint max_concurrent)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (requests_per_second >= 0);
+
+    g_mutex_lock(&self->lock);
+    if (key == NULL) {
+        GHashTableIter iter;
+        RateBucket* bucket;
+
+        self->default_rate = requests_per_second;
+        self->default_burst = burst;
+        self->default_max_concurrent = max_concurrent;
+
+        g_hash_table_iter_init(&iter, self->buckets);
+        while (g_hash_table_iter_next(&iter, NULL, (gpointer*)&bucket)) {
+            if (bucket->explicit)
+                continue;
+            rate_bucket_refill(bucket, g_get_monotonic_time());
+            rate_bucket_configure(bucket, requests_per_second, burst, max_concurrent);
+        }
+    } else {
+        RateBucket* bucket = rate_limiter_get_bucket(self, key);
+        rate_bucket_refill(bucket, g_get_monotonic_time());
+        rate_bucket_configure(bucket, requests_per_second, burst, max_concurrent);
+        bucket->explicit = TRUE;
+    }
+    g_cond_broadcast(&self->cond);
+    g_mutex_unlock(&self->lock);
+}
+
+/*
+ * Block until a request may be sent to key
+ */
+void
+ghbci_rate_limiter_acquire (GHbciRateLimiter* self, const gchar* key)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (key != NULL);
+
+    g_mutex_lock(&self->lock);
+    for (;;) {
+        RateBucket* bucket = rate_limiter_get_bucket(self, key);
+        gint64 now = g_get_monotonic_time();
+        gint64 wake_up = 0;
+
+        rate_bucket_refill(bucket, now);
+
+        if (bucket->blocked_until > now) {
+            wake_up = bucket->blocked_until;
+        } else if (bucket->rate > 0 && bucket->tokens < 1) {
+            wake_up = now + (gint64)((1 - bucket->tokens) * G_USEC_PER_SEC / bucket->rate) + 1;
+        } else if (bucket->max_concurrent == 0 || bucket->running < bucket->max_concurrent) {
+            if (bucket->rate > 0)
+                bucket->tokens -= 1;
+            bucket->running++;
+            break;
+        }
+
+        // wait for a token or a free slot (signalled by release)
+        if (wake_up > 0)
+            g_cond_wait_until(&self->cond, &self->lock, wake_up);
+        else
+            g_cond_wait(&self->cond, &self->lock);
+    }
+    g_mutex_unlock(&self->lock);
+}
+
+void
+ghbci_rate_limiter_release (GHbciRateLimiter* self, const gchar* key)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (key != NULL);
+
+    g_mutex_lock(&self->lock);
+    RateBucket* bucket = rate_limiter_get_bucket(self, key);
+    if (bucket->running > 0)
+        bucket->running--;
+    g_cond_broadcast(&self->cond);
+    g_mutex_unlock(&self->lock);
+}
+
+/*
+ * Hold back all requests to key for delay_usec, e.g. after the server
+ * signalled overload
+ */
+void
+ghbci_rate_limiter_penalize (GHbciRateLimiter* self, const gchar* key, gint64 delay_usec)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (key != NULL);
+
+    g_mutex_lock(&self->lock);
+    RateBucket* bucket = rate_limiter_get_bucket(self, key);
+    bucket->blocked_until = MAX(bucket->blocked_until, g_get_monotonic_time() + delay_usec);
+    // drain the burst, so requests resume at the configured pace
+    bucket->tokens = MIN(bucket->tokens, 0);
+    g_mutex_unlock(&self->lock);
+}
+
+
+// vim: sw=4 expandtab
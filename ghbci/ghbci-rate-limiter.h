@@ -0,0 +1,43 @@
+/*
+ * ghbci-rate-limiter.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_RATE_LIMITER_H__
+#define __GHBCI_RATE_LIMITER_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GHbciRateLimiter GHbciRateLimiter;
+
+GHbciRateLimiter* ghbci_rate_limiter_new            (void);
+
+void              ghbci_rate_limiter_free           (GHbciRateLimiter* self);
+
+void              ghbci_rate_limiter_set_limit      (GHbciRateLimiter* self, const gchar* key,
+                                                     gdouble requests_per_second, guint burst, guint max_concurrent);
+
+void              ghbci_rate_limiter_acquire        (GHbciRateLimiter* self, const gchar* key);
+
+void              ghbci_rate_limiter_release        (GHbciRateLimiter* self, const gchar* key);
+
+void              ghbci_rate_limiter_penalize       (GHbciRateLimiter* self, const gchar* key, gint64 delay_usec);
+
+G_END_DECLS
+
+#endif /* __GHBCI_RATE_LIMITER_H__ */
@@ -0,0 +1,458 @@
+/*
+ * ghbci-scheduler.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/**
+ * SECTION:ghbci-scheduler
+ * @short_description: Runs syncs of independent passports in parallel
+ *
+ * A #GHbciScheduler owns a bounded pool of worker threads attached to the
+ * java virtual machine of a #GHbciContext. Jobs are queued per passport
+ * (blz and userid) with ghbci_scheduler_push().
+ *
+ * Jobs of the same passport never run concurrently, because a hbci4java
+ * handler is not thread-safe. Passports with pending jobs are served round
+ * robin, so a passport with many queued jobs does not starve the others.
+ * Additionally the number of passports of the same bank synced at once can
+ * be limited with ghbci_scheduler_set_bank_limit().
+ *
+ * Each passport runs in its own java thread group, which gives it a private
+ * copy of the hbci4java configuration. Signals of the #GHbciContext are
+ * emitted in the worker thread running the job.
+ *
+ * Disposing the scheduler waits for the running jobs. A job may drop the
+ * last reference itself; its thread then stops after the job instead of
+ * being waited for.
+ **/
+
+#include <jni.h>
+#include <string.h>
+
+#include "ghbci-scheduler.h"
+#include "ghbci-context.h"
+#include "ghbci-context-private.h"
+
+#define GHBCI_SCHEDULER_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), \
+                                           GHBCI_TYPE_SCHEDULER, \
+                                           GHbciSchedulerPrivate))
+
+/* queued job */
+typedef struct
+{
+    GHbciSyncFunc func;
+    gpointer user_data;
+    GDestroyNotify notify;
+} SchedulerJob;
+
+/* per passport job queue */
+typedef struct
+{
+    gchar* blz;
+    gchar* userid;
+    GQueue jobs;
+    gboolean running;
+    gboolean ready;
+} SchedulerPassport;
+
+/* private data */
+struct _GHbciSchedulerPrivate
+{
+    GHbciContext* context;
+
+    GMutex lock;
+    GCond cond;
+    GPtrArray* workers;
+    gboolean shutdown;
+
+    guint default_bank_limit;
+    GHashTable* bank_limits;
+    GHashTable* bank_running;
+
+    GHashTable* passports;
+    GQueue ready;
+    guint pending;
+};
+
+/* the scheduler whose job runs in the current thread, cleared if the job disposes it */
+static GPrivate current_scheduler;
+
+static void     ghbci_scheduler_class_init         (GHbciSchedulerClass *class);
+static void     ghbci_scheduler_init               (GHbciScheduler *self);
+static void     ghbci_scheduler_finalize           (GObject *obj);
+static void     ghbci_scheduler_dispose            (GObject *obj);
+
+G_DEFINE_TYPE (GHbciScheduler, ghbci_scheduler, G_TYPE_OBJECT)
+
+
+static void
+ghbci_scheduler_class_init (GHbciSchedulerClass *class)
+{
+    GObjectClass *obj_class;
+
+    obj_class = G_OBJECT_CLASS (class);
+
+    obj_class->dispose = ghbci_scheduler_dispose;
+    obj_class->finalize = ghbci_scheduler_finalize;
+
+    /* add private structure */
+    g_type_class_add_private (obj_class, sizeof (GHbciSchedulerPrivate));
+}
+
+static void
+scheduler_passport_free (SchedulerPassport* passport)
+{
+    SchedulerJob* job;
+
+    while ((job = g_queue_pop_head(&passport->jobs)) != NULL) {
+        if (job->notify != NULL)
+            job->notify(job->user_data);
+        g_free(job);
+    }
+    g_free(passport->blz);
+    g_free(passport->userid);
+    g_free(passport);
+}
+
+static void
+ghbci_scheduler_init (GHbciScheduler *self)
+{
+    GHbciSchedulerPrivate *priv;
+
+    priv = GHBCI_SCHEDULER_GET_PRIVATE (self);
+    self->priv = priv;
+
+    priv->context = NULL;
+    g_mutex_init (&priv->lock);
+    g_cond_init (&priv->cond);
+    priv->workers = g_ptr_array_new ();
+    priv->shutdown = FALSE;
+
+    priv->default_bank_limit = 0;
+    priv->bank_limits  = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    priv->bank_running = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    priv->passports = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)scheduler_passport_free);
+    g_queue_init (&priv->ready);
+    priv->pending = 0;
+}
+
+static void
+ghbci_scheduler_dispose (GObject *obj)
+{
+    GHbciScheduler *self = GHBCI_SCHEDULER (obj);
+    GHbciSchedulerPrivate *priv = self->priv;
+    GThread* current = NULL;
+    guint i;
+
+    // a job can't wait for its own thread, which stops after the job
+    if (g_private_get(&current_scheduler) == self) {
+        g_private_set(&current_scheduler, NULL);
+        current = g_thread_self();
+    }
+
+    // let workers finish their current job and stop
+    g_mutex_lock(&priv->lock);
+    priv->shutdown = TRUE;
+    g_cond_broadcast(&priv->cond);
+    g_mutex_unlock(&priv->lock);
+
+    for (i = 0; i < priv->workers->len; i++) {
+        GThread* worker = g_ptr_array_index(priv->workers, i);
+        if (worker == current)
+            g_thread_unref(worker);
+        else
+            g_thread_join(worker);
+    }
+    g_ptr_array_set_size(priv->workers, 0);
+
+    g_queue_clear(&priv->ready);
+    g_hash_table_remove_all(priv->passports);
+
+    if (priv->context != NULL) {
+        g_object_unref(priv->context);
+        priv->context = NULL;
+    }
+
+    G_OBJECT_CLASS (ghbci_scheduler_parent_class)->dispose (obj);
+}
+
+static void
+ghbci_scheduler_finalize (GObject *obj)
+{
+    GHbciScheduler *self = GHBCI_SCHEDULER (obj);
+    GHbciSchedulerPrivate *priv = self->priv;
+
+    g_ptr_array_free(priv->workers, TRUE);
+    g_hash_table_unref(priv->bank_limits);
+    g_hash_table_unref(priv->bank_running);
+    g_hash_table_unref(priv->passports);
+    g_cond_clear(&priv->cond);
+    g_mutex_clear(&priv->lock);
+
+    G_OBJECT_CLASS (ghbci_scheduler_parent_class)->finalize (obj);
+}
+
+/*
+ * Check whether another passport of this bank may start, lock must be held
+ */
+static gboolean
+scheduler_bank_has_capacity (GHbciSchedulerPrivate* priv, const gchar* blz)
+{
+    guint limit = priv->default_bank_limit;
+    gpointer value;
+
+    if (g_hash_table_lookup_extended(priv->bank_limits, blz, NULL, &value))
+        limit = GPOINTER_TO_UINT(value);
+    if (limit == 0)
+        return TRUE;
+
+    return GPOINTER_TO_UINT(g_hash_table_lookup(priv->bank_running, blz)) < limit;
+}
+
+static void
+scheduler_bank_add_running (GHbciSchedulerPrivate* priv, const gchar* blz, gint delta)
+{
+    guint running = GPOINTER_TO_UINT(g_hash_table_lookup(priv->bank_running, blz));
+    g_hash_table_replace(priv->bank_running, g_strdup(blz), GUINT_TO_POINTER(running + delta));
+}
+
+/*
+ * Take the first ready passport whose bank has free capacity, lock must be held
+ */
+static SchedulerPassport*
+scheduler_next_passport (GHbciSchedulerPrivate* priv)
+{
+    GList* iter;
+
+    for (iter = priv->ready.head; iter != NULL; iter = iter->next) {
+        SchedulerPassport* passport = iter->data;
+        if (scheduler_bank_has_capacity(priv, passport->blz)) {
+            g_queue_delete_link(&priv->ready, iter);
+            passport->ready = FALSE;
+            return passport;
+        }
+    }
+    return NULL;
+}
+
+static gpointer
+scheduler_worker (gpointer data)
+{
+    GHbciScheduler* self = data;
+    GHbciSchedulerPrivate* priv = self->priv;
+
+    g_mutex_lock(&priv->lock);
+    while (!priv->shutdown) {
+        SchedulerPassport* passport = scheduler_next_passport(priv);
+        if (passport == NULL) {
+            g_cond_wait(&priv->cond, &priv->lock);
+            continue;
+        }
+
+        SchedulerJob* job = g_queue_pop_head(&passport->jobs);
+        passport->running = TRUE;
+        scheduler_bank_add_running(priv, passport->blz, 1);
+        g_mutex_unlock(&priv->lock);
+
+        // the job may dispose the scheduler and with it the passport
+        GHbciContext* context = g_object_ref(priv->context);
+        gchar* blz = g_strdup(passport->blz);
+        gchar* userid = g_strdup(passport->userid);
+        g_private_set(&current_scheduler, self);
+
+        // run job in the thread group of the passport
+        if (ghbci_context_attach_passport_thread(context, blz, userid) != NULL) {
+            job->func(context, blz, userid, job->user_data);
+            ghbci_context_detach_thread(context);
+        } else {
+            g_warning("could not attach worker for passport %s+%s", blz, userid);
+        }
+        if (job->notify != NULL)
+            job->notify(job->user_data);
+        g_free(job);
+
+        gboolean disposed = g_private_get(&current_scheduler) == NULL;
+        g_private_set(&current_scheduler, NULL);
+        g_free(userid);
+        g_free(blz);
+        g_object_unref(context);
+        if (disposed)
+            return NULL;
+
+        g_mutex_lock(&priv->lock);
+        passport->running = FALSE;
+        scheduler_bank_add_running(priv, passport->blz, -1);
+        priv->pending--;
+
+        // requeue at the end, so other passports get their turn first
+        if (!g_queue_is_empty(&passport->jobs)) {
+            passport->ready = TRUE;
+            g_queue_push_tail(&priv->ready, passport);
+        }
+        g_cond_broadcast(&priv->cond);
+    }
+    g_mutex_unlock(&priv->lock);
+
+    return NULL;
+}
+
+
+/* public methods */
+
+/**
+ * ghbci_scheduler_new: (constructor)
+ * @context: #GHbciContext used for all jobs
+ * @max_workers: number of worker threads
+ *
+ * Sets up a new #GHbciScheduler with a pool of @max_workers threads
+ *
+ * Returns: (transfer full): A New #GHbciScheduler
+ **/
+GHbciScheduler*
+ghbci_scheduler_new (GHbciContext* context, guint max_workers)
+{
+    GHbciScheduler* scheduler;
+    GHbciSchedulerPrivate* priv;
+    guint i;
+
+    g_return_val_if_fail (GHBCI_IS_CONTEXT (context), NULL);
+    g_return_val_if_fail (max_workers > 0, NULL);
+
+    scheduler = g_object_new (GHBCI_TYPE_SCHEDULER, NULL);
+    priv = scheduler->priv;
+    priv->context = g_object_ref (context);
+
+    for (i = 0; i < max_workers; i++) {
+        g_ptr_array_add(priv->workers, g_thread_new("ghbci-worker", scheduler_worker, scheduler));
+    }
+
+    return scheduler;
+}
+
+/**
+ * ghbci_scheduler_set_default_bank_limit:
+ * @self: The #GHbciScheduler
+ * @max_concurrent: maximum number of passports synced at once, 0 for no limit
+ *
+ * Set the limit for all banks without a limit of their own
+ **/
+void
+ghbci_scheduler_set_default_bank_limit (GHbciScheduler* self, guint max_concurrent)
+{
+    g_return_if_fail (GHBCI_IS_SCHEDULER (self));
+
+    g_mutex_lock(&self->priv->lock);
+    self->priv->default_bank_limit = max_concurrent;
+    g_cond_broadcast(&self->priv->cond);
+    g_mutex_unlock(&self->priv->lock);
+}
+
+/**
+ * ghbci_scheduler_set_bank_limit:
+ * @self: The #GHbciScheduler
+ * @blz: blz of the bank
+ * @max_concurrent: maximum number of passports synced at once, 0 for no limit
+ *
+ * Limit the number of passports of a bank synced concurrently
+ **/
+void
+ghbci_scheduler_set_bank_limit (GHbciScheduler* self, const gchar* blz, guint max_concurrent)
+{
+    g_return_if_fail (GHBCI_IS_SCHEDULER (self));
+    g_return_if_fail (blz != NULL);
+
+    g_mutex_lock(&self->priv->lock);
+    g_hash_table_replace(self->priv->bank_limits, g_strdup(blz), GUINT_TO_POINTER(max_concurrent));
+    g_cond_broadcast(&self->priv->cond);
+    g_mutex_unlock(&self->priv->lock);
+}
+
+/**
+ * ghbci_scheduler_push:
+ * @self: The #GHbciScheduler
+ * @blz: blz
+ * @userid: userid
+ * @func: (scope notified) (closure user_data) (destroy notify): job to run
+ * @user_data: data for @func
+ * @notify: called when @user_data is no longer needed
+ *
+ * Queue a job for a passport. Jobs of the same passport run in the order
+ * they were pushed, one at a time.
+ **/
+void
+ghbci_scheduler_push (GHbciScheduler* self, const gchar* blz, const gchar* userid,
+        GHbciSyncFunc func, gpointer user_data, GDestroyNotify notify)
+{
+    GHbciSchedulerPrivate* priv;
+    SchedulerPassport* passport;
+    SchedulerJob* job;
+
+    g_return_if_fail (GHBCI_IS_SCHEDULER (self));
+    g_return_if_fail (blz != NULL);
+    g_return_if_fail (userid != NULL);
+    g_return_if_fail (func != NULL);
+    priv = self->priv;
+
+    job = g_new0(SchedulerJob, 1);
+    job->func = func;
+    job->user_data = user_data;
+    job->notify = notify;
+
+    gchar* key = g_strconcat(blz, "+", userid, NULL);
+
+    g_mutex_lock(&priv->lock);
+    passport = g_hash_table_lookup(priv->passports, key);
+    if (passport == NULL) {
+        passport = g_new0(SchedulerPassport, 1);
+        passport->blz = g_strdup(blz);
+        passport->userid = g_strdup(userid);
+        g_queue_init(&passport->jobs);
+        g_hash_table_insert(priv->passports, key, passport);
+    } else {
+        g_free(key);
+    }
+
+    g_queue_push_tail(&passport->jobs, job);
+    priv->pending++;
+    if (!passport->running && !passport->ready) {
+        passport->ready = TRUE;
+        g_queue_push_tail(&priv->ready, passport);
+    }
+    g_cond_broadcast(&priv->cond);
+    g_mutex_unlock(&priv->lock);
+}
+
+/**
+ * ghbci_scheduler_wait:
+ * @self: The #GHbciScheduler
+ *
+ * Block until all queued jobs are done
+ **/
+void
+ghbci_scheduler_wait (GHbciScheduler* self)
+{
+    g_return_if_fail (GHBCI_IS_SCHEDULER (self));
+
+    g_mutex_lock(&self->priv->lock);
+    while (self->priv->pending > 0) {
+        g_cond_wait(&self->priv->cond, &self->priv->lock);
+    }
+    g_mutex_unlock(&self->priv->lock);
+}
+
+
+// vim: sw=4 expandtab
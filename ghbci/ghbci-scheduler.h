@@ -0,0 +1,83 @@
+/*
+ * ghbci-scheduler.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_SCHEDULER_H__
+#define __GHBCI_SCHEDULER_H__
+
+#include <glib.h>
+#include <glib-object.h>
+
+#include "ghbci-context.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GHbciScheduler GHbciScheduler;
+typedef struct _GHbciSchedulerClass GHbciSchedulerClass;
+typedef struct _GHbciSchedulerPrivate GHbciSchedulerPrivate;
+
+struct _GHbciScheduler
+{
+  GObject parent;
+
+  GHbciSchedulerPrivate *priv;
+};
+
+/**
+ * GHbciSchedulerClass:
+ **/
+struct _GHbciSchedulerClass
+{
+    GObjectClass parent_class;
+};
+
+#define GHBCI_TYPE_SCHEDULER           (ghbci_scheduler_get_type ())
+#define GHBCI_SCHEDULER(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), GHBCI_TYPE_SCHEDULER, GHbciScheduler))
+#define GHBCI_SCHEDULER_CLASS(obj)     (G_TYPE_CHECK_CLASS_CAST ((obj), GHBCI_TYPE_SCHEDULER, GHbciSchedulerClass))
+#define GHBCI_IS_SCHEDULER(obj)        (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GHBCI_TYPE_SCHEDULER))
+#define GHBCI_IS_SCHEDULER_CLASS(obj)  (G_TYPE_CHECK_CLASS_TYPE ((obj), GHBCI_TYPE_SCHEDULER))
+#define GHBCI_SCHEDULER_GET_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS ((obj), GHBCI_TYPE_SCHEDULER, GHbciSchedulerClass))
+
+
+/**
+ * GHbciSyncFunc:
+ * @context: the #GHbciContext
+ * @blz: blz of the passport
+ * @userid: userid of the passport
+ * @user_data: data passed to ghbci_scheduler_push()
+ *
+ * Job run by a #GHbciScheduler worker thread for a single passport
+ **/
+typedef void (*GHbciSyncFunc) (GHbciContext* context, const gchar* blz, const gchar* userid, gpointer user_data);
+
+GType             ghbci_scheduler_get_type                    (void) G_GNUC_CONST;
+
+GHbciScheduler*   ghbci_scheduler_new                         (GHbciContext* context, guint max_workers);
+
+void              ghbci_scheduler_set_default_bank_limit      (GHbciScheduler* self, guint max_concurrent);
+
+void              ghbci_scheduler_set_bank_limit              (GHbciScheduler* self, const gchar* blz, guint max_concurrent);
+
+void              ghbci_scheduler_push                        (GHbciScheduler* self, const gchar* blz, const gchar* userid,
+                                                               GHbciSyncFunc func, gpointer user_data, GDestroyNotify notify);
+
+void              ghbci_scheduler_wait                        (GHbciScheduler* self);
+
+
+G_END_DECLS
+
+#endif /* __GHBCI_SCHEDULER_H__ */
@@ -0,0 +1,33 @@
+/*
+ * ghbci-standing-order-private.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_STANDING_ORDER_PRIVATE_H__
+#define __GHBCI_STANDING_ORDER_PRIVATE_H__
+
+#include <glib.h>
+
+#include "ghbci-standing-order.h"
+
+gboolean            ghbci_parse_iso_date                      (const gchar* text, GDate* date);
+
+gchar*              ghbci_format_iso_date                     (const GDate* date);
+
+GHbciStandingOrder* ghbci_standing_order_new_from_result      (GHashTable* data, const gchar* prefix,
+                                                               GError** error);
+
+#endif /* __GHBCI_STANDING_ORDER_PRIVATE_H__ */
@@ -0,0 +1,274 @@
+/*
+ * ghbci-standing-order.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/**
+ * SECTION:ghbci-standing-order
+ * @short_description: Transfers the bank executes periodically
+ *
+ * A #GHbciStandingOrder is created at the bank with
+ * ghbci_context_create_standing_order() and listed with
+ * ghbci_context_get_standing_orders(). The bank executes it on its own, no
+ * client needs to be online at the due date.
+ **/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ghbci-standing-order.h"
+#include "ghbci-standing-order-private.h"
+#include "ghbci-transfer-private.h"
+#include "ghbci-error.h"
+#include "ghbci-error-private.h"
+
+
+G_DEFINE_BOXED_TYPE (GHbciStandingOrder, ghbci_standing_order, ghbci_standing_order_copy, ghbci_standing_order_free)
+
+
+static GDate*
+date_copy (const GDate* date)
+{
+    return date != NULL ? g_date_new_julian(g_date_get_julian(date)) : NULL;
+}
+
+static const gchar*
+lookup_field (GHashTable* data, const gchar* prefix, const gchar* name)
+{
+    gchar* key = g_strconcat(prefix, name, NULL);
+    const gchar* value = g_hash_table_lookup(data, key);
+
+    g_free(key);
+    return value;
+}
+
+
+/* private methods */
+
+/**
+ * ghbci_parse_iso_date:
+ * @text: date as hbci4java stores it, e.g. "2015-03-31"
+ * @date: date to set
+ *
+ * Returns: %TRUE if @text is a valid date
+ **/
+gboolean
+ghbci_parse_iso_date (const gchar* text, GDate* date)
+{
+    guint year, month, day;
+    gchar rest;
+
+    if (text == NULL || sscanf(text, "%4u-%2u-%2u%c", &year, &month, &day, &rest) != 3)
+        return FALSE;
+    if (!g_date_valid_dmy(day, month, year))
+        return FALSE;
+    g_date_set_dmy(date, day, month, year);
+    return TRUE;
+}
+
+/**
+ * ghbci_format_iso_date:
+ * @date: valid date
+ *
+ * Returns: (transfer full): @date in the format hbci4java expects for
+ *   job parameters
+ **/
+gchar*
+ghbci_format_iso_date (const GDate* date)
+{
+    return g_strdup_printf("%04u-%02u-%02u", g_date_get_year(date), g_date_get_month(date), g_date_get_day(date));
+}
+
+/**
+ * ghbci_standing_order_new_from_result:
+ * @data: result data of a DauerSEPAList job
+ * @prefix: prefix of the response segment, e.g. "content."
+ * @error: return location for a #GError
+ *
+ * Decode one standing order from the result data, the transfer is read
+ * from the pain document of the segment
+ *
+ * Returns: (transfer full) (nullable): the standing order or %NULL if the
+ *   segment is incomplete
+ **/
+GHbciStandingOrder*
+ghbci_standing_order_new_from_result (GHashTable* data, const gchar* prefix, GError** error)
+{
+    GHbciStandingOrder* self;
+    GDate date;
+
+    // binary data is stored as one character per byte
+    const gchar* pain = lookup_field(data, prefix, "sepapain");
+    if (pain == NULL) {
+        ghbci_set_error(error, GHBCI_ERROR_INVALID_DATA, NULL, GHBCI_RETRY_HINT_NEVER,
+                "standing order without pain document");
+        return NULL;
+    }
+    gsize pain_length;
+    gchar* pain_bytes = g_convert(pain, -1, "ISO-8859-1", "UTF-8", NULL, &pain_length, error);
+    if (pain_bytes == NULL)
+        return NULL;
+
+    self = g_new0(GHbciStandingOrder, 1);
+    if (!ghbci_transfer_read_pain001(pain_bytes, pain_length, &self->transfer, error)) {
+        g_free(pain_bytes);
+        ghbci_standing_order_free(self);
+        return NULL;
+    }
+    g_free(pain_bytes);
+
+    self->order_id = g_strdup(lookup_field(data, prefix, "orderid"));
+    g_date_clear(&date, 1);
+    if (ghbci_parse_iso_date(lookup_field(data, prefix, "DauerDetails.firstdate"), &date))
+        self->first_date = date_copy(&date);
+    if (ghbci_parse_iso_date(lookup_field(data, prefix, "DauerDetails.lastdate"), &date))
+        self->last_date = date_copy(&date);
+
+    const gchar* time_unit = lookup_field(data, prefix, "DauerDetails.timeunit");
+    self->time_unit = time_unit != NULL && *time_unit == 'W' ? GHBCI_TIME_UNIT_WEEKLY : GHBCI_TIME_UNIT_MONTHLY;
+    const gchar* turnus = lookup_field(data, prefix, "DauerDetails.turnus");
+    self->turnus = turnus != NULL ? g_ascii_strtoull(turnus, NULL, 10) : 1;
+    const gchar* exec_day = lookup_field(data, prefix, "DauerDetails.execday");
+    self->exec_day = exec_day != NULL ? g_ascii_strtoull(exec_day, NULL, 10) : 0;
+
+    return self;
+}
+
+
+/* public methods */
+
+/**
+ * ghbci_standing_order_copy:
+ * @self: The #GHbciStandingOrder
+ *
+ * Create a deep copy
+ *
+ * Returns: (transfer full): copy of @self
+ **/
+GHbciStandingOrder*
+ghbci_standing_order_copy (GHbciStandingOrder* self)
+{
+    GHbciStandingOrder* copy;
+
+    g_return_val_if_fail (self != NULL, NULL);
+
+    copy = g_new0(GHbciStandingOrder, 1);
+    copy->order_id = g_strdup(self->order_id);
+    copy->transfer.name = g_strdup(self->transfer.name);
+    copy->transfer.bic = g_strdup(self->transfer.bic);
+    copy->transfer.iban = g_strdup(self->transfer.iban);
+    copy->transfer.reference = g_strdup(self->transfer.reference);
+    copy->transfer.amount = g_strdup(self->transfer.amount);
+    copy->transfer.end_to_end_id = g_strdup(self->transfer.end_to_end_id);
+    copy->first_date = date_copy(self->first_date);
+    copy->last_date = date_copy(self->last_date);
+    copy->time_unit = self->time_unit;
+    copy->turnus = self->turnus;
+    copy->exec_day = self->exec_day;
+    return copy;
+}
+
+/**
+ * ghbci_standing_order_free:
+ * @self: The #GHbciStandingOrder
+ *
+ * Free a standing order returned by ghbci_context_get_standing_orders() or
+ * ghbci_standing_order_copy()
+ **/
+void
+ghbci_standing_order_free (GHbciStandingOrder* self)
+{
+    if (self == NULL)
+        return;
+
+    g_free(self->order_id);
+    g_free(self->transfer.name);
+    g_free(self->transfer.bic);
+    g_free(self->transfer.iban);
+    g_free(self->transfer.reference);
+    g_free(self->transfer.amount);
+    g_free(self->transfer.end_to_end_id);
+    if (self->first_date != NULL)
+        g_date_free(self->first_date);
+    if (self->last_date != NULL)
+        g_date_free(self->last_date);
+    g_free(self);
+}
+
+/**
+ * ghbci_standing_order_validate:
+ * @self: The #GHbciStandingOrder
+ * @error: return location for a #GError
+ *
+ * Check the transfer and the schedule of @self without contacting the
+ * bank. Fails with %GHBCI_ERROR_INVALID_DATA.
+ *
+ * Returns: %TRUE if @self is valid
+ **/
+gboolean
+ghbci_standing_order_validate (const GHbciStandingOrder* self, GError** error)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    if (!ghbci_transfer_validate(&self->transfer, error))
+        return FALSE;
+    if (self->first_date == NULL || !g_date_valid(self->first_date)) {
+        ghbci_set_error(error, GHBCI_ERROR_INVALID_DATA, NULL, GHBCI_RETRY_HINT_NEVER,
+                "standing order needs a first date");
+        return FALSE;
+    }
+    if (self->last_date != NULL
+            && (!g_date_valid(self->last_date) || g_date_compare(self->last_date, self->first_date) < 0)) {
+        ghbci_set_error(error, GHBCI_ERROR_INVALID_DATA, NULL, GHBCI_RETRY_HINT_NEVER,
+                "last date before first date");
+        return FALSE;
+    }
+
+    switch (self->time_unit) {
+    case GHBCI_TIME_UNIT_MONTHLY:
+        if (self->turnus < 1 || self->turnus > 12) {
+            ghbci_set_error(error, GHBCI_ERROR_INVALID_DATA, NULL, GHBCI_RETRY_HINT_NEVER,
+                    "monthly turnus must be 1 to 12: %u", self->turnus);
+            return FALSE;
+        }
+        if (self->exec_day < 1 || (self->exec_day > 31 && self->exec_day < 97) || self->exec_day > 99) {
+            ghbci_set_error(error, GHBCI_ERROR_INVALID_DATA, NULL, GHBCI_RETRY_HINT_NEVER,
+                    "invalid day of month: %u", self->exec_day);
+            return FALSE;
+        }
+        break;
+    case GHBCI_TIME_UNIT_WEEKLY:
+        if (self->turnus < 1 || self->turnus > 52) {
+            ghbci_set_error(error, GHBCI_ERROR_INVALID_DATA, NULL, GHBCI_RETRY_HINT_NEVER,
+                    "weekly turnus must be 1 to 52: %u", self->turnus);
+            return FALSE;
+        }
+        if (self->exec_day < 1 || self->exec_day > 7) {
+            ghbci_set_error(error, GHBCI_ERROR_INVALID_DATA, NULL, GHBCI_RETRY_HINT_NEVER,
+                    "invalid day of week: %u", self->exec_day);
+            return FALSE;
+        }
+        break;
+    default:
+        ghbci_set_error(error, GHBCI_ERROR_INVALID_DATA, NULL, GHBCI_RETRY_HINT_NEVER,
+                "invalid time unit: %d", self->time_unit);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+
+// vim: sw=4 expandtab
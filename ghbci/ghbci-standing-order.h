@@ -0,0 +1,80 @@
+/*
+ * ghbci-standing-order.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_STANDING_ORDER_H__
+#define __GHBCI_STANDING_ORDER_H__
+
+#include <glib.h>
+#include <glib-object.h>
+
+#include "ghbci-transfer.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GHbciStandingOrder GHbciStandingOrder;
+
+#define GHBCI_TYPE_STANDING_ORDER      (ghbci_standing_order_get_type ())
+
+/**
+ * GHbciTimeUnit:
+ * @GHBCI_TIME_UNIT_MONTHLY: every @turnus months
+ * @GHBCI_TIME_UNIT_WEEKLY: every @turnus weeks
+ *
+ * Unit of the interval of a #GHbciStandingOrder, the values are the codes
+ * of the HBCI specification
+ **/
+typedef enum {
+	GHBCI_TIME_UNIT_MONTHLY = 'M',
+	GHBCI_TIME_UNIT_WEEKLY = 'W',
+} GHbciTimeUnit;
+
+/**
+ * GHbciStandingOrder:
+ * @order_id: (nullable): id the bank assigned, %NULL for new orders
+ * @transfer: the transfer executed each time
+ * @first_date: date of the first execution
+ * @last_date: (nullable): date of the last execution, %NULL if unlimited
+ * @time_unit: unit of the interval
+ * @turnus: interval in @time_unit, 1 to 12 months or 1 to 52 weeks
+ * @exec_day: day of the month (1 to 31, 97 to 99 for the last days of the
+ *   month) or day of the week (1 is monday) of the execution
+ *
+ * A standing order, a transfer the bank executes periodically
+ **/
+struct _GHbciStandingOrder
+{
+    gchar* order_id;
+    GHbciTransfer transfer;
+    GDate* first_date;
+    GDate* last_date;
+    GHbciTimeUnit time_unit;
+    guint turnus;
+    guint exec_day;
+};
+
+GType               ghbci_standing_order_get_type             (void) G_GNUC_CONST;
+
+GHbciStandingOrder* ghbci_standing_order_copy                 (GHbciStandingOrder* self);
+
+void                ghbci_standing_order_free                 (GHbciStandingOrder* self);
+
+gboolean            ghbci_standing_order_validate             (const GHbciStandingOrder* self, GError** error);
+
+G_END_DECLS
+
+#endif /* __GHBCI_STANDING_ORDER_H__ */
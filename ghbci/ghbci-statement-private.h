@@ -23,7 +23,67 @@
 #include <glib-object.h>
 #include <jni.h>
 
-GHbciStatement* ghbci_statement_new_with_jobject (GHbciContext* context, jobject jobj);
+#include "ghbci-statement.h"
+#include "ghbci-context.h"
+#include "ghbci-string-pool-private.h"
+#include "ghbci-jstring-private.h"
+
+/* g_date_get_julian() of 1970-01-01 */
+#define GHBCI_UNIX_EPOCH_JULIAN     719163
+
+/* private data */
+struct _GHbciStatementPrivate
+{
+    GMainContext *glib_context;
+
+    jobject statement_jobj;
+    JNIEnv* jni_env;
+    GHbciContext* context;
+
+    /* julian days, 0 if not set */
+    guint32 valuta;
+    guint32 booking_date;
+    gchar* value;
+    gchar* saldo;
+    gchar* reference;
+    gchar* other_iban;
+    gchar* eref;
+    gchar* mref;
+    gchar* cred;
+
+    /* fields with few distinct values, owned by pool */
+    GHbciStringPool* pool;
+    const gchar* gv_code;
+    const gchar* other_name;
+    const gchar* other_bic;
+    const gchar* transaction_type;
+    guint gv_code_id;
+    guint other_name_id;
+    guint other_bic_id;
+    guint transaction_type_id;
+};
+
+/*
+ * Receives each statement as soon as it is parsed, takes ownership
+ */
+typedef void (*GHbciStatementFunc) (GHbciStatement* statement, gpointer user_data);
+
+/*
+ * Strings only needed while converting jobj go to arena, the caller resets
+ * it between statements
+ */
+GHbciStatement* ghbci_statement_new_with_jobject (GHbciContext* context, GHbciStringPool* pool, jobject jobj,
+                                                 GHbciJStringArena* arena);
+GHbciStatement* ghbci_statement_new_native (GHbciStringPool* pool, guint32 valuta, guint32 booking_date,
+        gchar* value, gchar* saldo, gchar* gv_code, gchar* transaction_type, gchar* other_name, gchar* other_iban,
+        gchar* other_bic, gchar* usage);
+GHbciStatement* ghbci_statement_new_structured (GHbciStringPool* pool, guint32 valuta, guint32 booking_date,
+        gchar* value, gchar* saldo, gchar* gv_code, gchar* transaction_type, gchar* other_name, gchar* other_iban,
+        gchar* other_bic, gchar* reference, gchar* eref, gchar* mref, gchar* cred);
+gchar* ghbci_statement_format_amount (gint64 cents, const gchar* currency);
+guint32 ghbci_statement_pack_date (guint day, guint month, guint year);
+guint32 ghbci_statement_pack_java_time (GTimeZone* zone, gint64 millis);
+const GDate* ghbci_statement_date_view (guint32 date, GDate* view);
 void ghbci_statement_remove_newlines (gchar* str);
 
 #endif /* __GHBCI_STATEMENT_PRIVATE_H__ */
@@ -41,30 +41,6 @@
                                            GHBCI_TYPE_STATEMENT, \
                                            GHbciStatementPrivate))
 
-/* private data */
-struct _GHbciStatementPrivate
-{
-    GMainContext *glib_context;
-
-    jobject statement_jobj;
-    JNIEnv* jni_env;
-    GHbciContext* context;
-
-    GDate* valuta;
-    GDate* booking_date;
-    gchar* value;
-    gchar* saldo;
-    gchar* gv_code;
-    gchar* reference;
-    gchar* other_name;
-    gchar* other_bic;
-    gchar* other_iban;
-    gchar* transaction_type;
-    gchar* eref;
-    gchar* mref;
-    gchar* cred;
-};
-
 /* properties */
 enum
 {
@@ -100,6 +76,41 @@ static void     ghbci_statement_get_property       (GObject *obj,
 G_DEFINE_TYPE (GHbciStatement, ghbci_statement, G_TYPE_OBJECT)
 
 
+/*
+ * Statements created without a pool, like by g_object_new(), get their own,
+ * just large enough for a few short values
+ */
+static GHbciStringPool*
+statement_pool (GHbciStatementPrivate* priv)
+{
+    if (priv->pool == NULL)
+        priv->pool = ghbci_string_pool_new_sized(64);
+    return priv->pool;
+}
+
+static void
+set_pooled (GHbciStatementPrivate* priv, const gchar** location, guint* id, const gchar* value)
+{
+    *location = ghbci_string_pool_intern(statement_pool(priv), value, id);
+}
+
+/*
+ * Like set_pooled(), frees value
+ */
+static void
+take_pooled (GHbciStatementPrivate* priv, const gchar** location, guint* id, gchar* value)
+{
+    set_pooled(priv, location, id, value);
+    g_free(value);
+}
+
+static guint32
+pack_gdate (const GDate* date)
+{
+    return date != NULL && g_date_valid(date) ? g_date_get_julian(date) : 0;
+}
+
+
 static void
 ghbci_statement_class_init (GHbciStatementClass *class)
 {
@@ -293,19 +304,24 @@ ghbci_statement_init (GHbciStatement *self)
     priv = GHBCI_STATEMENT_GET_PRIVATE (self);
     self->priv = priv;
 
-    priv->valuta = NULL;
-    priv->booking_date = NULL;
+    priv->valuta = 0;
+    priv->booking_date = 0;
     priv->value = NULL;
     priv->saldo = NULL;
-    priv->gv_code = NULL;
     priv->reference = NULL;
-    priv->other_name = NULL;
-    priv->other_bic = NULL;
     priv->other_iban = NULL;
-    priv->transaction_type = NULL;
     priv->eref = NULL;
     priv->mref = NULL;
     priv->cred = NULL;
+    priv->pool = NULL;
+    priv->gv_code = NULL;
+    priv->other_name = NULL;
+    priv->other_bic = NULL;
+    priv->transaction_type = NULL;
+    priv->gv_code_id = 0;
+    priv->other_name_id = 0;
+    priv->other_bic_id = 0;
+    priv->transaction_type_id = 0;
 }
 
 static void
@@ -316,19 +332,15 @@ ghbci_statement_dispose (GObject *obj)
     GHbciStatement *self = GHBCI_STATEMENT (obj);
     priv = GHBCI_STATEMENT_GET_PRIVATE (self);
 
-    g_free(priv->valuta);
-    g_free(priv->booking_date);
     g_free(priv->value);
     g_free(priv->saldo);
-    g_free(priv->gv_code);
     g_free(priv->reference);
-    g_free(priv->other_name);
-    g_free(priv->other_bic);
     g_free(priv->other_iban);
-    g_free(priv->transaction_type);
     g_free(priv->eref);
     g_free(priv->mref);
     g_free(priv->cred);
+    // the pooled fields go with the pool
+    g_clear_pointer(&priv->pool, ghbci_string_pool_unref);
 
     G_OBJECT_CLASS (ghbci_statement_parent_class)->dispose (obj);
 }
@@ -356,13 +368,11 @@ ghbci_statement_set_property (GObject      *obj,
     switch (prop_id)
     {
     case PROP_VALUTA:
-        g_free (priv->valuta);
-        priv->valuta = g_value_dup_boxed (value);
+        priv->valuta = pack_gdate (g_value_get_boxed (value));
         break;
 
     case PROP_BOOKING_DATE:
-        g_free (priv->booking_date);
-        priv->booking_date = g_value_dup_boxed (value);
+        priv->booking_date = pack_gdate (g_value_get_boxed (value));
         break;
 
     case PROP_VALUE:
@@ -381,13 +391,11 @@ ghbci_statement_set_property (GObject      *obj,
         break;
 
     case PROP_GV_CODE:
-        g_free (priv->gv_code);
-        priv->gv_code = g_value_dup_string (value);
+        set_pooled (priv, &priv->gv_code, &priv->gv_code_id, g_value_get_string (value));
         break;
 
     case PROP_OTHER_NAME:
-        g_free (priv->other_name);
-        priv->other_name = g_value_dup_string (value);
+        set_pooled (priv, &priv->other_name, &priv->other_name_id, g_value_get_string (value));
         break;
 
     case PROP_OTHER_IBAN:
@@ -396,13 +404,11 @@ ghbci_statement_set_property (GObject      *obj,
         break;
 
     case PROP_OTHER_BIC:
-        g_free (priv->other_bic);
-        priv->other_bic = g_value_dup_string (value);
+        set_pooled (priv, &priv->other_bic, &priv->other_bic_id, g_value_get_string (value));
         break;
 
     case PROP_TRANSACTION_TYPE:
-        g_free (priv->transaction_type);
-        priv->transaction_type = g_value_dup_string (value);
+        set_pooled (priv, &priv->transaction_type, &priv->transaction_type_id, g_value_get_string (value));
         break;
 
     case PROP_EREF:
@@ -434,6 +440,7 @@ ghbci_statement_get_property (GObject    *obj,
 {
     GHbciStatement *self;
     GHbciStatementPrivate *priv;
+    GDate date;
 
     self = GHBCI_STATEMENT (obj);
     priv = GHBCI_STATEMENT_GET_PRIVATE (self);
@@ -441,11 +448,11 @@ ghbci_statement_get_property (GObject    *obj,
     switch (prop_id)
     {
     case PROP_VALUTA:
-        g_value_set_boxed (value, priv->valuta);
+        g_value_set_boxed (value, ghbci_statement_date_view (priv->valuta, &date));
         break;
 
     case PROP_BOOKING_DATE:
-        g_value_set_boxed (value, priv->booking_date);
+        g_value_set_boxed (value, ghbci_statement_date_view (priv->booking_date, &date));
         break;
 
     case PROP_VALUE:
@@ -498,24 +505,36 @@ ghbci_statement_get_property (GObject    *obj,
     }
 }
 
-gchar* ghbci_statement_jstring_to_cstring(JNIEnv* jni_env, jstring jstr)
+/*
+ * Pool a java string, copied to arena only
+ */
+static void
+set_pooled_jstring (GHbciStatementPrivate* priv, JNIEnv* jni_env, GHbciJStringArena* arena,
+        const gchar** location, guint* id, jstring jstr)
 {
-    gchar* c_string;
-    const char* native_string;
-
-    if (jstr == NULL) {
-        return NULL;
-    }
+    set_pooled(priv, location, id, ghbci_jstring_arena_copy(arena, jni_env, jstr));
+}
 
-    native_string = (*jni_env)->GetStringUTFChars(jni_env, jstr, 0);
-    c_string = g_strdup(native_string);
-    (*jni_env)->ReleaseStringUTFChars(jni_env, jstr, native_string);
+/*
+ * Date field of a java object, with one call
+ */
+static guint32
+get_java_date (GHbciContext* context, JNIEnv* jni_env, jobject jobj, jfieldID field)
+{
+    jobject jdate = (*jni_env)->GetObjectField(jni_env, jobj, field);
+    guint32 date = 0;
 
-    return c_string;
+    if (jdate != NULL) {
+        jlong millis = (*jni_env)->CallLongMethod(jni_env, jdate, context->priv->method_Date_getTime);
+        date = ghbci_statement_pack_java_time(context->priv->time_zone, millis);
+        (*jni_env)->DeleteLocalRef(jni_env, jdate);
+    }
+    return date;
 }
 
 GHbciStatement*
-ghbci_statement_new_with_jobject (GHbciContext* context, jobject jstatement)
+ghbci_statement_new_with_jobject (GHbciContext* context, GHbciStringPool* pool, jobject jstatement,
+        GHbciJStringArena* arena)
 {
     GHbciStatement* statement;
     GHbciStatementPrivate* priv;
@@ -523,32 +542,22 @@ ghbci_statement_new_with_jobject (GHbciContext* context, jobject jstatement)
 
     statement = g_object_new (GHBCI_TYPE_STATEMENT, NULL);
     priv = statement->priv;
-    jni_env = context->priv->jni_env;
-
-    jobject jvaluta = (*jni_env)->GetObjectField(jni_env, jstatement, context->priv->field_GVRKUmsUmsLine_valuta);
-    jint jdate = (*jni_env)->CallIntMethod(jni_env, jvaluta, context->priv->method_Date_getDate);
-    jint jmonth = (*jni_env)->CallIntMethod(jni_env, jvaluta, context->priv->method_Date_getMonth) + 1;
-    jint jyear = (*jni_env)->CallIntMethod(jni_env, jvaluta, context->priv->method_Date_getYear) + 1900;
-    priv->valuta = g_date_new_dmy(jdate, jmonth, jyear);
-    (*jni_env)->DeleteLocalRef(jni_env, jvaluta);
-
-    jobject jbdate = (*jni_env)->GetObjectField(jni_env, jstatement, context->priv->field_GVRKUmsUmsLine_bdate);
-    jdate = (*jni_env)->CallIntMethod(jni_env, jbdate, context->priv->method_Date_getDate);
-    jmonth = (*jni_env)->CallIntMethod(jni_env, jbdate, context->priv->method_Date_getMonth) + 1;
-    jyear = (*jni_env)->CallIntMethod(jni_env, jbdate, context->priv->method_Date_getYear) + 1900;
-    priv->booking_date = g_date_new_dmy(jdate, jmonth, jyear);
-    (*jni_env)->DeleteLocalRef(jni_env, jbdate);
+    priv->pool = pool != NULL ? ghbci_string_pool_ref(pool) : NULL;
+    jni_env = ghbci_context_get_jni_env (context);
+
+    priv->valuta = get_java_date(context, jni_env, jstatement, context->priv->field_GVRKUmsUmsLine_valuta);
+    priv->booking_date = get_java_date(context, jni_env, jstatement, context->priv->field_GVRKUmsUmsLine_bdate);
 
     jobject jvalue        = (*jni_env)->GetObjectField(jni_env, jstatement, context->priv->field_GVRKUmsUmsLine_value);
     jobject jvalue_string = (*jni_env)->CallObjectMethod(jni_env, jvalue, context->priv->method_Value_toString);
-    priv->value = ghbci_statement_jstring_to_cstring(jni_env, jvalue_string);
+    priv->value = ghbci_jstring_dup(jni_env, jvalue_string);
     (*jni_env)->DeleteLocalRef(jni_env, jvalue_string);
     (*jni_env)->DeleteLocalRef(jni_env, jvalue);
 
     jobject jsaldo        = (*jni_env)->GetObjectField(jni_env, jstatement, context->priv->field_GVRKUmsUmsLine_saldo);
     jobject jsaldo_value  = (*jni_env)->GetObjectField(jni_env, jsaldo, context->priv->field_Saldo_value);
     jobject jsaldo_string = (*jni_env)->CallObjectMethod(jni_env, jsaldo_value, context->priv->method_Value_toString);
-    priv->saldo = ghbci_statement_jstring_to_cstring(jni_env, jsaldo_string);
+    priv->saldo = ghbci_jstring_dup(jni_env, jsaldo_string);
     (*jni_env)->DeleteLocalRef(jni_env, jsaldo_string);
     (*jni_env)->DeleteLocalRef(jni_env, jsaldo_value);
     (*jni_env)->DeleteLocalRef(jni_env, jsaldo);
@@ -563,17 +572,15 @@ ghbci_statement_new_with_jobject (GHbciContext* context, jobject jstatement)
             break;
         }
 
-        const char* usage_line = (*jni_env)->GetStringUTFChars(jni_env, jusage_line, 0);
-
-        g_string_append(reference, usage_line);
+        // copied right behind the previous line
+        gsize length = ghbci_jstring_append(reference, jni_env, jusage_line);
 
-        if (strlen(usage_line) < 27) {
+        if (length < 27) {
             g_string_append(reference, " ");
         }
 
         g_string_append(reference, "\n");
 
-        (*jni_env)->ReleaseStringUTFChars(jni_env, jusage_line, usage_line);
         (*jni_env)->DeleteLocalRef(jni_env, jusage_line);
     }
     priv->reference = g_string_free(reference, FALSE);
@@ -581,35 +588,33 @@ ghbci_statement_new_with_jobject (GHbciContext* context, jobject jstatement)
     (*jni_env)->DeleteLocalRef(jni_env, jusage);
     
     jstring jgv_code = (*jni_env)->GetObjectField(jni_env, jstatement, context->priv->field_GVRKUmsUmsLine_gvcode);
-    priv->gv_code = ghbci_statement_jstring_to_cstring(jni_env, jgv_code);
+    set_pooled_jstring(priv, jni_env, arena, &priv->gv_code, &priv->gv_code_id, jgv_code);
     (*jni_env)->DeleteLocalRef(jni_env, jgv_code);
 
     jobject other = (*jni_env)->GetObjectField(jni_env, jstatement, context->priv->field_GVRKUmsUmsLine_other);
     if (other != NULL) {
         jstring jname = (*jni_env)->GetObjectField(jni_env, other, context->priv->field_Konto_name);
         jstring jname2 = (*jni_env)->GetObjectField(jni_env, other, context->priv->field_Konto_name2);
-        gchar* name = ghbci_statement_jstring_to_cstring(jni_env, jname);
-        gchar* name2 = ghbci_statement_jstring_to_cstring(jni_env, jname2);
+        const gchar* name = ghbci_jstring_arena_copy(arena, jni_env, jname);
+        const gchar* name2 = ghbci_jstring_arena_copy(arena, jni_env, jname2);
         (*jni_env)->DeleteLocalRef(jni_env, jname2);
         (*jni_env)->DeleteLocalRef(jni_env, jname);
 
-        priv->other_name = g_strconcat(name, name2, NULL);
-        g_free(name);
-        g_free(name2);
+        take_pooled(priv, &priv->other_name, &priv->other_name_id, g_strconcat(name, name2, NULL));
 
         jstring jiban = (*jni_env)->GetObjectField(jni_env, other, context->priv->field_Konto_number);
-        priv->other_iban = ghbci_statement_jstring_to_cstring(jni_env, jiban);
+        priv->other_iban = ghbci_jstring_dup(jni_env, jiban);
         (*jni_env)->DeleteLocalRef(jni_env, jiban);
 
         jstring jbic = (*jni_env)->GetObjectField(jni_env, other, context->priv->field_Konto_blz);
-        priv->other_bic = ghbci_statement_jstring_to_cstring(jni_env, jbic);
+        set_pooled_jstring(priv, jni_env, arena, &priv->other_bic, &priv->other_bic_id, jbic);
         (*jni_env)->DeleteLocalRef(jni_env, jbic);
 
         (*jni_env)->DeleteLocalRef(jni_env, other);
     }
 
     jstring jtransaction_type = (*jni_env)->GetObjectField(jni_env, jstatement, context->priv->field_GVRKUmsUmsLine_text);
-    priv->transaction_type = ghbci_statement_jstring_to_cstring(jni_env, jtransaction_type);
+    set_pooled_jstring(priv, jni_env, arena, &priv->transaction_type, &priv->transaction_type_id, jtransaction_type);
     (*jni_env)->DeleteLocalRef(jni_env, jtransaction_type);
 
     return statement;
@@ -631,103 +636,290 @@ ghbci_statement_remove_newlines(gchar* str)
     str[i - skipped] = str[i];
 }
 
+/*
+ * SEPA fields preceding the actual reference, see take_reference()
+ */
+static const gchar* const sepa_fields[] = { "EREF+", "MREF+", "CRED+", "SVWZ+" };
+
+/* fields appended to the reference by Volksbanks, like "EREF: 42" */
+static const gchar* const appended_fields[] = { "EREF:", "MREF:", "CRED:", "IBAN:", "BIC:" };
+
+static gchar**
+sepa_field_location (GHbciStatementPrivate* priv, const gchar* field)
+{
+    if (g_str_has_prefix(field, "EREF"))
+        return &priv->eref;
+    if (g_str_has_prefix(field, "MREF"))
+        return &priv->mref;
+    if (g_str_has_prefix(field, "CRED"))
+        return &priv->cred;
+    if (g_str_has_prefix(field, "IBAN"))
+        return &priv->other_iban;
+    return NULL;
+}
+
+static void
+set_field (GHbciStatementPrivate* priv, const gchar* field, const gchar* value, gsize length)
+{
+    gchar* stripped = g_strstrip(g_strndup(value, length));
+    gchar** location;
+
+    if (g_str_has_prefix(field, "BIC")) {
+        take_pooled(priv, &priv->other_bic, &priv->other_bic_id, stripped);
+        return;
+    }
+    location = sepa_field_location(priv, field);
+    g_free(*location);
+    *location = stripped;
+}
+
+/*
+ * Start of the next SEPA field in reference, or its end
+ */
+static gchar*
+next_sepa_field (gchar* reference)
+{
+    gchar* next = reference + strlen(reference);
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(sepa_fields); i++) {
+        gchar* field = strstr(reference, sepa_fields[i]);
+        if (field != NULL && field < next)
+            next = field;
+    }
+    return next;
+}
+
+/*
+ * Set the reference, without newlines, and split off the SEPA fields:
+ * leading "EREF+", "MREF+" and "CRED+" fields up to "SVWZ+" with the
+ * actual reference (ING DiBa), or "EREF: " style fields at its end
+ * (Volksbank). Takes ownership of reference.
+ */
+static void
+take_reference (GHbciStatement* self, gchar* reference)
+{
+    GHbciStatementPrivate* priv = self->priv;
+    gchar* start = reference;
+
+    while (g_str_has_prefix(start, "EREF+") || g_str_has_prefix(start, "MREF+")
+            || g_str_has_prefix(start, "CRED+")) {
+        gchar* end = next_sepa_field(start + 5);
+        set_field(priv, start, start + 5, end - start - 5);
+        start = end;
+    }
+    // always last field
+    if (g_str_has_prefix(start, "SVWZ+"))
+        start += 5;
+    memmove(reference, start, strlen(start) + 1);
+    g_strstrip(reference);
+
+    // "KEY: value" pairs, from the end
+    for (;;) {
+        gchar* value = strrchr(reference, ' ');
+        gchar* key;
+        guint i;
+
+        if (value == NULL)
+            break;
+        *value = '\0';
+        key = strrchr(reference, ' ');
+        key = key != NULL ? key + 1 : reference;
+        for (i = 0; i < G_N_ELEMENTS(appended_fields); i++) {
+            if (strcmp(key, appended_fields[i]) == 0)
+                break;
+        }
+        if (i == G_N_ELEMENTS(appended_fields)) {
+            *value = ' ';
+            break;
+        }
+        set_field(priv, key, value + 1, strlen(value + 1));
+        *(key > reference ? key - 1 : key) = '\0';
+    }
+
+    g_free(priv->reference);
+    priv->reference = reference;
+}
+
+/*
+ * Create a statement parsed natively, takes ownership of all arguments but
+ * pool, which may be NULL. usage is the reference without newlines, its
+ * SEPA fields are split off.
+ */
+GHbciStatement*
+ghbci_statement_new_native (GHbciStringPool* pool, guint32 valuta, guint32 booking_date, gchar* value, gchar* saldo,
+        gchar* gv_code, gchar* transaction_type, gchar* other_name, gchar* other_iban, gchar* other_bic,
+        gchar* usage)
+{
+    GHbciStatement* statement = g_object_new (GHBCI_TYPE_STATEMENT, NULL);
+    GHbciStatementPrivate* priv = statement->priv;
+
+    priv->pool = pool != NULL ? ghbci_string_pool_ref(pool) : NULL;
+    priv->valuta = valuta;
+    priv->booking_date = booking_date;
+    priv->value = value;
+    priv->saldo = saldo;
+    take_pooled(priv, &priv->gv_code, &priv->gv_code_id, gv_code);
+    take_pooled(priv, &priv->transaction_type, &priv->transaction_type_id, transaction_type);
+    take_pooled(priv, &priv->other_name, &priv->other_name_id, other_name);
+    priv->other_iban = other_iban;
+    take_pooled(priv, &priv->other_bic, &priv->other_bic_id, other_bic);
+    take_reference(statement, usage);
+    return statement;
+}
+
+/*
+ * Create a statement from fields the bank delivered separately, takes
+ * ownership of all arguments but pool, which may be NULL. Nothing is split
+ * off the reference.
+ */
+GHbciStatement*
+ghbci_statement_new_structured (GHbciStringPool* pool, guint32 valuta, guint32 booking_date, gchar* value,
+        gchar* saldo, gchar* gv_code, gchar* transaction_type, gchar* other_name, gchar* other_iban,
+        gchar* other_bic, gchar* reference, gchar* eref, gchar* mref, gchar* cred)
+{
+    GHbciStatement* statement = g_object_new (GHBCI_TYPE_STATEMENT, NULL);
+    GHbciStatementPrivate* priv = statement->priv;
+
+    priv->pool = pool != NULL ? ghbci_string_pool_ref(pool) : NULL;
+    priv->valuta = valuta;
+    priv->booking_date = booking_date;
+    priv->value = value;
+    priv->saldo = saldo;
+    take_pooled(priv, &priv->gv_code, &priv->gv_code_id, gv_code);
+    take_pooled(priv, &priv->transaction_type, &priv->transaction_type_id, transaction_type);
+    take_pooled(priv, &priv->other_name, &priv->other_name_id, other_name);
+    priv->other_iban = other_iban;
+    take_pooled(priv, &priv->other_bic, &priv->other_bic_id, other_bic);
+    priv->reference = reference;
+    priv->eref = eref;
+    priv->mref = mref;
+    priv->cred = cred;
+    return statement;
+}
+
+/*
+ * Amounts are formatted like hbci4java's Value.toString()
+ */
+gchar*
+ghbci_statement_format_amount (gint64 cents, const gchar* currency)
+{
+    guint64 absolute = cents < 0 ? -(guint64)cents : (guint64)cents;
+
+    return g_strdup_printf("%s%" G_GUINT64_FORMAT ".%02u %s", cents < 0 ? "-" : "",
+            absolute / 100, (guint)(absolute % 100), currency);
+}
+
+/*
+ * Dates are stored as julian days, 0 if not set. This packs a date, 0 if it
+ * is not valid.
+ */
+guint32
+ghbci_statement_pack_date (guint day, guint month, guint year)
+{
+    GDate date;
+
+    if (!g_date_valid_dmy(day, month, year))
+        return 0;
+    g_date_clear(&date, 1);
+    g_date_set_dmy(&date, day, month, year);
+    return g_date_get_julian(&date);
+}
+
+/*
+ * Day of a java.util.Date in zone, Europe/Berlin for hbci4java's dates.
+ * Only the offset of zone at that time is looked up, nothing is allocated.
+ */
+guint32
+ghbci_statement_pack_java_time (GTimeZone* zone, gint64 millis)
+{
+    gint64 seconds = millis / 1000 - (millis % 1000 < 0 ? 1 : 0);
+    gint interval = g_time_zone_find_interval(zone, G_TIME_TYPE_UNIVERSAL, seconds);
+    gint64 local = seconds + g_time_zone_get_offset(zone, interval);
+    gint64 days = local / 86400 - (local % 86400 < 0 ? 1 : 0);
+
+    if (days + GHBCI_UNIX_EPOCH_JULIAN < 1 || days + GHBCI_UNIX_EPOCH_JULIAN > G_MAXINT32)
+        return 0;
+    return days + GHBCI_UNIX_EPOCH_JULIAN;
+}
+
+/*
+ * A date as GDate in view, returns NULL if it is not set
+ */
+const GDate*
+ghbci_statement_date_view (guint32 date, GDate* view)
+{
+    if (date == 0)
+        return NULL;
+    g_date_clear(view, 1);
+    g_date_set_julian(view, date);
+    return view;
+}
+
+/**
+ * ghbci_statement_prettify_statement:
+ * @statement: a #GHbciStatement
+ *
+ * Remove newlines from the reference and move its SEPA fields to the
+ * properties, like #GHbciStatement:eref. Statements parsed with
+ * ghbci_context_set_native_mt940() are prettified already.
+ **/
 void
 ghbci_statement_prettify_statement (GObject* statement)
 {
     gchar *reference;
+
+    g_return_if_fail (GHBCI_IS_STATEMENT (statement));
+
     g_object_get(statement,
                  "reference", &reference,
                  NULL);
+    if (reference == NULL)
+        return;
 
-    // extract SEPA fields from reference (ING DiBa)
-    while (reference[4] == '+') {
-        if (g_str_has_prefix(reference, "EREF+")
-                || g_str_has_prefix(reference, "MREF+")
-                || g_str_has_prefix(reference, "CRED+")) {
-
-            // detemine field size
-            gint end = 4;
-            while (reference[end] != '\n')
-                ++end;
-            ++end;
-            while (reference[end] != '\n')
-                ++end;
-
-            gchar* value = g_strndup(reference + 5, end - 5);
-            ghbci_statement_remove_newlines(value);
-            g_strstrip(value);
-
-            // save field
-            if (g_str_has_prefix(reference, "EREF+"))
-                g_object_set(statement, "eref", value, NULL);
-            else if (g_str_has_prefix(reference, "MREF+"))
-                g_object_set(statement, "mref", value, NULL);
-            else if (g_str_has_prefix(reference, "CRED+"))
-                g_object_set(statement, "cred", value, NULL);
-            g_free(value);
-
-            // remove field
-            memmove(reference, reference + end + 1, strlen(reference + end + 1) + 1);
-
-        } else if (g_str_has_prefix(reference, "SVWZ+")) {
-            // always last field
-            memmove(reference, reference + 5, strlen(reference + 5) + 1);
-            // remove newlines, they never make sense in SEPA fields
-            ghbci_statement_remove_newlines(reference);
-            break;
+    ghbci_statement_remove_newlines(reference);
 
-        } else {
-            // doesn't seem to be a SEPA field, don't look for further fields
-            break;
-        }
-    }
+    g_object_freeze_notify(statement);
+    take_reference(GHBCI_STATEMENT(statement), reference);
+    g_object_notify(statement, "reference");
+    g_object_notify(statement, "eref");
+    g_object_notify(statement, "mref");
+    g_object_notify(statement, "cred");
+    g_object_notify(statement, "other-iban");
+    g_object_notify(statement, "other-bic");
+    g_object_thaw_notify(statement);
+}
 
-    // volksbank way
-    ghbci_statement_remove_newlines(reference);
-    g_strstrip(reference);
-    gchar** words = g_strsplit_set(reference, " ", -1);
-    gint i = g_strv_length(words) - 2;
-    while (i >= 0) {
-        if (g_strcmp0(words[i], "BIC:") == 0) {
-            g_object_set(statement, "other-bic", words[i + 1], NULL);
-            g_free(words[i + 1]);
-            g_free(words[i]);
-            words[i] = NULL;
-            i -= 2;
-        } else if (g_strcmp0(words[i], "IBAN:") == 0) {
-            g_object_set(statement, "other-iban", words[i + 1], NULL);
-            g_free(words[i + 1]);
-            g_free(words[i]);
-            words[i] = NULL;
-            i -= 2;
-        } else if (g_strcmp0(words[i], "CRED:") == 0) {
-            g_object_set(statement, "cred", words[i + 1], NULL);
-            g_free(words[i + 1]);
-            g_free(words[i]);
-            words[i] = NULL;
-            i -= 2;
-        } else if (g_strcmp0(words[i], "MREF:") == 0) {
-            g_object_set(statement, "mref", words[i + 1], NULL);
-            g_free(words[i + 1]);
-            g_free(words[i]);
-            words[i] = NULL;
-            i -= 2;
-        } else if (g_strcmp0(words[i], "EREF:") == 0) {
-            g_object_set(statement, "eref", words[i + 1], NULL);
-            g_free(words[i + 1]);
-            g_free(words[i]);
-            words[i] = NULL;
-            i -= 2;
-        } else {
-            break;
-        }
-    }
-    g_free(reference);
-    gchar* result = g_strjoinv(" ", words);
-    reference = result;
-    g_strfreev(words);
+/**
+ * ghbci_statement_get_string_id:
+ * @statement: a #GHbciStatement
+ * @property: "gv-code", "transaction-type", "other-name" or "other-bic"
+ *
+ * The values of these properties repeat a lot and are stored once per list
+ * of statements fetched or parsed. Each distinct value has an id, so
+ * statements of the same list can be grouped and compared by it instead
+ * of the string.
+ *
+ * Returns: the id of the value of @property, 0 if it is %NULL
+ **/
+guint
+ghbci_statement_get_string_id (GHbciStatement* statement, const gchar* property)
+{
+    GHbciStatementPrivate* priv;
+
+    g_return_val_if_fail (GHBCI_IS_STATEMENT (statement), 0);
+    g_return_val_if_fail (property != NULL, 0);
+    priv = statement->priv;
 
-    g_object_set(statement, "reference", reference, NULL);
+    if (strcmp(property, "gv-code") == 0)
+        return priv->gv_code_id;
+    if (strcmp(property, "transaction-type") == 0)
+        return priv->transaction_type_id;
+    if (strcmp(property, "other-name") == 0)
+        return priv->other_name_id;
+    if (strcmp(property, "other-bic") == 0)
+        return priv->other_bic_id;
+    g_return_val_if_reached (0);
 }
 
 
@@ -57,6 +57,8 @@ GType             ghbci_statement_get_type                      (void) G_GNUC_CO
 
 void              ghbci_statement_prettify_statement            (GObject* statement);
 
+guint             ghbci_statement_get_string_id                 (GHbciStatement* statement, const gchar* property);
+
 
 G_END_DECLS
 
@@ -0,0 +1,98 @@
+/*
+ * ghbci-status.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/**
+ * SECTION:ghbci-status
+ * @short_description: Payload of status events
+ *
+ * hbci4java attaches objects to its status events, like the job being sent
+ * or the raw message. The #GHbciContext::status signal passes them decoded
+ * as #GHbciStatusPayload. Decoding only happens while a handler is
+ * connected to the signal.
+ **/
+
+#include "ghbci-status.h"
+
+G_DEFINE_BOXED_TYPE (GHbciStatusPayload, ghbci_status_payload, ghbci_status_payload_copy, ghbci_status_payload_free)
+
+
+/**
+ * ghbci_status_payload_new:
+ * @tag: status tag
+ *
+ * Create an empty payload
+ *
+ * Returns: (transfer full): new #GHbciStatusPayload
+ **/
+GHbciStatusPayload*
+ghbci_status_payload_new (gint tag)
+{
+    GHbciStatusPayload* self = g_new0(GHbciStatusPayload, 1);
+
+    self->tag = tag;
+    return self;
+}
+
+/**
+ * ghbci_status_payload_copy:
+ * @self: The #GHbciStatusPayload
+ *
+ * Create a deep copy
+ *
+ * Returns: (transfer full): copy of @self
+ **/
+GHbciStatusPayload*
+ghbci_status_payload_copy (GHbciStatusPayload* self)
+{
+    GHbciStatusPayload* copy;
+
+    g_return_val_if_fail (self != NULL, NULL);
+
+    copy = g_memdup2(self, sizeof(GHbciStatusPayload));
+    copy->job_name = g_strdup(self->job_name);
+    copy->dialog_id = g_strdup(self->dialog_id);
+    copy->message_name = g_strdup(self->message_name);
+    copy->raw_message = g_strdup(self->raw_message);
+    copy->function = g_strdup(self->function);
+    copy->call_counters = self->call_counters != NULL ? ghbci_call_counters_copy(self->call_counters) : NULL;
+    return copy;
+}
+
+/**
+ * ghbci_status_payload_free:
+ * @self: The #GHbciStatusPayload
+ *
+ * Free payload and all its strings
+ **/
+void
+ghbci_status_payload_free (GHbciStatusPayload* self)
+{
+    if (self == NULL)
+        return;
+
+    g_free(self->job_name);
+    g_free(self->dialog_id);
+    g_free(self->message_name);
+    g_free(self->raw_message);
+    g_free(self->function);
+    ghbci_call_counters_free(self->call_counters);
+    g_free(self);
+}
+
+
+// vim: sw=4 expandtab
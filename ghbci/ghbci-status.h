@@ -0,0 +1,77 @@
+/*
+ * ghbci-status.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_STATUS_H__
+#define __GHBCI_STATUS_H__
+
+#include <glib.h>
+#include <glib-object.h>
+
+#include "ghbci-instrumentation.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GHbciStatusPayload GHbciStatusPayload;
+
+/**
+ * GHbciStatusPayload:
+ * @tag: status tag, see #GHbciStatusTag
+ * @job_name: name of the job for SEND_TASK and SEND_TASK_DONE
+ * @dialog_id: id of the dialog, known after DIALOG_INIT_DONE
+ * @message_name: name of the message for MSG_CREATE
+ * @message_size: size of the raw message for MSG_RAW_SEND and MSG_RAW_RECV
+ * @raw_message: raw message, only if enabled with
+ *   ghbci_context_set_capture_raw_messages()
+ * @dialog_bytes_sent: bytes sent in the current dialog so far, counted while
+ *   the #GHbciContext::status signal has handlers
+ * @dialog_bytes_received: bytes received in the current dialog so far, like
+ *   @dialog_bytes_sent
+ * @function: public function for API_CALL_DONE
+ * @call_counters: costs of the call for API_CALL_DONE, see
+ *   ghbci_context_get_call_counters()
+ *
+ * Decoded objects attached to a status event of hbci4java. Fields not
+ * available for a status tag are %NULL or 0.
+ **/
+struct _GHbciStatusPayload
+{
+    gint tag;
+    gchar* job_name;
+    gchar* dialog_id;
+    gchar* message_name;
+    gsize message_size;
+    gchar* raw_message;
+    guint64 dialog_bytes_sent;
+    guint64 dialog_bytes_received;
+    gchar* function;
+    GHbciCallCounters* call_counters;
+};
+
+#define GHBCI_TYPE_STATUS_PAYLOAD      (ghbci_status_payload_get_type ())
+
+GType                ghbci_status_payload_get_type            (void) G_GNUC_CONST;
+
+GHbciStatusPayload*  ghbci_status_payload_new                 (gint tag);
+
+GHbciStatusPayload*  ghbci_status_payload_copy                (GHbciStatusPayload* self);
+
+void                 ghbci_status_payload_free                (GHbciStatusPayload* self);
+
+G_END_DECLS
+
+#endif /* __GHBCI_STATUS_H__ */
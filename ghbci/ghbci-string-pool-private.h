@@ -0,0 +1,41 @@
+/*
+ * ghbci-string-pool-private.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_STRING_POOL_PRIVATE_H__
+#define __GHBCI_STRING_POOL_PRIVATE_H__
+
+#include <glib.h>
+
+/* bytes of strings a pool for a list of statements starts with */
+#define GHBCI_STRING_POOL_CHUNK_SIZE        4096
+
+typedef struct _GHbciStringPool GHbciStringPool;
+
+GHbciStringPool*  ghbci_string_pool_new                       (void);
+
+GHbciStringPool*  ghbci_string_pool_new_sized                 (gsize chunk_size);
+
+GHbciStringPool*  ghbci_string_pool_ref                       (GHbciStringPool* self);
+
+void              ghbci_string_pool_unref                     (GHbciStringPool* self);
+
+const gchar*      ghbci_string_pool_intern                    (GHbciStringPool* self, const gchar* str, guint* id);
+
+guint             ghbci_string_pool_get_size                  (GHbciStringPool* self);
+
+#endif /* __GHBCI_STRING_POOL_PRIVATE_H__ */
@@ -0,0 +1,128 @@
+/*
+ * ghbci-string-pool.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/*
+ * Pool of immutable strings for the statement fields with few distinct
+ * values, like gv_code. Every distinct string is stored once and numbered
+ * in order of appearance, starting at 1, so 0 means no string. Strings are
+ * never removed, they live until the last reference to the pool is gone.
+ * A pool is made for one list of statements, every statement with a
+ * string of it holds a reference.
+ */
+
+#include "ghbci-string-pool-private.h"
+
+struct _GHbciStringPool
+{
+    gint ref_count;
+    GMutex lock;
+
+    GStringChunk* chunk;
+    /* string in chunk to its id */
+    GHashTable* ids;
+    guint size;
+};
+
+
+/*
+ * Pool with room for chunk_size bytes of strings before it grows
+ */
+GHbciStringPool*
+ghbci_string_pool_new_sized (gsize chunk_size)
+{
+    GHbciStringPool* self = g_new0(GHbciStringPool, 1);
+
+    self->ref_count = 1;
+    g_mutex_init(&self->lock);
+    self->chunk = g_string_chunk_new(chunk_size);
+    self->ids = g_hash_table_new(g_str_hash, g_str_equal);
+    return self;
+}
+
+GHbciStringPool*
+ghbci_string_pool_new (void)
+{
+    return ghbci_string_pool_new_sized(GHBCI_STRING_POOL_CHUNK_SIZE);
+}
+
+GHbciStringPool*
+ghbci_string_pool_ref (GHbciStringPool* self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    g_atomic_int_inc(&self->ref_count);
+    return self;
+}
+
+void
+ghbci_string_pool_unref (GHbciStringPool* self)
+{
+    g_return_if_fail (self != NULL);
+
+    if (g_atomic_int_dec_and_test(&self->ref_count)) {
+        g_hash_table_unref(self->ids);
+        g_string_chunk_free(self->chunk);
+        g_mutex_clear(&self->lock);
+        g_free(self);
+    }
+}
+
+/*
+ * The pooled copy of str, valid as long as the pool. Stores its id in id
+ * if not NULL, NULL is pooled as NULL with id 0.
+ */
+const gchar*
+ghbci_string_pool_intern (GHbciStringPool* self, const gchar* str, guint* id)
+{
+    gpointer pooled = NULL;
+    gpointer pooled_id = NULL;
+
+    g_return_val_if_fail (self != NULL, NULL);
+
+    if (str != NULL) {
+        g_mutex_lock(&self->lock);
+        if (!g_hash_table_lookup_extended(self->ids, str, &pooled, &pooled_id)) {
+            pooled = g_string_chunk_insert(self->chunk, str);
+            pooled_id = GUINT_TO_POINTER(++self->size);
+            g_hash_table_insert(self->ids, pooled, pooled_id);
+        }
+        g_mutex_unlock(&self->lock);
+    }
+    if (id != NULL)
+        *id = GPOINTER_TO_UINT(pooled_id);
+    return pooled;
+}
+
+/*
+ * Number of distinct strings
+ */
+guint
+ghbci_string_pool_get_size (GHbciStringPool* self)
+{
+    guint size;
+
+    g_return_val_if_fail (self != NULL, 0);
+
+    g_mutex_lock(&self->lock);
+    size = self->size;
+    g_mutex_unlock(&self->lock);
+    return size;
+}
+
+
+// vim: sw=4 expandtab
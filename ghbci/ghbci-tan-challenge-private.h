@@ -0,0 +1,32 @@
+/*
+ * ghbci-tan-challenge-private.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_TAN_CHALLENGE_PRIVATE_H__
+#define __GHBCI_TAN_CHALLENGE_PRIVATE_H__
+
+#include <glib.h>
+
+#include "ghbci-tan-challenge.h"
+
+GHbciTanChallenge*  ghbci_tan_challenge_new                   (const gchar* blz, const gchar* userid,
+                                                               const gchar* message, const gchar* challenge,
+                                                               gint64 expiry_time);
+
+gchar*              ghbci_tan_challenge_wait                  (GHbciTanChallenge* self);
+
+#endif /* __GHBCI_TAN_CHALLENGE_PRIVATE_H__ */
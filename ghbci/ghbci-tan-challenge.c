@@ -0,0 +1,345 @@
+/*
+ * ghbci-tan-challenge.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/**
+ * SECTION:ghbci-tan-challenge
+ * @short_description: A TAN the bank asks for, answered later
+ *
+ * When the bank needs a TAN and the #GHbciContext::tan-challenge signal has
+ * handlers, the context emits a #GHbciTanChallenge instead of
+ * #GHbciContext::callback. The handler must not block, it keeps a
+ * reference and calls ghbci_tan_challenge_answer() or
+ * ghbci_tan_challenge_cancel() from any thread once the user is done.
+ *
+ * Meanwhile the thread of the job runs its thread default main context if
+ * it can acquire it, e.g. in the main thread of an application, so the
+ * answer may come from a dialog of the same thread. Otherwise it sleeps.
+ * Either way it holds no lock of the context and gives its connection slot
+ * of the bank back, so other passports keep being served. Challenges not answered until their expiry
+ * time abort the job.
+ **/
+
+#include "ghbci-tan-challenge.h"
+#include "ghbci-tan-challenge-private.h"
+
+struct _GHbciTanChallenge
+{
+    gint ref_count;
+
+    gchar* blz;
+    gchar* userid;
+    gchar* message;
+    gchar* challenge;
+    gint64 expiry_time;
+
+    GMutex lock;
+    GCond cond;
+    /* the main context iterated by the waiting thread, if any */
+    GMainContext* main_context;
+    GHbciTanChallengeState state;
+    gchar* tan;
+};
+
+
+G_DEFINE_BOXED_TYPE (GHbciTanChallenge, ghbci_tan_challenge, ghbci_tan_challenge_ref, ghbci_tan_challenge_unref)
+
+
+/*
+ * Leave the pending state, returns FALSE if it was left before
+ */
+static gboolean
+finish (GHbciTanChallenge* self, GHbciTanChallengeState state, const gchar* tan)
+{
+    gboolean pending;
+
+    g_mutex_lock(&self->lock);
+    pending = self->state == GHBCI_TAN_CHALLENGE_PENDING;
+    if (pending) {
+        self->state = state;
+        self->tan = g_strdup(tan);
+        g_cond_signal(&self->cond);
+        if (self->main_context != NULL)
+            g_main_context_wakeup(self->main_context);
+    }
+    g_mutex_unlock(&self->lock);
+    return pending;
+}
+
+
+static gboolean
+wake_up (gpointer user_data)
+{
+    return G_SOURCE_CONTINUE;
+}
+
+
+/* private methods */
+
+/**
+ * ghbci_tan_challenge_new:
+ * @blz: blz of the passport
+ * @userid: userid of the passport
+ * @message: message of the bank
+ * @challenge: challenge data, e.g. the flicker code
+ * @expiry_time: monotonic time the challenge expires
+ *
+ * Create a pending challenge
+ *
+ * Returns: (transfer full): new #GHbciTanChallenge
+ **/
+GHbciTanChallenge*
+ghbci_tan_challenge_new (const gchar* blz, const gchar* userid, const gchar* message, const gchar* challenge,
+        gint64 expiry_time)
+{
+    GHbciTanChallenge* self = g_new0(GHbciTanChallenge, 1);
+
+    self->ref_count = 1;
+    self->blz = g_strdup(blz);
+    self->userid = g_strdup(userid);
+    self->message = g_strdup(message);
+    self->challenge = g_strdup(challenge);
+    self->expiry_time = expiry_time;
+    g_mutex_init(&self->lock);
+    g_cond_init(&self->cond);
+    self->state = GHBCI_TAN_CHALLENGE_PENDING;
+    return self;
+}
+
+/**
+ * ghbci_tan_challenge_wait:
+ * @self: The #GHbciTanChallenge
+ *
+ * Block until @self is answered, cancelled or expired. The thread default
+ * main context is iterated meanwhile if it can be acquired.
+ *
+ * Returns: (transfer full) (nullable): the TAN, %NULL if there is none
+ **/
+gchar*
+ghbci_tan_challenge_wait (GHbciTanChallenge* self)
+{
+    GMainContext* main_context = g_main_context_ref_thread_default();
+    GSource* timeout;
+    gchar* tan;
+
+    if (g_main_context_acquire(main_context)) {
+        // only wakes the iteration up once the challenge expired
+        gint64 remaining = MAX(self->expiry_time - g_get_monotonic_time(), 0);
+        timeout = g_timeout_source_new(remaining / 1000 + 1);
+        g_source_set_callback(timeout, wake_up, NULL, NULL);
+        g_source_attach(timeout, main_context);
+
+        g_mutex_lock(&self->lock);
+        self->main_context = main_context;
+        while (self->state == GHBCI_TAN_CHALLENGE_PENDING) {
+            if (g_get_monotonic_time() >= self->expiry_time) {
+                self->state = GHBCI_TAN_CHALLENGE_EXPIRED;
+                break;
+            }
+            g_mutex_unlock(&self->lock);
+            g_main_context_iteration(main_context, TRUE);
+            g_mutex_lock(&self->lock);
+        }
+        self->main_context = NULL;
+
+        g_source_destroy(timeout);
+        g_source_unref(timeout);
+        g_main_context_release(main_context);
+    } else {
+        g_mutex_lock(&self->lock);
+        while (self->state == GHBCI_TAN_CHALLENGE_PENDING) {
+            if (!g_cond_wait_until(&self->cond, &self->lock, self->expiry_time))
+                self->state = GHBCI_TAN_CHALLENGE_EXPIRED;
+        }
+    }
+    tan = g_strdup(self->tan);
+    g_mutex_unlock(&self->lock);
+    g_main_context_unref(main_context);
+    return tan;
+}
+
+
+/* public methods */
+
+/**
+ * ghbci_tan_challenge_ref:
+ * @self: The #GHbciTanChallenge
+ *
+ * Increase reference count
+ *
+ * Returns: (transfer full): @self
+ **/
+GHbciTanChallenge*
+ghbci_tan_challenge_ref (GHbciTanChallenge* self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    g_atomic_int_inc(&self->ref_count);
+    return self;
+}
+
+/**
+ * ghbci_tan_challenge_unref:
+ * @self: The #GHbciTanChallenge
+ *
+ * Decrease reference count, frees @self when it drops to zero
+ **/
+void
+ghbci_tan_challenge_unref (GHbciTanChallenge* self)
+{
+    g_return_if_fail (self != NULL);
+
+    if (g_atomic_int_dec_and_test(&self->ref_count)) {
+        g_free(self->blz);
+        g_free(self->userid);
+        g_free(self->message);
+        g_free(self->challenge);
+        g_free(self->tan);
+        g_mutex_clear(&self->lock);
+        g_cond_clear(&self->cond);
+        g_free(self);
+    }
+}
+
+/**
+ * ghbci_tan_challenge_get_blz:
+ * @self: The #GHbciTanChallenge
+ *
+ * Returns: (transfer none): blz of the passport
+ **/
+const gchar*
+ghbci_tan_challenge_get_blz (GHbciTanChallenge* self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    return self->blz;
+}
+
+/**
+ * ghbci_tan_challenge_get_userid:
+ * @self: The #GHbciTanChallenge
+ *
+ * Returns: (transfer none): userid of the passport
+ **/
+const gchar*
+ghbci_tan_challenge_get_userid (GHbciTanChallenge* self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    return self->userid;
+}
+
+/**
+ * ghbci_tan_challenge_get_message:
+ * @self: The #GHbciTanChallenge
+ *
+ * Returns: (transfer none): message of the bank to show to the user
+ **/
+const gchar*
+ghbci_tan_challenge_get_message (GHbciTanChallenge* self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    return self->message;
+}
+
+/**
+ * ghbci_tan_challenge_get_challenge:
+ * @self: The #GHbciTanChallenge
+ *
+ * Challenge data of the TAN method, e.g. the flicker code of chipTAN
+ *
+ * Returns: (transfer none): challenge data, empty if there is none
+ **/
+const gchar*
+ghbci_tan_challenge_get_challenge (GHbciTanChallenge* self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    return self->challenge;
+}
+
+/**
+ * ghbci_tan_challenge_get_expiry_time:
+ * @self: The #GHbciTanChallenge
+ *
+ * Returns: time the challenge expires, see g_get_monotonic_time()
+ **/
+gint64
+ghbci_tan_challenge_get_expiry_time (GHbciTanChallenge* self)
+{
+    g_return_val_if_fail (self != NULL, 0);
+
+    return self->expiry_time;
+}
+
+/**
+ * ghbci_tan_challenge_get_state:
+ * @self: The #GHbciTanChallenge
+ *
+ * Returns: the #GHbciTanChallengeState
+ **/
+GHbciTanChallengeState
+ghbci_tan_challenge_get_state (GHbciTanChallenge* self)
+{
+    GHbciTanChallengeState state;
+
+    g_return_val_if_fail (self != NULL, GHBCI_TAN_CHALLENGE_CANCELLED);
+
+    g_mutex_lock(&self->lock);
+    state = self->state;
+    g_mutex_unlock(&self->lock);
+    return state;
+}
+
+/**
+ * ghbci_tan_challenge_answer:
+ * @self: The #GHbciTanChallenge
+ * @tan: the TAN
+ *
+ * Answer the challenge, the job continues. May be called from any thread.
+ *
+ * Returns: %FALSE if @self was already answered, cancelled or expired
+ **/
+gboolean
+ghbci_tan_challenge_answer (GHbciTanChallenge* self, const gchar* tan)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (tan != NULL, FALSE);
+
+    return finish(self, GHBCI_TAN_CHALLENGE_ANSWERED, tan);
+}
+
+/**
+ * ghbci_tan_challenge_cancel:
+ * @self: The #GHbciTanChallenge
+ *
+ * Cancel the challenge, the job fails with %GHBCI_ERROR_ABORTED. May be
+ * called from any thread.
+ *
+ * Returns: %FALSE if @self was already answered, cancelled or expired
+ **/
+gboolean
+ghbci_tan_challenge_cancel (GHbciTanChallenge* self)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    return finish(self, GHBCI_TAN_CHALLENGE_CANCELLED, NULL);
+}
+
+
+// vim: sw=4 expandtab
@@ -0,0 +1,71 @@
+/*
+ * ghbci-tan-challenge.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_TAN_CHALLENGE_H__
+#define __GHBCI_TAN_CHALLENGE_H__
+
+#include <glib.h>
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GHbciTanChallenge GHbciTanChallenge;
+
+#define GHBCI_TYPE_TAN_CHALLENGE       (ghbci_tan_challenge_get_type ())
+
+/**
+ * GHbciTanChallengeState:
+ * @GHBCI_TAN_CHALLENGE_PENDING: waiting for the TAN
+ * @GHBCI_TAN_CHALLENGE_ANSWERED: TAN was given
+ * @GHBCI_TAN_CHALLENGE_CANCELLED: cancelled, the job is aborted
+ * @GHBCI_TAN_CHALLENGE_EXPIRED: not answered in time, the job is aborted
+ *
+ * State of a #GHbciTanChallenge
+ **/
+typedef enum {
+    GHBCI_TAN_CHALLENGE_PENDING,
+    GHBCI_TAN_CHALLENGE_ANSWERED,
+    GHBCI_TAN_CHALLENGE_CANCELLED,
+    GHBCI_TAN_CHALLENGE_EXPIRED
+} GHbciTanChallengeState;
+
+GType                   ghbci_tan_challenge_get_type          (void) G_GNUC_CONST;
+
+GHbciTanChallenge*      ghbci_tan_challenge_ref               (GHbciTanChallenge* self);
+
+void                    ghbci_tan_challenge_unref             (GHbciTanChallenge* self);
+
+const gchar*            ghbci_tan_challenge_get_blz           (GHbciTanChallenge* self);
+
+const gchar*            ghbci_tan_challenge_get_userid        (GHbciTanChallenge* self);
+
+const gchar*            ghbci_tan_challenge_get_message       (GHbciTanChallenge* self);
+
+const gchar*            ghbci_tan_challenge_get_challenge     (GHbciTanChallenge* self);
+
+gint64                  ghbci_tan_challenge_get_expiry_time   (GHbciTanChallenge* self);
+
+GHbciTanChallengeState  ghbci_tan_challenge_get_state         (GHbciTanChallenge* self);
+
+gboolean                ghbci_tan_challenge_answer            (GHbciTanChallenge* self, const gchar* tan);
+
+gboolean                ghbci_tan_challenge_cancel            (GHbciTanChallenge* self);
+
+G_END_DECLS
+
+#endif /* __GHBCI_TAN_CHALLENGE_H__ */
@@ -0,0 +1,42 @@
+/*
+ * ghbci-transfer-private.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_TRANSFER_PRIVATE_H__
+#define __GHBCI_TRANSFER_PRIVATE_H__
+
+#include <glib.h>
+
+#include "ghbci-transfer.h"
+
+gboolean          ghbci_transfer_parse_amount                 (const gchar* amount, gint64* cents);
+
+gchar*            ghbci_transfer_format_amount                (gint64 cents);
+
+gboolean          ghbci_transfer_check_iban                   (const gchar* iban);
+
+gboolean          ghbci_transfer_check_bic                    (const gchar* bic);
+
+gboolean          ghbci_transfer_check_account                (const gchar* name, const gchar* bic,
+                                                               const gchar* iban, GError** error);
+
+gchar*            ghbci_transfer_new_message_id               (void);
+
+gboolean          ghbci_transfer_read_pain001                 (const gchar* data, gssize length,
+                                                               GHbciTransfer* transfer, GError** error);
+
+#endif /* __GHBCI_TRANSFER_PRIVATE_H__ */
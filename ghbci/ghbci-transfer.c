@@ -0,0 +1,603 @@
+/*
+ * ghbci-transfer.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/**
+ * SECTION:ghbci-transfer
+ * @short_description: SEPA credit transfers and their pain.001 document
+ *
+ * A #GHbciTransfer describes one payment of a batch sent with
+ * ghbci_context_send_transfers(). All transfers are checked against the
+ * rules of the pain.001.003.03 schema before the bank is contacted, so a
+ * typo in the 2000th IBAN of a payroll run doesn't fail after the TAN was
+ * entered.
+ *
+ * ghbci_transfer_write_pain001() writes the same batch as pain.001.003.03
+ * document, e.g. for archiving or for submission by other means. It is
+ * streamed, memory use doesn't grow with the number of transfers.
+ **/
+
+#include <string.h>
+
+#include "ghbci-transfer.h"
+#include "ghbci-transfer-private.h"
+#include "ghbci-error.h"
+#include "ghbci-error-private.h"
+
+/* amounts are limited by the schema */
+#define MAX_AMOUNT_CENTS    G_GINT64_CONSTANT(99999999999)
+/* output is written in chunks of this size */
+#define PAIN_CHUNK_SIZE     65536
+
+#define PAIN001_NAMESPACE   "urn:iso:std:iso:20022:tech:xsd:pain.001.003.03"
+#define NOT_PROVIDED        "NOTPROVIDED"
+
+
+G_DEFINE_BOXED_TYPE (GHbciTransfer, ghbci_transfer, ghbci_transfer_copy, ghbci_transfer_free)
+
+
+/*
+ * Text of at least one and at most max_length characters
+ */
+static gboolean
+check_text (const gchar* text, glong max_length)
+{
+    if (text == NULL || *text == '\0' || !g_utf8_validate(text, -1, NULL))
+        return FALSE;
+    return g_utf8_strlen(text, -1) <= max_length;
+}
+
+/*
+ * RestrictedIdentificationSEPA1 of the schema
+ */
+static gboolean
+check_identification (const gchar* id)
+{
+    gsize length = id != NULL ? strlen(id) : 0;
+    gsize i;
+
+    if (length < 1 || length > 35)
+        return FALSE;
+    for (i = 0; i < length; i++) {
+        if (!g_ascii_isalnum(id[i]) && strchr("+?/-:().,' ", id[i]) == NULL)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static void
+append_escaped (GString* buffer, const gchar* element, const gchar* text)
+{
+    gchar* escaped = g_markup_escape_text(text, -1);
+
+    g_string_append_printf(buffer, "<%s>%s</%s>", element, escaped, element);
+    g_free(escaped);
+}
+
+static gboolean
+flush_buffer (GOutputStream* stream, GString* buffer, gsize threshold, GCancellable* cancellable,
+        GError** error)
+{
+    if (buffer->len < threshold)
+        return TRUE;
+    if (!g_output_stream_write_all(stream, buffer->str, buffer->len, NULL, cancellable, error))
+        return FALSE;
+    g_string_truncate(buffer, 0);
+    return TRUE;
+}
+
+
+/*
+ * State of ghbci_transfer_read_pain001(), collecting the first transaction
+ */
+typedef struct
+{
+    GHbciTransfer* transfer;
+    GString* text;
+    gboolean in_transaction;
+    gboolean done;
+} PainReader;
+
+static const gchar*
+local_name (const gchar* element_name)
+{
+    const gchar* colon = strchr(element_name, ':');
+
+    return colon != NULL ? colon + 1 : element_name;
+}
+
+static void
+pain_start_element (GMarkupParseContext* context, const gchar* element_name, const gchar** attribute_names,
+        const gchar** attribute_values, gpointer user_data, GError** error)
+{
+    PainReader* reader = user_data;
+
+    if (!reader->done && strcmp(local_name(element_name), "CdtTrfTxInf") == 0)
+        reader->in_transaction = TRUE;
+    g_string_truncate(reader->text, 0);
+}
+
+static void
+pain_end_element (GMarkupParseContext* context, const gchar* element_name, gpointer user_data, GError** error)
+{
+    PainReader* reader = user_data;
+    GHbciTransfer* transfer = reader->transfer;
+    const gchar* name = local_name(element_name);
+    const gchar* parent;
+    gchar** target = NULL;
+
+    if (!reader->in_transaction)
+        return;
+    if (strcmp(name, "CdtTrfTxInf") == 0) {
+        reader->in_transaction = FALSE;
+        reader->done = TRUE;
+        return;
+    }
+
+    // the element stack still contains element_name
+    parent = g_markup_parse_context_get_element_stack(context)->next->data;
+    parent = local_name(parent);
+    if (strcmp(name, "EndToEndId") == 0)
+        target = &transfer->end_to_end_id;
+    else if (strcmp(name, "InstdAmt") == 0)
+        target = &transfer->amount;
+    else if (strcmp(name, "BIC") == 0 || strcmp(name, "BICFI") == 0)
+        target = &transfer->bic;
+    else if (strcmp(name, "Nm") == 0 && strcmp(parent, "Cdtr") == 0)
+        target = &transfer->name;
+    else if (strcmp(name, "IBAN") == 0)
+        target = &transfer->iban;
+    else if (strcmp(name, "Ustrd") == 0)
+        target = &transfer->reference;
+
+    if (target != NULL && *target == NULL)
+        *target = g_strstrip(g_strdup(reader->text->str));
+}
+
+static void
+pain_text (GMarkupParseContext* context, const gchar* text, gsize text_len, gpointer user_data, GError** error)
+{
+    PainReader* reader = user_data;
+
+    if (reader->in_transaction)
+        g_string_append_len(reader->text, text, text_len);
+}
+
+static const GMarkupParser pain_parser = {
+    pain_start_element,
+    pain_end_element,
+    pain_text,
+    NULL,
+    NULL
+};
+
+
+/* private methods */
+
+/**
+ * ghbci_transfer_parse_amount:
+ * @amount: amount in EUR, e.g. "1234.5"
+ * @cents: return location for the amount in cent
+ *
+ * Parse an amount allowed in a SEPA transfer, between 0.01 and
+ * 999999999.99 with at most two decimals
+ *
+ * Returns: %TRUE if @amount is valid
+ **/
+gboolean
+ghbci_transfer_parse_amount (const gchar* amount, gint64* cents)
+{
+    gint64 value = 0;
+    gint decimals = -1;
+    const gchar* p;
+
+    if (amount == NULL || *amount == '\0')
+        return FALSE;
+
+    for (p = amount; *p != '\0'; p++) {
+        if (*p == '.' && decimals < 0 && p != amount) {
+            decimals = 0;
+        } else if (g_ascii_isdigit(*p) && decimals < 2) {
+            value = value * 10 + (*p - '0');
+            if (decimals >= 0)
+                decimals++;
+            if (value > MAX_AMOUNT_CENTS)
+                return FALSE;
+        } else {
+            return FALSE;
+        }
+    }
+    if (decimals == 0)
+        return FALSE;
+
+    for (decimals = MAX(decimals, 0); decimals < 2; decimals++)
+        value *= 10;
+    if (value < 1 || value > MAX_AMOUNT_CENTS)
+        return FALSE;
+
+    *cents = value;
+    return TRUE;
+}
+
+/**
+ * ghbci_transfer_format_amount:
+ * @cents: amount in cent
+ *
+ * Returns: (transfer full): @cents as decimal EUR amount
+ **/
+gchar*
+ghbci_transfer_format_amount (gint64 cents)
+{
+    return g_strdup_printf("%" G_GINT64_FORMAT ".%02d", cents / 100, (gint)(cents % 100));
+}
+
+/**
+ * ghbci_transfer_check_iban:
+ * @iban: IBAN without spaces
+ *
+ * Check format and checksum of an IBAN
+ *
+ * Returns: %TRUE if @iban is valid
+ **/
+gboolean
+ghbci_transfer_check_iban (const gchar* iban)
+{
+    gsize length = iban != NULL ? strlen(iban) : 0;
+    guint remainder = 0;
+    gsize i;
+
+    if (length < 5 || length > 34)
+        return FALSE;
+    if (!g_ascii_isupper(iban[0]) || !g_ascii_isupper(iban[1])
+            || !g_ascii_isdigit(iban[2]) || !g_ascii_isdigit(iban[3]))
+        return FALSE;
+
+    // mod 97 of the number with the first four characters moved to the end
+    for (i = 0; i < length; i++) {
+        gchar c = iban[(i + 4) % length];
+
+        if (g_ascii_isdigit(c))
+            remainder = (remainder * 10 + (c - '0')) % 97;
+        else if (g_ascii_isalpha(c))
+            remainder = (remainder * 100 + (g_ascii_toupper(c) - 'A' + 10)) % 97;
+        else
+            return FALSE;
+    }
+    return remainder == 1;
+}
+
+/**
+ * ghbci_transfer_check_bic:
+ * @bic: BIC
+ *
+ * Returns: %TRUE if @bic has the format of a BIC
+ **/
+gboolean
+ghbci_transfer_check_bic (const gchar* bic)
+{
+    gsize length = bic != NULL ? strlen(bic) : 0;
+    gsize i;
+
+    if (length != 8 && length != 11)
+        return FALSE;
+    for (i = 0; i < 6; i++) {
+        if (!g_ascii_isupper(bic[i]))
+            return FALSE;
+    }
+    if (!(g_ascii_isupper(bic[6]) || (bic[6] >= '2' && bic[6] <= '9')))
+        return FALSE;
+    if (!(g_ascii_isupper(bic[7]) || g_ascii_isdigit(bic[7])) || bic[7] == 'O')
+        return FALSE;
+    for (i = 8; i < length; i++) {
+        if (!g_ascii_isupper(bic[i]) && !g_ascii_isdigit(bic[i]))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * ghbci_transfer_check_account:
+ * @name: name of the account holder
+ * @bic: (nullable): BIC, may be empty
+ * @iban: IBAN
+ * @error: return location for a #GError
+ *
+ * Check the party of a transfer
+ *
+ * Returns: %TRUE if all values are valid
+ **/
+gboolean
+ghbci_transfer_check_account (const gchar* name, const gchar* bic, const gchar* iban, GError** error)
+{
+    if (!check_text(name, 70)) {
+        ghbci_set_error(error, GHBCI_ERROR_INVALID_DATA, NULL, GHBCI_RETRY_HINT_NEVER,
+                "name must have 1 to 70 characters: %s", name != NULL ? name : "");
+        return FALSE;
+    }
+    if (!ghbci_transfer_check_iban(iban)) {
+        ghbci_set_error(error, GHBCI_ERROR_INVALID_DATA, NULL, GHBCI_RETRY_HINT_NEVER,
+                "invalid IBAN: %s", iban != NULL ? iban : "");
+        return FALSE;
+    }
+    if (bic != NULL && *bic != '\0' && !ghbci_transfer_check_bic(bic)) {
+        ghbci_set_error(error, GHBCI_ERROR_INVALID_DATA, NULL, GHBCI_RETRY_HINT_NEVER,
+                "invalid BIC: %s", bic);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * ghbci_transfer_new_message_id:
+ *
+ * Returns: (transfer full): new id for a pain message, unique with high probability
+ **/
+gchar*
+ghbci_transfer_new_message_id (void)
+{
+    return g_strdup_printf("GHBCI-%" G_GINT64_MODIFIER "x-%08x", g_get_real_time(), g_random_int());
+}
+
+/**
+ * ghbci_transfer_read_pain001:
+ * @data: pain.001 document
+ * @length: length of @data or -1 if nul terminated
+ * @transfer: transfer to fill, fields must be %NULL
+ * @error: return location for a #GError
+ *
+ * Read the first transaction of a pain.001 document, as hbci4java returns
+ * for standing orders and scheduled transfers. Namespace and version of
+ * the schema don't matter, the element names are the same.
+ *
+ * Returns: %TRUE if @data contains a transaction
+ **/
+gboolean
+ghbci_transfer_read_pain001 (const gchar* data, gssize length, GHbciTransfer* transfer, GError** error)
+{
+    PainReader reader = { transfer, g_string_new(NULL), FALSE, FALSE };
+    GMarkupParseContext* context;
+    gboolean result;
+
+    context = g_markup_parse_context_new(&pain_parser, 0, &reader, NULL);
+    result = g_markup_parse_context_parse(context, data, length, error)
+            && g_markup_parse_context_end_parse(context, error);
+    g_markup_parse_context_free(context);
+    g_string_free(reader.text, TRUE);
+
+    if (result && !reader.done) {
+        ghbci_set_error(error, GHBCI_ERROR_INVALID_DATA, NULL, GHBCI_RETRY_HINT_NEVER,
+                "pain.001 document contains no transaction");
+        return FALSE;
+    }
+    return result;
+}
+
+
+/* public methods */
+
+/**
+ * ghbci_transfer_copy:
+ * @self: The #GHbciTransfer
+ *
+ * Create a deep copy
+ *
+ * Returns: (transfer full): copy of @self
+ **/
+GHbciTransfer*
+ghbci_transfer_copy (GHbciTransfer* self)
+{
+    GHbciTransfer* copy;
+
+    g_return_val_if_fail (self != NULL, NULL);
+
+    copy = g_new0(GHbciTransfer, 1);
+    copy->name = g_strdup(self->name);
+    copy->bic = g_strdup(self->bic);
+    copy->iban = g_strdup(self->iban);
+    copy->reference = g_strdup(self->reference);
+    copy->amount = g_strdup(self->amount);
+    copy->end_to_end_id = g_strdup(self->end_to_end_id);
+    return copy;
+}
+
+/**
+ * ghbci_transfer_free:
+ * @self: The #GHbciTransfer
+ *
+ * Free a transfer created by ghbci_transfer_copy()
+ **/
+void
+ghbci_transfer_free (GHbciTransfer* self)
+{
+    if (self == NULL)
+        return;
+
+    g_free(self->name);
+    g_free(self->bic);
+    g_free(self->iban);
+    g_free(self->reference);
+    g_free(self->amount);
+    g_free(self->end_to_end_id);
+    g_free(self);
+}
+
+/**
+ * ghbci_transfer_validate:
+ * @self: The #GHbciTransfer
+ * @error: return location for a #GError
+ *
+ * Check @self against the rules of the pain.001.003.03 schema, without
+ * contacting the bank. Fails with %GHBCI_ERROR_INVALID_DATA.
+ *
+ * Returns: %TRUE if @self is valid
+ **/
+gboolean
+ghbci_transfer_validate (const GHbciTransfer* self, GError** error)
+{
+    gint64 cents;
+
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    if (!ghbci_transfer_check_account(self->name, self->bic, self->iban, error))
+        return FALSE;
+    if (!ghbci_transfer_parse_amount(self->amount, &cents)) {
+        ghbci_set_error(error, GHBCI_ERROR_INVALID_DATA, NULL, GHBCI_RETRY_HINT_NEVER,
+                "invalid amount: %s", self->amount != NULL ? self->amount : "");
+        return FALSE;
+    }
+    if (self->reference != NULL && *self->reference != '\0' && !check_text(self->reference, 140)) {
+        ghbci_set_error(error, GHBCI_ERROR_INVALID_DATA, NULL, GHBCI_RETRY_HINT_NEVER,
+                "reference must have at most 140 characters: %s", self->reference);
+        return FALSE;
+    }
+    if (self->end_to_end_id != NULL && !check_identification(self->end_to_end_id)) {
+        ghbci_set_error(error, GHBCI_ERROR_INVALID_DATA, NULL, GHBCI_RETRY_HINT_NEVER,
+                "invalid end to end id: %s", self->end_to_end_id);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * ghbci_transfer_write_pain001:
+ * @stream: stream to write to
+ * @message_id: id of the message, up to 35 characters
+ * @source_name: name of the payer
+ * @source_bic: (nullable): BIC of the payer's bank
+ * @source_iban: IBAN of the payer
+ * @transfers: (array length=n_transfers): transfers
+ * @n_transfers: number of transfers
+ * @batch_booking: whether the bank books the batch as one sum
+ * @cancellable: (nullable): a #GCancellable
+ * @error: return location for a #GError
+ *
+ * Write @transfers as pain.001.003.03 document with a single payment
+ * information block, to be executed as soon as possible. All transfers are
+ * validated before the first byte is written.
+ *
+ * Returns: %TRUE on success
+ **/
+gboolean
+ghbci_transfer_write_pain001 (GOutputStream* stream, const gchar* message_id, const gchar* source_name,
+        const gchar* source_bic, const gchar* source_iban, const GHbciTransfer* transfers, guint n_transfers,
+        gboolean batch_booking, GCancellable* cancellable, GError** error)
+{
+    GString* buffer;
+    gint64 sum = 0;
+    gchar* amount;
+    guint i;
+
+    g_return_val_if_fail (G_IS_OUTPUT_STREAM (stream), FALSE);
+    g_return_val_if_fail (n_transfers == 0 || transfers != NULL, FALSE);
+    g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+    if (!check_identification(message_id)) {
+        ghbci_set_error(error, GHBCI_ERROR_INVALID_DATA, NULL, GHBCI_RETRY_HINT_NEVER,
+                "invalid message id: %s", message_id != NULL ? message_id : "");
+        return FALSE;
+    }
+    if (n_transfers == 0) {
+        ghbci_set_error(error, GHBCI_ERROR_INVALID_DATA, NULL, GHBCI_RETRY_HINT_NEVER, "no transfers");
+        return FALSE;
+    }
+    if (!ghbci_transfer_check_account(source_name, source_bic, source_iban, error))
+        return FALSE;
+
+    // the control sum comes first, so check and sum up before writing
+    for (i = 0; i < n_transfers; i++) {
+        gint64 cents = 0;
+        GError* transfer_error = NULL;
+
+        if (!ghbci_transfer_validate(&transfers[i], &transfer_error)) {
+            g_propagate_prefixed_error(error, transfer_error, "transfer %u: ", i);
+            return FALSE;
+        }
+        ghbci_transfer_parse_amount(transfers[i].amount, &cents);
+        sum += cents;
+    }
+
+    GDateTime* now = g_date_time_new_now_local();
+    gchar* created = g_date_time_format(now, "%Y-%m-%dT%H:%M:%S");
+    g_date_time_unref(now);
+
+    buffer = g_string_sized_new(PAIN_CHUNK_SIZE + 1024);
+    amount = ghbci_transfer_format_amount(sum);
+    g_string_append(buffer, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<Document xmlns=\"" PAIN001_NAMESPACE "\""
+            " xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\""
+            " xsi:schemaLocation=\"" PAIN001_NAMESPACE " pain.001.003.03.xsd\">\n"
+            "<CstmrCdtTrfInitn>\n<GrpHdr>");
+    append_escaped(buffer, "MsgId", message_id);
+    g_string_append_printf(buffer, "<CreDtTm>%s</CreDtTm><NbOfTxs>%u</NbOfTxs><CtrlSum>%s</CtrlSum>",
+            created, n_transfers, amount);
+    g_string_append(buffer, "<InitgPty>");
+    append_escaped(buffer, "Nm", source_name);
+    g_string_append(buffer, "</InitgPty></GrpHdr>\n<PmtInf>");
+    append_escaped(buffer, "PmtInfId", message_id);
+    g_string_append_printf(buffer, "<PmtMtd>TRF</PmtMtd><BtchBookg>%s</BtchBookg>"
+            "<NbOfTxs>%u</NbOfTxs><CtrlSum>%s</CtrlSum>"
+            "<PmtTpInf><SvcLvl><Cd>SEPA</Cd></SvcLvl></PmtTpInf>"
+            "<ReqdExctnDt>1999-01-01</ReqdExctnDt><Dbtr>",
+            batch_booking ? "true" : "false", n_transfers, amount);
+    append_escaped(buffer, "Nm", source_name);
+    g_string_append_printf(buffer, "</Dbtr><DbtrAcct><Id><IBAN>%s</IBAN></Id></DbtrAcct><DbtrAgt><FinInstnId>",
+            source_iban);
+    if (source_bic != NULL && *source_bic != '\0')
+        g_string_append_printf(buffer, "<BIC>%s</BIC>", source_bic);
+    else
+        g_string_append(buffer, "<Othr><Id>" NOT_PROVIDED "</Id></Othr>");
+    g_string_append(buffer, "</FinInstnId></DbtrAgt><ChrgBr>SLEV</ChrgBr>\n");
+    g_free(amount);
+    g_free(created);
+
+    for (i = 0; i < n_transfers; i++) {
+        const GHbciTransfer* transfer = &transfers[i];
+        gint64 cents = 0;
+
+        ghbci_transfer_parse_amount(transfer->amount, &cents);
+        amount = ghbci_transfer_format_amount(cents);
+
+        g_string_append(buffer, "<CdtTrfTxInf><PmtId>");
+        append_escaped(buffer, "EndToEndId", transfer->end_to_end_id != NULL ? transfer->end_to_end_id : NOT_PROVIDED);
+        g_string_append_printf(buffer, "</PmtId><Amt><InstdAmt Ccy=\"EUR\">%s</InstdAmt></Amt>", amount);
+        if (transfer->bic != NULL && *transfer->bic != '\0')
+            g_string_append_printf(buffer, "<CdtrAgt><FinInstnId><BIC>%s</BIC></FinInstnId></CdtrAgt>", transfer->bic);
+        g_string_append(buffer, "<Cdtr>");
+        append_escaped(buffer, "Nm", transfer->name);
+        g_string_append_printf(buffer, "</Cdtr><CdtrAcct><Id><IBAN>%s</IBAN></Id></CdtrAcct>", transfer->iban);
+        if (transfer->reference != NULL && *transfer->reference != '\0') {
+            g_string_append(buffer, "<RmtInf>");
+            append_escaped(buffer, "Ustrd", transfer->reference);
+            g_string_append(buffer, "</RmtInf>");
+        }
+        g_string_append(buffer, "</CdtTrfTxInf>\n");
+        g_free(amount);
+
+        if (!flush_buffer(stream, buffer, PAIN_CHUNK_SIZE, cancellable, error)) {
+            g_string_free(buffer, TRUE);
+            return FALSE;
+        }
+    }
+
+    g_string_append(buffer, "</PmtInf>\n</CstmrCdtTrfInitn>\n</Document>\n");
+    gboolean result = flush_buffer(stream, buffer, 0, cancellable, error);
+    g_string_free(buffer, TRUE);
+    return result;
+}
+
+
+// vim: sw=4 expandtab
@@ -0,0 +1,70 @@
+/*
+ * ghbci-transfer.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_TRANSFER_H__
+#define __GHBCI_TRANSFER_H__
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GHbciTransfer GHbciTransfer;
+
+#define GHBCI_TYPE_TRANSFER            (ghbci_transfer_get_type ())
+
+/**
+ * GHbciTransfer:
+ * @name: name of the recipient
+ * @bic: (nullable): BIC of the recipient's bank, may be omitted within the EEA
+ * @iban: IBAN of the recipient
+ * @reference: (nullable): remittance information, up to 140 characters
+ * @amount: amount in EUR, e.g. "1234.56"
+ * @end_to_end_id: (nullable): reference of the payer passed to the recipient
+ *
+ * One SEPA credit transfer from the account given to
+ * ghbci_context_send_transfers()
+ **/
+struct _GHbciTransfer
+{
+    gchar* name;
+    gchar* bic;
+    gchar* iban;
+    gchar* reference;
+    gchar* amount;
+    gchar* end_to_end_id;
+};
+
+GType             ghbci_transfer_get_type                     (void) G_GNUC_CONST;
+
+GHbciTransfer*    ghbci_transfer_copy                         (GHbciTransfer* self);
+
+void              ghbci_transfer_free                         (GHbciTransfer* self);
+
+gboolean          ghbci_transfer_validate                     (const GHbciTransfer* self, GError** error);
+
+gboolean          ghbci_transfer_write_pain001                (GOutputStream* stream, const gchar* message_id,
+                                                               const gchar* source_name, const gchar* source_bic,
+                                                               const gchar* source_iban, const GHbciTransfer* transfers,
+                                                               guint n_transfers, gboolean batch_booking,
+                                                               GCancellable* cancellable, GError** error);
+
+G_END_DECLS
+
+#endif /* __GHBCI_TRANSFER_H__ */
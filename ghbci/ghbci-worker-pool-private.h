@@ -0,0 +1,145 @@
+/*
+ * ghbci-worker-pool-private.h
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __GHBCI_WORKER_POOL_PRIVATE_H__
+#define __GHBCI_WORKER_POOL_PRIVATE_H__
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "ghbci-context.h"
+#include "ghbci-string-pool-private.h"
+#include "ghbci-transfer.h"
+#include "ghbci-standing-order.h"
+#include "ghbci-status.h"
+
+/* largest message on the socket, larger ones and bulk data go through a memfd */
+#define GHBCI_WORKER_MESSAGE_MAX    65536
+
+/* a transfer: name, bic, iban, reference, amount, end to end id */
+#define GHBCI_WORKER_TRANSFER_TYPE  "(msmsmsmsmsms)"
+/* a standing order: order id, transfer, julian first and last date (0 if
+ * none), time unit, turnus, execution day */
+#define GHBCI_WORKER_ORDER_TYPE     "(ms" GHBCI_WORKER_TRANSFER_TYPE "uuyuu)"
+/* a status event: tag, text, job name, dialog id, message name, message
+ * size, raw message, dialog bytes sent and received */
+#define GHBCI_WORKER_STATUS_TYPE    "(xsmsmsmstmstt)"
+
+/*
+ * Kinds of messages between a context and its workers. Every request is
+ * answered with REPLY or ERROR, a worker may send CALLBACK messages before,
+ * each answered with ANSWER, and LOG and STATUS messages, which are not
+ * answered.
+ */
+typedef enum {
+    GHBCI_WORKER_ADD_PASSPORT = 1,      /* (ss) blz, userid; reply () */
+    GHBCI_WORKER_GET_BALANCES = 2,      /* (sss) blz, userid, number; reply ms */
+    GHBCI_WORKER_GET_STATEMENTS = 3,    /* (sssb) blz, userid, number, native mt940; reply () with memfd */
+    GHBCI_WORKER_CALLBACK = 4,          /* (xss) reason, message, optional */
+    GHBCI_WORKER_ANSWER = 5,            /* ms answer, nothing to abort */
+    GHBCI_WORKER_REPLY = 6,
+    GHBCI_WORKER_ERROR = 7,             /* (siumss) domain, code, retry hint, segment, message */
+    GHBCI_WORKER_GET_ACCOUNTS = 8,      /* (ss) blz, userid; reply aa{ss} properties of each account */
+    GHBCI_WORKER_GET_TAN_METHODS = 9,   /* (ss) blz, userid; reply a{ss} */
+    GHBCI_WORKER_SEND_TRANSFER = 10,    /* (ssssss TRANSFER u) blz, userid, number, source name, bic and iban,
+                                           julian execution date or 0; reply ms order id */
+    GHBCI_WORKER_SEND_TRANSFERS = 11,   /* (ssssssa TRANSFER) blz, userid, number, source; reply () */
+    GHBCI_WORKER_CREATE_STANDING_ORDER = 12,    /* (ssssss ORDER) blz, userid, number, source; reply ms */
+    GHBCI_WORKER_GET_STANDING_ORDERS = 13,      /* (sssss) blz, userid, number, bic, iban; reply a ORDER */
+    GHBCI_WORKER_VALIDATE_PAIN001 = 14, /* ay document; reply () */
+    GHBCI_WORKER_SET_OPTIONS = 15,      /* (ib) log level, capture raw messages; reply () */
+    GHBCI_WORKER_LOG = 16,              /* (ixss) level, time, dialog id, message */
+    GHBCI_WORKER_STATUS = 17,           /* STATUS */
+    GHBCI_WORKER_LARGE = 18,            /* () with a memfd of a larger (uv) message, see ghbci_worker_send() */
+    GHBCI_WORKER_GET_BANK = 19,         /* s blz; reply (ss) name and pin/tan url, "" if unknown */
+    GHBCI_WORKER_LIST_BANKS = 20,       /* (); reply as blz of each bank */
+} GHbciWorkerMessage;
+
+/*
+ * Answers a callback of a worker on the thread of the request, NULL aborts
+ */
+typedef gchar* (*GHbciWorkerCallbackFunc) (const gchar* blz, const gchar* userid, gint reason,
+        const gchar* message, const gchar* optional, gpointer user_data);
+
+/*
+ * Passes on a LOG or STATUS message of a worker, on the thread of the
+ * request
+ */
+typedef void (*GHbciWorkerEventFunc) (GHbciWorkerMessage kind, GVariant* body, gpointer user_data);
+
+typedef struct _GHbciWorkerPool GHbciWorkerPool;
+
+const gchar*      ghbci_worker_body_type                      (GHbciWorkerMessage kind);
+
+gboolean          ghbci_worker_send                           (GSocket* socket, GHbciWorkerMessage kind, GVariant* body,
+                                                               gint fd, GError** error);
+
+gboolean          ghbci_worker_receive                        (GSocket* socket, gint64 timeout, GHbciWorkerMessage* kind,
+                                                               GVariant** body, gint* fd, GError** error);
+
+GVariant*         ghbci_worker_error_to_variant               (const GError* error);
+
+void              ghbci_worker_propagate_variant_error        (GError** error, GVariant* body);
+
+gint              ghbci_worker_write_statements               (GSList* statements, GError** error);
+
+GSList*           ghbci_worker_read_statements                (gint fd, GHbciStringPool* pool, GError** error);
+
+GVariant*         ghbci_worker_transfer_to_variant            (const GHbciTransfer* transfer);
+
+void              ghbci_worker_transfer_from_variant          (GVariant* variant, GHbciTransfer* transfer);
+
+GVariant*         ghbci_worker_standing_order_to_variant      (const GHbciStandingOrder* order);
+
+GHbciStandingOrder* ghbci_worker_standing_order_from_variant  (GVariant* variant);
+
+GVariant*         ghbci_worker_status_to_variant              (gint64 tag, const gchar* text,
+                                                               const GHbciStatusPayload* payload);
+
+GHbciStatusPayload* ghbci_worker_status_from_variant          (GVariant* variant, gchar** text);
+
+GVariant*         ghbci_worker_run_request                    (GHbciContext* context, GHbciWorkerMessage kind,
+                                                               GVariant* body, gint* fd, GError** error);
+
+GHbciWorkerPool*  ghbci_worker_pool_new                       (const gchar* directory, guint n_workers,
+                                                               GHbciWorkerCallbackFunc callback,
+                                                               GHbciWorkerEventFunc event, gpointer user_data,
+                                                               GError** error);
+
+void              ghbci_worker_pool_free                      (GHbciWorkerPool* self);
+
+void              ghbci_worker_pool_set_options               (GHbciWorkerPool* self, gint log_level,
+                                                               gboolean capture_raw_messages);
+
+GVariant*         ghbci_worker_pool_request                   (GHbciWorkerPool* self, const gchar* blz,
+                                                               const gchar* userid, GHbciWorkerMessage kind,
+                                                               GVariant* body, GError** error);
+
+gboolean          ghbci_worker_pool_add_passport              (GHbciWorkerPool* self, const gchar* blz,
+                                                               const gchar* userid, GError** error);
+
+gchar*            ghbci_worker_pool_get_balances              (GHbciWorkerPool* self, const gchar* blz,
+                                                               const gchar* userid, const gchar* number,
+                                                               GError** error);
+
+GSList*           ghbci_worker_pool_get_statements            (GHbciWorkerPool* self, const gchar* blz,
+                                                               const gchar* userid, const gchar* number,
+                                                               gboolean native_mt940, GHbciStringPool* pool,
+                                                               GError** error);
+
+#endif /* __GHBCI_WORKER_POOL_PRIVATE_H__ */
@@ -0,0 +1,982 @@
+/*
+ * ghbci-worker-pool.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/*
+ * Worker processes of ghbci_context_new_with_workers(), each running
+ * ghbci-worker with its own jvm.
+ *
+ * A worker talks to its context over a unix socket pair of type
+ * SOCK_SEQPACKET, so every message is a single GVariant "(uv)" of kind and
+ * body. Statement batches don't go through the socket: the worker
+ * serializes them into a sealed memfd and passes the descriptor along with
+ * the reply, the context maps it and copies the statements out of it.
+ * Messages larger than GHBCI_WORKER_MESSAGE_MAX, like many transfers or a
+ * captured raw message, take the same way in a GHBCI_WORKER_LARGE. Log
+ * messages and status events of a request are passed on as they happen, so
+ * a context with workers emits the same signals as one with its own jvm.
+ *
+ * Each passport belongs to one worker, the one with the fewest passports
+ * when it is added, so hbci4java never sees a passport file in two jvms.
+ * A worker runs one request at a time. If it crashes or doesn't answer for
+ * WORKER_TIMEOUT, it is killed, the request fails with GHBCI_ERROR_WORKER
+ * and the next request starts a new one, which adds the passports of the
+ * old one again first.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+#include <gio/gunixfdmessage.h>
+
+#include "ghbci-worker-pool-private.h"
+#include "ghbci-statement.h"
+#include "ghbci-statement-private.h"
+#include "ghbci-error.h"
+#include "ghbci-error-private.h"
+
+/* seconds a worker may be silent during a request, before it is killed */
+#define WORKER_TIMEOUT      600
+/* a statement of a batch, see ghbci_worker_write_statements() */
+#define STATEMENT_TYPE      "(uumsmsmsmsmsmsmsmsmsmsms)"
+#define STATEMENT_BORROWED  "(uum&sm&sm&sm&sm&sm&sm&sm&sm&sm&sm&s)"
+/* seals a memfd must have, so the sender can't change it while mapped */
+#define BATCH_SEALS         (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE)
+
+typedef struct
+{
+    /* held for a whole request */
+    GMutex lock;
+    guint index;
+    GSubprocess* process;
+    GSocket* socket;
+    /* passports added successfully, as { blz, userid } */
+    GPtrArray* passports;
+    /* passports added successfully, of this and earlier processes */
+    guint assigned;
+    /* passports have to be added again, the process was restarted */
+    gboolean replay;
+    /* options_serial of the pool the process got */
+    guint options_serial;
+} Worker;
+
+struct _GHbciWorkerPool
+{
+    Worker* workers;
+    guint n_workers;
+    gchar* program;
+    /* shared by the workers, passport files are named by blz and userid */
+    gchar* directory;
+    GHbciWorkerCallbackFunc callback;
+    GHbciWorkerEventFunc event;
+    gpointer user_data;
+
+    GMutex lock;
+    /* "blz+userid" to the worker of the passport */
+    GHashTable* assignments;
+    /* passed to each worker before its next request, see ghbci_worker_pool_set_options() */
+    gint log_level;
+    gboolean capture_raw_messages;
+    guint options_serial;
+};
+
+
+/*
+ * Body type of a message kind, NULL if it depends on the request
+ */
+const gchar*
+ghbci_worker_body_type (GHbciWorkerMessage kind)
+{
+    switch (kind) {
+    case GHBCI_WORKER_ADD_PASSPORT:
+    case GHBCI_WORKER_GET_ACCOUNTS:
+    case GHBCI_WORKER_GET_TAN_METHODS:
+        return "(ss)";
+    case GHBCI_WORKER_GET_BALANCES:
+        return "(sss)";
+    case GHBCI_WORKER_GET_STATEMENTS:
+        return "(sssb)";
+    case GHBCI_WORKER_CALLBACK:
+        return "(xss)";
+    case GHBCI_WORKER_ANSWER:
+        return "ms";
+    case GHBCI_WORKER_ERROR:
+        return "(siumss)";
+    case GHBCI_WORKER_SEND_TRANSFER:
+        return "(ssssss" GHBCI_WORKER_TRANSFER_TYPE "u)";
+    case GHBCI_WORKER_SEND_TRANSFERS:
+        return "(ssssssa" GHBCI_WORKER_TRANSFER_TYPE ")";
+    case GHBCI_WORKER_CREATE_STANDING_ORDER:
+        return "(ssssss" GHBCI_WORKER_ORDER_TYPE ")";
+    case GHBCI_WORKER_GET_STANDING_ORDERS:
+        return "(sssss)";
+    case GHBCI_WORKER_VALIDATE_PAIN001:
+        return "ay";
+    case GHBCI_WORKER_SET_OPTIONS:
+        return "(ib)";
+    case GHBCI_WORKER_GET_BANK:
+        return "s";
+    case GHBCI_WORKER_LOG:
+        return "(ixss)";
+    case GHBCI_WORKER_STATUS:
+        return GHBCI_WORKER_STATUS_TYPE;
+    case GHBCI_WORKER_LARGE:
+    case GHBCI_WORKER_LIST_BANKS:
+        return "()";
+    default:
+        return NULL;
+    }
+}
+
+/*
+ * Serialize value into a new sealed memfd, returns it or -1
+ */
+static gint
+write_sealed (GVariant* value, const gchar* what, GError** error)
+{
+    gsize size = g_variant_get_size(value);
+    gint saved_errno;
+    gint fd;
+
+    fd = memfd_create(what, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0 || ftruncate(fd, size) < 0)
+        goto failed;
+    if (size > 0) {
+        // serialized straight into the shared pages
+        gpointer data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED)
+            goto failed;
+        g_variant_store(value, data);
+        munmap(data, size);
+    }
+    if (fcntl(fd, F_ADD_SEALS, BATCH_SEALS | F_SEAL_SEAL) < 0)
+        goto failed;
+    return fd;
+
+failed:
+    saved_errno = errno;
+    g_set_error(error, G_IO_ERROR, g_io_error_from_errno(saved_errno), "writing %s failed: %s", what,
+            g_strerror(saved_errno));
+    if (fd >= 0)
+        close(fd);
+    return -1;
+}
+
+typedef struct
+{
+    gpointer data;
+    gsize size;
+} Mapping;
+
+static void
+mapping_free (gpointer user_data)
+{
+    Mapping* mapping = user_data;
+
+    munmap(mapping->data, mapping->size);
+    g_free(mapping);
+}
+
+/*
+ * Map a memfd of write_sealed() as a value of type, which holds the
+ * mapping. Doesn't close fd.
+ */
+static GVariant*
+read_sealed (gint fd, const GVariantType* type, const gchar* what, GError** error)
+{
+    struct stat info;
+
+    if (fstat(fd, &info) < 0) {
+        g_set_error(error, G_IO_ERROR, g_io_error_from_errno(errno), "reading %s failed: %s", what,
+                g_strerror(errno));
+        return NULL;
+    }
+    gint seals = fcntl(fd, F_GET_SEALS);
+    if (seals < 0 || (seals & BATCH_SEALS) != BATCH_SEALS) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "the %s memfd is not sealed", what);
+        return NULL;
+    }
+    if (info.st_size == 0)
+        return g_variant_ref_sink(g_variant_new_from_data(type, NULL, 0, FALSE, NULL, NULL));
+
+    Mapping* mapping = g_new(Mapping, 1);
+    mapping->size = info.st_size;
+    mapping->data = mmap(NULL, mapping->size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping->data == MAP_FAILED) {
+        g_set_error(error, G_IO_ERROR, g_io_error_from_errno(errno), "reading %s failed: %s", what,
+                g_strerror(errno));
+        g_free(mapping);
+        return NULL;
+    }
+    return g_variant_ref_sink(g_variant_new_from_data(type, mapping->data, mapping->size, FALSE,
+                mapping_free, mapping));
+}
+
+/*
+ * Send a message with an optional file descriptor, fd is -1 if there is
+ * none. A floating body is consumed. Messages larger than
+ * GHBCI_WORKER_MESSAGE_MAX are passed in a memfd, but can't carry a
+ * descriptor then.
+ */
+gboolean
+ghbci_worker_send (GSocket* socket, GHbciWorkerMessage kind, GVariant* body, gint fd, GError** error)
+{
+    GSocketControlMessage* fd_message = NULL;
+    GOutputVector vector;
+    gssize sent = -1;
+
+    g_return_val_if_fail (G_IS_SOCKET (socket), FALSE);
+    g_return_val_if_fail (body != NULL, FALSE);
+
+    GVariant* message = g_variant_ref_sink(g_variant_new("(uv)", kind, body));
+    vector.buffer = g_variant_get_data(message);
+    vector.size = g_variant_get_size(message);
+
+    if (vector.size > GHBCI_WORKER_MESSAGE_MAX && fd < 0) {
+        gint large_fd = write_sealed(message, "message", error);
+        if (large_fd >= 0) {
+            if (ghbci_worker_send(socket, GHBCI_WORKER_LARGE, g_variant_new("()"), large_fd, error))
+                sent = vector.size;
+            close(large_fd);
+        }
+        goto cleanup;
+    }
+    if (vector.size > GHBCI_WORKER_MESSAGE_MAX) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_MESSAGE_TOO_LARGE, "message of %" G_GSIZE_FORMAT " bytes",
+                vector.size);
+        goto cleanup;
+    }
+    if (fd >= 0) {
+        fd_message = g_unix_fd_message_new();
+        if (!g_unix_fd_message_append_fd(G_UNIX_FD_MESSAGE(fd_message), fd, error))
+            goto cleanup;
+    }
+    sent = g_socket_send_message(socket, NULL, &vector, 1, fd_message != NULL ? &fd_message : NULL,
+            fd_message != NULL ? 1 : 0, G_SOCKET_MSG_NONE, NULL, error);
+
+cleanup:
+    g_clear_object(&fd_message);
+    g_variant_unref(message);
+    return sent >= 0;
+}
+
+/*
+ * Wait up to timeout microseconds, or forever if it is -1, for the next
+ * message. Fails with G_IO_ERROR_CONNECTION_CLOSED if the other side is
+ * gone. A file descriptor sent along is stored in fd, -1 if there is none.
+ */
+gboolean
+ghbci_worker_receive (GSocket* socket, gint64 timeout, GHbciWorkerMessage* kind, GVariant** body, gint* fd,
+        GError** error)
+{
+    GSocketControlMessage** messages = NULL;
+    GInputVector vector;
+    gint n_messages = 0;
+    gint flags = 0;
+    gint received_fd = -1;
+    guint32 received_kind;
+    gssize length;
+    gint i, j;
+
+    g_return_val_if_fail (G_IS_SOCKET (socket), FALSE);
+    g_return_val_if_fail (kind != NULL && body != NULL && fd != NULL, FALSE);
+
+    *fd = -1;
+    if (!g_socket_condition_timed_wait(socket, G_IO_IN, timeout, NULL, error))
+        return FALSE;
+
+    gchar* buffer = g_malloc(GHBCI_WORKER_MESSAGE_MAX);
+    vector.buffer = buffer;
+    vector.size = GHBCI_WORKER_MESSAGE_MAX;
+    length = g_socket_receive_message(socket, NULL, &vector, 1, &messages, &n_messages, &flags, NULL, error);
+
+    // take the descriptors first, none may leak
+    for (i = 0; i < n_messages; i++) {
+        if (G_IS_UNIX_FD_MESSAGE(messages[i])) {
+            gint n_fds;
+            gint* fds = g_unix_fd_message_steal_fds(G_UNIX_FD_MESSAGE(messages[i]), &n_fds);
+            for (j = 0; j < n_fds; j++) {
+                if (received_fd < 0)
+                    received_fd = fds[j];
+                else
+                    close(fds[j]);
+            }
+            g_free(fds);
+        }
+        g_object_unref(messages[i]);
+    }
+    g_free(messages);
+
+    if (length <= 0 || (flags & MSG_TRUNC)) {
+        if (length == 0)
+            g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_CONNECTION_CLOSED, "connection closed");
+        else if (length > 0)
+            g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_MESSAGE_TOO_LARGE, "message truncated");
+        goto failed;
+    }
+
+    GVariant* message = g_variant_ref_sink(g_variant_new_from_data(G_VARIANT_TYPE("(uv)"), buffer, length,
+            FALSE, g_free, buffer));
+    buffer = NULL;
+    g_variant_get(message, "(uv)", &received_kind, body);
+    g_variant_unref(message);
+
+    // the actual message is in the memfd
+    if (received_kind == GHBCI_WORKER_LARGE && received_fd >= 0) {
+        g_variant_unref(*body);
+        *body = NULL;
+        message = read_sealed(received_fd, G_VARIANT_TYPE("(uv)"), "message", error);
+        close(received_fd);
+        received_fd = -1;
+        if (message == NULL)
+            goto failed;
+        g_variant_get(message, "(uv)", &received_kind, body);
+        g_variant_unref(message);
+    }
+
+    const gchar* type = ghbci_worker_body_type(received_kind);
+    if ((type == NULL && received_kind != GHBCI_WORKER_REPLY) || received_kind == GHBCI_WORKER_LARGE
+            || (type != NULL && !g_variant_is_of_type(*body, G_VARIANT_TYPE(type)))) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "invalid message of kind %u", received_kind);
+        g_variant_unref(*body);
+        *body = NULL;
+        goto failed;
+    }
+    *kind = received_kind;
+    *fd = received_fd;
+    return TRUE;
+
+failed:
+    g_free(buffer);
+    if (received_fd >= 0)
+        close(received_fd);
+    return FALSE;
+}
+
+/*
+ * Body of an ERROR message, keeps segment and retry hint of ghbci errors
+ */
+GVariant*
+ghbci_worker_error_to_variant (const GError* error)
+{
+    const gchar* segment = NULL;
+    GHbciRetryHint retry_hint = GHBCI_RETRY_HINT_NEVER;
+
+    g_return_val_if_fail (error != NULL, NULL);
+
+    if (error->domain == GHBCI_ERROR) {
+        segment = ghbci_error_get_segment(error);
+        retry_hint = ghbci_error_get_retry_hint(error);
+    }
+    return g_variant_new("(siumss)", g_quark_to_string(error->domain), error->code, retry_hint, segment,
+            error->message);
+}
+
+/*
+ * Recreate the error of an ERROR message
+ */
+void
+ghbci_worker_propagate_variant_error (GError** error, GVariant* body)
+{
+    const gchar* domain;
+    const gchar* segment;
+    const gchar* message;
+    gint code;
+    guint32 retry_hint;
+
+    g_variant_get(body, "(&sium&s&s)", &domain, &code, &retry_hint, &segment, &message);
+    if (g_quark_from_string(domain) == GHBCI_ERROR)
+        ghbci_set_error(error, code, segment, retry_hint, "%s", message);
+    else
+        g_set_error_literal(error, g_quark_from_string(domain), code, message);
+}
+
+GVariant*
+ghbci_worker_transfer_to_variant (const GHbciTransfer* transfer)
+{
+    return g_variant_new(GHBCI_WORKER_TRANSFER_TYPE, transfer->name, transfer->bic, transfer->iban,
+            transfer->reference, transfer->amount, transfer->end_to_end_id);
+}
+
+/*
+ * Fill transfer with copies of the fields in variant
+ */
+void
+ghbci_worker_transfer_from_variant (GVariant* variant, GHbciTransfer* transfer)
+{
+    g_variant_get(variant, GHBCI_WORKER_TRANSFER_TYPE, &transfer->name, &transfer->bic, &transfer->iban,
+            &transfer->reference, &transfer->amount, &transfer->end_to_end_id);
+}
+
+static guint32
+date_to_julian (const GDate* date)
+{
+    return date != NULL && g_date_valid(date) ? g_date_get_julian(date) : 0;
+}
+
+GVariant*
+ghbci_worker_standing_order_to_variant (const GHbciStandingOrder* order)
+{
+    const GHbciTransfer* transfer = &order->transfer;
+
+    return g_variant_new(GHBCI_WORKER_ORDER_TYPE, order->order_id, transfer->name, transfer->bic,
+            transfer->iban, transfer->reference, transfer->amount, transfer->end_to_end_id,
+            date_to_julian(order->first_date), date_to_julian(order->last_date), (guchar)order->time_unit,
+            order->turnus, order->exec_day);
+}
+
+GHbciStandingOrder*
+ghbci_worker_standing_order_from_variant (GVariant* variant)
+{
+    GHbciStandingOrder* order = g_new0(GHbciStandingOrder, 1);
+    GHbciTransfer* transfer = &order->transfer;
+    guint32 first_date, last_date;
+    guchar time_unit;
+
+    g_variant_get(variant, GHBCI_WORKER_ORDER_TYPE, &order->order_id, &transfer->name, &transfer->bic,
+            &transfer->iban, &transfer->reference, &transfer->amount, &transfer->end_to_end_id, &first_date,
+            &last_date, &time_unit, &order->turnus, &order->exec_day);
+    order->time_unit = time_unit;
+    if (g_date_valid_julian(first_date))
+        order->first_date = g_date_new_julian(first_date);
+    if (g_date_valid_julian(last_date))
+        order->last_date = g_date_new_julian(last_date);
+    return order;
+}
+
+GVariant*
+ghbci_worker_status_to_variant (gint64 tag, const gchar* text, const GHbciStatusPayload* payload)
+{
+    return g_variant_new(GHBCI_WORKER_STATUS_TYPE, tag, text != NULL ? text : "", payload->job_name,
+            payload->dialog_id, payload->message_name, (guint64)payload->message_size, payload->raw_message,
+            payload->dialog_bytes_sent, payload->dialog_bytes_received);
+}
+
+/*
+ * The payload of a STATUS message, text is set to the text of the event
+ */
+GHbciStatusPayload*
+ghbci_worker_status_from_variant (GVariant* variant, gchar** text)
+{
+    GHbciStatusPayload* payload;
+    guint64 message_size;
+    gint64 tag;
+
+    g_variant_get_child(variant, 0, "x", &tag);
+    payload = ghbci_status_payload_new(tag);
+    g_variant_get(variant, GHBCI_WORKER_STATUS_TYPE, NULL, text, &payload->job_name, &payload->dialog_id,
+            &payload->message_name, &message_size, &payload->raw_message, &payload->dialog_bytes_sent,
+            &payload->dialog_bytes_received);
+    payload->message_size = message_size;
+    return payload;
+}
+
+/*
+ * Serialize statements into a sealed memfd, returns it or -1
+ */
+gint
+ghbci_worker_write_statements (GSList* statements, GError** error)
+{
+    GVariantBuilder builder;
+    GSList* iter;
+    gint fd;
+
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("a" STATEMENT_TYPE));
+    for (iter = statements; iter != NULL; iter = iter->next) {
+        GHbciStatementPrivate* priv = GHBCI_STATEMENT(iter->data)->priv;
+        g_variant_builder_add(&builder, STATEMENT_TYPE, priv->valuta, priv->booking_date, priv->value,
+                priv->saldo, priv->gv_code, priv->transaction_type, priv->other_name, priv->other_iban,
+                priv->other_bic, priv->reference, priv->eref, priv->mref, priv->cred);
+    }
+    GVariant* batch = g_variant_ref_sink(g_variant_builder_end(&builder));
+    fd = write_sealed(batch, "statements", error);
+    g_variant_unref(batch);
+    return fd;
+}
+
+/*
+ * Statements of a batch ghbci_worker_write_statements() wrote, their
+ * pooled fields go to pool. Doesn't close fd.
+ */
+GSList*
+ghbci_worker_read_statements (gint fd, GHbciStringPool* pool, GError** error)
+{
+    GSList* statements = NULL;
+    GVariantIter iter;
+    guint32 valuta, booking_date;
+    const gchar *value, *saldo, *gv_code, *transaction_type, *other_name, *other_iban, *other_bic;
+    const gchar *reference, *eref, *mref, *cred;
+
+    // the strings are read in place, they are copied into the statements only
+    GVariant* batch = read_sealed(fd, G_VARIANT_TYPE("a" STATEMENT_TYPE), "statements", error);
+    if (batch == NULL)
+        return NULL;
+    g_variant_iter_init(&iter, batch);
+    while (g_variant_iter_next(&iter, STATEMENT_BORROWED, &valuta, &booking_date, &value, &saldo, &gv_code,
+                &transaction_type, &other_name, &other_iban, &other_bic, &reference, &eref, &mref, &cred)) {
+        GHbciStatement* statement = ghbci_statement_new_structured(pool, valuta, booking_date, g_strdup(value),
+                g_strdup(saldo), g_strdup(gv_code), g_strdup(transaction_type), g_strdup(other_name),
+                g_strdup(other_iban), g_strdup(other_bic), g_strdup(reference), g_strdup(eref), g_strdup(mref),
+                g_strdup(cred));
+        statements = g_slist_prepend(statements, statement);
+    }
+    g_variant_unref(batch);
+    return g_slist_reverse(statements);
+}
+
+
+static void
+worker_stop (Worker* worker)
+{
+    if (worker->socket != NULL)
+        g_socket_close(worker->socket, NULL);
+    g_clear_object(&worker->socket);
+    if (worker->process != NULL)
+        g_subprocess_force_exit(worker->process);
+    g_clear_object(&worker->process);
+}
+
+static gboolean
+worker_spawn (GHbciWorkerPool* self, Worker* worker, GError** error)
+{
+    GError* spawn_error = NULL;
+    gint fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) < 0) {
+        ghbci_set_error(error, GHBCI_ERROR_WORKER, NULL, GHBCI_RETRY_HINT_RETRY,
+                "creating socket for worker %u failed: %s", worker->index, g_strerror(errno));
+        return FALSE;
+    }
+
+    // the launcher closes its end after spawning
+    GSubprocessLauncher* launcher = g_subprocess_launcher_new(G_SUBPROCESS_FLAGS_NONE);
+    g_subprocess_launcher_take_fd(launcher, fds[1], 3);
+    gchar* directory = g_strconcat("--directory=", self->directory, NULL);
+    worker->process = g_subprocess_launcher_spawn(launcher, &spawn_error, self->program, "--fd=3", directory,
+            NULL);
+    g_free(directory);
+    g_object_unref(launcher);
+
+    worker->options_serial = 0;
+    if (worker->process != NULL)
+        worker->socket = g_socket_new_from_fd(fds[0], &spawn_error);
+    if (worker->socket == NULL) {
+        ghbci_set_error(error, GHBCI_ERROR_WORKER, NULL, GHBCI_RETRY_HINT_RETRY,
+                "starting worker %u failed: %s", worker->index, spawn_error->message);
+        g_error_free(spawn_error);
+        close(fds[0]);
+        worker_stop(worker);
+        return FALSE;
+    }
+    g_debug("worker %u started", worker->index);
+    return TRUE;
+}
+
+/*
+ * Run a request on a worker and wait for its reply, answering the callbacks
+ * of the worker meanwhile. A worker failing is stopped, its state is
+ * unknown then. The body is consumed if floating, fd may be NULL if the
+ * reply has no descriptor.
+ */
+static gboolean
+worker_request (GHbciWorkerPool* self, Worker* worker, const gchar* blz, const gchar* userid,
+        GHbciWorkerMessage kind, GVariant* body, GVariant** reply, gint* fd, GError** error)
+{
+    GError* worker_error = NULL;
+    GHbciWorkerMessage received;
+    GVariant* message = NULL;
+    gint received_fd = -1;
+
+    g_variant_ref_sink(body);
+    if (!ghbci_worker_send(worker->socket, kind, body, -1, &worker_error))
+        goto failed;
+
+    for (;;) {
+        if (!ghbci_worker_receive(worker->socket, WORKER_TIMEOUT * G_TIME_SPAN_SECOND, &received, &message,
+                    &received_fd, &worker_error))
+            goto failed;
+        if (received == GHBCI_WORKER_LOG || received == GHBCI_WORKER_STATUS) {
+            if (self->event != NULL)
+                self->event(received, message, self->user_data);
+            g_variant_unref(message);
+            if (received_fd >= 0)
+                close(received_fd);
+            received_fd = -1;
+            continue;
+        }
+        if (received != GHBCI_WORKER_CALLBACK)
+            break;
+
+        gint64 reason;
+        const gchar* text;
+        const gchar* optional;
+        g_variant_get(message, "(x&s&s)", &reason, &text, &optional);
+        // requests of no passport have nobody to ask
+        gchar* answer = blz != NULL ? self->callback(blz, userid, reason, text, optional, self->user_data) : NULL;
+        g_variant_unref(message);
+        gboolean sent = ghbci_worker_send(worker->socket, GHBCI_WORKER_ANSWER,
+                g_variant_new_maybe(G_VARIANT_TYPE_STRING, answer != NULL ? g_variant_new_string(answer) : NULL),
+                -1, &worker_error);
+        g_free(answer);
+        if (received_fd >= 0)
+            close(received_fd);
+        received_fd = -1;
+        if (!sent)
+            goto failed;
+    }
+
+    if (received == GHBCI_WORKER_ERROR) {
+        ghbci_worker_propagate_variant_error(error, message);
+        g_variant_unref(message);
+    } else if (received == GHBCI_WORKER_REPLY) {
+        *reply = message;
+        if (fd != NULL) {
+            *fd = received_fd;
+            received_fd = -1;
+        }
+    } else {
+        g_variant_unref(message);
+        g_set_error(&worker_error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "unexpected message of kind %u", received);
+        goto failed;
+    }
+    if (received_fd >= 0)
+        close(received_fd);
+    g_variant_unref(body);
+    return received == GHBCI_WORKER_REPLY;
+
+failed:
+    g_warning("worker %u failed, stopping it: %s", worker->index, worker_error->message);
+    ghbci_set_error(error, GHBCI_ERROR_WORKER, NULL, GHBCI_RETRY_HINT_RETRY, "worker %u failed: %s",
+            worker->index, worker_error->message);
+    g_error_free(worker_error);
+    worker_stop(worker);
+    worker->replay = TRUE;
+    g_variant_unref(body);
+    return FALSE;
+}
+
+/*
+ * Make sure a worker runs, has the current options and knows its
+ * passports, the lock of the worker has to be held
+ */
+static gboolean
+worker_prepare (GHbciWorkerPool* self, Worker* worker, GError** error)
+{
+    GVariant* reply;
+    gint log_level;
+    gboolean capture_raw_messages;
+    guint serial;
+    guint i;
+
+    if (worker->process == NULL && !worker_spawn(self, worker, error))
+        return FALSE;
+
+    g_mutex_lock(&self->lock);
+    serial = self->options_serial;
+    log_level = self->log_level;
+    capture_raw_messages = self->capture_raw_messages;
+    g_mutex_unlock(&self->lock);
+    if (worker->options_serial != serial) {
+        if (!worker_request(self, worker, NULL, NULL, GHBCI_WORKER_SET_OPTIONS,
+                    g_variant_new("(ib)", log_level, capture_raw_messages), &reply, NULL, error))
+            return FALSE;
+        g_variant_unref(reply);
+        worker->options_serial = serial;
+    }
+
+    if (worker->replay) {
+        for (i = 0; i < worker->passports->len; i++) {
+            gchar** passport = g_ptr_array_index(worker->passports, i);
+            if (!worker_request(self, worker, passport[0], passport[1], GHBCI_WORKER_ADD_PASSPORT,
+                        g_variant_new("(ss)", passport[0], passport[1]), &reply, NULL, error))
+                return FALSE;
+            g_variant_unref(reply);
+        }
+        worker->replay = FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ * The worker of a passport, a new passport is assigned to the worker with
+ * the fewest passports if assign is set. NULL if it has none.
+ */
+static Worker*
+get_worker (GHbciWorkerPool* self, const gchar* blz, const gchar* userid, gboolean assign)
+{
+    Worker* worker;
+    guint i;
+
+    gchar* key = g_strconcat(blz, "+", userid, NULL);
+    g_mutex_lock(&self->lock);
+    worker = g_hash_table_lookup(self->assignments, key);
+    if (worker == NULL && assign) {
+        worker = &self->workers[0];
+        for (i = 1; i < self->n_workers; i++) {
+            if (self->workers[i].assigned < worker->assigned)
+                worker = &self->workers[i];
+        }
+        g_hash_table_insert(self->assignments, key, worker);
+        key = NULL;
+    }
+    g_mutex_unlock(&self->lock);
+    g_free(key);
+    return worker;
+}
+
+/*
+ * A worker for a request of no passport, locked: the first one not running
+ * a request, or the first one if all are busy
+ */
+static Worker*
+lock_any_worker (GHbciWorkerPool* self)
+{
+    guint i;
+
+    for (i = 0; i < self->n_workers; i++) {
+        if (g_mutex_trylock(&self->workers[i].lock))
+            return &self->workers[i];
+    }
+    g_mutex_lock(&self->workers[0].lock);
+    return &self->workers[0];
+}
+
+/*
+ * Start n_workers processes of ghbci-worker, the one in the libexec
+ * directory or the one in the environment variable GHBCI_WORKER. Their
+ * passports are all stored in directory, a passport file is only opened by
+ * the worker the passport is assigned to. Callbacks of the
+ * workers are passed to callback and their log messages and status
+ * events to event, if not NULL, both on the thread of the request.
+ */
+GHbciWorkerPool*
+ghbci_worker_pool_new (const gchar* directory, guint n_workers, GHbciWorkerCallbackFunc callback,
+        GHbciWorkerEventFunc event, gpointer user_data, GError** error)
+{
+    GHbciWorkerPool* self;
+    guint i;
+
+    g_return_val_if_fail (directory != NULL, NULL);
+    g_return_val_if_fail (n_workers > 0, NULL);
+    g_return_val_if_fail (callback != NULL, NULL);
+
+    self = g_new0(GHbciWorkerPool, 1);
+    self->program = g_strdup(g_getenv("GHBCI_WORKER"));
+    if (self->program == NULL)
+        self->program = g_strdup(LIBEXEC_DIR "/ghbci-worker");
+    self->directory = g_strdup(directory);
+    self->callback = callback;
+    self->event = event;
+    self->user_data = user_data;
+    g_mutex_init(&self->lock);
+    self->assignments = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    self->n_workers = n_workers;
+    self->workers = g_new0(Worker, n_workers);
+    for (i = 0; i < n_workers; i++) {
+        Worker* worker = &self->workers[i];
+        g_mutex_init(&worker->lock);
+        worker->index = i;
+        worker->passports = g_ptr_array_new_with_free_func((GDestroyNotify)g_strfreev);
+    }
+
+    for (i = 0; i < n_workers; i++) {
+        if (!worker_spawn(self, &self->workers[i], error)) {
+            ghbci_worker_pool_free(self);
+            return NULL;
+        }
+    }
+    return self;
+}
+
+/*
+ * Stop all workers, no request may be running
+ */
+void
+ghbci_worker_pool_free (GHbciWorkerPool* self)
+{
+    guint i;
+
+    g_return_if_fail (self != NULL);
+
+    for (i = 0; i < self->n_workers; i++) {
+        Worker* worker = &self->workers[i];
+        // the worker exits when the socket is closed
+        if (worker->socket != NULL)
+            g_socket_close(worker->socket, NULL);
+        g_clear_object(&worker->socket);
+        g_clear_object(&worker->process);
+        g_ptr_array_unref(worker->passports);
+        g_mutex_clear(&worker->lock);
+    }
+    g_free(self->workers);
+    g_hash_table_unref(self->assignments);
+    g_mutex_clear(&self->lock);
+    g_free(self->program);
+    g_free(self->directory);
+    g_free(self);
+}
+
+/*
+ * Options for the workers, they get them before their next request
+ */
+void
+ghbci_worker_pool_set_options (GHbciWorkerPool* self, gint log_level, gboolean capture_raw_messages)
+{
+    g_return_if_fail (self != NULL);
+
+    g_mutex_lock(&self->lock);
+    self->log_level = log_level;
+    self->capture_raw_messages = capture_raw_messages;
+    self->options_serial++;
+    g_mutex_unlock(&self->lock);
+}
+
+/*
+ * Run a request on the worker of the passport blz/userid and return its
+ * reply, on any worker if blz is NULL. A floating body is consumed.
+ */
+GVariant*
+ghbci_worker_pool_request (GHbciWorkerPool* self, const gchar* blz, const gchar* userid,
+        GHbciWorkerMessage kind, GVariant* body, GError** error)
+{
+    GVariant* reply = NULL;
+    Worker* worker;
+
+    g_return_val_if_fail (self != NULL, NULL);
+    g_return_val_if_fail (body != NULL, NULL);
+
+    g_variant_ref_sink(body);
+    if (blz != NULL) {
+        worker = get_worker(self, blz, userid, FALSE);
+        if (worker == NULL) {
+            ghbci_set_error(error, GHBCI_ERROR_NO_PASSPORT, NULL, GHBCI_RETRY_HINT_NEVER,
+                    "no passport added for %s/%s", blz, userid);
+            g_variant_unref(body);
+            return NULL;
+        }
+        g_mutex_lock(&worker->lock);
+    } else {
+        worker = lock_any_worker(self);
+    }
+
+    if (worker_prepare(self, worker, error))
+        worker_request(self, worker, blz, userid, kind, body, &reply, NULL, error);
+    g_mutex_unlock(&worker->lock);
+    g_variant_unref(body);
+    return reply;
+}
+
+gboolean
+ghbci_worker_pool_add_passport (GHbciWorkerPool* self, const gchar* blz, const gchar* userid, GError** error)
+{
+    GVariant* reply = NULL;
+    gboolean success;
+    guint i;
+
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    Worker* worker = get_worker(self, blz, userid, TRUE);
+    g_mutex_lock(&worker->lock);
+    success = worker_prepare(self, worker, error)
+        && worker_request(self, worker, blz, userid, GHBCI_WORKER_ADD_PASSPORT,
+                g_variant_new("(ss)", blz, userid), &reply, NULL, error);
+    if (success) {
+        g_variant_unref(reply);
+        for (i = 0; i < worker->passports->len; i++) {
+            gchar** passport = g_ptr_array_index(worker->passports, i);
+            if (g_str_equal(passport[0], blz) && g_str_equal(passport[1], userid))
+                break;
+        }
+        if (i == worker->passports->len) {
+            gchar* passport[] = { (gchar*)blz, (gchar*)userid, NULL };
+            g_ptr_array_add(worker->passports, g_strdupv(passport));
+            g_mutex_lock(&self->lock);
+            worker->assigned++;
+            g_mutex_unlock(&self->lock);
+        }
+    }
+    g_mutex_unlock(&worker->lock);
+    return success;
+}
+
+gchar*
+ghbci_worker_pool_get_balances (GHbciWorkerPool* self, const gchar* blz, const gchar* userid, const gchar* number,
+        GError** error)
+{
+    GVariant* reply;
+    gchar* balance = NULL;
+
+    g_return_val_if_fail (self != NULL, NULL);
+
+    reply = ghbci_worker_pool_request(self, blz, userid, GHBCI_WORKER_GET_BALANCES,
+            g_variant_new("(sss)", blz, userid, number), error);
+    if (reply != NULL) {
+        if (g_variant_is_of_type(reply, G_VARIANT_TYPE("ms")))
+            g_variant_get(reply, "ms", &balance);
+        g_variant_unref(reply);
+    }
+    return balance;
+}
+
+GSList*
+ghbci_worker_pool_get_statements (GHbciWorkerPool* self, const gchar* blz, const gchar* userid,
+        const gchar* number, gboolean native_mt940, GHbciStringPool* pool, GError** error)
+{
+    GSList* statements = NULL;
+    GVariant* reply = NULL;
+    GError* read_error = NULL;
+    gint fd = -1;
+
+    g_return_val_if_fail (self != NULL, NULL);
+
+    Worker* worker = get_worker(self, blz, userid, FALSE);
+    if (worker == NULL) {
+        ghbci_set_error(error, GHBCI_ERROR_NO_PASSPORT, NULL, GHBCI_RETRY_HINT_NEVER,
+                "no passport added for %s/%s", blz, userid);
+        return NULL;
+    }
+
+    g_mutex_lock(&worker->lock);
+    if (worker_prepare(self, worker, error)
+            && worker_request(self, worker, blz, userid, GHBCI_WORKER_GET_STATEMENTS,
+                g_variant_new("(sssb)", blz, userid, number, native_mt940), &reply, &fd, error)) {
+        g_variant_unref(reply);
+        if (fd < 0)
+            g_set_error_literal(&read_error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "no statements sent");
+        else
+            statements = ghbci_worker_read_statements(fd, pool, &read_error);
+        if (read_error != NULL) {
+            ghbci_set_error(error, GHBCI_ERROR_WORKER, NULL, GHBCI_RETRY_HINT_RETRY,
+                    "statements of worker %u are invalid: %s", worker->index, read_error->message);
+            g_error_free(read_error);
+        }
+        if (fd >= 0)
+            close(fd);
+    }
+    g_mutex_unlock(&worker->lock);
+    return statements;
+}
+
+
+// vim: sw=4 expandtab
@@ -0,0 +1,266 @@
+/*
+ * ghbci-worker-request.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/*
+ * Runs the requests of the worker protocol on a context, for ghbci-worker
+ * and the service of ghbci-daemon, so both offer the same operations. See
+ * ghbci-worker-pool-private.h for the bodies and replies.
+ */
+
+#include "ghbci-context.h"
+#include "ghbci-context-private.h"
+#include "ghbci-worker-pool-private.h"
+
+/*
+ * The readable properties of each account
+ */
+static GVariant*
+accounts_to_variant (GSList* accounts)
+{
+    GVariantBuilder builder;
+    GSList* iter;
+    guint i;
+
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("aa{ss}"));
+    for (iter = accounts; iter != NULL; iter = iter->next) {
+        guint n_properties;
+        GParamSpec** properties = g_object_class_list_properties(G_OBJECT_GET_CLASS(iter->data), &n_properties);
+
+        g_variant_builder_open(&builder, G_VARIANT_TYPE("a{ss}"));
+        for (i = 0; i < n_properties; i++) {
+            gchar* value = NULL;
+
+            if (properties[i]->value_type != G_TYPE_STRING || !(properties[i]->flags & G_PARAM_READABLE))
+                continue;
+            g_object_get(iter->data, properties[i]->name, &value, NULL);
+            if (value != NULL)
+                g_variant_builder_add(&builder, "{ss}", properties[i]->name, value);
+            g_free(value);
+        }
+        g_variant_builder_close(&builder);
+        g_free(properties);
+    }
+    return g_variant_builder_end(&builder);
+}
+
+static GVariant*
+tan_methods_to_variant (GHashTable* tan_methods)
+{
+    GVariantBuilder builder;
+    GHashTableIter iter;
+    gpointer key, value;
+
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("a{ss}"));
+    g_hash_table_iter_init(&iter, tan_methods);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+        g_variant_builder_add(&builder, "{ss}", key, value);
+    return g_variant_builder_end(&builder);
+}
+
+static void
+transfer_clear (GHbciTransfer* transfer)
+{
+    g_free(transfer->name);
+    g_free(transfer->bic);
+    g_free(transfer->iban);
+    g_free(transfer->reference);
+    g_free(transfer->amount);
+    g_free(transfer->end_to_end_id);
+}
+
+static GVariant*
+order_id_to_variant (gchar* order_id)
+{
+    return g_variant_new_maybe(G_VARIANT_TYPE_STRING, order_id != NULL ? g_variant_new_take_string(order_id) : NULL);
+}
+
+static void
+add_blz (const gchar* blz, gpointer user_data)
+{
+    g_variant_builder_add(user_data, "s", blz);
+}
+
+/*
+ * Run a request of kind on context. Returns the floating reply, with a
+ * file descriptor to send along in fd or -1, or NULL with error set.
+ * Messages other than requests fail with G_IO_ERROR_NOT_SUPPORTED.
+ */
+GVariant*
+ghbci_worker_run_request (GHbciContext* context, GHbciWorkerMessage kind, GVariant* body, gint* fd,
+        GError** error)
+{
+    GError* request_error = NULL;
+    GVariant* reply = NULL;
+    const gchar *blz, *userid, *number;
+    const gchar *source_name, *source_bic, *source_iban;
+    gboolean native_mt940, capture_raw_messages;
+    GVariant* argument;
+    GHbciTransfer transfer;
+    GHbciTransfer* transfers;
+    GHbciStandingOrder* order;
+    GHashTable* tan_methods;
+    GSList *statements, *accounts, *orders, *iter;
+    GVariantBuilder builder;
+    GBytes* document;
+    GDate* date;
+    gchar* balance;
+    gchar* order_id = NULL;
+    gchar *name, *url;
+    guint32 julian_date;
+    gint log_level;
+    gsize n, i;
+
+    g_return_val_if_fail (GHBCI_IS_CONTEXT (context), NULL);
+    g_return_val_if_fail (body != NULL && fd != NULL, NULL);
+
+    *fd = -1;
+    switch (kind) {
+    case GHBCI_WORKER_ADD_PASSPORT:
+        g_variant_get(body, "(&s&s)", &blz, &userid);
+        if (ghbci_context_add_passport(context, blz, userid, &request_error))
+            reply = g_variant_new("()");
+        break;
+    case GHBCI_WORKER_GET_BALANCES:
+        g_variant_get(body, "(&s&s&s)", &blz, &userid, &number);
+        balance = ghbci_context_get_balances(context, blz, userid, number, &request_error);
+        if (request_error == NULL)
+            reply = g_variant_new_maybe(G_VARIANT_TYPE_STRING,
+                    balance != NULL ? g_variant_new_take_string(balance) : NULL);
+        else
+            g_free(balance);
+        break;
+    case GHBCI_WORKER_GET_STATEMENTS:
+        g_variant_get(body, "(&s&s&sb)", &blz, &userid, &number, &native_mt940);
+        statements = ghbci_context_fetch_statements(context, blz, userid, number, native_mt940, &request_error);
+        if (request_error == NULL)
+            *fd = ghbci_worker_write_statements(statements, &request_error);
+        if (*fd >= 0)
+            reply = g_variant_new("()");
+        g_slist_free_full(statements, g_object_unref);
+        break;
+    case GHBCI_WORKER_SET_OPTIONS:
+        g_variant_get(body, "(ib)", &log_level, &capture_raw_messages);
+        ghbci_context_set_log_level(context, log_level);
+        ghbci_context_set_capture_raw_messages(context, capture_raw_messages);
+        reply = g_variant_new("()");
+        break;
+    case GHBCI_WORKER_GET_ACCOUNTS:
+        g_variant_get(body, "(&s&s)", &blz, &userid);
+        accounts = ghbci_context_get_accounts(context, blz, userid, &request_error);
+        if (request_error == NULL)
+            reply = accounts_to_variant(accounts);
+        g_slist_free_full(accounts, g_object_unref);
+        break;
+    case GHBCI_WORKER_GET_TAN_METHODS:
+        g_variant_get(body, "(&s&s)", &blz, &userid);
+        tan_methods = ghbci_context_get_tan_methods(context, blz, userid, &request_error);
+        if (tan_methods != NULL) {
+            reply = tan_methods_to_variant(tan_methods);
+            g_hash_table_unref(tan_methods);
+        }
+        break;
+    case GHBCI_WORKER_SEND_TRANSFER:
+        g_variant_get(body, "(&s&s&s&s&s&s@" GHBCI_WORKER_TRANSFER_TYPE "u)", &blz, &userid, &number,
+                &source_name, &source_bic, &source_iban, &argument, &julian_date);
+        ghbci_worker_transfer_from_variant(argument, &transfer);
+        g_variant_unref(argument);
+        if (!g_date_valid_julian(julian_date)) {
+            if (ghbci_context_send_transfer(context, blz, userid, number, source_name, source_bic, source_iban,
+                        transfer.name, transfer.bic, transfer.iban, transfer.reference, transfer.amount,
+                        &request_error))
+                reply = order_id_to_variant(NULL);
+        } else {
+            date = g_date_new_julian(julian_date);
+            if (ghbci_context_send_scheduled_transfer(context, blz, userid, number, source_name, source_bic,
+                        source_iban, &transfer, date, &order_id, &request_error))
+                reply = order_id_to_variant(order_id);
+            g_date_free(date);
+        }
+        transfer_clear(&transfer);
+        break;
+    case GHBCI_WORKER_SEND_TRANSFERS:
+        g_variant_get(body, "(&s&s&s&s&s&s@a" GHBCI_WORKER_TRANSFER_TYPE ")", &blz, &userid, &number,
+                &source_name, &source_bic, &source_iban, &argument);
+        n = g_variant_n_children(argument);
+        transfers = g_new0(GHbciTransfer, n);
+        for (i = 0; i < n; i++) {
+            GVariant* child = g_variant_get_child_value(argument, i);
+            ghbci_worker_transfer_from_variant(child, &transfers[i]);
+            g_variant_unref(child);
+        }
+        g_variant_unref(argument);
+        if (ghbci_context_send_transfers(context, blz, userid, number, source_name, source_bic, source_iban,
+                    transfers, n, &request_error))
+            reply = g_variant_new("()");
+        for (i = 0; i < n; i++)
+            transfer_clear(&transfers[i]);
+        g_free(transfers);
+        break;
+    case GHBCI_WORKER_CREATE_STANDING_ORDER:
+        g_variant_get(body, "(&s&s&s&s&s&s@" GHBCI_WORKER_ORDER_TYPE ")", &blz, &userid, &number,
+                &source_name, &source_bic, &source_iban, &argument);
+        order = ghbci_worker_standing_order_from_variant(argument);
+        g_variant_unref(argument);
+        if (ghbci_context_create_standing_order(context, blz, userid, number, source_name, source_bic, source_iban,
+                    order, &order_id, &request_error))
+            reply = order_id_to_variant(order_id);
+        ghbci_standing_order_free(order);
+        break;
+    case GHBCI_WORKER_GET_STANDING_ORDERS:
+        g_variant_get(body, "(&s&s&s&s&s)", &blz, &userid, &number, &source_bic, &source_iban);
+        orders = ghbci_context_get_standing_orders(context, blz, userid, number, source_bic, source_iban,
+                &request_error);
+        if (request_error == NULL) {
+            g_variant_builder_init(&builder, G_VARIANT_TYPE("a" GHBCI_WORKER_ORDER_TYPE));
+            for (iter = orders; iter != NULL; iter = iter->next)
+                g_variant_builder_add_value(&builder, ghbci_worker_standing_order_to_variant(iter->data));
+            reply = g_variant_builder_end(&builder);
+        }
+        g_slist_free_full(orders, (GDestroyNotify)ghbci_standing_order_free);
+        break;
+    case GHBCI_WORKER_VALIDATE_PAIN001:
+        document = g_variant_get_data_as_bytes(body);
+        if (ghbci_context_validate_pain001(context, document, &request_error))
+            reply = g_variant_new("()");
+        g_bytes_unref(document);
+        break;
+    case GHBCI_WORKER_GET_BANK:
+        blz = g_variant_get_string(body, NULL);
+        name = (gchar*)ghbci_context_get_name_for_blz(context, blz);
+        url = (gchar*)ghbci_context_get_pin_tan_url_for_blz(context, blz);
+        reply = g_variant_new("(ss)", name, url);
+        g_free(name);
+        g_free(url);
+        break;
+    case GHBCI_WORKER_LIST_BANKS:
+        g_variant_builder_init(&builder, G_VARIANT_TYPE_STRING_ARRAY);
+        ghbci_context_blz_foreach(context, add_blz, &builder);
+        reply = g_variant_builder_end(&builder);
+        break;
+    default:
+        g_set_error(&request_error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "unexpected message of kind %u instead of a request",
+                kind);
+        break;
+    }
+    if (request_error != NULL)
+        g_propagate_error(error, request_error);
+    return reply;
+}
+
+
+// vim: sw=4 expandtab
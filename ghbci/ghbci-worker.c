@@ -0,0 +1,216 @@
+/*
+ * ghbci-worker.c
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/*
+ * Worker process of ghbci_context_new_with_workers(). Hosts a jvm with
+ * hbci4java in a context of its own and runs the requests of the context
+ * at the other end of the socket, until that closes it. Callbacks not
+ * answered here, log messages and status events are passed on to the
+ * other end, see ghbci-worker-pool.c for the protocol.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+#include "ghbci-context.h"
+#include "ghbci-context-private.h"
+#include "ghbci-worker-pool-private.h"
+
+typedef struct
+{
+    GSocket* socket;
+    /* the connection broke during a callback */
+    gboolean broken;
+} Worker;
+
+
+static gchar*
+forward_callback (GHbciContext* context, gint64 reason, const gchar* message, const gchar* optional,
+        gpointer user_data)
+{
+    Worker* worker = user_data;
+    GError* error = NULL;
+    GHbciWorkerMessage kind;
+    GVariant* body;
+    gchar* answer = NULL;
+    gint fd;
+
+    if (worker->broken)
+        return NULL;
+
+    if (!ghbci_worker_send(worker->socket, GHBCI_WORKER_CALLBACK,
+                g_variant_new("(xss)", reason, message != NULL ? message : "", optional != NULL ? optional : ""),
+                -1, &error)
+            || !ghbci_worker_receive(worker->socket, -1, &kind, &body, &fd, &error)) {
+        g_warning("forwarding callback failed: %s", error->message);
+        g_error_free(error);
+        worker->broken = TRUE;
+        return NULL;
+    }
+
+    if (fd >= 0)
+        close(fd);
+    if (kind == GHBCI_WORKER_ANSWER) {
+        g_variant_get(body, "ms", &answer);
+    } else {
+        g_warning("unexpected message of kind %u instead of an answer", kind);
+        worker->broken = TRUE;
+    }
+    g_variant_unref(body);
+    return answer;
+}
+
+static void
+forward_status (GHbciContext* context, gint64 tag, const gchar* text, GHbciStatusPayload* payload,
+        gpointer user_data)
+{
+    Worker* worker = user_data;
+    GError* error = NULL;
+
+    // the calls of the other end are counted there
+    if (worker->broken || tag == GHBCI_STATUSTAG_ENUM_API_CALL_DONE)
+        return;
+
+    if (!ghbci_worker_send(worker->socket, GHBCI_WORKER_STATUS, ghbci_worker_status_to_variant(tag, text, payload),
+                -1, &error)) {
+        g_warning("forwarding status failed: %s", error->message);
+        g_error_free(error);
+        worker->broken = TRUE;
+    }
+}
+
+/*
+ * Runs on the log delivery thread of the context, a broken connection is
+ * noticed by the request
+ */
+static void
+forward_log (gint level, gint64 time, const gchar* dialog_id, const gchar* message, gpointer user_data)
+{
+    Worker* worker = user_data;
+
+    ghbci_worker_send(worker->socket, GHBCI_WORKER_LOG,
+            g_variant_new("(ixss)", level, time, dialog_id != NULL ? dialog_id : "", message), -1, NULL);
+}
+
+/*
+ * Run a request and send the reply, FALSE if the connection broke
+ */
+static gboolean
+run_request (Worker* worker, GHbciContext* context, GHbciWorkerMessage kind, GVariant* body)
+{
+    GError* error = NULL;
+    GVariant* reply;
+    gboolean sent;
+    gint fd;
+
+    reply = ghbci_worker_run_request(context, kind, body, &fd, &error);
+    if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED)) {
+        g_warning("%s", error->message);
+        g_error_free(error);
+        return FALSE;
+    }
+
+    // the log messages of the request go first
+    ghbci_context_flush_log(context);
+
+    if (worker->broken) {
+        g_clear_error(&error);
+        if (reply != NULL)
+            g_variant_unref(g_variant_ref_sink(reply));
+        sent = FALSE;
+    } else if (reply != NULL) {
+        sent = ghbci_worker_send(worker->socket, GHBCI_WORKER_REPLY, reply, fd, &error);
+    } else {
+        GVariant* error_body = ghbci_worker_error_to_variant(error);
+        g_clear_error(&error);
+        sent = ghbci_worker_send(worker->socket, GHBCI_WORKER_ERROR, error_body, -1, &error);
+    }
+    if (!sent && error != NULL) {
+        g_warning("sending reply failed: %s", error->message);
+        g_error_free(error);
+    }
+    if (fd >= 0)
+        close(fd);
+    return sent;
+}
+
+int
+main (int argc, char** argv)
+{
+    GOptionContext* options;
+    GError* error = NULL;
+    GHbciWorkerMessage kind;
+    GVariant* body;
+    Worker worker;
+    gint socket_fd = -1;
+    gchar* directory = NULL;
+    gint fd;
+    GOptionEntry entries[] = {
+        { "fd", 0, 0, G_OPTION_ARG_INT, &socket_fd, "Socket to the context", "FD" },
+        { "directory", 0, 0, G_OPTION_ARG_FILENAME, &directory, "Directory of the passports", "DIR" },
+        { NULL }
+    };
+
+    options = g_option_context_new("- hbci4java worker of a ghbci context");
+    g_option_context_add_main_entries(options, entries, NULL);
+    if (!g_option_context_parse(options, &argc, &argv, &error) || socket_fd < 0 || directory == NULL) {
+        g_printerr("%s\n", error != NULL ? error->message : "--fd and --directory are required");
+        g_option_context_free(options);
+        return EXIT_FAILURE;
+    }
+    g_option_context_free(options);
+
+    worker.broken = FALSE;
+    worker.socket = g_socket_new_from_fd(socket_fd, &error);
+    if (worker.socket == NULL) {
+        g_printerr("%s\n", error->message);
+        return EXIT_FAILURE;
+    }
+
+    g_mkdir_with_parents(directory, 0700);
+    GHbciContext* context = ghbci_context_new(directory);
+    if (context == NULL) {
+        g_printerr("starting the jvm failed\n");
+        return EXIT_FAILURE;
+    }
+    g_signal_connect(context, "callback", G_CALLBACK(forward_callback), &worker);
+    g_signal_connect(context, "status", G_CALLBACK(forward_status), &worker);
+    ghbci_context_set_log_sink(context, forward_log, &worker, NULL);
+
+    while (ghbci_worker_receive(worker.socket, -1, &kind, &body, &fd, &error)) {
+        gboolean running;
+
+        if (fd >= 0)
+            close(fd);
+        running = run_request(&worker, context, kind, body);
+        g_variant_unref(body);
+        if (!running)
+            break;
+    }
+    if (error != NULL && !g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CONNECTION_CLOSED))
+        g_warning("receiving request failed: %s", error->message);
+    g_clear_error(&error);
+
+    g_object_unref(context);
+    g_object_unref(worker.socket);
+    g_free(directory);
+    return EXIT_SUCCESS;
+}
+
+// vim: sw=4 expandtab
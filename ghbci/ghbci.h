@@ -22,5 +22,16 @@
 #include <ghbci-statement.h>
 #include <ghbci-account.h>
 #include <ghbci-context.h>
+#include <ghbci-scheduler.h>
+#include <ghbci-metrics.h>
+#include <ghbci-status.h>
+#include <ghbci-error.h>
+#include <ghbci-instrumentation.h>
+#include <ghbci-capabilities.h>
+#include <ghbci-credential-provider.h>
+#include <ghbci-tan-challenge.h>
+#include <ghbci-transfer.h>
+#include <ghbci-standing-order.h>
+#include <ghbci-export.h>
 
 #endif /* __GHBCI_CONTEXT_H__ */
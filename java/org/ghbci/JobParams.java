@@ -0,0 +1,71 @@
+/*
+ * JobParams.java
+ *
+ * ghbci - A GObject wrapper of the hbci4java library
+ * Copyright (C) 2014-2015 Florian Richter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+package org.ghbci;
+
+import org.kapott.hbci.GV.HBCIJob;
+
+/**
+ * Sets all parameters of a job in one call from native code, instead of
+ * one JNI round trip per parameter
+ */
+public final class JobParams
+{
+    /** separates the values, hbci4java accepts no control characters anyway */
+    private static final char SEPARATOR = 0x1f;
+
+    /** the constant strings of the context, see ghbci-java-strings.h */
+    private static String[] strings;
+
+    private JobParams()
+    {
+    }
+
+    /**
+     * Keep the constant strings the names of set() refer to, called once
+     * by the context
+     */
+    public static void init(String[] constantStrings)
+    {
+        strings = constantStrings;
+    }
+
+    /**
+     * Set the parameters of a job. params holds a pair of constant string
+     * id of the name and index for each, an index below 0 sets a parameter
+     * without index. The values are joined by SEPARATOR. Stops at the
+     * first value hbci4java rejects.
+     */
+    public static void set(HBCIJob job, int[] params, String values)
+    {
+        int start = 0;
+
+        for (int i = 0; i < params.length; i += 2) {
+            int end = values.indexOf(SEPARATOR, start);
+            if (end < 0)
+                end = values.length();
+            String name = strings[params[i]];
+            String value = values.substring(start, end);
+            if (params[i + 1] < 0)
+                job.setParam(name, value);
+            else
+                job.setParam(name, Integer.valueOf(params[i + 1]), value);
+            start = end + 1;
+        }
+    }
+}
@@ -0,0 +1,210 @@
+#include <glib.h>
+#include <stdlib.h>
+#include "ghbci/ghbci-context.h"
+
+/*
+ * End to end benchmark of GHbciContext against tests/mock-pintan-server.py,
+ * run through tests/run-benchmark.py
+ */
+
+#define BLZ         "12345678"
+#define USERID      "benchuser"
+
+static const gchar* port;
+
+typedef struct
+{
+    const gchar* name;
+    GArray* samples;
+} Measurement;
+
+/*
+ * Everything the mock bank asks is known beforehand
+ */
+static void
+set_answers (GHbciContext* context)
+{
+    gchar* host = g_strdup_printf("localhost:%s/", port);
+
+    ghbci_context_set_answer(context, NULL, NULL, GHBCI_REASON_ENUM_NEED_COUNTRY, "DE");
+    ghbci_context_set_answer(context, NULL, NULL, GHBCI_REASON_ENUM_NEED_BLZ, BLZ);
+    ghbci_context_set_answer(context, NULL, NULL, GHBCI_REASON_ENUM_NEED_USERID, USERID);
+    ghbci_context_set_answer(context, NULL, NULL, GHBCI_REASON_ENUM_NEED_CUSTOMERID, USERID);
+    ghbci_context_set_answer(context, NULL, NULL, GHBCI_REASON_ENUM_NEED_HOST, host);
+    ghbci_context_set_answer(context, NULL, NULL, GHBCI_REASON_ENUM_NEED_PORT, port);
+    ghbci_context_set_answer(context, NULL, NULL, GHBCI_REASON_ENUM_NEED_FILTER, "Base64");
+    ghbci_context_set_answer(context, NULL, NULL, GHBCI_REASON_ENUM_NEED_PASSPHRASE_LOAD, "benchmark");
+    ghbci_context_set_answer(context, NULL, NULL, GHBCI_REASON_ENUM_NEED_PASSPHRASE_SAVE, "benchmark");
+    ghbci_context_set_answer(context, BLZ, USERID, GHBCI_REASON_ENUM_NEED_PT_PIN, "12345");
+    ghbci_context_set_answer(context, BLZ, USERID, GHBCI_REASON_ENUM_NEED_PT_SECMECH, "999");
+    g_free(host);
+}
+
+static gchar*
+answer (GHbciContext* context, gint64 reason, const gchar* msg, const gchar* optional, gpointer user_data)
+{
+    // informational callbacks
+    return g_strdup("");
+}
+
+static void
+check (GError* error, const gchar* operation)
+{
+    if (error != NULL) {
+        g_printerr("%s failed: %s\n", operation, error->message);
+        exit(1);
+    }
+}
+
+static gint
+compare_samples (gconstpointer a, gconstpointer b)
+{
+    gint64 x = *(const gint64*)a;
+    gint64 y = *(const gint64*)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static void
+report (Measurement* measurement, guint items)
+{
+    GArray* samples = measurement->samples;
+    gint64 sum = 0;
+    guint i;
+
+    g_array_sort(samples, compare_samples);
+    for (i = 0; i < samples->len; i++) {
+        sum += g_array_index(samples, gint64, i);
+    }
+    gint64 median = g_array_index(samples, gint64, samples->len / 2);
+
+    g_print("%-28s %6u %10.2f %10.2f %10.2f",
+            measurement->name, samples->len,
+            g_array_index(samples, gint64, 0) / 1000.0,
+            median / 1000.0,
+            sum / 1000.0 / samples->len);
+    if (items > 0)
+        g_print(" %12.0f", items * 1000000.0 / median);
+    g_print("\n");
+}
+
+#define MEASURE(measurement, iterations, code) \
+    do { \
+        guint iteration; \
+        (measurement).samples = g_array_new(FALSE, FALSE, sizeof(gint64)); \
+        for (iteration = 0; iteration < (iterations); iteration++) { \
+            gint64 start = g_get_monotonic_time(); \
+            code; \
+            gint64 elapsed = g_get_monotonic_time() - start; \
+            g_array_append_val((measurement).samples, elapsed); \
+        } \
+    } while (0)
+
+static void
+bench_statements (GHbciContext* context, const gchar* number, gboolean native, guint iterations)
+{
+    Measurement measurement;
+    guint lines = 0;
+
+    ghbci_context_set_native_mt940(context, native);
+    measurement.name = g_strdup_printf("get_statements (%s lines%s)", number, native ? ", native MT940" : "");
+    MEASURE(measurement, iterations, {
+        GError* error = NULL;
+        GSList* statements = ghbci_context_get_statements(context, BLZ, USERID, number, &error);
+        check(error, "get_statements");
+        lines = g_slist_length(statements);
+        g_slist_free_full(statements, g_object_unref);
+    });
+    report(&measurement, lines);
+
+    g_free((gchar*)measurement.name);
+    g_array_unref(measurement.samples);
+}
+
+int
+main (int argc, char *argv[])
+{
+    GHbciContext* context;
+    Measurement measurement;
+    guint iterations;
+
+    if (argc < 2) {
+        g_printerr("usage: %s PASSPORT_DIRECTORY [ITERATIONS]\n", argv[0]);
+        return 1;
+    }
+    iterations = argc > 2 ? atoi(argv[2]) : 10;
+    port = g_getenv("GHBCI_MOCK_PORT");
+    if (port == NULL) {
+        g_printerr("GHBCI_MOCK_PORT not set, run through run-benchmark.py\n");
+        return 1;
+    }
+
+    context = ghbci_context_new(argv[1]);
+    set_answers(context);
+    g_signal_connect(context, "callback", G_CALLBACK(answer), NULL);
+
+    g_print("%-28s %6s %10s %10s %10s %12s\n", "operation", "runs", "min ms", "median ms", "mean ms", "items/s");
+
+    // first time fetches BPD, system id and UPD
+    measurement.name = "add_passport (new)";
+    MEASURE(measurement, 1, {
+        GError* error = NULL;
+        ghbci_context_add_passport(context, BLZ, USERID, &error);
+        check(error, "add_passport");
+    });
+    report(&measurement, 0);
+    g_array_unref(measurement.samples);
+
+    measurement.name = "add_passport (existing)";
+    MEASURE(measurement, iterations, {
+        GError* error = NULL;
+        ghbci_context_add_passport(context, BLZ, USERID, &error);
+        check(error, "add_passport");
+    });
+    report(&measurement, 0);
+    g_array_unref(measurement.samples);
+
+    measurement.name = "get_accounts";
+    MEASURE(measurement, iterations, {
+        GError* error = NULL;
+        GSList* accounts = ghbci_context_get_accounts(context, BLZ, USERID, &error);
+        check(error, "get_accounts");
+        g_slist_free_full(accounts, g_object_unref);
+    });
+    report(&measurement, 0);
+    g_array_unref(measurement.samples);
+
+    measurement.name = "get_balances";
+    MEASURE(measurement, iterations, {
+        GError* error = NULL;
+        g_free(ghbci_context_get_balances(context, BLZ, USERID, "10", &error));
+        check(error, "get_balances");
+    });
+    report(&measurement, 0);
+    g_array_unref(measurement.samples);
+
+    bench_statements(context, "10", FALSE, iterations);
+    bench_statements(context, "1000", FALSE, iterations);
+    bench_statements(context, "100000", FALSE, MAX(iterations / 5, 1));
+    bench_statements(context, "1000", TRUE, iterations);
+    bench_statements(context, "100000", TRUE, MAX(iterations / 5, 1));
+    ghbci_context_set_native_mt940(context, FALSE);
+
+    measurement.name = "send_transfer";
+    MEASURE(measurement, iterations, {
+        GError* error = NULL;
+        ghbci_context_send_transfer(context, BLZ, USERID, "10",
+                "Mock Kunde", "MOCKDEFFXXX", "DE65123456780000000010",
+                "Mock Empfaenger", "MOCKDEFFXXX", "DE38123456780000001000",
+                "Benchmark", "1.23", &error);
+        check(error, "send_transfer");
+    });
+    report(&measurement, 0);
+    g_array_unref(measurement.samples);
+
+    g_object_unref(context);
+    return 0;
+}
+
+
+//vim: expandtab sw=4
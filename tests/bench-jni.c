@@ -0,0 +1,337 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <jni.h>
+#include "ghbci/ghbci-context.h"
+#include "ghbci/ghbci-context-private.h"
+#include "ghbci/ghbci-account.h"
+#include "ghbci/ghbci-account-private.h"
+#include "ghbci/ghbci-statement.h"
+#include "ghbci/ghbci-statement-private.h"
+#include "ghbci/ghbci-jstring-private.h"
+#include "ghbci/ghbci-instrumentation-private.h"
+
+/*
+ * Microbenchmarks of the JNI marshalling code paths on synthetic objects
+ * created in the jvm, no network involved.
+ *
+ * JNI calls and allocations are counted by the instrumentation of ghbci,
+ * if it was built with the meson option instrumentation. Both are counted
+ * per thread, so the log drain thread and jvm internal threads do not show
+ * up. The CallVoidMethod entering the callback bridge is counted too.
+ */
+
+#define BATCH       1000
+#define BATCHES     20
+
+static GHbciCallCounters counters;
+static gboolean jni_counting;
+static gboolean allocation_counting;
+
+typedef void (*BenchFunc) (gpointer data);
+
+/*
+ * measurement
+ */
+
+static gint
+compare_samples (gconstpointer a, gconstpointer b)
+{
+    gdouble x = *(const gdouble*)a;
+    gdouble y = *(const gdouble*)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/*
+ * Run @func in BATCHES batches of @batch calls, @ops operations each, and
+ * print median ns/op and mean allocations and JNI calls per operation
+ */
+static void
+run (const gchar* name, BenchFunc func, gpointer data, guint batch, guint ops)
+{
+    GArray* samples = g_array_new(FALSE, FALSE, sizeof(gdouble));
+    guint64 jni_calls = 0;
+    guint64 allocations = 0;
+    guint i, j;
+
+    // warm up the jit
+    for (j = 0; j < batch; j++)
+        func(data);
+
+    for (i = 0; i < BATCHES; i++) {
+        GHbciCallCounters start_counters = counters;
+        gint64 start = g_get_monotonic_time();
+
+        for (j = 0; j < batch; j++)
+            func(data);
+
+        gint64 elapsed = g_get_monotonic_time() - start;
+        allocations += counters.allocations - start_counters.allocations;
+        jni_calls += counters.jni_calls - start_counters.jni_calls;
+        gdouble ns = elapsed * 1000.0 / ((gdouble)batch * ops);
+        g_array_append_val(samples, ns);
+    }
+
+    g_array_sort(samples, compare_samples);
+    gdouble total = (gdouble)BATCHES * batch * ops;
+
+    g_print("%-32s %12.1f", name, g_array_index(samples, gdouble, samples->len / 2));
+    if (allocation_counting)
+        g_print(" %12.2f", allocations / total);
+    else
+        g_print(" %12s", "n/a");
+    if (jni_counting)
+        g_print(" %12.2f", jni_calls / total);
+    else
+        g_print(" %12s", "n/a");
+    g_print("\n");
+
+    g_array_unref(samples);
+}
+
+/*
+ * synthetic objects
+ */
+
+static jobject
+new_date (JNIEnv* jni_env, gint year, gint month, gint day)
+{
+    jclass class_Date = (*jni_env)->FindClass(jni_env, "java/util/Date");
+    jmethodID constructor = (*jni_env)->GetMethodID(jni_env, class_Date, "<init>", "(III)V");
+    jobject date = (*jni_env)->NewObject(jni_env, class_Date, constructor, year - 1900, month - 1, day);
+    (*jni_env)->DeleteLocalRef(jni_env, class_Date);
+    return date;
+}
+
+static jobject
+new_value (GHbciContext* context, JNIEnv* jni_env, const gchar* value)
+{
+    jmethodID constructor = (*jni_env)->GetMethodID(jni_env, context->priv->class_Value,
+            "<init>", "(Ljava/lang/String;Ljava/lang/String;)V");
+    jstring jvalue = (*jni_env)->NewStringUTF(jni_env, value);
+    jstring jcurr = (*jni_env)->NewStringUTF(jni_env, "EUR");
+    jobject result = (*jni_env)->NewObject(jni_env, context->priv->class_Value, constructor, jvalue, jcurr);
+    (*jni_env)->DeleteLocalRef(jni_env, jvalue);
+    (*jni_env)->DeleteLocalRef(jni_env, jcurr);
+    return result;
+}
+
+static void
+set_string_field (JNIEnv* jni_env, jobject obj, jfieldID field, const gchar* value)
+{
+    jstring jvalue = (*jni_env)->NewStringUTF(jni_env, value);
+    (*jni_env)->SetObjectField(jni_env, obj, field, jvalue);
+    (*jni_env)->DeleteLocalRef(jni_env, jvalue);
+}
+
+static jobject
+new_konto (GHbciContext* context, JNIEnv* jni_env)
+{
+    GHbciContextPrivate* priv = context->priv;
+    jobject konto = (*jni_env)->NewObject(jni_env, priv->class_Konto, priv->method_Konto_constructor);
+
+    set_string_field(jni_env, konto, priv->field_Konto_country, "DE");
+    set_string_field(jni_env, konto, priv->field_Konto_blz, "12345678");
+    set_string_field(jni_env, konto, priv->field_Konto_number, "1234567890");
+    set_string_field(jni_env, konto, priv->field_Konto_subnumber, "00");
+    set_string_field(jni_env, konto, priv->field_Konto_type, "Girokonto");
+    set_string_field(jni_env, konto, priv->field_Konto_curr, "EUR");
+    set_string_field(jni_env, konto, priv->field_Konto_customerid, "benchuser");
+    set_string_field(jni_env, konto, priv->field_Konto_name, "Erika Mustermann");
+    set_string_field(jni_env, konto, priv->field_Konto_name2, "Musterstadt");
+    set_string_field(jni_env, konto, priv->field_Konto_bic, "MOCKDEFFXXX");
+    set_string_field(jni_env, konto, priv->field_Konto_iban, "DE65123456781234567890");
+    return konto;
+}
+
+static jobject
+new_umsline (GHbciContext* context, JNIEnv* jni_env)
+{
+    GHbciContextPrivate* priv = context->priv;
+    jmethodID constructor = (*jni_env)->GetMethodID(jni_env, priv->class_GVRKUmsUmsLine, "<init>", "()V");
+    jmethodID add_usage = (*jni_env)->GetMethodID(jni_env, priv->class_GVRKUmsUmsLine, "addUsage", "(Ljava/lang/String;)V");
+    jmethodID saldo_constructor = (*jni_env)->GetMethodID(jni_env, priv->class_Saldo, "<init>", "()V");
+    jobject line = (*jni_env)->NewObject(jni_env, priv->class_GVRKUmsUmsLine, constructor);
+    jobject obj;
+    const gchar* usage[] = { "SVWZ+Rechnung 2015-0815", "EREF+NOTPROVIDED", "Musterstrasse 1 12345 Musterstadt" };
+    guint i;
+
+    obj = new_date(jni_env, 2015, 3, 2);
+    (*jni_env)->SetObjectField(jni_env, line, priv->field_GVRKUmsUmsLine_valuta, obj);
+    (*jni_env)->DeleteLocalRef(jni_env, obj);
+
+    obj = new_date(jni_env, 2015, 3, 1);
+    (*jni_env)->SetObjectField(jni_env, line, priv->field_GVRKUmsUmsLine_bdate, obj);
+    (*jni_env)->DeleteLocalRef(jni_env, obj);
+
+    obj = new_value(context, jni_env, "-42.23");
+    (*jni_env)->SetObjectField(jni_env, line, priv->field_GVRKUmsUmsLine_value, obj);
+    (*jni_env)->DeleteLocalRef(jni_env, obj);
+
+    jobject saldo = (*jni_env)->NewObject(jni_env, priv->class_Saldo, saldo_constructor);
+    obj = new_value(context, jni_env, "1337.00");
+    (*jni_env)->SetObjectField(jni_env, saldo, priv->field_Saldo_value, obj);
+    (*jni_env)->DeleteLocalRef(jni_env, obj);
+    (*jni_env)->SetObjectField(jni_env, line, priv->field_GVRKUmsUmsLine_saldo, saldo);
+    (*jni_env)->DeleteLocalRef(jni_env, saldo);
+
+    for (i = 0; i < G_N_ELEMENTS(usage); i++) {
+        jstring jusage = (*jni_env)->NewStringUTF(jni_env, usage[i]);
+        (*jni_env)->CallVoidMethod(jni_env, line, add_usage, jusage);
+        (*jni_env)->DeleteLocalRef(jni_env, jusage);
+    }
+
+    set_string_field(jni_env, line, priv->field_GVRKUmsUmsLine_gvcode, "105");
+    set_string_field(jni_env, line, priv->field_GVRKUmsUmsLine_text, "FOLGELASTSCHRIFT");
+
+    obj = new_konto(context, jni_env);
+    (*jni_env)->SetObjectField(jni_env, line, priv->field_GVRKUmsUmsLine_other, obj);
+    (*jni_env)->DeleteLocalRef(jni_env, obj);
+
+    return line;
+}
+
+/*
+ * benchmarks
+ */
+
+typedef struct
+{
+    GHbciContext* context;
+    JNIEnv* jni_env;
+    jobject umsline;
+    GHbciJStringArena arena;
+    GHbciAccount* account;
+    jobject callback;
+    jmethodID native_callback;
+    jstring message;
+    jobject string_buffer;
+    guint blzs;
+} Bench;
+
+static void
+bench_statement_new (gpointer data)
+{
+    Bench* bench = data;
+
+    g_object_unref(ghbci_statement_new_with_jobject(bench->context, NULL, bench->umsline, &bench->arena));
+    ghbci_jstring_arena_reset(&bench->arena);
+}
+
+static void
+bench_account_get_property (gpointer data)
+{
+    Bench* bench = data;
+    gchar* blz;
+    gchar* number;
+    gchar* owner_name;
+    gchar* iban;
+
+    g_object_get(bench->account, "blz", &blz, "number", &number, "owner-name", &owner_name, "iban", &iban, NULL);
+    g_free(blz);
+    g_free(number);
+    g_free(owner_name);
+    g_free(iban);
+}
+
+static void
+count_blz (const gchar* blz, gpointer user_data)
+{
+    Bench* bench = user_data;
+
+    bench->blzs++;
+}
+
+static void
+bench_blz_foreach (gpointer data)
+{
+    Bench* bench = data;
+
+    ghbci_context_blz_foreach(bench->context, count_blz, bench);
+}
+
+static gchar*
+answer (GHbciContext* context, gint64 reason, const gchar* msg, const gchar* optional, gpointer user_data)
+{
+    return g_strdup("12345");
+}
+
+static void
+bench_callback (gpointer data)
+{
+    Bench* bench = data;
+    JNIEnv* jni_env = bench->jni_env;
+
+    (*jni_env)->CallVoidMethod(jni_env, bench->callback, bench->native_callback,
+            NULL, (jint)GHBCI_REASON_ENUM_NEED_PT_PIN, bench->message, 0, bench->string_buffer);
+}
+
+int
+main (int argc, char *argv[])
+{
+    GHbciContextPrivate* priv;
+    Bench bench;
+    gchar* directory;
+
+    directory = g_dir_make_tmp("ghbci-bench-XXXXXX", NULL);
+    if (directory == NULL) {
+        g_printerr("creating temporary directory failed\n");
+        return 1;
+    }
+
+    bench.context = ghbci_context_new(directory);
+    if (bench.context == NULL) {
+        g_print("jvm or hbci4java not available, skipping\n");
+        return 77;
+    }
+    priv = bench.context->priv;
+    bench.jni_env = ghbci_context_get_jni_env(bench.context);
+
+    bench.umsline = new_umsline(bench.context, bench.jni_env);
+    ghbci_jstring_arena_init(&bench.arena);
+
+    jobject konto = new_konto(bench.context, bench.jni_env);
+    bench.account = ghbci_account_new_with_jobject(bench.context, konto);
+    (*bench.jni_env)->DeleteLocalRef(bench.jni_env, konto);
+
+    bench.callback = (*bench.jni_env)->NewObject(bench.jni_env, priv->class_HBCICallbackNative,
+            priv->method_HBCICallbackNative_constructor);
+    bench.native_callback = (*bench.jni_env)->GetMethodID(bench.jni_env, priv->class_HBCICallbackNative, "nativeCallback",
+            "(Lorg/kapott/hbci/passport/HBCIPassport;ILjava/lang/String;ILjava/lang/StringBuffer;)V");
+    bench.message = (*bench.jni_env)->NewStringUTF(bench.jni_env, "Bitte geben Sie Ihre PIN ein");
+    jmethodID string_buffer_constructor = (*bench.jni_env)->GetMethodID(bench.jni_env, priv->class_StringBuffer,
+            "<init>", "()V");
+    bench.string_buffer = (*bench.jni_env)->NewObject(bench.jni_env, priv->class_StringBuffer, string_buffer_constructor);
+    g_signal_connect(bench.context, "callback", G_CALLBACK(answer), NULL);
+
+#ifdef GHBCI_ENABLE_INSTRUMENTATION
+    jni_counting = ghbci_instrumentation_install(bench.jni_env);
+    ghbci_instrumentation_swap_counters(&counters);
+#ifdef __GLIBC__
+    allocation_counting = TRUE;
+#endif
+#endif
+
+    g_print("%-32s %12s %12s %12s\n", "operation", "ns/op", "allocs/op", "jni calls/op");
+
+    run("statement_new_with_jobject", bench_statement_new, &bench, BATCH, 1);
+    run("account_get_property", bench_account_get_property, &bench, BATCH, 4);
+    run("callback bridge", bench_callback, &bench, BATCH, 1);
+
+    // one run over all known banks, reported per bank
+    bench.blzs = 0;
+    ghbci_context_blz_foreach(bench.context, count_blz, &bench);
+    if (bench.blzs > 0)
+        run("blz_foreach (per blz)", bench_blz_foreach, &bench, 1, bench.blzs);
+
+    ghbci_jstring_arena_clear(&bench.arena);
+    g_object_unref(bench.account);
+    g_object_unref(bench.context);
+    g_rmdir(directory);
+    g_free(directory);
+    return 0;
+}
+
+
+//vim: expandtab sw=4
@@ -0,0 +1,384 @@
+#!/usr/bin/env python3
+#
+# mock-pintan-server.py
+#
+# ghbci - A GObject wrapper of the hbci4java library
+# Copyright (C) 2014-2015 Florian Richter
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 3 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+# for more details.
+
+"""
+Local stand-in for a FinTS 3.0 PIN/TAN bank
+
+Answers the dialogs hbci4java runs for add_passport (anonymous BPD,
+synchronisation, UPD), SaldoReq, KUmsAll, UebSEPA and SEPAInfo with
+scripted responses. Only the one-step PIN method 999 is offered, so no
+TAN is needed. Every response segment is checked against hbci-300.xml of
+the jar on startup, so the script fails loudly instead of sending
+messages hbci4java can't parse.
+
+Accounts are named after the number of statement lines they return:
+10, 1000 and 100000. Statements are paged with touchdown points (return
+code 3040) like real banks do.
+"""
+
+import argparse
+import base64
+import datetime
+import http.server
+import itertools
+import re
+import socketserver
+import ssl
+import sys
+import threading
+import zipfile
+
+BLZ = '12345678'
+BIC = 'MOCKDEFFXXX'
+BANK_NAME = 'Mock Bank'
+SYSID = 'MOCKSYSID00001'
+BPD_VERSION = '12'
+UPD_VERSION = '3'
+ACCOUNTS = ['10', '1000', '100000']
+PAGE_SIZE = 5000
+
+# (code, version) of all segments sent by the server
+RESPONSE_SEGMENTS = {
+    ('HIRMG', 2), ('HIRMS', 2), ('HIBPA', 3), ('HIKOM', 4), ('HISHV', 3),
+    ('HIPINS', 1), ('HISALS', 6), ('HIKAZS', 6), ('HICCSS', 1), ('HISPAS', 1),
+    ('HIUPA', 4), ('HIUPD', 6), ('HISYN', 3), ('HISYN', 4), ('HISAL', 6),
+    ('HIKAZ', 6), ('HISPA', 1),
+}
+
+
+def check_spec(jar):
+    """Make sure hbci4java knows every segment version we send"""
+    with zipfile.ZipFile(jar) as archive:
+        spec = archive.read('hbci-300.xml').decode('iso-8859-1')
+
+    known = set()
+    for segdef in re.finditer(r'<SEGdef id="[^"]+"[^>]*>(.*?)</SEGdef>', spec, re.S):
+        code = re.search(r'<value path="SegHead.code">(\w+)</value>', segdef.group(1))
+        version = re.search(r'<value path="SegHead.version">(\d+)</value>', segdef.group(1))
+        if code and version:
+            known.add((code.group(1), int(version.group(1))))
+
+    missing = sorted(RESPONSE_SEGMENTS - known)
+    if missing:
+        sys.exit('hbci-300.xml lacks segments %s' % missing)
+
+
+def iban(number):
+    bban = BLZ + number.rjust(10, '0')
+    check = 98 - int(bban + '131400') % 97
+    return 'DE%02d%s' % (check, bban)
+
+
+# --- syntax
+
+def escape(value):
+    return re.sub(r"([?@:+'])", r'?\1', value)
+
+
+def parse(data):
+    """Split message into segments of data elements of group elements"""
+    segments = []
+    segment = []
+    element = []
+    value = []
+    i = 0
+    while i < len(data):
+        c = data[i]
+        if c == '?':
+            value.append(data[i + 1])
+            i += 2
+            continue
+        if c == '@':
+            end = data.index('@', i + 1)
+            length = int(data[i + 1:end])
+            value.append(data[end + 1:end + 1 + length])
+            i = end + 1 + length
+            continue
+        if c in ":+'":
+            element.append(''.join(value))
+            value = []
+            if c in "+'":
+                segment.append(element)
+                element = []
+            if c == "'":
+                segments.append(segment)
+                segment = []
+        else:
+            value.append(c)
+        i += 1
+    return segments
+
+
+def binary(value):
+    return '@%d@%s' % (len(value), value)
+
+
+class Response:
+    """Collects response segments and numbers them"""
+
+    def __init__(self):
+        self.segments = []
+        self.global_rets = []
+
+    def add(self, code, version, *elements, ref=None):
+        self.segments.append((code, version, ref, elements))
+
+    def ret(self, ref, *rets):
+        # rets: (code, text, [params])
+        self.add('HIRMS', 2, *[retval(*r) for r in rets], ref=ref)
+
+    def render(self, first_number):
+        body = []
+        head = ('HIRMG', 2, None, [retval(*r) for r in self.global_rets])
+        number = first_number
+        for code, version, ref, elements in [head] + self.segments:
+            header = '%s:%d:%d' % (code, number, version)
+            if ref is not None:
+                header += ':%d' % ref
+            body.append('+'.join([header] + list(elements)) + "'")
+            number += 1
+        return ''.join(body), number
+
+
+def retval(code, text, params=()):
+    return ':'.join([code, '', escape(text)] + [escape(p) for p in params])
+
+
+def message(dialog_id, msgnum, ref_msgnum, response, crypted, userid):
+    if crypted:
+        inner, number = response.render(2)
+        now = datetime.datetime.now()
+        middle = ("HNVSK:998:3+PIN:1+998+1+2::%s+1:%s:%s+2:2:13:@8@00000000:5:1+280:%s:%s:V:0:0+0'"
+                  % (SYSID, now.strftime('%Y%m%d'), now.strftime('%H%M%S'), BLZ, escape(userid))
+                  + "HNVSD:999:1+%s'" % binary(inner))
+    else:
+        middle, number = response.render(2)
+    tail = "HNHBS:%d:1+%d'" % (number, msgnum)
+    head_format = "HNHBK:1:3+%012d+300+" + escape(dialog_id) + "+%d+" + escape(dialog_id) + ":%d'"
+    size = len(head_format % (0, msgnum, ref_msgnum)) + len(middle) + len(tail)
+    return head_format % (size, msgnum, ref_msgnum) + middle + tail
+
+
+# --- business data
+
+def bpd():
+    yield 'HIBPA', 3, BPD_VERSION, '280:' + BLZ, escape(BANK_NAME), '0', '1', '300'
+    yield 'HIKOM', 4, '280:' + BLZ, '1', '3:' + escape(SERVER_URL) + '::MIM:1'
+    yield 'HISHV', 3, 'N', 'PIN:1'
+    yield ('HIPINS', 1, '1', '1', '0',
+           ':'.join(['5', '20', '6', 'Benutzerkennung', 'Kunden-ID',
+                     'HKSAL', 'N', 'HKKAZ', 'N', 'HKCCS', 'N', 'HKSPA', 'N']))
+    yield 'HISALS', 6, '1', '1', '0'
+    yield 'HIKAZS', 6, '1', '1', '0', '360:J:N'
+    yield 'HICCSS', 1, '1', '1', '0'
+    yield 'HISPAS', 1, '1', '1', '0', 'J:J:N:' + escape('urn:iso:std:iso:20022:tech:xsd:pain.001.003.03')
+
+
+def upd(userid, customerid):
+    yield 'HIUPA', 4, escape(userid), UPD_VERSION, '0'
+    for number in ACCOUNTS:
+        yield ('HIUPD', 6, '%s::280:%s' % (number, BLZ), iban(number), escape(customerid), '1',
+               'EUR', 'Mock Kunde', '', 'Girokonto ' + number, '',
+               'HKSAL:1', 'HKKAZ:1', 'HKCCS:1', 'HKSPA:1')
+
+
+def line_amount(i):
+    """Amount of statement line i in cent"""
+    return (1 + i % 97) * 100 + i % 100
+
+
+def amount(cent):
+    return '%d,%02d' % (cent // 100, cent % 100)
+
+
+def mt940(number, start, count):
+    """MT940 statement with lines start..start+count, :61: and :86: records each"""
+    opening = 1000000000 - sum(line_amount(i) for i in range(start))
+    closing = opening - sum(line_amount(i) for i in range(start, start + count))
+    records = [':20:STARTUMS', ':25:%s/%s' % (BLZ, number), ':28C:0',
+               ':60F:C260101EUR' + amount(opening)]
+    for i in range(start, start + count):
+        day = datetime.date(2026, 1, 1) + datetime.timedelta(days=i % 365)
+        date = day.strftime('%y%m%d')
+        records.append(':61:%s%sD%sNMSCNONREF' % (date, date[2:], amount(line_amount(i))))
+        records.append(':86:105?00LASTSCHRIFT?20EREF+BENCH%d?21SVWZ+Benchmark Zeile %d'
+                       '?30%s?31%s?32Mock Empfaenger' % (i, i, BIC, iban(number)))
+    records += [':62F:C261231EUR' + amount(closing), '-']
+    return '\r\n' + '\r\n'.join(records) + '\r\n'
+
+
+# --- dialogs
+
+class Bank:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.dialog_ids = itertools.count(1)
+        self.msgnums = {}
+
+    def handle(self, request):
+        segments = parse(request)
+        head = segments[0]
+        dialog_id = head[3][0]
+        ref_msgnum = int(head[4][0])
+
+        # unwrap encrypted payload
+        crypted = False
+        for segment in segments:
+            if segment[0][0] == 'HNVSD':
+                segments = parse(segment[1][0])
+                crypted = True
+
+        userid = customerid = ''
+        for segment in segments:
+            if segment[0][0] == 'HKIDN':
+                customerid = segment[2][0]
+            elif segment[0][0] == 'HNSHK':
+                # key name is the last element: country, blz, userid, ...
+                key_name = segment[-1]
+                if len(key_name) > 2:
+                    userid = key_name[2]
+        userid = userid or customerid
+
+        with self.lock:
+            if dialog_id == '0':
+                dialog_id = 'MOCK%08d' % next(self.dialog_ids)
+            msgnum = self.msgnums.get(dialog_id, 0) + 1
+            self.msgnums[dialog_id] = msgnum
+
+        response = Response()
+        response.global_rets.append(('0010', 'Nachricht entgegengenommen.'))
+        anonymous = customerid == '9999999999'
+
+        for segment in segments:
+            code = segment[0][0]
+            number = int(segment[0][1])
+            version = int(segment[0][2])
+            handler = getattr(self, 'do_' + code, None)
+            if handler is not None:
+                handler(response, segment, number, version, userid, customerid, anonymous)
+            elif code.startswith('HK'):
+                response.ret(number, ('9010', 'Geschaeftsvorfall wird nicht unterstuetzt.'))
+
+        with self.lock:
+            if any(segment[0][0] == 'HKEND' for segment in segments):
+                self.msgnums.pop(dialog_id, None)
+
+        return message(dialog_id, msgnum, ref_msgnum, response, crypted and not anonymous, userid)
+
+    def do_HKIDN(self, response, segment, number, version, userid, customerid, anonymous):
+        response.ret(number, ('0020', 'Dialoginitialisierung erfolgreich.'))
+
+    def do_HKVVB(self, response, segment, number, version, userid, customerid, anonymous):
+        rets = []
+        if segment[1][0] != BPD_VERSION:
+            for item in bpd():
+                response.add(*item)
+            rets.append(('3050', 'BPD nicht mehr aktuell, aktuelle Version enthalten.'))
+        if not anonymous:
+            if segment[2][0] != UPD_VERSION:
+                for item in upd(userid, customerid):
+                    response.add(*item)
+                rets.append(('3050', 'UPD nicht mehr aktuell, aktuelle Version enthalten.'))
+            rets.append(('3920', 'Zugelassene TAN-Verfahren fuer den Benutzer.', ['999']))
+        rets.append(('0020', 'Auftrag ausgefuehrt.'))
+        response.ret(number, *rets)
+
+    def do_HKSYN(self, response, segment, number, version, userid, customerid, anonymous):
+        response.add('HISYN', version, SYSID, ref=number)
+        response.ret(number, ('0020', 'Auftrag ausgefuehrt.'))
+
+    def do_HKEND(self, response, segment, number, version, userid, customerid, anonymous):
+        response.global_rets[:] = [('0100', 'Dialog beendet.')]
+        response.ret(number, ('0020', 'Auftrag ausgefuehrt.'))
+
+    def do_HKSPA(self, response, segment, number, version, userid, customerid, anonymous):
+        accounts = ['J:%s:%s:%s::280:%s' % (iban(n), BIC, n, BLZ) for n in ACCOUNTS]
+        response.add('HISPA', 1, *accounts, ref=number)
+        response.ret(number, ('0020', 'Auftrag ausgefuehrt.'))
+
+    def do_HKSAL(self, response, segment, number, version, userid, customerid, anonymous):
+        account = segment[1][0]
+        today = datetime.date.today().strftime('%Y%m%d')
+        response.add('HISAL', 6, '%s::280:%s' % (account, BLZ), 'Girokonto ' + account, 'EUR',
+                     'C:1000000,00:EUR:' + today, ref=number)
+        response.ret(number, ('0020', 'Auftrag ausgefuehrt.'))
+
+    def do_HKKAZ(self, response, segment, number, version, userid, customerid, anonymous):
+        account = segment[1][0]
+        total = int(account) if account in ACCOUNTS else 0
+        offset = segment[6][0] if len(segment) > 6 and segment[6] and segment[6][0] else '0'
+        start = int(offset)
+        count = min(PAGE_SIZE, total - start)
+
+        response.add('HIKAZ', 6, binary(mt940(account, start, count)), ref=number)
+        if start + count < total:
+            response.ret(number, ('3040', 'Es liegen weitere Informationen vor.', [str(start + count)]))
+        else:
+            response.ret(number, ('0020', 'Auftrag ausgefuehrt.'))
+
+    def do_HKCCS(self, response, segment, number, version, userid, customerid, anonymous):
+        response.ret(number, ('0020', 'Auftrag ausgefuehrt.'))
+
+
+class Handler(http.server.BaseHTTPRequestHandler):
+    protocol_version = 'HTTP/1.1'
+
+    def do_POST(self):
+        length = int(self.headers.get('Content-Length', 0))
+        request = base64.b64decode(self.rfile.read(length)).decode('iso-8859-1')
+        answer = base64.b64encode(self.server.bank.handle(request).encode('iso-8859-1'))
+
+        self.send_response(200)
+        self.send_header('Content-Type', 'text/plain')
+        self.send_header('Content-Length', str(len(answer)))
+        self.end_headers()
+        self.wfile.write(answer)
+
+    def log_message(self, format, *args):
+        pass
+
+
+class Server(socketserver.ThreadingMixIn, http.server.HTTPServer):
+    daemon_threads = True
+
+
+def main():
+    global SERVER_URL
+
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('--jar', required=True, help='hbci4java.jar to check segment versions against')
+    parser.add_argument('--cert', required=True, help='certificate and key in PEM format')
+    parser.add_argument('--port', type=int, default=0)
+    args = parser.parse_args()
+
+    check_spec(args.jar)
+
+    server = Server(('127.0.0.1', args.port), Handler)
+    server.bank = Bank()
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    context.load_cert_chain(args.cert)
+    server.socket = context.wrap_socket(server.socket, server_side=True)
+
+    SERVER_URL = 'localhost:%d/' % server.server_address[1]
+    # tell the harness where we listen
+    print(server.server_address[1], flush=True)
+    server.serve_forever()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+#
+# run-benchmark.py
+#
+# ghbci - A GObject wrapper of the hbci4java library
+# Copyright (C) 2014-2015 Florian Richter
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 3 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+# for more details.
+
+"""
+Run a benchmark executable against the mock PIN/TAN server
+
+Creates a self-signed certificate, makes the JVM trust it (the context
+always checks certificates), starts mock-pintan-server.py and runs the
+benchmark with GHBCI_MOCK_PORT set. Exits with 77 (skipped) if the jar,
+openssl or keytool are missing.
+
+usage: run-benchmark.py BENCHMARK SERVER JAR [ITERATIONS]
+"""
+
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+SKIP = 77
+
+
+def main():
+    if len(sys.argv) < 4:
+        sys.exit(__doc__.strip().splitlines()[-1])
+    benchmark, server, jar = sys.argv[1:4]
+    iterations = sys.argv[4] if len(sys.argv) > 4 else '10'
+
+    for tool in ('openssl', 'keytool'):
+        if shutil.which(tool) is None:
+            print('%s not found, skipping' % tool)
+            return SKIP
+    if not os.path.exists(jar):
+        print('%s not installed, skipping' % jar)
+        return SKIP
+
+    with tempfile.TemporaryDirectory(prefix='ghbci-bench-') as directory:
+        key = os.path.join(directory, 'key.pem')
+        cert = os.path.join(directory, 'cert.pem')
+        truststore = os.path.join(directory, 'truststore.jks')
+        passports = os.path.join(directory, 'passports')
+        os.mkdir(passports)
+
+        subprocess.check_call(['openssl', 'req', '-x509', '-newkey', 'rsa:2048', '-nodes',
+                               '-keyout', key, '-out', cert, '-days', '1',
+                               '-subj', '/CN=localhost', '-addext', 'subjectAltName=DNS:localhost'],
+                              stderr=subprocess.DEVNULL)
+        subprocess.check_call(['keytool', '-importcert', '-noprompt', '-alias', 'mock',
+                               '-file', cert, '-keystore', truststore, '-storepass', 'benchmark'],
+                              stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        with open(os.path.join(directory, 'server.pem'), 'w') as pem:
+            pem.write(open(cert).read() + open(key).read())
+
+        mock = subprocess.Popen([sys.executable, server, '--jar', jar, '--cert', pem.name],
+                                stdout=subprocess.PIPE, universal_newlines=True)
+        try:
+            port = mock.stdout.readline().strip()
+            if not port:
+                print('mock server failed to start')
+                return 1
+
+            env = dict(os.environ)
+            env['GHBCI_MOCK_PORT'] = port
+            env['JAVA_TOOL_OPTIONS'] = ('-Djavax.net.ssl.trustStore=%s -Djavax.net.ssl.trustStorePassword=benchmark'
+                                        % truststore)
+            return subprocess.call([benchmark, passports, iterations], env=env)
+        finally:
+            mock.terminate()
+            mock.wait()
+
+
+if __name__ == '__main__':
+    sys.exit(main())
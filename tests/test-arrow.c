@@ -0,0 +1,175 @@
+#include <string.h>
+#include <glib.h>
+#include "ghbci/ghbci-statement.h"
+#include "ghbci/ghbci-statement-private.h"
+#include "ghbci/ghbci-export.h"
+#include "ghbci/ghbci-arrow-private.h"
+#include "test-helpers.h"
+
+enum
+{
+    VALUTA,
+    BOOKING_DATE,
+    VALUE,
+    CURRENCY,
+    SALDO,
+    GV_CODE,
+    TRANSACTION_TYPE,
+    OTHER_NAME,
+    OTHER_IBAN,
+    OTHER_BIC,
+    EREF,
+    MREF,
+    CRED,
+    REFERENCE,
+    N_COLUMNS
+};
+
+static gboolean
+is_valid (const struct ArrowArray* array, gint64 index)
+{
+    const guint8* validity = array->buffers[0];
+
+    return validity == NULL || (validity[index / 8] & (1 << (index % 8))) != 0;
+}
+
+static gint64
+decimal_at (const struct ArrowArray* array, gint64 index)
+{
+    const gint64* values = array->buffers[1];
+
+    // low 64 bits on little endian machines
+    return values[2 * index];
+}
+
+static void
+test_schema(void)
+{
+    GSList* statements = create_statements();
+    struct ArrowArray array;
+    struct ArrowSchema schema;
+
+    ghbci_export_statements_arrow(statements, &array, &schema);
+    g_slist_free_full(statements, g_object_unref);
+
+    g_assert_cmpstr(schema.format, ==, "+s");
+    g_assert_cmpint(schema.n_children, ==, N_COLUMNS);
+    g_assert_cmpstr(schema.children[VALUTA]->name, ==, "valuta");
+    g_assert_cmpstr(schema.children[VALUTA]->format, ==, "tdD");
+    g_assert_cmpstr(schema.children[VALUE]->format, ==, "d:18,2");
+    g_assert_cmpstr(schema.children[GV_CODE]->format, ==, "i");
+    g_assert_cmpstr(schema.children[GV_CODE]->dictionary->format, ==, "u");
+    g_assert_cmpstr(schema.children[REFERENCE]->name, ==, "reference");
+    g_assert_cmpstr(schema.children[REFERENCE]->format, ==, "U");
+    g_assert_cmpint(schema.children[REFERENCE]->flags, ==, ARROW_FLAG_NULLABLE);
+
+    schema.release(&schema);
+    g_assert_null(schema.release);
+    array.release(&array);
+    g_assert_null(array.release);
+}
+
+static void
+test_columns(void)
+{
+    GSList* statements = create_statements();
+    struct ArrowArray array;
+    struct ArrowSchema schema;
+    const struct ArrowArray* column;
+
+    ghbci_export_statements_arrow(statements, &array, &schema);
+    g_slist_free_full(statements, g_object_unref);
+    g_assert_cmpint(array.length, ==, 3);
+    g_assert_cmpint(array.n_children, ==, N_COLUMNS);
+
+    // days since 1970-01-01
+    column = array.children[BOOKING_DATE];
+    g_assert_cmpint(column->null_count, ==, 1);
+    g_assert_cmpint(((const gint32*)column->buffers[1])[0], ==, 0);
+    g_assert_cmpint(((const gint32*)column->buffers[1])[1], ==, 20455);
+    g_assert_false(is_valid(column, 2));
+    g_assert_cmpint(array.children[VALUTA]->null_count, ==, 2);
+
+    column = array.children[VALUE];
+    g_assert_cmpint(column->null_count, ==, 0);
+    g_assert_cmpint(decimal_at(column, 0), ==, 550);
+    g_assert_cmpint(decimal_at(column, 1), ==, -1234);
+    g_assert_cmpint(decimal_at(column, 2), ==, -1);
+    g_assert_cmpint(((const gint64*)column->buffers[1])[5], ==, -1);
+
+    column = array.children[SALDO];
+    g_assert_cmpint(column->null_count, ==, 1);
+    g_assert_false(is_valid(column, 0));
+    g_assert_true(is_valid(column, 1));
+    g_assert_cmpint(decimal_at(column, 2), ==, 99315);
+
+    // dictionary indices in order of appearance
+    column = array.children[TRANSACTION_TYPE];
+    g_assert_cmpint(((const gint32*)column->buffers[1])[0], ==, 0);
+    g_assert_cmpint(((const gint32*)column->buffers[1])[1], ==, 1);
+    g_assert_cmpint(((const gint32*)column->buffers[1])[2], ==, 1);
+    g_assert_cmpint(column->dictionary->length, ==, 2);
+    g_assert_cmpint(((const gint32*)column->dictionary->buffers[1])[2], ==, 21);
+    g_assert_true(memcmp(column->dictionary->buffers[2], "GUTSCHRIFTLASTSCHRIFT", 21) == 0);
+    g_assert_cmpint(array.children[GV_CODE]->null_count, ==, 1);
+    g_assert_cmpint(array.children[CURRENCY]->dictionary->length, ==, 1);
+
+    column = array.children[REFERENCE];
+    g_assert_cmpint(column->null_count, ==, 0);
+    g_assert_cmpint(((const gint64*)column->buffers[1])[1], ==, 5);
+    g_assert_cmpint(((const gint64*)column->buffers[1])[3], ==, 28);
+    g_assert_true(memcmp(column->buffers[2], "MieteAbschlag \"Strom\"\nJanuar", 28) == 0);
+    g_assert_cmpint(array.children[OTHER_NAME]->null_count, ==, 2);
+
+    schema.release(&schema);
+    array.release(&array);
+}
+
+static void
+test_move_child(void)
+{
+    GSList* statements = create_statements();
+    struct ArrowArray array;
+    struct ArrowSchema schema;
+    struct ArrowArray moved;
+
+    ghbci_export_statements_arrow(statements, &array, &schema);
+    g_slist_free_full(statements, g_object_unref);
+
+    // a consumer may keep a column after releasing the rest
+    moved = *array.children[REFERENCE];
+    array.children[REFERENCE]->release = NULL;
+    array.release(&array);
+    g_assert_true(memcmp(moved.buffers[2], "Miete", 5) == 0);
+    moved.release(&moved);
+    schema.release(&schema);
+}
+
+static void
+test_empty(void)
+{
+    struct ArrowArray array;
+    struct ArrowSchema schema;
+
+    ghbci_export_statements_arrow(NULL, &array, &schema);
+    g_assert_cmpint(array.length, ==, 0);
+    g_assert_cmpint(array.children[REFERENCE]->length, ==, 0);
+    g_assert_nonnull(array.children[REFERENCE]->buffers[1]);
+    schema.release(&schema);
+    array.release(&array);
+}
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/arrow/schema", test_schema);
+    g_test_add_func ("/arrow/columns", test_columns);
+    g_test_add_func ("/arrow/move-child", test_move_child);
+    g_test_add_func ("/arrow/empty", test_empty);
+    return g_test_run ();
+}
+
+
+//vim: expandtab sw=4
@@ -0,0 +1,268 @@
+#include <string.h>
+#include <glib.h>
+#include "ghbci/ghbci-statement.h"
+#include "ghbci/ghbci-camt-private.h"
+
+static const gchar report[] =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<Document xmlns=\"urn:iso:std:iso:20022:tech:xsd:camt.052.001.02\">\n"
+    " <BkToCstmrAcctRpt>\n"
+    "  <GrpHdr><MsgId>camt52_20260102</MsgId></GrpHdr>\n"
+    "  <Rpt>\n"
+    "   <Acct><Id><IBAN>DE65123456780000000010</IBAN></Id><Ccy>EUR</Ccy></Acct>\n"
+    "   <Bal>\n"
+    "    <Tp><CdOrPrtry><Cd>PRCD</Cd></CdOrPrtry></Tp>\n"
+    "    <Amt Ccy=\"EUR\">1000.00</Amt><CdtDbtInd>CRDT</CdtDbtInd>\n"
+    "    <Dt><Dt>2026-01-01</Dt></Dt>\n"
+    "   </Bal>\n"
+    "   <Bal>\n"
+    "    <Tp><CdOrPrtry><Cd>CLBD</Cd></CdOrPrtry></Tp>\n"
+    "    <Amt Ccy=\"EUR\">1.00</Amt><CdtDbtInd>DBIT</CdtDbtInd>\n"
+    "   </Bal>\n"
+    "   <Ntry>\n"
+    "    <Amt Ccy=\"EUR\">12.34</Amt>\n"
+    "    <CdtDbtInd>DBIT</CdtDbtInd>\n"
+    "    <Sts>BOOK</Sts>\n"
+    "    <BookgDt><Dt>2026-01-02</Dt></BookgDt>\n"
+    "    <ValDt><Dt>2026-01-03</Dt></ValDt>\n"
+    "    <BkTxCd><Prtry><Cd>NDDT+105+9900+1234</Cd><Issr>DK</Issr></Prtry></BkTxCd>\n"
+    "    <NtryDtls><TxDtls>\n"
+    "     <Refs><EndToEndId>42</EndToEndId><MndtId>C5D043E1A2C847988DF9F35F005785EB</MndtId></Refs>\n"
+    "     <RltdPties>\n"
+    "      <Dbtr><Nm>Mock Kunde</Nm></Dbtr>\n"
+    "      <DbtrAcct><Id><IBAN>DE65123456780000000010</IBAN></Id></DbtrAcct>\n"
+    "      <Cdtr><Nm>Stadtwerke M&#252;nchen &amp; Co</Nm>\n"
+    "       <Id><PrvtId><Othr><Id>DE05ZZZ00000205131</Id><SchmeNm><Prtry>SEPA</Prtry></SchmeNm></Othr></PrvtId></Id>\n"
+    "      </Cdtr>\n"
+    "      <CdtrAcct><Id><IBAN>DE09370205000004108405</IBAN></Id></CdtrAcct>\n"
+    "     </RltdPties>\n"
+    "     <RltdAgts><CdtrAgt><FinInstnId><BIC>BFSWDE33</BIC></FinInstnId></CdtrAgt></RltdAgts>\n"
+    "     <RmtInf><Ustrd>Abschlag Strom</Ustrd><Ustrd>Januar 2026</Ustrd></RmtInf>\n"
+    "    </TxDtls></NtryDtls>\n"
+    "    <AddtlNtryInf>LASTSCHRIFT</AddtlNtryInf>\n"
+    "   </Ntry>\n"
+    "   <Ntry>\n"
+    "    <Amt Ccy=\"EUR\">5</Amt>\n"
+    "    <CdtDbtInd>CRDT</CdtDbtInd>\n"
+    "    <Sts>BOOK</Sts>\n"
+    "    <BookgDt><Dt>2026-01-02</Dt></BookgDt>\n"
+    "    <ValDt><Dt>2026-01-02</Dt></ValDt>\n"
+    "    <BkTxCd><Prtry><Cd>NTRF+166+9310</Cd></Prtry></BkTxCd>\n"
+    "    <NtryDtls><TxDtls>\n"
+    "     <Refs><EndToEndId>NOTPROVIDED</EndToEndId></Refs>\n"
+    "     <RltdPties>\n"
+    "      <Dbtr><Nm>Max Mustermann</Nm></Dbtr>\n"
+    "      <DbtrAcct><Id><IBAN>DE38123456780000001000</IBAN></Id></DbtrAcct>\n"
+    "     </RltdPties>\n"
+    "     <RltdAgts><DbtrAgt><FinInstnId><BIC>MOCKDEFFXXX</BIC></FinInstnId></DbtrAgt></RltdAgts>\n"
+    "     <RmtInf><Ustrd>Miete</Ustrd></RmtInf>\n"
+    "    </TxDtls></NtryDtls>\n"
+    "    <AddtlNtryInf>GUTSCHRIFT</AddtlNtryInf>\n"
+    "   </Ntry>\n"
+    "   <Ntry>\n"
+    "    <Amt Ccy=\"EUR\">99.00</Amt>\n"
+    "    <CdtDbtInd>DBIT</CdtDbtInd>\n"
+    "    <Sts>PDNG</Sts>\n"
+    "   </Ntry>\n"
+    "  </Rpt>\n"
+    " </BkToCstmrAcctRpt>\n"
+    "</Document>\n";
+
+static void
+collect (GHbciStatement* statement, gpointer user_data)
+{
+    GPtrArray* statements = user_data;
+
+    g_ptr_array_add(statements, statement);
+}
+
+/*
+ * Feed the document in chunks of chunk_size bytes
+ */
+static GPtrArray*
+decode (const gchar* data, gsize chunk_size, GError** error)
+{
+    GPtrArray* statements = g_ptr_array_new_with_free_func(g_object_unref);
+    GHbciCamtDecoder* decoder = ghbci_camt_decoder_new(NULL, collect, statements);
+    gsize length = strlen(data);
+    gsize offset;
+    gboolean success = TRUE;
+
+    for (offset = 0; success && offset < length; offset += chunk_size)
+        success = ghbci_camt_decoder_feed(decoder, data + offset, MIN(chunk_size, length - offset), error);
+    if (success)
+        success = ghbci_camt_decoder_finish(decoder, error);
+    ghbci_camt_decoder_free(decoder);
+
+    if (!success) {
+        g_ptr_array_unref(statements);
+        return NULL;
+    }
+    return statements;
+}
+
+static void
+test_debit(void)
+{
+    GError* error = NULL;
+    GPtrArray* statements = decode(report, 7, &error);
+    GDate* valuta;
+    GDate* booking_date;
+    gchar* value;
+    gchar* saldo;
+    gchar* gv_code;
+    gchar* transaction_type;
+    gchar* reference;
+    gchar* other_name;
+    gchar* other_iban;
+    gchar* other_bic;
+    gchar* eref;
+    gchar* mref;
+    gchar* cred;
+
+    g_assert_no_error(error);
+    g_assert_cmpuint(statements->len, ==, 2);
+
+    g_object_get(g_ptr_array_index(statements, 0),
+                 "valuta", &valuta,
+                 "booking-date", &booking_date,
+                 "value", &value,
+                 "saldo", &saldo,
+                 "gv-code", &gv_code,
+                 "transaction-type", &transaction_type,
+                 "reference", &reference,
+                 "other-name", &other_name,
+                 "other-iban", &other_iban,
+                 "other-bic", &other_bic,
+                 "eref", &eref,
+                 "mref", &mref,
+                 "cred", &cred,
+                 NULL);
+    g_assert_cmpint(g_date_get_day(valuta), ==, 3);
+    g_assert_cmpint(g_date_get_day(booking_date), ==, 2);
+    g_assert_cmpint(g_date_get_year(booking_date), ==, 2026);
+    g_assert_cmpstr(value, ==, "-12.34 EUR");
+    g_assert_cmpstr(saldo, ==, "987.66 EUR");
+    g_assert_cmpstr(gv_code, ==, "105");
+    g_assert_cmpstr(transaction_type, ==, "LASTSCHRIFT");
+    g_assert_cmpstr(reference, ==, "Abschlag Strom Januar 2026");
+    g_assert_cmpstr(other_name, ==, "Stadtwerke M\xc3\xbcnchen & Co");
+    g_assert_cmpstr(other_iban, ==, "DE09370205000004108405");
+    g_assert_cmpstr(other_bic, ==, "BFSWDE33");
+    g_assert_cmpstr(eref, ==, "42");
+    g_assert_cmpstr(mref, ==, "C5D043E1A2C847988DF9F35F005785EB");
+    g_assert_cmpstr(cred, ==, "DE05ZZZ00000205131");
+    g_date_free(valuta);
+    g_date_free(booking_date);
+    g_free(value);
+    g_free(saldo);
+    g_free(gv_code);
+    g_free(transaction_type);
+    g_free(reference);
+    g_free(other_name);
+    g_free(other_iban);
+    g_free(other_bic);
+    g_free(eref);
+    g_free(mref);
+    g_free(cred);
+
+    g_ptr_array_unref(statements);
+}
+
+static void
+test_credit(void)
+{
+    GPtrArray* statements = decode(report, sizeof(report), NULL);
+    gchar* value;
+    gchar* saldo;
+    gchar* gv_code;
+    gchar* other_name;
+    gchar* other_iban;
+    gchar* other_bic;
+    gchar* eref;
+
+    g_object_get(g_ptr_array_index(statements, 1),
+                 "value", &value,
+                 "saldo", &saldo,
+                 "gv-code", &gv_code,
+                 "other-name", &other_name,
+                 "other-iban", &other_iban,
+                 "other-bic", &other_bic,
+                 "eref", &eref,
+                 NULL);
+    g_assert_cmpstr(value, ==, "5.00 EUR");
+    g_assert_cmpstr(saldo, ==, "992.66 EUR");
+    g_assert_cmpstr(gv_code, ==, "166");
+    g_assert_cmpstr(other_name, ==, "Max Mustermann");
+    g_assert_cmpstr(other_iban, ==, "DE38123456780000001000");
+    g_assert_cmpstr(other_bic, ==, "MOCKDEFFXXX");
+    g_assert_null(eref);
+    g_free(value);
+    g_free(saldo);
+    g_free(gv_code);
+    g_free(other_name);
+    g_free(other_iban);
+    g_free(other_bic);
+
+    g_ptr_array_unref(statements);
+}
+
+static void
+test_without_balance(void)
+{
+    GPtrArray* statements = decode(
+            "<Document><BkToCstmrAcctRpt><Rpt><Ntry>"
+            "<Amt Ccy=\"USD\">0.5</Amt><CdtDbtInd>DBIT</CdtDbtInd>"
+            "</Ntry></Rpt></BkToCstmrAcctRpt></Document>", 64, NULL);
+    gchar* value;
+    gchar* saldo;
+    gchar* reference;
+
+    g_assert_cmpuint(statements->len, ==, 1);
+    g_object_get(g_ptr_array_index(statements, 0),
+                 "value", &value,
+                 "saldo", &saldo,
+                 "reference", &reference,
+                 NULL);
+    g_assert_cmpstr(value, ==, "-0.50 USD");
+    g_assert_null(saldo);
+    g_assert_cmpstr(reference, ==, "");
+    g_free(value);
+    g_free(reference);
+
+    g_ptr_array_unref(statements);
+}
+
+static void
+test_invalid(void)
+{
+    GError* error = NULL;
+    GPtrArray* statements;
+
+    statements = decode("<Document><BkToCstmrAcctRpt><Rpt><Ntry>"
+                        "<Amt Ccy=\"EUR\">1,00</Amt><CdtDbtInd>CRDT</CdtDbtInd>"
+                        "</Ntry></Rpt></BkToCstmrAcctRpt></Document>", 16, &error);
+    g_assert_null(statements);
+    g_assert_error(error, G_MARKUP_ERROR, G_MARKUP_ERROR_INVALID_CONTENT);
+    g_clear_error(&error);
+
+    statements = decode("<Document><BkToCstmrAcctRpt><Rpt>", 16, &error);
+    g_assert_null(statements);
+    g_assert_error(error, G_MARKUP_ERROR, G_MARKUP_ERROR_PARSE);
+    g_clear_error(&error);
+}
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/camt/debit", test_debit);
+    g_test_add_func ("/camt/credit", test_credit);
+    g_test_add_func ("/camt/without-balance", test_without_balance);
+    g_test_add_func ("/camt/invalid", test_invalid);
+    return g_test_run ();
+}
+
+
+//vim: expandtab sw=4
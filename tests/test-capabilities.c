@@ -0,0 +1,99 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include "ghbci/ghbci-capabilities.h"
+#include "ghbci/ghbci-capabilities-private.h"
+
+static GHbciCapabilities*
+create_capabilities(void)
+{
+    GHbciCapabilities* capabilities = ghbci_capabilities_new("12345678");
+
+    ghbci_capabilities_set_bank(capabilities, "Testbank", "banking.example.com/fints", "300", "42");
+    ghbci_capabilities_add_job(capabilities, "KUmsAll", 7);
+    ghbci_capabilities_set_job_parameter(capabilities, "KUmsAll", "timerange", "90");
+    ghbci_capabilities_set_job_parameter(capabilities, "KUmsAll", "canmaxentries", "J");
+    ghbci_capabilities_add_job(capabilities, "UebSEPA", 1);
+    ghbci_capabilities_add_tan_method(capabilities, "942", "mobileTAN");
+    return capabilities;
+}
+
+static void
+check_capabilities(GHbciCapabilities* capabilities)
+{
+    gchar** jobs;
+
+    g_assert_cmpstr(ghbci_capabilities_get_blz(capabilities), ==, "12345678");
+    g_assert_cmpstr(ghbci_capabilities_get_bank_name(capabilities), ==, "Testbank");
+    g_assert_cmpstr(ghbci_capabilities_get_pin_tan_url(capabilities), ==, "banking.example.com/fints");
+    g_assert_cmpstr(ghbci_capabilities_get_hbci_version(capabilities), ==, "300");
+    g_assert_cmpstr(ghbci_capabilities_get_bpd_version(capabilities), ==, "42");
+
+    g_assert_true(ghbci_capabilities_supports_job(capabilities, "KUmsAll"));
+    g_assert_false(ghbci_capabilities_supports_job(capabilities, "DauerSEPANew"));
+    g_assert_cmpint(ghbci_capabilities_get_job_version(capabilities, "KUmsAll"), ==, 7);
+    g_assert_cmpint(ghbci_capabilities_get_job_version(capabilities, "DauerSEPANew"), ==, 0);
+
+    g_assert_cmpstr(ghbci_capabilities_get_job_parameter(capabilities, "KUmsAll", "canmaxentries"), ==, "J");
+    g_assert_null(ghbci_capabilities_get_job_parameter(capabilities, "UebSEPA", "timerange"));
+    g_assert_cmpint(ghbci_capabilities_get_job_parameter_int(capabilities, "KUmsAll", "timerange", 0), ==, 90);
+    g_assert_cmpint(ghbci_capabilities_get_job_parameter_int(capabilities, "KUmsAll", "canmaxentries", -1), ==, -1);
+
+    jobs = ghbci_capabilities_get_jobs(capabilities);
+    g_assert_cmpuint(g_strv_length(jobs), ==, 2);
+    g_assert_cmpstr(jobs[0], ==, "KUmsAll");
+    g_assert_cmpstr(jobs[1], ==, "UebSEPA");
+    g_strfreev(jobs);
+
+    g_assert_cmpstr(g_hash_table_lookup(ghbci_capabilities_get_tan_methods(capabilities), "942"), ==, "mobileTAN");
+}
+
+static void
+test_lookup(void)
+{
+    GHbciCapabilities* capabilities = create_capabilities();
+
+    check_capabilities(capabilities);
+    ghbci_capabilities_unref(capabilities);
+}
+
+static void
+test_save_load(void)
+{
+    GHbciCapabilities* capabilities = create_capabilities();
+    GHbciCapabilities* loaded;
+    GError* error = NULL;
+    gchar* directory = g_dir_make_tmp("ghbci-test-XXXXXX", &error);
+    g_assert_no_error(error);
+    gchar* filename = g_build_filename(directory, "bank-12345678-test.caps", NULL);
+
+    g_assert_true(ghbci_capabilities_save(capabilities, filename, &error));
+    g_assert_no_error(error);
+    ghbci_capabilities_unref(capabilities);
+
+    loaded = ghbci_capabilities_load(filename, &error);
+    g_assert_no_error(error);
+    check_capabilities(loaded);
+    ghbci_capabilities_unref(loaded);
+
+    g_unlink(filename);
+    g_assert_null(ghbci_capabilities_load(filename, &error));
+    g_assert_error(error, G_FILE_ERROR, G_FILE_ERROR_NOENT);
+    g_error_free(error);
+
+    g_rmdir(directory);
+    g_free(filename);
+    g_free(directory);
+}
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/capabilities/lookup", test_lookup);
+    g_test_add_func ("/capabilities/save-load", test_save_load);
+    return g_test_run ();
+}
+
+
+//vim: expandtab sw=4
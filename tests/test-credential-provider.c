@@ -0,0 +1,313 @@
+#include <glib.h>
+#include <gio/gio.h>
+#include "ghbci/ghbci-context.h"
+#include "ghbci/ghbci-credential-provider.h"
+#include "ghbci/ghbci-error.h"
+#include "ghbci/ghbci-error-private.h"
+#include "ghbci/ghbci-worker-pool-private.h"
+#include "test-helpers.h"
+
+static const gchar* program;
+
+/*
+ * Provider answering the PIN right away and the TAN deferred, it can't
+ * answer for TAN media at all
+ */
+typedef struct
+{
+    GObject parent;
+} TestProvider;
+
+typedef struct
+{
+    GObjectClass parent_class;
+} TestProviderClass;
+
+static void test_provider_iface_init (GHbciCredentialProviderInterface* iface);
+
+G_DEFINE_TYPE_WITH_CODE (TestProvider, test_provider, G_TYPE_OBJECT,
+        G_IMPLEMENT_INTERFACE (GHBCI_TYPE_CREDENTIAL_PROVIDER, test_provider_iface_init))
+
+static gboolean
+test_provider_lookup (GHbciCredentialProvider* self, const GHbciCredentialRequest* request, gchar** answer)
+{
+    if (request->reason != GHBCI_REASON_ENUM_NEED_PT_PIN)
+        return FALSE;
+    *answer = g_strdup("12345");
+    return TRUE;
+}
+
+static gboolean
+return_tan (gpointer user_data)
+{
+    GTask* task = user_data;
+
+    g_task_return_pointer(task, g_strdup("654321"), g_free);
+    g_object_unref(task);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+test_provider_request_async (GHbciCredentialProvider* self, const GHbciCredentialRequest* request,
+        GCancellable* cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+    GTask* task = g_task_new(self, cancellable, callback, user_data);
+
+    if (request->reason == GHBCI_REASON_ENUM_NEED_PT_TAN) {
+        g_idle_add(return_tan, task);
+    } else if (request->reason == GHBCI_REASON_ENUM_NEED_PT_TANMEDIA) {
+        g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "no tan media");
+        g_object_unref(task);
+    } else {
+        g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_CANCELLED, "declined");
+        g_object_unref(task);
+    }
+}
+
+static gchar*
+test_provider_request_finish (GHbciCredentialProvider* self, GAsyncResult* result, GError** error)
+{
+    return g_task_propagate_pointer(G_TASK(result), error);
+}
+
+static void
+test_provider_iface_init (GHbciCredentialProviderInterface* iface)
+{
+    iface->lookup = test_provider_lookup;
+    iface->request_async = test_provider_request_async;
+    iface->request_finish = test_provider_request_finish;
+}
+
+static void
+test_provider_class_init (TestProviderClass* class)
+{
+}
+
+static void
+test_provider_init (TestProvider* self)
+{
+}
+
+static void
+on_answer (GObject* source, GAsyncResult* result, gpointer user_data)
+{
+    GAsyncResult** result_out = user_data;
+
+    *result_out = g_object_ref(result);
+}
+
+static gchar*
+request_and_wait (GHbciCredentialProvider* provider, GHbciCredentialRequest* request, GError** error)
+{
+    GAsyncResult* result = NULL;
+    gchar* answer;
+
+    ghbci_credential_provider_request_async(provider, request, NULL, on_answer, &result);
+    while (result == NULL)
+        g_main_context_iteration(NULL, TRUE);
+    answer = ghbci_credential_provider_request_finish(provider, result, error);
+    g_object_unref(result);
+    return answer;
+}
+
+static void
+test_lookup(void)
+{
+    GHbciCredentialProvider* provider = g_object_new(test_provider_get_type(), NULL);
+    GHbciCredentialRequest request = { GHBCI_REASON_ENUM_NEED_PT_PIN, "12345678", "user", "PIN", "" };
+    gchar* answer = NULL;
+
+    g_assert_true(ghbci_credential_provider_lookup(provider, &request, &answer));
+    g_assert_cmpstr(answer, ==, "12345");
+    g_free(answer);
+
+    answer = NULL;
+    request.reason = GHBCI_REASON_ENUM_NEED_PT_TAN;
+    g_assert_false(ghbci_credential_provider_lookup(provider, &request, &answer));
+    g_assert_null(answer);
+    g_object_unref(provider);
+}
+
+static void
+test_request_async(void)
+{
+    GHbciCredentialProvider* provider = g_object_new(test_provider_get_type(), NULL);
+    GHbciCredentialRequest request = { GHBCI_REASON_ENUM_NEED_PT_TAN, "12345678", "user", "TAN", "" };
+    GError* error = NULL;
+    gchar* answer;
+
+    answer = request_and_wait(provider, &request, &error);
+    g_assert_no_error(error);
+    g_assert_cmpstr(answer, ==, "654321");
+    g_free(answer);
+
+    request.reason = GHBCI_REASON_ENUM_NEED_PT_SECMECH;
+    answer = request_and_wait(provider, &request, &error);
+    g_assert_error(error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+    g_assert_null(answer);
+    g_clear_error(&error);
+    g_object_unref(provider);
+}
+
+static void
+test_request_copy(void)
+{
+    GHbciCredentialRequest request = { GHBCI_REASON_ENUM_NEED_PT_TAN, "12345678", NULL, "TAN", "challenge" };
+    GHbciCredentialRequest* copy = ghbci_credential_request_copy(&request);
+
+    g_assert_cmpint(copy->reason, ==, GHBCI_REASON_ENUM_NEED_PT_TAN);
+    g_assert_cmpstr(copy->blz, ==, "12345678");
+    g_assert_null(copy->userid);
+    g_assert_cmpstr(copy->optional, ==, "challenge");
+    ghbci_credential_request_free(copy);
+}
+
+/*
+ * Asks the callback with the account number as reason and returns the
+ * answer as balance, a missing answer aborts
+ */
+static void
+reply_balances (GSocket* socket, GVariant* body)
+{
+    GHbciWorkerMessage kind;
+    GVariant* answer;
+    GError* error = NULL;
+    const gchar* number;
+    gchar* value;
+    gint fd;
+
+    g_variant_get(body, "(&s&s&s)", NULL, NULL, &number);
+    ghbci_worker_send(socket, GHBCI_WORKER_CALLBACK,
+            g_variant_new("(xss)", g_ascii_strtoll(number, NULL, 10), "question", ""), -1, NULL);
+    ghbci_worker_receive(socket, -1, &kind, &answer, &fd, NULL);
+    g_variant_get(answer, "ms", &value);
+    g_variant_unref(answer);
+    if (value != NULL) {
+        ghbci_worker_send(socket, GHBCI_WORKER_REPLY, g_variant_new("ms", value), -1, NULL);
+    } else {
+        ghbci_set_error(&error, GHBCI_ERROR_ABORTED, NULL, GHBCI_RETRY_HINT_USER_ACTION, "Aborted by User");
+        ghbci_worker_send(socket, GHBCI_WORKER_ERROR, ghbci_worker_error_to_variant(error), -1, NULL);
+        g_clear_error(&error);
+    }
+    g_free(value);
+}
+
+static const FakeWorkerRequest fake_worker_requests[] = {
+    { GHBCI_WORKER_SET_OPTIONS, fake_worker_reply },
+    { GHBCI_WORKER_ADD_PASSPORT, fake_worker_reply },
+    { GHBCI_WORKER_GET_BALANCES, reply_balances },
+    { GHBCI_WORKER_GET_BANK, fake_worker_get_bank },
+    { 0, NULL }
+};
+
+typedef struct
+{
+    guint calls;
+    const gchar* answer;
+} Callbacks;
+
+static gchar*
+answer_callback (GHbciContext* context, gint64 reason, const gchar* message, const gchar* optional,
+        gpointer user_data)
+{
+    Callbacks* callbacks = user_data;
+
+    callbacks->calls++;
+    return g_strdup(callbacks->answer);
+}
+
+static gchar*
+ask (GHbciContext* context, const gchar* userid, GHbciReason reason, GError** error)
+{
+    gchar* number = g_strdup_printf("%d", reason);
+    gchar* answer = ghbci_context_get_balances(context, "12345678", userid, number, error);
+
+    g_free(number);
+    return answer;
+}
+
+static void
+test_context(void)
+{
+    GHbciCredentialProvider* provider = g_object_new(test_provider_get_type(), NULL);
+    Callbacks callbacks = { 0, "signal" };
+    GHbciContext* context;
+    GError* error = NULL;
+    gchar* answer;
+
+    g_setenv("GHBCI_WORKER", program, TRUE);
+    context = ghbci_context_new_with_workers(g_get_tmp_dir(), 1, &error);
+    g_assert_no_error(error);
+    g_assert_true(ghbci_context_add_passport(context, "12345678", "test", &error));
+    g_assert_true(ghbci_context_add_passport(context, "12345678", "other", &error));
+    g_assert_no_error(error);
+    g_signal_connect(context, "callback", G_CALLBACK(answer_callback), &callbacks);
+    ghbci_context_set_credential_provider(context, provider);
+
+    // the provider answers without a static answer
+    answer = ask(context, "test", GHBCI_REASON_ENUM_NEED_PT_PIN, &error);
+    g_assert_no_error(error);
+    g_assert_cmpstr(answer, ==, "12345");
+    g_free(answer);
+
+    // static answers come first, the passport's one before the default
+    ghbci_context_set_answer(context, NULL, NULL, GHBCI_REASON_ENUM_NEED_PT_PIN, "0000");
+    ghbci_context_set_answer(context, "12345678", "test", GHBCI_REASON_ENUM_NEED_PT_PIN, "1111");
+    answer = ask(context, "test", GHBCI_REASON_ENUM_NEED_PT_PIN, &error);
+    g_assert_no_error(error);
+    g_assert_cmpstr(answer, ==, "1111");
+    g_free(answer);
+    answer = ask(context, "other", GHBCI_REASON_ENUM_NEED_PT_PIN, &error);
+    g_assert_no_error(error);
+    g_assert_cmpstr(answer, ==, "0000");
+    g_free(answer);
+
+    // a deferred answer is waited for in the main context of this thread
+    answer = ask(context, "test", GHBCI_REASON_ENUM_NEED_PT_TAN, &error);
+    g_assert_no_error(error);
+    g_assert_cmpstr(answer, ==, "654321");
+    g_free(answer);
+    g_assert_cmpuint(callbacks.calls, ==, 0);
+
+    // the signal answers what the provider doesn't support
+    answer = ask(context, "test", GHBCI_REASON_ENUM_NEED_PT_TANMEDIA, &error);
+    g_assert_no_error(error);
+    g_assert_cmpstr(answer, ==, "signal");
+    g_free(answer);
+    g_assert_cmpuint(callbacks.calls, ==, 1);
+
+    // other errors of the provider abort, like no answer of the signal
+    g_assert_null(ask(context, "test", GHBCI_REASON_ENUM_NEED_PT_SECMECH, &error));
+    g_assert_error(error, GHBCI_ERROR, GHBCI_ERROR_ABORTED);
+    g_clear_error(&error);
+    g_assert_cmpuint(callbacks.calls, ==, 1);
+
+    ghbci_context_set_credential_provider(context, NULL);
+    callbacks.answer = NULL;
+    g_assert_null(ask(context, "test", GHBCI_REASON_ENUM_NEED_PT_TAN, &error));
+    g_assert_error(error, GHBCI_ERROR, GHBCI_ERROR_ABORTED);
+    g_clear_error(&error);
+    g_assert_cmpuint(callbacks.calls, ==, 2);
+
+    g_object_unref(context);
+    g_object_unref(provider);
+}
+
+int
+main (int argc, char *argv[])
+{
+    if (argc > 1 && g_str_equal(argv[1], "--fd=3"))
+        return run_fake_worker(fake_worker_requests);
+
+    program = argv[0];
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/credential-provider/lookup", test_lookup);
+    g_test_add_func ("/credential-provider/request-async", test_request_async);
+    g_test_add_func ("/credential-provider/request-copy", test_request_copy);
+    g_test_add_func ("/credential-provider/context", test_context);
+    return g_test_run ();
+}
+
+
+//vim: expandtab sw=4
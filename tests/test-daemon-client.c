@@ -0,0 +1,246 @@
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include <gio/gunixfdlist.h>
+#include "ghbci/ghbci-context.h"
+#include "ghbci/ghbci-statement.h"
+#include "ghbci/ghbci-statement-private.h"
+#include "ghbci/ghbci-error.h"
+#include "ghbci/ghbci-error-private.h"
+#include "ghbci/ghbci-daemon-private.h"
+
+/*
+ * Stands in for ghbci-daemon on the other end of a peer to peer connection,
+ * on a thread of its own like the request threads of the daemon
+ */
+typedef struct
+{
+    gint fd;
+    GDBusNodeInfo* introspection;
+    GDBusConnection* connection;
+    GMainLoop* loop;
+    GMutex lock;
+    GCond ready;
+} FakeDaemon;
+
+static gchar*
+ask_client (GDBusConnection* connection, GVariant* parameters)
+{
+    GVariant* result;
+    const gchar* path;
+    gboolean answered;
+    gchar* answer;
+
+    g_variant_get_child(parameters, g_variant_n_children(parameters) - 1, "&o", &path);
+    result = g_dbus_connection_call_sync(connection, NULL, path, GHBCI_DAEMON_CALLBACK_INTERFACE, "Answer",
+            g_variant_new("(xss)", (gint64)GHBCI_REASON_ENUM_NEED_PT_PIN, "PIN", ""), G_VARIANT_TYPE("(bs)"),
+            G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL);
+    g_assert_nonnull(result);
+    g_variant_get(result, "(bs)", &answered, &answer);
+    g_variant_unref(result);
+    if (!answered)
+        g_clear_pointer(&answer, g_free);
+    return answer;
+}
+
+static void
+handle_method_call (GDBusConnection* connection, const gchar* sender, const gchar* object_path,
+        const gchar* interface_name, const gchar* method_name, GVariant* parameters,
+        GDBusMethodInvocation* invocation, gpointer user_data)
+{
+    GError* error = NULL;
+    const gchar* number;
+    GSList* statements;
+    gint fd;
+
+    if (g_str_equal(method_name, "AddPassport")) {
+        gchar* pin = ask_client(connection, parameters);
+        if (g_strcmp0(pin, "1234") == 0) {
+            g_dbus_method_invocation_return_value(invocation, NULL);
+        } else {
+            ghbci_set_error(&error, 9942, "3", GHBCI_RETRY_HINT_USER_ACTION, "PIN falsch");
+            ghbci_daemon_return_error(invocation, error);
+            g_error_free(error);
+        }
+        g_free(pin);
+    } else if (g_str_equal(method_name, "GetBalances")) {
+        g_variant_get(parameters, "(&s&s&s&o)", NULL, NULL, &number, NULL);
+        if (g_str_equal(number, "crash")) {
+            g_dbus_connection_close_sync(connection, NULL, NULL);
+            g_object_unref(invocation);
+        } else if (g_str_equal(number, "none")) {
+            g_dbus_method_invocation_return_value(invocation, g_variant_new("(bs)", FALSE, ""));
+        } else {
+            g_dbus_method_invocation_return_value(invocation, g_variant_new("(bs)", TRUE, "1.00 EUR"));
+        }
+    } else {
+        statements = g_slist_append(NULL, ghbci_statement_new_structured(NULL,
+                    ghbci_statement_pack_date(3, 1, 2026), ghbci_statement_pack_date(2, 1, 2026),
+                    g_strdup("-12.34 EUR"), NULL, g_strdup("105"), g_strdup("LASTSCHRIFT"),
+                    g_strdup("Stadtwerke"), NULL, NULL, g_strdup("Abschlag"), NULL, NULL, NULL));
+        fd = ghbci_worker_write_statements(statements, NULL);
+        GUnixFDList* fd_list = g_unix_fd_list_new_from_array(&fd, 1);
+        g_dbus_method_invocation_return_value_with_unix_fd_list(invocation, g_variant_new("(h)", 0), fd_list);
+        g_object_unref(fd_list);
+        g_slist_free_full(statements, g_object_unref);
+    }
+}
+
+static const GDBusInterfaceVTable daemon_vtable = { handle_method_call, NULL, NULL };
+
+static void
+on_closed (GDBusConnection* connection, gboolean remote_peer_vanished, GError* error, gpointer user_data)
+{
+    FakeDaemon* daemon = user_data;
+
+    g_main_loop_quit(daemon->loop);
+}
+
+static gpointer
+run_fake_daemon (gpointer data)
+{
+    FakeDaemon* daemon = data;
+    GMainContext* main_context = g_main_context_new();
+
+    g_main_context_push_thread_default(main_context);
+    daemon->loop = g_main_loop_new(main_context, FALSE);
+
+    GSocket* socket = g_socket_new_from_fd(daemon->fd, NULL);
+    GSocketConnection* stream = g_socket_connection_factory_create_connection(socket);
+    gchar* guid = g_dbus_generate_guid();
+    GDBusConnection* connection = g_dbus_connection_new_sync(G_IO_STREAM(stream), guid,
+            G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_SERVER, NULL, NULL, NULL);
+    g_assert_nonnull(connection);
+    g_dbus_connection_register_object(connection, GHBCI_DAEMON_PATH,
+            g_dbus_node_info_lookup_interface(daemon->introspection, GHBCI_DAEMON_INTERFACE),
+            &daemon_vtable, daemon, NULL, NULL);
+    g_signal_connect(connection, "closed", G_CALLBACK(on_closed), daemon);
+
+    g_mutex_lock(&daemon->lock);
+    daemon->connection = connection;
+    g_cond_signal(&daemon->ready);
+    g_mutex_unlock(&daemon->lock);
+
+    g_main_loop_run(daemon->loop);
+
+    g_object_unref(connection);
+    g_free(guid);
+    g_object_unref(stream);
+    g_object_unref(socket);
+    g_main_loop_unref(daemon->loop);
+    g_main_context_pop_thread_default(main_context);
+    g_main_context_unref(main_context);
+    return NULL;
+}
+
+typedef struct
+{
+    guint calls;
+    const gchar* pin;
+} Callbacks;
+
+static gchar*
+answer_callback (const gchar* blz, const gchar* userid, gint reason, const gchar* message, const gchar* optional,
+        gpointer user_data)
+{
+    Callbacks* callbacks = user_data;
+
+    g_assert_cmpstr(blz, ==, "12345678");
+    g_assert_cmpstr(userid, ==, "test");
+    g_assert_cmpint(reason, ==, GHBCI_REASON_ENUM_NEED_PT_PIN);
+    g_assert_cmpstr(message, ==, "PIN");
+    callbacks->calls++;
+    return g_strdup(callbacks->pin);
+}
+
+static void
+test_requests(void)
+{
+    Callbacks callbacks = { 0, "0000" };
+    FakeDaemon daemon;
+    GHbciDaemonClient* client;
+    GDBusConnection* connection;
+    GError* error = NULL;
+    GSList* statements;
+    gchar* balance;
+    gchar* other_name;
+    gint fds[2];
+
+    g_assert_cmpint(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), ==, 0);
+    daemon.fd = fds[1];
+    daemon.introspection = g_dbus_node_info_new_for_xml(GHBCI_DAEMON_INTROSPECTION, NULL);
+    daemon.connection = NULL;
+    g_mutex_init(&daemon.lock);
+    g_cond_init(&daemon.ready);
+    GThread* thread = g_thread_new("fake-daemon", run_fake_daemon, &daemon);
+
+    GSocket* socket = g_socket_new_from_fd(fds[0], NULL);
+    GSocketConnection* stream = g_socket_connection_factory_create_connection(socket);
+    connection = g_dbus_connection_new_sync(G_IO_STREAM(stream), NULL,
+            G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT, NULL, NULL, &error);
+    g_assert_no_error(error);
+    g_mutex_lock(&daemon.lock);
+    while (daemon.connection == NULL)
+        g_cond_wait(&daemon.ready, &daemon.lock);
+    g_mutex_unlock(&daemon.lock);
+
+    client = ghbci_daemon_client_new(connection, answer_callback, &callbacks, &error);
+    g_assert_no_error(error);
+
+    // errors of the daemon keep segment and retry hint
+    g_assert_false(ghbci_daemon_client_add_passport(client, "12345678", "test", &error));
+    g_assert_error(error, GHBCI_ERROR, 9942);
+    g_assert_cmpstr(error->message, ==, "PIN falsch");
+    g_assert_cmpstr(ghbci_error_get_segment(error), ==, "3");
+    g_assert_cmpint(ghbci_error_get_retry_hint(error), ==, GHBCI_RETRY_HINT_USER_ACTION);
+    g_clear_error(&error);
+
+    callbacks.pin = "1234";
+    g_assert_true(ghbci_daemon_client_add_passport(client, "12345678", "test", &error));
+    g_assert_no_error(error);
+    g_assert_cmpuint(callbacks.calls, ==, 2);
+
+    statements = ghbci_daemon_client_get_statements(client, "12345678", "test", "1234567", TRUE, NULL, &error);
+    g_assert_no_error(error);
+    g_assert_cmpuint(g_slist_length(statements), ==, 1);
+    g_object_get(statements->data, "other-name", &other_name, NULL);
+    g_assert_cmpstr(other_name, ==, "Stadtwerke");
+    g_free(other_name);
+    g_slist_free_full(statements, g_object_unref);
+
+    balance = ghbci_daemon_client_get_balances(client, "12345678", "test", "1234567", &error);
+    g_assert_no_error(error);
+    g_assert_cmpstr(balance, ==, "1.00 EUR");
+    g_free(balance);
+    g_assert_null(ghbci_daemon_client_get_balances(client, "12345678", "test", "none", &error));
+    g_assert_no_error(error);
+
+    // a daemon going away fails the request
+    g_assert_null(ghbci_daemon_client_get_balances(client, "12345678", "test", "crash", &error));
+    g_assert_error(error, GHBCI_ERROR, GHBCI_ERROR_WORKER);
+    g_assert_cmpint(ghbci_error_get_retry_hint(error), ==, GHBCI_RETRY_HINT_RETRY);
+    g_clear_error(&error);
+
+    g_thread_join(thread);
+    ghbci_daemon_client_free(client);
+    g_object_unref(connection);
+    g_object_unref(stream);
+    g_object_unref(socket);
+    g_dbus_node_info_unref(daemon.introspection);
+    g_mutex_clear(&daemon.lock);
+    g_cond_clear(&daemon.ready);
+}
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/daemon-client/requests", test_requests);
+    return g_test_run ();
+}
+
+
+//vim: expandtab sw=4
@@ -0,0 +1,481 @@
+#include <sys/socket.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include "ghbci/ghbci-context.h"
+#include "ghbci/ghbci-error.h"
+#include "ghbci/ghbci-worker-pool-private.h"
+#include "ghbci/ghbci-daemon-private.h"
+#include "test-helpers.h"
+
+/*
+ * Runs the service of ghbci-daemon over a peer to peer connection, in
+ * --workers mode with this program as worker, and in process if hbci4java
+ * is installed
+ */
+
+static const gchar* program;
+
+static void
+reply_accounts (GSocket* socket, GVariant* body)
+{
+    GVariantBuilder builder;
+
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("aa{ss}"));
+    g_variant_builder_open(&builder, G_VARIANT_TYPE("a{ss}"));
+    g_variant_builder_add(&builder, "{ss}", "number", "1234567");
+    g_variant_builder_add(&builder, "{ss}", "iban", "DE89370400440532013000");
+    g_variant_builder_close(&builder);
+    ghbci_worker_send(socket, GHBCI_WORKER_REPLY, g_variant_builder_end(&builder), -1, NULL);
+}
+
+static void
+reply_tan_methods (GSocket* socket, GVariant* body)
+{
+    GVariantBuilder builder;
+
+    // long enough for another request of the passport to wait for it
+    g_usleep(500 * G_TIME_SPAN_MILLISECOND);
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("a{ss}"));
+    g_variant_builder_add(&builder, "{ss}", "942", "mobileTAN");
+    ghbci_worker_send(socket, GHBCI_WORKER_REPLY, g_variant_builder_end(&builder), -1, NULL);
+}
+
+static void
+reply_transfer (GSocket* socket, GVariant* body)
+{
+    GVariant* transfer;
+    const gchar* bic;
+
+    // missing strings pass the daemon as such
+    g_variant_get_child(body, 6, "@" GHBCI_WORKER_TRANSFER_TYPE, &transfer);
+    g_variant_get_child(transfer, 1, "m&s", &bic);
+    ghbci_worker_send(socket, GHBCI_WORKER_REPLY, g_variant_new("ms", bic == NULL ? "4711" : NULL), -1, NULL);
+    g_variant_unref(transfer);
+}
+
+static void
+reply_banks (GSocket* socket, GVariant* body)
+{
+    GVariantBuilder builder;
+
+    g_variant_builder_init(&builder, G_VARIANT_TYPE_STRING_ARRAY);
+    g_variant_builder_add(&builder, "s", "12345678");
+    g_variant_builder_add(&builder, "s", "87654321");
+    ghbci_worker_send(socket, GHBCI_WORKER_REPLY, g_variant_builder_end(&builder), -1, NULL);
+}
+
+/*
+ * Asks for the pin when a passport is added, answers the other requests of
+ * the test, the tan methods slowly, and crashes when asked for balances
+ */
+static const FakeWorkerRequest fake_worker_requests[] = {
+    { GHBCI_WORKER_ADD_PASSPORT, fake_worker_ask_pin },
+    { GHBCI_WORKER_SET_OPTIONS, fake_worker_reply },
+    { GHBCI_WORKER_GET_STATEMENTS, fake_worker_send_statements },
+    { GHBCI_WORKER_GET_ACCOUNTS, reply_accounts },
+    { GHBCI_WORKER_GET_TAN_METHODS, reply_tan_methods },
+    { GHBCI_WORKER_SEND_TRANSFER, reply_transfer },
+    { GHBCI_WORKER_GET_BANK, fake_worker_get_bank },
+    { GHBCI_WORKER_LIST_BANKS, reply_banks },
+    { 0, NULL }
+};
+
+typedef struct
+{
+    gint fd;
+    GHbciDaemonService* service;
+    GDBusConnection* connection;
+    GMainLoop* loop;
+    GMutex lock;
+    GCond ready;
+    GThread* thread;
+    GSocket* socket;
+    GSocketConnection* stream;
+    GDBusConnection* client;
+} Server;
+
+static void
+on_closed (GDBusConnection* connection, gboolean remote_peer_vanished, GError* error, gpointer user_data)
+{
+    Server* server = user_data;
+
+    g_main_loop_quit(server->loop);
+}
+
+static gpointer
+run_server (gpointer data)
+{
+    Server* server = data;
+    GMainContext* main_context = g_main_context_new();
+    GError* error = NULL;
+
+    g_main_context_push_thread_default(main_context);
+    server->loop = g_main_loop_new(main_context, FALSE);
+
+    GSocket* socket = g_socket_new_from_fd(server->fd, NULL);
+    GSocketConnection* stream = g_socket_connection_factory_create_connection(socket);
+    gchar* guid = g_dbus_generate_guid();
+    GDBusConnection* connection = g_dbus_connection_new_sync(G_IO_STREAM(stream), guid,
+            G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_SERVER, NULL, NULL, NULL);
+    g_assert_nonnull(connection);
+    g_assert_true(ghbci_daemon_service_register(server->service, connection, &error));
+    g_assert_no_error(error);
+    g_signal_connect(connection, "closed", G_CALLBACK(on_closed), server);
+
+    g_mutex_lock(&server->lock);
+    server->connection = connection;
+    g_cond_signal(&server->ready);
+    g_mutex_unlock(&server->lock);
+
+    g_main_loop_run(server->loop);
+
+    g_object_unref(connection);
+    g_free(guid);
+    g_object_unref(stream);
+    g_object_unref(socket);
+    g_main_loop_unref(server->loop);
+    g_main_context_pop_thread_default(main_context);
+    g_main_context_unref(main_context);
+    return NULL;
+}
+
+/*
+ * Serves @daemon_context on a new thread, server->client is connected to it
+ */
+static void
+server_start (Server* server, GHbciContext* daemon_context)
+{
+    GError* error = NULL;
+    gint fds[2];
+
+    server->service = ghbci_daemon_service_new(daemon_context, 2);
+    g_assert_cmpint(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), ==, 0);
+    server->fd = fds[1];
+    server->connection = NULL;
+    g_mutex_init(&server->lock);
+    g_cond_init(&server->ready);
+    server->thread = g_thread_new("daemon", run_server, server);
+
+    server->socket = g_socket_new_from_fd(fds[0], NULL);
+    server->stream = g_socket_connection_factory_create_connection(server->socket);
+    server->client = g_dbus_connection_new_sync(G_IO_STREAM(server->stream), NULL,
+            G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT, NULL, NULL, &error);
+    g_assert_no_error(error);
+    g_mutex_lock(&server->lock);
+    while (server->connection == NULL)
+        g_cond_wait(&server->ready, &server->lock);
+    g_mutex_unlock(&server->lock);
+}
+
+static void
+server_stop (Server* server)
+{
+    g_dbus_connection_close_sync(server->client, NULL, NULL);
+    g_thread_join(server->thread);
+    if (server->service != NULL)
+        ghbci_daemon_service_free(server->service);
+    g_object_unref(server->client);
+    g_object_unref(server->stream);
+    g_object_unref(server->socket);
+    g_mutex_clear(&server->lock);
+    g_cond_clear(&server->ready);
+}
+
+typedef struct
+{
+    guint calls;
+    const gchar* pin;
+} Callbacks;
+
+static gchar*
+answer_callback (GHbciContext* context, gint64 reason, const gchar* message, const gchar* optional,
+        gpointer user_data)
+{
+    Callbacks* callbacks = user_data;
+
+    g_assert_cmpint(reason, ==, GHBCI_REASON_ENUM_NEED_PT_PIN);
+    g_assert_cmpstr(message, ==, "PIN");
+    callbacks->calls++;
+    return g_strdup(callbacks->pin);
+}
+
+static void
+test_workers(void)
+{
+    Callbacks callbacks = { 0, "0000" };
+    Server server;
+    GHbciContext* daemon_context;
+    GHbciContext* context;
+    GError* error = NULL;
+    GSList* statements;
+    gchar* other_name;
+
+    g_setenv("GHBCI_WORKER", program, TRUE);
+    daemon_context = ghbci_context_new_with_workers(g_get_tmp_dir(), 1, &error);
+    g_assert_no_error(error);
+    server_start(&server, daemon_context);
+
+    context = ghbci_context_new_for_daemon(server.client, &error);
+    g_assert_no_error(error);
+    g_signal_connect(context, "callback", G_CALLBACK(answer_callback), &callbacks);
+
+    // errors of the worker pass the daemon with segment and retry hint
+    g_assert_false(ghbci_context_add_passport(context, "12345678", "test", &error));
+    g_assert_error(error, GHBCI_ERROR, 9942);
+    g_assert_cmpstr(ghbci_error_get_segment(error), ==, "3");
+    g_assert_cmpint(ghbci_error_get_retry_hint(error), ==, GHBCI_RETRY_HINT_USER_ACTION);
+    g_clear_error(&error);
+
+    // the daemon asks the client of the request
+    callbacks.pin = "1234";
+    g_assert_true(ghbci_context_add_passport(context, "12345678", "test", &error));
+    g_assert_no_error(error);
+    g_assert_cmpuint(callbacks.calls, ==, 2);
+
+    statements = ghbci_context_get_statements(context, "12345678", "test", "1234567", &error);
+    g_assert_no_error(error);
+    g_assert_cmpuint(g_slist_length(statements), ==, 3);
+    g_object_get(statements->next->data, "other-name", &other_name, NULL);
+    g_assert_cmpstr(other_name, ==, "Stadtwerke M\xc3\xbcnchen & Co, Abrechnung Strom und Gas");
+    g_free(other_name);
+    g_slist_free_full(statements, g_object_unref);
+
+    // a crashing worker fails the request of the client only
+    g_test_expect_message(NULL, G_LOG_LEVEL_WARNING, "worker 0 failed*");
+    g_assert_null(ghbci_context_get_balances(context, "12345678", "test", "1234567", &error));
+    g_test_assert_expected_messages();
+    g_assert_error(error, GHBCI_ERROR, GHBCI_ERROR_WORKER);
+    g_assert_cmpint(ghbci_error_get_retry_hint(error), ==, GHBCI_RETRY_HINT_RETRY);
+    g_clear_error(&error);
+
+    g_object_unref(context);
+    server_stop(&server);
+    g_object_unref(daemon_context);
+}
+
+static void
+count_bank (const gchar* blz, gpointer user_data)
+{
+    guint* n_banks = user_data;
+
+    (*n_banks)++;
+}
+
+static void
+test_operations(void)
+{
+    GHbciTransfer transfer = { "Stadtwerke", NULL, "DE89370400440532013000", "Abschlag", "12.34", NULL };
+    Callbacks callbacks = { 0, "1234" };
+    Server server;
+    GHbciContext* daemon_context;
+    GHbciContext* context;
+    GError* error = NULL;
+    GSList* accounts;
+    GDate* date;
+    gchar* iban;
+    gchar* name;
+    gchar* url;
+    gchar* order_id = NULL;
+    guint n_banks = 0;
+
+    g_setenv("GHBCI_WORKER", program, TRUE);
+    daemon_context = ghbci_context_new_with_workers(g_get_tmp_dir(), 1, &error);
+    g_assert_no_error(error);
+    server_start(&server, daemon_context);
+    context = ghbci_context_new_for_daemon(server.client, &error);
+    g_assert_no_error(error);
+    g_signal_connect(context, "callback", G_CALLBACK(answer_callback), &callbacks);
+    g_assert_true(ghbci_context_add_passport(context, "12345678", "test", &error));
+    g_assert_no_error(error);
+
+    accounts = ghbci_context_get_accounts(context, "12345678", "test", &error);
+    g_assert_no_error(error);
+    g_assert_cmpuint(g_slist_length(accounts), ==, 1);
+    g_object_get(accounts->data, "iban", &iban, NULL);
+    g_assert_cmpstr(iban, ==, "DE89370400440532013000");
+    g_free(iban);
+    g_slist_free_full(accounts, g_object_unref);
+
+    date = g_date_new_dmy(1, 3, 2026);
+    g_assert_true(ghbci_context_send_scheduled_transfer(context, "12345678", "test", "1234567", "Max Muster",
+                NULL, "DE02120300000000202051", &transfer, date, &order_id, &error));
+    g_assert_no_error(error);
+    g_assert_cmpstr(order_id, ==, "4711");
+    g_free(order_id);
+    g_date_free(date);
+
+    // the banks are known to the daemon
+    name = (gchar*)ghbci_context_get_name_for_blz(context, "12345678");
+    g_assert_cmpstr(name, ==, "Testbank");
+    g_free(name);
+    url = (gchar*)ghbci_context_get_pin_tan_url_for_blz(context, "87654321");
+    g_assert_cmpstr(url, ==, "");
+    g_free(url);
+    ghbci_context_blz_foreach(context, count_bank, &n_banks);
+    g_assert_cmpuint(n_banks, ==, 2);
+
+    g_object_unref(context);
+    server_stop(&server);
+    g_object_unref(daemon_context);
+}
+
+static gpointer
+get_tan_methods (gpointer data)
+{
+    GError* error = NULL;
+    GHashTable* tan_methods = ghbci_context_get_tan_methods(data, "12345678", "test", &error);
+
+    g_assert_no_error(error);
+    g_assert_cmpstr(g_hash_table_lookup(tan_methods, "942"), ==, "mobileTAN");
+    g_hash_table_unref(tan_methods);
+    return NULL;
+}
+
+static gpointer
+get_accounts (gpointer data)
+{
+    GError* error = NULL;
+
+    g_assert_null(ghbci_context_get_accounts(data, "12345678", "test", &error));
+    g_assert_error(error, GHBCI_ERROR, GHBCI_ERROR_WORKER);
+    g_assert_cmpint(ghbci_error_get_retry_hint(error), ==, GHBCI_RETRY_HINT_RETRY);
+    g_error_free(error);
+    return NULL;
+}
+
+static void
+test_stop(void)
+{
+    Callbacks callbacks = { 0, "1234" };
+    Server server;
+    GHbciContext* daemon_context;
+    GHbciContext* context;
+    GError* error = NULL;
+    GThread* running;
+    GThread* waiting;
+
+    g_setenv("GHBCI_WORKER", program, TRUE);
+    daemon_context = ghbci_context_new_with_workers(g_get_tmp_dir(), 1, &error);
+    g_assert_no_error(error);
+    server_start(&server, daemon_context);
+    context = ghbci_context_new_for_daemon(server.client, &error);
+    g_assert_no_error(error);
+    g_signal_connect(context, "callback", G_CALLBACK(answer_callback), &callbacks);
+    g_assert_true(ghbci_context_add_passport(context, "12345678", "test", &error));
+    g_assert_no_error(error);
+
+    // the running request completes, the one waiting for the passport fails
+    running = g_thread_new("running", get_tan_methods, context);
+    g_usleep(100 * G_TIME_SPAN_MILLISECOND);
+    waiting = g_thread_new("waiting", get_accounts, context);
+    g_usleep(100 * G_TIME_SPAN_MILLISECOND);
+    ghbci_daemon_service_free(server.service);
+    server.service = NULL;
+    g_thread_join(running);
+    g_thread_join(waiting);
+
+    g_object_unref(context);
+    server_stop(&server);
+    g_object_unref(daemon_context);
+}
+
+typedef struct
+{
+    GHbciContext* context;
+    const gchar* userid;
+} Adding;
+
+static gpointer
+add_passport (gpointer data)
+{
+    Adding* adding = data;
+    GError* error = NULL;
+
+    // the bank is unreachable, but the new passport file is saved before
+    g_assert_false(ghbci_context_add_passport(adding->context, "12345678", adding->userid, &error));
+    g_clear_error(&error);
+    return NULL;
+}
+
+static void
+test_in_process(void)
+{
+    const gchar* userids[] = { "alice", "bob" };
+    GThread* threads[G_N_ELEMENTS(userids)];
+    Adding adding[G_N_ELEMENTS(userids)];
+    Server server;
+    GHbciContext* daemon_context;
+    GHbciContext* context;
+    GError* error = NULL;
+    gchar* directory;
+    gchar* filename;
+    guint i;
+
+    if (!g_file_test(DATA_DIR "/hbci4java.jar", G_FILE_TEST_EXISTS)) {
+        g_test_skip("hbci4java is not installed");
+        return;
+    }
+    directory = g_dir_make_tmp("ghbci-test-XXXXXX", &error);
+    g_assert_no_error(error);
+    daemon_context = ghbci_context_new(directory);
+    g_assert_nonnull(daemon_context);
+    ghbci_context_set_answer(daemon_context, NULL, NULL, GHBCI_REASON_ENUM_NEED_COUNTRY, "DE");
+    ghbci_context_set_answer(daemon_context, NULL, NULL, GHBCI_REASON_ENUM_NEED_BLZ, "12345678");
+    ghbci_context_set_answer(daemon_context, NULL, NULL, GHBCI_REASON_ENUM_NEED_HOST, "127.0.0.1");
+    ghbci_context_set_answer(daemon_context, NULL, NULL, GHBCI_REASON_ENUM_NEED_PORT, "9");
+    ghbci_context_set_answer(daemon_context, NULL, NULL, GHBCI_REASON_ENUM_NEED_FILTER, "Base64");
+    ghbci_context_set_answer(daemon_context, NULL, NULL, GHBCI_REASON_ENUM_NEED_PASSPHRASE_LOAD, "secret");
+    ghbci_context_set_answer(daemon_context, NULL, NULL, GHBCI_REASON_ENUM_NEED_PASSPHRASE_SAVE, "secret");
+    for (i = 0; i < G_N_ELEMENTS(userids); i++) {
+        ghbci_context_set_answer(daemon_context, "12345678", userids[i], GHBCI_REASON_ENUM_NEED_USERID,
+                userids[i]);
+        ghbci_context_set_answer(daemon_context, "12345678", userids[i], GHBCI_REASON_ENUM_NEED_CUSTOMERID,
+                userids[i]);
+    }
+    server_start(&server, daemon_context);
+
+    context = ghbci_context_new_for_daemon(server.client, &error);
+    g_assert_no_error(error);
+
+    // both requests configure hbci4java at the same time, in their own thread group
+    for (i = 0; i < G_N_ELEMENTS(userids); i++) {
+        adding[i].context = context;
+        adding[i].userid = userids[i];
+        threads[i] = g_thread_new("add-passport", add_passport, &adding[i]);
+    }
+    for (i = 0; i < G_N_ELEMENTS(userids); i++)
+        g_thread_join(threads[i]);
+
+    // each passport was saved under its own name
+    for (i = 0; i < G_N_ELEMENTS(userids); i++) {
+        filename = g_strdup_printf("%s/passport-12345678+%s.dat", directory, userids[i]);
+        g_assert_true(g_file_test(filename, G_FILE_TEST_EXISTS));
+        g_free(filename);
+    }
+
+    g_object_unref(context);
+    server_stop(&server);
+    g_object_unref(daemon_context);
+    g_rmdir(directory);
+    g_free(directory);
+}
+
+int
+main (int argc, char *argv[])
+{
+    if (argc > 1 && g_str_equal(argv[1], "--fd=3"))
+        return run_fake_worker(fake_worker_requests);
+
+    program = argv[0];
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/daemon/workers", test_workers);
+    g_test_add_func ("/daemon/operations", test_operations);
+    g_test_add_func ("/daemon/stop", test_stop);
+    g_test_add_func ("/daemon/in-process", test_in_process);
+    return g_test_run ();
+}
+
+
+//vim: expandtab sw=4
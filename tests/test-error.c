@@ -0,0 +1,64 @@
+#include <glib.h>
+#include "ghbci/ghbci-error.h"
+#include "ghbci/ghbci-error-private.h"
+
+static void
+test_retry_hint(void)
+{
+    g_assert_cmpint(ghbci_error_retry_hint_for_code(9800), ==, GHBCI_RETRY_HINT_RETRY);
+    g_assert_cmpint(ghbci_error_retry_hint_for_code(9942), ==, GHBCI_RETRY_HINT_USER_ACTION);
+    g_assert_cmpint(ghbci_error_retry_hint_for_code(9050), ==, GHBCI_RETRY_HINT_NEVER);
+    g_assert_cmpint(ghbci_error_retry_hint_for_code(GHBCI_ERROR_NETWORK), ==, GHBCI_RETRY_HINT_RETRY);
+    g_assert_cmpint(ghbci_error_retry_hint_for_code(GHBCI_ERROR_ABORTED), ==, GHBCI_RETRY_HINT_NEVER);
+}
+
+static void
+test_segment(void)
+{
+    GError* error = NULL;
+    GError* copy;
+
+    ghbci_set_error(&error, 9210, "4", GHBCI_RETRY_HINT_NEVER, "%s", "Auftrag abgelehnt");
+    g_assert_error(error, GHBCI_ERROR, 9210);
+    g_assert_cmpstr(error->message, ==, "Auftrag abgelehnt");
+    g_assert_cmpstr(ghbci_error_get_segment(error), ==, "4");
+
+    // extended data survives copies
+    copy = g_error_copy(error);
+    g_clear_error(&error);
+    g_assert_cmpstr(ghbci_error_get_segment(copy), ==, "4");
+    g_assert_cmpint(ghbci_error_get_retry_hint(copy), ==, GHBCI_RETRY_HINT_NEVER);
+    g_error_free(copy);
+
+    ghbci_set_error(&error, 9800, NULL, GHBCI_RETRY_HINT_RETRY, "Dialog abgebrochen");
+    g_assert_null(ghbci_error_get_segment(error));
+    g_assert_cmpint(ghbci_error_get_retry_hint(error), ==, GHBCI_RETRY_HINT_RETRY);
+    g_error_free(error);
+
+    // ignored without return location
+    ghbci_set_error(NULL, 9800, NULL, GHBCI_RETRY_HINT_RETRY, "Dialog abgebrochen");
+}
+
+static void
+test_other_domain(void)
+{
+    GError* error = g_error_new_literal(G_FILE_ERROR, G_FILE_ERROR_NOENT, "no such file");
+
+    g_assert_null(ghbci_error_get_segment(error));
+    g_assert_cmpint(ghbci_error_get_retry_hint(error), ==, GHBCI_RETRY_HINT_NEVER);
+    g_error_free(error);
+}
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/error/retry-hint", test_retry_hint);
+    g_test_add_func ("/error/segment", test_segment);
+    g_test_add_func ("/error/other-domain", test_other_domain);
+    return g_test_run ();
+}
+
+
+//vim: expandtab sw=4
@@ -0,0 +1,108 @@
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include "ghbci/ghbci-statement.h"
+#include "ghbci/ghbci-statement-private.h"
+#include "ghbci/ghbci-export.h"
+#include "test-helpers.h"
+
+static gchar*
+export (GHbciExportFormat format)
+{
+    GSList* statements = create_statements();
+    GOutputStream* stream = g_memory_output_stream_new_resizable();
+    GError* error = NULL;
+    gchar* data;
+
+    g_assert_true(ghbci_export_statements(statements, format, "12345678", "1234567", stream, NULL, &error));
+    g_assert_no_error(error);
+    g_assert_true(g_output_stream_write_all(stream, "", 1, NULL, NULL, NULL));
+    g_assert_true(g_output_stream_close(stream, NULL, NULL));
+    data = g_memory_output_stream_steal_data(G_MEMORY_OUTPUT_STREAM(stream));
+
+    g_object_unref(stream);
+    g_slist_free_full(statements, g_object_unref);
+    return data;
+}
+
+static void
+test_csv(void)
+{
+    gchar* data = export(GHBCI_EXPORT_FORMAT_CSV);
+
+    g_assert_cmpstr(data, ==,
+            "valuta,booking_date,amount,currency,saldo,gv_code,transaction_type,"
+            "other_name,other_iban,other_bic,eref,mref,cred,reference\r\n"
+            ",1970-01-01,5.50,EUR,,,GUTSCHRIFT,,,,,,,Miete\r\n"
+            "2026-01-03,2026-01-02,-12.34,EUR,987.66,105,LASTSCHRIFT,"
+            "\"Stadtwerke M\xc3\xbcnchen & Co, Abrechnung Strom und Gas\",DE09370205000004108405,BFSWDE33,"
+            "42,,DE05ZZZ00000205131,\"Abschlag \"\"Strom\"\"\nJanuar\"\r\n"
+            ",,-0.01,EUR,993.15,105,LASTSCHRIFT,,,,,,,\r\n");
+    g_free(data);
+}
+
+static void
+test_json_lines(void)
+{
+    gchar* data = export(GHBCI_EXPORT_FORMAT_JSON_LINES);
+
+    g_assert_cmpstr(data, ==,
+            "{\"valuta\":null,\"booking_date\":\"1970-01-01\",\"amount\":\"5.50\",\"currency\":\"EUR\","
+            "\"saldo\":null,\"gv_code\":null,\"transaction_type\":\"GUTSCHRIFT\",\"other_name\":null,\"other_iban\":null,"
+            "\"other_bic\":null,\"eref\":null,\"mref\":null,\"cred\":null,\"reference\":\"Miete\"}\n"
+            "{\"valuta\":\"2026-01-03\",\"booking_date\":\"2026-01-02\",\"amount\":\"-12.34\",\"currency\":\"EUR\","
+            "\"saldo\":\"987.66\",\"gv_code\":\"105\",\"transaction_type\":\"LASTSCHRIFT\","
+            "\"other_name\":\"Stadtwerke M\xc3\xbcnchen & Co, Abrechnung Strom und Gas\","
+            "\"other_iban\":\"DE09370205000004108405\",\"other_bic\":\"BFSWDE33\",\"eref\":\"42\",\"mref\":null,"
+            "\"cred\":\"DE05ZZZ00000205131\",\"reference\":\"Abschlag \\\"Strom\\\"\\nJanuar\"}\n"
+            "{\"valuta\":null,\"booking_date\":null,\"amount\":\"-0.01\",\"currency\":\"EUR\","
+            "\"saldo\":\"993.15\",\"gv_code\":\"105\",\"transaction_type\":\"LASTSCHRIFT\",\"other_name\":null,"
+            "\"other_iban\":null,\"other_bic\":null,\"eref\":null,\"mref\":null,\"cred\":null,\"reference\":\"\"}\n");
+    g_free(data);
+}
+
+static void
+test_ofx(void)
+{
+    gchar* data = export(GHBCI_EXPORT_FORMAT_OFX);
+
+    g_assert_true(g_str_has_prefix(data, "<?xml"));
+    g_assert_nonnull(strstr(data, "<BANKID>12345678</BANKID>\n<ACCTID>1234567</ACCTID>\n"));
+    g_assert_nonnull(strstr(data, "<DTSTART>19700101</DTSTART>\n<DTEND>20260102</DTEND>\n"));
+    g_assert_nonnull(strstr(data,
+            "<STMTTRN>\n<TRNTYPE>DEBIT</TRNTYPE>\n<DTPOSTED>20260102</DTPOSTED>\n<DTUSER>20260103</DTUSER>\n"
+            "<TRNAMT>-12.34</TRNAMT>\n<FITID>20260102-1</FITID>\n"
+            "<NAME>Stadtwerke M\xc3\xbcnchen &amp; Co, Abrechn</NAME>\n"
+            "<MEMO>Abschlag \"Strom\"\nJanuar</MEMO>\n</STMTTRN>\n"));
+    g_assert_nonnull(strstr(data, "<TRNTYPE>CREDIT</TRNTYPE>\n<DTPOSTED>19700101</DTPOSTED>\n<TRNAMT>5.50</TRNAMT>\n"));
+    g_assert_nonnull(strstr(data, "<LEDGERBAL>\n<BALAMT>987.66</BALAMT>\n<DTASOF>20260102</DTASOF>\n</LEDGERBAL>\n"));
+    g_assert_true(g_str_has_suffix(data, "</OFX>\n"));
+    g_free(data);
+}
+
+static void
+test_empty(void)
+{
+    GOutputStream* stream = g_memory_output_stream_new_resizable();
+    GError* error = NULL;
+
+    g_assert_true(ghbci_export_statements(NULL, GHBCI_EXPORT_FORMAT_JSON_LINES, NULL, NULL, stream, NULL, &error));
+    g_assert_no_error(error);
+    g_assert_cmpuint(g_memory_output_stream_get_data_size(G_MEMORY_OUTPUT_STREAM(stream)), ==, 0);
+    g_object_unref(stream);
+}
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/export/csv", test_csv);
+    g_test_add_func ("/export/json-lines", test_json_lines);
+    g_test_add_func ("/export/ofx", test_ofx);
+    g_test_add_func ("/export/empty", test_empty);
+    return g_test_run ();
+}
+
+
+//vim: expandtab sw=4
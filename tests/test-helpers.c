@@ -0,0 +1,102 @@
+#include <unistd.h>
+#include "ghbci/ghbci-context.h"
+#include "ghbci/ghbci-statement.h"
+#include "ghbci/ghbci-statement-private.h"
+#include "ghbci/ghbci-error.h"
+#include "ghbci/ghbci-error-private.h"
+#include "test-helpers.h"
+
+GSList*
+create_statements (void)
+{
+    GSList* statements = NULL;
+
+    statements = g_slist_append(statements, ghbci_statement_new_structured(NULL,
+                0, ghbci_statement_pack_date(1, 1, 1970),
+                g_strdup("5.50 EUR"), NULL, NULL, g_strdup("GUTSCHRIFT"), NULL, NULL, NULL,
+                g_strdup("Miete"), NULL, NULL, NULL));
+    statements = g_slist_append(statements, ghbci_statement_new_structured(NULL,
+                ghbci_statement_pack_date(3, 1, 2026), ghbci_statement_pack_date(2, 1, 2026),
+                g_strdup("-12.34 EUR"), g_strdup("987.66 EUR"), g_strdup("105"), g_strdup("LASTSCHRIFT"),
+                g_strdup("Stadtwerke M\xc3\xbcnchen & Co, Abrechnung Strom und Gas"),
+                g_strdup("DE09370205000004108405"), g_strdup("BFSWDE33"),
+                g_strdup("Abschlag \"Strom\"\nJanuar"), g_strdup("42"), NULL, g_strdup("DE05ZZZ00000205131")));
+    statements = g_slist_append(statements, ghbci_statement_new_structured(NULL,
+                0, 0, g_strdup("-0.01 EUR"), g_strdup("993.15 EUR"), g_strdup("105"), g_strdup("LASTSCHRIFT"),
+                NULL, NULL, NULL, g_strdup(""), NULL, NULL, NULL));
+    return statements;
+}
+
+int
+run_fake_worker (const FakeWorkerRequest* requests)
+{
+    GSocket* socket = g_socket_new_from_fd(3, NULL);
+    GHbciWorkerMessage kind;
+    GVariant* body;
+    gint fd;
+    guint i;
+
+    while (ghbci_worker_receive(socket, -1, &kind, &body, &fd, NULL)) {
+        for (i = 0; requests[i].handler != NULL && requests[i].kind != kind; i++)
+            ;
+        if (requests[i].handler == NULL)
+            _exit(1);
+        requests[i].handler(socket, body);
+        g_variant_unref(body);
+    }
+    g_object_unref(socket);
+    return 0;
+}
+
+void
+fake_worker_reply (GSocket* socket, GVariant* body)
+{
+    ghbci_worker_send(socket, GHBCI_WORKER_REPLY, g_variant_new("()"), -1, NULL);
+}
+
+void
+fake_worker_ask_pin (GSocket* socket, GVariant* body)
+{
+    GHbciWorkerMessage kind;
+    GVariant* answer;
+    GError* error = NULL;
+    gchar* pin = NULL;
+    gint fd;
+
+    ghbci_worker_send(socket, GHBCI_WORKER_CALLBACK,
+            g_variant_new("(xss)", (gint64)GHBCI_REASON_ENUM_NEED_PT_PIN, "PIN", ""), -1, NULL);
+    ghbci_worker_receive(socket, -1, &kind, &answer, &fd, NULL);
+    g_variant_get(answer, "ms", &pin);
+    g_variant_unref(answer);
+    if (g_strcmp0(pin, "1234") == 0) {
+        ghbci_worker_send(socket, GHBCI_WORKER_REPLY, g_variant_new("()"), -1, NULL);
+    } else {
+        ghbci_set_error(&error, 9942, "3", GHBCI_RETRY_HINT_USER_ACTION, "PIN falsch");
+        ghbci_worker_send(socket, GHBCI_WORKER_ERROR, ghbci_worker_error_to_variant(error), -1, NULL);
+        g_clear_error(&error);
+    }
+    g_free(pin);
+}
+
+void
+fake_worker_send_statements (GSocket* socket, GVariant* body)
+{
+    GSList* statements = create_statements();
+    gint fd = ghbci_worker_write_statements(statements, NULL);
+
+    ghbci_worker_send(socket, GHBCI_WORKER_REPLY, g_variant_new("()"), fd, NULL);
+    close(fd);
+    g_slist_free_full(statements, g_object_unref);
+}
+
+void
+fake_worker_get_bank (GSocket* socket, GVariant* body)
+{
+    // the rate limit of a job applies to the server of the bank
+    ghbci_worker_send(socket, GHBCI_WORKER_REPLY, g_variant_new("(ss)", "Testbank",
+                g_str_equal(g_variant_get_string(body, NULL), "12345678") ? "https://hbci.example/" : ""),
+            -1, NULL);
+}
+
+
+//vim: expandtab sw=4
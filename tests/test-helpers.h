@@ -0,0 +1,47 @@
+#ifndef TEST_HELPERS_H
+#define TEST_HELPERS_H
+
+#include <glib.h>
+#include <gio/gio.h>
+#include "ghbci/ghbci-worker-pool-private.h"
+
+/*
+ * Shared by the tests, linked into each of them
+ */
+
+/*
+ * A rent credit of 1970-01-01, a debit with all fields set and a debit
+ * without dates
+ */
+GSList* create_statements (void);
+
+/*
+ * Answers a request of the fake worker with the body the context sent
+ */
+typedef void (*FakeWorkerHandler) (GSocket* socket, GVariant* body);
+
+typedef struct
+{
+    GHbciWorkerMessage kind;
+    FakeWorkerHandler handler;
+} FakeWorkerRequest;
+
+/*
+ * Stands in for ghbci-worker on fd 3, requests is terminated by a NULL
+ * handler and the worker crashes on any kind not in it
+ */
+int run_fake_worker (const FakeWorkerRequest* requests);
+
+/* replies an empty tuple */
+void fake_worker_reply (GSocket* socket, GVariant* body);
+/* asks for the pin, only 1234 is right */
+void fake_worker_ask_pin (GSocket* socket, GVariant* body);
+/* sends create_statements() */
+void fake_worker_send_statements (GSocket* socket, GVariant* body);
+/* Testbank, with a pin/tan url only for 12345678 */
+void fake_worker_get_bank (GSocket* socket, GVariant* body);
+
+#endif
+
+
+//vim: expandtab sw=4
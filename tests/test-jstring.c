@@ -0,0 +1,171 @@
+#include <string.h>
+#include <glib.h>
+#include <jni.h>
+#include "ghbci/ghbci-jstring-private.h"
+
+/*
+ * Java strings faked by utf-8 strings behind a JNI function table with the
+ * functions the copies may use. Like the spec, GetStringUTFRegion()
+ * doesn't promise a terminating NUL, so the fake writes garbage instead.
+ */
+static guint region_calls;
+
+static jsize
+fake_GetStringLength (JNIEnv* env, jstring str)
+{
+    return g_utf8_strlen((const gchar*)str, -1);
+}
+
+static jsize
+fake_GetStringUTFLength (JNIEnv* env, jstring str)
+{
+    return strlen((const gchar*)str);
+}
+
+static void
+fake_GetStringUTFRegion (JNIEnv* env, jstring str, jsize start, jsize len, char* buf)
+{
+    const gchar* begin = g_utf8_offset_to_pointer((const gchar*)str, start);
+    const gchar* end = g_utf8_offset_to_pointer(begin, len);
+
+    memcpy(buf, begin, end - begin);
+    buf[end - begin] = 'X';
+    region_calls++;
+}
+
+static void
+fake_GetStringRegion (JNIEnv* env, jstring str, jsize start, jsize len, jchar* buf)
+{
+    gunichar2* chars = g_utf8_to_utf16((const gchar*)str, -1, NULL, NULL, NULL);
+
+    memcpy(buf, chars + start, len * sizeof(jchar));
+    g_free(chars);
+    region_calls++;
+}
+
+static struct JNINativeInterface_ fake_functions;
+static JNIEnv fake_env = &fake_functions;
+
+#define JSTRING(str) ((jstring)(str))
+
+static void
+test_dup(void)
+{
+    gchar* copy;
+
+    region_calls = 0;
+    copy = ghbci_jstring_dup(&fake_env, JSTRING("Stadtwerke"));
+    g_assert_cmpstr(copy, ==, "Stadtwerke");
+    g_free(copy);
+
+    // length in bytes, not in chars
+    copy = ghbci_jstring_dup(&fake_env, JSTRING("Müller"));
+    g_assert_cmpstr(copy, ==, "Müller");
+    g_free(copy);
+    g_assert_cmpuint(region_calls, ==, 2);
+
+    copy = ghbci_jstring_dup(&fake_env, JSTRING(""));
+    g_assert_cmpstr(copy, ==, "");
+    g_free(copy);
+    g_assert_cmpuint(region_calls, ==, 2);
+
+    g_assert_null(ghbci_jstring_dup(&fake_env, NULL));
+}
+
+static void
+test_append(void)
+{
+    GString* string = g_string_new("SVWZ+Miete\n");
+
+    g_assert_cmpuint(ghbci_jstring_append(string, &fake_env, JSTRING("Januar für")), ==, 11);
+    g_assert_cmpstr(string->str, ==, "SVWZ+Miete\nJanuar für");
+    g_assert_cmpuint(string->len, ==, 22);
+    g_assert_cmpuint(ghbci_jstring_append(string, &fake_env, NULL), ==, 0);
+    g_assert_cmpuint(string->len, ==, 22);
+    g_string_free(string, TRUE);
+}
+
+static void
+test_arena(void)
+{
+    GHbciJStringArena arena;
+    const gchar* copies[200];
+    const gchar* first;
+    gchar* large;
+    guint i;
+
+    ghbci_jstring_arena_init(&arena);
+    g_assert_null(ghbci_jstring_arena_copy(&arena, &fake_env, NULL));
+
+    // copies stay valid when the arena takes another block
+    for (i = 0; i < G_N_ELEMENTS(copies); i++)
+        copies[i] = ghbci_jstring_arena_copy(&arena, &fake_env, JSTRING("LASTSCHRIFT"));
+    for (i = 0; i < G_N_ELEMENTS(copies); i++)
+        g_assert_cmpstr(copies[i], ==, "LASTSCHRIFT");
+    g_assert_nonnull(arena.full);
+
+    large = g_strnfill(GHBCI_JSTRING_ARENA_BLOCK_SIZE * 2, 'a');
+    g_assert_cmpstr(ghbci_jstring_arena_copy(&arena, &fake_env, JSTRING(large)), ==, large);
+    g_free(large);
+
+    // a reset keeps one block for the next row
+    ghbci_jstring_arena_reset(&arena);
+    g_assert_null(arena.full);
+    first = ghbci_jstring_arena_copy(&arena, &fake_env, JSTRING("105"));
+    g_assert_true(first == arena.block);
+    g_assert_cmpstr(first, ==, "105");
+
+    ghbci_jstring_arena_clear(&arena);
+    g_assert_null(arena.block);
+}
+
+static void
+test_copy_prefix(void)
+{
+    gchar dest[8];
+    gchar* large;
+    gchar* message;
+
+    region_calls = 0;
+    g_assert_cmpuint(ghbci_jstring_copy_prefix(&fake_env, JSTRING("Miete"), dest, sizeof(dest)), ==, 5);
+    g_assert_cmpstr(dest, ==, "Miete");
+    g_assert_cmpuint(ghbci_jstring_copy_prefix(&fake_env, NULL, dest, sizeof(dest)), ==, 0);
+    g_assert_cmpstr(dest, ==, "");
+
+    // cut before the character not fitting completely
+    g_assert_cmpuint(ghbci_jstring_copy_prefix(&fake_env, JSTRING("Gebühr"), dest, 5), ==, 3);
+    g_assert_cmpstr(dest, ==, "Geb");
+    g_assert_cmpuint(ghbci_jstring_copy_prefix(&fake_env, JSTRING("Gebühr"), dest, 6), ==, 5);
+    g_assert_cmpstr(dest, ==, "Gebü");
+    g_assert_cmpuint(region_calls, ==, 3);
+
+    // a long string is read as far as it fits only, in one call
+    region_calls = 0;
+    large = g_strnfill(GHBCI_JSTRING_PREFIX_CHUNK * 4, 'a');
+    message = g_malloc(GHBCI_JSTRING_PREFIX_CHUNK);
+    g_assert_cmpuint(ghbci_jstring_copy_prefix(&fake_env, JSTRING(large), message, GHBCI_JSTRING_PREFIX_CHUNK),
+            ==, GHBCI_JSTRING_PREFIX_CHUNK - 1);
+    g_assert_cmpuint(region_calls, ==, 1);
+    g_free(message);
+    g_free(large);
+}
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    fake_functions.GetStringLength = fake_GetStringLength;
+    fake_functions.GetStringUTFLength = fake_GetStringUTFLength;
+    fake_functions.GetStringUTFRegion = fake_GetStringUTFRegion;
+    fake_functions.GetStringRegion = fake_GetStringRegion;
+
+    g_test_add_func ("/jstring/dup", test_dup);
+    g_test_add_func ("/jstring/append", test_append);
+    g_test_add_func ("/jstring/arena", test_arena);
+    g_test_add_func ("/jstring/copy-prefix", test_copy_prefix);
+    return g_test_run ();
+}
+
+
+//vim: expandtab sw=4
@@ -0,0 +1,175 @@
+#include <glib.h>
+#include <string.h>
+#include "ghbci/ghbci-log-ring.h"
+
+#define PRODUCERS       4
+#define PER_PRODUCER    10000
+
+static void
+push (GHbciLogRing* ring, gint level, guint serial, const gchar* message)
+{
+    GHbciLogRecord* record;
+    guint64 ticket;
+
+    record = ghbci_log_ring_reserve(ring, &ticket);
+    g_assert(record != NULL);
+    record->level = level;
+    record->serial = serial;
+    g_strlcpy(record->message, message, GHBCI_LOG_RECORD_MESSAGE_SIZE);
+    ghbci_log_ring_commit(ring, ticket);
+}
+
+static void
+test_order(void)
+{
+    GHbciLogRing* ring = ghbci_log_ring_new(8);
+    GHbciLogRecord record;
+    gint i;
+
+    // wraps around twice
+    for (i = 0; i < 20; i++) {
+        gchar* message = g_strdup_printf("message %d", i);
+        push(ring, 3, i, message);
+        g_assert(ghbci_log_ring_pop(ring, &record));
+        g_assert_cmpuint(record.serial, ==, i);
+        g_assert_cmpstr(record.message, ==, message);
+        g_free(message);
+    }
+    g_assert(!ghbci_log_ring_pop(ring, &record));
+
+    ghbci_log_ring_free(ring);
+}
+
+static void
+test_full(void)
+{
+    GHbciLogRing* ring = ghbci_log_ring_new(5);
+    GHbciLogRecord record;
+    guint64 ticket;
+    gint i;
+
+    // capacity is rounded up to 8
+    for (i = 0; i < 8; i++) {
+        push(ring, 3, i, "fill");
+    }
+    g_assert(ghbci_log_ring_reserve(ring, &ticket) == NULL);
+    g_assert(ghbci_log_ring_reserve(ring, &ticket) == NULL);
+    g_assert_cmpuint(ghbci_log_ring_get_dropped(ring), ==, 2);
+
+    // room again after consuming
+    g_assert(ghbci_log_ring_pop(ring, &record));
+    g_assert_cmpuint(record.serial, ==, 0);
+    push(ring, 3, 8, "again");
+
+    ghbci_log_ring_free(ring);
+}
+
+typedef struct
+{
+    /* read by the test thread while the drain thread counts */
+    gint received;
+    guint last[PRODUCERS];
+    gboolean ordered;
+} Collected;
+
+static void
+collect (const GHbciLogRecord* record, gpointer user_data)
+{
+    Collected* collected = user_data;
+    guint producer = record->level;
+
+    // records of one producer arrive in order
+    if (record->serial != collected->last[producer] + 1)
+        collected->ordered = FALSE;
+    collected->last[producer] = record->serial;
+    g_atomic_int_inc(&collected->received);
+}
+
+typedef struct
+{
+    GHbciLogRing* ring;
+    gint producer;
+} Producer;
+
+static gpointer
+produce (gpointer data)
+{
+    Producer* producer = data;
+    GHbciLogRecord* record;
+    guint64 ticket;
+    guint i;
+
+    for (i = 1; i <= PER_PRODUCER; i++) {
+        // spin while the drain thread catches up
+        while ((record = ghbci_log_ring_reserve(producer->ring, &ticket)) == NULL)
+            g_thread_yield();
+        record->level = producer->producer;
+        record->serial = i;
+        ghbci_log_ring_commit(producer->ring, ticket);
+    }
+    return NULL;
+}
+
+static void
+test_drain_thread(void)
+{
+    GHbciLogRing* ring = ghbci_log_ring_new(64);
+    Collected collected = { 0, { 0 }, TRUE };
+    Producer producers[PRODUCERS];
+    GThread* threads[PRODUCERS];
+    gint i;
+
+    ghbci_log_ring_start(ring, collect, &collected);
+    for (i = 0; i < PRODUCERS; i++) {
+        producers[i].ring = ring;
+        producers[i].producer = i;
+        threads[i] = g_thread_new("producer", produce, &producers[i]);
+    }
+    for (i = 0; i < PRODUCERS; i++) {
+        g_thread_join(threads[i]);
+    }
+
+    ghbci_log_ring_flush(ring);
+    g_assert_cmpint(g_atomic_int_get(&collected.received), ==, PRODUCERS * PER_PRODUCER);
+
+    // joining the drain thread makes the rest of collected safe to read
+    ghbci_log_ring_stop(ring);
+    g_assert(collected.ordered);
+    ghbci_log_ring_free(ring);
+}
+
+static void
+flush_from_delivery (const GHbciLogRecord* record, gpointer user_data)
+{
+    GHbciLogRing* ring = user_data;
+
+    // e.g. a log handler of the application flushing, must not deadlock
+    ghbci_log_ring_flush(ring);
+}
+
+static void
+test_flush_from_drain_thread(void)
+{
+    GHbciLogRing* ring = ghbci_log_ring_new(8);
+
+    ghbci_log_ring_start(ring, flush_from_delivery, ring);
+    push(ring, 3, 1, "flushing");
+    ghbci_log_ring_flush(ring);
+    ghbci_log_ring_stop(ring);
+    ghbci_log_ring_free(ring);
+}
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/log-ring/order", test_order);
+    g_test_add_func ("/log-ring/full", test_full);
+    g_test_add_func ("/log-ring/drain-thread", test_drain_thread);
+    g_test_add_func ("/log-ring/flush-from-drain-thread", test_flush_from_drain_thread);
+    return g_test_run ();
+}
+
+
+//vim: expandtab sw=4
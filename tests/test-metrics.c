@@ -0,0 +1,105 @@
+#include <glib.h>
+#include <string.h>
+#include "ghbci/ghbci-metrics.h"
+#include "ghbci/ghbci-metrics-private.h"
+
+static void
+test_percentile(void)
+{
+    GHbciMetrics* metrics = ghbci_metrics_new();
+    guint64 i;
+
+    for (i = 1; i <= 1000; i++) {
+        ghbci_metrics_record(metrics, "msg_send", "12030000", "KUmsAll", i * 1000);
+    }
+
+    g_assert_cmpuint(ghbci_metrics_get_count(metrics, "msg_send", NULL, NULL), ==, 1000);
+    g_assert_cmpuint(ghbci_metrics_get_count(metrics, "msg_parse", NULL, NULL), ==, 0);
+
+    // log-linear buckets are accurate to 1/16
+    guint64 p50 = ghbci_metrics_get_percentile(metrics, "msg_send", "12030000", NULL, 50);
+    g_assert_cmpuint(p50, >=, 500000 - 500000 / 16);
+    g_assert_cmpuint(p50, <=, 500000 + 500000 / 16);
+    guint64 p99 = ghbci_metrics_get_percentile(metrics, NULL, NULL, "KUmsAll", 99);
+    g_assert_cmpuint(p99, >=, 990000 - 990000 / 16);
+    g_assert_cmpuint(p99, <=, 990000 + 990000 / 16);
+
+    ghbci_metrics_reset(metrics);
+    g_assert_cmpuint(ghbci_metrics_get_count(metrics, NULL, NULL, NULL), ==, 0);
+    g_assert_cmpuint(ghbci_metrics_get_percentile(metrics, NULL, NULL, NULL, 50), ==, 0);
+
+    ghbci_metrics_unref(metrics);
+}
+
+static void
+test_status_pairing(void)
+{
+    GHbciMetrics* metrics = ghbci_metrics_new();
+
+    ghbci_metrics_begin_operation(metrics, "12030000", "SaldoReq");
+    ghbci_metrics_status(metrics, 17); // DIALOG_INIT
+    ghbci_metrics_status(metrics, 21); // MSG_CREATE
+    ghbci_metrics_status(metrics, 24); // MSG_SEND
+    ghbci_metrics_status(metrics, 18); // DIALOG_INIT_DONE
+    ghbci_metrics_status(metrics, 2);  // SEND_TASK_DONE without start
+    ghbci_metrics_end_operation(metrics);
+
+    g_assert_cmpuint(ghbci_metrics_get_count(metrics, "dialog_init", "12030000", "SaldoReq"), ==, 1);
+    g_assert_cmpuint(ghbci_metrics_get_count(metrics, "msg_create", NULL, NULL), ==, 1);
+    g_assert_cmpuint(ghbci_metrics_get_count(metrics, "msg_send", NULL, NULL), ==, 1);
+    g_assert_cmpuint(ghbci_metrics_get_count(metrics, "send_task", NULL, NULL), ==, 0);
+    g_assert_cmpuint(ghbci_metrics_get_count(metrics, NULL, NULL, NULL), ==, 3);
+
+    // the raw message is sent within msg_send
+    ghbci_metrics_status(metrics, 24); // MSG_SEND
+    ghbci_metrics_status(metrics, 30); // MSG_RAW_SEND
+    g_usleep(20000);
+    ghbci_metrics_status(metrics, 27); // MSG_RECV
+    g_assert_cmpuint(ghbci_metrics_get_count(metrics, "msg_send", NULL, NULL), ==, 2);
+    g_assert_cmpuint(ghbci_metrics_get_percentile(metrics, "msg_send", NULL, NULL, 100), >=, 19000);
+
+    // the next operation records into its own series
+    ghbci_metrics_begin_operation(metrics, "12030000", "KUmsAll");
+    ghbci_metrics_status(metrics, 17); // DIALOG_INIT
+    ghbci_metrics_status(metrics, 18); // DIALOG_INIT_DONE
+    ghbci_metrics_end_operation(metrics);
+    g_assert_cmpuint(ghbci_metrics_get_count(metrics, "dialog_init", "12030000", "SaldoReq"), ==, 1);
+    g_assert_cmpuint(ghbci_metrics_get_count(metrics, "dialog_init", "12030000", "KUmsAll"), ==, 1);
+
+    ghbci_metrics_unref(metrics);
+}
+
+static void
+test_prometheus(void)
+{
+    GHbciMetrics* metrics = ghbci_metrics_new();
+
+    ghbci_metrics_record(metrics, "execute", "12030000", "KUmsAll", 3000);
+    ghbci_metrics_record(metrics, "execute", "12030000", "KUmsAll", 2000000);
+    // in the bucket from 992 to 1023 microseconds
+    ghbci_metrics_record(metrics, "execute", "12030000", "KUmsAll", 999);
+
+    gchar* text = ghbci_metrics_to_prometheus(metrics);
+    g_assert(strstr(text, "# TYPE ghbci_phase_duration_seconds histogram\n") != NULL);
+    g_assert(strstr(text, "ghbci_phase_duration_seconds_bucket{phase=\"execute\",blz=\"12030000\",job=\"KUmsAll\",le=\"0.001\"} 1\n") != NULL);
+    g_assert(strstr(text, "ghbci_phase_duration_seconds_bucket{phase=\"execute\",blz=\"12030000\",job=\"KUmsAll\",le=\"0.005\"} 2\n") != NULL);
+    g_assert(strstr(text, "ghbci_phase_duration_seconds_bucket{phase=\"execute\",blz=\"12030000\",job=\"KUmsAll\",le=\"+Inf\"} 3\n") != NULL);
+    g_assert(strstr(text, "ghbci_phase_duration_seconds_count{phase=\"execute\",blz=\"12030000\",job=\"KUmsAll\"} 3\n") != NULL);
+    g_free(text);
+
+    ghbci_metrics_unref(metrics);
+}
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/metrics/percentile", test_percentile);
+    g_test_add_func ("/metrics/status-pairing", test_status_pairing);
+    g_test_add_func ("/metrics/prometheus", test_prometheus);
+    return g_test_run ();
+}
+
+
+//vim: expandtab sw=4
@@ -0,0 +1,327 @@
+#include <string.h>
+#include <glib.h>
+#include "ghbci/ghbci-statement.h"
+#include "ghbci/ghbci-mt940-private.h"
+#include "ghbci/ghbci-error.h"
+
+static const gchar diba[] =
+    ":20:STARTUMS\r\n"
+    ":25:12030000/1234567\r\n"
+    ":28C:0\r\n"
+    ":60F:C251230EUR1000,00\r\n"
+    ":61:2512301230DR12,34NMSCNONREF\r\n"
+    ":86:105?00LASTSCHRIFT?20EREF+42?21MREF+C5D043E1A2C847988DF9F3?225F005785EB?23CRED+DE05ZZZ00000205131"
+    "?24SVWZ+1.840000 Max Musterman?25n Lastschrift Miete?30BFSWDE33?31DE09370205000004108405?32Max Muster\r\n"
+    "?33mann\r\n"
+    ":61:2601021231C5,NMSCNONREF\r\n"
+    ":86:166?00GUTSCHRIFT?20Brot fuer die Welt-Vielen D?21ank fuer Ihre Spende EREF:?220002958342 MREF: 0000000253"
+    "?2374 CRED: DE18ZZZ00000180162?24 IBAN: DE093702050000041084?2505 BIC: BFSWDE33\r\n"
+    ":61:260103RC1,5NMSCNONREF\r\n"
+    ":62F:C260103EUR991,16\r\n"
+    "-\r\n"
+    ":20:STARTUMS\r\n"
+    ":60F:D260104EUR5,00\r\n"
+    ":61:260104C10,00NTRFNONREF\r\n"
+    ":86:Freitext \xe4\xf6\xfc ohne Struktur\r\n"
+    "-";
+
+static void
+collect (GHbciStatement* statement, gpointer user_data)
+{
+    GPtrArray* statements = user_data;
+
+    g_ptr_array_add(statements, statement);
+}
+
+static GPtrArray*
+parse (const gchar* data, GError** error)
+{
+    GPtrArray* statements = g_ptr_array_new_with_free_func(g_object_unref);
+
+    if (!ghbci_mt940_parse(data, strlen(data), NULL, collect, statements, error)) {
+        g_ptr_array_unref(statements);
+        return NULL;
+    }
+    return statements;
+}
+
+static void
+assert_date (GDate* date, GDateYear year, GDateMonth month, GDateDay day)
+{
+    g_assert_cmpint(g_date_get_year(date), ==, year);
+    g_assert_cmpint(g_date_get_month(date), ==, month);
+    g_assert_cmpint(g_date_get_day(date), ==, day);
+}
+
+static void
+test_structured(void)
+{
+    GError* error = NULL;
+    GPtrArray* statements = parse(diba, &error);
+    GDate* valuta;
+    GDate* booking_date;
+    gchar* value;
+    gchar* saldo;
+    gchar* gv_code;
+    gchar* transaction_type;
+    gchar* reference;
+    gchar* other_name;
+    gchar* other_iban;
+    gchar* other_bic;
+    gchar* eref;
+    gchar* mref;
+    gchar* cred;
+
+    g_assert_no_error(error);
+    g_assert_cmpuint(statements->len, ==, 4);
+
+    g_object_get(g_ptr_array_index(statements, 0),
+                 "valuta", &valuta,
+                 "booking-date", &booking_date,
+                 "value", &value,
+                 "saldo", &saldo,
+                 "gv-code", &gv_code,
+                 "transaction-type", &transaction_type,
+                 "reference", &reference,
+                 "other-name", &other_name,
+                 "other-iban", &other_iban,
+                 "other-bic", &other_bic,
+                 "eref", &eref,
+                 "mref", &mref,
+                 "cred", &cred,
+                 NULL);
+    assert_date(valuta, 2025, G_DATE_DECEMBER, 30);
+    assert_date(booking_date, 2025, G_DATE_DECEMBER, 30);
+    g_assert_cmpstr(value, ==, "-12.34 EUR");
+    g_assert_cmpstr(saldo, ==, "987.66 EUR");
+    g_assert_cmpstr(gv_code, ==, "105");
+    g_assert_cmpstr(transaction_type, ==, "LASTSCHRIFT");
+    g_assert_cmpstr(reference, ==, "1.840000 Max Mustermann Lastschrift Miete");
+    g_assert_cmpstr(other_name, ==, "Max Mustermann");
+    g_assert_cmpstr(other_iban, ==, "DE09370205000004108405");
+    g_assert_cmpstr(other_bic, ==, "BFSWDE33");
+    g_assert_cmpstr(eref, ==, "42");
+    g_assert_cmpstr(mref, ==, "C5D043E1A2C847988DF9F35F005785EB");
+    g_assert_cmpstr(cred, ==, "DE05ZZZ00000205131");
+    g_date_free(valuta);
+    g_date_free(booking_date);
+    g_free(value);
+    g_free(saldo);
+    g_free(gv_code);
+    g_free(transaction_type);
+    g_free(reference);
+    g_free(other_name);
+    g_free(other_iban);
+    g_free(other_bic);
+    g_free(eref);
+    g_free(mref);
+    g_free(cred);
+
+    g_ptr_array_unref(statements);
+}
+
+static void
+test_appended_fields(void)
+{
+    GPtrArray* statements = parse(diba, NULL);
+    GDate* valuta;
+    GDate* booking_date;
+    gchar* saldo;
+    gchar* reference;
+    gchar* other_iban;
+    gchar* other_bic;
+    gchar* mref;
+
+    g_object_get(g_ptr_array_index(statements, 1),
+                 "valuta", &valuta,
+                 "booking-date", &booking_date,
+                 "saldo", &saldo,
+                 "reference", &reference,
+                 "other-iban", &other_iban,
+                 "other-bic", &other_bic,
+                 "mref", &mref,
+                 NULL);
+    /* booked on the last day of the year before the valuta */
+    assert_date(valuta, 2026, G_DATE_JANUARY, 2);
+    assert_date(booking_date, 2025, G_DATE_DECEMBER, 31);
+    g_assert_cmpstr(saldo, ==, "992.66 EUR");
+    g_assert_cmpstr(reference, ==, "Brot fuer die Welt-Vielen Dank fuer Ihre Spende");
+    g_assert_cmpstr(other_iban, ==, "DE09370205000004108405");
+    g_assert_cmpstr(other_bic, ==, "BFSWDE33");
+    g_assert_cmpstr(mref, ==, "000000025374");
+    g_date_free(valuta);
+    g_date_free(booking_date);
+    g_free(saldo);
+    g_free(reference);
+    g_free(other_iban);
+    g_free(other_bic);
+    g_free(mref);
+
+    g_ptr_array_unref(statements);
+}
+
+static void
+test_without_details(void)
+{
+    GPtrArray* statements = parse(diba, NULL);
+    gchar* value;
+    gchar* saldo;
+    gchar* gv_code;
+    gchar* reference;
+
+    /* reversal of a debit, followed directly by the closing balance */
+    g_object_get(g_ptr_array_index(statements, 2),
+                 "value", &value,
+                 "saldo", &saldo,
+                 "gv-code", &gv_code,
+                 "reference", &reference,
+                 NULL);
+    g_assert_cmpstr(value, ==, "-1.50 EUR");
+    g_assert_cmpstr(saldo, ==, "991.16 EUR");
+    g_assert_null(gv_code);
+    g_assert_cmpstr(reference, ==, "");
+    g_free(value);
+    g_free(saldo);
+    g_free(reference);
+
+    g_ptr_array_unref(statements);
+}
+
+static void
+test_unstructured(void)
+{
+    GPtrArray* statements = parse(diba, NULL);
+    gchar* saldo;
+    gchar* gv_code;
+    gchar* reference;
+
+    g_object_get(g_ptr_array_index(statements, 3),
+                 "saldo", &saldo,
+                 "gv-code", &gv_code,
+                 "reference", &reference,
+                 NULL);
+    g_assert_cmpstr(saldo, ==, "5.00 EUR");
+    g_assert_cmpstr(gv_code, ==, "999");
+    g_assert_cmpstr(reference, ==, "Freitext \xc3\xa4\xc3\xb6\xc3\xbc ohne Struktur");
+    g_free(saldo);
+    g_free(gv_code);
+    g_free(reference);
+
+    g_ptr_array_unref(statements);
+}
+
+static void
+test_invalid(void)
+{
+    GError* error = NULL;
+    GPtrArray* statements;
+
+    statements = parse(":20:STARTUMS\r\n:60F:C251230EUR1000,00\r\n:61:2512XXC12,34NMSC\r\n-", &error);
+    g_assert_null(statements);
+    g_assert_error(error, GHBCI_ERROR, GHBCI_ERROR_FAILED);
+    g_clear_error(&error);
+
+    statements = parse("", &error);
+    g_assert_no_error(error);
+    g_assert_cmpuint(statements->len, ==, 0);
+    g_ptr_array_unref(statements);
+}
+
+/*
+ * Statements and error of data fed in pieces of length size
+ */
+static GPtrArray*
+parse_pieces (const gchar* data, gsize size, GError** error)
+{
+    GPtrArray* statements = g_ptr_array_new_with_free_func(g_object_unref);
+    GHbciMt940Parser* parser = ghbci_mt940_parser_new(NULL, collect, statements);
+    gsize length = strlen(data);
+    gboolean valid = TRUE;
+    gsize i;
+
+    for (i = 0; valid && i < length; i += size)
+        valid = ghbci_mt940_parser_feed(parser, data + i, MIN(size, length - i), error);
+    if (valid)
+        valid = ghbci_mt940_parser_finish(parser, error);
+    ghbci_mt940_parser_free(parser);
+    if (!valid) {
+        g_ptr_array_unref(statements);
+        return NULL;
+    }
+    return statements;
+}
+
+static void
+assert_same_statements (GPtrArray* statements, GPtrArray* expected)
+{
+    const gchar* properties[] = { "value", "saldo", "gv-code", "transaction-type", "reference", "other-name",
+        "other-iban", "other-bic" };
+    guint i, j;
+
+    g_assert_cmpuint(statements->len, ==, expected->len);
+    for (i = 0; i < statements->len; i++) {
+        for (j = 0; j < G_N_ELEMENTS(properties); j++) {
+            gchar *value, *expected_value;
+
+            g_object_get(g_ptr_array_index(statements, i), properties[j], &value, NULL);
+            g_object_get(g_ptr_array_index(expected, i), properties[j], &expected_value, NULL);
+            g_assert_cmpstr(value, ==, expected_value);
+            g_free(value);
+            g_free(expected_value);
+        }
+    }
+}
+
+static void
+test_pieces(void)
+{
+    const gchar* invalid = ":20:STARTUMS\r\n:60F:C251230EUR1000,00\r\n:61:2512XXC12,34NMSC\r\n-";
+    GPtrArray* expected = parse(diba, NULL);
+    gchar** lines = g_strsplit(diba, "\r\n", -1);
+    gchar* at_signs = g_strjoinv("@@", lines);
+    GPtrArray* expected_at_signs = parse(at_signs, NULL);
+    GError* expected_error = NULL;
+    GError* error = NULL;
+    gsize size;
+
+    g_assert_null(parse(invalid, &expected_error));
+    for (size = 1; size <= 64; size++) {
+        GPtrArray* statements = parse_pieces(diba, size, &error);
+        g_assert_no_error(error);
+        assert_same_statements(statements, expected);
+        g_ptr_array_unref(statements);
+
+        statements = parse_pieces(at_signs, size, &error);
+        g_assert_no_error(error);
+        assert_same_statements(statements, expected_at_signs);
+        g_ptr_array_unref(statements);
+
+        g_assert_null(parse_pieces(invalid, size, &error));
+        g_assert_error(error, GHBCI_ERROR, GHBCI_ERROR_FAILED);
+        g_assert_cmpstr(error->message, ==, expected_error->message);
+        g_clear_error(&error);
+    }
+
+    g_error_free(expected_error);
+    g_ptr_array_unref(expected_at_signs);
+    g_ptr_array_unref(expected);
+    g_free(at_signs);
+    g_strfreev(lines);
+}
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/mt940/structured", test_structured);
+    g_test_add_func ("/mt940/appended-fields", test_appended_fields);
+    g_test_add_func ("/mt940/without-details", test_without_details);
+    g_test_add_func ("/mt940/unstructured", test_unstructured);
+    g_test_add_func ("/mt940/invalid", test_invalid);
+    g_test_add_func ("/mt940/pieces", test_pieces);
+    return g_test_run ();
+}
+
+
+//vim: expandtab sw=4
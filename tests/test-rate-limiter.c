@@ -0,0 +1,165 @@
+#include <glib.h>
+#include "ghbci/ghbci-rate-limiter.h"
+
+typedef struct
+{
+    GHbciRateLimiter* limiter;
+    const gchar* key;
+    GMutex lock;
+    GCond cond;
+    gboolean acquired;
+} Acquire;
+
+static gpointer
+run_acquire (gpointer data)
+{
+    Acquire* acquire = data;
+
+    ghbci_rate_limiter_acquire(acquire->limiter, acquire->key);
+    g_mutex_lock(&acquire->lock);
+    acquire->acquired = TRUE;
+    g_cond_signal(&acquire->cond);
+    g_mutex_unlock(&acquire->lock);
+    return NULL;
+}
+
+/*
+ * Whether the acquire got a slot within timeout microseconds
+ */
+static gboolean
+wait_acquired (Acquire* acquire, gint64 timeout)
+{
+    gint64 end_time = g_get_monotonic_time() + timeout;
+    gboolean acquired;
+
+    g_mutex_lock(&acquire->lock);
+    while (!acquire->acquired && g_cond_wait_until(&acquire->cond, &acquire->lock, end_time))
+        ;
+    acquired = acquire->acquired;
+    g_mutex_unlock(&acquire->lock);
+    return acquired;
+}
+
+static void
+test_default_limit(void)
+{
+    GHbciRateLimiter* limiter = ghbci_rate_limiter_new();
+    Acquire acquire = { limiter, "bank" };
+    GThread* thread;
+
+    ghbci_rate_limiter_set_limit(limiter, NULL, 0, 1, 1);
+    ghbci_rate_limiter_acquire(limiter, "bank");
+
+    // a new default applies to the buckets created before
+    ghbci_rate_limiter_set_limit(limiter, NULL, 0, 1, 2);
+    thread = g_thread_new("acquire", run_acquire, &acquire);
+    g_assert_true(wait_acquired(&acquire, G_USEC_PER_SEC));
+    g_thread_join(thread);
+
+    // but not to the ones with a limit of their own
+    ghbci_rate_limiter_set_limit(limiter, "other", 0, 1, 1);
+    ghbci_rate_limiter_set_limit(limiter, NULL, 0, 1, 3);
+    ghbci_rate_limiter_acquire(limiter, "other");
+    acquire.key = "other";
+    acquire.acquired = FALSE;
+    thread = g_thread_new("acquire", run_acquire, &acquire);
+    g_assert_false(wait_acquired(&acquire, G_USEC_PER_SEC / 10));
+    ghbci_rate_limiter_release(limiter, "other");
+    g_assert_true(wait_acquired(&acquire, G_USEC_PER_SEC));
+    g_thread_join(thread);
+
+    ghbci_rate_limiter_free(limiter);
+}
+
+/*
+ * Microseconds it takes to acquire and release key n times
+ */
+static gint64
+time_requests (GHbciRateLimiter* limiter, const gchar* key, guint n)
+{
+    gint64 start = g_get_monotonic_time();
+    guint i;
+
+    for (i = 0; i < n; i++) {
+        ghbci_rate_limiter_acquire(limiter, key);
+        ghbci_rate_limiter_release(limiter, key);
+    }
+    return g_get_monotonic_time() - start;
+}
+
+static void
+test_pacing(void)
+{
+    GHbciRateLimiter* limiter = ghbci_rate_limiter_new();
+
+    // a full bucket bursts, then requests follow at the rate
+    ghbci_rate_limiter_set_limit(limiter, "bank", 20, 2, 0);
+    g_assert_cmpint(time_requests(limiter, "bank", 2), <, G_USEC_PER_SEC / 20);
+    g_assert_cmpint(time_requests(limiter, "bank", 2), >=, 2 * G_USEC_PER_SEC / 20 - 5000);
+
+    // the bucket refills up to the burst while no requests are sent
+    g_usleep(3 * G_USEC_PER_SEC / 20);
+    g_assert_cmpint(time_requests(limiter, "bank", 2), <, G_USEC_PER_SEC / 20);
+
+    // other keys have buckets of their own, without limit by default
+    g_assert_cmpint(time_requests(limiter, "other", 10), <, G_USEC_PER_SEC / 20);
+
+    ghbci_rate_limiter_free(limiter);
+}
+
+static void
+test_max_concurrent(void)
+{
+    GHbciRateLimiter* limiter = ghbci_rate_limiter_new();
+    Acquire acquire = { limiter, "bank" };
+    GThread* thread;
+
+    ghbci_rate_limiter_set_limit(limiter, "bank", 0, 1, 2);
+    ghbci_rate_limiter_acquire(limiter, "bank");
+    ghbci_rate_limiter_acquire(limiter, "bank");
+
+    // the third request waits for a slot
+    thread = g_thread_new("acquire", run_acquire, &acquire);
+    g_assert_false(wait_acquired(&acquire, G_USEC_PER_SEC / 10));
+    ghbci_rate_limiter_release(limiter, "bank");
+    g_assert_true(wait_acquired(&acquire, G_USEC_PER_SEC));
+    g_thread_join(thread);
+
+    ghbci_rate_limiter_release(limiter, "bank");
+    ghbci_rate_limiter_release(limiter, "bank");
+    ghbci_rate_limiter_free(limiter);
+}
+
+static void
+test_penalize(void)
+{
+    GHbciRateLimiter* limiter = ghbci_rate_limiter_new();
+
+    // all requests to the key wait, requests to others don't
+    ghbci_rate_limiter_penalize(limiter, "bank", G_USEC_PER_SEC / 5);
+    g_assert_cmpint(time_requests(limiter, "other", 1), <, G_USEC_PER_SEC / 20);
+    g_assert_cmpint(time_requests(limiter, "bank", 1), >=, G_USEC_PER_SEC / 5 - 5000);
+    g_assert_cmpint(time_requests(limiter, "bank", 1), <, G_USEC_PER_SEC / 20);
+
+    // the burst is drained, requests resume at the rate
+    ghbci_rate_limiter_set_limit(limiter, "paced", 20, 5, 0);
+    ghbci_rate_limiter_penalize(limiter, "paced", G_USEC_PER_SEC / 20);
+    g_assert_cmpint(time_requests(limiter, "paced", 2), >=, 2 * G_USEC_PER_SEC / 20 - 5000);
+
+    ghbci_rate_limiter_free(limiter);
+}
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/rate-limiter/default-limit", test_default_limit);
+    g_test_add_func ("/rate-limiter/pacing", test_pacing);
+    g_test_add_func ("/rate-limiter/max-concurrent", test_max_concurrent);
+    g_test_add_func ("/rate-limiter/penalize", test_penalize);
+    return g_test_run ();
+}
+
+
+//vim: expandtab sw=4
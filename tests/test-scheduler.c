@@ -0,0 +1,224 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include "ghbci/ghbci-context.h"
+#include "ghbci/ghbci-scheduler.h"
+
+/*
+ * Runs jobs which only record what they see, the workers are attached to
+ * the jvm of a context if hbci4java is installed
+ */
+
+static GHbciContext* context;
+
+static GMutex lock;
+static GCond cond;
+/* labels of the jobs in the order they ran */
+static GPtrArray* order;
+/* jobs running and most of them at once, per blz */
+static GHashTable* running;
+static GHashTable* most_running;
+/* a job waits until the test opens the gate */
+static gboolean gate_open;
+static guint notified;
+
+static void
+reset (void)
+{
+    g_mutex_lock(&lock);
+    g_ptr_array_set_size(order, 0);
+    g_hash_table_remove_all(running);
+    g_hash_table_remove_all(most_running);
+    gate_open = FALSE;
+    notified = 0;
+    g_mutex_unlock(&lock);
+}
+
+static void
+record (GHbciContext* job_context, const gchar* blz, const gchar* userid, gpointer user_data)
+{
+    guint count;
+
+    g_assert_true(job_context == context);
+    g_mutex_lock(&lock);
+    g_ptr_array_add(order, g_strdup(user_data));
+    count = GPOINTER_TO_UINT(g_hash_table_lookup(running, blz)) + 1;
+    g_hash_table_replace(running, g_strdup(blz), GUINT_TO_POINTER(count));
+    if (count > GPOINTER_TO_UINT(g_hash_table_lookup(most_running, blz)))
+        g_hash_table_replace(most_running, g_strdup(blz), GUINT_TO_POINTER(count));
+    g_mutex_unlock(&lock);
+
+    g_usleep(20000);
+
+    g_mutex_lock(&lock);
+    count = GPOINTER_TO_UINT(g_hash_table_lookup(running, blz)) - 1;
+    g_hash_table_replace(running, g_strdup(blz), GUINT_TO_POINTER(count));
+    g_mutex_unlock(&lock);
+}
+
+static void
+wait_for_gate (GHbciContext* job_context, const gchar* blz, const gchar* userid, gpointer user_data)
+{
+    g_mutex_lock(&lock);
+    while (!gate_open)
+        g_cond_wait(&cond, &lock);
+    g_mutex_unlock(&lock);
+}
+
+static void
+open_gate (void)
+{
+    g_mutex_lock(&lock);
+    gate_open = TRUE;
+    g_cond_broadcast(&cond);
+    g_mutex_unlock(&lock);
+}
+
+static void
+count_notify (gpointer user_data)
+{
+    g_mutex_lock(&lock);
+    notified++;
+    g_cond_broadcast(&cond);
+    g_mutex_unlock(&lock);
+}
+
+static void
+dispose_scheduler (GHbciContext* job_context, const gchar* blz, const gchar* userid, gpointer user_data)
+{
+    g_object_unref(user_data);
+}
+
+static gchar*
+join_order (void)
+{
+    gchar* joined;
+
+    g_mutex_lock(&lock);
+    g_ptr_array_add(order, NULL);
+    joined = g_strjoinv(" ", (gchar**)order->pdata);
+    g_ptr_array_set_size(order, order->len - 1);
+    g_mutex_unlock(&lock);
+    return joined;
+}
+
+static void
+test_round_robin(void)
+{
+    GHbciScheduler* scheduler;
+    gchar* joined;
+
+    if (context == NULL) {
+        g_test_skip("hbci4java is not installed");
+        return;
+    }
+    reset();
+    scheduler = ghbci_scheduler_new(context, 1);
+
+    // the only worker is busy until all jobs are queued
+    ghbci_scheduler_push(scheduler, "10000000", "gate", wait_for_gate, NULL, NULL);
+    ghbci_scheduler_push(scheduler, "10000000", "alice", record, "alice-1", NULL);
+    ghbci_scheduler_push(scheduler, "10000000", "alice", record, "alice-2", NULL);
+    ghbci_scheduler_push(scheduler, "10000000", "alice", record, "alice-3", NULL);
+    ghbci_scheduler_push(scheduler, "20000000", "bob", record, "bob-1", NULL);
+    ghbci_scheduler_push(scheduler, "20000000", "bob", record, "bob-2", NULL);
+    open_gate();
+    ghbci_scheduler_wait(scheduler);
+
+    joined = join_order();
+    g_assert_cmpstr(joined, ==, "alice-1 bob-1 alice-2 bob-2 alice-3");
+    g_free(joined);
+    g_object_unref(scheduler);
+}
+
+static void
+test_bank_limit(void)
+{
+    const gchar* userids[] = { "alice", "bob", "carol", "dave" };
+    GHbciScheduler* scheduler;
+    guint i;
+
+    if (context == NULL) {
+        g_test_skip("hbci4java is not installed");
+        return;
+    }
+    reset();
+    scheduler = ghbci_scheduler_new(context, 4);
+    ghbci_scheduler_set_default_bank_limit(scheduler, 2);
+    ghbci_scheduler_set_bank_limit(scheduler, "10000000", 1);
+
+    for (i = 0; i < G_N_ELEMENTS(userids); i++) {
+        ghbci_scheduler_push(scheduler, "10000000", userids[i], record, "limited", NULL);
+        ghbci_scheduler_push(scheduler, "20000000", userids[i], record, "default", NULL);
+    }
+    ghbci_scheduler_wait(scheduler);
+
+    g_mutex_lock(&lock);
+    g_assert_cmpuint(order->len, ==, 2 * G_N_ELEMENTS(userids));
+    g_assert_cmpuint(GPOINTER_TO_UINT(g_hash_table_lookup(most_running, "10000000")), ==, 1);
+    g_assert_cmpuint(GPOINTER_TO_UINT(g_hash_table_lookup(most_running, "20000000")), <=, 2);
+    g_mutex_unlock(&lock);
+    g_object_unref(scheduler);
+}
+
+static void
+test_dispose_in_job(void)
+{
+    GHbciScheduler* scheduler;
+    gint64 end_time;
+
+    if (context == NULL) {
+        g_test_skip("hbci4java is not installed");
+        return;
+    }
+    reset();
+    scheduler = ghbci_scheduler_new(context, 1);
+
+    // the job drops the last reference, the queued job of bob is dropped with it
+    ghbci_scheduler_push(scheduler, "10000000", "gate", wait_for_gate, NULL, NULL);
+    ghbci_scheduler_push(scheduler, "10000000", "alice", dispose_scheduler, scheduler, count_notify);
+    ghbci_scheduler_push(scheduler, "20000000", "bob", record, "bob", count_notify);
+    open_gate();
+
+    end_time = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+    g_mutex_lock(&lock);
+    while (notified < 2 && g_cond_wait_until(&cond, &lock, end_time))
+        ;
+    g_assert_cmpuint(notified, ==, 2);
+    g_assert_cmpuint(order->len, ==, 0);
+    g_mutex_unlock(&lock);
+}
+
+int
+main (int argc, char *argv[])
+{
+    gchar* directory = NULL;
+    int result;
+
+    g_test_init (&argc, &argv, NULL);
+
+    order = g_ptr_array_new_with_free_func(g_free);
+    running = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    most_running = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    // the jvm can only be created once per process
+    if (g_file_test(DATA_DIR "/hbci4java.jar", G_FILE_TEST_EXISTS)) {
+        directory = g_dir_make_tmp("ghbci-test-XXXXXX", NULL);
+        context = ghbci_context_new(directory);
+    }
+
+    g_test_add_func ("/scheduler/round-robin", test_round_robin);
+    g_test_add_func ("/scheduler/bank-limit", test_bank_limit);
+    g_test_add_func ("/scheduler/dispose-in-job", test_dispose_in_job);
+    result = g_test_run ();
+
+    g_clear_object(&context);
+    if (directory != NULL)
+        g_rmdir(directory);
+    g_free(directory);
+    g_hash_table_unref(most_running);
+    g_hash_table_unref(running);
+    g_ptr_array_unref(order);
+    return result;
+}
+
+
+//vim: expandtab sw=4
@@ -0,0 +1,138 @@
+#include <glib.h>
+#include "ghbci/ghbci-error.h"
+#include "ghbci/ghbci-standing-order.h"
+#include "ghbci/ghbci-standing-order-private.h"
+
+#define PAIN \
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" \
+    "<Document xmlns=\"urn:iso:std:iso:20022:tech:xsd:pain.001.001.03\"><CstmrCdtTrfInitn>" \
+    "<PmtInf><PmtInfId>P1</PmtInfId><DbtrAgt><FinInstnId><BIC>COBADEFFXXX</BIC></FinInstnId></DbtrAgt>" \
+    "<CdtTrfTxInf><PmtId><EndToEndId>NOTPROVIDED</EndToEndId></PmtId>" \
+    "<Amt><InstdAmt Ccy=\"EUR\">750.00</InstdAmt></Amt>" \
+    "<CdtrAgt><FinInstnId><BIC>GENODEF1S04</BIC></FinInstnId></CdtrAgt>" \
+    "<Cdtr><Nm>Hausverwaltung M\xc3\xbcller</Nm></Cdtr>" \
+    "<CdtrAcct><Id><IBAN>DE89370400440532013000</IBAN></Id></CdtrAcct>" \
+    "<RmtInf><Ustrd>Miete</Ustrd></RmtInf></CdtTrfTxInf></PmtInf>" \
+    "</CstmrCdtTrfInitn></Document>"
+
+static void
+test_iso_date(void)
+{
+    GDate date;
+
+    g_date_clear(&date, 1);
+    g_assert_true(ghbci_parse_iso_date("2016-02-29", &date));
+    g_assert_cmpuint(g_date_get_year(&date), ==, 2016);
+    g_assert_cmpuint(g_date_get_month(&date), ==, 2);
+    g_assert_cmpuint(g_date_get_day(&date), ==, 29);
+
+    gchar* text = ghbci_format_iso_date(&date);
+    g_assert_cmpstr(text, ==, "2016-02-29");
+    g_free(text);
+
+    g_assert_false(ghbci_parse_iso_date("2015-02-29", &date));
+    g_assert_false(ghbci_parse_iso_date("2015-01-01x", &date));
+    g_assert_false(ghbci_parse_iso_date("01.01.2015", &date));
+    g_assert_false(ghbci_parse_iso_date(NULL, &date));
+}
+
+static void
+test_new_from_result(void)
+{
+    GHashTable* data = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+    GError* error = NULL;
+
+    // binary values arrive as one character per byte
+    g_hash_table_insert(data, "content_2.sepapain", g_convert(PAIN, -1, "UTF-8", "ISO-8859-1", NULL, NULL, NULL));
+    g_hash_table_insert(data, "content_2.orderid", g_strdup("4711"));
+    g_hash_table_insert(data, "content_2.DauerDetails.firstdate", g_strdup("2015-01-01"));
+    g_hash_table_insert(data, "content_2.DauerDetails.timeunit", g_strdup("M"));
+    g_hash_table_insert(data, "content_2.DauerDetails.turnus", g_strdup("1"));
+    g_hash_table_insert(data, "content_2.DauerDetails.execday", g_strdup("99"));
+
+    GHbciStandingOrder* order = ghbci_standing_order_new_from_result(data, "content_2.", &error);
+    g_assert_no_error(error);
+    g_assert_nonnull(order);
+    g_assert_cmpstr(order->order_id, ==, "4711");
+    g_assert_cmpstr(order->transfer.name, ==, "Hausverwaltung M\xc3\xbcller");
+    g_assert_cmpstr(order->transfer.iban, ==, "DE89370400440532013000");
+    g_assert_cmpstr(order->transfer.bic, ==, "GENODEF1S04");
+    g_assert_cmpstr(order->transfer.amount, ==, "750.00");
+    g_assert_cmpstr(order->transfer.reference, ==, "Miete");
+    g_assert_nonnull(order->first_date);
+    g_assert_cmpuint(g_date_get_year(order->first_date), ==, 2015);
+    g_assert_null(order->last_date);
+    g_assert_cmpint(order->time_unit, ==, GHBCI_TIME_UNIT_MONTHLY);
+    g_assert_cmpuint(order->turnus, ==, 1);
+    g_assert_cmpuint(order->exec_day, ==, 99);
+    g_assert_no_error(error);
+    g_assert_true(ghbci_standing_order_validate(order, &error));
+    g_assert_no_error(error);
+
+    GHbciStandingOrder* copy = ghbci_standing_order_copy(order);
+    g_assert_cmpstr(copy->transfer.reference, ==, "Miete");
+    g_assert_cmpuint(g_date_get_julian(copy->first_date), ==, g_date_get_julian(order->first_date));
+    ghbci_standing_order_free(copy);
+    ghbci_standing_order_free(order);
+
+    g_assert_null(ghbci_standing_order_new_from_result(data, "content.", &error));
+    g_assert_error(error, GHBCI_ERROR, GHBCI_ERROR_INVALID_DATA);
+    g_clear_error(&error);
+    g_hash_table_unref(data);
+}
+
+static void
+test_validate(void)
+{
+    GDate* first = g_date_new_dmy(1, G_DATE_JANUARY, 2016);
+    GDate* last = g_date_new_dmy(1, G_DATE_DECEMBER, 2015);
+    GHbciStandingOrder order = {
+        NULL,
+        { "Max Mustermann", NULL, "DE89370400440532013000", "Rent", "500", NULL },
+        first, NULL, GHBCI_TIME_UNIT_WEEKLY, 2, 5
+    };
+    GError* error = NULL;
+
+    g_assert_true(ghbci_standing_order_validate(&order, &error));
+    g_assert_no_error(error);
+
+    order.exec_day = 8;
+    g_assert_false(ghbci_standing_order_validate(&order, &error));
+    g_assert_error(error, GHBCI_ERROR, GHBCI_ERROR_INVALID_DATA);
+    g_clear_error(&error);
+
+    order.time_unit = GHBCI_TIME_UNIT_MONTHLY;
+    order.turnus = 13;
+    g_assert_false(ghbci_standing_order_validate(&order, &error));
+    g_assert_error(error, GHBCI_ERROR, GHBCI_ERROR_INVALID_DATA);
+    g_clear_error(&error);
+
+    order.turnus = 3;
+    order.last_date = last;
+    g_assert_false(ghbci_standing_order_validate(&order, &error));
+    g_assert_error(error, GHBCI_ERROR, GHBCI_ERROR_INVALID_DATA);
+    g_clear_error(&error);
+
+    order.last_date = NULL;
+    order.first_date = NULL;
+    g_assert_false(ghbci_standing_order_validate(&order, &error));
+    g_assert_error(error, GHBCI_ERROR, GHBCI_ERROR_INVALID_DATA);
+    g_clear_error(&error);
+
+    g_date_free(first);
+    g_date_free(last);
+}
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/standing-order/iso-date", test_iso_date);
+    g_test_add_func ("/standing-order/new-from-result", test_new_from_result);
+    g_test_add_func ("/standing-order/validate", test_validate);
+    return g_test_run ();
+}
+
+
+//vim: expandtab sw=4
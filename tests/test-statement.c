@@ -88,6 +88,95 @@ test_prettify_volksbank(void)
     g_object_unref(statement);
 }
 
+static void
+test_string_ids(void)
+{
+    GHbciStringPool* pool = ghbci_string_pool_new();
+    GHbciStatement* first = ghbci_statement_new_structured(pool, 0, 0, g_strdup("1.00 EUR"), NULL,
+            g_strdup("105"), g_strdup("LASTSCHRIFT"), g_strdup("Stadtwerke"), NULL, g_strdup("BFSWDE33"),
+            g_strdup("Januar"), NULL, NULL, NULL);
+    GHbciStatement* second = ghbci_statement_new_structured(pool, 0, 0, g_strdup("2.00 EUR"), NULL,
+            g_strdup("105"), g_strdup("LASTSCHRIFT"), g_strdup("Stadtwerke"), NULL, NULL,
+            g_strdup("Februar"), NULL, NULL, NULL);
+    ghbci_string_pool_unref(pool);
+
+    g_assert_true(first->priv->gv_code == second->priv->gv_code);
+    g_assert_cmpuint(ghbci_statement_get_string_id(first, "gv-code"), ==,
+            ghbci_statement_get_string_id(second, "gv-code"));
+    g_assert_cmpuint(ghbci_statement_get_string_id(first, "gv-code"), !=,
+            ghbci_statement_get_string_id(first, "transaction-type"));
+    g_assert_cmpuint(ghbci_statement_get_string_id(first, "other-name"), ==,
+            ghbci_statement_get_string_id(second, "other-name"));
+    g_assert_cmpuint(ghbci_statement_get_string_id(first, "other-bic"), !=, 0);
+    g_assert_cmpuint(ghbci_statement_get_string_id(second, "other-bic"), ==, 0);
+
+    // setting a property pools the new value
+    g_object_set(second, "transaction-type", "GUTSCHRIFT", NULL);
+    g_assert_cmpuint(ghbci_statement_get_string_id(first, "transaction-type"), !=,
+            ghbci_statement_get_string_id(second, "transaction-type"));
+    g_object_set(second, "transaction-type", "LASTSCHRIFT", NULL);
+    g_assert_true(first->priv->transaction_type == second->priv->transaction_type);
+
+    g_object_unref(first);
+    g_assert_cmpstr(second->priv->gv_code, ==, "105");
+    g_object_unref(second);
+}
+
+static void
+assert_packed_date (guint32 date, guint day, guint month, guint year)
+{
+    GDate view;
+
+    g_assert_nonnull(ghbci_statement_date_view(date, &view));
+    g_assert_cmpuint(g_date_get_day(&view), ==, day);
+    g_assert_cmpuint(g_date_get_month(&view), ==, month);
+    g_assert_cmpuint(g_date_get_year(&view), ==, year);
+}
+
+static void
+test_java_dates(void)
+{
+    GTimeZone* zone = g_time_zone_new_identifier("Europe/Berlin");
+
+    if (zone == NULL) {
+        g_test_skip("no tzdata for Europe/Berlin");
+        return;
+    }
+    // midnights in Europe/Berlin, the day before in UTC
+    assert_packed_date(ghbci_statement_pack_java_time(zone, G_GINT64_CONSTANT(1767308400000)), 2, 1, 2026);
+    assert_packed_date(ghbci_statement_pack_java_time(zone, G_GINT64_CONSTANT(1751320800000)), 1, 7, 2025);
+    assert_packed_date(ghbci_statement_pack_java_time(zone, G_GINT64_CONSTANT(-90000000)), 31, 12, 1969);
+    // one millisecond before midnight
+    assert_packed_date(ghbci_statement_pack_java_time(zone, G_GINT64_CONSTANT(1751320799999)), 30, 6, 2025);
+    g_time_zone_unref(zone);
+}
+
+static void
+test_dates(void)
+{
+    GDate* date = g_date_new_dmy(29, G_DATE_FEBRUARY, 2024);
+    GDate* valuta;
+    GDate* booking_date;
+    GHbciStatement* statement = g_object_new(GHBCI_TYPE_STATEMENT,
+            "valuta", date,
+            NULL);
+
+    g_assert_cmpuint(ghbci_statement_pack_date(30, 2, 2024), ==, 0);
+    g_assert_cmpuint(statement->priv->valuta, ==, ghbci_statement_pack_date(29, 2, 2024));
+    g_assert_cmpuint(statement->priv->booking_date, ==, 0);
+
+    g_object_get(statement,
+                 "valuta", &valuta,
+                 "booking-date", &booking_date,
+                 NULL);
+    g_assert_cmpint(g_date_compare(valuta, date), ==, 0);
+    g_assert_null(booking_date);
+
+    g_date_free(valuta);
+    g_date_free(date);
+    g_object_unref(statement);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -96,6 +185,9 @@ main (int argc, char *argv[])
     g_test_add_func ("/statement/remove-new-lines", test_remove_newlines);
     g_test_add_func ("/statement/prettify-diba", test_prettify_diba);
     g_test_add_func ("/statement/prettify-volksbank", test_prettify_volksbank);
+    g_test_add_func ("/statement/string-ids", test_string_ids);
+    g_test_add_func ("/statement/java-dates", test_java_dates);
+    g_test_add_func ("/statement/dates", test_dates);
     return g_test_run ();
 }
 
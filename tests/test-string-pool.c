@@ -0,0 +1,87 @@
+#include <glib.h>
+#include "ghbci/ghbci-string-pool-private.h"
+
+static void
+test_intern(void)
+{
+    GHbciStringPool* pool = ghbci_string_pool_new();
+    gchar* copy = g_strdup("LASTSCHRIFT");
+    const gchar* first;
+    const gchar* second;
+    guint first_id;
+    guint second_id;
+
+    first = ghbci_string_pool_intern(pool, "LASTSCHRIFT", &first_id);
+    second = ghbci_string_pool_intern(pool, copy, &second_id);
+    g_free(copy);
+    g_assert_cmpstr(first, ==, "LASTSCHRIFT");
+    g_assert_true(first == second);
+    g_assert_cmpuint(first_id, ==, 1);
+    g_assert_cmpuint(second_id, ==, 1);
+
+    second = ghbci_string_pool_intern(pool, "GUTSCHRIFT", &second_id);
+    g_assert_cmpstr(second, ==, "GUTSCHRIFT");
+    g_assert_cmpuint(second_id, ==, 2);
+    g_assert_cmpuint(ghbci_string_pool_get_size(pool), ==, 2);
+
+    // the empty string is a value like any other
+    ghbci_string_pool_intern(pool, "", &second_id);
+    g_assert_cmpuint(second_id, ==, 3);
+
+    ghbci_string_pool_unref(pool);
+}
+
+static void
+test_null(void)
+{
+    GHbciStringPool* pool = ghbci_string_pool_new();
+    guint id = 42;
+
+    g_assert_null(ghbci_string_pool_intern(pool, NULL, &id));
+    g_assert_cmpuint(id, ==, 0);
+    g_assert_cmpuint(ghbci_string_pool_get_size(pool), ==, 0);
+    ghbci_string_pool_unref(pool);
+}
+
+static void
+test_ref(void)
+{
+    GHbciStringPool* pool = ghbci_string_pool_new();
+    const gchar* pooled = ghbci_string_pool_intern(pool, "105", NULL);
+
+    ghbci_string_pool_ref(pool);
+    ghbci_string_pool_unref(pool);
+    g_assert_cmpstr(pooled, ==, "105");
+    ghbci_string_pool_unref(pool);
+}
+
+static void
+test_sized(void)
+{
+    GHbciStringPool* pool = ghbci_string_pool_new_sized(8);
+    const gchar* first = ghbci_string_pool_intern(pool, "LASTSCHRIFT", NULL);
+    const gchar* second = ghbci_string_pool_intern(pool, "105", NULL);
+
+    // strings stay where they are when the pool grows
+    ghbci_string_pool_intern(pool, "Stadtwerke Musterstadt GmbH", NULL);
+    g_assert_cmpstr(first, ==, "LASTSCHRIFT");
+    g_assert_cmpstr(second, ==, "105");
+    g_assert_true(ghbci_string_pool_intern(pool, "105", NULL) == second);
+    g_assert_cmpuint(ghbci_string_pool_get_size(pool), ==, 3);
+    ghbci_string_pool_unref(pool);
+}
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/string-pool/intern", test_intern);
+    g_test_add_func ("/string-pool/null", test_null);
+    g_test_add_func ("/string-pool/ref", test_ref);
+    g_test_add_func ("/string-pool/sized", test_sized);
+    return g_test_run ();
+}
+
+
+//vim: expandtab sw=4
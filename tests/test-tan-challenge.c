@@ -0,0 +1,112 @@
+#include <glib.h>
+#include "ghbci/ghbci-tan-challenge.h"
+#include "ghbci/ghbci-tan-challenge-private.h"
+
+static gpointer
+answer_later (gpointer data)
+{
+    GHbciTanChallenge* challenge = data;
+
+    g_usleep(10000);
+    g_assert_true(ghbci_tan_challenge_answer(challenge, "123456"));
+    ghbci_tan_challenge_unref(challenge);
+    return NULL;
+}
+
+static void
+test_answer(void)
+{
+    GHbciTanChallenge* challenge = ghbci_tan_challenge_new("12345678", "user", "Bitte TAN eingeben", "flicker",
+            g_get_monotonic_time() + 10 * G_TIME_SPAN_SECOND);
+    GThread* thread;
+    gchar* tan;
+
+    g_assert_cmpstr(ghbci_tan_challenge_get_blz(challenge), ==, "12345678");
+    g_assert_cmpstr(ghbci_tan_challenge_get_challenge(challenge), ==, "flicker");
+    g_assert_cmpint(ghbci_tan_challenge_get_state(challenge), ==, GHBCI_TAN_CHALLENGE_PENDING);
+
+    // answered from another thread while this one waits
+    thread = g_thread_new("answer", answer_later, ghbci_tan_challenge_ref(challenge));
+    tan = ghbci_tan_challenge_wait(challenge);
+    g_thread_join(thread);
+
+    g_assert_cmpstr(tan, ==, "123456");
+    g_assert_cmpint(ghbci_tan_challenge_get_state(challenge), ==, GHBCI_TAN_CHALLENGE_ANSWERED);
+    g_free(tan);
+
+    // only the first answer counts
+    g_assert_false(ghbci_tan_challenge_answer(challenge, "654321"));
+    g_assert_false(ghbci_tan_challenge_cancel(challenge));
+    ghbci_tan_challenge_unref(challenge);
+}
+
+static gboolean
+answer_idle (gpointer data)
+{
+    g_assert_true(ghbci_tan_challenge_answer(data, "123456"));
+    return G_SOURCE_REMOVE;
+}
+
+static void
+test_answer_in_main_context(void)
+{
+    GHbciTanChallenge* challenge = ghbci_tan_challenge_new("12345678", "user", "Bitte TAN eingeben", "",
+            g_get_monotonic_time() + 10 * G_TIME_SPAN_SECOND);
+    GMainContext* main_context = g_main_context_new();
+    GSource* idle = g_idle_source_new();
+    gchar* tan;
+
+    // a dialog of the waiting thread answers, like in the main thread of an application
+    g_main_context_push_thread_default(main_context);
+    g_source_set_callback(idle, answer_idle, ghbci_tan_challenge_ref(challenge),
+            (GDestroyNotify)ghbci_tan_challenge_unref);
+    g_source_attach(idle, main_context);
+    g_source_unref(idle);
+    tan = ghbci_tan_challenge_wait(challenge);
+    g_main_context_pop_thread_default(main_context);
+
+    g_assert_cmpstr(tan, ==, "123456");
+    g_assert_cmpint(ghbci_tan_challenge_get_state(challenge), ==, GHBCI_TAN_CHALLENGE_ANSWERED);
+    g_free(tan);
+    g_main_context_unref(main_context);
+    ghbci_tan_challenge_unref(challenge);
+}
+
+static void
+test_cancel(void)
+{
+    GHbciTanChallenge* challenge = ghbci_tan_challenge_new("12345678", "user", "Bitte TAN eingeben", "",
+            g_get_monotonic_time() + 10 * G_TIME_SPAN_SECOND);
+
+    g_assert_true(ghbci_tan_challenge_cancel(challenge));
+    g_assert_null(ghbci_tan_challenge_wait(challenge));
+    g_assert_cmpint(ghbci_tan_challenge_get_state(challenge), ==, GHBCI_TAN_CHALLENGE_CANCELLED);
+    ghbci_tan_challenge_unref(challenge);
+}
+
+static void
+test_expire(void)
+{
+    GHbciTanChallenge* challenge = ghbci_tan_challenge_new("12345678", "user", "Bitte TAN eingeben", "",
+            g_get_monotonic_time() + 1000);
+
+    g_assert_null(ghbci_tan_challenge_wait(challenge));
+    g_assert_cmpint(ghbci_tan_challenge_get_state(challenge), ==, GHBCI_TAN_CHALLENGE_EXPIRED);
+    g_assert_false(ghbci_tan_challenge_answer(challenge, "123456"));
+    ghbci_tan_challenge_unref(challenge);
+}
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/tan-challenge/answer", test_answer);
+    g_test_add_func ("/tan-challenge/answer-in-main-context", test_answer_in_main_context);
+    g_test_add_func ("/tan-challenge/cancel", test_cancel);
+    g_test_add_func ("/tan-challenge/expire", test_expire);
+    return g_test_run ();
+}
+
+
+//vim: expandtab sw=4
@@ -0,0 +1,123 @@
+#include <glib.h>
+#include <gio/gio.h>
+#include <string.h>
+#include "ghbci/ghbci-error.h"
+#include "ghbci/ghbci-transfer.h"
+#include "ghbci/ghbci-transfer-private.h"
+
+static void
+test_parse_amount(void)
+{
+    gint64 cents = 0;
+
+    g_assert_true(ghbci_transfer_parse_amount("1234.56", &cents));
+    g_assert_cmpint(cents, ==, 123456);
+    g_assert_true(ghbci_transfer_parse_amount("7.5", &cents));
+    g_assert_cmpint(cents, ==, 750);
+    g_assert_true(ghbci_transfer_parse_amount("0.01", &cents));
+    g_assert_cmpint(cents, ==, 1);
+    g_assert_true(ghbci_transfer_parse_amount("999999999.99", &cents));
+    g_assert_cmpint(cents, ==, G_GINT64_CONSTANT(99999999999));
+
+    g_assert_false(ghbci_transfer_parse_amount("0.00", &cents));
+    g_assert_false(ghbci_transfer_parse_amount("1000000000", &cents));
+    g_assert_false(ghbci_transfer_parse_amount("1.234", &cents));
+    g_assert_false(ghbci_transfer_parse_amount("1,50", &cents));
+    g_assert_false(ghbci_transfer_parse_amount("-5", &cents));
+    g_assert_false(ghbci_transfer_parse_amount(".5", &cents));
+    g_assert_false(ghbci_transfer_parse_amount("5.", &cents));
+    g_assert_false(ghbci_transfer_parse_amount("", &cents));
+
+    gchar* formatted = ghbci_transfer_format_amount(750);
+    g_assert_cmpstr(formatted, ==, "7.50");
+    g_free(formatted);
+}
+
+static void
+test_check_account(void)
+{
+    g_assert_true(ghbci_transfer_check_iban("DE89370400440532013000"));
+    g_assert_false(ghbci_transfer_check_iban("DE89370400440532013001"));
+    g_assert_false(ghbci_transfer_check_iban("de89370400440532013000"));
+    g_assert_false(ghbci_transfer_check_iban("DE8937"));
+
+    g_assert_true(ghbci_transfer_check_bic("COBADEFFXXX"));
+    g_assert_true(ghbci_transfer_check_bic("COBADEFF"));
+    g_assert_false(ghbci_transfer_check_bic("COBADEF"));
+    g_assert_false(ghbci_transfer_check_bic("cobadeff"));
+    g_assert_false(ghbci_transfer_check_bic("COBADEFO"));
+}
+
+static void
+test_validate(void)
+{
+    GHbciTransfer transfer = { "Max Mustermann", NULL, "DE89370400440532013000", "Rent", "500", NULL };
+    GError* error = NULL;
+
+    g_assert_true(ghbci_transfer_validate(&transfer, &error));
+    g_assert_no_error(error);
+
+    transfer.amount = "500.001";
+    g_assert_false(ghbci_transfer_validate(&transfer, &error));
+    g_assert_error(error, GHBCI_ERROR, GHBCI_ERROR_INVALID_DATA);
+    g_clear_error(&error);
+
+    transfer.amount = "500";
+    transfer.iban = "DE00370400440532013000";
+    g_assert_false(ghbci_transfer_validate(&transfer, &error));
+    g_assert_error(error, GHBCI_ERROR, GHBCI_ERROR_INVALID_DATA);
+    g_clear_error(&error);
+}
+
+static void
+test_write_pain001(void)
+{
+    GHbciTransfer transfers[] = {
+        { "Max Mustermann", "COBADEFFXXX", "DE89370400440532013000", "Salary 10/2026", "2500.00", "PAY-1" },
+        { "Erika & Co", NULL, "DE89370400440532013000", NULL, "0.5", NULL },
+    };
+    GOutputStream* stream = g_memory_output_stream_new_resizable();
+    GError* error = NULL;
+
+    g_assert_true(ghbci_transfer_write_pain001(stream, "MSG-1", "Firma GmbH", NULL, "DE89370400440532013000",
+            transfers, G_N_ELEMENTS(transfers), FALSE, NULL, &error));
+    g_assert_no_error(error);
+    g_assert_true(g_output_stream_close(stream, NULL, NULL));
+
+    gchar* document = g_strndup(g_memory_output_stream_get_data(G_MEMORY_OUTPUT_STREAM(stream)),
+            g_memory_output_stream_get_data_size(G_MEMORY_OUTPUT_STREAM(stream)));
+    g_assert_true(g_str_has_prefix(document, "<?xml"));
+    g_assert_nonnull(strstr(document, "urn:iso:std:iso:20022:tech:xsd:pain.001.003.03"));
+    g_assert_nonnull(strstr(document, "<NbOfTxs>2</NbOfTxs><CtrlSum>2500.50</CtrlSum>"));
+    g_assert_nonnull(strstr(document, "<EndToEndId>PAY-1</EndToEndId>"));
+    g_assert_nonnull(strstr(document, "<EndToEndId>NOTPROVIDED</EndToEndId>"));
+    g_assert_nonnull(strstr(document, "<Nm>Erika &amp; Co</Nm>"));
+    g_assert_nonnull(strstr(document, "<InstdAmt Ccy=\"EUR\">0.50</InstdAmt>"));
+    g_free(document);
+    g_object_unref(stream);
+
+    // nothing is written if a transfer is invalid
+    stream = g_memory_output_stream_new_resizable();
+    transfers[1].amount = "abc";
+    g_assert_false(ghbci_transfer_write_pain001(stream, "MSG-2", "Firma GmbH", NULL, "DE89370400440532013000",
+            transfers, G_N_ELEMENTS(transfers), FALSE, NULL, &error));
+    g_assert_error(error, GHBCI_ERROR, GHBCI_ERROR_INVALID_DATA);
+    g_assert_cmpuint(g_memory_output_stream_get_data_size(G_MEMORY_OUTPUT_STREAM(stream)), ==, 0);
+    g_clear_error(&error);
+    g_object_unref(stream);
+}
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/transfer/parse-amount", test_parse_amount);
+    g_test_add_func ("/transfer/check-account", test_check_account);
+    g_test_add_func ("/transfer/validate", test_validate);
+    g_test_add_func ("/transfer/write-pain001", test_write_pain001);
+    return g_test_run ();
+}
+
+
+//vim: expandtab sw=4
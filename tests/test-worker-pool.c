@@ -0,0 +1,484 @@
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include "ghbci/ghbci-context.h"
+#include "ghbci/ghbci-statement.h"
+#include "ghbci/ghbci-statement-private.h"
+#include "ghbci/ghbci-error.h"
+#include "ghbci/ghbci-error-private.h"
+#include "ghbci/ghbci-worker-pool-private.h"
+#include "test-helpers.h"
+
+static const gchar* program;
+
+/* log level of the options the fake worker got */
+static gint log_level;
+
+static void
+reply_options (GSocket* socket, GVariant* body)
+{
+    g_variant_get(body, "(ib)", &log_level, NULL);
+    fake_worker_reply(socket, body);
+}
+
+/*
+ * The statements with a status event and a log message at the log level of
+ * the options
+ */
+static void
+reply_statements (GSocket* socket, GVariant* body)
+{
+    GHbciStatusPayload* payload = ghbci_status_payload_new(GHBCI_STATUSTAG_ENUM_DIALOG_INIT_DONE);
+
+    payload->dialog_id = g_strdup("4711");
+    ghbci_worker_send(socket, GHBCI_WORKER_STATUS,
+            ghbci_worker_status_to_variant(GHBCI_STATUSTAG_ENUM_DIALOG_INIT_DONE, "4711", payload), -1, NULL);
+    ghbci_status_payload_free(payload);
+    ghbci_worker_send(socket, GHBCI_WORKER_LOG,
+            g_variant_new("(ixss)", log_level, G_GINT64_CONSTANT(0), "4711", "Umsätze abgeholt"), -1, NULL);
+    fake_worker_send_statements(socket, body);
+}
+
+static void
+reply_document (GSocket* socket, GVariant* body)
+{
+    ghbci_worker_send(socket, GHBCI_WORKER_REPLY, body, -1, NULL);
+}
+
+/*
+ * Asks for the pin when a passport is added, returns documents to validate
+ * and crashes when asked for balances
+ */
+static const FakeWorkerRequest fake_worker_requests[] = {
+    { GHBCI_WORKER_ADD_PASSPORT, fake_worker_ask_pin },
+    { GHBCI_WORKER_SET_OPTIONS, reply_options },
+    { GHBCI_WORKER_GET_STATEMENTS, reply_statements },
+    { GHBCI_WORKER_VALIDATE_PAIN001, reply_document },
+    { 0, NULL }
+};
+
+static void
+assert_statements (GSList* statements)
+{
+    GHbciStatement *rent, *debit, *last;
+    GDate* booking_date;
+    gchar* other_name;
+    gchar* reference;
+    gchar* mref;
+
+    g_assert_cmpuint(g_slist_length(statements), ==, 3);
+    rent = g_slist_nth_data(statements, 0);
+    debit = g_slist_nth_data(statements, 1);
+    last = g_slist_nth_data(statements, 2);
+
+    g_object_get(debit, "booking-date", &booking_date, "other-name", &other_name, "reference", &reference,
+            "mref", &mref, NULL);
+    g_assert_cmpuint(g_date_get_day(booking_date), ==, 2);
+    g_assert_cmpstr(other_name, ==, "Stadtwerke M\xc3\xbcnchen & Co, Abrechnung Strom und Gas");
+    g_assert_cmpstr(reference, ==, "Abschlag \"Strom\"\nJanuar");
+    g_assert_null(mref);
+    g_date_free(booking_date);
+    g_free(other_name);
+    g_free(reference);
+
+    // the repeating fields are pooled again
+    g_assert_cmpuint(ghbci_statement_get_string_id(debit, "gv-code"), !=, 0);
+    g_assert_cmpuint(ghbci_statement_get_string_id(debit, "gv-code"), ==,
+            ghbci_statement_get_string_id(last, "gv-code"));
+    g_assert_cmpuint(ghbci_statement_get_string_id(rent, "other-name"), ==, 0);
+}
+
+static void
+test_statements(void)
+{
+    GSList* statements = create_statements();
+    GHbciStringPool* pool = ghbci_string_pool_new();
+    GError* error = NULL;
+    GSList* read;
+    gint fd;
+
+    fd = ghbci_worker_write_statements(statements, &error);
+    g_assert_no_error(error);
+    g_assert_cmpint(fd, >=, 0);
+
+    // sealed, the reader maps it without fearing changes
+    g_assert_cmpint(write(fd, "x", 1), <, 0);
+    g_assert_cmpint(ftruncate(fd, 0), <, 0);
+
+    read = ghbci_worker_read_statements(fd, pool, &error);
+    g_assert_no_error(error);
+    assert_statements(read);
+    g_assert_cmpuint(ghbci_string_pool_get_size(pool), ==, 5);
+
+    close(fd);
+    g_slist_free_full(read, g_object_unref);
+    g_slist_free_full(statements, g_object_unref);
+    ghbci_string_pool_unref(pool);
+}
+
+static void
+test_empty(void)
+{
+    GError* error = NULL;
+    gint fd;
+
+    fd = ghbci_worker_write_statements(NULL, &error);
+    g_assert_no_error(error);
+    g_assert_null(ghbci_worker_read_statements(fd, NULL, &error));
+    g_assert_no_error(error);
+    close(fd);
+}
+
+static void
+test_unsealed(void)
+{
+    GError* error = NULL;
+    gchar* path;
+    gint fd;
+
+    fd = g_file_open_tmp("test-worker-pool-XXXXXX", &path, NULL);
+    g_assert_cmpint(fd, >=, 0);
+    g_unlink(path);
+    g_free(path);
+
+    g_assert_null(ghbci_worker_read_statements(fd, NULL, &error));
+    g_assert_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+    g_error_free(error);
+    close(fd);
+}
+
+static void
+test_messages(void)
+{
+    GSocket* sockets[2];
+    GHbciWorkerMessage kind;
+    GVariant* body;
+    GError* error = NULL;
+    const gchar* blz;
+    const gchar* userid;
+    struct stat info;
+    gchar* document;
+    gint fds[2];
+    gint fd;
+
+    g_assert_cmpint(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds), ==, 0);
+    sockets[0] = g_socket_new_from_fd(fds[0], NULL);
+    sockets[1] = g_socket_new_from_fd(fds[1], NULL);
+
+    g_assert_true(ghbci_worker_send(sockets[0], GHBCI_WORKER_ADD_PASSPORT,
+                g_variant_new("(ss)", "12345678", "test"), -1, &error));
+    g_assert_no_error(error);
+    g_assert_true(ghbci_worker_receive(sockets[1], -1, &kind, &body, &fd, &error));
+    g_assert_no_error(error);
+    g_assert_cmpint(kind, ==, GHBCI_WORKER_ADD_PASSPORT);
+    g_assert_cmpint(fd, ==, -1);
+    g_variant_get(body, "(&s&s)", &blz, &userid);
+    g_assert_cmpstr(blz, ==, "12345678");
+    g_assert_cmpstr(userid, ==, "test");
+    g_variant_unref(body);
+
+    // descriptors travel with the message
+    fd = ghbci_worker_write_statements(NULL, NULL);
+    g_assert_true(ghbci_worker_send(sockets[1], GHBCI_WORKER_REPLY, g_variant_new("()"), fd, &error));
+    close(fd);
+    g_assert_true(ghbci_worker_receive(sockets[0], -1, &kind, &body, &fd, &error));
+    g_assert_cmpint(kind, ==, GHBCI_WORKER_REPLY);
+    g_assert_cmpint(fd, >=, 0);
+    g_assert_cmpint(fstat(fd, &info), ==, 0);
+    close(fd);
+    g_variant_unref(body);
+
+    // larger messages go through a memfd, but can't carry another descriptor
+    document = g_malloc0(4 * GHBCI_WORKER_MESSAGE_MAX);
+    g_assert_true(ghbci_worker_send(sockets[0], GHBCI_WORKER_VALIDATE_PAIN001,
+                g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, document, 4 * GHBCI_WORKER_MESSAGE_MAX, 1), -1,
+                &error));
+    g_assert_no_error(error);
+    g_assert_true(ghbci_worker_receive(sockets[1], -1, &kind, &body, &fd, &error));
+    g_assert_no_error(error);
+    g_assert_cmpint(kind, ==, GHBCI_WORKER_VALIDATE_PAIN001);
+    g_assert_cmpint(fd, ==, -1);
+    g_assert_cmpuint(g_variant_get_size(body), ==, 4 * GHBCI_WORKER_MESSAGE_MAX);
+    g_variant_unref(body);
+    fd = ghbci_worker_write_statements(NULL, NULL);
+    g_assert_false(ghbci_worker_send(sockets[1], GHBCI_WORKER_REPLY,
+                g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, document, 4 * GHBCI_WORKER_MESSAGE_MAX, 1), fd,
+                &error));
+    g_assert_error(error, G_IO_ERROR, G_IO_ERROR_MESSAGE_TOO_LARGE);
+    g_clear_error(&error);
+    close(fd);
+    g_free(document);
+
+    // bodies not matching their kind are rejected
+    g_assert_true(ghbci_worker_send(sockets[0], GHBCI_WORKER_CALLBACK, g_variant_new("(s)", "PIN"), -1, &error));
+    g_assert_false(ghbci_worker_receive(sockets[1], -1, &kind, &body, &fd, &error));
+    g_assert_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+    g_clear_error(&error);
+
+    // a timeout
+    g_assert_false(ghbci_worker_receive(sockets[1], 1000, &kind, &body, &fd, &error));
+    g_assert_error(error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT);
+    g_clear_error(&error);
+
+    g_socket_close(sockets[0], NULL);
+    g_assert_false(ghbci_worker_receive(sockets[1], -1, &kind, &body, &fd, &error));
+    g_assert_error(error, G_IO_ERROR, G_IO_ERROR_CONNECTION_CLOSED);
+    g_clear_error(&error);
+
+    g_object_unref(sockets[0]);
+    g_object_unref(sockets[1]);
+}
+
+static void
+test_orders(void)
+{
+    GHbciStandingOrder order = {
+        NULL,
+        { "Vermieter", NULL, "DE02120300000000202051", "Miete", "750.00", NULL },
+        g_date_new_dmy(1, G_DATE_FEBRUARY, 2026), NULL, GHBCI_TIME_UNIT_MONTHLY, 1, 1
+    };
+    GHbciStandingOrder* copy;
+    GVariant* variant;
+
+    variant = g_variant_ref_sink(ghbci_worker_standing_order_to_variant(&order));
+    copy = ghbci_worker_standing_order_from_variant(variant);
+    g_variant_unref(variant);
+
+    g_assert_null(copy->order_id);
+    g_assert_cmpstr(copy->transfer.name, ==, "Vermieter");
+    g_assert_null(copy->transfer.bic);
+    g_assert_cmpstr(copy->transfer.amount, ==, "750.00");
+    g_assert_cmpint(g_date_compare(copy->first_date, order.first_date), ==, 0);
+    // no last date stays unlimited
+    g_assert_null(copy->last_date);
+    g_assert_cmpint(copy->time_unit, ==, GHBCI_TIME_UNIT_MONTHLY);
+    g_assert_cmpuint(copy->turnus, ==, 1);
+    g_assert_cmpuint(copy->exec_day, ==, 1);
+
+    ghbci_standing_order_free(copy);
+    g_date_free(order.first_date);
+}
+
+static void
+test_errors(void)
+{
+    GError* error = NULL;
+    GError* copy = NULL;
+    GVariant* body;
+
+    ghbci_set_error(&error, 9942, "3", GHBCI_RETRY_HINT_USER_ACTION, "PIN falsch");
+    body = g_variant_ref_sink(ghbci_worker_error_to_variant(error));
+    ghbci_worker_propagate_variant_error(&copy, body);
+    g_assert_error(copy, GHBCI_ERROR, 9942);
+    g_assert_cmpstr(copy->message, ==, "PIN falsch");
+    g_assert_cmpstr(ghbci_error_get_segment(copy), ==, "3");
+    g_assert_cmpint(ghbci_error_get_retry_hint(copy), ==, GHBCI_RETRY_HINT_USER_ACTION);
+    g_variant_unref(body);
+    g_clear_error(&error);
+    g_clear_error(&copy);
+
+    g_set_error_literal(&error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "not found");
+    body = g_variant_ref_sink(ghbci_worker_error_to_variant(error));
+    ghbci_worker_propagate_variant_error(&copy, body);
+    g_assert_error(copy, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+    g_variant_unref(body);
+    g_clear_error(&error);
+    g_clear_error(&copy);
+}
+
+typedef struct
+{
+    guint calls;
+    const gchar* pin;
+    guint events;
+} Callbacks;
+
+static gchar*
+answer_callback (const gchar* blz, const gchar* userid, gint reason, const gchar* message, const gchar* optional,
+        gpointer user_data)
+{
+    Callbacks* callbacks = user_data;
+
+    g_assert_cmpstr(blz, ==, "12345678");
+    g_assert_cmpstr(userid, ==, "test");
+    g_assert_cmpint(reason, ==, GHBCI_REASON_ENUM_NEED_PT_PIN);
+    g_assert_cmpstr(message, ==, "PIN");
+    callbacks->calls++;
+    return g_strdup(callbacks->pin);
+}
+
+/*
+ * Expects the status event before the log message of the fake worker
+ */
+static void
+collect_event (GHbciWorkerMessage kind, GVariant* body, gpointer user_data)
+{
+    Callbacks* callbacks = user_data;
+    GHbciStatusPayload* payload;
+    const gchar* dialog_id;
+    const gchar* message;
+    gchar* text;
+    gint level;
+
+    if (callbacks->events++ % 2 == 0) {
+        g_assert_cmpint(kind, ==, GHBCI_WORKER_STATUS);
+        payload = ghbci_worker_status_from_variant(body, &text);
+        g_assert_cmpint(payload->tag, ==, GHBCI_STATUSTAG_ENUM_DIALOG_INIT_DONE);
+        g_assert_cmpstr(payload->dialog_id, ==, "4711");
+        g_assert_null(payload->job_name);
+        g_assert_cmpstr(text, ==, "4711");
+        ghbci_status_payload_free(payload);
+        g_free(text);
+    } else {
+        g_assert_cmpint(kind, ==, GHBCI_WORKER_LOG);
+        g_variant_get(body, "(ix&s&s)", &level, NULL, &dialog_id, &message);
+        g_assert_cmpint(level, ==, GHBCI_LOGLEVEL_ENUM_DEBUG);
+        g_assert_cmpstr(dialog_id, ==, "4711");
+        g_assert_cmpstr(message, ==, "Umsätze abgeholt");
+    }
+}
+
+static void
+test_pool(void)
+{
+    Callbacks callbacks = { 0, "0000", 0 };
+    GHbciWorkerPool* pool;
+    GError* error = NULL;
+    GSList* statements;
+    GVariant* reply;
+    gchar* document;
+
+    g_setenv("GHBCI_WORKER", program, TRUE);
+    pool = ghbci_worker_pool_new(g_get_tmp_dir(), 2, answer_callback, collect_event, &callbacks, &error);
+    g_assert_no_error(error);
+    ghbci_worker_pool_set_options(pool, GHBCI_LOGLEVEL_ENUM_DEBUG, FALSE);
+
+    statements = ghbci_worker_pool_get_statements(pool, "12345678", "test", "1234567", FALSE, NULL, &error);
+    g_assert_error(error, GHBCI_ERROR, GHBCI_ERROR_NO_PASSPORT);
+    g_clear_error(&error);
+
+    // errors of the worker keep segment and retry hint
+    g_assert_false(ghbci_worker_pool_add_passport(pool, "12345678", "test", &error));
+    g_assert_error(error, GHBCI_ERROR, 9942);
+    g_assert_cmpint(ghbci_error_get_retry_hint(error), ==, GHBCI_RETRY_HINT_USER_ACTION);
+    g_clear_error(&error);
+
+    callbacks.pin = "1234";
+    g_assert_true(ghbci_worker_pool_add_passport(pool, "12345678", "test", &error));
+    g_assert_no_error(error);
+    g_assert_cmpuint(callbacks.calls, ==, 2);
+
+    // log messages and status events of the request come before the reply
+    statements = ghbci_worker_pool_get_statements(pool, "12345678", "test", "1234567", FALSE, NULL, &error);
+    g_assert_no_error(error);
+    g_assert_cmpuint(callbacks.events, ==, 2);
+    assert_statements(statements);
+    g_slist_free_full(statements, g_object_unref);
+
+    // requests and replies beyond the socket's message size
+    document = g_malloc0(4 * GHBCI_WORKER_MESSAGE_MAX);
+    reply = ghbci_worker_pool_request(pool, NULL, NULL, GHBCI_WORKER_VALIDATE_PAIN001,
+            g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, document, 4 * GHBCI_WORKER_MESSAGE_MAX, 1), &error);
+    g_assert_no_error(error);
+    g_assert_cmpuint(g_variant_get_size(reply), ==, 4 * GHBCI_WORKER_MESSAGE_MAX);
+    g_variant_unref(reply);
+    g_free(document);
+
+    // a crash fails the request only
+    g_test_expect_message(NULL, G_LOG_LEVEL_WARNING, "worker 0 failed*");
+    g_assert_null(ghbci_worker_pool_get_balances(pool, "12345678", "test", "1234567", &error));
+    g_test_assert_expected_messages();
+    g_assert_error(error, GHBCI_ERROR, GHBCI_ERROR_WORKER);
+    g_assert_cmpint(ghbci_error_get_retry_hint(error), ==, GHBCI_RETRY_HINT_RETRY);
+    g_clear_error(&error);
+
+    // the new worker gets the options and the passport again first
+    statements = ghbci_worker_pool_get_statements(pool, "12345678", "test", "1234567", FALSE, NULL, &error);
+    g_assert_no_error(error);
+    g_assert_cmpuint(callbacks.calls, ==, 3);
+    g_assert_cmpuint(callbacks.events, ==, 4);
+    assert_statements(statements);
+    g_slist_free_full(statements, g_object_unref);
+
+    ghbci_worker_pool_free(pool);
+}
+
+static gchar*
+answer_pin (const gchar* blz, const gchar* userid, gint reason, const gchar* message, const gchar* optional,
+        gpointer user_data)
+{
+    return g_strdup(g_str_equal(userid, "wrong") ? "0000" : "1234");
+}
+
+static void
+test_assignment(void)
+{
+    GHbciWorkerPool* pool;
+    GError* error = NULL;
+
+    g_setenv("GHBCI_WORKER", program, TRUE);
+    pool = ghbci_worker_pool_new(g_get_tmp_dir(), 2, answer_pin, NULL, NULL, &error);
+    g_assert_no_error(error);
+
+    // a passport failing to be added doesn't count for its worker
+    g_assert_false(ghbci_worker_pool_add_passport(pool, "12345678", "wrong", &error));
+    g_assert_error(error, GHBCI_ERROR, 9942);
+    g_clear_error(&error);
+    g_assert_true(ghbci_worker_pool_add_passport(pool, "12345678", "test", &error));
+    g_assert_no_error(error);
+
+    g_test_expect_message(NULL, G_LOG_LEVEL_WARNING, "worker 0 failed*");
+    g_assert_null(ghbci_worker_pool_get_balances(pool, "12345678", "test", "1234567", &error));
+    g_test_assert_expected_messages();
+    g_clear_error(&error);
+
+    // the next one goes to the other worker
+    g_assert_true(ghbci_worker_pool_add_passport(pool, "12345678", "other", &error));
+    g_assert_no_error(error);
+    g_test_expect_message(NULL, G_LOG_LEVEL_WARNING, "worker 1 failed*");
+    g_assert_null(ghbci_worker_pool_get_balances(pool, "12345678", "other", "1234567", &error));
+    g_test_assert_expected_messages();
+    g_clear_error(&error);
+
+    ghbci_worker_pool_free(pool);
+}
+
+static void
+test_spawn_failure(void)
+{
+    GError* error = NULL;
+
+    g_setenv("GHBCI_WORKER", "/nonexistent/ghbci-worker", TRUE);
+    g_assert_null(ghbci_worker_pool_new(g_get_tmp_dir(), 1, answer_callback, NULL, NULL, &error));
+    g_assert_error(error, GHBCI_ERROR, GHBCI_ERROR_WORKER);
+    g_clear_error(&error);
+}
+
+int
+main (int argc, char *argv[])
+{
+    if (argc > 1 && g_str_equal(argv[1], "--fd=3"))
+        return run_fake_worker(fake_worker_requests);
+
+    program = argv[0];
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/worker-pool/statements", test_statements);
+    g_test_add_func ("/worker-pool/empty", test_empty);
+    g_test_add_func ("/worker-pool/unsealed", test_unsealed);
+    g_test_add_func ("/worker-pool/messages", test_messages);
+    g_test_add_func ("/worker-pool/orders", test_orders);
+    g_test_add_func ("/worker-pool/errors", test_errors);
+    g_test_add_func ("/worker-pool/pool", test_pool);
+    g_test_add_func ("/worker-pool/assignment", test_assignment);
+    g_test_add_func ("/worker-pool/spawn-failure", test_spawn_failure);
+    return g_test_run ();
+}
+
+
+//vim: expandtab sw=4